@@ -20,13 +20,19 @@
 #include "admin/list_disks_command.h"
 
 #include <iostream>
+#include <map>
 
 #include "common/disk_info.h"
+#include "common/exceptions.h"
 #include "common/human_readable_format.h"
 #include "common/lizardfs_version.h"
 #include "common/moosefs_vector.h"
 #include "common/server_connection.h"
 #include "admin/list_chunkservers_command.h"
+#include "protocol/cltocs.h"
+#include "protocol/cstocl.h"
+
+typedef std::map<std::string, DiskScrubInfo> ScrubInfoMap;
 
 static std::string boolToYesNoString(bool value) {
 	return (value ? "yes" : "no");
@@ -110,8 +116,24 @@ static void printPorcelainStats(const HddStatistics& stats) {
 			<< ' ' << stats.fsyncops;
 }
 
+static void printPorcelainScrubInfo(const ScrubInfoMap& scrubInfo, const std::string& path) {
+	auto it = scrubInfo.find(path);
+	if (it == scrubInfo.end()) {
+		std::cout << " - - - - - - -";
+		return;
+	}
+	const DiskScrubInfo& scrub = it->second;
+	std::cout << ' ' << scrub.chunksTestedInPass
+			<< ' ' << scrub.chunksInPass
+			<< ' ' << scrub.completedPasses
+			<< ' ' << scrub.lastPassEndTime
+			<< ' ' << scrub.lastPassDuration
+			<< ' ' << scrub.bytesLastMinute
+			<< ' ' << scrub.slowdown;
+}
+
 static void printPorcelainMode(const ChunkserverListEntry& cs, const MooseFSVector<DiskInfo>& disks,
-		bool verbose) {
+		const ScrubInfoMap& scrubInfo, bool verbose) {
 	for (const DiskInfo& disk : disks) {
 		std::cout << NetworkAddress(cs.servip, cs.servport).toString()
 				<< ' ' << disk.path
@@ -130,13 +152,36 @@ static void printPorcelainMode(const ChunkserverListEntry& cs, const MooseFSVect
 			printPorcelainStats(disk.lastHourStats);
 			std::cout << ' ';
 			printPorcelainStats(disk.lastDayStats);
+			printPorcelainScrubInfo(scrubInfo, disk.path);
 		}
 		std::cout << std::endl;
 	}
 }
 
+static void printScrubInfo(const ScrubInfoMap& scrubInfo, const std::string& path) {
+	auto it = scrubInfo.find(path);
+	if (it == scrubInfo.end()) {
+		return; // chunkserver doesn't report it
+	}
+	const DiskScrubInfo& scrub = it->second;
+	std::cout << "\ttest pass: " << scrub.chunksTestedInPass << '/' << scrub.chunksInPass;
+	if (scrub.chunksInPass > 0) {
+		std::cout << " (" << 100ULL * scrub.chunksTestedInPass / scrub.chunksInPass << "%)";
+	}
+	std::cout << '\n' << "\tlast complete test pass: ";
+	if (scrub.completedPasses > 0) {
+		std::cout << timeToString(scrub.lastPassEndTime)
+				<< " (took " << scrub.lastPassDuration << "s)";
+	} else {
+		std::cout << '-';
+	}
+	std::cout << '\n' << "\ttested last minute: " << convertToIec(scrub.bytesLastMinute) << "B"
+			<< (scrub.slowdown > 1 ? " (slowed down " + std::to_string(scrub.slowdown) + "x)" : "")
+			<< std::endl;
+}
+
 static void printNormalMode(const ChunkserverListEntry& cs, const MooseFSVector<DiskInfo>& disks,
-		bool verbose) {
+		const ScrubInfoMap& scrubInfo, bool verbose) {
 	for (const DiskInfo& disk : disks) {
 		std::string lastError;
 		if (disk.errorChunkId == 0 && disk.errorTimeStamp == 0) {
@@ -158,6 +203,7 @@ static void printNormalMode(const ChunkserverListEntry& cs, const MooseFSVector<
 				<< "\ttotal space: " << convertToIec(disk.total) << "B\n"
 				<< "\tused space: " << convertToIec(disk.used) << "B\n"
 				<< "\tchunks: " << convertToSi(disk.chunksCount) << std::endl;
+		printScrubInfo(scrubInfo, disk.path);
 		if (verbose) {
 			const HddStatistics* stats[3] = {
 					&disk.lastMinuteStats,
@@ -177,6 +223,22 @@ static void printNormalMode(const ChunkserverListEntry& cs, const MooseFSVector<
 	}
 }
 
+static ScrubInfoMap getScrubInfo(ServerConnection& connection) {
+	ScrubInfoMap result;
+	try {
+		auto request = cltocs::hddScrubInfo::build();
+		auto response = connection.sendAndReceive(request, LIZ_CSTOCL_HDD_SCRUB_INFO);
+		std::vector<DiskScrubInfo> disks;
+		cstocl::hddScrubInfo::deserialize(response, disks);
+		for (const DiskScrubInfo& disk : disks) {
+			result[disk.path] = disk;
+		}
+	} catch (ConnectionException&) {
+		// Older chunkservers close the connection when they get this request
+	}
+	return result;
+}
+
 std::string ListDisksCommand::name() const {
 	return "list-disks";
 }
@@ -184,7 +246,8 @@ std::string ListDisksCommand::name() const {
 LizardFsProbeCommand::SupportedOptions ListDisksCommand::supportedOptions() const {
 	return {
 		{kPorcelainMode, kPorcelainModeDescription},
-		{kVerboseMode,   "Be a little more verbose and show operations statistics."},
+		{kVerboseMode,   "Be a little more verbose and show operations statistics "
+				"(and chunk testing progress in porcelain mode)."},
 	};
 }
 
@@ -209,10 +272,11 @@ void ListDisksCommand::run(const Options& options) const {
 		response = connection.sendAndReceive(request, CSTOCL_HDD_LIST_V2);
 		MooseFSVector<DiskInfo> disks;
 		deserializeAllMooseFsPacketDataNoHeader(response, disks);
+		ScrubInfoMap scrubInfo = getScrubInfo(connection);
 		if (options.isSet(kPorcelainMode)) {
-			printPorcelainMode(cs, disks, options.isSet(kVerboseMode));
+			printPorcelainMode(cs, disks, scrubInfo, options.isSet(kVerboseMode));
 		} else {
-			printNormalMode(cs, disks, options.isSet(kVerboseMode));
+			printNormalMode(cs, disks, scrubInfo, options.isSet(kVerboseMode));
 		}
 	}
 }
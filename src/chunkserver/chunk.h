@@ -27,10 +27,12 @@
 
 #include <condition_variable>
 #include <thread>
+#include <vector>
 
 #include "chunkserver/chunk_format.h"
 #include "common/chunk_part_type.h"
 #include "common/disk_info.h"
+#include "protocol/chunks_with_type.h"
 #include "protocol/MFSCommunication.h"
 
 #define STATSHISTORY (24*60)
@@ -96,7 +98,20 @@ struct folder {
 	double carry;
 	std::thread scanthread;
 	std::thread migratethread;
-	Chunk *testhead,**testtail;
+	Chunk *testhead,**testtail; // all chunks of the folder, in order of creation
+	// background testing (see hdd_scrubber_disk_thread)
+	std::vector<ChunkWithType> scrubqueue; // chunks left in the current pass, ordered by id
+	uint32_t scrubpos;
+	bool scrubqueuebuilt; // false until scrubqueue is built, eg. after resuming a pass
+	uint64_t scrubcursor; // id of the last tested chunk, stored in a file to resume after restart
+	uint32_t scrubpasschunks;
+	uint32_t scrubpassstart;
+	uint32_t scrubpasses;
+	uint32_t scrublastpassend;
+	uint32_t scrublastpassduration;
+	uint64_t scrubbytes;
+	uint64_t scrubbyteslastminute;
+	uint32_t scrubslowdown;
 	struct folder *next;
 };
 
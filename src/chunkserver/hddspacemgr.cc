@@ -54,9 +54,12 @@
 #ifdef LIZARDFS_HAVE_THREAD_LOCAL
 #include <array>
 #endif // LIZARDFS_HAVE_THREAD_LOCAL
+#include <algorithm>
 #include <atomic>
 #include <deque>
 #include <list>
+#include <map>
+#include <memory>
 #include <mutex>
 #include <string>
 #include <thread>
@@ -68,6 +71,7 @@
 #include "chunkserver/indexed_resource_pool.h"
 #include "chunkserver/iostat.h"
 #include "chunkserver/open_chunk.h"
+#include "chunkserver/scrub_rate_controller.h"
 #include "common/cfg.h"
 #include "common/cwrap.h"
 #include "common/crc.h"
@@ -105,6 +109,8 @@
 #define CHUNKLOCKED ((void*)1)
 
 static std::atomic<unsigned> HDDTestFreq_ms(10 * 1000);
+static std::atomic<unsigned> HDDTestBatchSize(8);
+static std::atomic<unsigned> HDDTestSlowdownLatency_us(50 * 1000);
 
 /// Number of bytes which should be addded to each disk's used space
 static uint64_t gLeaveFree;
@@ -139,12 +145,11 @@ static std::deque<ChunkWithVersionAndType> gNewChunks;
 static std::atomic<uint32_t> errorcounter(0);
 static std::atomic_int hddspacechanged(0);
 
-static std::thread foldersthread, delayedthread, testerthread;
+static std::thread foldersthread, delayedthread, scrubberthread;
 static std::thread test_chunk_thread;
 
 static std::atomic<int> term(0);
 static uint8_t folderactions = 0; // no need for atomic; guarded by folderlock anyway
-static std::atomic<uint8_t> testerreset(0);
 
 // master reports = damaged chunks, lost chunks, new chunks
 static std::mutex gMasterReportsLock;
@@ -156,7 +161,7 @@ static cntcond *cclist = NULL;
 // folderhead + all data in structures (except folder::cstat)
 static std::mutex folderlock;
 
-// chunk tester
+// folder::testhead lists
 static std::mutex testlock;
 
 #ifndef LIZARDFS_HAVE_THREAD_LOCAL
@@ -458,6 +463,27 @@ void hdd_diskinfo_movestats(void) {
 		}
 		f->stats[f->statspos] = f->cstat;
 		f->cstat.clear();
+		f->scrubbyteslastminute = f->scrubbytes;
+		f->scrubbytes = 0;
+	}
+}
+
+void hdd_get_scrub_info(std::vector<DiskScrubInfo>& disks) {
+	TRACETHIS();
+	std::lock_guard<std::mutex> folderlock_guard(folderlock);
+	for (folder *f = folderhead; f; f = f->next) {
+		disks.emplace_back();
+		DiskScrubInfo& disk = disks.back();
+		disk.path = f->path;
+		disk.chunksInPass = f->scrubpasschunks;
+		uint32_t chunksLeft = f->scrubqueue.size() - f->scrubpos;
+		disk.chunksTestedInPass = f->scrubpasschunks > chunksLeft ? f->scrubpasschunks - chunksLeft : 0;
+		disk.passStartTime = f->scrubpassstart;
+		disk.completedPasses = f->scrubpasses;
+		disk.lastPassEndTime = f->scrublastpassend;
+		disk.lastPassDuration = f->scrublastpassduration;
+		disk.bytesLastMinute = f->scrubbyteslastminute;
+		disk.slowdown = f->scrubslowdown;
 	}
 }
 
@@ -740,19 +766,6 @@ static inline Chunk* hdd_chunk_find(uint64_t chunkId, ChunkPartType chunkType) {
 	return hdd_chunk_get(chunkId, chunkType, CH_NEW_NONE, ChunkFormat::IMPROPER);
 }
 
-static void hdd_chunk_testmove(Chunk *c) {
-	TRACETHIS();
-	std::lock_guard<std::mutex> testlock_guard(testlock);
-	if (c->testnext) {
-		*(c->testprev) = c->testnext;
-		c->testnext->testprev = c->testprev;
-		c->testnext = NULL;
-		c->testprev = c->owner->testtail;
-		*(c->testprev) = c;
-		c->owner->testtail = &(c->testnext);
-	}
-}
-
 // no locks - locked by caller
 static inline void hdd_refresh_usage(folder *f) {
 	TRACETHIS();
@@ -937,7 +950,6 @@ void hdd_check_folders() {
 				}
 				free(f->path);
 				delete f;
-				testerreset = 1;
 			} else {
 				fptr = &(f->next);
 			}
@@ -1209,7 +1221,6 @@ static int hdd_io_begin(Chunk *c,int newflag, uint32_t chunk_version = std::nume
 	int status;
 
 //      syslog(LOG_NOTICE,"chunk: %" PRIu64 " - before io",c->chunkid);
-	hdd_chunk_testmove(c);
 	if (c->refcount==0) {
 		bool add = (c->fd < 0);
 
@@ -2844,112 +2855,241 @@ void hdd_test_chunk(ChunkWithVersionAndType chunk) {
 	test_chunk_queue.put(chunk);
 }
 
-void hdd_tester_thread() {
+/* background chunk testing (scrubbing) */
+
+/*
+ * Chunks are tested by one thread per physical device (folders placed on the same device share
+ * it), so that disks are tested in parallel and no disk is read by several testers at once.
+ * Each folder is tested in passes -- a pass tests all chunks of the folder in order of their ids.
+ * Batches of chunks taken from the pass are tested in order of inode numbers of chunk files to
+ * reduce seeking. Position of the pass is stored in the folder, so that testing resumes where it
+ * stopped after restart. The base pace (one chunk every HDD_TEST_FREQ seconds per device) is
+ * slowed down when foreground reads from the device are slow.
+ */
+
+struct ScrubberDiskWorker {
+	std::thread thread;
+	std::atomic<bool> stop;
+
+	ScrubberDiskWorker() : stop(false) {}
+};
+
+static std::string hdd_scrub_progress_filename(const folder *f) {
+	return std::string(f->path) + ".scrub_progress";
+}
+
+/* folderlock: LOCKED */
+static void hdd_scrub_load_progress(folder *f) {
+	cstream_t fd(fopen(hdd_scrub_progress_filename(f).c_str(), "r"));
+	uint64_t cursor;
+	uint32_t passstart;
+	if (fd && fscanf(fd.get(), "%" SCNu64 " %" SCNu32, &cursor, &passstart) == 2) {
+		f->scrubcursor = cursor;
+		f->scrubpassstart = passstart;
+	}
+}
+
+static void hdd_scrub_save_progress(const std::string& filename, uint64_t cursor,
+		uint32_t passstart) {
+	std::string tmpname = filename + ".tmp";
+	cstream_t fd(fopen(tmpname.c_str(), "w"));
+	if (!fd) {
+		return; // eg. read-only folder marked for removal, progress won't be kept after restart
+	}
+	bool ok = fprintf(fd.get(), "%" PRIu64 " %" PRIu32 "\n", cursor, passstart) > 0;
+	ok = (fclose(fd.release()) == 0) && ok;
+	if (!ok || rename(tmpname.c_str(), filename.c_str()) < 0) {
+		unlink(tmpname.c_str());
+	}
+}
+
+/* folderlock: LOCKED */
+static void hdd_scrub_start_pass(folder *f) {
+	std::lock_guard<std::mutex> testlock_guard(testlock);
+	f->scrubqueue.clear();
+	f->scrubpos = 0;
+	f->scrubpasschunks = 0;
+	for (Chunk *c = f->testhead; c; c = c->testnext) {
+		f->scrubpasschunks++;
+		if (c->chunkid > f->scrubcursor) {
+			f->scrubqueue.emplace_back(c->chunkid, c->type());
+		}
+	}
+	std::sort(f->scrubqueue.begin(), f->scrubqueue.end(),
+			[](const ChunkWithType& a, const ChunkWithType& b) { return a.id < b.id; });
+	f->scrubqueuebuilt = true;
+	if (f->scrubpassstart == 0) {
+		f->scrubpassstart = time(NULL);
+	}
+}
+
+/* folderlock: LOCKED */
+static void hdd_scrub_take_batch(folder *f, uint32_t batchSize, std::vector<ChunkWithType>& batch) {
+	if (f->scrubpos >= f->scrubqueue.size()) {
+		if (f->scrubqueuebuilt && (!f->scrubqueue.empty() || f->scrubcursor > 0)) {
+			// All chunks of the pass were tested
+			uint32_t now = time(NULL);
+			f->scrubpasses++;
+			f->scrublastpassend = now;
+			f->scrublastpassduration = now - std::min(now, f->scrubpassstart);
+			f->scrubcursor = 0;
+			f->scrubpassstart = 0;
+		}
+		hdd_scrub_start_pass(f);
+	}
+	while (batch.size() < batchSize && f->scrubpos < f->scrubqueue.size()) {
+		batch.push_back(f->scrubqueue[f->scrubpos++]);
+	}
+}
+
+/* Tests the chunks and returns the number of bytes read */
+static uint64_t hdd_scrub_test_batch(const std::vector<ChunkWithType>& batch) {
+	struct BatchEntry {
+		ino_t inode;
+		uint64_t size;
+		ChunkWithType chunk;
+	};
+	std::vector<BatchEntry> entries;
+	for (const ChunkWithType& chunk : batch) {
+		Chunk *c = hdd_chunk_find(chunk.id, chunk.type);
+		if (c == NULL) {
+			continue; // deleted in the meantime
+		}
+		std::string filename = c->filename();
+		hdd_chunk_release(c);
+		struct stat st;
+		if (stat(filename.c_str(), &st) < 0) {
+			st.st_ino = 0;
+			st.st_size = 0;
+		}
+		entries.push_back({st.st_ino, (uint64_t)st.st_size, chunk});
+	}
+	std::sort(entries.begin(), entries.end(),
+			[](const BatchEntry& a, const BatchEntry& b) { return a.inode < b.inode; });
+
+	uint64_t bytes = 0;
+	for (const BatchEntry& entry : entries) {
+		if (term) {
+			break;
+		}
+		int status = hdd_int_test(entry.chunk.id, 0, entry.chunk.type);
+		if (status != LIZARDFS_STATUS_OK && status != LIZARDFS_ERROR_NOCHUNK) {
+			hdd_report_damaged_chunk(entry.chunk.id, entry.chunk.type);
+		}
+		bytes += entry.size;
+	}
+	return bytes;
+}
+
+static void hdd_scrubber_disk_thread(dev_t devid, std::atomic<bool> *stop) {
 	TRACETHIS();
-	folder *f, *of;
-	Chunk *c;
-	uint64_t chunkid;
-	uint32_t version;
-	ChunkPartType chunkType = slice_traits::standard::ChunkPartType();
-	uint32_t cnt;
-	uint64_t start_us, end_us;
-
-	f = folderhead;
-	cnt = 0;
-	while (!term) {
-		start_us = get_usectime();
-		chunkid = 0;
-		version = 0;
+	ScrubRateController rateController(HDDTestSlowdownLatency_us);
+	Timer sinceRateUpdate;
+	uint32_t folderIndex = 0;
+	uint32_t lastBatchSize = HDDTestBatchSize;
+	uint64_t waited_ms = 0;
+
+	while (!term && !*stop) {
+		unsigned step_ms = std::min(HDDTestFreq_ms.load(), 1000U);
+		usleep(1000 * step_ms);
+		waited_ms += step_ms;
+
+		std::vector<ChunkWithType> batch;
+		std::string progressFilename;
 		{
 			std::lock_guard<std::mutex> folderlock_guard(folderlock);
-			std::lock_guard<std::mutex> hashlock_guard(hashlock);
-			std::lock_guard<std::mutex> testlock_guard(testlock);
-			uint8_t testerresetExpected = 1;
-			if (testerreset.compare_exchange_strong(testerresetExpected, 0)) {
-				f = folderhead;
-				cnt = 0;
-			}
-			cnt += std::min(HDDTestFreq_ms.load(), 1000U);
-			if (cnt < HDDTestFreq_ms || folderactions == 0 || folderhead == nullptr) {
-				chunkid = 0;
-			} else {
-				cnt = 0;
-				of = f;
-				do {
-					f = f->next;
-					if (f == nullptr) {
-						f = folderhead;
-					}
-				} while ((f->damaged || f->todel || f->toremove || f->scanstate != SCST_WORKING) && of != f);
-				if (of == f && (f->damaged || f->todel || f->toremove || f->scanstate != SCST_WORKING)) {
-					chunkid = 0;
-				} else {
-					c = f->testhead;
-					if (c && c->state==CH_AVAIL) {
-						chunkid = c->chunkid;
-						version = c->version;
-						chunkType = c->type();
-					}
+			if (folderactions == 0) {
+				continue;
+			}
+			std::vector<folder*> folders;
+			uint64_t readOps = 0, readUsec = 0;
+			for (folder *f = folderhead; f; f = f->next) {
+				if (f->damaged || f->lfd < 0 || f->devid != devid) {
+					continue;
+				}
+				readOps += f->cstat.rops;
+				readUsec += f->cstat.usecreadsum;
+				if (!f->todel && !f->toremove && f->scanstate == SCST_WORKING) {
+					folders.push_back(f);
 				}
 			}
-		}
-		if (chunkid > 0) {
-			if (hdd_int_test(chunkid, version, chunkType) != LIZARDFS_STATUS_OK) {
-				hdd_report_damaged_chunk(chunkid, chunkType);
+			if (sinceRateUpdate.elapsed_ms() >= 1000) {
+				sinceRateUpdate.reset();
+				rateController.setLatencyThreshold(HDDTestSlowdownLatency_us);
+				rateController.update(readOps, readUsec);
+			}
+			for (folder *f : folders) {
+				f->scrubslowdown = rateController.slowdown();
 			}
-			chunkid = 0;
+			uint64_t required_ms = uint64_t(HDDTestFreq_ms) * lastBatchSize * rateController.slowdown();
+			if (folders.empty() || waited_ms < required_ms) {
+				continue;
+			}
+			folder *f = folders[folderIndex++ % folders.size()];
+			hdd_scrub_take_batch(f, HDDTestBatchSize, batch);
+			progressFilename = hdd_scrub_progress_filename(f);
 		}
-		end_us = get_usectime();
-		if (end_us > start_us) {
-			unsigned time_to_sleep_us = 1000 * std::min(HDDTestFreq_ms.load(), 1000U);
-			end_us -= start_us;
-			if (end_us < time_to_sleep_us) {
-				usleep(time_to_sleep_us - end_us);
+		waited_ms = 0;
+		lastBatchSize = std::max<uint32_t>(batch.size(), 1);
+		if (batch.empty()) {
+			continue;
+		}
+
+		uint64_t cursor = batch.back().id;
+		uint64_t bytes = hdd_scrub_test_batch(batch);
+		uint32_t passstart = 0;
+		bool found = false;
+		{
+			std::lock_guard<std::mutex> folderlock_guard(folderlock);
+			// The folder might have been removed in the meantime
+			for (folder *f = folderhead; f && !found; f = f->next) {
+				if (hdd_scrub_progress_filename(f) == progressFilename) {
+					f->scrubcursor = cursor;
+					f->scrubbytes += bytes;
+					passstart = f->scrubpassstart;
+					found = true;
+				}
 			}
 		}
+		if (found) {
+			hdd_scrub_save_progress(progressFilename, cursor, passstart);
+		}
 	}
 }
 
-void hdd_testshuffle(folder *f) {
+void hdd_scrubber_thread() {
 	TRACETHIS();
-	uint32_t i,j,chunksno;
-	Chunk **csorttab,*c;
-	std::lock_guard<std::mutex> testlock_guard(testlock);
-	chunksno = 0;
-	for (c=f->testhead ; c ; c=c->testnext) {
-		chunksno++;
-	}
-	if (chunksno>0) {
-		csorttab = (Chunk**) malloc(sizeof(Chunk*)*chunksno);
-		passert(csorttab);
-		chunksno = 0;
-		for (c=f->testhead ; c ; c=c->testnext) {
-			csorttab[chunksno++] = c;
-		}
-		if (chunksno>1) {
-			for (i=0 ; i<chunksno-1 ; i++) {
-				j = i+rnd_ranged<uint32_t>(chunksno-i);
-				if (j!=i) {
-					c = csorttab[i];
-					csorttab[i] = csorttab[j];
-					csorttab[j] = c;
+	std::map<dev_t, std::unique_ptr<ScrubberDiskWorker>> workers;
+	while (!term) {
+		std::vector<dev_t> devices;
+		{
+			std::lock_guard<std::mutex> folderlock_guard(folderlock);
+			for (folder *f = folderhead; f; f = f->next) {
+				if (!f->damaged && f->lfd >= 0) {
+					devices.push_back(f->devid);
 				}
 			}
 		}
-	} else {
-		csorttab = NULL;
-	}
-	f->testhead = NULL;
-	f->testtail = &(f->testhead);
-	for (i=0 ; i<chunksno ; i++) {
-		c = csorttab[i];
-		c->testnext = NULL;
-		c->testprev = f->testtail;
-		*(c->testprev) = c;
-		f->testtail = &(c->testnext);
+		for (dev_t devid : devices) {
+			if (workers.count(devid) == 0) {
+				std::unique_ptr<ScrubberDiskWorker> worker(new ScrubberDiskWorker());
+				worker->thread = std::thread(hdd_scrubber_disk_thread, devid, &worker->stop);
+				workers[devid] = std::move(worker);
+			}
+		}
+		for (auto it = workers.begin(); it != workers.end();) {
+			if (std::find(devices.begin(), devices.end(), it->first) == devices.end()) {
+				it->second->stop = true;
+				it->second->thread.join();
+				it = workers.erase(it);
+			} else {
+				++it;
+			}
+		}
+		sleep(1);
 	}
-	if (csorttab) {
-		free(csorttab);
+	for (auto& worker : workers) {
+		worker.second->thread.join();
 	}
 }
 
@@ -3302,7 +3442,6 @@ void *hdd_folder_scan(void *arg) {
 
 	hdd_folder_scan_layout(f, begin_time, 1);
 	hdd_folder_scan_layout(f, begin_time, 0);
-	hdd_testshuffle(f);
 	gScansInProgress--;
 
 	std::lock_guard<std::mutex> folderlock_guard(folderlock);
@@ -3356,7 +3495,7 @@ void hdd_term(void) {
 
 	i = term.exchange(1); // if term is non zero here then it means that threads have not been started, so do not join with them
 	if (i==0) {
-		testerthread.join();
+		scrubberthread.join();
 		foldersthread.join();
 		delayedthread.join();
 		try {
@@ -3690,9 +3829,11 @@ int hdd_parseline(char *hddcfgline) {
 	f->testhead = NULL;
 	f->testtail = &(f->testhead);
 	f->carry = (double)(random()&0x7FFFFFFF)/(double)(0x7FFFFFFF);
+	if (!damaged) {
+		hdd_scrub_load_progress(f);
+	}
 	f->next = folderhead;
 	folderhead = f;
-	testerreset = 1;
 	return 2;
 }
 
@@ -3788,6 +3929,9 @@ void hdd_reload(void) {
 	PerformFsync = cfg_getuint32("PERFORM_FSYNC", 1);
 
 	HDDTestFreq_ms = cfg_ranged_get("HDD_TEST_FREQ", 10., 0.001, 1000000.) * 1000;
+	HDDTestBatchSize = cfg_get_minmaxvalue<uint32_t>("HDD_TEST_BATCH_SIZE", 8, 1, 1024);
+	HDDTestSlowdownLatency_us =
+			cfg_get_minmaxvalue<uint32_t>("HDD_TEST_SLOWDOWN_LATENCY_MS", 50, 1, 1000000) * 1000;
 
 	gPunchHolesInFiles = cfg_getuint32("HDD_PUNCH_HOLES", 0);
 
@@ -3812,7 +3956,7 @@ void hdd_reload(void) {
 int hdd_late_init(void) {
 	TRACETHIS();
 	term = 0;
-	testerthread = std::thread(hdd_tester_thread);
+	scrubberthread = std::thread(hdd_scrubber_thread);
 	foldersthread = std::thread(hdd_folders_thread);
 	delayedthread = std::thread(hdd_free_resources_thread);
 	try {
@@ -3877,6 +4021,9 @@ int hdd_init(void) {
 
 	gAdviseNoCache = cfg_getuint32("HDD_ADVISE_NO_CACHE", 0);
 	HDDTestFreq_ms = cfg_ranged_get("HDD_TEST_FREQ", 10., 0.001, 1000000.) * 1000;
+	HDDTestBatchSize = cfg_get_minmaxvalue<uint32_t>("HDD_TEST_BATCH_SIZE", 8, 1, 1024);
+	HDDTestSlowdownLatency_us =
+			cfg_get_minmaxvalue<uint32_t>("HDD_TEST_SLOWDOWN_LATENCY_MS", 50, 1, 1000000) * 1000;
 
 	gPunchHolesInFiles = cfg_getuint32("HDD_PUNCH_HOLES", 0);
 
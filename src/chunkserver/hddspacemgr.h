@@ -27,6 +27,7 @@
 #include "chunkserver/output_buffer.h"
 #include "common/chunk_part_type.h"
 #include "common/chunk_with_version_and_type.h"
+#include "common/disk_info.h"
 #include "protocol/chunks_with_type.h"
 #include "protocol/MFSCommunication.h"
 
@@ -43,6 +44,7 @@ uint32_t hdd_diskinfo_v1_size();
 void hdd_diskinfo_v1_data(uint8_t *buff);
 uint32_t hdd_diskinfo_v2_size();
 void hdd_diskinfo_v2_data(uint8_t *buff);
+void hdd_get_scrub_info(std::vector<DiskScrubInfo>& disks);
 
 /* lock/unlock pair */
 void hdd_get_chunks_begin();
@@ -898,6 +898,23 @@ void worker_hdd_list_v2(csserventry *eptr, const uint8_t *data,
 	hdd_diskinfo_v2_data(ptr); // unlock
 }
 
+void worker_hdd_scrub_info(csserventry *eptr, const uint8_t *data, uint32_t length) {
+	TRACETHIS();
+	try {
+		cltocs::hddScrubInfo::deserialize(data, length);
+	} catch (IncorrectDeserializationException &e) {
+		lzfs_pretty_syslog(LOG_NOTICE, "LIZ_CLTOCS_HDD_SCRUB_INFO - bad packet: %s (length: %" PRIu32 ")",
+				e.what(), length);
+		eptr->state = CLOSE;
+		return;
+	}
+	std::vector<DiskScrubInfo> disks;
+	hdd_get_scrub_info(disks);
+	std::vector<uint8_t> buffer;
+	cstocl::hddScrubInfo::serialize(buffer, disks);
+	worker_create_attached_packet(eptr, buffer);
+}
+
 void worker_chart(csserventry *eptr, const uint8_t *data, uint32_t length) {
 	TRACETHIS();
 	uint32_t chartid;
@@ -1036,6 +1053,9 @@ void worker_gotpacket(csserventry *eptr, uint32_t type, const uint8_t *data, uin
 		case CLTOCS_HDD_LIST_V2:
 			worker_hdd_list_v2(eptr, data, length);
 			break;
+		case LIZ_CLTOCS_HDD_SCRUB_INFO:
+			worker_hdd_scrub_info(eptr, data, length);
+			break;
 		case CLTOAN_CHART:
 			worker_chart(eptr, data, length);
 			break;
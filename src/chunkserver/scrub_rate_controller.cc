@@ -0,0 +1,48 @@
+/*
+   Copyright 2017 Skytechnology sp. z o.o.
+
+   This file is part of LizardFS.
+
+   LizardFS is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, version 3.
+
+   LizardFS is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with LizardFS. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "common/platform.h"
+#include "chunkserver/scrub_rate_controller.h"
+
+#include <algorithm>
+
+const uint32_t ScrubRateController::kMaxSlowdown;
+const uint64_t ScrubRateController::kMinReadOps;
+
+void ScrubRateController::update(uint64_t readOps, uint64_t readUsec) {
+	uint64_t ops = readOps;
+	uint64_t usec = readUsec;
+	if (readOps >= lastOps_ && readUsec >= lastUsec_) {
+		ops -= lastOps_;
+		usec -= lastUsec_;
+	} // otherwise the counters were reset and contain only the new reads
+	lastOps_ = readOps;
+	lastUsec_ = readUsec;
+
+	if (ops < kMinReadOps) {
+		// The disk is (almost) idle
+		slowdown_ = std::max<uint32_t>(slowdown_ / 2, 1);
+		return;
+	}
+	uint64_t averageLatency_us = usec / ops;
+	if (averageLatency_us > latencyThreshold_us_) {
+		slowdown_ = std::min(slowdown_ * 2, kMaxSlowdown);
+	} else if (averageLatency_us < latencyThreshold_us_ / 2) {
+		slowdown_ = std::max<uint32_t>(slowdown_ / 2, 1);
+	}
+}
@@ -0,0 +1,66 @@
+/*
+   Copyright 2017 Skytechnology sp. z o.o.
+
+   This file is part of LizardFS.
+
+   LizardFS is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, version 3.
+
+   LizardFS is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with LizardFS. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "common/platform.h"
+
+#include <cstdint>
+
+/*!
+ * \brief Adapts the pace of background chunk testing of a disk to its foreground load.
+ *
+ * The controller is fed with counters of foreground (client and replication) reads of the disk
+ * and computes a slowdown factor, by which the base interval between chunk tests is multiplied.
+ * The factor is doubled each time the average read latency observed since the previous update
+ * exceeds the threshold and halved when the latency drops below half of the threshold.
+ */
+class ScrubRateController {
+public:
+	static const uint32_t kMaxSlowdown = 16;
+	// Fewer reads than that don't tell anything about the load of the disk
+	static const uint64_t kMinReadOps = 10;
+
+	explicit ScrubRateController(uint32_t latencyThreshold_us)
+			: latencyThreshold_us_(latencyThreshold_us),
+			  slowdown_(1),
+			  lastOps_(0),
+			  lastUsec_(0) {
+	}
+
+	void setLatencyThreshold(uint32_t latencyThreshold_us) {
+		latencyThreshold_us_ = latencyThreshold_us;
+	}
+
+	/*!
+	 * \brief Updates the slowdown factor.
+	 * \param readOps number of foreground reads, may be reset to 0 between calls
+	 * \param readUsec total time of these reads in microseconds
+	 */
+	void update(uint64_t readOps, uint64_t readUsec);
+
+	uint32_t slowdown() const {
+		return slowdown_;
+	}
+
+private:
+	uint32_t latencyThreshold_us_;
+	uint32_t slowdown_;
+	uint64_t lastOps_;
+	uint64_t lastUsec_;
+};
@@ -0,0 +1,68 @@
+/*
+   Copyright 2017 Skytechnology sp. z o.o.
+
+   This file is part of LizardFS.
+
+   LizardFS is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, version 3.
+
+   LizardFS is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with LizardFS. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "common/platform.h"
+#include "chunkserver/scrub_rate_controller.h"
+
+#include <gtest/gtest.h>
+
+TEST(ScrubRateControllerTests, SlowsDownWhenReadsAreSlow) {
+	ScrubRateController controller(10000);
+	EXPECT_EQ(1U, controller.slowdown());
+
+	// 100 reads, 20ms each
+	controller.update(100, 100 * 20000);
+	EXPECT_EQ(2U, controller.slowdown());
+	controller.update(200, 200 * 20000);
+	EXPECT_EQ(4U, controller.slowdown());
+	for (int i = 3; i < 10; ++i) {
+		controller.update(i * 100, i * 100 * 20000);
+	}
+	EXPECT_EQ(ScrubRateController::kMaxSlowdown, controller.slowdown());
+
+	// Latency between half of the threshold and the threshold doesn't change anything
+	controller.update(1100, 900 * 20000 + 200 * 7000);
+	EXPECT_EQ(ScrubRateController::kMaxSlowdown, controller.slowdown());
+
+	// Fast reads
+	controller.update(1200, 900 * 20000 + 200 * 7000 + 100 * 1000);
+	EXPECT_EQ(ScrubRateController::kMaxSlowdown / 2, controller.slowdown());
+}
+
+TEST(ScrubRateControllerTests, SpeedsUpWhenDiskIsIdle) {
+	ScrubRateController controller(10000);
+	controller.update(100, 100 * 20000);
+	controller.update(200, 200 * 20000);
+	EXPECT_EQ(4U, controller.slowdown());
+
+	controller.update(205, 200 * 20000 + 5 * 50000);
+	EXPECT_EQ(2U, controller.slowdown());
+	controller.update(205, 200 * 20000 + 5 * 50000);
+	EXPECT_EQ(1U, controller.slowdown());
+	controller.update(205, 200 * 20000 + 5 * 50000);
+	EXPECT_EQ(1U, controller.slowdown());
+}
+
+TEST(ScrubRateControllerTests, CountersReset) {
+	ScrubRateController controller(10000);
+	controller.update(1000, 1000 * 1000);
+	EXPECT_EQ(1U, controller.slowdown());
+	// Counters were reset, only 50 slow reads happened since then
+	controller.update(50, 50 * 30000);
+	EXPECT_EQ(2U, controller.slowdown());
+}
@@ -19,15 +19,36 @@
 #include "common/platform.h"
 #include "common/chunkserver_stats.h"
 
+#include <algorithm>
+#include <cmath>
 #include <mutex>
 #include <unordered_map>
 
 // ChunkserverEntry implementation
 
 constexpr int ChunkserverStats::ChunkserverEntry::defectiveTimeout_ms;
+constexpr int ChunkserverStats::ChunkserverEntry::readLatencyValidity_ms;
+constexpr float ChunkserverStats::ChunkserverEntry::kReferenceReadLatency_us;
+constexpr float ChunkserverStats::ChunkserverEntry::kEwmaWeight;
 
 ChunkserverStats::ChunkserverEntry::ChunkserverEntry(): pendingReads_(0), pendingWrites_(0),
-		defects_(0), defectiveTimeout_(std::chrono::milliseconds(defectiveTimeout_ms)) {
+		defects_(0), defectiveTimeout_(std::chrono::milliseconds(defectiveTimeout_ms)),
+		readLatencyEwma_us_(0), readBandwidthEwma_(0),
+		readLatencyValidity_(std::chrono::milliseconds(readLatencyValidity_ms)) {
+}
+
+void ChunkserverStats::ChunkserverEntry::addReadSample(uint64_t latency_us, uint32_t bytes) {
+	float latency = std::max<uint64_t>(latency_us, 1);
+	float bandwidth = bytes * 1000000. / latency;
+	if (readLatencyEwma_us_ == 0 || readLatencyValidity_.expired()) {
+		// start from scratch, old averages don't tell anything
+		readLatencyEwma_us_ = latency;
+		readBandwidthEwma_ = bandwidth;
+	} else {
+		readLatencyEwma_us_ += kEwmaWeight * (latency - readLatencyEwma_us_);
+		readBandwidthEwma_ += kEwmaWeight * (bandwidth - readBandwidthEwma_);
+	}
+	readLatencyValidity_.reset();
 }
 
 // ChunkserverStats implementation
@@ -72,6 +93,42 @@ void ChunkserverStats::markDefective(const NetworkAddress& address) {
 	chunkserver.defectiveTimeout_.reset();
 }
 
+void ChunkserverStats::readOperationFinished(const NetworkAddress& address,
+		uint64_t latency_us, uint32_t bytes) {
+	std::unique_lock<std::mutex> lock(mutex_);
+	ChunkserverEntry &chunkserver = chunkserverEntries_[address];
+	chunkserver.pendingReads_--;
+	chunkserver.defects_ = 0;
+	chunkserver.addReadSample(latency_us, bytes);
+	readLatencies_[address].add(latency_us);
+}
+
+std::vector<std::pair<NetworkAddress, LatencyHistogram>> ChunkserverStats::readLatencies() {
+	std::unique_lock<std::mutex> lock(mutex_);
+	return std::vector<std::pair<NetworkAddress, LatencyHistogram>>(
+			readLatencies_.begin(), readLatencies_.end());
+}
+
+uint64_t ChunkserverStats::readLatencyPercentile(const NetworkAddress& address,
+		double percentile, uint64_t minCount) {
+	std::unique_lock<std::mutex> lock(mutex_);
+	auto it = readLatencies_.find(address);
+	if (it == readLatencies_.end() || it->second.count() < std::max<uint64_t>(minCount, 1)) {
+		return 0;
+	}
+	const LatencyHistogram &histogram = it->second;
+	uint64_t threshold = std::ceil(histogram.count() * percentile / 100);
+	uint64_t count = 0;
+	for (int k = 0; k < LatencyHistogram::kBuckets - 1; ++k) {
+		count += histogram.bucketCount(k);
+		if (count >= threshold) {
+			return LatencyHistogram::bucketLimit(k);
+		}
+	}
+	// the last bucket has no upper limit, use the limit of the previous one
+	return LatencyHistogram::bucketLimit(LatencyHistogram::kBuckets - 2);
+}
+
 float ChunkserverStats::ChunkserverEntry::score() const {
 	if (defects_ > 0 && !defectiveTimeout_.expired()) {
 		return 1. / (defects_ + 1);
@@ -80,6 +137,16 @@ float ChunkserverStats::ChunkserverEntry::score() const {
 	}
 }
 
+float ChunkserverStats::ChunkserverEntry::readScore() const {
+	float latency_us = kReferenceReadLatency_us;
+	if (readLatencyEwma_us_ > 0 && !readLatencyValidity_.expired()) {
+		latency_us = readLatencyEwma_us_;
+	}
+	// our pending reads will most probably be served before the new one
+	float expected_us = latency_us * (pendingReads_ + 1);
+	return score() * kReferenceReadLatency_us / (kReferenceReadLatency_us + expected_us);
+}
+
 // ChunkserverStatsProxy implementation
 
 ChunkserverStatsProxy::~ChunkserverStatsProxy() {
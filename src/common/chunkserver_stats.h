@@ -23,7 +23,10 @@
 #include <chrono>
 #include <mutex>
 #include <unordered_map>
+#include <utility>
+#include <vector>
 
+#include "common/latency_histogram.h"
 #include "common/network_address.h"
 #include "common/time_utils.h"
 
@@ -42,6 +45,11 @@
 //
 // Successful operations on chunkservers considered "defective" should call markWorking().
 //
+// Latencies of successful reads are gathered in histograms (see readOperationFinished()).
+// Exponentially weighted moving averages of the latency and bandwidth of recent reads are kept
+// as well and readers should prefer chunkservers with better readScore() -- the ones which are
+// fast and not busy with our other reads.
+//
 // All methods are thread safe.
 //
 class ChunkserverStats {
@@ -64,13 +72,39 @@ public:
 
 		float score() const;
 
+		// Like score(), but also takes into account the expected time of a read, computed
+		// from the average latency of recent reads and the number of our pending reads.
+		// Chunkservers without recent reads are assumed to have kReferenceReadLatency_us.
+		float readScore() const;
+
+		// Average latency of recent reads, 0 if there were none
+		float readLatencyEwma_us() const {
+			return readLatencyEwma_us_;
+		}
+
+		// Average bandwidth of recent reads in bytes per second, 0 if there were none
+		float readBandwidthEwma() const {
+			return readBandwidthEwma_;
+		}
+
 	private:
 		static constexpr int defectiveTimeout_ms = 2000;
+		// Latency averages older than that are not used in readScore() to let the chunkservers
+		// which were slow prove they got better
+		static constexpr int readLatencyValidity_ms = 10000;
+		static constexpr float kReferenceReadLatency_us = 2000;
+		// Weight of a new sample in the moving averages
+		static constexpr float kEwmaWeight = 0.2;
+
+		void addReadSample(uint64_t latency_us, uint32_t bytes);
 
 		uint32_t pendingReads_;
 		uint32_t pendingWrites_;
 		uint32_t defects_;
 		Timeout defectiveTimeout_;
+		float readLatencyEwma_us_;
+		float readBandwidthEwma_;
+		Timeout readLatencyValidity_;
 
 		friend class ChunkserverStats;
 	};
@@ -88,9 +122,22 @@ public:
 	void markDefective(const NetworkAddress& address);
 	void markWorking(const NetworkAddress& address);
 
+	// unregisters a successful read operation of the given size, marks the chunkserver
+	// as working and adds the latency of the operation to its histogram and averages
+	void readOperationFinished(const NetworkAddress& address, uint64_t latency_us,
+			uint32_t bytes);
+
+	std::vector<std::pair<NetworkAddress, LatencyHistogram>> readLatencies();
+
+	// returns an upper bound of the given percentile of latencies of reads from the chunkserver
+	// or 0 if there were fewer than minCount reads
+	uint64_t readLatencyPercentile(const NetworkAddress& address, double percentile,
+			uint64_t minCount);
+
 private:
 	std::mutex mutex_;
 	std::unordered_map<NetworkAddress, ChunkserverEntry> chunkserverEntries_;
+	std::unordered_map<NetworkAddress, LatencyHistogram> readLatencies_;
 };
 
 // global chunkserver statistics for this mount instance
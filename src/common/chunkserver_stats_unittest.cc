@@ -19,6 +19,9 @@
 #include "common/platform.h"
 #include "common/chunkserver_stats.h"
 
+#include <iostream>
+#include <utility>
+#include <vector>
 #include <gtest/gtest.h>
 
 TEST(ChunkserverStatsTests, ChunkserverStatsCounters) {
@@ -138,3 +141,122 @@ TEST(ChunkserverStatsTests, AllPendingDefectiveLonger) {
 	EXPECT_EQ(stats.getStatisticsFor(server1).score(), 1.);
 	EXPECT_LT(stats.getStatisticsFor(server2).score(), 1.);
 }
+
+TEST(ChunkserverStatsTests, ChunkserverStatsReadLatency) {
+	ChunkserverStats stats;
+	NetworkAddress server1(1111, 11);
+	stats.registerReadOperation(server1);
+	stats.registerReadOperation(server1);
+	stats.markDefective(server1);
+	stats.readOperationFinished(server1, 100, 65536);
+	EXPECT_EQ(1u, stats.getStatisticsFor(server1).pendingReads());
+	EXPECT_EQ(stats.getStatisticsFor(server1).score(), 1.);
+	stats.readOperationFinished(server1, 3000, 65536);
+
+	auto latencies = stats.readLatencies();
+	ASSERT_EQ(1u, latencies.size());
+	EXPECT_EQ(server1, latencies[0].first);
+	const LatencyHistogram &histogram = latencies[0].second;
+	EXPECT_EQ(2u, histogram.count());
+	EXPECT_EQ(3100u, histogram.sumUs());
+	EXPECT_EQ(1u, histogram.bucketCount(LatencyHistogram::bucket(100)));
+	EXPECT_EQ(128u, LatencyHistogram::bucketLimit(LatencyHistogram::bucket(100)));
+	EXPECT_EQ(4096u, LatencyHistogram::bucketLimit(LatencyHistogram::bucket(3000)));
+}
+
+TEST(ChunkserverStatsTests, ChunkserverStatsReadScore) {
+	ChunkserverStats stats;
+	NetworkAddress fast(1111, 11);
+	NetworkAddress slow(2222, 22);
+	NetworkAddress unknown(3333, 33);
+	for (int i = 0; i < 10; ++i) {
+		stats.registerReadOperation(fast);
+		stats.readOperationFinished(fast, 500, 65536);
+		stats.registerReadOperation(slow);
+		stats.readOperationFinished(slow, 20000, 65536);
+	}
+	EXPECT_FLOAT_EQ(500, stats.getStatisticsFor(fast).readLatencyEwma_us());
+	EXPECT_FLOAT_EQ(65536 * 2000, stats.getStatisticsFor(fast).readBandwidthEwma());
+	EXPECT_GT(stats.getStatisticsFor(fast).readScore(), stats.getStatisticsFor(unknown).readScore());
+	EXPECT_GT(stats.getStatisticsFor(unknown).readScore(), stats.getStatisticsFor(slow).readScore());
+
+	// The average follows changes of latency
+	stats.registerReadOperation(fast);
+	stats.readOperationFinished(fast, 1500, 65536);
+	EXPECT_FLOAT_EQ(700, stats.getStatisticsFor(fast).readLatencyEwma_us());
+
+	// Busy chunkservers are avoided
+	float idleScore = stats.getStatisticsFor(fast).readScore();
+	stats.registerReadOperation(fast);
+	EXPECT_LT(stats.getStatisticsFor(fast).readScore(), idleScore);
+
+	// Defects still matter
+	for (int i = 0; i < 10; ++i) {
+		stats.markDefective(unknown);
+	}
+	EXPECT_LT(stats.getStatisticsFor(unknown).readScore(), stats.getStatisticsFor(slow).readScore());
+}
+
+TEST(ChunkserverStatsTests, ChunkserverStatsReadLatencyPercentile) {
+	ChunkserverStats stats;
+	NetworkAddress server1(1111, 11);
+	for (int i = 0; i < 95; ++i) {
+		stats.registerReadOperation(server1);
+		stats.readOperationFinished(server1, 1000, 65536);
+	}
+	EXPECT_EQ(0u, stats.readLatencyPercentile(server1, 95, 100));
+	for (int i = 0; i < 5; ++i) {
+		stats.registerReadOperation(server1);
+		stats.readOperationFinished(server1, 100000, 65536);
+	}
+	EXPECT_EQ(1024u, stats.readLatencyPercentile(server1, 50, 100));
+	EXPECT_EQ(1024u, stats.readLatencyPercentile(server1, 95, 100));
+	EXPECT_EQ(131072u, stats.readLatencyPercentile(server1, 96, 100));
+	EXPECT_EQ(0u, stats.readLatencyPercentile(NetworkAddress(2222, 22), 50, 0));
+}
+
+// Simulates reading from three chunkservers of different speed by several concurrent readers.
+// Each chunkserver serves reads one by one, so a read waits for reads queued before it.
+TEST(ChunkserverStatsTests, ReadSourceSelectionSimulation) {
+	const std::vector<uint64_t> serviceTime_us = {500, 2000, 8000};
+	const int kReaders = 4;
+	const int kRounds = 2000;
+
+	auto simulate = [&](bool useScores) {
+		ChunkserverStats stats;
+		std::vector<NetworkAddress> servers;
+		for (unsigned i = 0; i < serviceTime_us.size(); ++i) {
+			servers.emplace_back(1000 + i, 9422);
+		}
+		uint64_t totalLatency_us = 0;
+		int roundRobin = 0;
+		for (int round = 0; round < kRounds; ++round) {
+			std::vector<int> queued(servers.size(), 0);
+			std::vector<std::pair<int, uint64_t>> reads;
+			for (int reader = 0; reader < kReaders; ++reader) {
+				int chosen = roundRobin++ % servers.size();
+				if (useScores) {
+					for (unsigned i = 0; i < servers.size(); ++i) {
+						if (stats.getStatisticsFor(servers[i]).readScore()
+								> stats.getStatisticsFor(servers[chosen]).readScore()) {
+							chosen = i;
+						}
+					}
+				}
+				stats.registerReadOperation(servers[chosen]);
+				reads.emplace_back(chosen, serviceTime_us[chosen] * ++queued[chosen]);
+			}
+			for (const auto& read : reads) {
+				stats.readOperationFinished(servers[read.first], read.second, 65536);
+				totalLatency_us += read.second;
+			}
+		}
+		return totalLatency_us / (kRounds * kReaders);
+	};
+
+	uint64_t random_us = simulate(false);
+	uint64_t scored_us = simulate(true);
+	std::cout << "average read latency: random choice " << random_us << "us"
+	          << ", based on scores " << scored_us << "us" << std::endl;
+	EXPECT_LT(scored_us * 2, random_us);
+}
@@ -96,3 +96,20 @@ SERIALIZABLE_CLASS_BODY(DiskInfo,
 	static const uint32_t kDamagedFlagMask = 0x2;
 	static const uint32_t kScanInProgressFlagMask = 0x4;
 SERIALIZABLE_CLASS_END;
+
+/*!
+ * Progress of background testing (scrubbing) of chunks stored on a disk.
+ * A pass tests all chunks of the disk in order of their ids.
+ */
+SERIALIZABLE_CLASS_BEGIN(DiskScrubInfo)
+SERIALIZABLE_CLASS_BODY(DiskScrubInfo,
+		std::string, path,
+		uint32_t, chunksInPass,       // number of chunks on the disk when the current pass began
+		uint32_t, chunksTestedInPass,
+		uint32_t, passStartTime,
+		uint32_t, completedPasses,    // since start of the chunkserver
+		uint32_t, lastPassEndTime,    // 0 if no pass has been completed yet
+		uint32_t, lastPassDuration,   // in seconds
+		uint64_t, bytesLastMinute,
+		uint32_t, slowdown)           // how many times testing is slowed down due to disk load
+SERIALIZABLE_CLASS_END;
@@ -0,0 +1,328 @@
+/*
+   Copyright 2017 Skytechnology sp. z o.o.
+
+   This file is part of LizardFS.
+
+   LizardFS is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, version 3.
+
+   LizardFS is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with LizardFS. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include "common/platform.h"
+
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+/*!
+ * \brief Open addressing hash table (linear probing), which grows without long pauses.
+ *
+ * Slots are stored directly in the table. Slot type has to be trivially copyable and
+ * both a default-constructed slot and a slot of zero bytes have to be the empty one.
+ * Hasher provides:
+ *   uint64_t operator()(const Slot &slot) const - hash of a stored slot,
+ *   static bool empty(const Slot &slot) - is the slot unused.
+ * The table doesn't know keys of slots - lookups get a hash and a predicate instead,
+ * so slots may refer to data kept elsewhere (e.g. ids of interned strings).
+ *
+ * When the table is 3/4 full, a table two times bigger is allocated and slots are moved
+ * to it a few at a time, with each insertion. Until all of them are moved, lookups check
+ * both tables. Erasing uses backward shifting instead of tombstones, so lookups of
+ * missing keys stay short even after many erasures. Tables are allocated with calloc,
+ * which maps big ones directly from the kernel, so pages of the new table are zeroed
+ * lazily, when slots are moved to them, instead of all at once when it is allocated.
+ *
+ * Pointers to slots are invalidated by insertions and erasures.
+ */
+template <typename Slot, typename Hasher>
+class IncrementalHashTable {
+	static_assert(std::is_trivially_copyable<Slot>::value, "slots are kept in memory allocated with calloc");
+
+public:
+	explicit IncrementalHashTable(Hasher hasher = Hasher())
+			: hasher_(std::move(hasher)),
+			  current_size_(0),
+			  old_size_(0),
+			  migration_start_(0),
+			  migrated_(0) {
+	}
+
+	/*! \brief Returns a slot with the hash for which pred(slot) is true, or nullptr. */
+	template <typename Predicate>
+	Slot *find(uint64_t hash, Predicate pred) {
+		if (!current_.empty()) {
+			uint64_t mask = current_.size() - 1;
+			for (uint64_t i = hash & mask; !Hasher::empty(current_[i]); i = (i + 1) & mask) {
+				if (pred(current_[i])) {
+					return &current_[i];
+				}
+			}
+		}
+		if (!old_.empty()) {
+			uint64_t mask = old_.size() - 1;
+			for (uint64_t i = oldProbeStart(hash); !Hasher::empty(old_[i]); i = (i + 1) & mask) {
+				if (pred(old_[i])) {
+					return &old_[i];
+				}
+			}
+		}
+		return nullptr;
+	}
+
+	template <typename Predicate>
+	const Slot *find(uint64_t hash, Predicate pred) const {
+		return const_cast<IncrementalHashTable *>(this)->find(hash, pred);
+	}
+
+	/*!
+	 * \brief Calls f(slot) for all slots which could have the hash.
+	 *
+	 * These are slots of the probing sequence of the hash, so they include all slots
+	 * with the hash and some other ones. Function must not modify the table.
+	 */
+	template <typename Function>
+	void forEachCandidate(uint64_t hash, Function f) {
+		if (!current_.empty()) {
+			uint64_t mask = current_.size() - 1;
+			for (uint64_t i = hash & mask; !Hasher::empty(current_[i]); i = (i + 1) & mask) {
+				f(current_[i]);
+			}
+		}
+		if (!old_.empty()) {
+			uint64_t mask = old_.size() - 1;
+			for (uint64_t i = oldProbeStart(hash); !Hasher::empty(old_[i]); i = (i + 1) & mask) {
+				f(old_[i]);
+			}
+		}
+	}
+
+	/*! \brief Inserts the slot, which mustn't be in the table yet. */
+	void insert(const Slot &slot) {
+		assert(!Hasher::empty(slot));
+		if (current_.empty() || 4 * (current_size_ + 1) > 3 * current_.size()) {
+			grow();
+		}
+		place(current_, slot);
+		current_size_++;
+		migrate(kMigrationStep);
+	}
+
+	/*! \brief Removes a slot, pointer has to be returned by find or forEachCandidate. */
+	void erase(Slot *slot) {
+		if (slot >= current_.data() && slot < current_.data() + current_.size()) {
+			shiftBackward(current_, slot - current_.data());
+			current_size_--;
+		} else {
+			assert(slot >= old_.data() && slot < old_.data() + old_.size());
+			shiftBackward(old_, slot - old_.data());
+			old_size_--;
+		}
+	}
+
+	/*! \brief Calls f(slot) for all slots in the table. */
+	template <typename Function>
+	void forEach(Function f) const {
+		for (const Slot &slot : old_) {
+			if (!Hasher::empty(slot)) {
+				f(slot);
+			}
+		}
+		for (const Slot &slot : current_) {
+			if (!Hasher::empty(slot)) {
+				f(slot);
+			}
+		}
+	}
+
+	void clear() {
+		Array().swap(current_);
+		Array().swap(old_);
+		current_size_ = 0;
+		old_size_ = 0;
+		migration_start_ = 0;
+		migrated_ = 0;
+	}
+
+	std::size_t size() const {
+		return current_size_ + old_size_;
+	}
+
+	bool empty() const {
+		return size() == 0;
+	}
+
+	/*! \brief Number of bytes allocated by the table. */
+	uint64_t memoryUsage() const {
+		return (current_.size() + old_.size()) * sizeof(Slot);
+	}
+
+	/*! \brief Is the table being moved to a bigger one. */
+	bool isGrowing() const {
+		return !old_.empty();
+	}
+
+	static constexpr uint64_t kMinCapacity = 16;
+	/*! Number of slots of the old table moved with each insertion. */
+	static constexpr uint64_t kMigrationStep = 8;
+
+private:
+	/* Zero-filled array of slots */
+	class Array {
+	public:
+		Array() : data_(nullptr), size_(0) {
+		}
+
+		explicit Array(uint64_t size)
+				: data_(static_cast<Slot *>(calloc(size, sizeof(Slot)))),
+				  size_(size) {
+			if (data_ == nullptr) {
+				throw std::bad_alloc();
+			}
+		}
+
+		~Array() {
+			free(data_);
+		}
+
+		Array(const Array &) = delete;
+		Array &operator=(const Array &) = delete;
+
+		void swap(Array &other) {
+			std::swap(data_, other.data_);
+			std::swap(size_, other.size_);
+		}
+
+		bool empty() const {
+			return size_ == 0;
+		}
+
+		uint64_t size() const {
+			return size_;
+		}
+
+		Slot *data() {
+			return data_;
+		}
+
+		Slot &operator[](uint64_t index) {
+			return data_[index];
+		}
+
+		const Slot *begin() const {
+			return data_;
+		}
+
+		const Slot *end() const {
+			return data_ + size_;
+		}
+
+	private:
+		Slot *data_;
+		uint64_t size_;
+	};
+
+	/*
+	 * Slots of the old table are moved in order, starting from an empty slot, so no
+	 * probing sequence continues from the moved part to the rest. If home position of
+	 * a hash is in the moved part, its remaining slots are just after the moved part.
+	 */
+	bool isMigrated(uint64_t index) const {
+		return ((index - migration_start_) & (old_.size() - 1)) < migrated_;
+	}
+
+	/* Slots from the beginning of a probing sequence could be already moved */
+	uint64_t oldProbeStart(uint64_t hash) const {
+		uint64_t home = hash & (old_.size() - 1);
+		return isMigrated(home) ? (migration_start_ + migrated_) & (old_.size() - 1) : home;
+	}
+
+	void grow() {
+		if (current_.empty()) {
+			Array(kMinCapacity).swap(current_);
+			return;
+		}
+		migrate(old_.size());
+		old_.swap(current_);
+		old_size_ = current_size_;
+		current_size_ = 0;
+		Array(2 * old_.size()).swap(current_);
+		migration_start_ = 0;
+		while (!Hasher::empty(old_[migration_start_])) {
+			migration_start_++;
+		}
+		migrated_ = 0;
+	}
+
+	void migrate(uint64_t count) {
+		while (!old_.empty() && count-- > 0) {
+			Slot &slot = old_[(migration_start_ + migrated_) & (old_.size() - 1)];
+			if (!Hasher::empty(slot)) {
+				place(current_, slot);
+				slot = Slot();
+				current_size_++;
+				old_size_--;
+			}
+			if (++migrated_ == old_.size()) {
+				Array().swap(old_);
+			}
+		}
+	}
+
+	void place(Array &table, const Slot &slot) {
+		uint64_t mask = table.size() - 1;
+		uint64_t i = hasher_(slot) & mask;
+		while (!Hasher::empty(table[i])) {
+			i = (i + 1) & mask;
+		}
+		table[i] = slot;
+	}
+
+	/*
+	 * Empties the slot and moves back the following slots of its cluster, which would
+	 * become unreachable otherwise. Slots of the old table with home position in its
+	 * moved part are always moved back, which keeps them reachable from the moved part.
+	 */
+	void shiftBackward(Array &table, uint64_t hole) {
+		uint64_t mask = table.size() - 1;
+		bool is_old = (&table == &old_);
+		for (uint64_t i = (hole + 1) & mask; !Hasher::empty(table[i]); i = (i + 1) & mask) {
+			uint64_t home = hasher_(table[i]) & mask;
+			bool stays = ((i - home) & mask) < ((i - hole) & mask);
+			if (is_old && isMigrated(home)) {
+				stays = false;
+			}
+			if (!stays) {
+				table[hole] = table[i];
+				hole = i;
+			}
+		}
+		table[hole] = Slot();
+	}
+
+	Hasher hasher_;
+	Array current_;
+	Array old_;
+	std::size_t current_size_;
+	std::size_t old_size_;
+	uint64_t migration_start_;
+	uint64_t migrated_;
+};
+
+template <typename Slot, typename Hasher>
+constexpr uint64_t IncrementalHashTable<Slot, Hasher>::kMinCapacity;
+template <typename Slot, typename Hasher>
+constexpr uint64_t IncrementalHashTable<Slot, Hasher>::kMigrationStep;
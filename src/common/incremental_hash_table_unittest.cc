@@ -0,0 +1,109 @@
+/*
+   Copyright 2017 Skytechnology sp. z o.o.
+
+   This file is part of LizardFS.
+
+   LizardFS is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, version 3.
+
+   LizardFS is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with LizardFS. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "common/platform.h"
+#include "common/incremental_hash_table.h"
+
+#include <random>
+#include <set>
+#include <gtest/gtest.h>
+
+namespace {
+
+// Bad hash function, so that there are long clusters in the table
+struct CollidingHasher {
+	uint64_t operator()(uint32_t value) const {
+		return value / 4;
+	}
+	static bool empty(uint32_t value) {
+		return value == 0;
+	}
+};
+
+typedef IncrementalHashTable<uint32_t, CollidingHasher> Table;
+
+} // anonymous namespace
+
+static uint32_t *find(Table &table, uint32_t value) {
+	return table.find(value / 4, [value](uint32_t slot) { return slot == value; });
+}
+
+TEST(IncrementalHashTableTests, InsertFindErase) {
+	Table table;
+	EXPECT_TRUE(table.empty());
+	EXPECT_EQ(nullptr, find(table, 1));
+
+	for (uint32_t value = 1; value <= 1000; ++value) {
+		table.insert(value);
+	}
+	EXPECT_EQ(1000U, table.size());
+	for (uint32_t value = 1; value <= 1000; ++value) {
+		ASSERT_NE(nullptr, find(table, value));
+		EXPECT_EQ(value, *find(table, value));
+	}
+	EXPECT_EQ(nullptr, find(table, 1001));
+
+	for (uint32_t value = 1; value <= 1000; value += 3) {
+		table.erase(find(table, value));
+	}
+	EXPECT_EQ(666U, table.size());
+	for (uint32_t value = 1; value <= 1000; ++value) {
+		EXPECT_EQ(value % 3 != 1, find(table, value) != nullptr);
+	}
+
+	std::set<uint32_t> candidates;
+	table.forEachCandidate(5, [&candidates](uint32_t value) { candidates.insert(value); });
+	EXPECT_EQ(1U, candidates.count(20));
+	EXPECT_EQ(1U, candidates.count(21));
+	EXPECT_EQ(0U, candidates.count(22));
+	EXPECT_EQ(1U, candidates.count(23));
+
+	uint32_t count = 0;
+	table.forEach([&count](uint32_t) { ++count; });
+	EXPECT_EQ(666U, count);
+
+	table.clear();
+	EXPECT_TRUE(table.empty());
+	EXPECT_EQ(0U, table.memoryUsage());
+}
+
+// Compares the table with std::set while it is growing, so that both tables are used
+TEST(IncrementalHashTableTests, RandomOperationsDuringGrowth) {
+	Table table;
+	std::set<uint32_t> reference;
+	std::mt19937 generator(1);
+	bool was_growing = false;
+	for (int i = 0; i < 50000; ++i) {
+		uint32_t value = 1 + generator() % 5000;
+		uint32_t *slot = find(table, value);
+		ASSERT_EQ(reference.count(value) > 0, slot != nullptr) << value;
+		if (slot && generator() % 3 == 0) {
+			table.erase(slot);
+			reference.erase(value);
+		} else if (!slot) {
+			table.insert(value);
+			reference.insert(value);
+		}
+		was_growing |= table.isGrowing();
+		ASSERT_EQ(reference.size(), table.size());
+	}
+	EXPECT_TRUE(was_growing);
+	for (uint32_t value = 1; value <= 5000; ++value) {
+		ASSERT_EQ(reference.count(value) > 0, find(table, value) != nullptr) << value;
+	}
+}
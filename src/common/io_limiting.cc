@@ -20,7 +20,11 @@
 #include "common/io_limiting.h"
 
 #include <algorithm>
+#include <functional>
 #include <thread>
+#ifdef LIZARDFS_HAVE_SCHED_GETCPU
+#  include <sched.h>
+#endif
 
 #include "common/io_limits_config_loader.h"
 #include "common/massert.h"
@@ -32,6 +36,28 @@ void Limiter::registerReconfigure(ReconfigurationFunction reconfigure) {
 	reconfigure_ = reconfigure;
 }
 
+uint32_t ioLimiting::cpuSlots() {
+	static const uint32_t kMaxCpuSlots = 256;
+	return std::min(std::max(std::thread::hardware_concurrency(), 1U), kMaxCpuSlots);
+}
+
+uint32_t ioLimiting::currentCpuSlot(uint32_t slots) {
+#ifdef LIZARDFS_HAVE_SCHED_GETCPU
+	int cpu = sched_getcpu();
+	if (cpu >= 0) {
+		return cpu % slots;
+	}
+#endif
+	// Threads have to be spread among slots some other way
+	static thread_local size_t threadHash =
+			std::hash<std::thread::id>()(std::this_thread::get_id());
+	return threadHash % slots;
+}
+
+static int64_t toNanoseconds(SteadyTimePoint time) {
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(time.time_since_epoch()).count();
+}
+
 SteadyTimePoint RTClock::now() {
 	return SteadyClock::now();
 }
@@ -40,7 +66,66 @@ void RTClock::sleepUntil(SteadyTimePoint time) {
 	return std::this_thread::sleep_until(time);
 }
 
+Group::Group(const SharedState& shared, const std::string& groupId, Clock& clock,
+		uint32_t slots)
+		: shared_(shared),
+		  groupId_(groupId),
+		  reserve_(0),
+		  lastRequestSuccessful_(true),
+		  dead_(false),
+		  clock_(clock),
+		  cpuSlots_(std::max(slots, 1U)),
+		  buckets_(new LocalBucket[cpuSlots_]),
+		  localTokensExpiration_(0),
+		  waiting_(0) {
+}
+
+bool Group::tryTake(uint64_t size) {
+	if (waiting_.load(std::memory_order_acquire) > 0 || dead_) {
+		return false;
+	}
+	LocalBucket& bucket = buckets_[currentCpuSlot(cpuSlots_)];
+	uint64_t tokens = bucket.tokens.load(std::memory_order_relaxed);
+	do {
+		if (tokens < size) {
+			return false;
+		}
+	} while (!bucket.tokens.compare_exchange_weak(tokens, tokens - size,
+			std::memory_order_acquire));
+	// Expiration is checked after taking, as tokens are put into buckets after it is updated
+	if (toNanoseconds(clock_.now()) > localTokensExpiration_.load(std::memory_order_acquire)) {
+		bucket.tokens.fetch_add(size, std::memory_order_relaxed);
+		return false;
+	}
+	bucket.taken.fetch_add(size, std::memory_order_relaxed);
+	return true;
+}
+
+void Group::collectLocalTokens() {
+	for (uint32_t i = 0; i < cpuSlots_; ++i) {
+		reserve_ += buckets_[i].tokens.exchange(0, std::memory_order_acquire);
+	}
+}
+
+void Group::distributeReserve() {
+	if (reserve_ == 0) {
+		return;
+	}
+	localTokensExpiration_.store(toNanoseconds(lastRequestEndTime_ + shared_.delta),
+			std::memory_order_release);
+	uint64_t share = reserve_ / cpuSlots_;
+	uint32_t current = currentCpuSlot(cpuSlots_);
+	for (uint32_t i = 0; i < cpuSlots_; ++i) {
+		uint64_t tokens = (i == current) ? reserve_ - share * (cpuSlots_ - 1) : share;
+		if (tokens > 0) {
+			buckets_[i].tokens.fetch_add(tokens, std::memory_order_release);
+		}
+	}
+	reserve_ = 0;
+}
+
 bool Group::attempt(uint64_t size) {
+	collectLocalTokens();
 	if (lastRequestEndTime_ + shared_.delta < clock_.now()) {
 		reserve_ = 0;
 	}
@@ -77,6 +162,14 @@ void Group::askMaster(std::unique_lock<std::mutex>& lock) {
 			&& ((pastRequests_.front().creationTime + shared_.delta) < clock_.now())) {
 		pastRequests_.pop_front();
 	}
+	// Bytes taken from buckets are accounted as requests which have just finished
+	uint64_t takenLocally = 0;
+	for (uint32_t i = 0; i < cpuSlots_; ++i) {
+		takenLocally += buckets_[i].taken.exchange(0, std::memory_order_relaxed);
+	}
+	if (takenLocally > 0) {
+		pastRequests_.emplace_back(clock_.now(), takenLocally);
+	}
 	uint64_t size = 0;
 	for (const auto& request : pendingRequests_) {
 		size += request.size;
@@ -96,6 +189,7 @@ void Group::askMaster(std::unique_lock<std::mutex>& lock) {
 }
 
 uint8_t Group::wait(uint64_t size, SteadyTimePoint deadline, std::unique_lock<std::mutex>& lock) {
+	waiting_++;
 	PendingRequests::iterator it = enqueue(size);
 	it->cond.wait(lock, [this, it]() {return isFirst(it);});
 	uint8_t status = LIZARDFS_ERROR_TIMEOUT;
@@ -123,7 +217,11 @@ uint8_t Group::wait(uint64_t size, SteadyTimePoint deadline, std::unique_lock<st
 		askMaster(lock);
 	}
 	dequeue(it);
+	if (pendingRequests_.empty() && !dead_) {
+		distributeReserve();
+	}
 	notifyQueue();
+	waiting_--;
 	return status;
 }
 
@@ -20,6 +20,7 @@
 
 #include "common/platform.h"
 
+#include <atomic>
 #include <condition_variable>
 #include <functional>
 #include <list>
@@ -59,6 +60,12 @@ protected:
 	ReconfigurationFunction reconfigure_;
 };
 
+// Number of slots for per-CPU data, i.e. the number of CPUs (capped)
+uint32_t cpuSlots();
+
+// Slot of the CPU the calling thread runs on, lower than 'slots'
+uint32_t currentCpuSlot(uint32_t slots);
+
 // Abstract clock used by the limiting mechanism, introduced mostly for testing purposed.
 // Should be monotonic.
 struct Clock {
@@ -87,13 +94,24 @@ struct SharedState {
 	std::chrono::microseconds delta;
 };
 
-// Single IO limiting group, allowing users to wait for a resource assignment
+/**
+ * Single IO limiting group, allowing users to wait for a resource assignment.
+ *
+ * Bandwidth obtained from the limiter is kept in 'reserve_', which is protected by the lock
+ * passed to 'wait' and handed out to waiting users in FIFO order. When nobody is waiting,
+ * what is left is split among per-CPU token buckets, from which 'tryTake' takes without any
+ * lock. Users which don't find enough tokens in the bucket of their CPU call 'wait', which
+ * first collects tokens left in all buckets and only then asks the limiter for more.
+ */
 class Group {
 public:
-	Group(const SharedState& shared, const std::string& groupId, Clock& clock) : shared_(shared),
-		groupId_(groupId), reserve_(0), lastRequestSuccessful_(true), dead_(false), clock_(clock) {}
+	Group(const SharedState& shared, const std::string& groupId, Clock& clock,
+			uint32_t slots = cpuSlots());
 	virtual ~Group() {}
 
+	// take size bytes from the bucket of the current CPU if there are enough tokens in it
+	// and nobody waits, never blocks
+	bool tryTake(uint64_t size);
 	// wait until we are allowed to transfer size bytes, return MFS status
 	uint8_t wait(uint64_t size, const SteadyTimePoint deadline, std::unique_lock<std::mutex>& lock);
 	// notify all waitees that the group has been removed
@@ -112,6 +130,14 @@ private:
 		std::condition_variable cond;
 		uint64_t size;
 	};
+	// Tokens of a single CPU and the number of bytes taken from them since the last request
+	// sent to the limiter. Padded to a cache line, so that CPUs don't share them.
+	struct LocalBucket {
+		LocalBucket() : tokens(0), taken(0) {}
+		std::atomic<uint64_t> tokens;
+		std::atomic<uint64_t> taken;
+		char padding[64 - 2 * sizeof(std::atomic<uint64_t>)];
+	};
 	typedef std::list<PastRequest> PastRequests;
 	typedef std::list<PendingRequest> PendingRequests;
 
@@ -121,6 +147,10 @@ private:
 	bool attempt(uint64_t size);
 	void askMaster(std::unique_lock<std::mutex>& lock);
 	void notifyQueue();
+	// move tokens from all buckets back to 'reserve_'
+	void collectLocalTokens();
+	// split 'reserve_' among buckets, the current CPU gets the remainder
+	void distributeReserve();
 
 	const SharedState& shared_;
 	const std::string groupId_;
@@ -137,8 +167,15 @@ private:
 	// fact that some decisions are made on a basis of its value before the communication starts.
 	SteadyTimePoint lastRequestEndTime_;
 	bool lastRequestSuccessful_;
-	bool dead_;
+	std::atomic<bool> dead_;
 	Clock& clock_;
+	const uint32_t cpuSlots_;
+	std::unique_ptr<LocalBucket[]> buckets_;
+	// Tokens in buckets can't be used after this time (as 'reserve_' after
+	// lastRequestEndTime_ + delta), kept as nanoseconds since the epoch of SteadyClock
+	std::atomic<int64_t> localTokensExpiration_;
+	// Number of users in 'wait', who are served before users of 'tryTake'
+	std::atomic<uint32_t> waiting_;
 };
 
 } // namespace ioLimiting
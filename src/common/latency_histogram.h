@@ -0,0 +1,78 @@
+/*
+   Copyright 2017 Skytechnology sp. z o.o.
+
+   This file is part of LizardFS.
+
+   LizardFS is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, version 3.
+
+   LizardFS is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with LizardFS. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "common/platform.h"
+
+#include <array>
+#include <cstdint>
+#include <limits>
+
+/*!
+ * \brief Histogram of latencies with buckets growing by powers of two.
+ *
+ * Bucket k (for k > 0) counts latencies in range [2^(k-1), 2^k) microseconds, bucket 0 counts
+ * latencies below 1us and the last bucket counts everything which doesn't fit in the previous
+ * ones. Not thread safe.
+ */
+class LatencyHistogram {
+public:
+	static constexpr int kBuckets = 26; // the last limited bucket ends at ~16s
+
+	LatencyHistogram() : count_(0), sum_us_(0), buckets_() {
+	}
+
+	/*! \brief Index of the bucket for the given latency. */
+	static int bucket(uint64_t latency_us) {
+		int k = 0;
+		while (latency_us > 0 && k < kBuckets - 1) {
+			latency_us >>= 1;
+			k++;
+		}
+		return k;
+	}
+
+	/*! \brief Upper (exclusive) limit of the bucket, max value for the last one. */
+	static uint64_t bucketLimit(int k) {
+		return k < kBuckets - 1 ? (uint64_t)1 << k : std::numeric_limits<uint64_t>::max();
+	}
+
+	void add(uint64_t latency_us) {
+		count_++;
+		sum_us_ += latency_us;
+		buckets_[bucket(latency_us)]++;
+	}
+
+	uint64_t count() const {
+		return count_;
+	}
+
+	uint64_t sumUs() const {
+		return sum_us_;
+	}
+
+	uint64_t bucketCount(int k) const {
+		return buckets_[k];
+	}
+
+private:
+	uint64_t count_;
+	uint64_t sum_us_;
+	std::array<uint64_t, kBuckets> buckets_;
+};
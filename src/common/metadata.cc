@@ -32,6 +32,7 @@
 
 #include "common/cwrap.h"
 #include "common/datapack.h"
+#include "common/metadata_compression.h"
 #include "common/mfserr.h"
 #include "common/slogger.h"
 
@@ -63,6 +64,45 @@ const char kSessionsTmpFilename[] = SESSIONS_FILENAME ".tmp";
 
 std::unique_ptr<Lockfile> gMetadataLockfile;
 
+// Versions of compressed files are read from their decompressed headers,
+// truncated files are recognized by the end marker, which is not compressed.
+static uint64_t compressedMetadataGetVersion(const std::string& file) {
+#ifdef LIZARDFS_HAVE_METADATA_COMPRESSION
+	cstream_t fd(fopen(file.c_str(), "r"));
+	if (fd == nullptr) {
+		throw MetadataCheckException("Can't open the metadata file");
+	}
+	char eofmark[16];
+	if (fseeko(fd.get(), -16, SEEK_END) != 0 || fread(eofmark, 1, 16, fd.get()) != 16) {
+		throw MetadataCheckException("Can't read the metadata file");
+	}
+	if (memcmp(eofmark, "[MFS EOF MARKER]", 16) != 0) {
+		throw MetadataCheckException("The metadata file is truncated");
+	}
+	char chkbuff[20];
+	if (fseeko(fd.get(), 8, SEEK_SET) != 0) {
+		throw MetadataCheckException("Can't read the metadata file");
+	}
+	FILE *decompressed = metadataOpenDecompressingStream(fd.get());
+	if (decompressed == nullptr) {
+		throw MetadataCheckException("Can't decompress the metadata file");
+	}
+	fd.release();
+	fd.reset(decompressed);
+	if (fread(chkbuff, 1, 20, fd.get()) != 20) {
+		throw MetadataCheckException("Can't read the metadata file");
+	}
+	if (memcmp(chkbuff, LIZARDFSSIGNATURE "M 2.9", 8) != 0) {
+		throw MetadataCheckException("Bad format of the metadata file");
+	}
+	const uint8_t* ptr = reinterpret_cast<const uint8_t*>(chkbuff + 8 + 4);
+	return get64bit(&ptr);
+#else
+	(void)file;
+	throw MetadataCheckException("Compressed metadata is not supported in this build");
+#endif
+}
+
 uint64_t metadataGetVersion(const std::string& file) {
 	int fd;
 	char chkbuff[20];
@@ -83,6 +123,10 @@ uint64_t metadataGetVersion(const std::string& file) {
 		close(fd);
 		return 0;
 	}
+	if (metadataIsCompressed(reinterpret_cast<const uint8_t*>(chkbuff))) {
+		close(fd);
+		return compressedMetadataGetVersion(file);
+	}
 	if (bytes != 20) {
 		close(fd);
 		throw MetadataCheckException("Can't read the metadata file");
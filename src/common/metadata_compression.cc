@@ -0,0 +1,273 @@
+/*
+   Copyright 2017 Skytechnology sp. z o.o.
+
+   This file is part of LizardFS.
+
+   LizardFS is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, version 3.
+
+   LizardFS is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with LizardFS. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "common/platform.h"
+#include "common/metadata_compression.h"
+
+#include <errno.h>
+#include <string.h>
+#include <algorithm>
+#include <new>
+
+#include "common/datapack.h"
+#include "common/massert.h"
+
+#ifdef LIZARDFS_HAVE_METADATA_COMPRESSION
+#  include <zlib.h>
+#endif
+
+const char kCompressedMetadataSignature[] = "LIZZ 1.0";
+
+static const uint32_t kBlockHeaderSize = 12;
+static const char kEofMarker[] = "[MFS EOF MARKER]";
+
+bool metadataIsCompressed(const uint8_t *header) {
+	return memcmp(header, kCompressedMetadataSignature, 8) == 0;
+}
+
+#ifdef LIZARDFS_HAVE_METADATA_COMPRESSION
+
+constexpr uint32_t CompressedMetadataPart::kBlockSize;
+
+static ssize_t compressed_part_write(void *cookie, const char *buf, size_t size) {
+	static_cast<CompressedMetadataPart *>(cookie)->append(
+			reinterpret_cast<const uint8_t *>(buf), size);
+	return size;
+}
+
+CompressedMetadataPart::CompressedMetadataPart(FILE *sink, int level)
+		: sink_(sink),
+		  level_(level),
+		  stream_(nullptr),
+		  raw_size_(0) {
+	buffer_.reserve(kBlockSize);
+}
+
+CompressedMetadataPart::~CompressedMetadataPart() {
+	if (stream_) {
+		fclose(stream_);
+	}
+}
+
+FILE *CompressedMetadataPart::stream() {
+	if (!stream_) {
+		cookie_io_functions_t functions = {nullptr, compressed_part_write, nullptr, nullptr};
+		stream_ = fopencookie(this, "w", functions);
+		if (!stream_) {
+			throw std::bad_alloc();
+		}
+	}
+	return stream_;
+}
+
+void CompressedMetadataPart::append(const uint8_t *data, uint64_t size) {
+	while (size > 0) {
+		uint64_t length = std::min<uint64_t>(size, kBlockSize - buffer_.size());
+		buffer_.insert(buffer_.end(), data, data + length);
+		raw_size_ += length;
+		data += length;
+		size -= length;
+		if (buffer_.size() == kBlockSize) {
+			compressBlock();
+		}
+	}
+}
+
+void CompressedMetadataPart::finish() {
+	if (stream_) {
+		fclose(stream_);
+		stream_ = nullptr;
+	}
+	compressBlock();
+}
+
+// Compresses data into 'block' (header included), returns false in case of an error
+static bool compress_block(const uint8_t *data, uint32_t size, int level,
+		std::vector<uint8_t> &block) {
+	uLongf compressed_size = compressBound(size);
+	block.resize(kBlockHeaderSize + compressed_size);
+	if (compress2(block.data() + kBlockHeaderSize, &compressed_size, data, size, level) != Z_OK) {
+		return false;
+	}
+	block.resize(kBlockHeaderSize + compressed_size);
+
+	uint8_t *ptr = block.data();
+	put32bit(&ptr, compressed_size);
+	put32bit(&ptr, size);
+	put32bit(&ptr, crc32(0, data, size));
+	return true;
+}
+
+void CompressedMetadataPart::compressBlock() {
+	if (buffer_.empty()) {
+		return;
+	}
+	massert(compress_block(buffer_.data(), buffer_.size(), level_, compressed_),
+			"metadata compression failed");
+	fwrite(compressed_.data(), 1, compressed_.size(), sink_);
+	buffer_.clear();
+}
+
+bool metadataWriteCompressedHeader(FILE *fd) {
+	return fwrite(kCompressedMetadataSignature, 1, 8, fd) == 8;
+}
+
+bool metadataWriteStoredBlock(FILE *fd, const uint8_t *data, uint32_t size) {
+	std::vector<uint8_t> block;
+	return compress_block(data, size, Z_NO_COMPRESSION, block) &&
+			fwrite(block.data(), 1, block.size(), fd) == block.size();
+}
+
+bool metadataWriteCompressedEnd(FILE *fd) {
+	uint8_t end[kBlockHeaderSize] = {0};
+	return fwrite(end, 1, kBlockHeaderSize, fd) == kBlockHeaderSize
+			&& fwrite(kEofMarker, 1, 16, fd) == 16;
+}
+
+namespace {
+
+/*
+ * State of a decompressing stream. Some data from before the current position is kept
+ * in the window, because stdio seeks backwards to align its buffer.
+ */
+struct DecompressingStream {
+	static const uint32_t kHistorySize = 64 * 1024;
+
+	FILE *fd;
+	std::vector<uint8_t> window;
+	std::vector<uint8_t> compressed;
+	uint64_t window_offset;
+	uint64_t position;
+	bool finished;
+
+	explicit DecompressingStream(FILE *fd)
+			: fd(fd), window_offset(0), position(0), finished(false) {
+	}
+
+	// Decompresses the next block to the window, returns false in case of an error
+	bool loadBlock() {
+		uint8_t header[kBlockHeaderSize];
+		if (fread(header, 1, kBlockHeaderSize, fd) != kBlockHeaderSize) {
+			return false;
+		}
+		const uint8_t *ptr = header;
+		uint32_t compressed_size = get32bit(&ptr);
+		uint32_t size = get32bit(&ptr);
+		uint32_t crc = get32bit(&ptr);
+		if (compressed_size == 0) {
+			finished = true;
+			return true;
+		}
+		if (size > CompressedMetadataPart::kBlockSize ||
+				compressed_size > compressBound(CompressedMetadataPart::kBlockSize)) {
+			return false;
+		}
+		compressed.resize(compressed_size);
+		if (fread(compressed.data(), 1, compressed_size, fd) != compressed_size) {
+			return false;
+		}
+
+		if (window.size() > kHistorySize) {
+			uint64_t dropped = window.size() - kHistorySize;
+			window.erase(window.begin(), window.begin() + dropped);
+			window_offset += dropped;
+		}
+		size_t offset = window.size();
+		window.resize(offset + size);
+		uLongf decompressed_size = size;
+		if (uncompress(window.data() + offset, &decompressed_size, compressed.data(),
+				compressed_size) != Z_OK || decompressed_size != size ||
+				crc32(0, window.data() + offset, size) != crc) {
+			window.resize(offset);
+			return false;
+		}
+		return true;
+	}
+
+	uint64_t end() const {
+		return window_offset + window.size();
+	}
+};
+
+} // anonymous namespace
+
+static ssize_t decompressing_read(void *cookie, char *buf, size_t size) {
+	DecompressingStream &stream = *static_cast<DecompressingStream *>(cookie);
+	size_t copied = 0;
+	while (copied < size) {
+		if (stream.position < stream.end()) {
+			size_t length = std::min<uint64_t>(size - copied, stream.end() - stream.position);
+			memcpy(buf + copied, stream.window.data() + (stream.position - stream.window_offset),
+					length);
+			stream.position += length;
+			copied += length;
+		} else if (stream.finished) {
+			break;
+		} else if (!stream.loadBlock()) {
+			errno = EIO;
+			return -1;
+		}
+	}
+	return copied;
+}
+
+static int decompressing_seek(void *cookie, off64_t *offset, int whence) {
+	DecompressingStream &stream = *static_cast<DecompressingStream *>(cookie);
+	int64_t target;
+	if (whence == SEEK_SET) {
+		target = *offset;
+	} else if (whence == SEEK_CUR) {
+		target = stream.position + *offset;
+	} else {
+		errno = EINVAL;
+		return -1;
+	}
+	if (target < 0 || (uint64_t)target < stream.window_offset) {
+		errno = EINVAL;
+		return -1;
+	}
+	while ((uint64_t)target > stream.end() && !stream.finished) {
+		if (!stream.loadBlock()) {
+			errno = EIO;
+			return -1;
+		}
+	}
+	stream.position = target;
+	*offset = target;
+	return 0;
+}
+
+static int decompressing_close(void *cookie) {
+	DecompressingStream *stream = static_cast<DecompressingStream *>(cookie);
+	int status = fclose(stream->fd);
+	delete stream;
+	return status;
+}
+
+FILE *metadataOpenDecompressingStream(FILE *fd) {
+	DecompressingStream *stream = new DecompressingStream(fd);
+	cookie_io_functions_t functions = {decompressing_read, nullptr, decompressing_seek,
+			decompressing_close};
+	FILE *result = fopencookie(stream, "r", functions);
+	if (!result) {
+		delete stream;
+	}
+	return result;
+}
+
+#endif // LIZARDFS_HAVE_METADATA_COMPRESSION
@@ -0,0 +1,111 @@
+/*
+   Copyright 2017 Skytechnology sp. z o.o.
+
+   This file is part of LizardFS.
+
+   LizardFS is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, version 3.
+
+   LizardFS is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with LizardFS. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "common/platform.h"
+
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+
+#if defined(LIZARDFS_HAVE_ZLIB_H) && defined(LIZARDFS_HAVE_FOPENCOOKIE)
+#  define LIZARDFS_HAVE_METADATA_COMPRESSION 1
+#endif
+
+/*
+ * Compressed metadata file is a container for a regular metadata file. It begins with
+ * kCompressedMetadataSignature, followed by blocks of the regular file:
+ *   32bit:compressed_size 32bit:size 32bit:crc compressed_size*8bit:zlib_data
+ * and ends with a block of zeros and "[MFS EOF MARKER]", so that truncated files can be
+ * recognized without decompressing them. Each block is compressed separately, so parts of
+ * the file can be compressed in parallel and just concatenated.
+ */
+extern const char kCompressedMetadataSignature[];
+
+/// Checks if the first 8 bytes of a file are the signature of a compressed metadata file.
+bool metadataIsCompressed(const uint8_t *header);
+
+#ifdef LIZARDFS_HAVE_METADATA_COMPRESSION
+
+/**
+ * A part of the compressed metadata file.
+ * Data written to stream() (or append()) is cut into blocks, which are compressed and written
+ * to the sink as soon as they are filled, so at most one block is kept in memory.
+ * Errors of writing are reported by ferror(sink).
+ */
+class CompressedMetadataPart {
+public:
+	static constexpr uint32_t kBlockSize = 1 << 20;
+
+	/// \param sink file to which compressed blocks are written
+	/// \param level zlib compression level (1..9)
+	CompressedMetadataPart(FILE *sink, int level);
+	~CompressedMetadataPart();
+
+	CompressedMetadataPart(const CompressedMetadataPart &) = delete;
+	CompressedMetadataPart &operator=(const CompressedMetadataPart &) = delete;
+
+	/// Stream writing to this part, valid until finish() is called.
+	FILE *stream();
+
+	void append(const uint8_t *data, uint64_t size);
+
+	/// Flushes the stream and compresses the remaining data.
+	void finish();
+
+	/// Size of the data before compression.
+	uint64_t rawSize() const {
+		return raw_size_;
+	}
+
+private:
+	void compressBlock();
+
+	FILE *sink_;
+	int level_;
+	FILE *stream_;
+	uint64_t raw_size_;
+	std::vector<uint8_t> buffer_;
+	std::vector<uint8_t> compressed_;
+};
+
+/// Writes the signature of a compressed metadata file.
+bool metadataWriteCompressedHeader(FILE *fd);
+
+/**
+ * Writes a block with data which isn't compressed.
+ * Size of the block depends only on the size of the data, so the block can be overwritten
+ * later, e.g. when sizes which it contains are known.
+ */
+bool metadataWriteStoredBlock(FILE *fd, const uint8_t *data, uint32_t size);
+
+/// Writes the end of a compressed metadata file.
+bool metadataWriteCompressedEnd(FILE *fd);
+
+/**
+ * Opens a stream reading the regular metadata file from a compressed one.
+ * \param fd file positioned just after the signature, closed together with the returned stream
+ * \return the stream or nullptr (then fd isn't closed)
+ *
+ * Blocks are decompressed and verified when they are needed. The stream supports ftello and
+ * seeking forward, errors (including wrong checksums) are reported by ferror.
+ */
+FILE *metadataOpenDecompressingStream(FILE *fd);
+
+#endif
@@ -0,0 +1,252 @@
+/*
+   Copyright 2017 Skytechnology sp. z o.o.
+
+   This file is part of LizardFS.
+
+   LizardFS is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, version 3.
+
+   LizardFS is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with LizardFS. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "common/platform.h"
+#include "common/metadata_compression.h"
+
+#include <unistd.h>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+#include <gtest/gtest.h>
+
+#include "common/datapack.h"
+
+#ifdef LIZARDFS_HAVE_METADATA_COMPRESSION
+
+// Something resembling stored nodes and edges: ids, timestamps and names
+static std::vector<uint8_t> generate_metadata(std::size_t size, uint32_t seed) {
+	std::mt19937 generator(seed);
+	std::vector<uint8_t> data;
+	data.reserve(size + 64);
+	uint32_t id = 1;
+	while (data.size() < size) {
+		uint8_t record[24];
+		uint8_t *ptr = record;
+		put32bit(&ptr, id++);
+		put32bit(&ptr, generator() % 16);
+		put32bit(&ptr, 1500000000 + generator() % 1000);
+		put32bit(&ptr, 1000);
+		put64bit(&ptr, generator() % (1 << 20));
+		data.insert(data.end(), record, record + sizeof(record));
+		std::string name = "file_" + std::to_string(generator() % 100000) + ".dat";
+		data.insert(data.end(), name.begin(), name.end());
+	}
+	data.resize(size);
+	return data;
+}
+
+static std::string compress_to_file(const std::vector<std::vector<uint8_t>> &parts, int level) {
+	std::string path = "/tmp/metadata_compression_test." + std::to_string(getpid());
+	FILE *fd = fopen(path.c_str(), "w");
+	EXPECT_NE(nullptr, fd);
+	EXPECT_TRUE(metadataWriteCompressedHeader(fd));
+	for (const auto &data : parts) {
+		CompressedMetadataPart part(fd, level);
+		EXPECT_EQ(data.size(), fwrite(data.data(), 1, data.size(), part.stream()));
+		part.finish();
+		EXPECT_EQ(data.size(), part.rawSize());
+	}
+	EXPECT_TRUE(metadataWriteCompressedEnd(fd));
+	EXPECT_EQ(0, ferror(fd));
+	fclose(fd);
+	return path;
+}
+
+static FILE *open_decompressed(const std::string &path) {
+	FILE *fd = fopen(path.c_str(), "r");
+	uint8_t header[8];
+	EXPECT_EQ(8U, fread(header, 1, 8, fd));
+	EXPECT_TRUE(metadataIsCompressed(header));
+	return metadataOpenDecompressingStream(fd);
+}
+
+TEST(MetadataCompressionTests, PartsAreConcatenated) {
+	std::vector<std::vector<uint8_t>> parts{
+			generate_metadata(3 * CompressedMetadataPart::kBlockSize + 100, 1),
+			generate_metadata(16, 2),
+			{},
+			generate_metadata(CompressedMetadataPart::kBlockSize, 3)};
+	std::string path = compress_to_file(parts, 1);
+
+	FILE *fd = open_decompressed(path);
+	ASSERT_NE(nullptr, fd);
+	for (const auto &data : parts) {
+		std::vector<uint8_t> read(data.size());
+		EXPECT_EQ(data.size(), fread(read.data(), 1, read.size(), fd));
+		EXPECT_EQ(data, read);
+	}
+	EXPECT_EQ(EOF, fgetc(fd));
+	EXPECT_NE(0, feof(fd));
+	EXPECT_EQ(0, ferror(fd));
+	fclose(fd);
+	unlink(path.c_str());
+}
+
+TEST(MetadataCompressionTests, StoredBlocksCanBeOverwritten) {
+	std::string path = "/tmp/metadata_compression_test." + std::to_string(getpid());
+	FILE *fd = fopen(path.c_str(), "w");
+	ASSERT_NE(nullptr, fd);
+	std::vector<uint8_t> data = generate_metadata(CompressedMetadataPart::kBlockSize + 1, 7);
+	uint8_t header[16] = {0};
+	EXPECT_TRUE(metadataWriteCompressedHeader(fd));
+	off_t offset = ftello(fd);
+	EXPECT_TRUE(metadataWriteStoredBlock(fd, header, 16));
+	{
+		CompressedMetadataPart part(fd, 1);
+		part.append(data.data(), data.size());
+		part.finish();
+	}
+	off_t end = ftello(fd);
+	memcpy(header, data.data(), 16);
+	ASSERT_EQ(0, fseeko(fd, offset, SEEK_SET));
+	EXPECT_TRUE(metadataWriteStoredBlock(fd, header, 16));
+	ASSERT_EQ(0, fseeko(fd, end, SEEK_SET));
+	EXPECT_TRUE(metadataWriteCompressedEnd(fd));
+	fclose(fd);
+
+	fd = open_decompressed(path);
+	ASSERT_NE(nullptr, fd);
+	std::vector<uint8_t> read(16 + data.size());
+	EXPECT_EQ(read.size(), fread(read.data(), 1, read.size(), fd));
+	EXPECT_EQ(0, memcmp(read.data(), header, 16));
+	EXPECT_TRUE(std::equal(data.begin(), data.end(), read.begin() + 16));
+	EXPECT_EQ(EOF, fgetc(fd));
+	EXPECT_EQ(0, ferror(fd));
+	fclose(fd);
+	unlink(path.c_str());
+}
+
+TEST(MetadataCompressionTests, SeekingForward) {
+	std::vector<uint8_t> data = generate_metadata(5 * CompressedMetadataPart::kBlockSize, 4);
+	std::string path = compress_to_file({data}, 6);
+
+	FILE *fd = open_decompressed(path);
+	ASSERT_NE(nullptr, fd);
+	std::mt19937 generator(5);
+	off_t position = 0;
+	while (position + 1000 < (off_t)data.size()) {
+		uint8_t buffer[100];
+		EXPECT_EQ(position, ftello(fd));
+		ASSERT_EQ(100U, fread(buffer, 1, 100, fd));
+		EXPECT_EQ(0, memcmp(buffer, data.data() + position, 100));
+		off_t skip = generator() % 300000;
+		ASSERT_EQ(0, fseeko(fd, skip, SEEK_CUR));
+		position += 100 + skip;
+	}
+	fclose(fd);
+	unlink(path.c_str());
+}
+
+TEST(MetadataCompressionTests, CorruptedDataIsDetected) {
+	std::vector<uint8_t> data = generate_metadata(2 * CompressedMetadataPart::kBlockSize, 6);
+	std::string path = compress_to_file({data}, 1);
+	FILE *raw = fopen(path.c_str(), "r+");
+	fseeko(raw, 1000, SEEK_SET);
+	int c = fgetc(raw);
+	fseeko(raw, 1000, SEEK_SET);
+	fputc(c ^ 0x10, raw);
+	fclose(raw);
+
+	FILE *fd = open_decompressed(path);
+	ASSERT_NE(nullptr, fd);
+	std::vector<uint8_t> read(data.size());
+	EXPECT_GT(data.size(), fread(read.data(), 1, read.size(), fd));
+	EXPECT_NE(0, ferror(fd));
+	fclose(fd);
+	unlink(path.c_str());
+}
+
+// Measures how fast metadata is dumped, with and without compression in many threads
+TEST(MetadataCompressionTests, DumpSpeedAndSize) {
+	const int kParts = 8;
+	std::vector<std::vector<uint8_t>> parts;
+	for (int i = 0; i < kParts; ++i) {
+		parts.push_back(generate_metadata(8 * CompressedMetadataPart::kBlockSize, 10 + i));
+	}
+	uint64_t raw_size = kParts * 8 * CompressedMetadataPart::kBlockSize;
+
+	auto start = std::chrono::steady_clock::now();
+	std::string path = "/tmp/metadata_compression_test." + std::to_string(getpid());
+	FILE *fd = fopen(path.c_str(), "w");
+	for (const auto &data : parts) {
+		fwrite(data.data(), 1, data.size(), fd);
+	}
+	fclose(fd);
+	auto plain_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+			std::chrono::steady_clock::now() - start).count();
+
+	// Parts are compressed to temporary files, which are concatenated, as metadata dumps do
+	start = std::chrono::steady_clock::now();
+	std::vector<FILE *> compressed;
+	std::vector<std::thread> threads;
+	for (const auto &data : parts) {
+		compressed.push_back(tmpfile());
+		FILE *tmp = compressed.back();
+		threads.emplace_back([tmp, &data]() {
+			CompressedMetadataPart part(tmp, 1);
+			fwrite(data.data(), 1, data.size(), part.stream());
+			part.finish();
+		});
+	}
+	fd = fopen(path.c_str(), "w");
+	metadataWriteCompressedHeader(fd);
+	std::vector<uint8_t> copy_buffer(CompressedMetadataPart::kBlockSize);
+	for (int i = 0; i < kParts; ++i) {
+		threads[i].join();
+		rewind(compressed[i]);
+		size_t size;
+		while ((size = fread(copy_buffer.data(), 1, copy_buffer.size(), compressed[i])) > 0) {
+			fwrite(copy_buffer.data(), 1, size, fd);
+		}
+		fclose(compressed[i]);
+	}
+	metadataWriteCompressedEnd(fd);
+	uint64_t compressed_size = ftello(fd);
+	fclose(fd);
+	auto compressed_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+			std::chrono::steady_clock::now() - start).count();
+
+	start = std::chrono::steady_clock::now();
+	fd = open_decompressed(path);
+	std::vector<uint8_t> buffer(65536);
+	uint64_t read_size = 0;
+	size_t bytes;
+	while ((bytes = fread(buffer.data(), 1, buffer.size(), fd)) > 0) {
+		read_size += bytes;
+	}
+	fclose(fd);
+	auto read_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+			std::chrono::steady_clock::now() - start).count();
+	unlink(path.c_str());
+
+	EXPECT_EQ(raw_size, read_size);
+	EXPECT_GT(raw_size, compressed_size);
+	std::cout << "metadata " << (raw_size >> 20) << " MiB: plain dump " << plain_ms
+	          << " ms, compressed dump in " << kParts << " threads " << compressed_ms << " ms ("
+	          << (compressed_size >> 20) << " MiB), reading compressed " << read_ms << " ms"
+	          << std::endl;
+}
+
+#endif
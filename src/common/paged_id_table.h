@@ -0,0 +1,146 @@
+/*
+   Copyright 2017 Skytechnology sp. z o.o.
+
+   This file is part of LizardFS.
+
+   LizardFS is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, version 3.
+
+   LizardFS is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with LizardFS. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include "common/platform.h"
+
+#include <array>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+/*!
+ * \brief Map from 32-bit ids to pointers, for ids which are mostly contiguous.
+ *
+ * Pointers are stored in an array indexed directly by id, split into pages of
+ * 2^kPageBits entries. Pages are allocated when the first id from their range is inserted
+ * and freed when the last one is erased, so sparse ranges of ids don't take memory.
+ * Lookup is two array accesses, without hashing or following lists.
+ */
+template <typename T, unsigned kPageBits = 16>
+class PagedIdTable {
+public:
+	static constexpr uint32_t kPageSize = 1U << kPageBits;
+
+	PagedIdTable() : size_(0) {
+	}
+
+	/*! \brief Returns pointer stored for the id or nullptr if there is no such id. */
+	T *find(uint32_t id) const {
+		uint32_t page = id >> kPageBits;
+		if (page >= pages_.size() || !pages_[page]) {
+			return nullptr;
+		}
+		return pages_[page]->entries[id & (kPageSize - 1)];
+	}
+
+	/*! \brief Stores pointer for the id (replacing the previous one). */
+	void insert(uint32_t id, T *value) {
+		assert(value);
+		uint32_t page = id >> kPageBits;
+		if (page >= pages_.size()) {
+			pages_.resize(page + 1);
+		}
+		if (!pages_[page]) {
+			pages_[page].reset(new Page());
+		}
+		T *&entry = pages_[page]->entries[id & (kPageSize - 1)];
+		if (entry == nullptr) {
+			pages_[page]->count++;
+			size_++;
+		}
+		entry = value;
+	}
+
+	/*! \brief Removes the id from the table. */
+	void erase(uint32_t id) {
+		uint32_t page = id >> kPageBits;
+		if (page >= pages_.size() || !pages_[page]) {
+			return;
+		}
+		T *&entry = pages_[page]->entries[id & (kPageSize - 1)];
+		if (entry == nullptr) {
+			return;
+		}
+		entry = nullptr;
+		size_--;
+		if (--pages_[page]->count == 0) {
+			pages_[page].reset();
+			while (!pages_.empty() && !pages_.back()) {
+				pages_.pop_back();
+			}
+			if (pages_.size() < pages_.capacity() / 4) {
+				pages_.shrink_to_fit();
+			}
+		}
+	}
+
+	/*! \brief Calls function for each stored pointer, in order of ids. */
+	template <typename Function>
+	void forEach(Function function) const {
+		for (const auto &page : pages_) {
+			if (!page) {
+				continue;
+			}
+			for (T *entry : page->entries) {
+				if (entry) {
+					function(entry);
+				}
+			}
+		}
+	}
+
+	std::size_t size() const {
+		return size_;
+	}
+
+	bool empty() const {
+		return size_ == 0;
+	}
+
+	void clear() {
+		pages_.clear();
+		size_ = 0;
+	}
+
+	/*! \brief Memory (in bytes) taken by the table. */
+	std::size_t memoryUsage() const {
+		std::size_t result = pages_.capacity() * sizeof(typename decltype(pages_)::value_type);
+		for (const auto &page : pages_) {
+			if (page) {
+				result += sizeof(Page);
+			}
+		}
+		return result;
+	}
+
+private:
+	struct Page {
+		Page() : entries(), count(0) {
+		}
+
+		std::array<T *, kPageSize> entries;
+		uint32_t count;
+	};
+
+	std::vector<std::unique_ptr<Page>> pages_;
+	std::size_t size_;
+};
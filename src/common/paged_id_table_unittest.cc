@@ -0,0 +1,185 @@
+/*
+   Copyright 2017 Skytechnology sp. z o.o.
+
+   This file is part of LizardFS.
+
+   LizardFS is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, version 3.
+
+   LizardFS is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with LizardFS. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "common/platform.h"
+#include "common/paged_id_table.h"
+
+#include <cstdio>
+#include <iostream>
+#include <random>
+#include <vector>
+#include <unistd.h>
+#include <gtest/gtest.h>
+
+#include "common/slab_allocator.h"
+#include "common/time_utils.h"
+
+TEST(PagedIdTableTests, InsertFindErase) {
+	PagedIdTable<int, 4> table;
+	std::vector<int> values(100);
+
+	EXPECT_TRUE(table.empty());
+	EXPECT_EQ(nullptr, table.find(0));
+	EXPECT_EQ(nullptr, table.find(1000000));
+
+	for (uint32_t id = 0; id < 100; id += 2) {
+		table.insert(id, &values[id]);
+	}
+	table.insert(4096U, &values[1]);
+	EXPECT_EQ(51U, table.size());
+	for (uint32_t id = 0; id < 100; ++id) {
+		EXPECT_EQ(id % 2 == 0 ? &values[id] : nullptr, table.find(id));
+	}
+	EXPECT_EQ(&values[1], table.find(4096U));
+
+	table.insert(10, &values[11]);
+	EXPECT_EQ(51U, table.size());
+	EXPECT_EQ(&values[11], table.find(10));
+
+	table.erase(4096U);
+	table.erase(11);
+	table.erase(12);
+	EXPECT_EQ(49U, table.size());
+	EXPECT_EQ(nullptr, table.find(4096U));
+	EXPECT_EQ(nullptr, table.find(12));
+	// Memory of removed pages is released
+	EXPECT_LT(table.memoryUsage(), 2000U);
+
+	std::vector<int *> visited;
+	table.forEach([&visited](int *value) { visited.push_back(value); });
+	ASSERT_EQ(49U, visited.size());
+	EXPECT_EQ(&values[0], visited[0]);
+	EXPECT_EQ(&values[11], visited[5]);
+	EXPECT_EQ(&values[98], visited.back());
+
+	table.clear();
+	EXPECT_TRUE(table.empty());
+	EXPECT_EQ(nullptr, table.find(0));
+}
+
+namespace {
+
+// Resembles FSNode - 64 bytes and a pointer used by the hash table
+struct Node {
+	uint32_t id;
+	uint8_t data[48];
+	Node *next;
+};
+
+} // anonymous namespace
+
+static uint64_t resident_memory() {
+	long pages = 0, resident = 0;
+	FILE *file = fopen("/proc/self/statm", "r");
+	if (file) {
+		if (fscanf(file, "%ld %ld", &pages, &resident) != 2) {
+			resident = 0;
+		}
+		fclose(file);
+	}
+	return resident * sysconf(_SC_PAGESIZE);
+}
+
+static void print_result(const char *name, uint32_t count, int64_t create_us, int64_t lookup_us,
+		uint64_t memory) {
+	std::cout << name << " " << count << " nodes: create " << create_us * 1000 / count
+	          << " ns/node, lookup " << lookup_us * 1000 / count << " ns/lookup, memory "
+	          << memory / count << " B/node\n";
+}
+
+/*
+ * Compares a chained hash table of 2^22 buckets with separately allocated nodes
+ * (the way master kept FSNodes) with a paged table and nodes from a slab allocator.
+ * Slabs are big enough to be allocated with mmap, so they are measured first - otherwise
+ * they would reuse memory freed by the first part of the benchmark.
+ */
+static void benchmark(uint32_t count) {
+	const uint32_t kHashSize = 1 << 22;
+	std::mt19937 generator(count);
+	std::vector<uint32_t> lookups(count);
+	for (auto &id : lookups) {
+		id = 1 + generator() % count;
+	}
+
+	{
+		uint64_t memory_before = resident_memory();
+		SlabAllocator<Node> allocator;
+		PagedIdTable<Node> table;
+		Timer timer;
+		for (uint32_t id = 1; id <= count; ++id) {
+			Node *node = allocator.create();
+			node->id = id;
+			table.insert(id, node);
+		}
+		int64_t create_us = timer.lap_us();
+		uint64_t found = 0;
+		for (uint32_t id : lookups) {
+			Node *node = table.find(id);
+			found += (node && node->id == id);
+		}
+		int64_t lookup_us = timer.lap_us();
+		EXPECT_EQ(count, found);
+		print_result("table+slab", count, create_us, lookup_us,
+		             resident_memory() - memory_before);
+		std::cout << "table+slab " << count << " nodes: accounted memory "
+		          << (allocator.memoryUsage() + table.memoryUsage()) / count << " B/node\n";
+	}
+
+	{
+		uint64_t memory_before = resident_memory();
+		std::vector<Node *> hash(kHashSize);
+		Timer timer;
+		for (uint32_t id = 1; id <= count; ++id) {
+			Node *node = new Node();
+			node->id = id;
+			node->next = hash[id & (kHashSize - 1)];
+			hash[id & (kHashSize - 1)] = node;
+		}
+		int64_t create_us = timer.lap_us();
+		uint64_t found = 0;
+		for (uint32_t id : lookups) {
+			for (Node *node = hash[id & (kHashSize - 1)]; node; node = node->next) {
+				if (node->id == id) {
+					++found;
+					break;
+				}
+			}
+		}
+		int64_t lookup_us = timer.lap_us();
+		EXPECT_EQ(count, found);
+		print_result("hash+malloc", count, create_us, lookup_us,
+		             resident_memory() - memory_before);
+		for (Node *node : hash) {
+			while (node) {
+				Node *next = node->next;
+				delete node;
+				node = next;
+			}
+		}
+	}
+}
+
+TEST(PagedIdTableTests, Benchmark) {
+	benchmark(1000000);
+}
+
+TEST(PagedIdTableTests, DISABLED_BenchmarkLarge) {
+	for (uint32_t count : {10000000, 100000000, 200000000}) {
+		benchmark(count);
+	}
+}
@@ -88,6 +88,15 @@ public:
 		return readOperation_.wave;
 	}
 
+	uint32_t requestSize() const {
+		return readOperation_.request_size;
+	}
+
+	// Time since the executor was created (i.e. since the request was sent)
+	int64_t elapsed_us() const {
+		return timer_.elapsed_us();
+	}
+
 private:
 	enum ReadOperationState {
 		kSendingRequest,
@@ -135,6 +144,8 @@ private:
 	/* checksum will be used to receive crc of complete data blocks */
 	uint32_t currentlyReadBlockCrc_;
 
+	Timer timer_;
+
 	/*
 	 * Four functions below are called when all the data
 	 * in the corresponding state has been received
@@ -19,6 +19,7 @@
 #include "common/platform.h"
 #include "common/read_plan_executor.h"
 
+#include <algorithm>
 #include <chrono>
 #include <map>
 #include <set>
@@ -39,13 +40,17 @@
 std::atomic<uint64_t> ReadPlanExecutor::executions_total_;
 std::atomic<uint64_t> ReadPlanExecutor::executions_with_additional_operations_;
 std::atomic<uint64_t> ReadPlanExecutor::executions_finished_by_additional_operations_;
+std::atomic<uint64_t> ReadPlanExecutor::hedged_reads_issued_;
+std::atomic<uint64_t> ReadPlanExecutor::hedged_reads_won_;
+constexpr uint64_t ReadPlanExecutor::kMinReadsToHedge;
 
 ReadPlanExecutor::ReadPlanExecutor(ChunkserverStats &chunkserver_stats, uint64_t chunk_id,
 		uint32_t chunk_version, std::unique_ptr<ReadPlan> plan)
 	: stats_(chunkserver_stats),
 	  chunk_id_(chunk_id),
 	  chunk_version_(chunk_version),
-	  plan_(std::move(plan)) {
+	  plan_(std::move(plan)),
+	  hedge_percentile_(0) {
 }
 
 /*! \brief A function which starts single read operation from chunkserver.
@@ -192,15 +197,111 @@ void ReadPlanExecutor::startPrefetchForWave(ExecuteParams &params, int wave) {
 	}
 }
 
+/*! \brief Returns time after which reads of the first wave should be hedged (0 if never).
+ *
+ * It's the highest of the chosen percentiles of read latencies of the chunkservers used
+ * in the first wave. Chunkservers without enough reads are not taken into account.
+ */
+uint64_t ReadPlanExecutor::hedgeDelay_us(const ExecuteParams &params) const {
+	if (hedge_percentile_ <= 0) {
+		return 0;
+	}
+	uint64_t delay_us = 0;
+	for (const auto &read_operation : plan_->read_operations) {
+		if (read_operation.second.wave != 0 || read_operation.second.request_size <= 0) {
+			continue;
+		}
+		const NetworkAddress &address = params.locations.at(read_operation.first).address;
+		delay_us = std::max(delay_us,
+				stats_.readLatencyPercentile(address, hedge_percentile_, kMinReadsToHedge));
+	}
+	return delay_us;
+}
+
+/*! \brief A function which hedges the pending read operations.
+ *
+ * Reads of parts which have an alternative location are sent to that location as well
+ * (the data is received into a separate buffer, so that the slower read can't spoil it).
+ *
+ * \param params Execution parameters pack.
+ * \return true if some reads couldn't be hedged this way and the next wave should be started.
+ */
+bool ReadPlanExecutor::startHedgedReads(ExecuteParams &params) {
+	std::vector<std::pair<ChunkPartType, ReadPlan::ReadOperation>> pending;
+	for (const auto &read_operation : plan_->read_operations) {
+		if (read_operation.second.wave != 0) {
+			continue;
+		}
+		for (const auto &fd_and_executor : executors_) {
+			if (fd_and_executor.second.chunkType() == read_operation.first) {
+				pending.push_back(read_operation);
+				break;
+			}
+		}
+	}
+
+	bool start_next_wave = false;
+	for (const auto &read_operation : pending) {
+		auto it = alternative_locations_.find(read_operation.first);
+		if (it == alternative_locations_.end()) {
+			start_next_wave = true;
+			continue;
+		}
+		const ChunkTypeWithAddress &ctwa = it->second;
+		ReadPlan::ReadOperation op = read_operation.second;
+		std::vector<uint8_t> data(op.request_size);
+		op.buffer_offset = 0;
+		stats_.registerReadOperation(ctwa.address);
+		try {
+			Timeout connect_timeout(std::chrono::milliseconds(params.connect_timeout));
+			int fd = params.connector.startUsingConnection(ctwa.address, connect_timeout);
+			try {
+				ReadOperationExecutor executor(op, chunk_id_, chunk_version_, read_operation.first,
+				                               ctwa.address, ctwa.chunkserver_version, fd,
+				                               data.data());
+				executor.sendReadRequest(connect_timeout);
+				executors_.insert(std::make_pair(fd, std::move(executor)));
+				hedged_reads_[fd] = std::move(data);
+			} catch (...) {
+				tcpclose(fd);
+				throw;
+			}
+			++hedged_reads_issued_;
+		} catch (ChunkserverConnectionException &ex) {
+			// the original read is still in progress, so it's not a failure of the plan
+			stats_.unregisterReadOperation(ctwa.address);
+			stats_.markDefective(ctwa.address);
+		}
+	}
+	if (start_next_wave) {
+		++hedged_reads_issued_;
+	}
+	return start_next_wave;
+}
+
+/*! \brief Cancel all pending read operations of the chunk part. */
+void ReadPlanExecutor::cancelReads(ChunkPartType chunk_type) {
+	for (auto it = executors_.begin(); it != executors_.end();) {
+		if (it->second.chunkType() == chunk_type) {
+			tcpclose(it->first);
+			stats_.unregisterReadOperation(it->second.server());
+			hedged_reads_.erase(it->first);
+			it = executors_.erase(it);
+		} else {
+			++it;
+		}
+	}
+}
+
 /*! \brief Function waits for data from chunkservers.
  *
  * \param params Execution parameters pack.
- * \param wave_timeout Timeout class keeping time to end of current wave.
+ * \param timeout_ms Maximum time of waiting (eg. time to end of current wave).
  * \param poll_fds Vector with pollfds structures resulting from call to poll system function.
  * \return true on success
  *         false EINTR occurred (call to waitForData should be repeated)
  */
-bool ReadPlanExecutor::waitForData(ExecuteParams &params, Timeout &wave_timeout,
+bool ReadPlanExecutor::waitForData(ExecuteParams &params, int timeout_ms,
 		std::vector<pollfd> &poll_fds) {
 	// Prepare for poll
 	poll_fds.clear();
@@ -213,8 +314,8 @@ bool ReadPlanExecutor::waitForData(ExecuteParams &params, Timeout &wave_timeout,
 	}
 
 	// Call poll
-	int poll_timeout = std::max(
-	    0, (int)std::min(params.total_timeout.remaining_ms(), wave_timeout.remaining_ms()));
+	int poll_timeout =
+	    std::max(0, (int)std::min<int64_t>(params.total_timeout.remaining_ms(), timeout_ms));
 	int status = tcppoll(poll_fds, poll_timeout);
 	if (status < 0) {
 #ifdef _WIN32
@@ -248,10 +349,20 @@ bool ReadPlanExecutor::readSomeData(ExecuteParams &params, const pollfd &poll_fd
 			throw ChunkserverConnectionException("Read from chunkserver (poll) error", server);
 		}
 	} catch (ChunkserverConnectionException &ex) {
+		ChunkPartType chunk_type = executor.chunkType();
 		stats_.markDefective(server);
-		networking_failures_.push_back(executor.chunkType());
 		tcpclose(poll_fd.fd);
+		if (hedged_reads_.erase(poll_fd.fd) > 0) {
+			stats_.unregisterReadOperation(server);
+		}
 		executors_.erase(poll_fd.fd);
+		// the part failed only if the other read of it (if the read was hedged) failed too
+		for (const auto &fd_and_executor : executors_) {
+			if (fd_and_executor.second.chunkType() == chunk_type) {
+				return true;
+			}
+		}
+		networking_failures_.push_back(chunk_type);
 		if (!plan_->isFinishingPossible(networking_failures_)) {
 			throw;
 		}
@@ -259,11 +370,27 @@ bool ReadPlanExecutor::readSomeData(ExecuteParams &params, const pollfd &poll_fd
 	}
 
 	if (executor.isFinished()) {
-		stats_.unregisterReadOperation(server);
-		stats_.markWorking(server);
+		ChunkPartType chunk_type = executor.chunkType();
+		stats_.readOperationFinished(server, executor.elapsed_us(), executor.requestSize());
 		params.connector.endUsingConnection(poll_fd.fd, server);
-		available_parts_.push_back(executor.chunkType());
+		auto hedged_read = hedged_reads_.find(poll_fd.fd);
+		if (hedged_read != hedged_reads_.end()) {
+			const ReadPlan::ReadOperation *op = nullptr;
+			for (const auto &read_operation : plan_->read_operations) {
+				if (read_operation.first == chunk_type) {
+					op = &read_operation.second;
+				}
+			}
+			assert(op);
+			std::copy(hedged_read->second.begin(), hedged_read->second.end(),
+			          params.buffer + op->buffer_offset);
+			hedged_reads_.erase(hedged_read);
+			++hedged_reads_won_;
+		}
 		executors_.erase(poll_fd.fd);
+		// the other read of this part (if the read was hedged) is not needed any more
+		cancelReads(chunk_type);
+		available_parts_.push_back(chunk_type);
 	}
 
 	return true;
@@ -287,6 +414,10 @@ void ReadPlanExecutor::executeReadOperations(ExecuteParams &params) {
 
 	Timeout wave_timeout(std::chrono::milliseconds(params.wave_timeout));
 	std::vector<pollfd> poll_fds;
+	uint64_t hedge_delay_us = hedgeDelay_us(params);
+	bool hedge_pending = hedge_delay_us > 0 && hedge_delay_us < params.wave_timeout * 1000ULL;
+	Timeout hedge_timeout{std::chrono::microseconds(hedge_delay_us)};
+	bool start_next_wave = false;
 
 	while (true) {
 		if (params.total_timeout.expired()) {
@@ -298,8 +429,16 @@ void ReadPlanExecutor::executeReadOperations(ExecuteParams &params) {
 			throw RecoverableReadException("Chunkservers communication timed out");
 		}
 
-		if (wave_timeout.expired() || failed_reads) {
+		if (hedge_pending && (hedge_timeout.expired() || wave > 0)) {
+			hedge_pending = false;
+			if (wave == 0) {
+				start_next_wave = startHedgedReads(params);
+			}
+		}
+
+		if (wave_timeout.expired() || failed_reads || start_next_wave) {
 			// start next wave
+			start_next_wave = false;
 			executions_with_additional_operations_ += wave == 0;
 			++wave;
 			wave_timeout.reset();
@@ -307,7 +446,12 @@ void ReadPlanExecutor::executeReadOperations(ExecuteParams &params) {
 			startPrefetchForWave(params, wave + 1);
 		}
 
-		if (!waitForData(params, wave_timeout, poll_fds)) {
+		int64_t timeout_ms = wave_timeout.remaining_ms();
+		if (hedge_pending) {
+			// round up, so that we don't spin before the time of hedging
+			timeout_ms = std::min<int64_t>(timeout_ms, (hedge_timeout.remaining_us() + 999) / 1000);
+		}
+		if (!waitForData(params, timeout_ms, poll_fds)) {
 			// EINTR occurred - we need to restart poll
 			continue;
 		}
@@ -325,7 +469,11 @@ void ReadPlanExecutor::executeReadOperations(ExecuteParams &params) {
 				continue;
 			}
 
-			ReadOperationExecutor &executor = executors_.at(poll_fd.fd);
+			auto executor_it = executors_.find(poll_fd.fd);
+			if (executor_it == executors_.end()) {
+				continue; // cancelled, because the other read of its part has finished
+			}
+			ReadOperationExecutor &executor = executor_it->second;
 
 			if (!readSomeData(params, poll_fd, executor)) {
 				++failed_reads;
@@ -405,6 +553,7 @@ void ReadPlanExecutor::executePlan(std::vector<uint8_t> &buffer,
 		int connect_timeout, int level_timeout,
 		const Timeout &total_timeout) {
 	executors_.clear();
+	hedged_reads_.clear();
 	networking_failures_.clear();
 	available_parts_.clear();
 	++executions_total_;
@@ -435,4 +584,5 @@ void ReadPlanExecutor::executePlan(std::vector<uint8_t> &buffer,
 		tcpclose(fd_and_executor.first);
 		stats_.unregisterReadOperation(fd_and_executor.second.server());
 	}
+	hedged_reads_.clear();
 }
@@ -71,6 +71,22 @@ public:
 			int wave_timeout,
 			const Timeout& total_timeout);
 
+	/*! \brief Enable hedged reads in the next executions of the plan.
+	 *
+	 * If reads of the first wave take longer than the given percentile of latencies of previous
+	 * reads from their chunkservers, the same reads are sent to alternative locations of the
+	 * parts (the one which finishes first is used, the other one is cancelled). Reads of parts
+	 * without an alternative location are hedged by starting the next wave (eg. reading parity
+	 * parts) before the wave timeout.
+	 *
+	 * \param percentile percentile of latencies after which reads are hedged, 0 disables hedging
+	 * \param alternative_locations second locations of chunk parts (may be empty)
+	 */
+	void enableHedging(double percentile, const ChunkTypeLocations& alternative_locations) {
+		hedge_percentile_ = percentile;
+		alternative_locations_ = alternative_locations;
+	}
+
 	/*! \brief Function Return parts that couldn't be read in execution phase.
 	 *
 	 * \return set of parts that couldn't be read during the last call to executePlan
@@ -88,6 +104,15 @@ public:
 	/// Counter for the .lizardfds_tweaks file.
 	static std::atomic<uint64_t> executions_finished_by_additional_operations_;
 
+	/// Counter for the .lizardfds_tweaks file.
+	static std::atomic<uint64_t> hedged_reads_issued_;
+
+	/// Counter for the .lizardfds_tweaks file.
+	static std::atomic<uint64_t> hedged_reads_won_;
+
+	/// Minimal number of reads from a chunkserver needed to hedge reads from it.
+	static constexpr uint64_t kMinReadsToHedge = 20;
+
 protected:
 	struct ExecuteParams {
 		uint8_t *buffer;
@@ -106,7 +131,10 @@ protected:
 	                            const ReadPlan::ReadOperation &op);
 	int startReadsForWave(ExecuteParams &params, int wave);
 	void startPrefetchForWave(ExecuteParams &params, int wave);
-	bool waitForData(ExecuteParams &params, Timeout &wave_timeout, std::vector<pollfd> &poll_fds);
+	uint64_t hedgeDelay_us(const ExecuteParams &params) const;
+	bool startHedgedReads(ExecuteParams &params);
+	void cancelReads(ChunkPartType chunk_type);
+	bool waitForData(ExecuteParams &params, int timeout_ms, std::vector<pollfd> &poll_fds);
 	bool readSomeData(ExecuteParams &params, const pollfd &poll_fd,
 	                  ReadOperationExecutor &executor);
 	void executeReadOperations(ExecuteParams &params);
@@ -118,7 +146,12 @@ private:
 	std::unique_ptr<ReadPlan> plan_;
 
 	flat_map<int, ReadOperationExecutor> executors_;
+	/*! Hedged reads (by their descriptors) store data in their own buffers. */
+	std::map<int, std::vector<uint8_t>> hedged_reads_;
 	ReadPlan::PartsContainer available_parts_;
 	ReadPlan::PartsContainer networking_failures_;
 	NetworkAddress last_connection_failure_;
+
+	double hedge_percentile_;
+	ChunkTypeLocations alternative_locations_;
 };
@@ -54,12 +54,12 @@ public:
 	}
 
 	T &operator[](long pos) {
-		assert(pos >= 0 && pos < size());
+		assert(pos >= 0 && pos < static_cast<long>(size()));
 		return data_[advance(start_, pos)];
 	}
 
 	const T &operator[](long pos) const {
-		assert(pos >= 0 && pos < size());
+		assert(pos >= 0 && pos < static_cast<long>(size()));
 		return data_[advance(start_, pos)];
 	}
 
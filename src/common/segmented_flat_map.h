@@ -0,0 +1,465 @@
+/*
+   Copyright 2017 Skytechnology sp. z o.o.
+
+   This file is part of LizardFS.
+
+   LizardFS is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, version 3.
+
+   LizardFS is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with LizardFS. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include "common/platform.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <functional>
+#include <iterator>
+#include <memory>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+/*!
+ * \brief Ordered map which is a flat sorted vector while small and a two level
+ *        B+tree-like structure (sorted vector of sorted segments) when large.
+ *
+ * Up to kSmallLimit elements all data is kept in a single sorted vector, so small maps
+ * have the same memory footprint and performance as flat_map (plus one pointer).
+ * Above this limit elements are split into segments of at most 2 * kSegmentSize
+ * elements each. Insert and erase then move at most one segment, i.e. they are
+ * O(log n + kSegmentSize) instead of O(n), and lookups stay O(log n).
+ *
+ * As in flat_map, insert and erase invalidate all iterators. Keys are expected
+ * to be used as stable cursors (i.e. lower_bound(last_key)) instead of positions.
+ */
+template <typename Key, typename T, class Compare = std::less<Key>,
+	std::size_t kSegmentSize = 512>
+class segmented_flat_map {
+public:
+	typedef Key key_type;
+	typedef T mapped_type;
+	typedef Compare key_compare;
+	typedef std::pair<Key, T> value_type;
+	typedef std::size_t size_type;
+	typedef std::ptrdiff_t difference_type;
+	typedef value_type &reference;
+	typedef const value_type &const_reference;
+
+	static constexpr size_type kSmallLimit = 2 * kSegmentSize;
+
+private:
+	typedef std::vector<value_type> Segment;
+
+	struct Segments {
+		std::vector<Segment> data;
+		size_type size;
+	};
+
+	template <bool Const>
+	class iterator_base {
+	public:
+		typedef std::bidirectional_iterator_tag iterator_category;
+		typedef typename segmented_flat_map::value_type value_type;
+		typedef typename segmented_flat_map::difference_type difference_type;
+		typedef typename std::conditional<Const, const value_type *, value_type *>::type pointer;
+		typedef typename std::conditional<Const, const value_type &, value_type &>::type reference;
+		typedef typename std::conditional<Const, const segmented_flat_map *, segmented_flat_map *>::type
+			map_pointer;
+
+		iterator_base() : map_(), segment_(), position_() {
+		}
+
+		iterator_base(map_pointer map, size_type segment, size_type position)
+			: map_(map), segment_(segment), position_(position) {
+		}
+
+		template <bool OtherConst, typename = typename std::enable_if<Const && !OtherConst>::type>
+		iterator_base(const iterator_base<OtherConst> &other)
+			: map_(other.map_), segment_(other.segment_), position_(other.position_) {
+		}
+
+		reference operator*() const {
+			return map_->segment(segment_)[position_];
+		}
+
+		pointer operator->() const {
+			return &map_->segment(segment_)[position_];
+		}
+
+		iterator_base &operator++() {
+			++position_;
+			if (position_ >= map_->segment(segment_).size() &&
+			    segment_ + 1 < map_->segmentCount()) {
+				++segment_;
+				position_ = 0;
+			}
+			return *this;
+		}
+
+		iterator_base operator++(int) {
+			iterator_base result(*this);
+			++(*this);
+			return result;
+		}
+
+		iterator_base &operator--() {
+			if (position_ == 0) {
+				assert(segment_ > 0);
+				--segment_;
+				position_ = map_->segment(segment_).size();
+			}
+			--position_;
+			return *this;
+		}
+
+		iterator_base operator--(int) {
+			iterator_base result(*this);
+			--(*this);
+			return result;
+		}
+
+		bool operator==(const iterator_base &other) const {
+			return segment_ == other.segment_ && position_ == other.position_;
+		}
+
+		bool operator!=(const iterator_base &other) const {
+			return !(*this == other);
+		}
+
+	private:
+		map_pointer map_;
+		size_type segment_;
+		size_type position_;
+
+		friend class segmented_flat_map;
+		template <bool> friend class iterator_base;
+	};
+
+public:
+	typedef iterator_base<false> iterator;
+	typedef iterator_base<true> const_iterator;
+
+	segmented_flat_map() : small_(), large_(), compare_() {
+	}
+
+	explicit segmented_flat_map(const key_compare &comp) : small_(), large_(), compare_(comp) {
+	}
+
+	segmented_flat_map(const segmented_flat_map &other)
+		: small_(other.small_),
+		  large_(other.large_ ? new Segments(*other.large_) : nullptr),
+		  compare_(other.compare_) {
+	}
+
+	segmented_flat_map(segmented_flat_map &&other) noexcept
+		: small_(std::move(other.small_)),
+		  large_(std::move(other.large_)),
+		  compare_(std::move(other.compare_)) {
+	}
+
+	segmented_flat_map &operator=(const segmented_flat_map &other) {
+		if (this != &other) {
+			small_ = other.small_;
+			large_.reset(other.large_ ? new Segments(*other.large_) : nullptr);
+			compare_ = other.compare_;
+		}
+		return *this;
+	}
+
+	segmented_flat_map &operator=(segmented_flat_map &&other) noexcept {
+		small_ = std::move(other.small_);
+		large_ = std::move(other.large_);
+		compare_ = std::move(other.compare_);
+		return *this;
+	}
+
+	// Iterators
+	iterator begin() noexcept {
+		return iterator(this, 0, 0);
+	}
+
+	const_iterator begin() const noexcept {
+		return const_iterator(this, 0, 0);
+	}
+
+	const_iterator cbegin() const noexcept {
+		return begin();
+	}
+
+	iterator end() noexcept {
+		return iterator(this, segmentCount() - 1, segment(segmentCount() - 1).size());
+	}
+
+	const_iterator end() const noexcept {
+		return const_iterator(this, segmentCount() - 1, segment(segmentCount() - 1).size());
+	}
+
+	const_iterator cend() const noexcept {
+		return end();
+	}
+
+	// Capacity
+	bool empty() const noexcept {
+		return size() == 0;
+	}
+
+	size_type size() const noexcept {
+		return large_ ? large_->size : small_.size();
+	}
+
+	/*! \brief Returns true if the map switched to segmented representation. */
+	bool segmented() const noexcept {
+		return static_cast<bool>(large_);
+	}
+
+	void clear() {
+		small_.clear();
+		large_.reset();
+	}
+
+	// Modifiers
+	std::pair<iterator, bool> insert(const value_type &value) {
+		return emplace_impl(value_type(value));
+	}
+
+	std::pair<iterator, bool> insert(value_type &&value) {
+		return emplace_impl(std::move(value));
+	}
+
+	iterator erase(iterator pos) {
+		Segment &seg = segment(pos.segment_);
+		assert(pos.position_ < seg.size());
+		seg.erase(seg.begin() + pos.position_);
+		if (!large_) {
+			return iterator(this, 0, pos.position_);
+		}
+
+		--large_->size;
+		if (large_->size < kSmallLimit / 2) {
+			size_type index = globalIndex(pos.segment_, pos.position_);
+			toSmall();
+			return iterator(this, 0, index);
+		}
+
+		return normalize(mergeSegment(pos.segment_, pos.position_));
+	}
+
+	size_type erase(const key_type &key) {
+		iterator it = find(key);
+		if (it == end()) {
+			return 0;
+		}
+		erase(it);
+		return 1;
+	}
+
+	// Lookup
+	size_type count(const key_type &key) const {
+		return find(key) != end();
+	}
+
+	iterator find(const key_type &key) {
+		iterator it = lower_bound(key);
+		if (it != end() && !compare_(key, it->first)) {
+			return it;
+		}
+		return end();
+	}
+
+	const_iterator find(const key_type &key) const {
+		const_iterator it = lower_bound(key);
+		if (it != end() && !compare_(key, it->first)) {
+			return it;
+		}
+		return end();
+	}
+
+	/*! \brief Returns iterator to nth element (O(n / kSegmentSize) for segmented maps). */
+	iterator find_nth(size_type nth) {
+		auto location = locate_nth(nth);
+		return iterator(this, location.first, location.second);
+	}
+
+	const_iterator find_nth(size_type nth) const {
+		auto location = locate_nth(nth);
+		return const_iterator(this, location.first, location.second);
+	}
+
+	iterator lower_bound(const key_type &key) {
+		auto location = locate(key);
+		return iterator(this, location.first, location.second);
+	}
+
+	const_iterator lower_bound(const key_type &key) const {
+		auto location = locate(key);
+		return const_iterator(this, location.first, location.second);
+	}
+
+	key_compare key_comp() const {
+		return compare_;
+	}
+
+private:
+	size_type segmentCount() const {
+		return large_ ? large_->data.size() : 1;
+	}
+
+	Segment &segment(size_type index) {
+		return large_ ? large_->data[index] : small_;
+	}
+
+	const Segment &segment(size_type index) const {
+		return large_ ? large_->data[index] : small_;
+	}
+
+	/*! \brief Returns (segment, position) of first element not less than key. */
+	std::pair<size_type, size_type> locate(const key_type &key) const {
+		auto element_less = [this](const value_type &a, const key_type &b) {
+			return compare_(a.first, b);
+		};
+		if (!large_) {
+			auto it = std::lower_bound(small_.begin(), small_.end(), key, element_less);
+			return {0, it - small_.begin()};
+		}
+
+		const auto &segments = large_->data;
+		// Segments are never empty, find first one which last element is not less than key
+		auto seg_it = std::lower_bound(segments.begin(), segments.end(), key,
+			[this](const Segment &s, const key_type &k) {
+				return compare_(s.back().first, k);
+			});
+		if (seg_it == segments.end()) {
+			return {segments.size() - 1, segments.back().size()};
+		}
+		auto it = std::lower_bound(seg_it->begin(), seg_it->end(), key, element_less);
+		return {seg_it - segments.begin(), it - seg_it->begin()};
+	}
+
+	std::pair<size_type, size_type> locate_nth(size_type nth) const {
+		if (nth >= size()) {
+			return {segmentCount() - 1, segment(segmentCount() - 1).size()};
+		}
+		size_type index = 0;
+		while (nth >= segment(index).size()) {
+			nth -= segment(index).size();
+			++index;
+		}
+		return {index, nth};
+	}
+
+	size_type globalIndex(size_type segment_index, size_type position) const {
+		for (size_type i = 0; i < segment_index; ++i) {
+			position += segment(i).size();
+		}
+		return position;
+	}
+
+	/*! \brief Moves iterator pointing past the end of a segment to the beginning of next one. */
+	iterator normalize(std::pair<size_type, size_type> location) {
+		if (location.second >= segment(location.first).size() &&
+		    location.first + 1 < segmentCount()) {
+			++location.first;
+			location.second = 0;
+		}
+		return iterator(this, location.first, location.second);
+	}
+
+	std::pair<iterator, bool> emplace_impl(value_type &&value) {
+		auto location = locate(value.first);
+		Segment &seg = segment(location.first);
+		if (location.second < seg.size() && !compare_(value.first, seg[location.second].first)) {
+			return {iterator(this, location.first, location.second), false};
+		}
+
+		seg.insert(seg.begin() + location.second, std::move(value));
+		if (!large_) {
+			if (small_.size() > kSmallLimit) {
+				toLarge();
+				return {find_nth(location.second), true};
+			}
+			return {iterator(this, 0, location.second), true};
+		}
+
+		++large_->size;
+		if (seg.size() > 2 * kSegmentSize) {
+			location = splitSegment(location.first, location.second);
+		}
+		return {iterator(this, location.first, location.second), true};
+	}
+
+	/*! \brief Splits segment in half and returns new location of given element. */
+	std::pair<size_type, size_type> splitSegment(size_type index, size_type position) {
+		auto &segments = large_->data;
+		Segment tail;
+		tail.reserve(kSegmentSize * 2);
+		std::move(segments[index].begin() + kSegmentSize, segments[index].end(),
+		          std::back_inserter(tail));
+		segments[index].erase(segments[index].begin() + kSegmentSize, segments[index].end());
+		segments.insert(segments.begin() + index + 1, std::move(tail));
+		if (position >= kSegmentSize) {
+			return {index + 1, position - kSegmentSize};
+		}
+		return {index, position};
+	}
+
+	/*! \brief Removes empty segment or merges a small one with its successor.
+	 *
+	 * \return New location of element which was at (index, position).
+	 */
+	std::pair<size_type, size_type> mergeSegment(size_type index, size_type position) {
+		auto &segments = large_->data;
+		if (segments[index].empty()) {
+			segments.erase(segments.begin() + index);
+			if (index >= segments.size()) {
+				return {segments.size() - 1, segments.back().size()};
+			}
+			return {index, 0};
+		}
+		if (index + 1 < segments.size() && segments[index].size() < kSegmentSize / 2 &&
+		    segments[index].size() + segments[index + 1].size() <= kSegmentSize) {
+			Segment &next = segments[index + 1];
+			std::move(next.begin(), next.end(), std::back_inserter(segments[index]));
+			segments.erase(segments.begin() + index + 1);
+		}
+		return {index, position};
+	}
+
+	void toLarge() {
+		std::unique_ptr<Segments> large(new Segments());
+		large->size = small_.size();
+		for (size_type begin = 0; begin < small_.size(); begin += kSegmentSize) {
+			size_type end = std::min(begin + kSegmentSize, small_.size());
+			Segment seg;
+			seg.reserve(kSegmentSize * 2);
+			std::move(small_.begin() + begin, small_.begin() + end, std::back_inserter(seg));
+			large->data.push_back(std::move(seg));
+		}
+		Segment().swap(small_);
+		large_ = std::move(large);
+	}
+
+	void toSmall() {
+		Segment small;
+		small.reserve(large_->size);
+		for (auto &seg : large_->data) {
+			std::move(seg.begin(), seg.end(), std::back_inserter(small));
+		}
+		small_ = std::move(small);
+		large_.reset();
+	}
+
+	Segment small_;                   /*!< All elements of a small map. */
+	std::unique_ptr<Segments> large_; /*!< Segments of a large map (small_ is unused then). */
+	key_compare compare_;
+};
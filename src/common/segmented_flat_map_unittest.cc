@@ -0,0 +1,205 @@
+/*
+   Copyright 2017 Skytechnology sp. z o.o.
+
+   This file is part of LizardFS.
+
+   LizardFS is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, version 3.
+
+   LizardFS is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with LizardFS. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "common/platform.h"
+#include "common/segmented_flat_map.h"
+
+#include <algorithm>
+#include <iostream>
+#include <map>
+#include <random>
+#include <gtest/gtest.h>
+
+#include "common/flat_map.h"
+#include "common/time_utils.h"
+
+// Small segments, so that all code paths are exercised with few elements
+typedef segmented_flat_map<uint64_t, int, std::less<uint64_t>, 8> TestMap;
+
+template <class Map>
+static void expectEqual(const std::map<uint64_t, int> &expected, const Map &map) {
+	ASSERT_EQ(expected.size(), map.size());
+	ASSERT_EQ(expected.empty(), map.empty());
+	auto expected_it = expected.begin();
+	for (const auto &entry : map) {
+		ASSERT_EQ(expected_it->first, entry.first);
+		ASSERT_EQ(expected_it->second, entry.second);
+		++expected_it;
+	}
+}
+
+TEST(SegmentedFlatMap, InsertFindErase) {
+	TestMap map;
+	EXPECT_TRUE(map.empty());
+	EXPECT_TRUE(map.begin() == map.end());
+
+	for (uint64_t i = 0; i < 100; ++i) {
+		auto result = map.insert({i * 2, (int)i});
+		EXPECT_TRUE(result.second);
+		EXPECT_EQ(i * 2, result.first->first);
+	}
+	EXPECT_TRUE(map.segmented());
+	EXPECT_EQ(100U, map.size());
+
+	auto result = map.insert({10, 1000});
+	EXPECT_FALSE(result.second);
+	EXPECT_EQ(5, result.first->second);
+
+	EXPECT_EQ(21, map.find(42)->second);
+	EXPECT_TRUE(map.find(43) == map.end());
+	EXPECT_EQ(44U, map.lower_bound(43)->first);
+	EXPECT_TRUE(map.lower_bound(1000) == map.end());
+	EXPECT_EQ(1U, map.count(0));
+	EXPECT_EQ(0U, map.count(1));
+
+	for (uint64_t i = 0; i < 100; ++i) {
+		EXPECT_EQ(i * 2, map.find_nth(i)->first);
+	}
+	EXPECT_TRUE(map.find_nth(100) == map.end());
+
+	// erase returns iterator to the next element
+	auto it = map.erase(map.find(42));
+	EXPECT_EQ(44U, it->first);
+	it = map.erase(map.find(198));
+	EXPECT_TRUE(it == map.end());
+	EXPECT_EQ(1U, map.erase(0));
+	EXPECT_EQ(0U, map.erase(0));
+
+	while (!map.empty()) {
+		map.erase(map.begin());
+	}
+	EXPECT_FALSE(map.segmented());
+	EXPECT_TRUE(map.begin() == map.end());
+}
+
+TEST(SegmentedFlatMap, Iterators) {
+	TestMap map;
+	for (uint64_t i = 0; i < 50; ++i) {
+		map.insert({i, (int)i});
+	}
+
+	uint64_t expected = 0;
+	for (auto it = map.begin(); it != map.end(); ++it) {
+		EXPECT_EQ(expected++, it->first);
+	}
+	for (auto it = map.end(); it != map.begin();) {
+		--it;
+		EXPECT_EQ(--expected, it->first);
+	}
+
+	const TestMap &const_map = map;
+	TestMap::const_iterator const_it = map.find(10);
+	EXPECT_TRUE(const_it == const_map.find(10));
+	(*map.find(10)).second = 1000;
+	EXPECT_EQ(1000, const_it->second);
+
+	TestMap copy(map);
+	map.clear();
+	EXPECT_TRUE(map.empty());
+	EXPECT_EQ(50U, copy.size());
+	EXPECT_EQ(1000, copy.find(10)->second);
+}
+
+TEST(SegmentedFlatMap, RandomOperations) {
+	std::mt19937 generator(1234);
+	std::map<uint64_t, int> expected;
+	TestMap map;
+
+	for (int round = 0; round < 20; ++round) {
+		// alternately grow and shrink the map, so that it is converted back and forth
+		int operations = 200 + (generator() % 200);
+		bool grow = round % 2 == 0;
+		for (int i = 0; i < operations; ++i) {
+			uint64_t key = generator() % 1000;
+			if (grow || (generator() % 4) == 0) {
+				int value = generator();
+				bool inserted = expected.insert({key, value}).second;
+				EXPECT_EQ(inserted, map.insert({key, value}).second);
+			} else {
+				EXPECT_EQ(expected.erase(key), map.erase(key));
+			}
+		}
+		expectEqual(expected, map);
+
+		uint64_t key = generator() % 1000;
+		auto expected_it = expected.lower_bound(key);
+		auto it = map.lower_bound(key);
+		if (expected_it == expected.end()) {
+			EXPECT_TRUE(it == map.end());
+		} else {
+			ASSERT_TRUE(it != map.end());
+			EXPECT_EQ(expected_it->first, it->first);
+		}
+	}
+}
+
+template <class Map>
+static void benchmark(const char *name, uint64_t count) {
+	std::mt19937_64 generator(count);
+	std::vector<uint64_t> keys(count);
+	for (auto &key : keys) {
+		key = generator();
+	}
+
+	Map map;
+	Timer timer;
+	for (uint64_t i = 0; i < count; ++i) {
+		map.insert({keys[i], (int)i});
+	}
+	int64_t create_us = timer.lap_us();
+
+	uint64_t found = 0;
+	for (uint64_t i = 0; i < count; ++i) {
+		found += map.find(keys[i]) != map.end();
+	}
+	int64_t lookup_us = timer.lap_us();
+
+	// Directory listing is done in batches (as readdir does), continuing from the last key
+	uint64_t listed = 0;
+	auto it = map.begin();
+	while (it != map.end()) {
+		for (int i = 0; i < 1000 && it != map.end(); ++i, ++it) {
+			++listed;
+		}
+		if (it != map.end()) {
+			it = map.lower_bound(it->first);
+		}
+	}
+	int64_t readdir_us = timer.lap_us();
+
+	EXPECT_EQ(count, found);
+	EXPECT_EQ(count, listed);
+	std::cout << name << " " << count << " entries: create " << create_us * 1000 / count
+	          << " ns/op, lookup " << lookup_us * 1000 / count << " ns/op, readdir "
+	          << readdir_us * 1000 / count << " ns/entry\n";
+}
+
+TEST(SegmentedFlatMap, Benchmark) {
+	for (uint64_t count : {1000, 10000}) {
+		benchmark<flat_map<uint64_t, int>>("flat_map", count);
+		benchmark<segmented_flat_map<uint64_t, int>>("segmented_flat_map", count);
+	}
+}
+
+TEST(SegmentedFlatMap, DISABLED_BenchmarkLarge) {
+	// flat_map needs O(n^2) time to be filled, so it is measured only for the smallest size
+	benchmark<flat_map<uint64_t, int>>("flat_map", 100000);
+	for (uint64_t count : {100000, 1000000, 10000000}) {
+		benchmark<segmented_flat_map<uint64_t, int>>("segmented_flat_map", count);
+	}
+}
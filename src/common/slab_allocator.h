@@ -0,0 +1,116 @@
+/*
+   Copyright 2017 Skytechnology sp. z o.o.
+
+   This file is part of LizardFS.
+
+   LizardFS is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, version 3.
+
+   LizardFS is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with LizardFS. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include "common/platform.h"
+
+#include <cassert>
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+/*!
+ * \brief Allocator of objects of a single type, which takes memory from big slabs.
+ *
+ * Objects are placed one after another in slabs of kObjectsPerSlab elements, so there
+ * is no per object malloc overhead (header and rounding up to size class) and objects
+ * allocated one after another are close to each other in memory.
+ * Freed objects are kept on a free list and reused by the next allocations. Memory
+ * of slabs is released only when the allocator is destroyed.
+ */
+template <typename T, std::size_t kObjectsPerSlab = 4096>
+class SlabAllocator {
+public:
+	SlabAllocator() : free_list_(nullptr), size_(0) {
+	}
+
+	SlabAllocator(const SlabAllocator &) = delete;
+	SlabAllocator &operator=(const SlabAllocator &) = delete;
+
+	/*! \brief Allocates memory and constructs an object in it. */
+	template <typename... Args>
+	T *create(Args &&... args) {
+		void *memory = allocate();
+		try {
+			return new (memory) T(std::forward<Args>(args)...);
+		} catch (...) {
+			deallocate(memory);
+			throw;
+		}
+	}
+
+	/*! \brief Destroys an object created by this allocator. */
+	void destroy(T *object) {
+		assert(object);
+		object->~T();
+		deallocate(object);
+	}
+
+	/*! \brief Number of objects which are allocated at the moment. */
+	std::size_t size() const {
+		return size_;
+	}
+
+	/*! \brief Memory (in bytes) taken by the allocator. */
+	std::size_t memoryUsage() const {
+		return slabs_.capacity() * sizeof(typename decltype(slabs_)::value_type) +
+		       slabs_.size() * kObjectsPerSlab * sizeof(Slot);
+	}
+
+private:
+	union Slot {
+		Slot *next;
+		typename std::aligned_storage<sizeof(T), alignof(T)>::type storage;
+	};
+
+	void *allocate() {
+		if (free_list_ == nullptr) {
+			addSlab();
+		}
+		Slot *slot = free_list_;
+		free_list_ = slot->next;
+		++size_;
+		return slot;
+	}
+
+	void deallocate(void *memory) {
+		Slot *slot = static_cast<Slot *>(memory);
+		slot->next = free_list_;
+		free_list_ = slot;
+		assert(size_ > 0);
+		--size_;
+	}
+
+	void addSlab() {
+		slabs_.emplace_back(new Slot[kObjectsPerSlab]);
+		Slot *slab = slabs_.back().get();
+		// Linked in reverse order, so that objects are allocated in order of addresses
+		for (std::size_t i = kObjectsPerSlab; i > 0; --i) {
+			slab[i - 1].next = free_list_;
+			free_list_ = &slab[i - 1];
+		}
+	}
+
+	std::vector<std::unique_ptr<Slot[]>> slabs_;
+	Slot *free_list_;
+	std::size_t size_;
+};
@@ -0,0 +1,87 @@
+/*
+   Copyright 2017 Skytechnology sp. z o.o.
+
+   This file is part of LizardFS.
+
+   LizardFS is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, version 3.
+
+   LizardFS is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with LizardFS. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "common/platform.h"
+#include "common/slab_allocator.h"
+
+#include <set>
+#include <string>
+#include <vector>
+#include <gtest/gtest.h>
+
+namespace {
+
+struct Counted {
+	Counted(int v, std::string s) : value(v), text(std::move(s)) {
+		++alive;
+	}
+	~Counted() {
+		--alive;
+	}
+
+	int value;
+	std::string text;
+	static int alive;
+};
+
+int Counted::alive = 0;
+
+} // anonymous namespace
+
+TEST(SlabAllocatorTests, CreateDestroy) {
+	SlabAllocator<Counted, 4> allocator;
+	std::vector<Counted *> objects;
+	for (int i = 0; i < 10; ++i) {
+		objects.push_back(allocator.create(i, std::to_string(i)));
+	}
+	EXPECT_EQ(10, Counted::alive);
+	EXPECT_EQ(10U, allocator.size());
+	EXPECT_GE(allocator.memoryUsage(), 3 * 4 * sizeof(Counted));
+	EXPECT_LT(allocator.memoryUsage(), 4 * 4 * sizeof(Counted));
+	for (int i = 0; i < 10; ++i) {
+		EXPECT_EQ(i, objects[i]->value);
+		EXPECT_EQ(std::to_string(i), objects[i]->text);
+	}
+	// objects from one slab are allocated one after another
+	EXPECT_EQ(objects[0] + 1, objects[1]);
+
+	std::set<Counted *> unique(objects.begin(), objects.end());
+	EXPECT_EQ(10U, unique.size());
+
+	for (Counted *object : objects) {
+		allocator.destroy(object);
+	}
+	EXPECT_EQ(0, Counted::alive);
+	EXPECT_EQ(0U, allocator.size());
+}
+
+TEST(SlabAllocatorTests, MemoryIsReused) {
+	SlabAllocator<Counted, 4> allocator;
+	Counted *first = allocator.create(1, "a");
+	Counted *second = allocator.create(2, "b");
+	std::size_t memory = allocator.memoryUsage();
+
+	allocator.destroy(first);
+	Counted *third = allocator.create(3, "c");
+	EXPECT_EQ(first, third);
+	EXPECT_EQ(memory, allocator.memoryUsage());
+
+	allocator.destroy(second);
+	allocator.destroy(third);
+	EXPECT_EQ(0, Counted::alive);
+}
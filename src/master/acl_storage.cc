@@ -21,22 +21,23 @@
 #include "common/hashfn.h"
 #include "master/acl_storage.h"
 
+#include <new>
+
+AclStorage::AclStorage() : last_mode_change_() {
+}
+
 AclStorage::~AclStorage() {
 	#ifndef NDEBUG
 		// Assert refcount sanity
-		for (auto &p : acl_) {
-			p.second.get().second--;
-		}
-		for (auto &kv : storage_) {
-			assert(kv.second == 0);
+		std::vector<uint32_t> refcount(pool_.size());
+		forEach([&refcount](InodeId, AclId acl_id) { refcount[acl_id]++; });
+		for (AclId acl_id = 0; acl_id < pool_.size(); ++acl_id) {
+			assert(refcount[acl_id] == pool_[acl_id].refcount);
 		}
 	#endif
 }
 
-size_t AclStorage::Hash::operator()(const RichACL &acl) const {
-	//NOTE(konrad.lipinski) the standard denotes bucket_count as implementation-defined;
-	// pragmatic implementations (ex. libstdc++) are expected to use a prime number though
-	// so there's no need to introduce explicit entropy into initial seed value
+uint32_t AclStorage::hash(const RichACL &acl) {
 	uint64_t seed = 0;
 	hashCombine(seed, acl.getOwnerMask());
 	hashCombine(seed, acl.getGroupMask());
@@ -49,63 +50,137 @@ size_t AclStorage::Hash::operator()(const RichACL &acl) const {
 		hashCombine(seed, ace.mask);
 		hashCombine(seed, ace.id);
 	}
-	return seed;
+	return hash6432(seed);
+}
+
+AclStorage::InodeAcl *AclStorage::find(InodeId id) {
+	return acl_.find(hash64(id), [id](const InodeAcl &entry) { return entry.inode == id; });
 }
 
 const RichACL *AclStorage::get(InodeId id) const {
-	const auto it = acl_.find(id);
-	return it != acl_.end()
-		? std::addressof(it->second.get().first)
-		: nullptr;
+	const InodeAcl *entry =
+	        acl_.find(hash64(id), [id](const InodeAcl &entry) { return entry.inode == id; });
+	return entry ? pool_[entry->acl].acl.get() : nullptr;
 }
 
 void AclStorage::set(InodeId id, RichACL &&acl) {
-	const auto it = acl_.find(id);
-	KeyValue &kv = ref(std::move(acl));
-	if (it == acl_.end()) {
-		acl_.insert({id, kv});
+	assign(id, acquire(std::move(acl)));
+}
+
+void AclStorage::set(InodeId id, AclId acl_id) {
+	assert(pool_[acl_id].refcount > 0);
+	pool_[acl_id].refcount++;
+	assign(id, acl_id);
+}
+
+void AclStorage::assign(InodeId id, AclId acl_id) {
+	InodeAcl *entry = find(id);
+	if (!entry) {
+		acl_.insert(InodeAcl(id, acl_id));
 	} else {
-		unref(it->second);
-		it->second = kv;
+		AclId previous = entry->acl;
+		entry->acl = acl_id;
+		release(previous);
 	}
 }
 
 void AclStorage::erase(InodeId id) {
-	const auto it = acl_.find(id);
-	if (it != acl_.end()) {
-		unref(it->second);
-		acl_.erase(it);
+	InodeAcl *entry = find(id);
+	if (entry) {
+		AclId acl_id = entry->acl;
+		acl_.erase(entry);
+		release(acl_id);
 	}
 }
 
 void AclStorage::setMode(InodeId id, uint16_t mode, bool is_dir) {
-	const auto it = acl_.find(id);
-	if (it != acl_.end()) {
-		auto &kv_ref = it->second;
-		RichACL acl_with_mode(kv_ref.get().first);
+	InodeAcl *entry = find(id);
+	if (!entry) {
+		return;
+	}
+	ModeChange &change = last_mode_change_;
+	if (!change.valid || change.from != entry->acl || change.mode != mode ||
+	    change.is_dir != is_dir) {
+		RichACL acl_with_mode(*pool_[entry->acl].acl);
 		acl_with_mode.setMode(mode, is_dir);
-		if (acl_with_mode != kv_ref.get().first) {
-			unref(kv_ref);
-			kv_ref = ref(std::move(acl_with_mode));
+		change.from = entry->acl;
+		change.to = acl_with_mode != *pool_[entry->acl].acl
+		                    ? acquire(std::move(acl_with_mode)) : entry->acl;
+		change.mode = mode;
+		change.is_dir = is_dir;
+		change.valid = true;
+		if (change.to != change.from) {
+			// reference acquired above is taken over by the inode
+			AclId previous = entry->acl;
+			entry->acl = change.to;
+			release(previous);
 		}
+		return;
+	}
+	if (change.to != change.from) {
+		pool_[change.to].refcount++;
+		AclId previous = entry->acl;
+		entry->acl = change.to;
+		release(previous);
 	}
 }
 
-AclStorage::KeyValue &AclStorage::ref(RichACL &&acl) {
-	const auto p = storage_.insert(KeyValue(std::move(acl), 0UL));
-	auto &kv = *p.first;
-	assert(p.second || kv.second > 0);
-	kv.second++;
-	assert(kv.second > 0);
-	return kv;
+AclStorage::AclId AclStorage::acquire(RichACL &&acl) {
+	uint32_t acl_hash = hash(acl);
+	uint64_t *slot = index_.find(acl_hash, [this, acl_hash, &acl](uint64_t slot) {
+		return (slot >> 32) == acl_hash && *pool_[(slot & UINT32_MAX) - 1].acl == acl;
+	});
+	if (slot) {
+		AclId acl_id = (*slot & UINT32_MAX) - 1;
+		pool_[acl_id].refcount++;
+		return acl_id;
+	}
+
+	AclId acl_id;
+	if (!free_ids_.empty()) {
+		acl_id = free_ids_.back();
+		free_ids_.pop_back();
+	} else {
+		if (pool_.size() >= UINT32_MAX - 1) {
+			throw std::bad_alloc();
+		}
+		acl_id = pool_.size();
+		pool_.emplace_back();
+	}
+	PoolEntry &entry = pool_[acl_id];
+	entry.acl.reset(new RichACL(std::move(acl)));
+	entry.refcount = 1;
+	entry.hash = acl_hash;
+	index_.insert((static_cast<uint64_t>(acl_hash) << 32) | (acl_id + 1));
+	return acl_id;
 }
 
-void AclStorage::unref(KeyValue &kv) {
-	assert(kv.second > 0);
-	kv.second--;
-	if (kv.second == 0) {
-		const auto it = storage_.find(kv.first);
-		assert(it != storage_.end());
-		storage_.erase(it);
+void AclStorage::release(AclId acl_id) {
+	PoolEntry &entry = pool_[acl_id];
+	assert(entry.refcount > 0);
+	if (--entry.refcount > 0) {
+		return;
+	}
+	uint64_t *slot = index_.find(entry.hash, [acl_id](uint64_t slot) {
+		return (slot & UINT32_MAX) == acl_id + 1;
+	});
+	assert(slot);
+	index_.erase(slot);
+	entry.acl.reset();
+	free_ids_.push_back(acl_id);
+	if (last_mode_change_.valid &&
+	    (last_mode_change_.from == acl_id || last_mode_change_.to == acl_id)) {
+		last_mode_change_.valid = false;
+	}
+}
+
+uint64_t AclStorage::memoryUsage() const {
+	uint64_t usage = acl_.memoryUsage() + index_.memoryUsage() +
+	                 pool_.capacity() * sizeof(PoolEntry) + free_ids_.capacity() * sizeof(AclId);
+	for (const PoolEntry &entry : pool_) {
+		if (entry.acl) {
+			usage += sizeof(RichACL) + entry.acl->size() * sizeof(RichACL::Ace);
+		}
 	}
+	return usage;
 }
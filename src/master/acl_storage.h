@@ -20,12 +20,21 @@
 
 #include "common/platform.h"
 
-#include <unordered_map>
+#include <cstdint>
+#include <memory>
+#include <vector>
 
+#include "common/hashfn.h"
+#include "common/incremental_hash_table.h"
 #include "common/richacl.h"
 
 /*!
  * \brief A class aggregating ACL storage and inode->acl maps, deduplication included.
+ *
+ * Equal ACLs are kept once, in a pool of reference counted ACLs identified by 32-bit ids,
+ * and inodes are mapped to these ids by an open addressing hash table. ACLs in the pool
+ * are never modified - a changed ACL of an inode is looked up (or added) in the pool
+ * and the inode is mapped to it, so other inodes sharing the old ACL are not affected.
  */
 class AclStorage {
 public:
@@ -34,7 +43,7 @@ public:
 	AclStorage(AclStorage&&) = delete;
 	AclStorage& operator=(AclStorage&&) = delete;
 
-	AclStorage() = default;
+	AclStorage();
 
 	/*!
 	 * \brief Assert state sanity.
@@ -46,6 +55,11 @@ public:
 	 */
 	typedef uint32_t InodeId;
 
+	/*!
+	 * \brief Identifier of an ACL in the pool
+	 */
+	typedef uint32_t AclId;
+
 	/*!
 	 * \brief Find ACL for an inode.
 	 *
@@ -62,6 +76,14 @@ public:
 	 */
 	void set(InodeId id, RichACL &&acl);
 
+	/*!
+	 * \brief Set ACL from the pool for an inode.
+	 *
+	 * \param id inode id
+	 * \param acl_id id of an ACL acquired from the pool
+	 */
+	void set(InodeId id, AclId acl_id);
+
 	/*!
 	 * \brief Erase ACL for an inode.
 	 *
@@ -72,41 +94,126 @@ public:
 	/*!
 	 * \brief Set mode of ACL of an inode (if any).
 	 *
+	 * The last computed change is remembered, so changing mode of many inodes
+	 * sharing an ACL (e.g. recursive chmod) computes the new ACL once.
+	 *
 	 * \param id inode id
 	 * \param mode mode to be set
 	 * \param is_dir true if inode is a directory
 	 */
 	void setMode(InodeId id, uint16_t mode, bool is_dir);
-private:
-	struct Hash {
-		size_t operator()(const RichACL &acl) const;
-	};
-
-	typedef std::unordered_map<RichACL, unsigned long, Hash> AclToRefCountMap;
-	typedef AclToRefCountMap::value_type KeyValue;
-	typedef std::unordered_map<InodeId, std::reference_wrapper<KeyValue>> InodeToKVMap;
 
 	/*!
-	 * \brief Insert an ACL into permanent storage.
+	 * \brief Insert an ACL into the pool or increase reference count of an equal one.
 	 *
-	 * Insert a key-value (ACL, reference count) into storage or increase
-	 * reference count of one already present.
-	 *
-	 * \param acl key
-	 * \return key-value pair from storage
+	 * \param acl ACL to be inserted
+	 * \return id of the ACL, which has to be released with release()
 	 */
-	KeyValue &ref(RichACL &&acl);
+	AclId acquire(RichACL &&acl);
 
 	/*!
-	 * \brief Decrease reference count of an ACL.
-	 *
-	 * Decrease reference count of a key-value pair from storage and remove
-	 * it from storage if count reaches zero.
+	 * \brief Decrease reference count of an ACL, remove it if it reaches zero.
 	 *
-	 * \param kv key-value pair from storage
+	 * \param acl_id id of the ACL
+	 */
+	void release(AclId acl_id);
+
+	/*!
+	 * \brief Call f(acl_id, acl) for all ACLs in the pool.
+	 */
+	template <typename Function>
+	void forEachAcl(Function f) const {
+		for (AclId acl_id = 0; acl_id < pool_.size(); ++acl_id) {
+			if (pool_[acl_id].refcount > 0) {
+				f(acl_id, *pool_[acl_id].acl);
+			}
+		}
+	}
+
+	/*!
+	 * \brief Call f(inode_id, acl_id) for all inodes with ACL.
+	 */
+	template <typename Function>
+	void forEach(Function f) const {
+		acl_.forEach([&f](const InodeAcl &entry) { f(entry.inode, entry.acl); });
+	}
+
+	/*!
+	 * \brief Number of inodes with ACL.
+	 */
+	std::size_t size() const {
+		return acl_.size();
+	}
+
+	/*!
+	 * \brief Number of distinct ACLs.
+	 */
+	std::size_t aclCount() const {
+		return index_.size();
+	}
+
+	/*!
+	 * \brief Approximate number of bytes allocated by the storage.
+	 */
+	uint64_t memoryUsage() const;
+
+private:
+	struct PoolEntry {
+		std::unique_ptr<RichACL> acl;
+		uint32_t refcount; /*!< 0 for unused entries. */
+		uint32_t hash;
+	};
+
+	/* Slot of the index is 32 bits of hash and ACL id + 1 */
+	struct IndexHasher {
+		uint64_t operator()(uint64_t slot) const {
+			return slot >> 32;
+		}
+		static bool empty(uint64_t slot) {
+			return slot == 0;
+		}
+	};
+
+	struct InodeAcl {
+		InodeAcl() : inode(0), acl(0) {
+		}
+		InodeAcl(InodeId inode, AclId acl) : inode(inode), acl(acl) {
+		}
+
+		InodeId inode; /*!< 0 for empty slots. */
+		AclId acl;
+	};
+
+	struct InodeHasher {
+		uint64_t operator()(const InodeAcl &entry) const {
+			return hash64(entry.inode);
+		}
+		static bool empty(const InodeAcl &entry) {
+			return entry.inode == 0;
+		}
+	};
+
+	/*! \brief The last change made by setMode. */
+	struct ModeChange {
+		AclId from;
+		AclId to;
+		uint16_t mode;
+		bool is_dir;
+		bool valid;
+	};
+
+	static uint32_t hash(const RichACL &acl);
+
+	InodeAcl *find(InodeId id);
+
+	/*!
+	 * \brief Map inode to an ACL, taking over a reference of the ACL.
 	 */
-	void unref(KeyValue &kv);
+	void assign(InodeId id, AclId acl_id);
 
-	AclToRefCountMap storage_;
-	InodeToKVMap acl_;
+	std::vector<PoolEntry> pool_;
+	std::vector<AclId> free_ids_;
+	IncrementalHashTable<uint64_t, IndexHasher> index_;
+	IncrementalHashTable<InodeAcl, InodeHasher> acl_;
+	ModeChange last_mode_change_;
 };
@@ -90,8 +90,9 @@
 #define CHARTS_PACKETSSENT 22
 #define CHARTS_BYTESRCVD 23
 #define CHARTS_BYTESSENT 24
+#define CHARTS_CHUNKLOOP 25
 
-#define CHARTS 25
+#define CHARTS 26
 
 /* name , join mode , percent , scale , multiplier , divisor */
 #define STATDEFS { \
@@ -120,6 +121,7 @@
 	{"psent"        ,CHARTS_MODE_ADD,0,CHARTS_SCALE_MILI ,1000,60}, \
 	{"brcvd"        ,CHARTS_MODE_ADD,0,CHARTS_SCALE_MILI ,8000,60}, \
 	{"bsent"        ,CHARTS_MODE_ADD,0,CHARTS_SCALE_MILI ,8000,60}, \
+	{"chunkloop"    ,CHARTS_MODE_MAX,0,CHARTS_SCALE_NONE ,   1, 1}, \
 	{NULL           ,0              ,0,0                 ,   0, 0}  \
 };
 
@@ -231,6 +233,7 @@ void chartsdata_refresh(void) {
 	chunk_stats(&del,&repl);
 	data[CHARTS_DELCHUNK]=del;
 	data[CHARTS_REPLCHUNK]=repl;
+	data[CHARTS_CHUNKLOOP]=chunk_get_loop_duration();
 	fs_retrieve_stats(fsdata);
 	for (i = 0 ; i < FsStats::Size; ++i) {
 		data[CHARTS_STATFS + i] = fsdata[i];
@@ -0,0 +1,176 @@
+/*
+   Copyright 2017 Skytechnology sp. z o.o.
+
+   This file is part of LizardFS.
+
+   LizardFS is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, version 3.
+
+   LizardFS is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with LizardFS. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "common/platform.h"
+
+#include "master/chunk_job_planner.h"
+
+#include <algorithm>
+#include <cassert>
+
+#include "common/flat_map.h"
+
+uint32_t ChunkJobPlanner::Batch::addGoal(const Goal &goal) {
+	if (goals.empty() || !(goals.back() == goal)) {
+		goals.push_back(goal);
+	}
+	return goals.size() - 1;
+}
+
+const ChunkJobPlanner::Plan *ChunkJobPlanner::Batch::find(uint64_t chunkid,
+		uint64_t signature) const {
+	auto it = std::lower_bound(index.begin(), index.end(), std::make_pair(chunkid, uint32_t(0)));
+	if (it == index.end() || it->first != chunkid) {
+		return nullptr;
+	}
+	if (chunks[it->second].signature != signature) {
+		return nullptr;
+	}
+	return &plans[it->second];
+}
+
+void ChunkJobPlanner::Batch::clear() {
+	goals.clear();
+	chunks.clear();
+	parts.clear();
+	plans.clear();
+	index.clear();
+}
+
+ChunkJobPlanner::ChunkJobPlanner(unsigned thread_count)
+		: pending_tasks_(0),
+		  terminate_(false) {
+	assert(thread_count > 0);
+	for (unsigned i = 0; i < thread_count; ++i) {
+		workers_.emplace_back(&ChunkJobPlanner::workerLoop, this);
+	}
+}
+
+ChunkJobPlanner::~ChunkJobPlanner() {
+	{
+		std::unique_lock<std::mutex> lock(mutex_);
+		terminate_ = true;
+	}
+	cond_.notify_all();
+	for (auto &worker : workers_) {
+		worker.join();
+	}
+}
+
+void ChunkJobPlanner::start(Batch &batch) {
+	assert(!busy());
+
+	batch.plans.resize(batch.chunks.size());
+	batch.index.resize(batch.chunks.size());
+
+	// Each worker gets a continuous range of chunks, the last task builds the index
+	std::size_t range_count = std::min<std::size_t>(workers_.size(),
+	                                                std::max<std::size_t>(batch.chunks.size(), 1));
+	std::size_t range_size = (batch.chunks.size() + range_count - 1) / range_count;
+
+	std::unique_lock<std::mutex> lock(mutex_);
+	pending_tasks_.store(range_count + 1, std::memory_order_release);
+	for (std::size_t i = 0; i < range_count; ++i) {
+		std::size_t begin = std::min(i * range_size, batch.chunks.size());
+		std::size_t end = std::min(begin + range_size, batch.chunks.size());
+		tasks_.push_back([&batch, begin, end]() {
+			for (std::size_t pos = begin; pos < end; ++pos) {
+				batch.chunks[pos].signature = signature(batch, batch.chunks[pos]);
+				batch.plans[pos] = analyze(batch, batch.chunks[pos]);
+			}
+		});
+	}
+	tasks_.push_back([&batch]() {
+		for (std::size_t pos = 0; pos < batch.chunks.size(); ++pos) {
+			batch.index[pos] = std::make_pair(batch.chunks[pos].chunkid, uint32_t(pos));
+		}
+		std::sort(batch.index.begin(), batch.index.end());
+	});
+	lock.unlock();
+	cond_.notify_all();
+}
+
+void ChunkJobPlanner::workerLoop() {
+	std::unique_lock<std::mutex> lock(mutex_);
+	while (true) {
+		cond_.wait(lock, [this]() { return terminate_ || !tasks_.empty(); });
+		if (terminate_) {
+			return;
+		}
+		std::function<void()> task = std::move(tasks_.front());
+		tasks_.pop_front();
+		lock.unlock();
+		task();
+		pending_tasks_.fetch_sub(1, std::memory_order_acq_rel);
+		lock.lock();
+	}
+}
+
+ChunkJobPlanner::Stats ChunkJobPlanner::computeStats(const Goal &goal,
+		const ChunkCopiesCalculator &calc) {
+	Stats stats;
+	stats.full_copies = calc.getFullCopiesCount();
+	stats.state = calc.getState();
+	stats.missing_parts = calc.countPartsToRecover();
+	stats.redundant_parts = calc.countPartsToRemove();
+	stats.goal_full_copies = ChunkCopiesCalculator::getFullCopiesCount(goal);
+	return stats;
+}
+
+/*! \brief Decides if ChunkWorker::doChunkJobs could do anything with the chunk.
+ *
+ * The conditions below mirror steps of doChunkJobs - the result has to be
+ * 'true' whenever any of the steps could send a command to a chunkserver.
+ * It is fine to be too pessimistic here, the chunk is then simply evaluated
+ * again on the main thread.
+ */
+ChunkJobPlanner::Plan ChunkJobPlanner::analyze(const Batch &batch, const ChunkState &chunk) {
+	const Goal &goal = batch.goals[chunk.goal];
+	ChunkCopiesCalculator calc(goal);
+	bool has_invalid = false, has_busy = false, has_todel = false, same_ip = false;
+	double max_part_usage = batch.min_usage;
+	flat_map<uint32_t, int> ip_counter;
+
+	for (uint32_t i = chunk.parts_begin; i < chunk.parts_end; ++i) {
+		const PartState &part = batch.parts[i];
+		if (!part.valid) {
+			has_invalid = true;
+			continue;
+		}
+		calc.addPart(part.type, part.label);
+		has_busy |= part.busy;
+		has_todel |= part.todel;
+		max_part_usage = std::max(max_part_usage, part.usage);
+		if (batch.avoid_same_ip) {
+			same_ip |= (++ip_counter[part.ip]) > 1;
+		}
+	}
+	calc.optimize();
+
+	Plan plan;
+	plan.stats = computeStats(goal, calc);
+
+	bool rebalance = (batch.max_usage - batch.min_usage) > batch.acceptable_difference &&
+	                 (max_part_usage - batch.min_usage) > batch.acceptable_difference;
+
+	plan.needs_jobs = has_invalid || has_busy || chunk.file_count == 0 ||
+	                  (plan.stats.state != ChunksAvailabilityState::kLost &&
+	                   (plan.stats.missing_parts > 0 || plan.stats.redundant_parts > 0 ||
+	                    has_todel || same_ip || rebalance));
+	return plan;
+}
@@ -0,0 +1,184 @@
+/*
+   Copyright 2017 Skytechnology sp. z o.o.
+
+   This file is part of LizardFS.
+
+   LizardFS is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, version 3.
+
+   LizardFS is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with LizardFS. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include "common/platform.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "common/chunk_copies_calculator.h"
+#include "common/chunk_part_type.h"
+#include "common/chunks_availability_state.h"
+#include "common/goal.h"
+#include "common/hashfn.h"
+#include "common/media_label.h"
+
+/*! \brief Background analysis of chunks processed by chunk loop.
+ *
+ * Chunk loop (ChunkWorker) has to evaluate every chunk in the system in order to
+ * find ones which need replication, deletion or rebalancing. In a healthy system
+ * almost all chunks need nothing, but the evaluation (building ChunkCopiesCalculator
+ * for each chunk) still has to be done on the main thread.
+ *
+ * This class moves the evaluation to worker threads. The main thread takes a snapshot
+ * of chunk parts state for a group of hash buckets (Batch), workers compute
+ * statistics and decide if the chunk needs any job (Plan), and then the main thread
+ * applies the plans - only chunks which need a job are evaluated again (and jobs are
+ * sent) on the main thread. Each snapshot entry carries a signature of the chunk state,
+ * so plans of chunks which were modified in the meantime are discarded.
+ */
+class ChunkJobPlanner {
+public:
+	/*! \brief Snapshot of a single chunk part. */
+	struct PartState {
+		uint32_t version;
+		ChunkPartType type;
+		uint16_t csid;
+		uint8_t state;
+		MediaLabel label;
+		uint32_t ip;      /*!< Ip of chunkserver holding the part. */
+		double usage;     /*!< Disk usage of chunkserver holding the part. */
+		bool valid;
+		bool busy;
+		bool todel;
+	};
+
+	/*! \brief Snapshot of a single chunk. */
+	struct ChunkState {
+		uint64_t chunkid;
+		uint64_t signature;   /*!< Signature of the chunk state, computed by workers. */
+		uint64_t goal_signature; /*!< Signature of goal counters of the chunk. */
+		uint32_t version;
+		uint8_t operation;
+		uint32_t goal;        /*!< Index of the chunk goal in Batch::goals. */
+		uint32_t file_count;
+		uint32_t parts_begin; /*!< Parts of the chunk are Batch::parts[parts_begin, parts_end). */
+		uint32_t parts_end;
+	};
+
+	/*! \brief Availability statistics of a chunk. */
+	struct Stats {
+		int full_copies;
+		ChunksAvailabilityState::State state;
+		int missing_parts;
+		int redundant_parts;
+		int goal_full_copies;
+	};
+
+	/*! \brief Result of chunk analysis. */
+	struct Plan {
+		Stats stats;
+		bool needs_jobs; /*!< False if processing the chunk would only update its statistics. */
+	};
+
+	/*! \brief Group of chunks analyzed together. */
+	struct Batch {
+		std::vector<Goal> goals;
+		std::vector<ChunkState> chunks;
+		std::vector<PartState> parts;
+		std::vector<Plan> plans;                          /*!< Computed by workers. */
+		std::vector<std::pair<uint64_t, uint32_t>> index; /*!< (chunkid, position) sorted. */
+
+		double min_usage;             /*!< Lowest disk usage of all chunkservers. */
+		double max_usage;             /*!< Highest disk usage of all chunkservers. */
+		double acceptable_difference; /*!< Disk usage difference which triggers rebalancing. */
+		bool avoid_same_ip;
+
+		Batch() : min_usage(), max_usage(), acceptable_difference(), avoid_same_ip() {}
+
+		/*! \brief Adds goal to the batch (reusing the last one if equal) and returns its index. */
+		uint32_t addGoal(const Goal &goal);
+
+		/*! \brief Returns plan of a chunk or nullptr if the chunk was not planned
+		 * or its state (signature) has changed since the snapshot was taken.
+		 */
+		const Plan *find(uint64_t chunkid, uint64_t signature) const;
+
+		void clear();
+	};
+
+	/*! \param thread_count number of worker threads (has to be greater than 0). */
+	explicit ChunkJobPlanner(unsigned thread_count);
+	~ChunkJobPlanner();
+
+	ChunkJobPlanner(const ChunkJobPlanner &) = delete;
+	ChunkJobPlanner &operator=(const ChunkJobPlanner &) = delete;
+
+	/*! \brief Starts analysis of the batch on worker threads.
+	 *
+	 * The batch mustn't be accessed until busy() returns false.
+	 */
+	void start(Batch &batch);
+
+	/*! \brief Returns true if analysis of the last started batch is still in progress. */
+	bool busy() const {
+		return pending_tasks_.load(std::memory_order_acquire) > 0;
+	}
+
+	unsigned threadCount() const {
+		return workers_.size();
+	}
+
+	/*! \brief Computes availability statistics from a calculator (after optimize). */
+	static Stats computeStats(const Goal &goal, const ChunkCopiesCalculator &calc);
+
+	/*! \brief Signature of everything analyze depends on.
+	 *
+	 * The same function is used for a chunk on the main thread and for its snapshot
+	 * on worker threads, so the main thread computes it only once per chunk.
+	 */
+	template <typename PartIterator>
+	static uint64_t signature(uint64_t chunkid, uint32_t version, uint8_t operation,
+			uint64_t goal_signature, PartIterator first, PartIterator last) {
+		uint64_t signature = chunkid;
+		hashCombine(signature, version, operation, goal_signature);
+		for (; first != last; ++first) {
+			hashCombine(signature, first->version, (int)first->type.getId(),
+			            (uint16_t)first->csid, (uint8_t)first->state);
+		}
+		return signature;
+	}
+
+	static uint64_t signature(const Batch &batch, const ChunkState &chunk) {
+		return signature(chunk.chunkid, chunk.version, chunk.operation, chunk.goal_signature,
+		                 batch.parts.begin() + chunk.parts_begin,
+		                 batch.parts.begin() + chunk.parts_end);
+	}
+
+	/*! \brief Analyzes a single chunk from the batch (thread safe). */
+	static Plan analyze(const Batch &batch, const ChunkState &chunk);
+
+private:
+	void workerLoop();
+
+	std::vector<std::thread> workers_;
+	std::mutex mutex_;
+	std::condition_variable cond_;
+	std::deque<std::function<void()>> tasks_;
+	std::atomic<uint32_t> pending_tasks_;
+	bool terminate_;
+};
@@ -0,0 +1,189 @@
+/*
+   Copyright 2017 Skytechnology sp. z o.o.
+
+   This file is part of LizardFS.
+
+   LizardFS is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, version 3.
+
+   LizardFS is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with LizardFS. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "common/platform.h"
+#include "master/chunk_job_planner.h"
+
+#include <thread>
+#include <gtest/gtest.h>
+
+#include "master/goal_config_loader.h"
+#include "unittests/chunk_type_constants.h"
+
+class ChunkJobPlannerTests : public ::testing::Test {
+protected:
+	typedef ChunkJobPlanner::PartState PartState;
+
+	void SetUp() override {
+		batch_.min_usage = 0.5;
+		batch_.max_usage = 0.5;
+		batch_.acceptable_difference = 0.1;
+		batch_.avoid_same_ip = false;
+		goal_ = batch_.addGoal(goal_config::parseLine("2 two: _ _\n").second);
+	}
+
+	static PartState part(uint32_t ip, double usage = 0.5, bool valid = true) {
+		PartState part_state;
+		part_state.version = 1;
+		part_state.type = standard;
+		part_state.csid = ip;
+		part_state.state = 0;
+		part_state.label = MediaLabel::kWildcard;
+		part_state.ip = ip;
+		part_state.usage = usage;
+		part_state.valid = valid;
+		part_state.busy = false;
+		part_state.todel = false;
+		return part_state;
+	}
+
+	const ChunkJobPlanner::ChunkState &addChunk(uint64_t chunkid,
+			const std::vector<PartState> &parts, uint32_t file_count = 1) {
+		ChunkJobPlanner::ChunkState chunk;
+		chunk.chunkid = chunkid;
+		chunk.signature = 0;
+		chunk.goal_signature = 1;
+		chunk.version = 1;
+		chunk.operation = 0;
+		chunk.goal = goal_;
+		chunk.file_count = file_count;
+		chunk.parts_begin = batch_.parts.size();
+		batch_.parts.insert(batch_.parts.end(), parts.begin(), parts.end());
+		chunk.parts_end = batch_.parts.size();
+		batch_.chunks.push_back(chunk);
+		return batch_.chunks.back();
+	}
+
+	ChunkJobPlanner::Plan analyze(const std::vector<PartState> &parts, uint32_t file_count = 1) {
+		return ChunkJobPlanner::analyze(batch_, addChunk(batch_.chunks.size() + 1, parts,
+		                                                 file_count));
+	}
+
+	ChunkJobPlanner::Batch batch_;
+	uint32_t goal_;
+};
+
+TEST_F(ChunkJobPlannerTests, HealthyChunk) {
+	auto plan = analyze({part(1), part(2)});
+	EXPECT_FALSE(plan.needs_jobs);
+	EXPECT_EQ(2, plan.stats.full_copies);
+	EXPECT_EQ(2, plan.stats.goal_full_copies);
+	EXPECT_EQ(0, plan.stats.missing_parts);
+	EXPECT_EQ(0, plan.stats.redundant_parts);
+	EXPECT_EQ(ChunksAvailabilityState::kSafe, plan.stats.state);
+}
+
+TEST_F(ChunkJobPlannerTests, ChunksNeedingJobs) {
+	auto plan = analyze({part(1)});
+	EXPECT_TRUE(plan.needs_jobs);
+	EXPECT_EQ(1, plan.stats.missing_parts);
+	EXPECT_EQ(ChunksAvailabilityState::kEndangered, plan.stats.state);
+
+	plan = analyze({part(1), part(2), part(3)});
+	EXPECT_TRUE(plan.needs_jobs);
+	EXPECT_EQ(1, plan.stats.redundant_parts);
+
+	plan = analyze({part(1), part(2), part(3, 0.5, false)});
+	EXPECT_TRUE(plan.needs_jobs);
+	EXPECT_EQ(2, plan.stats.full_copies);
+
+	plan = analyze({part(1), part(2)}, 0);
+	EXPECT_TRUE(plan.needs_jobs);
+
+	auto todel = part(2);
+	todel.todel = true;
+	EXPECT_TRUE(analyze({part(1), todel}).needs_jobs);
+
+	auto busy = part(2);
+	busy.busy = true;
+	EXPECT_TRUE(analyze({part(1), busy}).needs_jobs);
+}
+
+TEST_F(ChunkJobPlannerTests, LostChunk) {
+	auto plan = analyze({});
+	EXPECT_FALSE(plan.needs_jobs);
+	EXPECT_EQ(ChunksAvailabilityState::kLost, plan.stats.state);
+
+	plan = analyze({part(1, 0.5, false)});
+	EXPECT_TRUE(plan.needs_jobs);
+	EXPECT_EQ(ChunksAvailabilityState::kLost, plan.stats.state);
+}
+
+TEST_F(ChunkJobPlannerTests, SameIp) {
+	EXPECT_FALSE(analyze({part(1), part(1)}).needs_jobs);
+	batch_.avoid_same_ip = true;
+	EXPECT_TRUE(analyze({part(1), part(1)}).needs_jobs);
+	EXPECT_FALSE(analyze({part(1), part(2)}).needs_jobs);
+}
+
+TEST_F(ChunkJobPlannerTests, Rebalance) {
+	batch_.min_usage = 0.2;
+	batch_.max_usage = 0.9;
+	EXPECT_TRUE(analyze({part(1, 0.2), part(2, 0.9)}).needs_jobs);
+	EXPECT_FALSE(analyze({part(1, 0.2), part(2, 0.25)}).needs_jobs);
+
+	batch_.max_usage = 0.25;
+	EXPECT_FALSE(analyze({part(1, 0.2), part(2, 0.25)}).needs_jobs);
+}
+
+TEST_F(ChunkJobPlannerTests, ParallelPlanning) {
+	for (uint64_t chunkid = 1000; chunkid > 0; --chunkid) {
+		std::vector<PartState> parts;
+		for (uint32_t i = 0; i < chunkid % 4; ++i) {
+			parts.push_back(part(i, 0.5, chunkid % 7 != 0));
+		}
+		addChunk(chunkid, parts);
+	}
+
+	ChunkJobPlanner planner(4);
+	planner.start(batch_);
+	while (planner.busy()) {
+		std::this_thread::yield();
+	}
+
+	ASSERT_EQ(batch_.chunks.size(), batch_.plans.size());
+	for (const auto &chunk : batch_.chunks) {
+		auto expected = ChunkJobPlanner::analyze(batch_, chunk);
+		const ChunkJobPlanner::Plan *plan = batch_.find(chunk.chunkid,
+		                                                ChunkJobPlanner::signature(batch_, chunk));
+		ASSERT_NE(nullptr, plan);
+		EXPECT_EQ(expected.needs_jobs, plan->needs_jobs);
+		EXPECT_EQ(expected.stats.missing_parts, plan->stats.missing_parts);
+		EXPECT_EQ(expected.stats.redundant_parts, plan->stats.redundant_parts);
+		EXPECT_EQ(expected.stats.full_copies, plan->stats.full_copies);
+	}
+
+	// Plans of modified or unknown chunks are not returned
+	auto chunk = batch_.chunks.front();
+	EXPECT_NE(nullptr, batch_.find(chunk.chunkid, chunk.signature));
+	++chunk.version;
+	EXPECT_EQ(nullptr, batch_.find(chunk.chunkid, ChunkJobPlanner::signature(batch_, chunk)));
+	EXPECT_EQ(nullptr, batch_.find(1001, chunk.signature));
+
+	// Planner can be reused
+	batch_.clear();
+	goal_ = batch_.addGoal(goal_config::parseLine("2 two: _ _\n").second);
+	addChunk(5, {part(1), part(2)});
+	planner.start(batch_);
+	while (planner.busy()) {
+		std::this_thread::yield();
+	}
+	uint64_t signature = ChunkJobPlanner::signature(batch_, batch_.chunks.front());
+	ASSERT_NE(nullptr, batch_.find(5, signature));
+	EXPECT_FALSE(batch_.find(5, signature)->needs_jobs);
+}
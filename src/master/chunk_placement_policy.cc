@@ -0,0 +1,62 @@
+/*
+   Copyright 2017 Skytechnology sp. z o.o.
+
+   This file is part of LizardFS.
+
+   LizardFS is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, version 3.
+
+   LizardFS is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with LizardFS. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "common/platform.h"
+#include "master/chunk_placement_policy.h"
+
+#include <algorithm>
+
+constexpr int64_t ChunkPlacementPolicy::kMaxWeight;
+constexpr const char *FreeSpacePlacementPolicy::kName;
+constexpr const char *LoadAwarePlacementPolicy::kName;
+
+double ChunkPlacementPolicy::usage(const ChunkserverPlacementInfo &info) {
+	if (info.total_space == 0 || info.used_space > info.total_space) {
+		return 1.0;
+	}
+	return double(info.used_space) / double(info.total_space);
+}
+
+int64_t FreeSpacePlacementPolicy::weight(const ChunkserverPlacementInfo &info) const {
+	// A good weight formula will do the following:
+	//   * Agree with the chunk balancing algorithm, i.e. avoid creating a distribution which
+	//     immediately needs to be re-balanced.
+	//   * Be coarse enough that when the cluster is balanced, weights are generally equal.
+	//   * Keep weights constant across the cluster for long enough periods
+	//     that the 'history' can also do its job.
+	//
+	// weight = percent free spaces
+	return std::max<int64_t>(kMaxWeight * (1. - usage(info)), 1);
+}
+
+int64_t LoadAwarePlacementPolicy::weight(const ChunkserverPlacementInfo &info) const {
+	double load = std::min<double>(info.load_factor, 100) / 100.;
+	double factor = (1. - load_penalty_ * load) / (1. + replication_penalty_ * info.pending_operations);
+	return std::max<int64_t>(kMaxWeight * (1. - usage(info)) * std::max(factor, 0.), 1);
+}
+
+std::unique_ptr<ChunkPlacementPolicy> createChunkPlacementPolicy(const std::string &name,
+		double load_penalty, double replication_penalty) {
+	if (name == FreeSpacePlacementPolicy::kName) {
+		return std::unique_ptr<ChunkPlacementPolicy>(new FreeSpacePlacementPolicy());
+	} else if (name == LoadAwarePlacementPolicy::kName) {
+		return std::unique_ptr<ChunkPlacementPolicy>(
+				new LoadAwarePlacementPolicy(load_penalty, replication_penalty));
+	}
+	return nullptr;
+}
@@ -0,0 +1,111 @@
+/*
+   Copyright 2017 Skytechnology sp. z o.o.
+
+   This file is part of LizardFS.
+
+   LizardFS is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, version 3.
+
+   LizardFS is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with LizardFS. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "common/platform.h"
+
+#include <cstdint>
+#include <memory>
+#include <string>
+
+/// State of a chunkserver which is taken into account when placing new chunks.
+struct ChunkserverPlacementInfo {
+	ChunkserverPlacementInfo()
+	    : used_space(), total_space(), load_factor(), pending_operations() {
+	}
+
+	ChunkserverPlacementInfo(uint64_t used_space, uint64_t total_space, uint8_t load_factor,
+	                         uint32_t pending_operations)
+	    : used_space(used_space),
+	      total_space(total_space),
+	      load_factor(load_factor),
+	      pending_operations(pending_operations) {
+	}
+
+	uint64_t used_space;
+	uint64_t total_space;
+	uint8_t load_factor;          ///< Disk utilization reported by the chunkserver (0-100).
+	uint32_t pending_operations;  ///< Replications in progress to or from the chunkserver.
+};
+
+/*! \brief Policy which weights chunkservers for placement of new chunks.
+ *
+ * GetServersForNewChunk spreads new chunks between servers proportionally to their
+ * weights, so a policy decides which share of new chunks each server receives.
+ */
+class ChunkPlacementPolicy {
+public:
+	/// Weight of a server with no used space, weights of other servers are lower.
+	static constexpr int64_t kMaxWeight = 1024 * 1024;
+
+	virtual ~ChunkPlacementPolicy() {
+	}
+
+	virtual const char *name() const = 0;
+
+	/// Returns weight of a server, at least 1 if it can store a chunk at all.
+	virtual int64_t weight(const ChunkserverPlacementInfo &info) const = 0;
+
+protected:
+	static double usage(const ChunkserverPlacementInfo &info);
+};
+
+/// Weights servers by their free space only.
+class FreeSpacePlacementPolicy : public ChunkPlacementPolicy {
+public:
+	static constexpr const char *kName = "free_space";
+
+	const char *name() const override {
+		return kName;
+	}
+
+	int64_t weight(const ChunkserverPlacementInfo &info) const override;
+};
+
+/*! \brief Weights servers by free space lowered for servers which are busy.
+ *
+ * The weight based on free space is multiplied by (1 - load_penalty * load_factor / 100)
+ * and divided by (1 + replication_penalty * pending_operations), so saturated servers
+ * receive a smaller share of new chunks until their load drops.
+ */
+class LoadAwarePlacementPolicy : public ChunkPlacementPolicy {
+public:
+	static constexpr const char *kName = "load_aware";
+
+	LoadAwarePlacementPolicy(double load_penalty, double replication_penalty)
+	    : load_penalty_(load_penalty), replication_penalty_(replication_penalty) {
+	}
+
+	const char *name() const override {
+		return kName;
+	}
+
+	int64_t weight(const ChunkserverPlacementInfo &info) const override;
+
+private:
+	double load_penalty_;
+	double replication_penalty_;
+};
+
+/*! \brief Creates a policy with the given name.
+ *
+ * \return nullptr if there is no such policy.
+ */
+std::unique_ptr<ChunkPlacementPolicy> createChunkPlacementPolicy(const std::string &name,
+		double load_penalty, double replication_penalty);
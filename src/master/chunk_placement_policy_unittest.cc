@@ -0,0 +1,136 @@
+/*
+   Copyright 2017 Skytechnology sp. z o.o.
+
+   This file is part of LizardFS.
+
+   LizardFS is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, version 3.
+
+   LizardFS is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with LizardFS. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "common/platform.h"
+#include "master/chunk_placement_policy.h"
+
+#include <gtest/gtest.h>
+
+#include "common/media_label.h"
+#include "master/get_servers_for_new_chunk.h"
+
+static const uint64_t kGiB = 1024ULL * 1024 * 1024;
+
+static ChunkserverPlacementInfo server(uint64_t used_gib, uint8_t load_factor = 0,
+		uint32_t pending_operations = 0) {
+	return ChunkserverPlacementInfo(used_gib * kGiB, 100 * kGiB, load_factor, pending_operations);
+}
+
+TEST(ChunkPlacementPolicyTests, CreatePolicy) {
+	EXPECT_STREQ("free_space", createChunkPlacementPolicy("free_space", 0.5, 0.1)->name());
+	EXPECT_STREQ("load_aware", createChunkPlacementPolicy("load_aware", 0.5, 0.1)->name());
+	EXPECT_EQ(nullptr, createChunkPlacementPolicy("fastest", 0.5, 0.1));
+}
+
+TEST(ChunkPlacementPolicyTests, FreeSpaceWeights) {
+	FreeSpacePlacementPolicy policy;
+	EXPECT_EQ(ChunkPlacementPolicy::kMaxWeight, policy.weight(server(0)));
+	EXPECT_EQ(ChunkPlacementPolicy::kMaxWeight / 4, policy.weight(server(75)));
+	EXPECT_EQ(1, policy.weight(server(100)));
+	EXPECT_EQ(1, policy.weight(ChunkserverPlacementInfo(200, 100, 0, 0)));
+	EXPECT_EQ(1, policy.weight(ChunkserverPlacementInfo(0, 0, 0, 0)));
+	// load is ignored
+	EXPECT_EQ(policy.weight(server(30)), policy.weight(server(30, 100, 10)));
+}
+
+TEST(ChunkPlacementPolicyTests, LoadAwareWeights) {
+	FreeSpacePlacementPolicy free_space;
+	LoadAwarePlacementPolicy policy(0.5, 0.1);
+
+	// idle servers are weighted by free space only
+	for (uint64_t used = 0; used <= 100; used += 10) {
+		EXPECT_EQ(free_space.weight(server(used)), policy.weight(server(used)));
+	}
+	EXPECT_EQ(ChunkPlacementPolicy::kMaxWeight / 2, policy.weight(server(0, 100)));
+	EXPECT_EQ(ChunkPlacementPolicy::kMaxWeight / 2, policy.weight(server(0, 0, 10)));
+	EXPECT_EQ(ChunkPlacementPolicy::kMaxWeight / 2, policy.weight(server(0, 200)));
+
+	// weights never grow with load or used space and never drop to 0
+	for (uint64_t used = 0; used <= 100; used += 5) {
+		int64_t previous = policy.weight(server(used));
+		for (int load = 0; load <= 100; load += 5) {
+			int64_t weight = policy.weight(server(used, load));
+			EXPECT_LE(weight, previous);
+			EXPECT_GE(weight, 1);
+			EXPECT_LE(weight, policy.weight(server(used - std::min<uint64_t>(used, 5), load)));
+			previous = weight;
+		}
+		for (uint32_t operations = 0; operations <= 100; ++operations) {
+			int64_t weight = policy.weight(server(used, 50, operations));
+			EXPECT_LE(weight, policy.weight(server(used, 50, operations - std::min(operations, 1U))));
+			EXPECT_GE(weight, 1);
+		}
+	}
+
+	LoadAwarePlacementPolicy full_penalty(1.0, 0);
+	EXPECT_EQ(1, full_penalty.weight(server(0, 100)));
+}
+
+/*
+ * Places 'count' single copy chunks on servers with the given state and returns
+ * number of chunks placed on each of them.
+ */
+static std::vector<int> place_chunks(const ChunkPlacementPolicy &policy,
+		const std::vector<ChunkserverPlacementInfo> &servers, int count) {
+	ChunkCreationHistory history;
+	Goal::Slice::Labels labels = {{MediaLabel::kWildcard, 1}};
+	Goal::Slice::ConstPartProxy proxy(
+	    vector_range<const Goal::Slice::DataContainer, Goal::Slice::SizeContainer::value_type>(
+	        labels.data(), 0, labels.size()));
+	std::vector<int> chunks(servers.size());
+	for (int i = 0; i < count; ++i) {
+		GetServersForNewChunk getter;
+		for (size_t s = 0; s < servers.size(); ++s) {
+			getter.addServer(reinterpret_cast<matocsserventry *>(s + 1), MediaLabel::kWildcard,
+			                 policy.weight(servers[s]), 0, servers[s].load_factor);
+		}
+		getter.prepareData(history);
+		std::vector<matocsserventry *> used;
+		for (matocsserventry *chosen : getter.chooseServersForLabels(history, proxy, 0, used)) {
+			++chunks[reinterpret_cast<intptr_t>(chosen) - 1];
+		}
+	}
+	return chunks;
+}
+
+TEST(ChunkPlacementPolicyTests, LoadAwareFairness) {
+	LoadAwarePlacementPolicy policy(0.5, 0.1);
+	const int kChunks = 10000;
+
+	// Equal idle servers receive equal shares
+	std::vector<int> chunks = place_chunks(policy, {server(50), server(50), server(50)}, kChunks);
+	for (int count : chunks) {
+		EXPECT_NEAR(kChunks / 3, count, kChunks / 100);
+	}
+
+	// A saturated server receives half of the share of idle ones, but isn't starved;
+	// a server with replications in progress is between them
+	chunks = place_chunks(policy, {server(50), server(50), server(50, 100), server(50, 0, 5)},
+	                      kChunks);
+	EXPECT_NEAR(chunks[0], chunks[1], kChunks / 100);
+	EXPECT_NEAR(chunks[0] / 2, chunks[2], kChunks / 100);
+	EXPECT_NEAR(chunks[0] * 2 / 3, chunks[3], kChunks / 100);
+	EXPECT_EQ(kChunks, chunks[0] + chunks[1] + chunks[2] + chunks[3]);
+
+	// When all servers are equally loaded, free space decides as without load
+	FreeSpacePlacementPolicy free_space;
+	std::vector<int> loaded = place_chunks(policy, {server(20, 80), server(60, 80)}, kChunks);
+	std::vector<int> idle = place_chunks(free_space, {server(20), server(60)}, kChunks);
+	EXPECT_NEAR(idle[0], loaded[0], kChunks / 100);
+	EXPECT_NEAR(idle[0], 2 * idle[1], kChunks / 100);
+}
@@ -62,6 +62,7 @@
 #  include "common/cfg.h"
 #  include "common/main.h"
 #  include "common/random.h"
+#  include "master/chunk_job_planner.h"
 #  include "master/matoclserv.h"
 #  include "master/matocsserv.h"
 #  include "master/topology.h"
@@ -202,6 +203,7 @@ static uint32_t ChunksLoopPeriod;
 static uint32_t ChunksLoopTimeout;
 static double   gAcceptableDifference;
 static bool     RebalancingBetweenLabels = false;
+static uint32_t gChunksLoopThreads;
 
 static uint32_t jobsnorepbefore;
 
@@ -236,8 +238,10 @@ public:
 	uint32_t version;
 	uint32_t lockid;
 	uint32_t lockedto;
+	uint32_t lastFile; // inode of the file the chunk was added to most recently, may be stale
 #ifndef METARESTORE
 	uint8_t inEndangeredQueue:1;
+	uint8_t inHealthChanges:1;
 	uint8_t needverincrease:1;
 	uint8_t interrupted:1;
 	uint8_t operation:3;
@@ -257,6 +261,12 @@ public:
 	static uint64_t allFullChunkCopies[CHUNK_MATRIX_SIZE][CHUNK_MATRIX_SIZE];
 	static std::deque<Chunk *> endangeredChunks;
 	static GoalCache goalCache;
+	/*! Numbers of references to chunks from files, by health of the chunks. */
+	static uint64_t fileReferences[3];
+	/*! Chunks which changed their health, consumed by incremental tests of files. */
+	static std::vector<uint64_t> healthChanges;
+	static bool healthChangesOverflow;
+	static constexpr std::size_t kMaxHealthChanges = 1000000;
 #endif
 
 	void clear() {
@@ -266,9 +276,11 @@ public:
 		version = 0;
 		lockid = 0;
 		lockedto = 0;
+		lastFile = 0;
 		checksum = 0;
 #ifndef METARESTORE
 		inEndangeredQueue = 0;
+		inHealthChanges = 0;
 		needverincrease = 1;
 		interrupted = 0;
 		operation = Chunk::NONE;
@@ -303,6 +315,10 @@ public:
 		goalCounters_.addFile(goal);
 #ifndef METARESTORE
 		updateStats(false);
+		// Health doesn't change, but the file which got an unhealthy chunk has to be tested
+		if (health() != ChunkHealth::kHealthy) {
+			recordHealthChange();
+		}
 #endif
 	}
 
@@ -358,16 +374,21 @@ public:
 	void freeStats() {
 		count--;
 		removeFromStats();
+		if (health() != ChunkHealth::kHealthy) {
+			recordHealthChange();
+		}
 	}
 
-	// Updates statistics of all chunks
-	void updateStats(bool remove_from_stats = true) {
-		int oldAllMissingParts = allMissingParts_;
-
-		if (remove_from_stats) {
-			removeFromStats();
+	// Health of the chunk in files, as seen by tests of files
+	ChunkHealth health() const {
+		if (allFullCopies_ == 0) {
+			return ChunkHealth::kUnavailable;
 		}
+		return allMissingParts_ > 0 ? ChunkHealth::kUnderGoal : ChunkHealth::kHealthy;
+	}
 
+	// Updates statistics of all chunks
+	void updateStats(bool remove_from_stats = true) {
 		Goal g = getGoal();
 
 		ChunkCopiesCalculator all(g);
@@ -381,11 +402,23 @@ public:
 
 		all.optimize();
 
-		allFullCopies_ = std::min(kMaxStatCount, all.getFullCopiesCount());
-		allAvailabilityState_ = all.getState();
-		allMissingParts_ = std::min(kMaxStatCount, all.countPartsToRecover());
-		allRedundantParts_ = std::min(kMaxStatCount, all.countPartsToRemove());
-		copiesInStats_ = std::min(kMaxStatCount, ChunkCopiesCalculator::getFullCopiesCount(g));
+		updateStats(ChunkJobPlanner::computeStats(g, all), remove_from_stats);
+	}
+
+	// Updates statistics of all chunks using statistics computed by ChunkJobPlanner
+	void updateStats(const ChunkJobPlanner::Stats &stats, bool remove_from_stats = true) {
+		int oldAllMissingParts = allMissingParts_;
+		ChunkHealth oldHealth = health();
+
+		if (remove_from_stats) {
+			removeFromStats();
+		}
+
+		allFullCopies_ = std::min(kMaxStatCount, stats.full_copies);
+		allAvailabilityState_ = stats.state;
+		allMissingParts_ = std::min(kMaxStatCount, stats.missing_parts);
+		allRedundantParts_ = std::min(kMaxStatCount, stats.redundant_parts);
+		copiesInStats_ = std::min(kMaxStatCount, stats.goal_full_copies);
 
 		/* Enqueue a chunk as endangered only if:
 		 * 1. Endangered chunks prioritization is on (limit > 0)
@@ -403,9 +436,33 @@ public:
 			endangeredChunks.push_back(this);
 		}
 
+		if (health() != oldHealth && fileCount() > 0) {
+			recordHealthChange();
+		}
+
 		addToStats();
 	}
 
+	bool hasSameGoal(const Chunk &other) const {
+		return CountersComparator()(goalCounters_, other.goalCounters_);
+	}
+
+	uint64_t goalSignature() const {
+		uint64_t signature = goalCounters_.size();
+		for (const auto &counter : goalCounters_) {
+			hashCombine(signature, counter.goal, counter.count);
+		}
+		return signature;
+	}
+
+#ifndef METARESTORE
+	// Signature of everything ChunkJobPlanner::analyze depends on
+	uint64_t planSignature() const {
+		return ChunkJobPlanner::signature(chunkid, version, operation, goalSignature(),
+		                                  parts.begin(), parts.end());
+	}
+#endif
+
 	bool isSafe() const {
 		return allAvailabilityState_ == ChunksAvailabilityState::kSafe;
 	}
@@ -459,6 +516,18 @@ private:
 		return static_cast<ChunksAvailabilityState::State>(allAvailabilityState_);
 	}
 
+	void recordHealthChange() {
+		if (inHealthChanges || chunkid == 0) {
+			return;
+		}
+		if (healthChanges.size() >= kMaxHealthChanges) {
+			healthChangesOverflow = true;
+			return;
+		}
+		inHealthChanges = 1;
+		healthChanges.push_back(chunkid);
+	}
+
 	void removeFromStats() {
 		int prev_goal = -1;
 		for (const auto& counter : goalCounters_) {
@@ -473,6 +542,7 @@ private:
 		uint8_t limitedGoal = std::min<uint8_t>(CHUNK_MATRIX_SIZE - 1, copiesInStats_);
 		uint8_t limitedAll = std::min<uint8_t>(CHUNK_MATRIX_SIZE - 1, allFullCopies_);
 		allFullChunkCopies[limitedGoal][limitedAll]--;
+		fileReferences[static_cast<int>(health())] -= fileCount();
 	}
 
 	void addToStats() {
@@ -489,6 +559,7 @@ private:
 		uint8_t limitedGoal = std::min<uint8_t>(CHUNK_MATRIX_SIZE - 1, copiesInStats_);
 		uint8_t limitedAll = std::min<uint8_t>(CHUNK_MATRIX_SIZE - 1, allFullCopies_);
 		allFullChunkCopies[limitedGoal][limitedAll]++;
+		fileReferences[static_cast<int>(health())] += fileCount();
 	}
 #endif
 };
@@ -503,6 +574,10 @@ ChunksAvailabilityState Chunk::allChunksAvailability;
 ChunksReplicationState Chunk::allChunksReplicationState;
 uint64_t Chunk::count;
 uint64_t Chunk::allFullChunkCopies[CHUNK_MATRIX_SIZE][CHUNK_MATRIX_SIZE];
+uint64_t Chunk::fileReferences[3];
+std::vector<uint64_t> Chunk::healthChanges;
+bool Chunk::healthChangesOverflow = false;
+constexpr std::size_t Chunk::kMaxHealthChanges;
 #endif
 
 #define CHUNK_BUCKET_SIZE 20000
@@ -868,6 +943,45 @@ void chunk_info(uint32_t *allchunks,uint32_t *allcopies,uint32_t *regularvalidco
 	}
 }
 
+void chunk_get_file_references(uint64_t &all, uint64_t &undergoal, uint64_t &unavailable) {
+	undergoal = Chunk::fileReferences[static_cast<int>(ChunkHealth::kUnderGoal)];
+	unavailable = Chunk::fileReferences[static_cast<int>(ChunkHealth::kUnavailable)];
+	all = Chunk::fileReferences[static_cast<int>(ChunkHealth::kHealthy)] + undergoal + unavailable;
+}
+
+bool chunk_take_health_changes(std::vector<uint64_t> &chunks) {
+	chunks.clear();
+	chunks.swap(Chunk::healthChanges);
+	for (uint64_t chunkid : chunks) {
+		Chunk *c = chunk_find(chunkid);
+		if (c) {
+			c->inHealthChanges = 0;
+		}
+	}
+	bool complete = !Chunk::healthChangesOverflow;
+	Chunk::healthChangesOverflow = false;
+	return complete;
+}
+
+int chunk_get_health(uint64_t chunkid, ChunkHealth &health, uint32_t &file_count) {
+	Chunk *c = chunk_find(chunkid);
+	if (c == NULL) {
+		return LIZARDFS_ERROR_NOCHUNK;
+	}
+	health = c->health();
+	file_count = c->fileCount();
+	return LIZARDFS_STATUS_OK;
+}
+
+int chunk_get_last_file(uint64_t chunkid, uint32_t &inode) {
+	Chunk *c = chunk_find(chunkid);
+	if (c == NULL) {
+		return LIZARDFS_ERROR_NOCHUNK;
+	}
+	inode = c->lastFile;
+	return LIZARDFS_STATUS_OK;
+}
+
 uint32_t chunk_get_missing_count(void) {
 	uint32_t res = 0;
 	for (uint8_t goal = GoalId::kMin; goal <= GoalId::kMax; ++goal) {
@@ -921,14 +1035,15 @@ static inline int chunk_delete_file_int(Chunk *c, uint8_t goal) {
 	return LIZARDFS_STATUS_OK;
 }
 
-/// updates chunk's goal after a file with goal `goal' has been added
-static inline int chunk_add_file_int(Chunk *c, uint8_t goal) {
+/// updates chunk's goal after a file `inode' with goal `goal' has been added
+static inline int chunk_add_file_int(Chunk *c, uint8_t goal, uint32_t inode) {
 	try {
 		c->addFileWithGoal(goal);
 	} catch (Exception& ex) {
 		lzfs_pretty_syslog(LOG_WARNING, "chunk_add_file_int: %s", ex.what());
 		return LIZARDFS_ERROR_CHUNKLOST;
 	}
+	c->lastFile = inode;
 	chunk_update_checksum(c);
 	return LIZARDFS_STATUS_OK;
 }
@@ -942,13 +1057,13 @@ int chunk_delete_file(uint64_t chunkid,uint8_t goal) {
 	return chunk_delete_file_int(c,goal);
 }
 
-int chunk_add_file(uint64_t chunkid,uint8_t goal) {
+int chunk_add_file(uint64_t chunkid,uint8_t goal,uint32_t inode) {
 	Chunk *c;
 	c = chunk_find(chunkid);
 	if (c==NULL) {
 		return LIZARDFS_ERROR_NOCHUNK;
 	}
-	return chunk_add_file_int(c,goal);
+	return chunk_add_file_int(c,goal,inode);
 }
 
 int chunk_can_unlock(uint64_t chunkid, uint32_t lockid) {
@@ -1034,7 +1149,7 @@ int chunk_get_partstomodify(uint64_t chunkid, int &recover, int &remove) {
 	return LIZARDFS_STATUS_OK;
 }
 
-uint8_t chunk_multi_modify(uint64_t ochunkid, uint32_t *lockid, uint8_t goal,
+uint8_t chunk_multi_modify(uint64_t ochunkid, uint32_t *lockid, uint8_t goal, uint32_t inode,
 		bool usedummylockid, bool quota_exceeded, uint8_t *opflag, uint64_t *nchunkid,
 		uint32_t min_server_version = 0) {
 	Chunk *c = NULL;
@@ -1064,7 +1179,7 @@ uint8_t chunk_multi_modify(uint64_t ochunkid, uint32_t *lockid, uint8_t goal,
 		c = chunk_new(gChunksMetadata->nextchunkid++, 1);
 		c->interrupted = 0;
 		c->operation = Chunk::CREATE;
-		chunk_add_file_int(c,goal);
+		chunk_add_file_int(c,goal,inode);
 		for (const auto &server_with_type : serversWithChunkTypes) {
 			c->parts.push_back(ChunkPart(matocsserv_get_csdb(server_with_type.first)->csid,
 			                             ChunkPart::BUSY, c->version, server_with_type.second));
@@ -1140,7 +1255,7 @@ uint8_t chunk_multi_modify(uint64_t ochunkid, uint32_t *lockid, uint8_t goal,
 			c->interrupted = 0;
 			c->operation = Chunk::DUPLICATE;
 			chunk_delete_file_int(oc,goal);
-			chunk_add_file_int(c,goal);
+			chunk_add_file_int(c,goal,inode);
 			for (const auto &old_part : oc->parts) {
 				if (old_part.is_valid()) {
 					c->parts.push_back(ChunkPart(old_part.csid, ChunkPart::BUSY, c->version, old_part.type));
@@ -1168,7 +1283,7 @@ uint8_t chunk_multi_modify(uint64_t ochunkid, uint32_t *lockid, uint8_t goal,
 }
 
 uint8_t chunk_multi_truncate(uint64_t ochunkid, uint32_t lockid, uint32_t length,
-		uint8_t goal, bool denyTruncatingParityParts, bool quota_exceeded, uint64_t *nchunkid) {
+		uint8_t goal, uint32_t inode, bool denyTruncatingParityParts, bool quota_exceeded, uint64_t *nchunkid) {
 	Chunk *oc, *c;
 
 	c=NULL;
@@ -1225,7 +1340,7 @@ uint8_t chunk_multi_truncate(uint64_t ochunkid, uint32_t lockid, uint32_t length
 		c->interrupted = 0;
 		c->operation = Chunk::DUPTRUNC;
 		chunk_delete_file_int(oc,goal);
-		chunk_add_file_int(c,goal);
+		chunk_add_file_int(c,goal,inode);
 		for (const auto &old_part : oc->parts) {
 			if (old_part.is_valid()) {
 				c->parts.push_back(ChunkPart(old_part.csid, ChunkPart::BUSY, c->version, old_part.type));
@@ -1246,11 +1361,11 @@ uint8_t chunk_multi_truncate(uint64_t ochunkid, uint32_t lockid, uint32_t length
 #endif // ! METARESTORE
 
 uint8_t chunk_apply_modification(uint32_t ts, uint64_t oldChunkId, uint32_t lockid, uint8_t goal,
-		bool doIncreaseVersion, uint64_t *newChunkId) {
+		uint32_t inode, bool doIncreaseVersion, uint64_t *newChunkId) {
 	Chunk *c;
 	if (oldChunkId == 0) { // new chunk
 		c = chunk_new(gChunksMetadata->nextchunkid++, 1);
-		chunk_add_file_int(c, goal);
+		chunk_add_file_int(c, goal, inode);
 	} else {
 		Chunk *oc = chunk_find(oldChunkId);
 		if (oc == NULL) {
@@ -1268,7 +1383,7 @@ uint8_t chunk_apply_modification(uint32_t ts, uint64_t oldChunkId, uint32_t lock
 		} else {
 			c = chunk_new(gChunksMetadata->nextchunkid++, 1);
 			chunk_delete_file_int(oc, goal);
-			chunk_add_file_int(c, goal);
+			chunk_add_file_int(c, goal, inode);
 		}
 	}
 	c->lockedto = ts + LOCKTIMEOUT;
@@ -1496,6 +1611,10 @@ int chunk_getversionandlocations(uint64_t chunkid, uint32_t currentIp, uint32_t&
 }
 
 void chunk_server_has_chunk(matocsserventry *ptr, uint64_t chunkid, uint32_t version, ChunkPartType chunkType) {
+	chunk_server_has_chunk(matocsserv_get_csdb(ptr)->csid, chunkid, version, chunkType);
+}
+
+void chunk_server_has_chunk(uint16_t server_csid, uint64_t chunkid, uint32_t version, ChunkPartType chunkType) {
 	Chunk *c;
 	const uint32_t new_version = version & 0x7FFFFFFF;
 	const bool todel = version & 0x80000000;
@@ -1510,7 +1629,6 @@ void chunk_server_has_chunk(matocsserventry *ptr, uint64_t chunkid, uint32_t ver
 		c->lockid = 0;
 		chunk_update_checksum(c);
 	}
-	auto server_csid = matocsserv_get_csdb(ptr)->csid;
 	for (auto &part : c->parts) {
 		if (part.csid == server_csid && part.type == chunkType) {
 			// This server already notified us about its copy.
@@ -1581,11 +1699,14 @@ void chunk_damaged(matocsserventry *ptr, uint64_t chunkid, ChunkPartType chunk_t
 }
 
 void chunk_lost(matocsserventry *ptr,uint64_t chunkid, ChunkPartType chunk_type) {
+	chunk_lost(matocsserv_get_csdb(ptr)->csid, chunkid, chunk_type);
+}
+
+void chunk_lost(uint16_t server_csid, uint64_t chunkid, ChunkPartType chunk_type) {
 	Chunk *c = chunk_find(chunkid);
 	if (c == nullptr) {
 		return;
 	}
-	auto server_csid = matocsserv_get_csdb(ptr)->csid;
 	auto it = std::remove_if(c->parts.begin(), c->parts.end(), [server_csid, chunk_type](const ChunkPart &part) {
 		return part.csid == server_csid && part.type == chunk_type;
 	});
@@ -1811,6 +1932,11 @@ public:
 	void doChunkJobs(Chunk *c, uint16_t serverCount);
 	void mainLoop();
 
+	/// Duration (in seconds) of the last full pass over all chunks.
+	uint32_t lastLoopDuration() const {
+		return lastLoopDuration_;
+	}
+
 private:
 	typedef std::vector<ServerWithUsage> ServersWithUsage;
 
@@ -1828,6 +1954,10 @@ private:
 
 	bool deleteUnusedChunks();
 
+	void configurePlanner();
+	void preparePlans();
+	void processChunk(Chunk *c, uint16_t serverCount);
+
 	uint32_t getMinChunkserverVersion(Chunk *c, ChunkPartType type);
 	bool tryReplication(Chunk *c, ChunkPartType type, matocsserventry *destinationServer);
 
@@ -1852,13 +1982,26 @@ private:
 	std::map<MediaLabel, ServersWithUsage> labeledSortedServers_;
 
 	MainLoopStack stack_;
+
+	/// Snapshot of chunks processed in the current step and their plans.
+	ChunkJobPlanner::Batch plans_;
+
+	/// Analyzes chunks on worker threads (null if background planning is disabled).
+	std::unique_ptr<ChunkJobPlanner> planner_;
+
+	uint32_t lastLoopDuration_;
+	uint32_t plannedChunks_;
+	uint32_t evaluatedChunks_;
 };
 
 ChunkWorker::ChunkWorker()
 		: deleteNotDone_(0),
 		  deleteDone_(0),
 		  prevToDeleteCount_(0),
-		  deleteLoopCount_(0) {
+		  deleteLoopCount_(0),
+		  lastLoopDuration_(0),
+		  plannedChunks_(0),
+		  evaluatedChunks_(0) {
 	memset(&inforec_,0,sizeof(loop_info));
 	stack_.current_bucket = 0;
 }
@@ -1894,6 +2037,16 @@ void ChunkWorker::doEveryLoopTasks() {
 	memset(&inforec_,0,sizeof(inforec_));
 	chunksinfo_loopstart = chunksinfo_loopend;
 	chunksinfo_loopend = eventloop_time();
+	if (chunksinfo_loopstart > 0) {
+		lastLoopDuration_ = chunksinfo_loopend - chunksinfo_loopstart;
+		if (planner_) {
+			lzfs_pretty_syslog(LOG_INFO, "chunks loop: full pass took %" PRIu32 "s, %" PRIu32
+			                   " chunks analyzed in background, %" PRIu32 " evaluated in main loop",
+			                   lastLoopDuration_, plannedChunks_, evaluatedChunks_);
+		}
+	}
+	plannedChunks_ = 0;
+	evaluatedChunks_ = 0;
 }
 
 void ChunkWorker::doEverySecondTasks() {
@@ -2533,6 +2686,92 @@ bool ChunkWorker::deleteUnusedChunks() {
 	return true;
 }
 
+void ChunkWorker::configurePlanner() {
+	uint32_t current_threads = planner_ ? planner_->threadCount() : 0;
+	if (current_threads == gChunksLoopThreads) {
+		return;
+	}
+	planner_.reset();
+	plans_ = ChunkJobPlanner::Batch();
+	if (gChunksLoopThreads > 0) {
+		planner_.reset(new ChunkJobPlanner(gChunksLoopThreads));
+	}
+}
+
+/*! \brief Takes a snapshot of chunks which will be processed in the current step.
+ *
+ * Buckets are visited in the same order and with the same limits as in mainLoop.
+ */
+void ChunkWorker::preparePlans() {
+	plans_.clear();
+	plans_.min_usage = sortedServers_.empty() ? 0.0 : sortedServers_.front().disk_usage;
+	plans_.max_usage = sortedServers_.empty() ? 0.0 : sortedServers_.back().disk_usage;
+	plans_.acceptable_difference = gAcceptableDifference;
+	plans_.avoid_same_ip = gAvoidSameIpChunkservers;
+
+	uint32_t bucket = stack_.current_bucket;
+	uint32_t goal = 0;
+	uint64_t goal_signature = 0;
+	Chunk *prev = nullptr;
+	for (uint32_t step = 0; step < HashSteps && plans_.chunks.size() < HashCPS; ++step) {
+		for (Chunk *c = gChunksMetadata->chunkhash[bucket]; c; c = c->next) {
+			if (!prev || !c->hasSameGoal(*prev)) {
+				goal = plans_.addGoal(c->getGoal());
+				goal_signature = c->goalSignature();
+			}
+			prev = c;
+
+			ChunkJobPlanner::ChunkState chunk;
+			chunk.chunkid = c->chunkid;
+			chunk.signature = 0; // computed by the planner
+			chunk.goal_signature = goal_signature;
+			chunk.version = c->version;
+			chunk.operation = c->operation;
+			chunk.goal = goal;
+			chunk.file_count = c->fileCount();
+			chunk.parts_begin = plans_.parts.size();
+			for (const auto &part : c->parts) {
+				const auto *server_entry = csdb_find(part.csid);
+				if (server_entry->eptr == nullptr) {
+					// Disconnected copy, it will be removed by doChunkJobs
+					continue;
+				}
+				ChunkJobPlanner::PartState part_state;
+				part_state.version = part.version;
+				part_state.type = part.type;
+				part_state.csid = part.csid;
+				part_state.state = part.state;
+				part_state.label = server_entry->label;
+				part_state.ip = matocsserv_get_servip(server_entry->eptr);
+				part_state.usage = matocsserv_get_usage(server_entry->eptr);
+				part_state.valid = part.is_valid();
+				part_state.busy = part.is_busy();
+				part_state.todel = part.is_todel();
+				plans_.parts.push_back(part_state);
+			}
+			chunk.parts_end = plans_.parts.size();
+			plans_.chunks.push_back(chunk);
+		}
+		bucket = (bucket + 123) % HASHSIZE;
+	}
+}
+
+void ChunkWorker::processChunk(Chunk *c, uint16_t serverCount) {
+	if (planner_) {
+		chunk_handle_disconnected_copies(c);
+		const ChunkJobPlanner::Plan *plan = plans_.find(c->chunkid, c->planSignature());
+		if (plan) {
+			++plannedChunks_;
+			if (!plan->needs_jobs || serverCount == 0) {
+				c->updateStats(plan->stats);
+				return;
+			}
+		}
+		++evaluatedChunks_;
+	}
+	doChunkJobs(c, serverCount);
+}
+
 void ChunkWorker::mainLoop() {
 	Chunk *c;
 
@@ -2556,6 +2795,7 @@ void ChunkWorker::mainLoop() {
 		}
 
 		doEverySecondTasks();
+		configurePlanner();
 
 		if (jobsnorepbefore < eventloop_time()) {
 			stack_.endangered_to_serve = gEndangeredChunksServingLimit;
@@ -2577,6 +2817,17 @@ void ChunkWorker::mainLoop() {
 			}
 		}
 
+		// Chunks are analyzed on worker threads while the main loop serves other requests,
+		// only chunks which need some job are evaluated again in doChunkJobs.
+		if (planner_) {
+			preparePlans();
+			planner_->start(plans_);
+			while (planner_->busy()) {
+				yield;
+			}
+			stack_.watchdog.start();
+		}
+
 		while (stack_.buckets_done_count < HashSteps &&
 		       stack_.chunks_done_count < HashCPS) {
 			if (stack_.current_bucket == 0) {
@@ -2602,7 +2853,7 @@ void ChunkWorker::mainLoop() {
 
 			stack_.node = gChunksMetadata->chunkhash[stack_.current_bucket];
 			while (stack_.node) {
-				doChunkJobs(stack_.node, stack_.usable_server_count);
+				processChunk(stack_.node, stack_.usable_server_count);
 				++stack_.chunks_done_count;
 				stack_.node = stack_.node->next;
 
@@ -2645,6 +2896,10 @@ void chunk_jobs_process_bit(void) {
 	}
 }
 
+uint32_t chunk_get_loop_duration(void) {
+	return gChunkWorker ? gChunkWorker->lastLoopDuration() : 0;
+}
+
 #endif
 
 constexpr uint32_t kSerializedChunkSizeNoLockId = 16;
@@ -2863,6 +3118,7 @@ void chunk_reload(void) {
 	gEndangeredChunksMaxCapacity = cfg_get("ENDANGERED_CHUNKS_MAX_CAPACITY", static_cast<uint64_t>(1024*1024UL));
 	gAcceptableDifference = cfg_ranged_get("ACCEPTABLE_DIFFERENCE",0.1, 0.001, 10.0);
 	RebalancingBetweenLabels = cfg_getuint32("CHUNKS_REBALANCING_BETWEEN_LABELS", 0) == 1;
+	gChunksLoopThreads = cfg_get_maxvalue<uint32_t>("CHUNKS_LOOP_THREADS", 0, 64);
 }
 #endif
 
@@ -2943,6 +3199,7 @@ int chunk_strinit(void) {
 	gEndangeredChunksMaxCapacity = cfg_get("ENDANGERED_CHUNKS_MAX_CAPACITY", static_cast<uint64_t>(1024*1024UL));
 	gAcceptableDifference = cfg_ranged_get("ACCEPTABLE_DIFFERENCE", 0.1, 0.001, 10.0);
 	RebalancingBetweenLabels = cfg_getuint32("CHUNKS_REBALANCING_BETWEEN_LABELS", 0) == 1;
+	gChunksLoopThreads = cfg_get_maxvalue<uint32_t>("CHUNKS_LOOP_THREADS", 0, 64);
 	eventloop_reloadregister(chunk_reload);
 	metadataserver::registerFunctionCalledOnPromotion(chunk_become_master);
 	eventloop_eachloopregister(chunk_clean_zombie_servers_a_bit);
@@ -22,6 +22,7 @@
 
 #include <inttypes.h>
 #include <stdio.h>
+#include <vector>
 
 #include "common/chunk_part_type.h"
 #include "common/chunk_type_with_address.h"
@@ -32,16 +33,23 @@
 
 struct matocsserventry;
 
+/// Health of a chunk, as seen by tests of files.
+enum class ChunkHealth : uint8_t {
+	kHealthy,
+	kUnderGoal,   ///< chunk has full copies, but some parts are missing
+	kUnavailable  ///< chunk has no full copy
+};
+
 extern bool gAvoidSameIpChunkservers;
 
 int chunk_increase_version(uint64_t chunkid);
 int chunk_set_version(uint64_t chunkid,uint32_t version);
 int chunk_change_file(uint64_t chunkid,uint8_t prevgoal,uint8_t newgoal);
 int chunk_delete_file(uint64_t chunkid,uint8_t goal);
-int chunk_add_file(uint64_t chunkid,uint8_t goal);
+int chunk_add_file(uint64_t chunkid,uint8_t goal,uint32_t inode);
 int chunk_unlock(uint64_t chunkid);
 uint8_t chunk_apply_modification(uint32_t ts, uint64_t oldChunkId, uint32_t lockid, uint8_t goal,
-		bool doIncreaseVersion, uint64_t *newChunkId);
+		uint32_t inode, bool doIncreaseVersion, uint64_t *newChunkId);
 
 // Tries to set next chunk id to a passed value, returns status
 uint8_t chunk_set_next_chunkid(uint64_t nextChunkIdToBeSet);
@@ -49,13 +57,15 @@ uint8_t chunk_set_next_chunkid(uint64_t nextChunkIdToBeSet);
 #ifdef METARESTORE
 void chunk_dump(void);
 #else
-uint8_t chunk_multi_modify(uint64_t ochunkid, uint32_t *lockid, uint8_t goal,
+uint8_t chunk_multi_modify(uint64_t ochunkid, uint32_t *lockid, uint8_t goal, uint32_t inode,
 		bool usedummylockid, bool quota_exceeded, uint8_t *opflag, uint64_t *nchunkid,
 		uint32_t min_server_version);
 uint8_t chunk_multi_truncate(uint64_t ochunkid, uint32_t lockid, uint32_t length,
-		uint8_t goal, bool denyTruncatingParityParts, bool quota_exceeded, uint64_t *nchunkid);
+		uint8_t goal, uint32_t inode, bool denyTruncatingParityParts, bool quota_exceeded, uint64_t *nchunkid);
 void chunk_stats(uint32_t *del,uint32_t *repl);
 void chunk_store_info(uint8_t *buff);
+/// Returns duration (in seconds) of the last full pass of chunk loop over all chunks.
+uint32_t chunk_get_loop_duration(void);
 uint32_t chunk_get_missing_count(void);
 void chunk_store_chunkcounters(uint8_t *buff,uint8_t matrixid);
 uint32_t chunk_count(void);
@@ -67,6 +77,18 @@ void chunk_info(uint32_t *allchunks,uint32_t *allcopies,uint32_t *regcopies);
 bool chunk_has_only_invalid_copies(uint64_t chunkid);
 
 int chunk_get_fullcopies(uint64_t chunkid,uint8_t *vcopies);
+int chunk_get_health(uint64_t chunkid, ChunkHealth &health, uint32_t &file_count);
+
+/// Returns inode of the file to which the chunk was added most recently.
+/// The chunk may have been removed from that file since then.
+int chunk_get_last_file(uint64_t chunkid, uint32_t &inode);
+
+/// Returns numbers of references to chunks from files, maintained when chunks change.
+void chunk_get_file_references(uint64_t &all, uint64_t &undergoal, uint64_t &unavailable);
+
+/// Moves ids of chunks whose health changed since the last call to 'chunks'.
+/// Returns false if some changes weren't recorded, because there were too many of them.
+bool chunk_take_health_changes(std::vector<uint64_t> &chunks);
 int chunk_get_partstomodify(uint64_t chunkid, int &recover, int &remove);
 int chunk_repair(uint8_t goal,uint64_t ochunkid,uint32_t *nversion, uint8_t correct_only);
 
@@ -77,6 +99,9 @@ int chunk_getversionandlocations(uint64_t chunkid, uint32_t currentIp, uint32_t&
 void chunk_server_has_chunk(matocsserventry *ptr, uint64_t chunkid, uint32_t version, ChunkPartType chunkType);
 void chunk_damaged(matocsserventry *ptr, uint64_t chunkid, ChunkPartType chunk_type);
 void chunk_lost(matocsserventry *ptr, uint64_t chunkid, ChunkPartType chunk_type);
+/// Variants of the functions above for a chunkserver given by its id in the chunkserver database.
+void chunk_server_has_chunk(uint16_t csid, uint64_t chunkid, uint32_t version, ChunkPartType chunkType);
+void chunk_lost(uint16_t csid, uint64_t chunkid, ChunkPartType chunk_type);
 void chunk_server_disconnected(matocsserventry *ptr, const MediaLabel &label);
 void chunk_server_unlabelled_connected();
 void chunk_server_label_changed(const MediaLabel &previousLabel, const MediaLabel &newLabel);
@@ -0,0 +1,144 @@
+/*
+   Copyright 2017 Skytechnology sp. z o.o.
+
+   This file is part of LizardFS.
+
+   LizardFS is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, version 3.
+
+   LizardFS is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with LizardFS. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "common/platform.h"
+#include "master/chunks.h"
+
+#include <algorithm>
+#include <map>
+#include <random>
+#include <set>
+#include <gtest/gtest.h>
+
+#include "master/chunkserver_db.h"
+#include "master/filesystem_metadata.h"
+#include "master/goal_config_loader.h"
+#include "unittests/chunk_type_constants.h"
+
+namespace {
+
+const uint8_t kGoal = 1;
+const int kServers = 4;
+
+// Chunk as the test expects it to be
+struct ChunkModel {
+	std::set<uint16_t> servers;
+	uint32_t files;
+	uint32_t last_file;
+	ChunkHealth taken_health; // health when changes were taken last time
+	bool added_unhealthy;     // a file got the chunk while it wasn't healthy since then
+
+	ChunkHealth health() const {
+		if (servers.empty()) {
+			return ChunkHealth::kUnavailable;
+		}
+		return servers.size() < 2 ? ChunkHealth::kUnderGoal : ChunkHealth::kHealthy;
+	}
+};
+
+csdbentry gServers[kServers + 1];
+
+} // anonymous namespace
+
+// Applies random changes of chunks and checks what is maintained incrementally
+// against a recount of all chunks
+TEST(ChunksTests, HealthOfFilesMatchesRecount) {
+	gGoalDefinitions[kGoal] = goal_config::parseLine("1 two: _ _").second;
+	for (uint16_t csid = 1; csid <= kServers; ++csid) {
+		gServers[csid].csid = csid;
+		// never dereferenced, chunks only check that their servers are connected
+		gServers[csid].eptr = reinterpret_cast<matocsserventry *>(&gServers[csid]);
+		gIdToCSEntry[csid] = &gServers[csid];
+	}
+	chunk_strinit();
+
+	std::mt19937 generator(1234);
+	std::map<uint64_t, ChunkModel> chunks;
+	std::vector<uint64_t> ids;
+	std::vector<uint64_t> changes;
+	uint64_t expected_changes = 0;
+	for (int step = 1; step <= 20000; ++step) {
+		int operation = std::uniform_int_distribution<int>(0, 9)(generator);
+		uint32_t inode = std::uniform_int_distribution<uint32_t>(1, 1000)(generator);
+		if (ids.size() < 200 && (ids.empty() || operation == 0)) {
+			uint64_t chunkid;
+			ASSERT_EQ(LIZARDFS_STATUS_OK,
+			          chunk_apply_modification(step, 0, 0, kGoal, inode, false, &chunkid));
+			ids.push_back(chunkid);
+			chunks[chunkid] = ChunkModel{{}, 1, inode, ChunkHealth::kUnavailable, false};
+			continue;
+		}
+		uint64_t chunkid = ids[std::uniform_int_distribution<std::size_t>(
+		        0, ids.size() - 1)(generator)];
+		ChunkModel &model = chunks[chunkid];
+		uint16_t csid = std::uniform_int_distribution<uint16_t>(1, kServers)(generator);
+		if (operation <= 2) {
+			ASSERT_EQ(LIZARDFS_STATUS_OK, chunk_add_file(chunkid, kGoal, inode));
+			model.files++;
+			model.last_file = inode;
+			model.added_unhealthy |= model.health() != ChunkHealth::kHealthy;
+		} else if (operation <= 4) {
+			// Keeping one file, as changes of chunks without files aren't recorded
+			if (model.files > 1) {
+				ASSERT_EQ(LIZARDFS_STATUS_OK, chunk_delete_file(chunkid, kGoal));
+				model.files--;
+			}
+		} else if (operation <= 7) {
+			chunk_server_has_chunk(csid, chunkid, 1, standard);
+			model.servers.insert(csid);
+		} else {
+			chunk_lost(csid, chunkid, standard);
+			model.servers.erase(csid);
+		}
+
+		if (step % 100 != 0) {
+			continue;
+		}
+		uint64_t references[3] = {0, 0, 0};
+		for (auto &id_and_model : chunks) {
+			ChunkHealth health;
+			uint32_t file_count, last_file;
+			ASSERT_EQ(LIZARDFS_STATUS_OK, chunk_get_health(id_and_model.first, health, file_count));
+			ASSERT_EQ(LIZARDFS_STATUS_OK, chunk_get_last_file(id_and_model.first, last_file));
+			EXPECT_EQ(id_and_model.second.health(), health);
+			EXPECT_EQ(id_and_model.second.files, file_count);
+			EXPECT_EQ(id_and_model.second.last_file, last_file);
+			references[static_cast<int>(id_and_model.second.health())] += file_count;
+		}
+		uint64_t all, undergoal, unavailable;
+		chunk_get_file_references(all, undergoal, unavailable);
+		EXPECT_EQ(references[0] + references[1] + references[2], all);
+		EXPECT_EQ(references[static_cast<int>(ChunkHealth::kUnderGoal)], undergoal);
+		EXPECT_EQ(references[static_cast<int>(ChunkHealth::kUnavailable)], unavailable);
+
+		ASSERT_TRUE(chunk_take_health_changes(changes));
+		std::sort(changes.begin(), changes.end());
+		for (auto &id_and_model : chunks) {
+			ChunkModel &changed = id_and_model.second;
+			if (changed.health() != changed.taken_health || changed.added_unhealthy) {
+				expected_changes++;
+				EXPECT_TRUE(std::binary_search(changes.begin(), changes.end(),
+				                               id_and_model.first))
+				        << "chunk " << id_and_model.first << " at step " << step;
+			}
+			changed.taken_health = changed.health();
+			changed.added_unhealthy = false;
+		}
+	}
+	EXPECT_LT(1000U, expected_changes);
+}
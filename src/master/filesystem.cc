@@ -64,6 +64,8 @@ std::map<int, Goal> gGoalDefinitions;
 // Number of changelog file versions
 uint32_t gStoredPreviousBackMetaCopies;
 
+uint32_t gMetadataCompressionLevel = 0;
+
 // Checksum validation
 bool gDisableChecksumVerification = false;
 
@@ -158,14 +160,23 @@ void fs_disable_metadata_dump_on_exit() {
 #else
 void fs_storeall(const char *fname) {
 	FILE *fd;
+	bool stored = true;
 	fd = fopen(fname,"w");
 	if (fd==NULL) {
 		lzfs_pretty_syslog(LOG_ERR, "can't open metadata file");
 		return;
 	}
+#ifdef LIZARDFS_HAVE_METADATA_COMPRESSION
+	if (gMetadataCompressionLevel > 0) {
+		stored = fs_store_compressed_fd(fd, gMetadataCompressionLevel, fname);
+	} else {
+		fs_store_fd(fd);
+	}
+#else
 	fs_store_fd(fd);
+#endif
 
-	if (ferror(fd)!=0) {
+	if (!stored || ferror(fd)!=0) {
 		lzfs_pretty_syslog(LOG_ERR, "can't write metadata");
 	} else if (fflush(fd) == EOF) {
 		lzfs_pretty_syslog(LOG_ERR, "can't fflush metadata");
@@ -302,6 +313,14 @@ static void fs_read_config_file() {
 			"BACK_META_KEEP_PREVIOUS",
 			kDefaultStoredPreviousBackMetaCopies,
 			kMaxStoredPreviousBackMetaCopies);
+	gMetadataCompressionLevel = cfg_get_maxvalue(
+			"METADATA_DUMP_COMPRESSION_LEVEL", 0U, kMaxMetadataCompressionLevel);
+#ifndef LIZARDFS_HAVE_METADATA_COMPRESSION
+	if (gMetadataCompressionLevel > 0) {
+		lzfs_pretty_syslog(LOG_WARNING, "METADATA_DUMP_COMPRESSION_LEVEL is set, but compression"
+				" of metadata is not supported in this build");
+	}
+#endif
 
 	ChecksumUpdater::setPeriod(cfg_getint32("METADATA_CHECKSUM_INTERVAL", 50));
 	gChecksumBackgroundUpdater.setSpeedLimit(
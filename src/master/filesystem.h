@@ -194,6 +194,11 @@ const uint32_t kMaxStoredPreviousBackMetaCopies = 99;
 
 extern uint32_t gStoredPreviousBackMetaCopies;
 
+// Compression level of metadata dumps, 0 means no compression
+const uint32_t kMaxMetadataCompressionLevel = 9;
+
+extern uint32_t gMetadataCompressionLevel;
+
 #ifdef METARESTORE
 
 void fs_dump(void);
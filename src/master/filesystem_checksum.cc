@@ -127,6 +127,9 @@ uint64_t fs_checksum(ChecksumMode mode) {
 	hashCombine(checksum, gMetadata->xattrChecksum);
 	hashCombine(checksum, gMetadata->quota_checksum);
 	hashCombine(checksum, chunk_checksum(mode));
+	if (!gMetadata->lazy_snapshots.empty()) {
+		hashCombine(checksum, gMetadata->lazy_snapshots.checksum());
+	}
 	return checksum;
 }
 
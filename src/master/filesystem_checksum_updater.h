@@ -50,6 +50,7 @@ public:
 
 protected:
 	static void writeToChangelog(uint32_t ts) {
+		fs_changelog_flush(); // checksum has to include deferred entries
 		lastEntry_ = gMetadata->metaversion;
 		if (metadataserver::isMaster() && !gChecksumBackgroundUpdater.inProgress()) {
 			std::string versionString = lizardfsVersionToString(LIZARDFS_VERSHEX);
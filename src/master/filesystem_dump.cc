@@ -164,16 +164,14 @@ void fs_dumpfree() {
 }
 
 void xattr_dump() {
-	uint32_t i;
-	xattr_data_entry *xa;
-
-	for (i = 0; i < XATTR_DATA_HASH_SIZE; i++) {
-		for (xa = gMetadata->xattr_data_hash[i]; xa; xa = xa->next) {
-			printf("X|i:%10" PRIu32 "|n:%s|v:%s\n", xa->inode,
-			       fsnodes_escape_name(std::string((char*)xa->attrname, xa->anleng)).c_str(),
-			       fsnodes_escape_name(std::string((char*)xa->attrvalue, xa->avleng)).c_str());
-		}
-	}
+	const XattrStorage &storage = gMetadata->xattr_storage;
+	storage.forEach([&storage](const XattrStorage::Entry &entry) {
+		printf("X|i:%10" PRIu32 "|n:%s|v:%s\n", entry.inode,
+		       fsnodes_escape_name(std::string((const char *)storage.name(entry),
+		                                       storage.nameLength(entry))).c_str(),
+		       fsnodes_escape_name(std::string((const char *)storage.value(entry),
+		                                       storage.valueLength(entry))).c_str());
+	});
 }
 
 void fs_dump(void) {
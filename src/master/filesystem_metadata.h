@@ -24,11 +24,13 @@
 #include <map>
 #include <unordered_map>
 
+#include "common/paged_id_table.h"
 #include "common/tape_copies.h"
 #include "common/special_inode_defs.h"
 #include "master/acl_storage.h"
 #include "master/chunks.h"
 #include "master/id_pool_detainer.h"
+#include "master/lazy_snapshot_registry.h"
 #include "master/filesystem_checksum_background_updater.h"
 #include "master/filesystem_freenode.h"
 #include "master/filesystem_node_types.h"
@@ -44,17 +46,18 @@
 struct FilesystemMetadata {
 public:
 	std::unordered_map<uint32_t, TapeCopies> tapeCopies;
-	xattr_inode_entry *xattr_inode_hash[XATTR_INODE_HASH_SIZE];
-	xattr_data_entry *xattr_data_hash[XATTR_DATA_HASH_SIZE];
+	XattrStorage xattr_storage;
 	IdPoolDetainer<uint32_t, uint32_t> inode_pool;
 	AclStorage acl_storage;
 	TrashPathContainer trash;
 	ReservedPathContainer reserved;
 	FSNodeDirectory *root;
 	FSNode *nodehash[NODEHASHSIZE];
+	PagedIdTable<FSNode> node_table; /*!< Used for lookups by id, nodehash is used for iteration. */
 	TaskManager task_manager;
 	FileLocks flock_locks;
 	FileLocks posix_locks;
+	LazySnapshotRegistry lazy_snapshots;
 
 	uint32_t maxnodeid;
 	uint32_t nextsessionid;
@@ -75,8 +78,7 @@ public:
 
 	FilesystemMetadata()
 	    : tapeCopies{},
-	      xattr_inode_hash{},
-	      xattr_data_hash{},
+	      xattr_storage{},
 	      inode_pool{MFS_INODE_REUSE_DELAY, 12,
 	                 MAX_REGULAR_INODE, MAX_REGULAR_INODE,
 	                 32 * 8 * 1024, 8 * 1024, 10},
@@ -84,9 +86,11 @@ public:
 	      reserved{},
 	      root{},
 	      nodehash{},
+	      node_table{},
 	      task_manager{},
 	      flock_locks{},
 	      posix_locks{},
+	      lazy_snapshots{},
 	      maxnodeid{},
 	      nextsessionid{},
 	      nodes{},
@@ -104,16 +108,6 @@ public:
 	}
 
 	~FilesystemMetadata() {
-		// Free memory allocated in xattr_inode_hash hashmap
-		for (uint32_t i = 0; i < XATTR_INODE_HASH_SIZE; ++i) {
-			freeListConnectedUsingNext(xattr_inode_hash[i]);
-		}
-
-		// Free memory allocated in xattr_data_hash hashmap
-		for (uint32_t i = 0; i < XATTR_DATA_HASH_SIZE; ++i) {
-			deleteListConnectedUsingNext(xattr_data_hash[i]);
-		}
-
 		// Free memory allocated in nodehash hashmap
 		for (uint32_t i = 0; i < NODEHASHSIZE; ++i) {
 			FSNode *node = nodehash[i];
@@ -125,28 +119,6 @@ public:
 		}
 	}
 
-private:
-	// Frees a C-style list with elements connected using e->next pointer and allocated using
-	// malloc
-	template <typename T>
-	void freeListConnectedUsingNext(T *&list) {
-		while (list != nullptr) {
-			T *next = list->next;
-			free(list);
-			list = next;
-		}
-	}
-
-	// Frees a C-style list with elements connected using e->next pointer and allocated using
-	// new
-	template <typename T>
-	void deleteListConnectedUsingNext(T *&list) {
-		while (list != nullptr) {
-			T *next = list->next;
-			delete list;
-			list = next;
-		}
-	}
 };
 
 extern FilesystemMetadata *gMetadata;
@@ -27,6 +27,7 @@
 
 #include "common/attributes.h"
 #include "common/massert.h"
+#include "common/slab_allocator.h"
 #include "common/slice_traits.h"
 #include "master/chunks.h"
 #include "master/datacachemgr.h"
@@ -36,6 +37,7 @@
 #include "master/filesystem_operations.h"
 #include "master/filesystem_periodic.h"
 #include "master/filesystem_quota.h"
+#include "master/filesystem_snapshot.h"
 #include "master/fs_context.h"
 
 #ifndef NDEBUG
@@ -47,22 +49,39 @@
 #define MAXFNAMELENG 255
 
 
+namespace {
+/*! \brief Nodes of each type are allocated from a separate arena.
+ *
+ * There are hundreds of millions of nodes in big installations, so saving malloc
+ * overhead and keeping nodes close to each other in memory matters.
+ */
+struct FSNodeArenas {
+	SlabAllocator<FSNodeFile> files;
+	SlabAllocator<FSNodeDirectory> directories;
+	SlabAllocator<FSNodeSymlink> symlinks;
+	SlabAllocator<FSNodeDevice> devices;
+	SlabAllocator<FSNode> others;
+};
+} // anonymous namespace
+
+static FSNodeArenas gFSNodeArenas;
+
 FSNode *FSNode::create(uint8_t type) {
 	switch (type) {
 	case kFile:
 	case kTrash:
 	case kReserved:
-		return new FSNodeFile(type);
+		return gFSNodeArenas.files.create(type);
 	case kDirectory:
-		return new FSNodeDirectory();
+		return gFSNodeArenas.directories.create();
 	case kSymlink:
-		return new FSNodeSymlink();
+		return gFSNodeArenas.symlinks.create();
 	case kFifo:
 	case kSocket:
-		return new FSNode(type);
+		return gFSNodeArenas.others.create(type);
 	case kBlockDev:
 	case kCharDev:
-		return new FSNodeDevice(type);
+		return gFSNodeArenas.devices.create(type);
 	default:
 		assert(!"invalid node type");
 	}
@@ -74,27 +93,33 @@ void FSNode::destroy(FSNode *node) {
 	case kFile:
 	case kTrash:
 	case kReserved:
-		delete static_cast<FSNodeFile *>(node);
+		gFSNodeArenas.files.destroy(static_cast<FSNodeFile *>(node));
 		break;
 	case kDirectory:
-		delete static_cast<FSNodeDirectory *>(node);
+		gFSNodeArenas.directories.destroy(static_cast<FSNodeDirectory *>(node));
 		break;
 	case kSymlink:
-		delete static_cast<FSNodeSymlink *>(node);
+		gFSNodeArenas.symlinks.destroy(static_cast<FSNodeSymlink *>(node));
 		break;
 	case kFifo:
 	case kSocket:
-		delete node;
+		gFSNodeArenas.others.destroy(node);
 		break;
 	case kBlockDev:
 	case kCharDev:
-		delete static_cast<FSNodeDevice *>(node);
+		gFSNodeArenas.devices.destroy(static_cast<FSNodeDevice *>(node));
 		break;
 	default:
 		assert(!"invalid node type");
 	}
 }
 
+uint64_t fsnodes_memory_usage() {
+	return gFSNodeArenas.files.memoryUsage() + gFSNodeArenas.directories.memoryUsage() +
+	       gFSNodeArenas.symlinks.memoryUsage() + gFSNodeArenas.devices.memoryUsage() +
+	       gFSNodeArenas.others.memoryUsage() + gMetadata->node_table.memoryUsage();
+}
+
 // number of blocks in the last chunk before EOF
 static uint32_t last_chunk_blocks(FSNodeFile *node) {
 	const uint64_t last_byte = node->length - 1;
@@ -584,6 +609,7 @@ FSNode *fsnodes_create_node(uint32_t ts, FSNodeDirectory *parent, const HString
 	uint32_t nodepos = NODEHASHPOS(node->id);
 	node->next = gMetadata->nodehash[nodepos];
 	gMetadata->nodehash[nodepos] = node;
+	gMetadata->node_table.insert(node->id, node);
 	fsnodes_update_checksum(node);
 	fsnodes_link(ts, parent, node, name);
 	fsnodes_quota_update(node, {{QuotaResource::kInodes, +1}});
@@ -1102,7 +1128,7 @@ uint8_t fsnodes_appendchunks(uint32_t ts, FSNodeFile *dst, FSNodeFile *src) {
 	for(uint32_t i = 0; i < src_chunks; ++i) {
 		auto chunkid = src->chunks[i];
 		if (chunkid > 0) {
-			if (chunk_add_file(chunkid, dst->goal) != LIZARDFS_STATUS_OK) {
+			if (chunk_add_file(chunkid, dst->goal, dst->id) != LIZARDFS_STATUS_OK) {
 				lzfs_pretty_syslog(LOG_ERR, "structure error - chunk %016" PRIX64 " not found (inode: %" PRIu32
 				                " ; index: %" PRIu32 ")",
 				       chunkid, src->id, i);
@@ -1209,6 +1235,23 @@ void fsnodes_change_uid_gid(FSNode *p, uint32_t uid, uint32_t gid) {
 	}
 }
 
+/*! \brief Remove lazy snapshot data related to the directory which is being removed.
+ *
+ * Directory is removed only when it is empty, so its lazy snapshots (if any)
+ * don't share anything anymore.
+ */
+static void fsnodes_lazy_snapshot_forget(FSNodeDirectory *dir) {
+	if (gMetadata->lazy_snapshots.empty()) {
+		return;
+	}
+	gMetadata->lazy_snapshots.remove(dir->id);
+	for (uint32_t clone : gMetadata->lazy_snapshots.clonesOf(dir->id)) {
+		LazySnapshotRegistry::Entry entry;
+		gMetadata->lazy_snapshots.remove(clone, &entry);
+		fsnodes_sub_stats(fsnodes_id_to_node<FSNodeDirectory>(clone), &entry.stats);
+	}
+}
+
 static inline void fsnodes_remove_node(uint32_t ts, FSNode *toremove) {
 	if (!toremove->parent.empty()) {
 		return;
@@ -1223,6 +1266,7 @@ static inline void fsnodes_remove_node(uint32_t ts, FSNode *toremove) {
 		}
 		ptr = &((*ptr)->next);
 	}
+	gMetadata->node_table.erase(toremove->id);
 	if (gChecksumBackgroundUpdater.isNodeIncluded(toremove)) {
 		removeFromChecksum(gChecksumBackgroundUpdater.fsNodesChecksum, toremove->checksum);
 	}
@@ -1232,6 +1276,7 @@ static inline void fsnodes_remove_node(uint32_t ts, FSNode *toremove) {
 	gMetadata->acl_storage.erase(toremove->id);
 	if (toremove->type == FSNode::kDirectory) {
 		gMetadata->dirnodes--;
+		fsnodes_lazy_snapshot_forget(static_cast<FSNodeDirectory*>(toremove));
 	}
 	if (toremove->type == FSNode::kFile || toremove->type == FSNode::kTrash ||
 	    toremove->type == FSNode::kReserved) {
@@ -1346,7 +1391,8 @@ int fsnodes_purge(uint32_t ts, FSNode *p) {
 	return -1;
 }
 
-uint8_t fsnodes_undel(uint32_t ts, FSNodeFile *node) {
+uint8_t fsnodes_undel(const FsContext &context, FSNodeFile *node) {
+	uint32_t ts = context.ts();
 	uint8_t is_new;
 	uint32_t i, partleng, dots;
 	/* check path */
@@ -1412,10 +1458,16 @@ uint8_t fsnodes_undel(uint32_t ts, FSNodeFile *node) {
 			partleng++;
 		}
 		HString name(path, partleng);
+		if (is_new == 0) {
+			fsnodes_lazy_snapshot_materialize(context, p, true);
+		}
 		if (partleng == pleng) {  // last name
 			if (fsnodes_nameisused(p, name)) {
 				return LIZARDFS_ERROR_EEXIST;
 			}
+			if (is_new == 0) {
+				fsnodes_lazy_snapshot_protect_dir(context, p);
+			}
 			// remove from trash and link to new parent
 			if (node->type == FSNode::kTrash) {
 				gMetadata->trash.erase(TrashPathKey(node));
@@ -1435,6 +1487,7 @@ uint8_t fsnodes_undel(uint32_t ts, FSNodeFile *node) {
 				n = fsnodes_lookup(p, name);
 				if (n == nullptr) {
 					is_new = 1;
+					fsnodes_lazy_snapshot_protect_dir(context, p);
 				} else {
 					if (n->type != FSNode::kDirectory) {
 						return LIZARDFS_ERROR_CANTCREATEPATH;
@@ -1483,7 +1536,8 @@ void fsnodes_getgoal_recursive(FSNode *node, uint8_t gmode, GoalStatistics &fgta
 		}
 		dgtab[node->goal]++;
 		if (gmode == GMODE_RECURSIVE) {
-			const FSNodeDirectory *dir_node = static_cast<const FSNodeDirectory*>(node);
+			const FSNodeDirectory *dir_node =
+			        fsnodes_lazy_snapshot_resolve(static_cast<const FSNodeDirectory*>(node));
 			for (const auto &entry : dir_node->entries) {
 				fsnodes_getgoal_recursive(entry.second, gmode, fgtab, dgtab);
 			}
@@ -1499,7 +1553,8 @@ void fsnodes_gettrashtime_recursive(FSNode *node, uint8_t gmode,
 	} else if (node->type == FSNode::kDirectory) {
 		dirTrashtimes[node->trashtime] += 1;
 		if (gmode == GMODE_RECURSIVE) {
-			const FSNodeDirectory *dir_node = static_cast<const FSNodeDirectory*>(node);
+			const FSNodeDirectory *dir_node =
+			        fsnodes_lazy_snapshot_resolve(static_cast<const FSNodeDirectory*>(node));
 			for (const auto &entry : dir_node->entries) {
 				fsnodes_gettrashtime_recursive(entry.second, gmode, fileTrashtimes, dirTrashtimes);
 			}
@@ -1516,7 +1571,8 @@ void fsnodes_geteattr_recursive(FSNode *node, uint8_t gmode, uint32_t feattrtab[
 	} else {
 		deattrtab[(node->mode >> 12)]++;
 		if (gmode == GMODE_RECURSIVE) {
-			const FSNodeDirectory *dir_node = static_cast<const FSNodeDirectory*>(node);
+			const FSNodeDirectory *dir_node =
+			        fsnodes_lazy_snapshot_resolve(static_cast<const FSNodeDirectory*>(node));
 			for (const auto &entry : dir_node->entries) {
 				fsnodes_geteattr_recursive(entry.second, gmode, feattrtab, deattrtab);
 			}
@@ -36,14 +36,7 @@ inline uint32_t fsnodes_hash(uint32_t parentid, const HString &name) {
 namespace detail {
 
 inline FSNode *fsnodes_id_to_node_internal(uint32_t id) {
-	FSNode *p;
-	uint32_t nodepos = NODEHASHPOS(id);
-	for (p = gMetadata->nodehash[nodepos]; p; p = p->next) {
-		if (p->id == id) {
-			return p;
-		}
-	}
-	return nullptr;
+	return gMetadata->node_table.find(id);
 }
 
 template<class NodeType>
@@ -116,6 +109,7 @@ inline void fsnodes_update_ctime(FSNode *node, uint32_t ctime) {
 }
 
 std::string fsnodes_escape_name(const std::string &name);
+uint64_t fsnodes_memory_usage();
 int fsnodes_purge(uint32_t ts, FSNode *p);
 uint32_t fsnodes_getdetachedsize(const TrashPathContainer &data);
 void fsnodes_getdetacheddata(const TrashPathContainer &data, uint8_t *dbuff);
@@ -133,7 +127,7 @@ uint8_t verify_session(const FsContext &context, OperationMode operationMode,
 
 uint8_t fsnodes_get_node_for_operation(const FsContext &context, ExpectedNodeType expectedNodeType,
 	uint8_t modemask, uint32_t inode, FSNode **ret, FSNodeDirectory **ret_rn = nullptr);
-uint8_t fsnodes_undel(uint32_t ts, FSNodeFile *node);
+uint8_t fsnodes_undel(const FsContext &context, FSNodeFile *node);
 
 int fsnodes_namecheck(const std::string &name);
 void fsnodes_get_stats(FSNode *node, statsrecord *sr);
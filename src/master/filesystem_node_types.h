@@ -37,6 +37,7 @@
 #else
 #  include <map>
 #  include "common/flat_map.h"
+#  include "common/segmented_flat_map.h"
 #endif
 
 #include "master/fs_context.h"
@@ -115,7 +116,8 @@ struct FSNode {
 	compact_vector<uint32_t, uint32_t> parent; /*!< Parent nodes ids. To reduce memory usage ids
 	                                                are stored instead of pointers to FSNode. */
 
-	FSNode   *next; /*!< Next field used for storing FSNode in hash map. */
+	FSNode   *next; /*!< Next field used for storing FSNode in hash map (used for iteration,
+	                     lookups by id are done in FilesystemMetadata::node_table). */
 	uint64_t checksum; /*!< Node checksum. */
 
 	FSNode(uint8_t t) {
@@ -200,8 +202,9 @@ struct FSNodeDirectory : public FSNode {
 			return a.data() < b.data();
 		}
 	};
-	typedef flat_map<hstorage::Handle, FSNode *, std::vector<std::pair<hstorage::Handle, FSNode *>>,
-	HandleCompare> EntriesContainer;
+	// Small directories are kept in a flat sorted vector, large ones (with thousands
+	// of entries) are split into segments, so insert/erase doesn't move all entries.
+	typedef segmented_flat_map<hstorage::Handle, FSNode *, HandleCompare> EntriesContainer;
 #endif
 
 	typedef EntriesContainer::iterator iterator;
@@ -22,6 +22,8 @@
 
 #include <cstdarg>
 #include <cstdint>
+#include <string>
+#include <vector>
 
 #include "common/attributes.h"
 #include "common/event_loop.h"
@@ -32,6 +34,7 @@
 #include "master/filesystem_checksum_updater.h"
 #include "master/filesystem_node.h"
 #include "master/filesystem_quota.h"
+#include "master/filesystem_snapshot.h"
 #include "master/fs_context.h"
 #include "master/locks.h"
 #include "master/matocsserv.h"
@@ -65,11 +68,19 @@ bool decodeChar(const char *keys, const std::vector<T> values, char key, T &valu
 	return false;
 }
 
+#ifndef METARESTORE
+static std::vector<std::pair<uint32_t, std::string>> gDeferredChangelog;
+#endif
+
 void fs_changelog(uint32_t ts, const char *format, ...) {
 #ifdef METARESTORE
 	(void)ts;
 	(void)format;
 #else
+	if (!gDeferredChangelog.empty()) {
+		fs_changelog_flush();
+	}
+
 	const uint32_t kMaxTimestampSize = 20;
 	const uint32_t kMaxEntrySize = kMaxLogLineSize - kMaxTimestampSize;
 	static char entry[kMaxLogLineSize];
@@ -97,6 +108,30 @@ void fs_changelog(uint32_t ts, const char *format, ...) {
 #endif
 }
 
+void fs_changelog_defer(uint32_t ts, const char *format, ...) {
+#ifdef METARESTORE
+	(void)ts;
+	(void)format;
+#else
+	static char entry[kMaxLogLineSize];
+	va_list ap;
+	va_start(ap, format);
+	vsnprintf(entry, kMaxLogLineSize, format, ap);
+	va_end(ap);
+	gDeferredChangelog.emplace_back(ts, entry);
+#endif
+}
+
+void fs_changelog_flush() {
+#ifndef METARESTORE
+	std::vector<std::pair<uint32_t, std::string>> deferred;
+	deferred.swap(gDeferredChangelog);
+	for (const auto &entry : deferred) {
+		fs_changelog(entry.first, "%s", entry.second.c_str());
+	}
+#endif
+}
+
 #ifndef METARESTORE
 uint8_t fs_readreserved_size(uint32_t rootinode, uint8_t sesflags, uint32_t *dbuffsize) {
 	if (rootinode != 0) {
@@ -231,7 +266,7 @@ uint8_t fs_undel(const FsContext &context, uint32_t inode) {
 		return LIZARDFS_ERROR_ENOENT;
 	}
 
-	status = fsnodes_undel(context.ts(), static_cast<FSNodeFile*>(p));
+	status = fsnodes_undel(context, static_cast<FSNodeFile*>(p));
 	if (context.isPersonalityMaster()) {
 		if (status == LIZARDFS_STATUS_OK) {
 			fs_changelog(context.ts(), "UNDEL(%" PRIu32 ")", p->id);
@@ -441,6 +476,7 @@ uint8_t fs_lookup(const FsContext &context, uint32_t parent, const HString &name
 	if (fsnodes_namecheck(name) < 0) {
 		return LIZARDFS_ERROR_EINVAL;
 	}
+	fsnodes_lazy_snapshot_materialize(context, static_cast<FSNodeDirectory*>(wd), true);
 	FSNode *child = fsnodes_lookup(static_cast<FSNodeDirectory*>(wd), name);
 	if (!child) {
 		return LIZARDFS_ERROR_ENOENT;
@@ -531,8 +567,9 @@ uint8_t fs_try_setlength(const FsContext &context, uint32_t inode, uint8_t opene
 				uint64_t nchunkid;
 				// We deny truncating parity only if truncating down
 				denyTruncatingParity = denyTruncatingParity && (length < node_file->length);
+				fsnodes_lazy_snapshot_protect(context, p);
 				status = chunk_multi_truncate(
-				    ochunkid, lockId, (length & MFSCHUNKMASK), p->goal, denyTruncatingParity,
+				    ochunkid, lockId, (length & MFSCHUNKMASK), p->goal, p->id, denyTruncatingParity,
 				    fsnodes_quota_exceeded(p, {{QuotaResource::kSize, 1}}), &nchunkid);
 				if (status != LIZARDFS_STATUS_OK) {
 					return status;
@@ -573,7 +610,7 @@ uint8_t fs_apply_trunc(uint32_t ts, uint32_t inode, uint32_t indx, uint64_t chun
 	if (ochunkid == 0) {
 		return LIZARDFS_ERROR_NOCHUNK;
 	}
-	status = chunk_apply_modification(ts, ochunkid, lockid, p->goal, true, &nchunkid);
+	status = chunk_apply_modification(ts, ochunkid, lockid, p->goal, p->id, true, &nchunkid);
 	if (status != LIZARDFS_STATUS_OK) {
 		return status;
 	}
@@ -633,6 +670,8 @@ uint8_t fs_do_setlength(const FsContext &context, uint32_t inode, uint64_t lengt
 		return status;
 	}
 
+	fsnodes_lazy_snapshot_protect(context, p);
+
 	fsnodes_setlength(static_cast<FSNodeFile*>(p), length);
 	fs_changelog(ts, "LENGTH(%" PRIu32 ",%" PRIu64 ")", inode, static_cast<FSNodeFile*>(p)->length);
 	p->mtime = ts;
@@ -689,6 +728,7 @@ uint8_t fs_setattr(const FsContext &context, uint32_t inode, uint8_t setmask, ui
 			return LIZARDFS_ERROR_EPERM;
 		}
 	}
+	fsnodes_lazy_snapshot_protect(context, p);
 	// first ignore sugid clears done by kernel
 	if ((setmask & (SET_UID_FLAG | SET_GID_FLAG)) &&
 	    (setmask & SET_MODE_FLAG)) {  // chown+chmod = chown with sugid clears
@@ -877,6 +917,7 @@ uint8_t fs_symlink(const FsContext &context, uint32_t parent, const HString &nam
 	if (fsnodes_namecheck(name) < 0) {
 		return LIZARDFS_ERROR_EINVAL;
 	}
+	fsnodes_lazy_snapshot_materialize(context, static_cast<FSNodeDirectory*>(wd), true);
 	if (fsnodes_nameisused(static_cast<FSNodeDirectory*>(wd), name)) {
 		return LIZARDFS_ERROR_EEXIST;
 	}
@@ -885,6 +926,7 @@ uint8_t fs_symlink(const FsContext &context, uint32_t parent, const HString &nam
 	     fsnodes_quota_exceeded_dir(wd, {{QuotaResource::kInodes, 1}}))) {
 		return LIZARDFS_ERROR_QUOTA;
 	}
+	fsnodes_lazy_snapshot_protect_dir(context, static_cast<FSNodeDirectory*>(wd));
 	FSNodeSymlink *p = static_cast<FSNodeSymlink *>(fsnodes_create_node(
 	    context.ts(), static_cast<FSNodeDirectory *>(wd), name, FSNode::kSymlink, 0777, 0,
 	    context.uid(), context.gid(), 0, AclInheritance::kDontInheritAcl, *inode));
@@ -945,6 +987,7 @@ uint8_t fs_mknod(const FsContext &context, uint32_t parent, const HString &name,
 	if (fsnodes_namecheck(name) < 0) {
 		return LIZARDFS_ERROR_EINVAL;
 	}
+	fsnodes_lazy_snapshot_materialize(context, static_cast<FSNodeDirectory*>(wd), true);
 	if (fsnodes_nameisused(static_cast<FSNodeDirectory*>(wd), name)) {
 		return LIZARDFS_ERROR_EEXIST;
 	}
@@ -952,6 +995,7 @@ uint8_t fs_mknod(const FsContext &context, uint32_t parent, const HString &name,
 	    fsnodes_quota_exceeded_dir(wd, {{QuotaResource::kInodes, 1}})) {
 		return LIZARDFS_ERROR_QUOTA;
 	}
+	fsnodes_lazy_snapshot_protect_dir(context, static_cast<FSNodeDirectory*>(wd));
 	p = fsnodes_create_node(ts, static_cast<FSNodeDirectory*>(wd), name, type, mode, umask, context.uid(), context.gid(), 0,
 	                        AclInheritance::kInheritAcl);
 	if (type == FSNode::kBlockDev || type == FSNode::kCharDev) {
@@ -990,6 +1034,7 @@ uint8_t fs_mkdir(const FsContext &context, uint32_t parent, const HString &name,
 	if (fsnodes_namecheck(name) < 0) {
 		return LIZARDFS_ERROR_EINVAL;
 	}
+	fsnodes_lazy_snapshot_materialize(context, static_cast<FSNodeDirectory*>(wd), true);
 	if (fsnodes_nameisused(static_cast<FSNodeDirectory*>(wd), name)) {
 		return LIZARDFS_ERROR_EEXIST;
 	}
@@ -997,6 +1042,7 @@ uint8_t fs_mkdir(const FsContext &context, uint32_t parent, const HString &name,
 	    fsnodes_quota_exceeded_dir(wd, {{QuotaResource::kInodes, 1}})) {
 		return LIZARDFS_ERROR_QUOTA;
 	}
+	fsnodes_lazy_snapshot_protect_dir(context, static_cast<FSNodeDirectory*>(wd));
 	p = fsnodes_create_node(ts, static_cast<FSNodeDirectory *>(wd), name, FSNode::kDirectory, mode,
 	                        umask, context.uid(), context.gid(), copysgid, AclInheritance::kInheritAcl);
 	*inode = p->id;
@@ -1062,6 +1108,7 @@ uint8_t fs_unlink(const FsContext &context, uint32_t parent, const HString &name
 	if (fsnodes_namecheck(name) < 0) {
 		return LIZARDFS_ERROR_EINVAL;
 	}
+	fsnodes_lazy_snapshot_materialize(context, static_cast<FSNodeDirectory*>(wd), true);
 	FSNode *child = fsnodes_lookup(static_cast<FSNodeDirectory*>(wd), name);
 	if (!child) {
 		return LIZARDFS_ERROR_ENOENT;
@@ -1072,6 +1119,7 @@ uint8_t fs_unlink(const FsContext &context, uint32_t parent, const HString &name
 	if (child->type == FSNode::kDirectory) {
 		return LIZARDFS_ERROR_EPERM;
 	}
+	fsnodes_lazy_snapshot_protect_dir(context, static_cast<FSNodeDirectory*>(wd));
 	fs_changelog(ts, "UNLINK(%" PRIu32 ",%s):%" PRIu32, wd->id,
 	             fsnodes_escape_name(name).c_str(), child->id);
 	fsnodes_unlink(ts, static_cast<FSNodeDirectory*>(wd), name, child);
@@ -1094,6 +1142,7 @@ uint8_t fs_recursive_remove(const FsContext &context, uint32_t parent,
 	if (status != LIZARDFS_STATUS_OK) {
 		return status;
 	}
+	fsnodes_lazy_snapshot_materialize(context, static_cast<FSNodeDirectory*>(wd_tmp), true);
 
 	FSNode *child = fsnodes_lookup(static_cast<FSNodeDirectory*>(wd_tmp), name);
 	if (!child) {
@@ -1130,6 +1179,7 @@ uint8_t fs_rmdir(const FsContext &context, uint32_t parent, const HString &name)
 	if (fsnodes_namecheck(name) < 0) {
 		return LIZARDFS_ERROR_EINVAL;
 	}
+	fsnodes_lazy_snapshot_materialize(context, static_cast<FSNodeDirectory*>(wd), true);
 	FSNode *child = fsnodes_lookup(static_cast<FSNodeDirectory*>(wd), name);
 	if (!child) {
 		return LIZARDFS_ERROR_ENOENT;
@@ -1140,9 +1190,11 @@ uint8_t fs_rmdir(const FsContext &context, uint32_t parent, const HString &name)
 	if (child->type != FSNode::kDirectory) {
 		return LIZARDFS_ERROR_ENOTDIR;
 	}
+	fsnodes_lazy_snapshot_materialize(context, static_cast<FSNodeDirectory*>(child), true);
 	if (!static_cast<FSNodeDirectory*>(child)->entries.empty()) {
 		return LIZARDFS_ERROR_ENOTEMPTY;
 	}
+	fsnodes_lazy_snapshot_protect_dir(context, static_cast<FSNodeDirectory*>(wd));
 	fs_changelog(ts, "UNLINK(%" PRIu32 ",%s):%" PRIu32, wd->id,
 	             fsnodes_escape_name(name).c_str(), child->id);
 	fsnodes_unlink(ts, static_cast<FSNodeDirectory*>(wd), name, child);
@@ -1198,6 +1250,7 @@ uint8_t fs_rename(const FsContext &context, uint32_t parent_src, const HString &
 	if (fsnodes_namecheck(name_src) < 0) {
 		return LIZARDFS_ERROR_EINVAL;
 	}
+	fsnodes_lazy_snapshot_materialize(context, static_cast<FSNodeDirectory*>(swd), true);
 	FSNode *se_child = fsnodes_lookup(static_cast<FSNodeDirectory*>(swd), name_src);
 	if (!se_child) {
 		return LIZARDFS_ERROR_ENOENT;
@@ -1224,6 +1277,7 @@ uint8_t fs_rename(const FsContext &context, uint32_t parent_src, const HString &
 	if (fsnodes_namecheck(name_dst) < 0) {
 		return LIZARDFS_ERROR_EINVAL;
 	}
+	fsnodes_lazy_snapshot_materialize(context, static_cast<FSNodeDirectory*>(dwd), true);
 	FSNode *de_child = fsnodes_lookup(static_cast<FSNodeDirectory*>(dwd), name_dst);
 
 	if (de_child == se_child) {
@@ -1231,6 +1285,9 @@ uint8_t fs_rename(const FsContext &context, uint32_t parent_src, const HString &
 	}
 
 	if (de_child) {
+		if (de_child->type == FSNode::kDirectory) {
+			fsnodes_lazy_snapshot_materialize(context, static_cast<FSNodeDirectory*>(de_child), true);
+		}
 		if (de_child->type == FSNode::kDirectory && !static_cast<FSNodeDirectory*>(de_child)->entries.empty()) {
 			return LIZARDFS_ERROR_ENOTEMPTY;
 		}
@@ -1258,6 +1315,8 @@ uint8_t fs_rename(const FsContext &context, uint32_t parent_src, const HString &
 		return LIZARDFS_ERROR_QUOTA;
 	}
 
+	fsnodes_lazy_snapshot_protect_dir(context, static_cast<FSNodeDirectory*>(swd));
+	fsnodes_lazy_snapshot_protect_dir(context, static_cast<FSNodeDirectory*>(dwd));
 	if (de_child) {
 		fsnodes_unlink(context.ts(), static_cast<FSNodeDirectory*>(dwd), name_dst, de_child);
 	}
@@ -1304,9 +1363,12 @@ uint8_t fs_link(const FsContext &context, uint32_t inode_src, uint32_t parent_ds
 	if (fsnodes_namecheck(name_dst) < 0) {
 		return LIZARDFS_ERROR_EINVAL;
 	}
+	fsnodes_lazy_snapshot_materialize(context, static_cast<FSNodeDirectory*>(dwd), true);
 	if (fsnodes_nameisused(static_cast<FSNodeDirectory*>(dwd), name_dst)) {
 		return LIZARDFS_ERROR_EEXIST;
 	}
+	fsnodes_lazy_snapshot_protect_dir(context, static_cast<FSNodeDirectory*>(dwd));
+	fsnodes_lazy_snapshot_protect(context, sp);
 	fsnodes_link(context.ts(), static_cast<FSNodeDirectory*>(dwd), sp, name_dst);
 	if (inode) {
 		*inode = inode_src;
@@ -1349,6 +1411,7 @@ uint8_t fs_append(const FsContext &context, uint32_t inode, uint32_t inode_src)
 	if (context.isPersonalityMaster() && fsnodes_quota_exceeded(p, {{QuotaResource::kSize, 1}})) {
 		return LIZARDFS_ERROR_QUOTA;
 	}
+	fsnodes_lazy_snapshot_protect(context, p);
 	status = fsnodes_appendchunks(context.ts(), static_cast<FSNodeFile*>(p), static_cast<FSNodeFile*>(sp));
 	if (status != LIZARDFS_STATUS_OK) {
 		return status;
@@ -1662,6 +1725,8 @@ uint8_t fs_readdir_size(const FsContext &context, uint32_t inode, uint8_t flags,
 		return status;
 	}
 
+	fsnodes_lazy_snapshot_materialize(context, static_cast<FSNodeDirectory*>(p), true);
+
 	*dnode = p;
 	*dbuffsize = fsnodes_getdirsize(static_cast<FSNodeDirectory*>(p), flags & GETDIR_FLAG_WITHATTR);
 	return LIZARDFS_STATUS_OK;
@@ -1693,6 +1758,8 @@ uint8_t fs_readdir(const FsContext &context, uint32_t inode, uint64_t first_entr
 		return status;
 	}
 
+	fsnodes_lazy_snapshot_materialize(context, static_cast<FSNodeDirectory*>(dir), true);
+
 	uint32_t ts = eventloop_time();
 	ChecksumUpdater cu(ts);
 
@@ -1921,6 +1988,7 @@ uint8_t fs_writechunk(const FsContext &context, uint32_t inode, uint32_t indx, b
 	if (indx > MAX_INDEX) {
 		return LIZARDFS_ERROR_INDEXTOOBIG;
 	}
+	fsnodes_lazy_snapshot_protect(context, p);
 #ifndef METARESTORE
 	if (gMagicAutoFileRepair && context.isPersonalityMaster()) {
 		fs_auto_repair_if_needed(p, indx);
@@ -1951,7 +2019,7 @@ uint8_t fs_writechunk(const FsContext &context, uint32_t inode, uint32_t indx, b
 	ochunkid = p->chunks[indx];
 	if (context.isPersonalityMaster()) {
 #ifndef METARESTORE
-		status = chunk_multi_modify(ochunkid, lockid, p->goal, usedummylockid,
+		status = chunk_multi_modify(ochunkid, lockid, p->goal, p->id, usedummylockid,
 		                            quota_exceeded, opflag, &nchunkid, min_server_version);
 #else
 		(void)usedummylockid;
@@ -1961,7 +2029,7 @@ uint8_t fs_writechunk(const FsContext &context, uint32_t inode, uint32_t indx, b
 #endif
 	} else {
 		bool increaseVersion = (*opflag != 0);
-		status = chunk_apply_modification(context.ts(), ochunkid, *lockid, p->goal,
+		status = chunk_apply_modification(context.ts(), ochunkid, *lockid, p->goal, p->id,
 		                                  increaseVersion, &nchunkid);
 	}
 	if (status != LIZARDFS_STATUS_OK) {
@@ -2017,6 +2085,7 @@ uint8_t fs_writeend(uint32_t inode, uint64_t length, uint64_t chunkid, uint32_t
 			return LIZARDFS_ERROR_EPERM;
 		}
 		if (length > p->length) {
+			fsnodes_lazy_snapshot_protect(FsContext::getForMaster(ts), p);
 			fsnodes_setlength(p, length);
 			p->mtime = ts;
 			fsnodes_update_ctime(p, ts);
@@ -2064,6 +2133,8 @@ uint8_t fs_repair(const FsContext &context, uint32_t inode,
 		return status;
 	}
 
+	fsnodes_lazy_snapshot_protect(context, p);
+
 	FSNodeFile *node_file = static_cast<FSNodeFile*>(p);
 	fsnodes_get_stats(p, &psr);
 	for (indx = 0; indx < node_file->chunks.size(); indx++) {
@@ -2324,6 +2395,12 @@ uint8_t fs_deprecated_setgoal(const FsContext &context, uint32_t inode, uint8_t
 	uint32_t nci = 0;
 	uint32_t nsi = 0;
 
+	if (smode & SMODE_RMASK) {
+		fsnodes_lazy_snapshot_protect_subtree(context, p);
+	} else if ((p->mode & (EATTR_NOOWNER << 12)) != 0 || context.uid() == 0 ||
+	           context.uid() == p->uid) {
+		fsnodes_lazy_snapshot_protect(context, p);
+	}
 	fsnodes_setgoal_recursive(p, context.ts(), context.uid(), goal, smode, &si, &nci, &nsi);
 
 	if (context.isPersonalityMaster()) {
@@ -2441,6 +2518,12 @@ uint8_t fs_deprecated_settrashtime(const FsContext &context, uint32_t inode, uin
 	uint32_t nci = 0;
 	uint32_t nsi = 0;
 	sassert(context.hasUidGidData());
+	if (smode & SMODE_RMASK) {
+		fsnodes_lazy_snapshot_protect_subtree(context, p);
+	} else if ((p->mode & (EATTR_NOOWNER << 12)) != 0 || context.uid() == 0 ||
+	           context.uid() == p->uid) {
+		fsnodes_lazy_snapshot_protect(context, p);
+	}
 	fsnodes_settrashtime_recursive(p, context.ts(), context.uid(), trashtime, smode, &si, &nci,
 	                               &nsi);
 	if (context.isPersonalityMaster()) {
@@ -2484,6 +2567,12 @@ uint8_t fs_seteattr(const FsContext &context, uint32_t inode, uint8_t eattr, uin
 	uint32_t nci = 0;
 	uint32_t nsi = 0;
 	sassert(context.hasUidGidData());
+	if (smode & SMODE_RMASK) {
+		fsnodes_lazy_snapshot_protect_subtree(context, p);
+	} else if ((p->mode & (EATTR_NOOWNER << 12)) != 0 || context.uid() == 0 ||
+	           context.uid() == p->uid) {
+		fsnodes_lazy_snapshot_protect(context, p);
+	}
 	fsnodes_seteattr_recursive(p, context.ts(), context.uid(), eattr, smode, &si, &nci, &nsi);
 	if (context.isPersonalityMaster()) {
 		if ((smode & SMODE_RMASK) == 0 && nsi > 0 && si == 0 && nci == 0) {
@@ -2555,6 +2644,7 @@ uint8_t fs_setxattr(const FsContext &context, uint32_t inode, uint8_t opened,
 	if (mode > XATTR_SMODE_REMOVE) {
 		return LIZARDFS_ERROR_EINVAL;
 	}
+	fsnodes_lazy_snapshot_protect(context, p);
 	status = xattr_setattr(p->id, anleng, attrname, avleng, attrvalue, mode);
 	if (status != LIZARDFS_STATUS_OK) {
 		return status;
@@ -2627,6 +2717,10 @@ uint8_t fs_deleteacl(const FsContext &context, uint32_t inode, AclType type) {
 	if (status != LIZARDFS_STATUS_OK) {
 		return status;
 	}
+	if (type == AclType::kDefault && p->type != FSNode::kDirectory) {
+		return LIZARDFS_ERROR_ENOTSUP;
+	}
+	fsnodes_lazy_snapshot_protect(context, p);
 	status = fsnodes_deleteacl(p, type, context.ts());
 	if (context.isPersonalityMaster()) {
 		if (status == LIZARDFS_STATUS_OK) {
@@ -2659,6 +2753,10 @@ uint8_t fs_setacl(const FsContext &context, uint32_t inode, const RichACL &acl)
 		return status;
 	}
 	std::string acl_string = acl.toString();
+	if (!acl.checkInheritFlags(p->type == FSNode::kDirectory)) {
+		return LIZARDFS_ERROR_ENOTSUP;
+	}
+	fsnodes_lazy_snapshot_protect(context, p);
 	status = fsnodes_setacl(p, acl, context.ts());
 	if (context.isPersonalityMaster()) {
 		if (status == LIZARDFS_STATUS_OK) {
@@ -2683,6 +2781,13 @@ uint8_t fs_setacl(const FsContext &context, uint32_t inode, AclType type, const
 		return status;
 	}
 	std::string acl_string = acl.toString();
+	if (type != AclType::kDefault && type != AclType::kAccess) {
+		return LIZARDFS_ERROR_EINVAL;
+	}
+	if (type == AclType::kDefault && p->type != FSNode::kDirectory) {
+		return LIZARDFS_ERROR_ENOTSUP;
+	}
+	fsnodes_lazy_snapshot_protect(context, p);
 	status = fsnodes_setacl(p, type, acl, context.ts());
 	if (context.isPersonalityMaster()) {
 		if (status == LIZARDFS_STATUS_OK) {
@@ -2914,7 +3019,7 @@ void fs_add_files_to_chunks() {
 			    f->type == FSNode::kReserved) {
 				for (const auto &chunkid : static_cast<FSNodeFile*>(f)->chunks) {
 					if (chunkid > 0) {
-						chunk_add_file(chunkid, f->goal);
+						chunk_add_file(chunkid, f->goal, f->id);
 					}
 				}
 			}
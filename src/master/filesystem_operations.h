@@ -66,6 +66,13 @@ void fs_broadcast_metadata_saved(uint8_t status);
 // Adds an entry to a changelog, updates filesystem.cc internal structures, prepends a
 // proper timestamp to changelog entry and broadcasts it to metaloggers and shadow masters
 void fs_changelog(uint32_t ts, const char *format, ...) __attribute__((__format__(__printf__, 2, 3)));
+
+// Stores a changelog entry which is added just before the next entry added by fs_changelog
+// or by fs_changelog_flush. Metadata version doesn't change until the entry is added, so
+// read-only operations may use it to record changes done on their behalf without logging.
+void fs_changelog_defer(uint32_t ts, const char *format, ...) __attribute__((__format__(__printf__, 2, 3)));
+// Adds all deferred entries to a changelog
+void fs_changelog_flush();
 void fs_add_files_to_chunks();
 
 uint64_t fs_getversion();
@@ -20,8 +20,12 @@
 #include "common/platform.h"
 #include "master/filesystem_periodic.h"
 
+#include <algorithm>
 #include <cstdint>
 #include <type_traits>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
 
 #include "common/cfg.h"
 #include "common/event_loop.h"
@@ -31,6 +35,8 @@
 #  include "common/flat_map.h"
 #endif
 #include "common/loop_watchdog.h"
+#include "common/time_utils.h"
+#include "common/token_bucket.h"
 #include "master/filesystem_checksum.h"
 #include "master/filesystem_checksum_updater.h"
 #include "master/filesystem_metadata.h"
@@ -46,18 +52,14 @@
 #ifndef METARESTORE
 
 static uint32_t fsinfo_files = 0;
-static uint32_t fsinfo_ugfiles = 0;
 static uint32_t fsinfo_mfiles = 0;
-static uint32_t fsinfo_chunks = 0;
-static uint32_t fsinfo_ugchunks = 0;
-static uint32_t fsinfo_mchunks = 0;
 static uint32_t fsinfo_loopstart = 0;
 static uint32_t fsinfo_loopend = 0;
 static uint32_t fsinfo_notfoundchunks = 0;
-static uint32_t fsinfo_unavailchunks = 0;
-static uint32_t fsinfo_unavailfiles = 0;
-static uint32_t fsinfo_unavailtrashfiles = 0;
-static uint32_t fsinfo_unavailreservedfiles = 0;
+
+/*! Maximal number of files purged from trash per second, 0 means no limit. */
+static uint32_t gTrashPurgeMaxRate = 0;
+static TokenBucket gTrashPurgeBudget(SteadyClock::now());
 
 static int gTasksBatchSize = 1000;
 
@@ -81,6 +83,28 @@ enum NodeErrorFlag {
 static const size_t kMaxNodeEntries = 1000000;
 static DefectiveNodesMap gDefectiveNodes;
 
+/*
+ * Files are tested in two ways. The full test visits all files once per
+ * FILE_TEST_LOOP_MIN_TIME. Between its loops, files are tested again when health of their
+ * chunks changes: files in which a chunk was found unhealthy are remembered, and a chunk
+ * which became unhealthy is looked for in the file it was added to most recently. Only
+ * chunks which are shared by more files (e.g. after snapshots) and weren't found this way
+ * are located by a pass over all files which only compares chunk ids.
+ */
+
+/*! Files in which chunks were found unhealthy, by chunk id. */
+static std::unordered_map<uint64_t, std::vector<uint32_t>> gUnhealthyChunkFiles;
+/*! Files to be tested again, because health of their chunks changed. */
+static std::unordered_set<uint32_t> gFilesToRetest;
+/*! Chunks which became unhealthy in files which aren't known, to be looked for. */
+static std::unordered_set<uint64_t> gChunksToLocate;
+static bool gLocateAllChunks = false;
+/*! State of the current pass over all files looking for chunks. */
+static std::unordered_set<uint64_t> gChunksBeingLocated;
+static bool gLocatingAllChunks = false;
+static bool gLocatePassRunning = false;
+static uint32_t gLocatePassIndex = 0;
+
 void fs_background_task_manager_work() {
 	if (gMetadata->task_manager.workAvailable()) {
 		uint32_t ts = eventloop_time();
@@ -162,6 +186,29 @@ void fs_test_getdata(uint32_t &loopstart, uint32_t &loopend, uint32_t &files, ui
 	std::stringstream report;
 	int errors = 0;
 
+	uint32_t unavailfiles = 0;
+	uint32_t unavailtrashfiles = 0;
+	uint32_t unavailreservedfiles = 0;
+	uint32_t undergoalfiles = 0;
+	for (const auto &entry : gDefectiveNodes) {
+		FSNode *node = fsnodes_id_to_node<FSNode>(entry.first);
+		if (node && (entry.second & kChunkUnavailable)) {
+			if (node->type == FSNode::kTrash) {
+				unavailtrashfiles++;
+			} else if (node->type == FSNode::kReserved) {
+				unavailreservedfiles++;
+			} else {
+				unavailfiles += node->parent.size();
+			}
+		}
+		if (node && (entry.second & kChunkUnderGoal)) {
+			undergoalfiles++;
+		}
+	}
+
+	uint64_t all_chunks, undergoal_chunks, unavailable_chunks;
+	chunk_get_file_references(all_chunks, undergoal_chunks, unavailable_chunks);
+
 	for (const auto &entry : gDefectiveNodes) {
 		if (errors >= ERRORS_LOG_MAX) {
 			break;
@@ -239,26 +286,26 @@ void fs_test_getdata(uint32_t &loopstart, uint32_t &loopend, uint32_t &files, ui
 	if (fsinfo_notfoundchunks > 0) {
 		report << "unknown chunks: " << fsinfo_notfoundchunks << "\n";
 	}
-	if (fsinfo_unavailchunks > 0) {
-		report << "unavailable chunks: " << fsinfo_unavailchunks << "\n";
+	if (unavailable_chunks > 0) {
+		report << "unavailable chunks: " << unavailable_chunks << "\n";
 	}
-	if (fsinfo_unavailtrashfiles > 0) {
-		report << "unavailable trash files: " << fsinfo_unavailtrashfiles << "\n";
+	if (unavailtrashfiles > 0) {
+		report << "unavailable trash files: " << unavailtrashfiles << "\n";
 	}
-	if (fsinfo_unavailreservedfiles > 0) {
-		report << "unavailable reserved files: " << fsinfo_unavailreservedfiles << "\n";
+	if (unavailreservedfiles > 0) {
+		report << "unavailable reserved files: " << unavailreservedfiles << "\n";
 	}
-	if (fsinfo_unavailfiles > 0) {
-		report << "unavailable files: " << fsinfo_unavailfiles << "\n";
+	if (unavailfiles > 0) {
+		report << "unavailable files: " << unavailfiles << "\n";
 	}
 	result = report.str();
 
 	files = fsinfo_files;
-	ugfiles = fsinfo_ugfiles;
+	ugfiles = undergoalfiles;
 	mfiles = fsinfo_mfiles;
-	chunks = fsinfo_chunks;
-	ugchunks = fsinfo_ugchunks;
-	mchunks = fsinfo_mchunks;
+	chunks = all_chunks + fsinfo_notfoundchunks;
+	ugchunks = undergoal_chunks;
+	mchunks = unavailable_chunks + fsinfo_notfoundchunks;
 	loopstart = fsinfo_loopstart;
 	loopend = fsinfo_loopend;
 }
@@ -288,21 +335,20 @@ void fs_background_checksum_recalculation_a_bit() {
 		}
 		break;
 	case ChecksumRecalculatingStep::kXattrs:
-		// Xattrs are in a hashtable, therefore they can be recalculated in multiple steps.
-		while (gChecksumBackgroundUpdater.getPosition() < XATTR_DATA_HASH_SIZE) {
-			for (xattr_data_entry *xde =
-			             gMetadata->xattr_data_hash[gChecksumBackgroundUpdater
-			                                                .getPosition()];
-			     xde; xde = xde->next) {
-				xattr_checksum_add_to_background(xde);
-				++recalculated;
-			}
+		// Xattrs are recalculated in multiple steps, in order of inodes they belong to.
+		// Inodes without xattrs are skipped quickly, so they are not fully counted.
+		for (uint32_t visited = 0;
+		     (uint32_t)gChecksumBackgroundUpdater.getPosition() <= gMetadata->maxnodeid;
+		     ++visited) {
+			recalculated += xattr_checksum_add_to_background(
+			        gChecksumBackgroundUpdater.getPosition());
 			gChecksumBackgroundUpdater.incPosition();
-			if (recalculated >= gChecksumBackgroundUpdater.getSpeedLimit()) {
+			if (recalculated >= gChecksumBackgroundUpdater.getSpeedLimit() ||
+			    visited >= 64 * gChecksumBackgroundUpdater.getSpeedLimit()) {
 				break;
 			}
 		}
-		if (gChecksumBackgroundUpdater.getPosition() == XATTR_DATA_HASH_SIZE) {
+		if ((uint32_t)gChecksumBackgroundUpdater.getPosition() > gMetadata->maxnodeid) {
 			gChecksumBackgroundUpdater.incStep();
 		}
 		break;
@@ -321,51 +367,120 @@ void fs_background_checksum_recalculation_a_bit() {
 	eventloop_make_next_poll_nonblocking();
 }
 
+/* Remembers that the chunk is unhealthy in the file, so the file is tested again when it changes */
+static void fs_remember_unhealthy_chunk(uint64_t chunkid, uint32_t inode) {
+	auto it = gUnhealthyChunkFiles.find(chunkid);
+	if (it == gUnhealthyChunkFiles.end()) {
+		if (gUnhealthyChunkFiles.size() >= kMaxNodeEntries) {
+			return;
+		}
+		it = gUnhealthyChunkFiles.insert({chunkid, std::vector<uint32_t>()}).first;
+	}
+	if (std::find(it->second.begin(), it->second.end(), inode) == it->second.end()) {
+		it->second.push_back(inode);
+	}
+}
+
+/* Returns NodeErrorFlag of the node, counts chunks which don't exist if notfoundchunks is set */
+static uint8_t fs_test_node(FSNode *f, uint32_t *notfoundchunks) {
+	uint8_t node_error_flag = 0;
+
+	if (f->type == FSNode::kFile || f->type == FSNode::kTrash || f->type == FSNode::kReserved) {
+		for (const auto &chunkid : static_cast<FSNodeFile *>(f)->chunks) {
+			if (chunkid == 0) {
+				continue;
+			}
+
+			ChunkHealth health;
+			uint32_t file_count;
+			if (chunk_get_health(chunkid, health, file_count) != LIZARDFS_STATUS_OK) {
+				node_error_flag |= static_cast<int>(kChunkUnavailable);
+				if (notfoundchunks) {
+					(*notfoundchunks)++;
+				}
+				continue;
+			}
+			if (health == ChunkHealth::kHealthy) {
+				continue;
+			}
+			if (health == ChunkHealth::kUnavailable) {
+				node_error_flag |= static_cast<int>(kChunkUnavailable);
+			} else {
+				node_error_flag |= static_cast<int>(kChunkUnderGoal);
+			}
+			fs_remember_unhealthy_chunk(chunkid, f->id);
+		}
+	}
+
+	if (f->type == FSNode::kDirectory) {
+		for (const auto &entry : static_cast<FSNodeDirectory *>(f)->entries) {
+			FSNode *node = entry.second;
+
+			if (!node ||
+			    std::find(node->parent.begin(), node->parent.end(), f->id) ==
+			            node->parent.end()) {
+				node_error_flag |= static_cast<int>(kStructureError);
+			}
+		}
+	}
+
+	return node_error_flag;
+}
+
+static void fs_set_node_errors(FSNode *f, uint8_t node_error_flag) {
+	if (node_error_flag == 0) {
+		auto it = gDefectiveNodes.find(f->id);
+		if (it != gDefectiveNodes.end()) {
+			gDefectiveNodes.erase(it);
+		}
+		return;
+	}
+
+	if (node_error_flag & kChunkUnavailable) {
+		auto it = gDefectiveNodes.find(f->id);
+		if (it == gDefectiveNodes.end() || !((*it).second & kChunkUnavailable)) {
+			std::string name = get_node_info(f);
+			lzfs_pretty_syslog(LOG_ERR, "Chunks unavailable in %s", name.c_str());
+		}
+	}
+	if (node_error_flag & kStructureError) {
+		auto it = gDefectiveNodes.find(f->id);
+		if (it == gDefectiveNodes.end() || !((*it).second & kStructureError)) {
+			std::string name = get_node_info(f);
+			lzfs_pretty_syslog(LOG_ERR, "Structure error in %s", name.c_str());
+		}
+	}
+
+	if (gDefectiveNodes.size() < kMaxNodeEntries) {
+		gDefectiveNodes[f->id] = node_error_flag;
+	} else {
+		auto it = gDefectiveNodes.find(f->id);
+		if (it != gDefectiveNodes.end()) {
+			(*it).second = node_error_flag;
+		}
+	}
+}
+
 void fs_process_file_test() {
 	uint32_t k;
-	uint8_t vc, node_error_flag;
 	ActiveLoopWatchdog watchdog;
 
 	static uint32_t files = 0;
-	static uint32_t ugfiles = 0;
 	static uint32_t mfiles = 0;
-	static uint32_t chunks = 0;
-	static uint32_t ugchunks = 0;
-	static uint32_t mchunks = 0;
 	static uint32_t notfoundchunks = 0;
-	static uint32_t unavailchunks = 0;
-	static uint32_t unavailfiles = 0;
-	static uint32_t unavailtrashfiles = 0;
-	static uint32_t unavailreservedfiles = 0;
 
 	FSNode *f;
 
 	if (gFileTestLoopIndex == 0) {
 		fsinfo_files = files;
-		fsinfo_ugfiles = ugfiles;
 		fsinfo_mfiles = mfiles;
-		fsinfo_chunks = chunks;
-		fsinfo_ugchunks = ugchunks;
-		fsinfo_mchunks = mchunks;
 		fsinfo_loopstart = fsinfo_loopend;
 		fsinfo_loopend = eventloop_time();
 		fsinfo_notfoundchunks = notfoundchunks;
-		fsinfo_unavailchunks = unavailchunks;
-		fsinfo_unavailfiles = unavailfiles;
-		fsinfo_unavailtrashfiles = unavailtrashfiles;
-		fsinfo_unavailreservedfiles = unavailreservedfiles;
 
 		files = 0;
-		ugfiles = 0;
 		mfiles = 0;
-		chunks = 0;
-		ugchunks = 0;
-		mchunks = 0;
 		notfoundchunks = 0;
-		unavailchunks = 0;
-		unavailfiles = 0;
-		unavailtrashfiles = 0;
-		unavailreservedfiles = 0;
 	}
 
 	watchdog.start();
@@ -377,103 +492,118 @@ void fs_process_file_test() {
 		}
 
 		for (f = gMetadata->nodehash[gFileTestLoopIndex]; f; f = f->next) {
-			node_error_flag = 0;
-
-			if (f->type == FSNode::kFile || f->type == FSNode::kTrash ||
-			    f->type == FSNode::kReserved) {
-				for (const auto &chunkid : static_cast<FSNodeFile *>(f)->chunks) {
-					if (chunkid == 0) {
-						continue;
-					}
-
-					if (chunk_get_fullcopies(chunkid, &vc) !=
-					    LIZARDFS_STATUS_OK) {
-						node_error_flag |=
-						        static_cast<int>(kChunkUnavailable);
-						notfoundchunks++;
-						mchunks++;
-					} else if (vc == 0) {
-						node_error_flag |=
-						        static_cast<int>(kChunkUnavailable);
-						unavailchunks++;
-						mchunks++;
-					} else {
-						int recover, remove;
-						chunk_get_partstomodify(chunkid, recover, remove);
-						if (recover > 0) {
-							node_error_flag |=
-							        static_cast<int>(kChunkUnderGoal);
-							ugchunks++;
-						}
-					}
-					chunks++;
-				}
-			}
-
-			if (f->type == FSNode::kDirectory) {
-				for (const auto &entry :
-				     static_cast<FSNodeDirectory *>(f)->entries) {
-					FSNode *node = entry.second;
-
-					if (!node ||
-					    std::find(node->parent.begin(), node->parent.end(),
-					              f->id) == node->parent.end()) {
-						node_error_flag |=
-						        static_cast<int>(kStructureError);
-					}
-				}
-			}
+			fs_set_node_errors(f, fs_test_node(f, &notfoundchunks));
+		}
+	}
 
-			if (node_error_flag == 0) {
-				auto it = gDefectiveNodes.find(f->id);
-				if (it != gDefectiveNodes.end()) {
-					gDefectiveNodes.erase(it);
-				}
-				continue;
-			}
+	gFileTestLoopBucketLimit -= k;
+	if (gFileTestLoopIndex >= NODEHASHSIZE) {
+		gFileTestLoopIndex = 0;
+	}
+}
 
-			if (node_error_flag & kChunkUnavailable) {
-				if (f->type == FSNode::kTrash) {
-					unavailtrashfiles++;
-				} else if (f->type == FSNode::kReserved) {
-					unavailreservedfiles++;
-				} else {
-					unavailfiles += f->parent.size();
-				}
+/* Does a part of the pass over all files looking for gChunksBeingLocated */
+static void fs_locate_chunks(ActiveLoopWatchdog &watchdog) {
+	if (!gLocatePassRunning) {
+		if (gChunksToLocate.empty() && !gLocateAllChunks) {
+			return;
+		}
+		gChunksBeingLocated.clear();
+		gChunksBeingLocated.swap(gChunksToLocate);
+		gLocatingAllChunks = gLocateAllChunks;
+		gLocateAllChunks = false;
+		gLocatePassIndex = 0;
+		gLocatePassRunning = true;
+	}
 
-				auto it = gDefectiveNodes.find(f->id);
-				if (it == gDefectiveNodes.end()) {
-					std::string name = get_node_info(f);
-					lzfs_pretty_syslog(LOG_ERR, "Chunks unavailable in %s",
-					                   name.c_str());
-				}
+	for (; gLocatePassIndex < NODEHASHSIZE; ++gLocatePassIndex) {
+		if (watchdog.expired()) {
+			return;
+		}
+		for (FSNode *f = gMetadata->nodehash[gLocatePassIndex]; f; f = f->next) {
+			if (f->type != FSNode::kFile && f->type != FSNode::kTrash &&
+			    f->type != FSNode::kReserved) {
+				continue;
 			}
-			if (node_error_flag & kChunkUnderGoal) {
-				ugfiles++;
+			const auto &chunks = static_cast<FSNodeFile *>(f)->chunks;
+			bool found = gLocatingAllChunks;
+			for (auto it = chunks.begin(); !found && it != chunks.end(); ++it) {
+				found = *it != 0 && gChunksBeingLocated.count(*it) > 0;
 			}
-			if (node_error_flag & kStructureError) {
-				auto it = gDefectiveNodes.find(f->id);
-				if (it == gDefectiveNodes.end()) {
-					std::string name = get_node_info(f);
-					lzfs_pretty_syslog(LOG_ERR, "Structure error in %s",
-					                   name.c_str());
-				}
+			if (found) {
+				fs_set_node_errors(f, fs_test_node(f, nullptr));
 			}
+		}
+	}
 
-			if (gDefectiveNodes.size() < kMaxNodeEntries) {
-				gDefectiveNodes[f->id] = node_error_flag;
-			} else {
-				auto it = gDefectiveNodes.find(f->id);
-				if (it != gDefectiveNodes.end()) {
-					(*it).second = node_error_flag;
-				}
-			}
+	gLocatePassRunning = false;
+	gChunksBeingLocated.clear();
+}
+
+/* Checks if the chunk still belongs to the file */
+static bool fs_file_has_chunk(uint32_t inode, uint64_t chunkid) {
+	FSNode *f = fsnodes_id_to_node<FSNode>(inode);
+	if (!f || (f->type != FSNode::kFile && f->type != FSNode::kTrash &&
+	           f->type != FSNode::kReserved)) {
+		return false;
+	}
+	const auto &chunks = static_cast<FSNodeFile *>(f)->chunks;
+	return std::find(chunks.begin(), chunks.end(), chunkid) != chunks.end();
+}
+
+void fs_background_incremental_file_test(void) {
+	if (eventloop_time() <= gTestStartTime) {
+		return;
+	}
+
+	static std::vector<uint64_t> changes;
+	if (!chunk_take_health_changes(changes)) {
+		// some changes were lost, so all files have to be tested
+		gLocateAllChunks = true;
+	}
+	for (uint64_t chunkid : changes) {
+		std::vector<uint32_t> known_files;
+		auto it = gUnhealthyChunkFiles.find(chunkid);
+		if (it != gUnhealthyChunkFiles.end()) {
+			known_files.swap(it->second);
+			gUnhealthyChunkFiles.erase(it);
+			gFilesToRetest.insert(known_files.begin(), known_files.end());
+		}
+		ChunkHealth health;
+		uint32_t file_count;
+		if (chunk_get_health(chunkid, health, file_count) != LIZARDFS_STATUS_OK ||
+		    health == ChunkHealth::kHealthy || file_count <= known_files.size()) {
+			continue;
+		}
+		uint32_t inode;
+		if (chunk_get_last_file(chunkid, inode) == LIZARDFS_STATUS_OK &&
+		    std::find(known_files.begin(), known_files.end(), inode) == known_files.end() &&
+		    fs_file_has_chunk(inode, chunkid)) {
+			gFilesToRetest.insert(inode);
+			known_files.push_back(inode);
+		}
+		if (file_count > known_files.size()) {
+			gChunksToLocate.insert(chunkid);
 		}
 	}
 
-	gFileTestLoopBucketLimit -= k;
-	if (gFileTestLoopIndex >= NODEHASHSIZE) {
-		gFileTestLoopIndex = 0;
+	ActiveLoopWatchdog watchdog;
+	watchdog.start();
+	while (!gFilesToRetest.empty() && !watchdog.expired()) {
+		uint32_t inode = *gFilesToRetest.begin();
+		gFilesToRetest.erase(gFilesToRetest.begin());
+		FSNode *f = fsnodes_id_to_node<FSNode>(inode);
+		if (f) {
+			fs_set_node_errors(f, fs_test_node(f, nullptr));
+		}
+	}
+	if (gFilesToRetest.empty()) {
+		fs_locate_chunks(watchdog);
+	}
+
+	if (!gFilesToRetest.empty() || gLocatePassRunning || !gChunksToLocate.empty() ||
+	    gLocateAllChunks) {
+		eventloop_make_next_poll_nonblocking();
 	}
 }
 
@@ -512,12 +642,27 @@ struct InodeInfo {
 };
 
 #ifndef METARESTORE
+/*
+ * Trash is ordered by expiration time, so only expired files are visited. When
+ * TRASH_PURGE_MAX_RATE is set, files which expired at once (e.g. a big directory removed
+ * with a short trash time) are purged gradually, which spreads changelog entries and
+ * deletions of chunks over time.
+ */
 static void fs_do_emptytrash(uint32_t ts) {
 	SignalLoopWatchdog watchdog;
 
+	uint32_t budget = UINT32_MAX;
+	double budget_taken = 0;
+	SteadyTimePoint now = SteadyClock::now();
+	if (gTrashPurgeMaxRate > 0) {
+		budget_taken = gTrashPurgeBudget.attempt(now, gTrashPurgeBudget.budgetCeil());
+		budget = budget_taken;
+	}
+	uint32_t purged = 0;
+
 	auto it = gMetadata->trash.begin();
 	watchdog.start();
-	while (it != gMetadata->trash.end() && ((*it).first.timestamp < ts)) {
+	while (it != gMetadata->trash.end() && ((*it).first.timestamp < ts) && purged < budget) {
 		FSNodeFile *node = fsnodes_id_to_node_verify<FSNodeFile>((*it).first.id);
 
 		if (!node) {
@@ -533,6 +678,7 @@ static void fs_do_emptytrash(uint32_t ts) {
 
 		// Purge operation should be performed anyway - if it fails, inode will be reserved
 		fs_changelog(ts, "PURGE(%" PRIu32 ")", node_id);
+		purged++;
 
 		it = gMetadata->trash.begin();
 
@@ -540,6 +686,12 @@ static void fs_do_emptytrash(uint32_t ts) {
 			break;
 		}
 	}
+
+	if (gTrashPurgeMaxRate > 0) {
+		// give back the part of budget which wasn't used
+		gTrashPurgeBudget.reconfigure(now, gTrashPurgeMaxRate, gTrashPurgeMaxRate,
+		                              budget_taken - purged);
+	}
 }
 #endif
 
@@ -592,6 +744,9 @@ uint8_t fs_apply_emptyreserved_deprecated(uint32_t /*ts*/,uint32_t /*freeinodes*
 #ifndef METARESTORE
 void fs_read_periodic_config_file() {
 	gFileTestLoopTime = cfg_get_minmaxvalue<uint32_t>("FILE_TEST_LOOP_MIN_TIME", 3600, FILETESTSMINLOOPTIME, FILETESTSMAXLOOPTIME);
+	gTrashPurgeMaxRate = cfg_getuint32("TRASH_PURGE_MAX_RATE", 0);
+	// budget for one second of purging
+	gTrashPurgeBudget.reconfigure(SteadyClock::now(), gTrashPurgeMaxRate, gTrashPurgeMaxRate);
 }
 
 void fs_periodic_master_init() {
@@ -599,6 +754,7 @@ void fs_periodic_master_init() {
 	eventloop_eachloopregister(fs_background_checksum_recalculation_a_bit);
 	eventloop_eachloopregister(fs_background_task_manager_work);
 	eventloop_eachloopregister(fs_background_file_test);
+	eventloop_eachloopregister(fs_background_incremental_file_test);
 	eventloop_timeregister_ms(100, fs_periodic_emptytrash);
 }
 #endif
@@ -22,16 +22,194 @@
 #include "common/main.h"
 #include "master/filesystem_checksum_updater.h"
 #include "master/filesystem_metadata.h"
+#include "master/filesystem_operations.h"
 #include "master/filesystem_quota.h"
+#include "master/filesystem_snapshot.h"
 #include "master/snapshot_task.h"
 #include "master/task_manager.h"
 
 static uint32_t gInitialSnapshotTaskBatch;
 static uint32_t gSnapshotTaskBatchLimit;
+static bool gLazySnapshots;
 
 void fs_read_snapshot_config_file() {
 	gInitialSnapshotTaskBatch = cfg_getuint32("SNAPSHOT_INITIAL_BATCH_SIZE", 1000);
 	gSnapshotTaskBatchLimit = cfg_getuint32("SNAPSHOT_INITIAL_BATCH_SIZE_LIMIT", 10000);
+	gLazySnapshots = cfg_getuint8("SNAPSHOT_LAZY", 0);
+}
+
+void fsnodes_lazy_snapshot_register(const FSNodeDirectory *source, FSNodeDirectory *clone) {
+	uint32_t source_id = source->id;
+	statsrecord stats = source->stats;
+
+	// Snapshot of a lazy snapshot shares contents of the original source.
+	const LazySnapshotRegistry::Entry *entry = gMetadata->lazy_snapshots.find(source->id);
+	if (entry) {
+		source_id = entry->source;
+		stats = entry->stats;
+	}
+	if (stats.inodes == 0) {
+		return;
+	}
+
+	gMetadata->lazy_snapshots.add(clone->id, source_id, stats);
+	fsnodes_add_stats(clone, &stats);
+}
+
+const FSNodeDirectory *fsnodes_lazy_snapshot_resolve(const FSNodeDirectory *dir) {
+	if (gMetadata->lazy_snapshots.empty()) {
+		return dir;
+	}
+	const LazySnapshotRegistry::Entry *entry = gMetadata->lazy_snapshots.find(dir->id);
+	if (!entry) {
+		return dir;
+	}
+	const FSNodeDirectory *source = fsnodes_id_to_node<FSNodeDirectory>(entry->source);
+	return source ? source : dir;
+}
+
+/*! \brief Unregister lazy snapshot and remove its captured statistics. */
+static bool fsnodes_lazy_snapshot_detach(FSNodeDirectory *dir, LazySnapshotRegistry::Entry *entry) {
+	if (!gMetadata->lazy_snapshots.remove(dir->id, entry)) {
+		return false;
+	}
+	statsrecord empty{};
+	fsnodes_add_sub_stats(dir, &empty, &entry->stats);
+	return true;
+}
+
+void fsnodes_lazy_snapshot_materialize(const FsContext &context, FSNodeDirectory *dir,
+		bool defer_changelog) {
+	if (!context.isPersonalityMaster() || gMetadata->lazy_snapshots.empty()) {
+		return;
+	}
+
+	LazySnapshotRegistry::Entry entry;
+	if (!fsnodes_lazy_snapshot_detach(dir, &entry)) {
+		return;
+	}
+	if (defer_changelog) {
+		fs_changelog_defer(context.ts(), "MATERIALIZE(%" PRIu32 ")", dir->id);
+	} else {
+		fs_changelog(context.ts(), "MATERIALIZE(%" PRIu32 ")", dir->id);
+	}
+
+	FSNodeDirectory *source = fsnodes_id_to_node<FSNodeDirectory>(entry.source);
+	if (!source || source->type != FSNode::kDirectory) {
+		lzfs_pretty_syslog(LOG_ERR, "structure error - source %" PRIu32
+		                   " of lazy snapshot %" PRIu32 " not found", entry.source, dir->id);
+		return;
+	}
+
+	SnapshotTask::SubtaskContainer children;
+	children.reserve(source->entries.size());
+	for (const auto &child : source->entries) {
+		children.emplace_back(child.second->id, (HString)child.first);
+	}
+	if (children.empty()) {
+		return;
+	}
+
+	SnapshotTask task(std::move(children), 0, dir->id, 0, 0, 0, true, false, true,
+	                  defer_changelog);
+	intrusive_list<TaskManager::Task> unused;
+	while (!task.isFinished()) {
+		int status = task.execute(context.ts(), unused);
+		if (status != LIZARDFS_STATUS_OK) {
+			lzfs_pretty_syslog(LOG_ERR, "can't materialize lazy snapshot %" PRIu32 ": %s",
+			                   dir->id, lizardfs_error_string(status));
+		}
+	}
+}
+
+/*! \brief Materialize all lazy snapshots of the given directory. */
+static void fsnodes_lazy_snapshot_materialize_clones(const FsContext &context,
+		FSNodeDirectory *source) {
+	if (!gMetadata->lazy_snapshots.isSource(source->id)) {
+		return;
+	}
+	for (uint32_t clone : gMetadata->lazy_snapshots.clonesOf(source->id)) {
+		FSNodeDirectory *dir = fsnodes_id_to_node<FSNodeDirectory>(clone);
+		if (dir) {
+			fsnodes_lazy_snapshot_materialize(context, dir);
+		}
+	}
+}
+
+void fsnodes_lazy_snapshot_protect(const FsContext &context, FSNode *node) {
+	if (!context.isPersonalityMaster() || gMetadata->lazy_snapshots.empty()) {
+		return;
+	}
+
+	// Lazy snapshots of an ancestor share the node only via ancestors which are
+	// lazy themselves, so materialization has to proceed from the top.
+	std::vector<FSNodeDirectory *> path;
+	for (uint32_t parent_id : node->parent) {
+		path.clear();
+		FSNodeDirectory *dir = fsnodes_id_to_node<FSNodeDirectory>(parent_id);
+		while (dir) {
+			path.push_back(dir);
+			if (dir == gMetadata->root || dir->parent.empty()) {
+				break;
+			}
+			dir = fsnodes_id_to_node<FSNodeDirectory>(dir->parent[0]);
+		}
+		for (auto it = path.rbegin(); it != path.rend(); ++it) {
+			fsnodes_lazy_snapshot_materialize_clones(context, *it);
+		}
+	}
+}
+
+void fsnodes_lazy_snapshot_protect_dir(const FsContext &context, FSNodeDirectory *dir) {
+	if (!context.isPersonalityMaster() || gMetadata->lazy_snapshots.empty()) {
+		return;
+	}
+	fsnodes_lazy_snapshot_protect(context, dir);
+	fsnodes_lazy_snapshot_materialize_clones(context, dir);
+	fsnodes_lazy_snapshot_materialize(context, dir);
+}
+
+void fsnodes_lazy_snapshot_protect_subtree(const FsContext &context, FSNode *node) {
+	if (!context.isPersonalityMaster() || gMetadata->lazy_snapshots.empty()) {
+		return;
+	}
+	fsnodes_lazy_snapshot_protect(context, node);
+
+	std::vector<FSNodeDirectory *> stack;
+	if (node->type == FSNode::kDirectory) {
+		stack.push_back(static_cast<FSNodeDirectory *>(node));
+	}
+	while (!stack.empty() && !gMetadata->lazy_snapshots.empty()) {
+		FSNodeDirectory *dir = stack.back();
+		stack.pop_back();
+		fsnodes_lazy_snapshot_materialize_clones(context, dir);
+		fsnodes_lazy_snapshot_materialize(context, dir);
+		for (const auto &entry : dir->entries) {
+			if (entry.second->type == FSNode::kDirectory) {
+				stack.push_back(static_cast<FSNodeDirectory *>(entry.second));
+			}
+		}
+	}
+}
+
+/*! \brief Create lazy snapshot of a directory.
+ *
+ * Snapshot is created in constant time - only destination directory is created
+ * and the whole operation is stored in changelog as a single LAZYCLONE entry.
+ */
+static uint8_t fs_lazy_snapshot(const FsContext &context, FSNodeDirectory *src_node,
+		FSNodeDirectory *dst_parent_node, const HString &name_dst) {
+	statsrecord sr;
+	fsnodes_get_stats(src_node, &sr);
+	if (fsnodes_quota_exceeded_ug(src_node, {{QuotaResource::kInodes, 1}}) ||
+	    fsnodes_quota_exceeded_dir(dst_parent_node, {{QuotaResource::kInodes, sr.inodes},
+	                                                 {QuotaResource::kSize, sr.size}})) {
+		return LIZARDFS_ERROR_QUOTA;
+	}
+
+	SnapshotTask task({{src_node->id, name_dst}}, src_node->id, dst_parent_node->id, 0, 0, 0,
+	                  true, false, true);
+	return task.cloneNode(context.ts());
 }
 
 uint8_t fs_snapshot(const FsContext &context, uint32_t inode_src, uint32_t parent_dst,
@@ -63,6 +241,13 @@ uint8_t fs_snapshot(const FsContext &context, uint32_t inode_src, uint32_t paren
 
 	assert(context.isPersonalityMaster());
 
+	fsnodes_lazy_snapshot_protect_dir(context, static_cast<FSNodeDirectory *>(dst_parent_node));
+	if (gLazySnapshots && src_node->type == FSNode::kDirectory &&
+	    !fsnodes_lookup(static_cast<FSNodeDirectory *>(dst_parent_node), name_dst)) {
+		return fs_lazy_snapshot(context, static_cast<FSNodeDirectory *>(src_node),
+		                        static_cast<FSNodeDirectory *>(dst_parent_node), name_dst);
+	}
+
 	auto task = new SnapshotTask({{src_node->id, name_dst}}, src_node->id,
 	                                   static_cast<FSNodeDirectory *>(dst_parent_node)->id,
 	                                   0, can_overwrite, ignore_missing_src, true, true);
@@ -94,3 +279,25 @@ uint8_t fs_clone_node(const FsContext &context, uint32_t inode_src, uint32_t par
 
 	return task.cloneNode(context.ts());
 }
+
+uint8_t fs_lazy_clone_node(const FsContext &context, uint32_t inode_src, uint32_t parent_dst,
+			uint32_t inode_dst, const HString &name_dst) {
+
+	SnapshotTask task({{inode_src, name_dst}}, 0, parent_dst, inode_dst, 0, 0, false, false,
+	                  true);
+
+	return task.cloneNode(context.ts());
+}
+
+uint8_t fs_apply_materialize(uint32_t inode) {
+	FSNodeDirectory *dir = fsnodes_id_to_node<FSNodeDirectory>(inode);
+	if (!dir || dir->type != FSNode::kDirectory) {
+		return LIZARDFS_ERROR_ENOENT;
+	}
+	LazySnapshotRegistry::Entry entry;
+	if (!fsnodes_lazy_snapshot_detach(dir, &entry)) {
+		return LIZARDFS_ERROR_EINVAL;
+	}
+	gMetadata->metaversion++;
+	return LIZARDFS_STATUS_OK;
+}
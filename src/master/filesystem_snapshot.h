@@ -21,6 +21,7 @@
 #include "common/platform.h"
 
 #include "master/filesystem.h"
+#include "master/filesystem_node_types.h"
 #include "master/fs_context.h"
 
 void fs_read_snapshot_config_file();
@@ -51,3 +52,54 @@ uint8_t fs_snapshot(const FsContext &context, uint32_t inode_src, uint32_t paren
 uint8_t fs_clone_node(const FsContext &context, uint32_t inode_src, uint32_t parent_dst,
 		uint32_t inode_dst, const HString &name_dst,
 		uint8_t can_overwrite);
+
+/*! \brief Clone one inode as a part of lazy snapshot.
+ *
+ * Directories are not copied, they become lazy snapshots of the source directory.
+ *
+ * \param context server context.
+ * \param inode_src number of inode to clone.
+ * \param parent_dst number of inode of the directory where source inode should be cloned to.
+ * \param inode_dst inode number that should be used for clone's inode.
+ * \param name_dst clone name.
+ */
+uint8_t fs_lazy_clone_node(const FsContext &context, uint32_t inode_src, uint32_t parent_dst,
+		uint32_t inode_dst, const HString &name_dst);
+
+/*! \brief Apply MATERIALIZE changelog entry - stop sharing contents of lazy snapshot. */
+uint8_t fs_apply_materialize(uint32_t inode);
+
+/*! \brief Register directory as lazy snapshot of source directory. */
+void fsnodes_lazy_snapshot_register(const FSNodeDirectory *source, FSNodeDirectory *clone);
+
+/*! \brief Returns directory whose entries are contents of the given directory.
+ *
+ * For lazy snapshot it is its source directory, otherwise the directory itself.
+ */
+const FSNodeDirectory *fsnodes_lazy_snapshot_resolve(const FSNodeDirectory *dir);
+
+/*! \brief Clone (one level of) contents of lazy snapshot into the directory.
+ *
+ * Does nothing if the directory is not a lazy snapshot or context is not master's.
+ *
+ * Operations which only read the directory (lookup, readdir) still need the clones,
+ * as they return their inode numbers, but they pass defer_changelog, so that changelog
+ * entries of the materialization are added only together with the next modification
+ * of metadata (see fs_changelog_defer). Materialization reproduces the current contents
+ * of the source, which is not modified until then without materializing its snapshots
+ * first, so shadow masters end up with exactly the same nodes.
+ */
+void fsnodes_lazy_snapshot_materialize(const FsContext &context, FSNodeDirectory *dir,
+		bool defer_changelog = false);
+
+/*! \brief Prepare node for modification of its attributes or data.
+ *
+ * Materializes lazy snapshots which share the node through its ancestors.
+ */
+void fsnodes_lazy_snapshot_protect(const FsContext &context, FSNode *node);
+
+/*! \brief Prepare directory for modification of its entries. */
+void fsnodes_lazy_snapshot_protect_dir(const FsContext &context, FSNodeDirectory *dir);
+
+/*! \brief Prepare whole subtree for (recursive) modification. */
+void fsnodes_lazy_snapshot_protect_subtree(const FsContext &context, FSNode *node);
@@ -20,8 +20,13 @@
 #include "common/platform.h"
 #include "master/filesystem_store.h"
 
+#include <unistd.h>
 #include <cstdio>
+#include <cstdlib>
 #include <fstream>
+#include <functional>
+#include <string>
+#include <thread>
 #include <vector>
 
 #include "common/cwrap.h"
@@ -29,8 +34,10 @@
 #include "common/setup.h"
 #include "common/lizardfs_version.h"
 #include "common/metadata.h"
+#include "common/metadata_compression.h"
 #include "common/rotate_files.h"
 #include "common/setup.h"
+#include "common/time_utils.h"
 
 #include "master/changelog.h"
 #include "master/filesystem.h"
@@ -56,33 +63,31 @@ constexpr uint8_t kMetadataVersionWithLockIds = 0x29;
 char const MetadataStructureReadErrorMsg[] = "error reading metadata (structure)";
 
 void xattr_store(FILE *fd) {
+	const XattrStorage &storage = gMetadata->xattr_storage;
 	uint8_t hdrbuff[4 + 1 + 4];
 	uint8_t *ptr;
-	uint32_t i;
-	xattr_data_entry *xa;
-
-	for (i = 0; i < XATTR_DATA_HASH_SIZE; i++) {
-		for (xa = gMetadata->xattr_data_hash[i]; xa; xa = xa->next) {
-			ptr = hdrbuff;
-			put32bit(&ptr, xa->inode);
-			put8bit(&ptr, xa->anleng);
-			put32bit(&ptr, xa->avleng);
-			if (fwrite(hdrbuff, 1, 4 + 1 + 4, fd) != (size_t)(4 + 1 + 4)) {
-				lzfs_pretty_syslog(LOG_NOTICE, "fwrite error");
-				return;
-			}
-			if (fwrite(xa->attrname, 1, xa->anleng, fd) != (size_t)(xa->anleng)) {
-				lzfs_pretty_syslog(LOG_NOTICE, "fwrite error");
-				return;
-			}
-			if (xa->avleng > 0) {
-				if (fwrite(xa->attrvalue, 1, xa->avleng, fd) !=
-				    (size_t)(xa->avleng)) {
-					lzfs_pretty_syslog(LOG_NOTICE, "fwrite error");
-					return;
-				}
-			}
+	bool ok = true;
+
+	storage.forEach([fd, &storage, &hdrbuff, &ptr, &ok](const XattrStorage::Entry &entry) {
+		if (!ok) {
+			return;
+		}
+		ptr = hdrbuff;
+		put32bit(&ptr, entry.inode);
+		put8bit(&ptr, storage.nameLength(entry));
+		put32bit(&ptr, storage.valueLength(entry));
+		if (fwrite(hdrbuff, 1, 4 + 1 + 4, fd) != (size_t)(4 + 1 + 4) ||
+		    fwrite(storage.name(entry), 1, storage.nameLength(entry), fd) !=
+		            (size_t)storage.nameLength(entry) ||
+		    (storage.valueLength(entry) > 0 &&
+		     fwrite(storage.value(entry), 1, storage.valueLength(entry), fd) !=
+		             (size_t)storage.valueLength(entry))) {
+			lzfs_pretty_syslog(LOG_NOTICE, "fwrite error");
+			ok = false;
 		}
+	});
+	if (!ok) {
+		return;
 	}
 	memset(hdrbuff, 0, 4 + 1 + 4);
 	if (fwrite(hdrbuff, 1, 4 + 1 + 4, fd) != (size_t)(4 + 1 + 4)) {
@@ -92,14 +97,14 @@ void xattr_store(FILE *fd) {
 }
 
 int xattr_load(FILE *fd, int ignoreflag) {
+	XattrStorage &storage = gMetadata->xattr_storage;
 	uint8_t hdrbuff[4 + 1 + 4];
 	const uint8_t *ptr;
 	uint32_t inode;
 	uint8_t anleng;
 	uint32_t avleng;
-	xattr_data_entry *xa;
-	xattr_inode_entry *ih;
-	uint32_t hash, ihash;
+	uint8_t attrname[256];
+	std::vector<uint8_t> attrvalue;
 
 	while (1) {
 		if (fread(hdrbuff, 1, 4 + 1 + 4, fd) != 4 + 1 + 4) {
@@ -132,12 +137,11 @@ int xattr_load(FILE *fd, int ignoreflag) {
 			}
 		}
 
-		ihash = xattr_inode_hash_fn(inode);
-		for (ih = gMetadata->xattr_inode_hash[ihash]; ih && ih->inode != inode;
-			ih = ih->next) {
-		}
-
-		if (ih && ih->anleng + anleng + 1 > MFS_XATTR_LIST_MAX) {
+		uint32_t namelist_leng = 0;
+		storage.forEachOfInode(inode, [&storage, &namelist_leng](const XattrStorage::Entry &entry) {
+			namelist_leng += storage.nameLength(entry) + 1U;
+		});
+		if (namelist_leng + anleng + 1 > MFS_XATTR_LIST_MAX) {
 			lzfs_pretty_syslog(LOG_ERR, "loading xattr: name list too long");
 			if (ignoreflag) {
 				fseek(fd, anleng + avleng, SEEK_CUR);
@@ -147,60 +151,18 @@ int xattr_load(FILE *fd, int ignoreflag) {
 			}
 		}
 
-		xa = new xattr_data_entry;
-		xa->inode = inode;
-		xa->attrname = (uint8_t *)malloc(anleng);
-		passert(xa->attrname);
-		if (fread(xa->attrname, 1, anleng, fd) != (size_t)anleng) {
-			int err = errno;
-			delete xa;
-			errno = err;
+		attrvalue.resize(avleng);
+		if (fread(attrname, 1, anleng, fd) != (size_t)anleng ||
+		    fread(attrvalue.data(), 1, avleng, fd) != (size_t)avleng) {
 			lzfs_pretty_errlog(LOG_ERR, "loading xattr: read error");
 			return -1;
 		}
-		xa->anleng = anleng;
-		if (avleng > 0) {
-			xa->attrvalue = (uint8_t *)malloc(avleng);
-			passert(xa->attrvalue);
-			if (fread(xa->attrvalue, 1, avleng, fd) != (size_t)avleng) {
-				int err = errno;
-				delete xa;
-				errno = err;
-				lzfs_pretty_errlog(LOG_ERR, "loading xattr: read error");
-				return -1;
-			}
-		} else {
-			xa->attrvalue = NULL;
-		}
-		xa->avleng = avleng;
-		hash = xattr_data_hash_fn(inode, xa->anleng, xa->attrname);
-		xa->next = gMetadata->xattr_data_hash[hash];
-		if (xa->next) {
-			xa->next->prev = &(xa->next);
-		}
-		xa->prev = gMetadata->xattr_data_hash + hash;
-		gMetadata->xattr_data_hash[hash] = xa;
-
-		if (ih) {
-			xa->nextinode = ih->data_head;
-			if (xa->nextinode) {
-				xa->nextinode->previnode = &(xa->nextinode);
-			}
-			xa->previnode = &(ih->data_head);
-			ih->data_head = xa;
-			ih->anleng += anleng + 1U;
-			ih->avleng += avleng;
+		XattrStorage::Entry *entry = storage.find(inode, attrname, anleng);
+		if (entry) {
+			// the last value wins, as it did when duplicates shadowed each other
+			storage.setValue(entry, attrvalue.data(), avleng);
 		} else {
-			ih = (xattr_inode_entry *)malloc(sizeof(xattr_inode_entry));
-			passert(ih);
-			ih->inode = inode;
-			xa->nextinode = NULL;
-			xa->previnode = &(ih->data_head);
-			ih->data_head = xa;
-			ih->anleng = anleng + 1U;
-			ih->avleng = avleng;
-			ih->next = gMetadata->xattr_inode_hash[ihash];
-			gMetadata->xattr_inode_hash[ihash] = ih;
+			storage.insert(inode, attrname, anleng, attrvalue.data(), avleng);
 		}
 	}
 }
@@ -658,6 +620,7 @@ int fs_loadnode(FILE *fd) {
 	nodepos = NODEHASHPOS(p->id);
 	p->next = gMetadata->nodehash[nodepos];
 	gMetadata->nodehash[nodepos] = p;
+	gMetadata->node_table.insert(p->id, p);
 	gMetadata->inode_pool.markAsAcquired(p->id);
 	gMetadata->nodes++;
 	if (type == FSNode::kDirectory) {
@@ -727,6 +690,80 @@ static void fs_storelocks(FILE *fd) {
 	gMetadata->posix_locks.store(fd);
 }
 
+static const uint32_t kLazySnapshotRecordSize = 4 + 4 + 4 * 4 + 3 * 8;
+
+static void fs_store_lazy_snapshots(FILE *fd) {
+	uint8_t wbuff[kLazySnapshotRecordSize], *ptr;
+
+	ptr = wbuff;
+	put32bit(&ptr, gMetadata->lazy_snapshots.size());
+	if (fwrite(wbuff, 1, 4, fd) != (size_t)4) {
+		lzfs_pretty_syslog(LOG_NOTICE, "fwrite error");
+		return;
+	}
+	for (const auto &clone : gMetadata->lazy_snapshots) {
+		const statsrecord &sr = clone.second.stats;
+		ptr = wbuff;
+		put32bit(&ptr, clone.first);
+		put32bit(&ptr, clone.second.source);
+		put32bit(&ptr, sr.inodes);
+		put32bit(&ptr, sr.dirs);
+		put32bit(&ptr, sr.files);
+		put32bit(&ptr, sr.chunks);
+		put64bit(&ptr, sr.length);
+		put64bit(&ptr, sr.size);
+		put64bit(&ptr, sr.realsize);
+		if (fwrite(wbuff, 1, kLazySnapshotRecordSize, fd) != (size_t)kLazySnapshotRecordSize) {
+			lzfs_pretty_syslog(LOG_NOTICE, "fwrite error");
+			return;
+		}
+	}
+}
+
+static int fs_load_lazy_snapshots(FILE *fd, int ignoreflag) {
+	uint8_t rbuff[kLazySnapshotRecordSize];
+	const uint8_t *ptr;
+
+	if (fread(rbuff, 1, 4, fd) != 4) {
+		lzfs_pretty_errlog(LOG_ERR, "loading lazy snapshots: read error");
+		return -1;
+	}
+	ptr = rbuff;
+	uint32_t count = get32bit(&ptr);
+	for (uint32_t i = 0; i < count; ++i) {
+		if (fread(rbuff, 1, kLazySnapshotRecordSize, fd) != kLazySnapshotRecordSize) {
+			lzfs_pretty_errlog(LOG_ERR, "loading lazy snapshots: read error");
+			return -1;
+		}
+		ptr = rbuff;
+		uint32_t clone = get32bit(&ptr);
+		uint32_t source = get32bit(&ptr);
+		statsrecord sr;
+		sr.inodes = get32bit(&ptr);
+		sr.dirs = get32bit(&ptr);
+		sr.files = get32bit(&ptr);
+		sr.chunks = get32bit(&ptr);
+		sr.length = get64bit(&ptr);
+		sr.size = get64bit(&ptr);
+		sr.realsize = get64bit(&ptr);
+
+		FSNodeDirectory *dir = fsnodes_id_to_node<FSNodeDirectory>(clone);
+		if (!dir || dir->type != FSNode::kDirectory || !dir->entries.empty() ||
+		    !fsnodes_id_to_node(source)) {
+			lzfs_pretty_syslog(LOG_ERR, "loading lazy snapshots: wrong entry (%" PRIu32
+			                   " -> %" PRIu32 ")", clone, source);
+			if (ignoreflag) {
+				continue;
+			}
+			return -1;
+		}
+		if (gMetadata->lazy_snapshots.add(clone, source, sr)) {
+			fsnodes_add_stats(dir, &sr);
+		}
+	}
+	return 0;
+}
+
 int fs_lostnode(FSNode *p) {
 	uint8_t artname[40];
 	uint32_t i, l;
@@ -969,7 +1006,7 @@ void fs_store(FILE *fd, uint8_t fver) {
 			return;
 		}
 		fs_store_acls(fd);
-		if (process_section("ACLS 1.2", hdr, ptr, offbegin, offend, fd) != LIZARDFS_STATUS_OK) {
+		if (process_section("ACLS 1.3", hdr, ptr, offbegin, offend, fd) != LIZARDFS_STATUS_OK) {
 			return;
 		}
 		fs_storequotas(fd);
@@ -980,6 +1017,12 @@ void fs_store(FILE *fd, uint8_t fver) {
 		if (process_section("FLCK 1.0", hdr, ptr, offbegin, offend, fd) != LIZARDFS_STATUS_OK) {
 			return;
 		}
+		if (!gMetadata->lazy_snapshots.empty()) {
+			fs_store_lazy_snapshots(fd);
+			if (process_section("LZSN 1.0", hdr, ptr, offbegin, offend, fd) != LIZARDFS_STATUS_OK) {
+				return;
+			}
+		}
 	}
 	chunk_store(fd);
 	if (fver >= kMetadataVersionWithSections) {
@@ -1016,6 +1059,153 @@ void fs_store_fd(FILE *fd) {
 	}
 }
 
+#ifdef LIZARDFS_HAVE_METADATA_COMPRESSION
+typedef void (*StoreFunction)(FILE *);
+
+/*
+ * Stores a section compressed block by block. Size of the section is known when it's
+ * stored, so its header is written as a block which isn't compressed and overwritten later,
+ * like process_section does in uncompressed files.
+ */
+static bool fs_store_compressed_section(FILE *fd, const char *label, StoreFunction store,
+		int level) {
+	uint8_t hdr[16];
+	uint8_t *ptr = hdr + 8;
+	memcpy(hdr, label, 8);
+	put64bit(&ptr, 0);
+	off_t offbegin = ftello(fd);
+	if (offbegin < 0 || !metadataWriteStoredBlock(fd, hdr, 16)) {
+		return false;
+	}
+	CompressedMetadataPart data(fd, level);
+	store(data.stream());
+	data.finish();
+	off_t offend = ftello(fd);
+	ptr = hdr + 8;
+	put64bit(&ptr, data.rawSize());
+	return offend >= 0 && fseeko(fd, offbegin, SEEK_SET) == 0 &&
+	       metadataWriteStoredBlock(fd, hdr, 16) && fseeko(fd, offend, SEEK_SET) == 0;
+}
+
+/* Opens a temporary file next to fname, which is removed when it's closed */
+static FILE *fs_open_temporary_file(const char *fname) {
+	std::string path = std::string(fname) + ".XXXXXX";
+	int fd = mkstemp(&path[0]);
+	if (fd < 0) {
+		return nullptr;
+	}
+	unlink(path.c_str());
+	FILE *result = fdopen(fd, "w+");
+	if (result == nullptr) {
+		close(fd);
+	}
+	return result;
+}
+
+static bool fs_copy_file(FILE *from, FILE *to) {
+	std::vector<uint8_t> buffer(CompressedMetadataPart::kBlockSize);
+	if (fseeko(from, 0, SEEK_SET) != 0) {
+		return false;
+	}
+	size_t size;
+	while ((size = fread(buffer.data(), 1, buffer.size(), from)) > 0) {
+		if (fwrite(buffer.data(), 1, size, to) != size) {
+			return false;
+		}
+	}
+	return ferror(from) == 0;
+}
+
+/*
+ * Sections are serialized by separate threads. The first group of sections is written
+ * directly to fd, the other ones are written to temporary files next to fname and copied
+ * to fd in the usual order, so memory used by the dump doesn't grow with size of metadata
+ * (every thread keeps one block). Nodes and edges are stored by one thread, because both
+ * of them read names, which are not thread safe in every name storage.
+ */
+bool fs_store_compressed_fd(FILE *fd, int level, const char *fname) {
+	struct Section {
+		const char *label;
+		StoreFunction store;
+	};
+	struct Group {
+		std::vector<Section> sections;
+		FILE *tmp;
+		bool ok;
+	};
+	std::vector<Group> groups;
+	auto add_group = [&](std::initializer_list<Section> sections) {
+		groups.push_back({sections, nullptr, true});
+	};
+	add_group({{"NODE 1.0", fs_storenodes}, {"EDGE 1.0", fs_storeedges}});
+	add_group({{"FREE 1.0", fs_storefree}});
+	add_group({{"XATR 1.0", xattr_store}});
+	add_group({{"ACLS 1.3", fs_store_acls}});
+	add_group({{"QUOT 1.1", fs_storequotas}});
+	add_group({{"FLCK 1.0", fs_storelocks}});
+	if (!gMetadata->lazy_snapshots.empty()) {
+		add_group({{"LZSN 1.0", fs_store_lazy_snapshots}});
+	}
+	add_group({{"CHNK 1.0", chunk_store}});
+
+	auto store_group = [level](Group &group, FILE *out) {
+		for (const auto &section : group.sections) {
+			group.ok = group.ok &&
+			           fs_store_compressed_section(out, section.label, section.store, level);
+		}
+		group.ok = group.ok && ferror(out) == 0;
+	};
+
+	std::vector<std::thread> threads(groups.size());
+	for (std::size_t i = 1; i < groups.size(); ++i) {
+		Group &group = groups[i];
+		// If there is no temporary file, the group is stored later by this thread
+		group.tmp = fs_open_temporary_file(fname);
+		if (group.tmp) {
+			threads[i] = std::thread(store_group, std::ref(group), group.tmp);
+		}
+	}
+
+	/* Note LIZARDFSSIGNATURE instead of MFSSIGNATURE! */
+	const char signature[] = LIZARDFSSIGNATURE "M 2.9";
+	uint8_t hdr[16];
+	uint8_t *ptr = hdr;
+	bool ok = metadataWriteCompressedHeader(fd);
+	{
+		CompressedMetadataPart header(fd, level);
+		header.append(reinterpret_cast<const uint8_t *>(signature), sizeof(signature) - 1);
+		put32bit(&ptr, gMetadata->maxnodeid);
+		put64bit(&ptr, gMetadata->metaversion);
+		put32bit(&ptr, gMetadata->nextsessionid);
+		header.append(hdr, 16);
+		header.finish();
+	}
+
+	for (std::size_t i = 0; i < groups.size(); ++i) {
+		Group &group = groups[i];
+		if (group.tmp) {
+			threads[i].join();
+			ok = ok && group.ok && fs_copy_file(group.tmp, fd);
+			fclose(group.tmp);
+		} else {
+			store_group(group, fd);
+			ok = ok && group.ok;
+		}
+	}
+
+	{
+		CompressedMetadataPart eof_marker(fd, level);
+		eof_marker.append(reinterpret_cast<const uint8_t *>("[MFS EOF MARKER]"), 16);
+		eof_marker.finish();
+	}
+	ok = ok && metadataWriteCompressedEnd(fd) && ferror(fd) == 0;
+	if (!ok) {
+		lzfs_pretty_syslog(LOG_NOTICE, "fwrite error");
+	}
+	return ok;
+}
+#endif
+
 uint64_t fs_loadversion(FILE *fd) {
 	uint8_t hdr[12];
 	const uint8_t *ptr;
@@ -1161,6 +1351,17 @@ int fs_load(FILE *fd, int ignoreflag, uint8_t fver) {
 				if (fs_load_acls(fd, ignoreflag) < 0) {
 #ifndef METARESTORE
 					lzfs_pretty_syslog(LOG_ERR, "error reading access control lists");
+#endif
+					return -1;
+				}
+			} else if (memcmp(hdr, "ACLS 1.3", 8) == 0) {
+				lzfs_pretty_syslog_attempt(
+				        LOG_INFO,
+				        "loading access control lists from the metadata file");
+				fflush(stderr);
+				if (fs_load_shared_acls(fd, ignoreflag) < 0) {
+#ifndef METARESTORE
+					lzfs_pretty_syslog(LOG_ERR, "error reading access control lists");
 #endif
 					return -1;
 				}
@@ -1184,6 +1385,15 @@ int fs_load(FILE *fd, int ignoreflag, uint8_t fver) {
 				if (fs_loadlocks(fd, ignoreflag) < 0) {
 #ifndef METARESTORE
 					lzfs_pretty_syslog(LOG_ERR, "error reading metadata (chunks)");
+#endif
+					return -1;
+				}
+			} else if (memcmp(hdr, "LZSN 1.0", 8) == 0) {
+				lzfs_pretty_syslog_attempt(LOG_INFO, "loading lazy snapshots from the metadata file");
+				fflush(stderr);
+				if (fs_load_lazy_snapshots(fd, ignoreflag) < 0) {
+#ifndef METARESTORE
+					lzfs_pretty_syslog(LOG_ERR, "error reading metadata (lazy snapshots)");
 #endif
 					return -1;
 				}
@@ -1239,7 +1449,6 @@ int fs_load(FILE *fd, int ignoreflag, uint8_t fver) {
 	return 0;
 }
 
-#ifndef METARESTORE
 void fs_new(void) {
 	uint32_t nodepos;
 	gMetadata->maxnodeid = SPECIAL_INODE_ROOT;
@@ -1256,6 +1465,7 @@ void fs_new(void) {
 	nodepos = NODEHASHPOS(gMetadata->root->id);
 	gMetadata->root->next = gMetadata->nodehash[nodepos];
 	gMetadata->nodehash[nodepos] = gMetadata->root;
+	gMetadata->node_table.insert(gMetadata->root->id, gMetadata->root);
 	gMetadata->inode_pool.markAsAcquired(gMetadata->root->id);
 	chunk_newfs();
 	gMetadata->nodes = 1;
@@ -1264,7 +1474,6 @@ void fs_new(void) {
 	fs_checksum(ChecksumMode::kForceRecalculate);
 	fsnodes_quota_update(gMetadata->root, {{QuotaResource::kInodes, +1}});
 }
-#endif
 
 int fs_emergency_storeall(const std::string &fname) {
 	cstream_t fd(fopen(fname.c_str(), "w"));
@@ -1390,34 +1599,46 @@ void fs_load_changelogs() {
 }
 
 /*
- * Load and apply given changelog file.
+ * Load and apply given changelog file. Lines are read and parsed by a separate thread
+ * while entries are applied.
  */
 void fs_load_changelog(const std::string &path) {
 	std::string fullFileName = fs::getCurrentWorkingDirectoryNoThrow() + "/" + path;
 	std::ifstream changelog(path);
-	std::string line;
-	size_t end = 0;
 	sassert(gMetadata->metaversion > 0);
 
+	// entries older than this are skipped for sure, so they don't need to be parsed
+	const uint64_t initialVersion = fs_getversion();
 	uint64_t first = 0;
 	uint64_t id = 0;
 	uint64_t skippedEntries = 0;
 	uint64_t appliedEntries = 0;
-	while (std::getline(changelog, line).good()) {
-		id = stoull(line, &end);
-		if (id < fs_getversion()) {
-			++skippedEntries;
-			continue;
-		} else if (!first) {
-			first = id;
-		}
-		++appliedEntries;
-		uint8_t status = restore(path.c_str(), id, line.c_str() + end,
-		                         RestoreRigor::kIgnoreParseErrors);
-		if (status != LIZARDFS_STATUS_OK) {
-			throw MetadataConsistencyException("can't apply changelog " + fullFileName,
-			                                   status);
-		}
+	uint8_t status = restore_read_ahead(
+			[&](RestoreEntry &entry) {
+				std::string line;
+				size_t end = 0;
+				if (!std::getline(changelog, line).good()) {
+					return false;
+				}
+				entry.version = stoull(line, &end);
+				if (entry.version >= initialVersion) {
+					restore_parse(path.c_str(), entry.version, line.c_str() + end, entry);
+				}
+				return true;
+			},
+			[&](const RestoreEntry &entry) {
+				id = entry.version;
+				if (id < fs_getversion()) {
+					++skippedEntries;
+					return static_cast<uint8_t>(LIZARDFS_STATUS_OK);
+				} else if (!first) {
+					first = id;
+				}
+				++appliedEntries;
+				return restore(entry, RestoreRigor::kIgnoreParseErrors);
+			});
+	if (status != LIZARDFS_STATUS_OK) {
+		throw MetadataConsistencyException("can't apply changelog " + fullFileName, status);
 	}
 	if (appliedEntries > 0) {
 		lzfs_pretty_syslog_attempt(LOG_NOTICE, "%s: %" PRIu64 " changes applied (%" PRIu64
@@ -1451,6 +1672,21 @@ void fs_loadall(const std::string& fname,int ignoreflag) {
 	if (fread(hdr,1,8,fd.get())!=8) {
 		throw MetadataConsistencyException("can't read metadata header");
 	}
+	if (metadataIsCompressed(hdr)) {
+#ifdef LIZARDFS_HAVE_METADATA_COMPRESSION
+		FILE *decompressed = metadataOpenDecompressingStream(fd.get());
+		if (decompressed == nullptr) {
+			throw FilesystemException("can't decompress metadata file: " + errorString(errno));
+		}
+		fd.release();
+		fd.reset(decompressed);
+		if (fread(hdr, 1, 8, fd.get()) != 8) {
+			throw MetadataConsistencyException("can't read metadata header");
+		}
+#else
+		throw MetadataConsistencyException("compressed metadata is not supported in this build");
+#endif
+	}
 #ifndef METARESTORE
 	if (metadataserver::isMaster()) {
 		if (memcmp(hdr, "MFSM NEW", 8) == 0) {    // special case - create new file system
@@ -1493,9 +1729,11 @@ void fs_loadall(const std::string& fname,int ignoreflag) {
 			"%" PRIu32 " inodes including "
 			"%" PRIu32 " directory inodes and "
 			"%" PRIu32 " file inodes, "
-			"%" PRIu32 " chunks)",
+			"%" PRIu32 " chunks, "
+			"%" PRIu64 " MiB used by inodes)",
 			fnameWithPath.c_str(),
-			gMetadata->nodes, gMetadata->dirnodes, gMetadata->filenodes, chunk_count());
+			gMetadata->nodes, gMetadata->dirnodes, gMetadata->filenodes, chunk_count(),
+			fsnodes_memory_usage() >> 20);
 #else
 	lzfs_pretty_syslog(LOG_INFO, "metadata file %s read", fnameWithPath.c_str());
 #endif
@@ -1556,9 +1794,12 @@ uint8_t fs_storeall(MetadataDumper::DumpType dumpType) {
 		return LIZARDFS_ERROR_TEMP_NOTPOSSIBLE;
 	}
 
+	fs_changelog_flush(); // Dumped metadata has to match the changelog
 	fs_erase_message_from_lockfile(); // We are going to do some changes in the data dir right now
 	changelog_rotate();
 	matomlserv_broadcast_logrotate();
+	// No dumping process is running now, so name storage can move strings around
+	hstorage::Storage::instance().compact();
 	// child == true says that we forked
 	// bg may be changed to dump in foreground in case of a fork error
 	bool child = metadataDumper.start(dumpType, fs_checksum(ChecksumMode::kGetCurrent));
@@ -1577,9 +1818,20 @@ uint8_t fs_storeall(MetadataDumper::DumpType dumpType) {
 			return LIZARDFS_ERROR_IO;
 		}
 
+		Timer timer;
+		bool stored = true;
+#ifdef LIZARDFS_HAVE_METADATA_COMPRESSION
+		if (gMetadataCompressionLevel > 0) {
+			stored = fs_store_compressed_fd(fd.get(), gMetadataCompressionLevel,
+			                                kMetadataTmpFilename);
+		} else {
+			fs_store_fd(fd.get());
+		}
+#else
 		fs_store_fd(fd.get());
+#endif
 
-		if (ferror(fd.get()) != 0) {
+		if (!stored || ferror(fd.get()) != 0) {
 			lzfs_pretty_syslog(LOG_ERR, "can't write metadata");
 			fd.reset();
 			unlink(kMetadataTmpFilename);
@@ -1595,6 +1847,9 @@ uint8_t fs_storeall(MetadataDumper::DumpType dumpType) {
 				lzfs_pretty_errlog(LOG_ERR, "metadata fflush failed");
 			} else if (fsync(fileno(fd.get())) == -1) {
 				lzfs_pretty_errlog(LOG_ERR, "metadata fsync failed");
+			} else {
+				lzfs_pretty_syslog(LOG_INFO, "metadata stored in %.3f s (%" PRIu64 " MiB)",
+						timer.elapsed_ms() / 1000., (uint64_t)ftello(fd.get()) >> 20);
 			}
 			fd.reset();
 			if (!child) {
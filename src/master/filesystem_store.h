@@ -24,6 +24,7 @@
 #include <cstdio>
 
 #include "common/exceptions.h"
+#include "common/metadata_compression.h"
 #include "master/metadata_dumper.h"
 
 LIZARDFS_CREATE_EXCEPTION_CLASS(MetadataException, Exception);
@@ -38,4 +39,15 @@ void fs_broadcast_metadata_saved(uint8_t status);
 void fs_load_changelogs();
 void fs_load_changelog(const std::string &path);
 void fs_loadall(const std::string& fname,int ignoreflag);
+
+/// Creates an empty filesystem with the root directory only.
+void fs_new(void);
 void fs_store_fd(FILE *fd);
+#ifdef LIZARDFS_HAVE_METADATA_COMPRESSION
+/*! \brief Stores metadata in blocks compressed in parallel with given zlib compression level.
+ *
+ * \param fname name of the file being written, temporary files are created next to it
+ * \return false if metadata couldn't be written
+ */
+bool fs_store_compressed_fd(FILE *fd, int level, const char *fname);
+#endif
@@ -21,6 +21,7 @@
 #include "master/filesystem_store.h"
 
 #include <cstdio>
+#include <unordered_map>
 #include <vector>
 
 #include "common/cwrap.h"
@@ -67,14 +68,35 @@ static void fs_store_acl(uint32_t id, const RichACL &acl, FILE *fd) {
 	}
 }
 
+/*
+ * ACLS 1.3 section: distinct ACLs with their ids (stored like ACLs of inodes in 1.2),
+ * end marker, then (inode, ACL id) pairs ended with inode 0.
+ */
 void fs_store_acls(FILE *fd) {
-	for (uint32_t i = 0; i < NODEHASHSIZE; ++i) {
-		for (FSNode *p = gMetadata->nodehash[i]; p; p = p->next) {
-			const RichACL *node_acl = gMetadata->acl_storage.get(p->id);
-			if (node_acl) {
-				fs_store_acl(p->id, *node_acl, fd);
-			}
+	gMetadata->acl_storage.forEachAcl([fd](AclStorage::AclId acl_id, const RichACL &acl) {
+		fs_store_acl(acl_id, acl, fd);
+	});
+	fs_store_marker(fd);
+
+	static std::vector<uint8_t> buffer;
+	buffer.clear();
+	bool ok = true;
+	gMetadata->acl_storage.forEach([fd, &ok](AclStorage::InodeId inode, AclStorage::AclId acl_id) {
+		std::size_t offset = buffer.size();
+		buffer.resize(offset + serializedSize(inode, acl_id));
+		uint8_t *destination = buffer.data() + offset;
+		serialize(&destination, inode, acl_id);
+		if (buffer.size() >= 65536) {
+			ok = ok && fwrite(buffer.data(), 1, buffer.size(), fd) == buffer.size();
+			buffer.clear();
 		}
+	});
+	if (ok) {
+		ok = fwrite(buffer.data(), 1, buffer.size(), fd) == buffer.size();
+	}
+	if (!ok) {
+		lzfs_pretty_syslog(LOG_NOTICE, "fwrite error");
+		return;
 	}
 	fs_store_marker(fd);
 }
@@ -312,3 +334,95 @@ int fs_load_acls(FILE *fd, int ignoreflag) {
 
 	return 0;
 }
+
+/*
+ * Loads ACLS 1.3 section. ACLs are acquired in the pool as they are read, ids from the file
+ * are mapped to ids in the pool and references taken here are released at the end.
+ */
+int fs_load_shared_acls(FILE *fd, int ignoreflag) {
+	std::vector<uint8_t> buffer;
+	std::unordered_map<uint32_t, AclStorage::AclId> acl_ids;
+	auto release_acls = [&acl_ids]() {
+		for (const auto &acl_id : acl_ids) {
+			gMetadata->acl_storage.release(acl_id.second);
+		}
+	};
+
+	try {
+		while (true) {
+			// Read size of the entry
+			uint32_t size = 0;
+			buffer.resize(serializedSize(size));
+			if (fread(buffer.data(), 1, buffer.size(), fd) != buffer.size()) {
+				throw Exception(std::string("read error: ") + strerr(errno),
+				                LIZARDFS_ERROR_IO);
+			}
+			deserialize(buffer, size);
+			if (size == 0) {
+				// this is end marker
+				break;
+			} else if (size > 10000000) {
+				throw Exception("strange size of entry: " + std::to_string(size),
+				                LIZARDFS_ERROR_ERANGE);
+			}
+
+			buffer.resize(size);
+			if (fread(buffer.data(), 1, buffer.size(), fd) != buffer.size()) {
+				throw Exception(std::string("read error: ") + strerr(errno),
+				                LIZARDFS_ERROR_IO);
+			}
+			uint32_t file_acl_id;
+			RichACL acl;
+			deserialize(buffer, file_acl_id, acl);
+			if (acl_ids.count(file_acl_id) > 0) {
+				throw Exception("duplicated acl id: " + std::to_string(file_acl_id),
+				                LIZARDFS_ERROR_EINVAL);
+			}
+			acl_ids[file_acl_id] = gMetadata->acl_storage.acquire(std::move(acl));
+		}
+
+		while (true) {
+			uint32_t inode = 0, file_acl_id = 0;
+			buffer.resize(serializedSize(inode));
+			if (fread(buffer.data(), 1, buffer.size(), fd) != buffer.size()) {
+				throw Exception(std::string("read error: ") + strerr(errno),
+				                LIZARDFS_ERROR_IO);
+			}
+			deserialize(buffer, inode);
+			if (inode == 0) {
+				// this is end marker
+				break;
+			}
+			if (fread(buffer.data(), 1, buffer.size(), fd) != buffer.size()) {
+				throw Exception(std::string("read error: ") + strerr(errno),
+				                LIZARDFS_ERROR_IO);
+			}
+			deserialize(buffer, file_acl_id);
+
+			try {
+				FSNode *p = fsnodes_id_to_node(inode);
+				if (!p) {
+					throw Exception("unknown inode: " + std::to_string(inode));
+				}
+				auto acl_id = acl_ids.find(file_acl_id);
+				if (acl_id == acl_ids.end()) {
+					throw Exception("unknown acl id: " + std::to_string(file_acl_id));
+				}
+				gMetadata->acl_storage.set(p->id, acl_id->second);
+			} catch (Exception &ex) {
+				lzfs_pretty_syslog(LOG_ERR, "loading acl: %s", ex.what());
+				if (!ignoreflag) {
+					release_acls();
+					return -1;
+				}
+			}
+		}
+	} catch (Exception &ex) {
+		lzfs_pretty_syslog(LOG_ERR, "loading acl: %s", ex.what());
+		release_acls();
+		return -1;
+	}
+
+	release_acls();
+	return 0;
+}
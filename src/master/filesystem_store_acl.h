@@ -28,5 +28,6 @@
 int fs_load_legacy_acls(FILE *fd, int ignoreflag);
 int fs_load_posix_acls(FILE *fd, int ignoreflag);
 int fs_load_acls(FILE *fd, int ignoreflag);
-int fs_store_acls(FILE *fd);
+int fs_load_shared_acls(FILE *fd, int ignoreflag);
+void fs_store_acls(FILE *fd);
 
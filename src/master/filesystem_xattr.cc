@@ -23,89 +23,69 @@
 #include "master/filesystem_checksum.h"
 #include "master/filesystem_xattr.h"
 
-static uint64_t xattr_checksum(const xattr_data_entry *xde) {
-	if (!xde) {
-		return 0;
-	}
+static uint64_t xattr_checksum(const XattrStorage::Entry &entry) {
+	const XattrStorage &storage = gMetadata->xattr_storage;
 	uint64_t seed = 645819511511147ULL;
-	hashCombine(seed, xde->inode, ByteArray(xde->attrname, xde->anleng),
-	            ByteArray(xde->attrvalue, xde->avleng));
+	hashCombine(seed, entry.inode, ByteArray(storage.name(entry), storage.nameLength(entry)),
+	            ByteArray(storage.value(entry), storage.valueLength(entry)));
 	return seed;
 }
 
-static void xattr_update_checksum(xattr_data_entry *xde) {
-	if (!xde) {
-		return;
-	}
-	if (gChecksumBackgroundUpdater.isXattrIncluded(xde)) {
-		removeFromChecksum(gChecksumBackgroundUpdater.xattrChecksum, xde->checksum);
-	}
-	removeFromChecksum(gMetadata->xattrChecksum, xde->checksum);
-	xde->checksum = xattr_checksum(xde);
-	if (gChecksumBackgroundUpdater.isXattrIncluded(xde)) {
-		addToChecksum(gChecksumBackgroundUpdater.xattrChecksum, xde->checksum);
+static void xattr_checksum_add(const XattrStorage::Entry &entry) {
+	uint64_t checksum = xattr_checksum(entry);
+	if (gChecksumBackgroundUpdater.isXattrIncluded(entry.inode)) {
+		addToChecksum(gChecksumBackgroundUpdater.xattrChecksum, checksum);
 	}
-	addToChecksum(gMetadata->xattrChecksum, xde->checksum);
+	addToChecksum(gMetadata->xattrChecksum, checksum);
 }
 
-static inline void xattr_removeentry(xattr_data_entry *xa) {
-	*(xa->previnode) = xa->nextinode;
-	if (xa->nextinode) {
-		xa->nextinode->previnode = xa->previnode;
-	}
-	*(xa->prev) = xa->next;
-	if (xa->next) {
-		xa->next->prev = xa->prev;
-	}
-	if (gChecksumBackgroundUpdater.isXattrIncluded(xa)) {
-		removeFromChecksum(gChecksumBackgroundUpdater.xattrChecksum, xa->checksum);
+static void xattr_checksum_remove(const XattrStorage::Entry &entry) {
+	uint64_t checksum = xattr_checksum(entry);
+	if (gChecksumBackgroundUpdater.isXattrIncluded(entry.inode)) {
+		removeFromChecksum(gChecksumBackgroundUpdater.xattrChecksum, checksum);
 	}
-	removeFromChecksum(gMetadata->xattrChecksum, xa->checksum);
-	delete xa;
+	removeFromChecksum(gMetadata->xattrChecksum, checksum);
 }
 
-void xattr_checksum_add_to_background(xattr_data_entry *xde) {
-	if (!xde) {
-		return;
-	}
-	removeFromChecksum(gMetadata->xattrChecksum, xde->checksum);
-	xde->checksum = xattr_checksum(xde);
-	addToChecksum(gMetadata->xattrChecksum, xde->checksum);
-	addToChecksum(gChecksumBackgroundUpdater.xattrChecksum, xde->checksum);
+static inline void xattr_removeentry(XattrStorage::Entry *entry) {
+	xattr_checksum_remove(*entry);
+	gMetadata->xattr_storage.erase(entry);
+}
+
+/*! \brief Sum of lengths of names of attributes of the inode, as returned by listxattr. */
+static uint32_t xattr_namelist_leng(uint32_t inode) {
+	uint32_t leng = 0;
+	gMetadata->xattr_storage.forEachOfInode(inode, [&leng](const XattrStorage::Entry &entry) {
+		leng += gMetadata->xattr_storage.nameLength(entry) + 1U;
+	});
+	return leng;
+}
+
+uint32_t xattr_checksum_add_to_background(uint32_t inode) {
+	uint32_t count = 0;
+	gMetadata->xattr_storage.forEachOfInode(inode, [&count](const XattrStorage::Entry &entry) {
+		addToChecksum(gChecksumBackgroundUpdater.xattrChecksum, xattr_checksum(entry));
+		count++;
+	});
+	return count;
 }
 
 void xattr_recalculate_checksum() {
 	gMetadata->xattrChecksum = XATTRCHECKSUMSEED;
-	for (int i = 0; i < XATTR_DATA_HASH_SIZE; ++i) {
-		for (xattr_data_entry *xde = gMetadata->xattr_data_hash[i]; xde; xde = xde->next) {
-			xde->checksum = xattr_checksum(xde);
-			addToChecksum(gMetadata->xattrChecksum, xde->checksum);
-		}
-	}
+	gMetadata->xattr_storage.forEach([](const XattrStorage::Entry &entry) {
+		addToChecksum(gMetadata->xattrChecksum, xattr_checksum(entry));
+	});
 }
 
 void xattr_removeinode(uint32_t inode) {
-	xattr_inode_entry *ih, **ihp;
-
-	ihp = &(gMetadata->xattr_inode_hash[xattr_inode_hash_fn(inode)]);
-	while ((ih = *ihp)) {
-		if (ih->inode == inode) {
-			while (ih->data_head) {
-				xattr_removeentry(ih->data_head);
-			}
-			*ihp = ih->next;
-			free(ih);
-		} else {
-			ihp = &(ih->next);
-		}
+	while (XattrStorage::Entry *entry = gMetadata->xattr_storage.findAny(inode)) {
+		xattr_removeentry(entry);
 	}
 }
 
 uint8_t xattr_setattr(uint32_t inode, uint8_t anleng, const uint8_t *attrname, uint32_t avleng,
 			const uint8_t *attrvalue, uint8_t mode) {
-	xattr_inode_entry *ih;
-	xattr_data_entry *xa;
-	uint32_t hash, ihash;
+	XattrStorage &storage = gMetadata->xattr_storage;
 
 	if (avleng > MFS_XATTR_SIZE_MAX) {
 		return LIZARDFS_ERROR_ERANGE;
@@ -118,158 +98,72 @@ uint8_t xattr_setattr(uint32_t inode, uint8_t anleng, const uint8_t *attrname, u
 		return LIZARDFS_ERROR_EINVAL;
 	}
 
-	ihash = xattr_inode_hash_fn(inode);
-	for (ih = gMetadata->xattr_inode_hash[ihash]; ih && ih->inode != inode; ih = ih->next) {
-	}
-
-	hash = xattr_data_hash_fn(inode, anleng, attrname);
-	for (xa = gMetadata->xattr_data_hash[hash]; xa; xa = xa->next) {
-		if (xa->inode == inode && xa->anleng == anleng &&
-		    memcmp(xa->attrname, attrname, anleng) == 0) {
-			passert(ih);
-			if (mode == XATTR_SMODE_CREATE_ONLY) {  // create only
-				return LIZARDFS_ERROR_EEXIST;
-			}
-			if (mode == XATTR_SMODE_REMOVE) {  // remove
-				ih->anleng -= anleng + 1U;
-				ih->avleng -= xa->avleng;
-				xattr_removeentry(xa);
-				if (ih->data_head == NULL) {
-					if (ih->anleng != 0 || ih->avleng != 0) {
-						lzfs_pretty_syslog(LOG_WARNING,
-						       "xattr non zero lengths on remove "
-						       "(inode:%" PRIu32 ",anleng:%" PRIu32
-						       ",avleng:%" PRIu32 ")",
-						       ih->inode, ih->anleng, ih->avleng);
-					}
-					xattr_removeinode(inode);
-				}
-				return LIZARDFS_STATUS_OK;
-			}
-			ih->avleng -= xa->avleng;
-			if (xa->attrvalue) {
-				free(xa->attrvalue);
-			}
-			if (avleng > 0) {
-				xa->attrvalue = (uint8_t *)malloc(avleng);
-				passert(xa->attrvalue);
-				memcpy(xa->attrvalue, attrvalue, avleng);
-			} else {
-				xa->attrvalue = NULL;
-			}
-			xa->avleng = avleng;
-			ih->avleng += avleng;
-			xattr_update_checksum(xa);
+	XattrStorage::Entry *entry = storage.find(inode, attrname, anleng);
+	if (entry) {
+		if (mode == XATTR_SMODE_CREATE_ONLY) {  // create only
+			return LIZARDFS_ERROR_EEXIST;
+		}
+		if (mode == XATTR_SMODE_REMOVE) {  // remove
+			xattr_removeentry(entry);
 			return LIZARDFS_STATUS_OK;
 		}
+		xattr_checksum_remove(*entry);
+		storage.setValue(entry, attrvalue, avleng);
+		xattr_checksum_add(*entry);
+		return LIZARDFS_STATUS_OK;
 	}
 
 	if (mode == XATTR_SMODE_REPLACE_ONLY || mode == XATTR_SMODE_REMOVE) {
 		return LIZARDFS_ERROR_ENOATTR;
 	}
 
-	if (ih && ih->anleng + anleng + 1 > MFS_XATTR_LIST_MAX) {
+	if (xattr_namelist_leng(inode) + anleng + 1 > MFS_XATTR_LIST_MAX) {
 		return LIZARDFS_ERROR_ERANGE;
 	}
 
-	xa = new xattr_data_entry;
-	xa->inode = inode;
-	xa->attrname = (uint8_t *)malloc(anleng);
-	passert(xa->attrname);
-	memcpy(xa->attrname, attrname, anleng);
-	xa->anleng = anleng;
-	if (avleng > 0) {
-		xa->attrvalue = (uint8_t *)malloc(avleng);
-		passert(xa->attrvalue);
-		memcpy(xa->attrvalue, attrvalue, avleng);
-	} else {
-		xa->attrvalue = NULL;
-	}
-	xa->avleng = avleng;
-	xa->next = gMetadata->xattr_data_hash[hash];
-	if (xa->next) {
-		xa->next->prev = &(xa->next);
-	}
-	xa->prev = gMetadata->xattr_data_hash + hash;
-	gMetadata->xattr_data_hash[hash] = xa;
-
-	if (ih) {
-		xa->nextinode = ih->data_head;
-		if (xa->nextinode) {
-			xa->nextinode->previnode = &(xa->nextinode);
-		}
-		xa->previnode = &(ih->data_head);
-		ih->data_head = xa;
-		ih->anleng += anleng + 1U;
-		ih->avleng += avleng;
-	} else {
-		ih = (xattr_inode_entry *)malloc(sizeof(xattr_inode_entry));
-		passert(ih);
-		ih->inode = inode;
-		xa->nextinode = NULL;
-		xa->previnode = &(ih->data_head);
-		ih->data_head = xa;
-		ih->anleng = anleng + 1U;
-		ih->avleng = avleng;
-		ih->next = gMetadata->xattr_inode_hash[ihash];
-		gMetadata->xattr_inode_hash[ihash] = ih;
-	}
-	xa->checksum = 0;
-	xattr_update_checksum(xa);
+	storage.insert(inode, attrname, anleng, attrvalue, avleng);
+	xattr_checksum_add(*storage.find(inode, attrname, anleng));
 	return LIZARDFS_STATUS_OK;
 }
 
 uint8_t xattr_getattr(uint32_t inode, uint8_t anleng, const uint8_t *attrname, uint32_t *avleng,
 			uint8_t **attrvalue) {
-	xattr_data_entry *xa;
-
-	for (xa = gMetadata->xattr_data_hash[xattr_data_hash_fn(inode, anleng, attrname)]; xa;
-	     xa = xa->next) {
-		if (xa->inode == inode && xa->anleng == anleng &&
-		    memcmp(xa->attrname, attrname, anleng) == 0) {
-			if (xa->avleng > MFS_XATTR_SIZE_MAX) {
-				return LIZARDFS_ERROR_ERANGE;
-			}
-			*attrvalue = xa->attrvalue;
-			*avleng = xa->avleng;
-			return LIZARDFS_STATUS_OK;
-		}
+	XattrStorage &storage = gMetadata->xattr_storage;
+	const XattrStorage::Entry *entry = storage.find(inode, attrname, anleng);
+	if (!entry) {
+		return LIZARDFS_ERROR_ENOATTR;
+	}
+	if (storage.valueLength(*entry) > MFS_XATTR_SIZE_MAX) {
+		return LIZARDFS_ERROR_ERANGE;
 	}
-	return LIZARDFS_ERROR_ENOATTR;
+	*attrvalue = const_cast<uint8_t *>(storage.value(*entry));
+	*avleng = storage.valueLength(*entry);
+	return LIZARDFS_STATUS_OK;
 }
 
 uint8_t xattr_listattr_leng(uint32_t inode, void **xanode, uint32_t *xasize) {
-	xattr_inode_entry *ih;
-	xattr_data_entry *xa;
-
-	for (ih = gMetadata->xattr_inode_hash[xattr_inode_hash_fn(inode)]; ih; ih = ih->next) {
-		if (ih->inode == inode) {
-			*xanode = ih;
-			for (xa = ih->data_head; xa; xa = xa->nextinode) {
-				*xasize += xa->anleng + 1U;
-			}
-			if (*xasize > MFS_XATTR_LIST_MAX) {
-				return LIZARDFS_ERROR_ERANGE;
-			}
-			return LIZARDFS_STATUS_OK;
+	// Any entry of the inode identifies it for xattr_listattr_data
+	*xanode = gMetadata->xattr_storage.findAny(inode);
+	if (*xanode) {
+		*xasize += xattr_namelist_leng(inode);
+		if (*xasize > MFS_XATTR_LIST_MAX) {
+			return LIZARDFS_ERROR_ERANGE;
 		}
 	}
-	*xanode = NULL;
 	return LIZARDFS_STATUS_OK;
 }
 
 void xattr_listattr_data(void *xanode, uint8_t *xabuff) {
-	xattr_inode_entry *ih = (xattr_inode_entry *)xanode;
-	xattr_data_entry *xa;
+	XattrStorage &storage = gMetadata->xattr_storage;
 	uint32_t l;
 
 	l = 0;
-	if (ih) {
-		for (xa = ih->data_head; xa; xa = xa->nextinode) {
-			memcpy(xabuff + l, xa->attrname, xa->anleng);
-			l += xa->anleng;
+	if (xanode) {
+		uint32_t inode = static_cast<XattrStorage::Entry *>(xanode)->inode;
+		storage.forEachOfInode(inode, [&storage, xabuff, &l](const XattrStorage::Entry &entry) {
+			memcpy(xabuff + l, storage.name(entry), storage.nameLength(entry));
+			l += storage.nameLength(entry);
 			xabuff[l++] = 0;
-		}
+		});
 	}
 }
-
@@ -21,11 +21,13 @@
 #include "common/cfg.h"
 #include "common/event_loop.h"
 #include "master/hstring_memstorage.h"
+#include "master/hstring_mmapstorage.h"
 #ifdef LIZARDFS_HAVE_DB
   #include "master/hstring_bdbstorage.h"
 #endif
 
 static int gUseBDBStorage;
+static int gUseMmapStorage;
 static std::string gBDBStoragePath;
 static uint64_t gBDBStorageCacheSize;
 
@@ -33,14 +35,19 @@ void hstorage_reload() {
 	int use_bdb = cfg_getuint8("USE_BDB_NAME_STORAGE", 0);
 	std::string bdb_path = cfg_getstring("DATA_PATH", DATA_PATH);
 	uint64_t cache_size = cfg_getuint32("BDB_NAME_STORAGE_CACHE_SIZE", 10);
+	int use_mmap = cfg_getuint8("USE_MMAP_FOR_NAME_STORAGE", 0);
 
 	if (use_bdb != gUseBDBStorage) {
 		lzfs_pretty_syslog(LOG_ERR, "Changing USE_BDB_NAME_STORAGE requires restart.");
 	}
 
-	if (gUseBDBStorage && bdb_path != gBDBStoragePath) {
+	if (use_mmap != gUseMmapStorage) {
+		lzfs_pretty_syslog(LOG_ERR, "Changing USE_MMAP_FOR_NAME_STORAGE requires restart.");
+	}
+
+	if ((gUseBDBStorage || gUseMmapStorage) && bdb_path != gBDBStoragePath) {
 		lzfs_pretty_syslog(LOG_ERR,
-		                   "Changing DATA_PATH with enabled BDB name storage requires restart.");
+		                   "Changing DATA_PATH with enabled BDB or mmap name storage requires restart.");
 	}
 
 	if (cache_size != gBDBStorageCacheSize) {
@@ -56,8 +63,17 @@ int hstorage_init() {
 	gUseBDBStorage = cfg_getuint8("USE_BDB_FOR_NAME_STORAGE", 0);
 	gBDBStoragePath = cfg_getstring("DATA_PATH", DATA_PATH);
 	gBDBStorageCacheSize = cfg_getuint32("BDB_NAME_STORAGE_CACHE_SIZE", 10);
-
-	if (gUseBDBStorage) {
+	gUseMmapStorage = cfg_getuint8("USE_MMAP_FOR_NAME_STORAGE", 0);
+
+	if (gUseMmapStorage) {
+		try {
+			hstorage::Storage::reset(
+			        new hstorage::MmapStorage(gBDBStoragePath + "/name_storage.mmap"));
+		} catch (std::exception &e) {
+			lzfs_pretty_syslog(LOG_ERR, "%s", e.what());
+			return -1;
+		}
+	} else if (gUseBDBStorage) {
 #ifdef LIZARDFS_HAVE_DB
 		hstorage::Storage::reset(new hstorage::BDBStorage(gBDBStoragePath + "/name_storage.db",
 		                                                  gBDBStorageCacheSize * 1024 * 1024, 1));
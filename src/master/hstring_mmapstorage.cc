@@ -0,0 +1,227 @@
+#include "common/platform.h"
+
+#include <fcntl.h>
+#include <inttypes.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cassert>
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+
+#include "common/slogger.h"
+#include "common/time_utils.h"
+#include "master/hstring_mmapstorage.h"
+
+using namespace hstorage;
+
+constexpr uint32_t MmapStorage::kDefaultHotCacheSize;
+constexpr uint64_t MmapStorage::kMinCapacity;
+constexpr double MmapStorage::kCompactionThreshold;
+
+MmapStorage::MmapStorage(const std::string &path, uint32_t hot_cache_size)
+		: fd_(-1),
+		  path_(path),
+		  arena_(nullptr),
+		  arena_used_(0),
+		  arena_capacity_(0),
+		  garbage_(0),
+		  hot_cache_(std::max<uint32_t>(hot_cache_size, 1), 0) {
+	fd_ = open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0600);
+	if (fd_ < 0) {
+		throw std::runtime_error("Could not open name storage file " + path + ": " +
+		                         strerror(errno));
+	}
+	try {
+		resize(kMinCapacity);
+	} catch (...) {
+		close(fd_);
+		throw;
+	}
+}
+
+MmapStorage::~MmapStorage() {
+	/* The file isn't truncated here, a forked process may still use it */
+	if (arena_) {
+		munmap(arena_, arena_capacity_);
+		arena_ = nullptr;
+	}
+	if (fd_ >= 0) {
+		close(fd_);
+		fd_ = -1;
+	}
+}
+
+bool MmapStorage::compare(const Handle &handle, const HString &str) {
+	if (hash(handle) != static_cast<HashType>(str.hash())) {
+		return false;
+	}
+	uint64_t slot = decode(handle);
+	const RecordHeader *header = record(slots_[slot].offset);
+	return header->length == str.size() && memcmp(data(slot), str.data(), str.size()) == 0;
+}
+
+::std::string MmapStorage::get(const Handle &handle) {
+	uint64_t slot = decode(handle);
+	return std::string(data(slot), record(slots_[slot].offset)->length);
+}
+
+void MmapStorage::copy(Handle &handle, const Handle &other) {
+	slots_[decode(other)].refcount++;
+	handle.data() = other.data();
+}
+
+/*
+ * Binding hstring to handle:
+ * 1. Look for the same string in the cache of recently bound ones and share it if found
+ * 2. Otherwise append the string to the arena and remember it in the cache
+ */
+void MmapStorage::bind(Handle &handle, const HString &str) {
+	uint64_t &cached = hot_cache_[str.hash() % hot_cache_.size()];
+	if (cached > 0) {
+		uint64_t slot = cached - 1;
+		// slot could be reused by another string since it was cached
+		if (slots_[slot].refcount > 0 && record(slots_[slot].offset)->length == str.size()
+				&& memcmp(data(slot), str.data(), str.size()) == 0) {
+			slots_[slot].refcount++;
+			handle.data() = encode(slot, str.hash());
+			return;
+		}
+	}
+
+	uint64_t slot = allocateSlot();
+	slots_[slot].offset = append(str, slot);
+	slots_[slot].refcount = 1;
+	cached = slot + 1;
+	handle.data() = encode(slot, str.hash());
+}
+
+void MmapStorage::unbind(Handle &handle) {
+	uint64_t slot = decode(handle);
+	assert(slots_[slot].refcount > 0);
+	if (--slots_[slot].refcount == 0) {
+		garbage_ += recordSize(record(slots_[slot].offset)->length);
+		free_slots_.push_back(slot);
+	}
+}
+
+/*
+ * Live records are moved towards the beginning of the arena, in order of their positions,
+ * so a record never overwrites one which wasn't moved yet. Slots (and so handles) stay
+ * the same, only their offsets are updated.
+ *
+ * It blocks the master, so it is done only when enough of the arena is wasted.
+ */
+void MmapStorage::compact() {
+	if (garbage_ == 0 || garbage_ < arena_used_ * kCompactionThreshold) {
+		return;
+	}
+	Timer timer;
+	uint64_t reclaimed = garbage_;
+	uint64_t read_offset = 0;
+	uint64_t write_offset = 0;
+	while (read_offset < arena_used_) {
+		const RecordHeader *header = record(read_offset);
+		uint64_t size = recordSize(header->length);
+		uint64_t slot = header->slot;
+		if (slot < slots_.size() && slots_[slot].refcount > 0 &&
+				slots_[slot].offset == read_offset) {
+			if (write_offset != read_offset) {
+				memmove(arena_ + write_offset, arena_ + read_offset, size);
+				slots_[slot].offset = write_offset;
+			}
+			write_offset += size;
+		}
+		read_offset += size;
+	}
+	arena_used_ = write_offset;
+	garbage_ = 0;
+
+	uint64_t capacity = kMinCapacity;
+	while (capacity < 2 * arena_used_) {
+		capacity *= 2;
+	}
+	if (capacity < arena_capacity_) {
+		resize(capacity);
+	}
+	lzfs_pretty_syslog(LOG_INFO, "name storage compacted in %.3f s (%" PRIu64 " MiB reclaimed)",
+			timer.elapsed_ms() / 1000., reclaimed >> 20);
+}
+
+::std::string MmapStorage::name() const {
+	return kName;
+}
+
+uint64_t MmapStorage::recordSize(uint32_t length) {
+	uint64_t size = sizeof(RecordHeader) + length + 1;
+	return (size + alignof(RecordHeader) - 1) / alignof(RecordHeader) * alignof(RecordHeader);
+}
+
+MmapStorage::ValueType MmapStorage::encode(uint64_t slot, HashType hash) const {
+	return (static_cast<ValueType>(hash) << Handle::kHashShift) | (slot + kSalt);
+}
+
+uint64_t MmapStorage::decode(const Handle &handle) const {
+	return (handle.data() & Handle::kMask) - kSalt;
+}
+
+const MmapStorage::RecordHeader *MmapStorage::record(uint64_t offset) const {
+	return reinterpret_cast<const RecordHeader *>(arena_ + offset);
+}
+
+const char *MmapStorage::data(uint64_t slot) const {
+	return reinterpret_cast<const char *>(arena_ + slots_[slot].offset + sizeof(RecordHeader));
+}
+
+uint64_t MmapStorage::append(const HString &str, uint64_t slot) {
+	uint64_t size = recordSize(str.size());
+	if (arena_used_ + size > arena_capacity_) {
+		uint64_t capacity = arena_capacity_;
+		while (arena_used_ + size > capacity) {
+			capacity *= 2;
+		}
+		resize(capacity);
+	}
+	uint64_t offset = arena_used_;
+	RecordHeader *header = reinterpret_cast<RecordHeader *>(arena_ + offset);
+	header->slot = slot;
+	header->length = str.size();
+	memcpy(arena_ + offset + sizeof(RecordHeader), str.c_str(), str.size() + 1);
+	arena_used_ += size;
+	return offset;
+}
+
+uint64_t MmapStorage::allocateSlot() {
+	if (!free_slots_.empty()) {
+		uint64_t slot = free_slots_.back();
+		free_slots_.pop_back();
+		return slot;
+	}
+	if (slots_.size() >= Handle::kMask - kSalt) {
+		throw std::bad_alloc();
+	}
+	slots_.push_back(Slot{0, 0});
+	return slots_.size() - 1;
+}
+
+void MmapStorage::resize(uint64_t capacity) {
+	if (ftruncate(fd_, capacity) < 0) {
+		throw std::runtime_error("Could not resize name storage file " + path_ + ": " +
+		                         strerror(errno));
+	}
+	void *mapped = mmap(nullptr, capacity, PROT_READ | PROT_WRITE, MAP_SHARED, fd_, 0);
+	if (mapped == MAP_FAILED) {
+		throw std::runtime_error("Could not map name storage file " + path_ + ": " +
+		                         strerror(errno));
+	}
+	if (arena_) {
+		munmap(arena_, arena_capacity_);
+	}
+	arena_ = static_cast<uint8_t *>(mapped);
+	arena_capacity_ = capacity;
+#ifdef MADV_RANDOM
+	// names are accessed in random order, reading ahead would only waste memory
+	madvise(arena_, arena_capacity_, MADV_RANDOM);
+#endif
+}
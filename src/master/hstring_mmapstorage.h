@@ -0,0 +1,105 @@
+#pragma once
+
+#include "common/platform.h"
+
+#include "master/hstring_storage.h"
+
+#include <string>
+#include <vector>
+
+namespace hstorage {
+
+/*! \brief Memory-mapped storage for hstring
+ *
+ * Strings are appended to an arena kept in a file mapped into memory, so the kernel can
+ * page them out and load them back lazily, when they are needed. Data stored in handle is
+ * 16 bits of string's hash + index of a slot, which keeps the reference count and
+ * the position of the string in the arena. Equal strings bound shortly one after another
+ * (e.g. common names like "Makefile") share one copy, which is found using a small cache
+ * of recently bound strings.
+ *
+ * Strings are never modified in the arena, space freed by unbound ones is reclaimed only
+ * by compact(). Thanks to that, a forked process (e.g. the one dumping metadata) can safely
+ * read the arena while the parent process appends new strings to it.
+ */
+class MmapStorage : public Storage {
+public:
+	typedef Handle::HashType HashType;
+	typedef Handle::ValueType ValueType;
+
+	/*!
+	 * \param path Path of the arena file, its content is discarded.
+	 * \param hot_cache_size Number of entries in the cache of recently bound strings.
+	 */
+	MmapStorage(const ::std::string &path, uint32_t hot_cache_size = kDefaultHotCacheSize);
+
+	~MmapStorage();
+
+	bool compare(const Handle &handle, const HString &str) override;
+	::std::string get(const Handle &handle) override;
+	void copy(Handle &handle, const Handle &other) override;
+	void bind(Handle &handle, const HString &str) override;
+	void unbind(Handle &handle) override;
+	void compact() override;
+	::std::string name() const override;
+
+	static HashType hash(const Handle &handle) {
+		return handle.data() >> Handle::kHashShift;
+	}
+
+	/*! \brief Number of bytes used in the arena, including the ones not reclaimed yet. */
+	uint64_t arenaSize() const {
+		return arena_used_;
+	}
+
+	/*! \brief Number of bytes in the arena which would be reclaimed by compact(). */
+	uint64_t garbageSize() const {
+		return garbage_;
+	}
+
+	static constexpr uint32_t kDefaultHotCacheSize = 64 * 1024;
+
+private:
+	struct Slot {
+		uint64_t offset;   /*!< Position of the record in the arena. */
+		uint32_t refcount; /*!< Number of handles bound to the slot, 0 for unused slots. */
+	};
+
+	/*! \brief Header of a string record in the arena, followed by the string and '\0'. */
+	struct RecordHeader {
+		uint64_t slot;
+		uint32_t length;
+	};
+
+	static uint64_t recordSize(uint32_t length);
+
+	ValueType encode(uint64_t slot, HashType hash) const;
+	uint64_t decode(const Handle &handle) const;
+	const RecordHeader *record(uint64_t offset) const;
+	const char *data(uint64_t slot) const;
+	uint64_t append(const HString &str, uint64_t slot);
+	uint64_t allocateSlot();
+	void resize(uint64_t capacity);
+
+	int fd_;
+	std::string path_;
+	uint8_t *arena_;
+	uint64_t arena_used_;
+	uint64_t arena_capacity_;
+	uint64_t garbage_;
+	std::vector<Slot> slots_;
+	std::vector<uint64_t> free_slots_;
+	std::vector<uint64_t> hot_cache_; /*!< Slot + 1 of a recently bound string, 0 if empty. */
+
+	static constexpr const char *kName = "MmapStorage";
+	static constexpr uint64_t kMinCapacity = 16 * 1024 * 1024;
+	/*! Compaction is done only if at least this part of the arena is wasted. */
+	static constexpr double kCompactionThreshold = 0.25;
+	/*
+	 * Like in BDBStorage, handles are salted, so that a handle of the first string
+	 * (slot 0, hash 0) doesn't look like null.
+	 */
+	static const ValueType kSalt = 1;
+};
+
+} //namespace hstring
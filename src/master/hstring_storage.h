@@ -67,6 +67,16 @@ public:
 	 *  Passed handle is required to be bound to a valid string.
 	 */
 	virtual void unbind(Handle &handle) = 0;
+
+	/*!
+	 *  \brief Reclaims space of unbound strings, if storage needs it
+	 *
+	 *  Handles stay valid. Called before metadata is dumped, when no other process uses
+	 *  the storage.
+	 */
+	virtual void compact() {
+	}
+
 	virtual ::std::string name() const = 0;
 
 private:
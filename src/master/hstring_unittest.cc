@@ -5,8 +5,12 @@
 #endif
 
 #include "master/hstring_memstorage.h"
+#include "master/hstring_mmapstorage.h"
 
+#include <cstdio>
 #include <functional>
+#include <string>
+#include <vector>
 #include <gtest/gtest.h>
 
 using namespace hstorage;
@@ -90,6 +94,105 @@ TEST(HStringTest, MemCopy) {
 	EXPECT_TRUE(h2 == h4.get());
 }
 
+/*
+ * MmapStorage tests
+ */
+TEST(HStringTest, MmapComparison) {
+	const char MMAP_FILEPATH[] = "/tmp/hstring_mmap_comparison";
+	{
+		Storage::reset(new MmapStorage(MMAP_FILEPATH));
+		EXPECT_EQ(Storage::instance().name(), "MmapStorage");
+		HString str1("Good morning");
+		HString str2("Good evening");
+		Handle handle(str1);
+
+		EXPECT_TRUE(str1 == handle);
+		EXPECT_TRUE(handle == str1);
+		EXPECT_FALSE(str1 != handle);
+		EXPECT_FALSE(str2 == handle);
+		EXPECT_FALSE(handle == str2);
+		EXPECT_TRUE(str2 < handle);
+		EXPECT_TRUE(handle > str2);
+		EXPECT_EQ(MmapStorage::hash(handle), static_cast<MmapStorage::HashType>(str1.hash()));
+		EXPECT_EQ(MmapStorage::hash(handle), handle.hash());
+	} // destroy all Handle objects
+	Storage::reset();
+	std::remove(MMAP_FILEPATH);
+}
+
+TEST(HStringTest, MmapCopyAndDeduplication) {
+	const char MMAP_FILEPATH[] = "/tmp/hstring_mmap_copy";
+	{
+		MmapStorage *storage = new MmapStorage(MMAP_FILEPATH);
+		Storage::reset(storage);
+		Handle h1("Good morning");
+		Handle h2("Good evening");
+		Handle h3;
+		Handle h4 = h1;
+		Handle h5(h2);
+		Handle h6(HString(""));
+
+		h3 = std::move(h1);
+		h1 = h2;
+		h2 = std::move(h3);
+
+		EXPECT_TRUE(h1 == h5.get());
+		EXPECT_TRUE(h2 == h4.get());
+		EXPECT_EQ("", static_cast<std::string>(h6));
+
+		// A common name bound again is stored once
+		uint64_t size = storage->arenaSize();
+		Handle h7("Good morning");
+		EXPECT_EQ(size, storage->arenaSize());
+		EXPECT_EQ(h7.data(), h2.data());
+	} // destroy all Handle objects
+	Storage::reset();
+	std::remove(MMAP_FILEPATH);
+}
+
+TEST(HStringTest, MmapCompaction) {
+	const char MMAP_FILEPATH[] = "/tmp/hstring_mmap_compaction";
+	{
+		MmapStorage *storage = new MmapStorage(MMAP_FILEPATH, 16);
+		Storage::reset(storage);
+		// enough strings to make the arena grow a few times
+		const int count = 200000;
+		std::vector<Handle> handles;
+		for (int i = 0; i < count; ++i) {
+			handles.emplace_back("file_with_quite_a_long_name_" + std::to_string(i) + ".txt");
+		}
+		std::vector<Handle> kept;
+		for (int i = 0; i < count; ++i) {
+			if (i % 10 == 0) {
+				kept.push_back(std::move(handles[i]));
+			}
+		}
+		std::vector<Handle::ValueType> kept_data;
+		for (const auto &handle : kept) {
+			kept_data.push_back(handle.data());
+		}
+		uint64_t size_before = storage->arenaSize();
+		handles.clear();
+		EXPECT_LT(0.8 * size_before, storage->garbageSize());
+
+		storage->compact();
+		EXPECT_EQ(0U, storage->garbageSize());
+		EXPECT_GT(0.2 * size_before, storage->arenaSize());
+		for (int i = 0; i < count / 10; ++i) {
+			EXPECT_EQ(kept_data[i], kept[i].data());
+			EXPECT_EQ("file_with_quite_a_long_name_" + std::to_string(i * 10) + ".txt",
+			          static_cast<std::string>(kept[i]));
+		}
+
+		// Slots of removed strings are reused
+		Handle another("another");
+		EXPECT_TRUE(another == HString("another"));
+		EXPECT_TRUE(kept[1] == HString("file_with_quite_a_long_name_10.txt"));
+	} // destroy all Handle objects
+	Storage::reset();
+	std::remove(MMAP_FILEPATH);
+}
+
 /*
  * BDBStorage tests
  */
@@ -0,0 +1,75 @@
+/*
+   Copyright 2017 Skytechnology sp. z o.o.
+
+   This file is part of LizardFS.
+
+   LizardFS is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, version 3.
+
+   LizardFS is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with LizardFS. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "common/platform.h"
+
+#include "master/lazy_snapshot_registry.h"
+
+#include <algorithm>
+
+#include "common/hashfn.h"
+
+bool LazySnapshotRegistry::add(uint32_t clone, uint32_t source, const statsrecord &stats) {
+	auto result = clones_.insert({clone, Entry{source, stats}});
+	if (!result.second) {
+		return false;
+	}
+	sources_.insert({source, clone});
+	addToChecksum(checksum_, entryChecksum(clone, result.first->second));
+	return true;
+}
+
+bool LazySnapshotRegistry::remove(uint32_t clone, Entry *entry) {
+	auto it = clones_.find(clone);
+	if (it == clones_.end()) {
+		return false;
+	}
+
+	auto range = sources_.equal_range(it->second.source);
+	for (auto source_it = range.first; source_it != range.second; ++source_it) {
+		if (source_it->second == clone) {
+			sources_.erase(source_it);
+			break;
+		}
+	}
+
+	removeFromChecksum(checksum_, entryChecksum(clone, it->second));
+	if (entry) {
+		*entry = it->second;
+	}
+	clones_.erase(it);
+	return true;
+}
+
+std::vector<uint32_t> LazySnapshotRegistry::clonesOf(uint32_t source) const {
+	std::vector<uint32_t> result;
+	auto range = sources_.equal_range(source);
+	for (auto it = range.first; it != range.second; ++it) {
+		result.push_back(it->second);
+	}
+	std::sort(result.begin(), result.end());
+	return result;
+}
+
+uint64_t LazySnapshotRegistry::entryChecksum(uint32_t clone, const Entry &entry) {
+	uint64_t seed = 0x7F2A;
+	hashCombine(seed, clone, entry.source, entry.stats.inodes, entry.stats.dirs,
+	            entry.stats.files, entry.stats.chunks, entry.stats.length, entry.stats.size,
+	            entry.stats.realsize);
+	return seed;
+}
@@ -0,0 +1,113 @@
+/*
+   Copyright 2017 Skytechnology sp. z o.o.
+
+   This file is part of LizardFS.
+
+   LizardFS is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, version 3.
+
+   LizardFS is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with LizardFS. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include "common/platform.h"
+
+#include <cstdint>
+#include <map>
+#include <vector>
+
+#include "master/filesystem_node_types.h"
+
+/*! \brief Registry of directories created by lazy snapshots.
+ *
+ * A lazy snapshot of a directory is an empty directory node (clone) which logically
+ * contains everything its source directory contained at the time the snapshot was taken.
+ * The clone keeps statistics of the source (captured at snapshot time) and is
+ * materialized one level at a time - either when it is accessed or right before
+ * its source (or any of the source's ancestors) is going to be modified.
+ *
+ * Containers are ordered, so iterating over the registry is deterministic
+ * (this matters for metadata dumps and for the order of emitted changelogs).
+ */
+class LazySnapshotRegistry {
+public:
+	struct Entry {
+		uint32_t source;   /*!< Inode of directory whose contents the clone shares. */
+		statsrecord stats; /*!< Statistics of the source captured when the clone was made. */
+	};
+
+	typedef std::map<uint32_t, Entry> Container;
+	typedef Container::const_iterator const_iterator;
+
+	LazySnapshotRegistry() : checksum_(0) {}
+
+	bool empty() const {
+		return clones_.empty();
+	}
+
+	std::size_t size() const {
+		return clones_.size();
+	}
+
+	/*! \brief Register new lazy clone.
+	 * \param clone inode of an (empty) directory that becomes a lazy clone.
+	 * \param source inode of directory whose contents are shared.
+	 * \param stats statistics of source directory.
+	 * \return false if clone was already registered.
+	 */
+	bool add(uint32_t clone, uint32_t source, const statsrecord &stats);
+
+	/*! \brief Unregister lazy clone.
+	 * \param clone inode of lazy clone.
+	 * \param entry if not null, removed entry is stored there.
+	 * \return false if clone wasn't registered.
+	 */
+	bool remove(uint32_t clone, Entry *entry = nullptr);
+
+	/*! \brief Returns entry of lazy clone or nullptr if inode is not a lazy clone. */
+	const Entry *find(uint32_t clone) const {
+		auto it = clones_.find(clone);
+		return it == clones_.end() ? nullptr : &it->second;
+	}
+
+	/*! \brief Returns true if there are lazy clones sharing contents of this inode. */
+	bool isSource(uint32_t inode) const {
+		return sources_.count(inode) > 0;
+	}
+
+	/*! \brief Returns inodes of all lazy clones of given source (in ascending order). */
+	std::vector<uint32_t> clonesOf(uint32_t source) const;
+
+	uint64_t checksum() const {
+		return checksum_;
+	}
+
+	const_iterator begin() const {
+		return clones_.begin();
+	}
+
+	const_iterator end() const {
+		return clones_.end();
+	}
+
+	void clear() {
+		clones_.clear();
+		sources_.clear();
+		checksum_ = 0;
+	}
+
+private:
+	static uint64_t entryChecksum(uint32_t clone, const Entry &entry);
+
+	Container clones_;                          /*!< clone -> (source, captured stats) */
+	std::multimap<uint32_t, uint32_t> sources_; /*!< source -> clone */
+	uint64_t checksum_;
+};
@@ -0,0 +1,85 @@
+/*
+   Copyright 2017 Skytechnology sp. z o.o.
+
+   This file is part of LizardFS.
+
+   LizardFS is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, version 3.
+
+   LizardFS is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with LizardFS. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "common/platform.h"
+
+#include "master/lazy_snapshot_registry.h"
+
+#include <gtest/gtest.h>
+
+static statsrecord makeStats(uint32_t inodes, uint64_t size) {
+	statsrecord sr{};
+	sr.inodes = inodes;
+	sr.files = inodes;
+	sr.size = size;
+	return sr;
+}
+
+TEST(LazySnapshotRegistryTests, AddRemove) {
+	LazySnapshotRegistry registry;
+	EXPECT_TRUE(registry.empty());
+	EXPECT_EQ(0U, registry.checksum());
+
+	EXPECT_TRUE(registry.add(10, 2, makeStats(5, 100)));
+	EXPECT_TRUE(registry.add(11, 2, makeStats(5, 100)));
+	EXPECT_TRUE(registry.add(12, 3, makeStats(1, 10)));
+	EXPECT_FALSE(registry.add(12, 4, makeStats(1, 10)));
+	EXPECT_EQ(3U, registry.size());
+
+	ASSERT_NE(nullptr, registry.find(12));
+	EXPECT_EQ(3U, registry.find(12)->source);
+	EXPECT_EQ(10U, registry.find(12)->stats.size);
+	EXPECT_EQ(nullptr, registry.find(2));
+
+	EXPECT_TRUE(registry.isSource(2));
+	EXPECT_TRUE(registry.isSource(3));
+	EXPECT_FALSE(registry.isSource(4));
+	EXPECT_EQ(std::vector<uint32_t>({10, 11}), registry.clonesOf(2));
+
+	LazySnapshotRegistry::Entry entry;
+	EXPECT_TRUE(registry.remove(10, &entry));
+	EXPECT_EQ(2U, entry.source);
+	EXPECT_EQ(5U, entry.stats.inodes);
+	EXPECT_FALSE(registry.remove(10));
+	EXPECT_EQ(std::vector<uint32_t>({11}), registry.clonesOf(2));
+
+	EXPECT_TRUE(registry.remove(11));
+	EXPECT_FALSE(registry.isSource(2));
+	EXPECT_TRUE(registry.remove(12));
+	EXPECT_TRUE(registry.empty());
+	EXPECT_EQ(0U, registry.checksum());
+}
+
+TEST(LazySnapshotRegistryTests, Checksum) {
+	LazySnapshotRegistry a, b;
+
+	a.add(10, 2, makeStats(5, 100));
+	a.add(11, 3, makeStats(1, 10));
+	b.add(11, 3, makeStats(1, 10));
+	b.add(10, 2, makeStats(5, 100));
+	EXPECT_EQ(a.checksum(), b.checksum());
+	EXPECT_NE(0U, a.checksum());
+
+	b.remove(10);
+	b.add(10, 2, makeStats(5, 101));
+	EXPECT_NE(a.checksum(), b.checksum());
+
+	a.clear();
+	EXPECT_TRUE(a.empty());
+	EXPECT_EQ(0U, a.checksum());
+}
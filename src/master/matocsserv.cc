@@ -32,6 +32,7 @@
 #include <unistd.h>
 #include <algorithm>
 #include <list>
+#include <memory>
 #include <set>
 #include <vector>
 
@@ -51,6 +52,7 @@
 #include "common/slogger.h"
 #include "common/sockets.h"
 #include "common/time_utils.h"
+#include "master/chunk_placement_policy.h"
 #include "master/chunks.h"
 #include "master/chunkserver_db.h"
 #include "master/filesystem.h"
@@ -68,6 +70,7 @@
 enum{KILL, CONNECTED};
 
 double gLoadFactorPenalty = 0.;
+static std::unique_ptr<ChunkPlacementPolicy> gChunkPlacementPolicy(new FreeSpacePlacementPolicy());
 
 struct matocsserventry {
 	matocsserventry() : inputPacket(MaxPacketSize) {}
@@ -375,16 +378,9 @@ std::vector<std::pair<matocsserventry *, ChunkPartType>> matocsserv_getservers_f
 		if (eptr->mode != KILL && eptr->totalspace > 0 &&
 		    eptr->usedspace <= eptr->totalspace &&
 		    (eptr->totalspace - eptr->usedspace) >= MFSCHUNKSIZE) {
-
-			// A good weight formula will do the following:
-			//   * Agree with the chunk balancing algorithm, i.e. avoid creating a distribution which
-			//     immediately needs to be re-balanced.
-			//   * Be coarse enough that when the cluster is balanced, weights are generally equal.
-			//   * Keep weights constant across the cluster for long enough periods
-			//     that the 'history' can also do its job.
-			//
-			// weight = percent free spaces
-			const int64_t weight = 1024 * 1024 * (1. - matocsserv_get_usage(eptr));
+			const int64_t weight = gChunkPlacementPolicy->weight(ChunkserverPlacementInfo(
+					eptr->usedspace, eptr->totalspace, eptr->load_factor,
+					eptr->rrepcounter + eptr->wrepcounter));
 			getter.addServer(eptr, eptr->label, weight, eptr->version, eptr->load_factor);
 		}
 	}
@@ -1769,6 +1765,21 @@ void matocsserv_serve(const std::vector<pollfd> &pdesc) {
 	}
 }
 
+static void matocsserv_load_placement_policy() {
+	std::string name = cfg_get("CHUNK_PLACEMENT_POLICY", std::string(FreeSpacePlacementPolicy::kName));
+	double load_penalty = cfg_get_minmaxvalue<double>("CHUNK_PLACEMENT_LOAD_PENALTY", 0.5, 0., 1.);
+	double replication_penalty =
+			cfg_get_minmaxvalue<double>("CHUNK_PLACEMENT_REPLICATION_PENALTY", 0.1, 0., 10.);
+	std::unique_ptr<ChunkPlacementPolicy> policy =
+			createChunkPlacementPolicy(name, load_penalty, replication_penalty);
+	if (!policy) {
+		lzfs_pretty_syslog(LOG_WARNING, "unknown CHUNK_PLACEMENT_POLICY: %s, using %s",
+				name.c_str(), gChunkPlacementPolicy->name());
+		return;
+	}
+	gChunkPlacementPolicy = std::move(policy);
+}
+
 void matocsserv_reload(void) {
 	char *oldListenHost,*oldListenPort;
 	int newlsock;
@@ -1778,6 +1789,7 @@ void matocsserv_reload(void) {
 	ListenHost = cfg_getstr("MATOCS_LISTEN_HOST","*");
 	ListenPort = cfg_getstr("MATOCS_LISTEN_PORT","9420");
 	gLoadFactorPenalty = cfg_get_minmaxvalue<double>("LOAD_FACTOR_PENALTY", 0., 0., 0.5);
+	matocsserv_load_placement_policy();
 	if (strcmp(oldListenHost,ListenHost)==0 && strcmp(oldListenPort,ListenPort)==0) {
 		free(oldListenHost);
 		free(oldListenPort);
@@ -1824,6 +1836,7 @@ int matocsserv_init(void) {
 	ListenHost = cfg_getstr("MATOCS_LISTEN_HOST","*");
 	ListenPort = cfg_getstr("MATOCS_LISTEN_PORT","9420");
 	gLoadFactorPenalty = cfg_get_minmaxvalue<double>("LOAD_FACTOR_PENALTY", 0., 0., 0.5);
+	matocsserv_load_placement_policy();
 
 	lsock = tcpsocket();
 	if (lsock<0) {
@@ -143,6 +143,7 @@ bool MetadataDumper::start(MetadataDumper::DumpType& dumpType, uint64_t checksum
 				// exec mfsmetarestore
 				std::string checksumStringified = std::to_string(checksum);
 				std::string storedMetaCopies = std::to_string(gStoredPreviousBackMetaCopies);
+				std::string compressionLevel = std::to_string(gMetadataCompressionLevel);
 				char* metarestoreArgs[] = {
 					const_cast<char*>(metarestorePath_.c_str()),
 					const_cast<char*>("-m"),
@@ -153,6 +154,8 @@ bool MetadataDumper::start(MetadataDumper::DumpType& dumpType, uint64_t checksum
 					const_cast<char*>(checksumStringified.c_str()),
 					const_cast<char*>("-B"),
 					const_cast<char*>(storedMetaCopies.c_str()),
+					const_cast<char*>("-Z"),
+					const_cast<char*>(compressionLevel.c_str()),
 					const_cast<char*>("-#"),
 					const_cast<char*>(changelogFilename.c_str()),
 					NULL};
@@ -20,11 +20,13 @@
 
 #include "master/recursive_remove_task.h"
 
+#include "master/filesystem_snapshot.h"
+
 bool RemoveTask::isFinished() const {
 	return current_subtask_ == subtask_.end();
 }
 
-int RemoveTask::retrieveNodes(FSNodeDirectory *&wd, FSNode *&child) {
+int RemoveTask::retrieveNodes(uint32_t ts, FSNodeDirectory *&wd, FSNode *&child) {
 	FSNode *wd_tmp = fsnodes_id_to_node(parent_);
 	if (!wd_tmp) {
 		return LIZARDFS_ERROR_ENOENT;
@@ -33,6 +35,7 @@ int RemoveTask::retrieveNodes(FSNodeDirectory *&wd, FSNode *&child) {
 		return LIZARDFS_ERROR_EACCES;
 	}
 	wd = static_cast<FSNodeDirectory*>(wd_tmp);
+	fsnodes_lazy_snapshot_materialize(FsContext::getForMaster(ts), wd, true);
 	child = fsnodes_lookup(wd, *current_subtask_);
 	if (!child) {
 		return LIZARDFS_ERROR_ENOENT;
@@ -40,6 +43,7 @@ int RemoveTask::retrieveNodes(FSNodeDirectory *&wd, FSNode *&child) {
 	if (!fsnodes_sticky_access(wd, child, context_->uid())) {
 		return LIZARDFS_ERROR_EPERM;
 	}
+	fsnodes_lazy_snapshot_protect_dir(FsContext::getForMaster(ts), wd);
 	return LIZARDFS_STATUS_OK;
 }
 
@@ -52,7 +56,7 @@ void RemoveTask::doUnlink(uint32_t ts, FSNodeDirectory *wd, FSNode *child) {
 int RemoveTask::execute(uint32_t ts, intrusive_list<Task> &work_queue) {
 	FSNodeDirectory *wd = nullptr;
 	FSNode *child = nullptr;
-	int status = retrieveNodes(wd, child);
+	int status = retrieveNodes(ts, wd, child);
 	if (status != LIZARDFS_STATUS_OK) {
 		return status;
 	}
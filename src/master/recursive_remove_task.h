@@ -68,7 +68,7 @@ public:
 	}
 
 private:
-	int retrieveNodes(FSNodeDirectory *&wd, FSNode *&child);
+	int retrieveNodes(uint32_t ts, FSNodeDirectory *&wd, FSNode *&child);
 
 	/*! \brief Execute unlink operation to remove node. */
 	void doUnlink(uint32_t ts, FSNodeDirectory *wd, FSNode *child);
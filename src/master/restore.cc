@@ -23,9 +23,14 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <atomic>
+#include <exception>
+#include <memory>
+#include <thread>
 
 #include "protocol/MFSCommunication.h"
 #include "common/lizardfs_error_codes.h"
+#include "common/pcqueue.h"
 #include "common/slogger.h"
 #include "master/filesystem.h"
 #include "master/filesystem_snapshot.h"
@@ -191,35 +196,47 @@
 #define GETU32(data,clptr) do { char* end_ = NULL; (data)=strtoul(clptr,&end_,10); clptr = end_; } while (0)
 #define GETU64(data,clptr) do { char* end_ = NULL; (data)=strtoull(clptr,&end_,10); clptr = end_; } while (0)
 
-int do_access(const char *filename, uint64_t lv, uint32_t ts, const char *ptr) {
+/*
+ * Functions below only parse entries. Changes of metadata are done by actions which they
+ * return, so that entries can be parsed by another thread than the one applying them.
+ */
+
+static int do_access(const char *filename, uint64_t lv, uint32_t ts, const char *ptr,
+		RestoreAction &action) {
 	uint32_t inode;
 	EAT(ptr,filename,lv,'(');
 	GETU32(inode,ptr);
 	EAT(ptr,filename,lv,')');
-	return fs_apply_access(ts,inode);
+	action = [=]() { return fs_apply_access(ts,inode); };
+	return LIZARDFS_STATUS_OK;
 }
 
-int do_append(const char *filename, uint64_t lv, uint32_t ts, const char *ptr) {
+static int do_append(const char *filename, uint64_t lv, uint32_t ts, const char *ptr,
+		RestoreAction &action) {
 	uint32_t inode,inode_src;
 	EAT(ptr,filename,lv,'(');
 	GETU32(inode,ptr);
 	EAT(ptr,filename,lv,',');
 	GETU32(inode_src,ptr);
 	EAT(ptr,filename,lv,')');
-	return fs_append(FsContext::getForRestore(ts), inode, inode_src);
+	action = [=]() { return fs_append(FsContext::getForRestore(ts), inode, inode_src); };
+	return LIZARDFS_STATUS_OK;
 }
 
-int do_acquire(const char *filename, uint64_t lv, uint32_t ts, const char *ptr) {
+static int do_acquire(const char *filename, uint64_t lv, uint32_t ts, const char *ptr,
+		RestoreAction &action) {
 	uint32_t inode,cuid;
 	EAT(ptr,filename,lv,'(');
 	GETU32(inode,ptr);
 	EAT(ptr,filename,lv,',');
 	GETU32(cuid,ptr);
 	EAT(ptr,filename,lv,')');
-	return fs_acquire(FsContext::getForRestore(ts), inode, cuid);
+	action = [=]() { return fs_acquire(FsContext::getForRestore(ts), inode, cuid); };
+	return LIZARDFS_STATUS_OK;
 }
 
-int do_attr(const char *filename, uint64_t lv, uint32_t ts, const char *ptr) {
+static int do_attr(const char *filename, uint64_t lv, uint32_t ts, const char *ptr,
+		RestoreAction &action) {
 	uint32_t inode,mode,uid,gid,atime,mtime;
 	EAT(ptr,filename,lv,'(');
 	GETU32(inode,ptr);
@@ -234,10 +251,12 @@ int do_attr(const char *filename, uint64_t lv, uint32_t ts, const char *ptr) {
 	EAT(ptr,filename,lv,',');
 	GETU32(mtime,ptr);
 	EAT(ptr,filename,lv,')');
-	return fs_apply_attr(ts,inode,mode,uid,gid,atime,mtime);
+	action = [=]() { return fs_apply_attr(ts,inode,mode,uid,gid,atime,mtime); };
+	return LIZARDFS_STATUS_OK;
 }
 
-int do_checksum(const char *filename, uint64_t lv, uint32_t, const char *ptr) {
+static int do_checksum(const char *filename, uint64_t lv, uint32_t, const char *ptr,
+		RestoreAction &action) {
 	uint8_t version[256];
 	uint64_t checksum;
 	EAT(ptr,filename,lv,'(');
@@ -245,10 +264,13 @@ int do_checksum(const char *filename, uint64_t lv, uint32_t, const char *ptr) {
 	EAT(ptr,filename,lv,')');
 	EAT(ptr,filename,lv,':');
 	GETU64(checksum,ptr);
-	return fs_apply_checksum((char*)&version, checksum);
+	std::string version_string((const char*)version);
+	action = [=]() { return fs_apply_checksum(version_string, checksum); };
+	return LIZARDFS_STATUS_OK;
 }
 
-int do_create(const char *filename, uint64_t lv, uint32_t ts, const char *ptr) {
+static int do_create(const char *filename, uint64_t lv, uint32_t ts, const char *ptr,
+		RestoreAction &action) {
 	uint32_t parent,mode,uid,gid,rdev,inode;
 	uint8_t type,name[256];
 	EAT(ptr,filename,lv,'(');
@@ -269,20 +291,27 @@ int do_create(const char *filename, uint64_t lv, uint32_t ts, const char *ptr) {
 	EAT(ptr,filename,lv,')');
 	EAT(ptr,filename,lv,':');
 	GETU32(inode,ptr);
-	return fs_apply_create(ts, parent, HString((const char*)name), type, mode, uid, gid, rdev, inode);
+	HString hname((const char*)name);
+	action = [=]() {
+		return fs_apply_create(ts, parent, hname, type, mode, uid, gid, rdev, inode);
+	};
+	return LIZARDFS_STATUS_OK;
 }
 
-int do_session(const char *filename, uint64_t lv, uint32_t ts, const char *ptr) {
+static int do_session(const char *filename, uint64_t lv, uint32_t ts, const char *ptr,
+		RestoreAction &action) {
 	uint32_t cuid;
 	(void)ts;
 	EAT(ptr,filename,lv,'(');
 	EAT(ptr,filename,lv,')');
 	EAT(ptr,filename,lv,':');
 	GETU32(cuid,ptr);
-	return fs_apply_session(cuid);
+	action = [=]() { return fs_apply_session(cuid); };
+	return LIZARDFS_STATUS_OK;
 }
 
-int do_emptytrash_deprecated(const char *filename, uint64_t lv, uint32_t ts, const char *ptr) {
+static int do_emptytrash_deprecated(const char *filename, uint64_t lv, uint32_t ts,
+		const char *ptr, RestoreAction &action) {
 	uint32_t reservedinodes,freeinodes;
 	EAT(ptr,filename,lv,'(');
 	EAT(ptr,filename,lv,')');
@@ -290,37 +319,45 @@ int do_emptytrash_deprecated(const char *filename, uint64_t lv, uint32_t ts, con
 	GETU32(freeinodes,ptr);
 	EAT(ptr,filename,lv,',');
 	GETU32(reservedinodes,ptr);
-	return fs_apply_emptytrash_deprecated(ts,freeinodes,reservedinodes);
+	action = [=]() { return fs_apply_emptytrash_deprecated(ts,freeinodes,reservedinodes); };
+	return LIZARDFS_STATUS_OK;
 }
 
-int do_emptyreserved_deprecated(const char *filename, uint64_t lv, uint32_t ts, const char* ptr) {
+static int do_emptyreserved_deprecated(const char *filename, uint64_t lv, uint32_t ts,
+		const char* ptr, RestoreAction &action) {
 	uint32_t freeinodes;
 	EAT(ptr,filename,lv,'(');
 	EAT(ptr,filename,lv,')');
 	EAT(ptr,filename,lv,':');
 	GETU32(freeinodes,ptr);
-	return fs_apply_emptyreserved_deprecated(ts,freeinodes);
+	action = [=]() { return fs_apply_emptyreserved_deprecated(ts,freeinodes); };
+	return LIZARDFS_STATUS_OK;
 }
 
-int do_freeinodes(const char *filename, uint64_t lv, uint32_t ts, const char* ptr) {
+static int do_freeinodes(const char *filename, uint64_t lv, uint32_t ts, const char* ptr,
+		RestoreAction &action) {
 	uint32_t freeinodes;
 	EAT(ptr,filename,lv,'(');
 	EAT(ptr,filename,lv,')');
 	EAT(ptr,filename,lv,':');
 	GETU32(freeinodes,ptr);
-	return fs_apply_freeinodes(ts,freeinodes);
+	action = [=]() { return fs_apply_freeinodes(ts,freeinodes); };
+	return LIZARDFS_STATUS_OK;
 }
 
-int do_incversion(const char *filename, uint64_t lv, uint32_t ts, const char *ptr) {
+static int do_incversion(const char *filename, uint64_t lv, uint32_t ts, const char *ptr,
+		RestoreAction &action) {
 	uint64_t chunkid;
 	(void)ts;
 	EAT(ptr,filename,lv,'(');
 	GETU64(chunkid,ptr);
 	EAT(ptr,filename,lv,')');
-	return fs_apply_incversion(chunkid);
+	action = [=]() { return fs_apply_incversion(chunkid); };
+	return LIZARDFS_STATUS_OK;
 }
 
-int do_link(const char *filename, uint64_t lv, uint32_t ts, const char *ptr) {
+static int do_link(const char *filename, uint64_t lv, uint32_t ts, const char *ptr,
+		RestoreAction &action) {
 	uint32_t inode,parent;
 	uint8_t name[256];
 	EAT(ptr,filename,lv,'(');
@@ -330,11 +367,15 @@ int do_link(const char *filename, uint64_t lv, uint32_t ts, const char *ptr) {
 	EAT(ptr,filename,lv,',');
 	GETNAME(name,ptr,filename,lv,')');
 	EAT(ptr,filename,lv,')');
-	return fs_link(FsContext::getForRestore(ts), inode, parent, HString((const char*)name),
-			nullptr, nullptr);
+	HString hname((const char*)name);
+	action = [=]() {
+		return fs_link(FsContext::getForRestore(ts), inode, parent, hname, nullptr, nullptr);
+	};
+	return LIZARDFS_STATUS_OK;
 }
 
-int do_length(const char *filename, uint64_t lv, uint32_t ts, const char *ptr) {
+static int do_length(const char *filename, uint64_t lv, uint32_t ts, const char *ptr,
+		RestoreAction &action) {
 	uint32_t inode;
 	uint64_t length;
 	EAT(ptr,filename,lv,'(');
@@ -342,10 +383,12 @@ int do_length(const char *filename, uint64_t lv, uint32_t ts, const char *ptr) {
 	EAT(ptr,filename,lv,',');
 	GETU64(length,ptr);
 	EAT(ptr,filename,lv,')');
-	return fs_apply_length(ts,inode,length);
+	action = [=]() { return fs_apply_length(ts,inode,length); };
+	return LIZARDFS_STATUS_OK;
 }
 
-int do_move(const char* filename, uint64_t lv, uint32_t ts, const char* ptr) {
+static int do_move(const char* filename, uint64_t lv, uint32_t ts, const char* ptr,
+		RestoreAction &action) {
 	uint32_t inode,parent_src,parent_dst;
 	uint8_t name_src[256],name_dst[256];
 	EAT(ptr,filename,lv,'(');
@@ -359,19 +402,21 @@ int do_move(const char* filename, uint64_t lv, uint32_t ts, const char* ptr) {
 	EAT(ptr,filename,lv,')');
 	EAT(ptr,filename,lv,':');
 	GETU32(inode,ptr);
-	return fs_rename(FsContext::getForRestore(ts),
-			parent_src, HString((const char*)name_src),
-			parent_dst, HString((const char*)name_dst),
-			&inode, nullptr);
+	HString hname_src((const char*)name_src);
+	HString hname_dst((const char*)name_dst);
+	action = [=]() mutable {
+		return fs_rename(FsContext::getForRestore(ts), parent_src, hname_src,
+				parent_dst, hname_dst, &inode, nullptr);
+	};
+	return LIZARDFS_STATUS_OK;
 }
 
-int do_lock_op(const char *filename, uint64_t lv, uint32_t ts, const char *ptr) {
+static int do_lock_op(const char *filename, uint64_t lv, uint32_t ts, const char *ptr,
+		RestoreAction &action) {
 	uint32_t lock_type, inode, sessionid;
 	uint64_t start, end;
 	uint64_t owner;
 	uint32_t op;
-	const bool nonblocking = false;
-	std::vector<FileLocks::Owner> dummy_applied;
 	EAT(ptr, filename, lv, '(');
 	GETU32(lock_type, ptr);
 	EAT(ptr, filename, lv, ',');
@@ -388,29 +433,35 @@ int do_lock_op(const char *filename, uint64_t lv, uint32_t ts, const char *ptr)
 	GETU32(op, ptr);
 	EAT(ptr,filename,lv,')');
 
-	int status = LIZARDFS_STATUS_OK;
-
-	switch (static_cast<lzfs_locks::Type>(lock_type)) {
-	case lzfs_locks::Type::kFlock:
-		status = fs_flock_op(FsContext::getForRestore(ts), inode, owner, sessionid, 0, 0,
-				op, nonblocking, dummy_applied);
-		break;
-	case lzfs_locks::Type::kPosix:
-		status = fs_posixlock_op(FsContext::getForRestore(ts), inode, start, end, owner, sessionid, 0, 0,
-				op, nonblocking, dummy_applied);
-		break;
-	default:
-		lzfs_pretty_syslog(LOG_ERR, "Invalid lock type passed to restore: %u", lock_type);
-		return LIZARDFS_ERROR_EINVAL;
-	}
+	action = [=]() {
+		const bool nonblocking = false;
+		std::vector<FileLocks::Owner> dummy_applied;
+		int status = LIZARDFS_STATUS_OK;
 
-	if (status==LIZARDFS_ERROR_WAITING) {
-		return LIZARDFS_STATUS_OK;
-	}
-	return status;
+		switch (static_cast<lzfs_locks::Type>(lock_type)) {
+		case lzfs_locks::Type::kFlock:
+			status = fs_flock_op(FsContext::getForRestore(ts), inode, owner, sessionid, 0, 0,
+					op, nonblocking, dummy_applied);
+			break;
+		case lzfs_locks::Type::kPosix:
+			status = fs_posixlock_op(FsContext::getForRestore(ts), inode, start, end, owner, sessionid, 0, 0,
+					op, nonblocking, dummy_applied);
+			break;
+		default:
+			lzfs_pretty_syslog(LOG_ERR, "Invalid lock type passed to restore: %u", lock_type);
+			return static_cast<int>(LIZARDFS_ERROR_EINVAL);
+		}
+
+		if (status==LIZARDFS_ERROR_WAITING) {
+			return static_cast<int>(LIZARDFS_STATUS_OK);
+		}
+		return status;
+	};
+	return LIZARDFS_STATUS_OK;
 }
 
-int do_remove_pending_op(const char *filename, uint64_t lv, uint32_t ts, const char *ptr) {
+static int do_remove_pending_op(const char *filename, uint64_t lv, uint32_t ts,
+		const char *ptr, RestoreAction &action) {
 	uint32_t lock_type;
 	uint64_t ownerid;
 	uint32_t sessionid;
@@ -429,13 +480,16 @@ int do_remove_pending_op(const char *filename, uint64_t lv, uint32_t ts, const c
 	GETU64(reqid, ptr);
 	EAT(ptr,filename,lv,')');
 
-	return fs_locks_remove_pending(FsContext::getForRestore(ts), lock_type, ownerid, sessionid,
-		inode, reqid);
+	action = [=]() {
+		return fs_locks_remove_pending(FsContext::getForRestore(ts), lock_type, ownerid,
+				sessionid, inode, reqid);
+	};
+	return LIZARDFS_STATUS_OK;
 }
 
-int do_lock_clear_session(const char *filename, uint64_t lv, uint32_t ts, const char *ptr) {
+static int do_lock_clear_session(const char *filename, uint64_t lv, uint32_t ts,
+		const char *ptr, RestoreAction &action) {
 	uint32_t lock_type, inode, sessionid;
-	std::vector<FileLocks::Owner> applied;
 
 	EAT(ptr, filename, lv, '(');
 	GETU32(lock_type, ptr);
@@ -445,12 +499,17 @@ int do_lock_clear_session(const char *filename, uint64_t lv, uint32_t ts, const
 	GETU32(sessionid, ptr);
 	EAT(ptr, filename, lv, ')');
 
-	return fs_locks_clear_session(FsContext::getForRestore(ts), lock_type, inode, sessionid, applied);
+	action = [=]() {
+		std::vector<FileLocks::Owner> applied;
+		return fs_locks_clear_session(FsContext::getForRestore(ts), lock_type, inode,
+				sessionid, applied);
+	};
+	return LIZARDFS_STATUS_OK;
 }
 
-int do_lock_unlock_inode(const char *filename, uint64_t lv, uint32_t ts, const char *ptr) {
+static int do_lock_unlock_inode(const char *filename, uint64_t lv, uint32_t ts,
+		const char *ptr, RestoreAction &action) {
 	uint32_t lock_type, inode;
-	std::vector<FileLocks::Owner> applied;
 
 	EAT(ptr, filename, lv, '(');
 	GETU32(lock_type, ptr);
@@ -458,28 +517,37 @@ int do_lock_unlock_inode(const char *filename, uint64_t lv, uint32_t ts, const c
 	GETU32(inode, ptr);
 	EAT(ptr, filename, lv, ')');
 
-	return fs_locks_unlock_inode(FsContext::getForRestore(ts), lock_type, inode, applied);
+	action = [=]() {
+		std::vector<FileLocks::Owner> applied;
+		return fs_locks_unlock_inode(FsContext::getForRestore(ts), lock_type, inode, applied);
+	};
+	return LIZARDFS_STATUS_OK;
 }
 
-int do_purge(const char* filename, uint64_t lv, uint32_t ts, const char* ptr) {
+static int do_purge(const char* filename, uint64_t lv, uint32_t ts, const char* ptr,
+		RestoreAction &action) {
 	uint32_t inode;
 	EAT(ptr,filename,lv,'(');
 	GETU32(inode,ptr);
 	EAT(ptr,filename,lv,')');
-	return fs_purge(FsContext::getForRestore(ts), inode);
+	action = [=]() { return fs_purge(FsContext::getForRestore(ts), inode); };
+	return LIZARDFS_STATUS_OK;
 }
 
-int do_release(const char* filename, uint64_t lv, uint32_t ts, const char* ptr) {
+static int do_release(const char* filename, uint64_t lv, uint32_t ts, const char* ptr,
+		RestoreAction &action) {
 	uint32_t inode,cuid;
 	EAT(ptr,filename,lv,'(');
 	GETU32(inode,ptr);
 	EAT(ptr,filename,lv,',');
 	GETU32(cuid,ptr);
 	EAT(ptr,filename,lv,')');
-	return fs_release(FsContext::getForRestore(ts), inode, cuid);
+	action = [=]() { return fs_release(FsContext::getForRestore(ts), inode, cuid); };
+	return LIZARDFS_STATUS_OK;
 }
 
-int do_repair(const char* filename, uint64_t lv, uint32_t ts, const char* ptr) {
+static int do_repair(const char* filename, uint64_t lv, uint32_t ts, const char* ptr,
+		RestoreAction &action) {
 	uint32_t inode,indx;
 	uint32_t version;
 	EAT(ptr,filename,lv,'(');
@@ -489,10 +557,12 @@ int do_repair(const char* filename, uint64_t lv, uint32_t ts, const char* ptr) {
 	EAT(ptr,filename,lv,')');
 	EAT(ptr,filename,lv,':');
 	GETU32(version,ptr);
-	return fs_apply_repair(ts,inode,indx,version);
+	action = [=]() { return fs_apply_repair(ts,inode,indx,version); };
+	return LIZARDFS_STATUS_OK;
 }
 
-int do_seteattr(const char* filename, uint64_t lv, uint32_t ts, const char* ptr) {
+static int do_seteattr(const char* filename, uint64_t lv, uint32_t ts, const char* ptr,
+		RestoreAction &action) {
 	uint32_t inode,uid,ci,nci,npi;
 	uint8_t eattr,smode;
 	EAT(ptr,filename,lv,'(');
@@ -510,10 +580,15 @@ int do_seteattr(const char* filename, uint64_t lv, uint32_t ts, const char* ptr)
 	GETU32(nci,ptr);
 	EAT(ptr,filename,lv,',');
 	GETU32(npi,ptr);
-	return fs_seteattr(FsContext::getForRestoreWithUidGid(ts, uid, 0), inode, eattr, smode, &ci, &nci, &npi);
+	action = [=]() mutable {
+		return fs_seteattr(FsContext::getForRestoreWithUidGid(ts, uid, 0), inode, eattr, smode,
+				&ci, &nci, &npi);
+	};
+	return LIZARDFS_STATUS_OK;
 }
 
-int do_setgoal(const char *filename, uint64_t lv, uint32_t ts, const char *ptr) {
+static int do_setgoal(const char *filename, uint64_t lv, uint32_t ts, const char *ptr,
+		RestoreAction &action) {
 	uint32_t inode, uid, ci, nci, npi;
 	uint8_t goal, smode;
 	EAT(ptr, filename, lv, '(');
@@ -533,31 +608,44 @@ int do_setgoal(const char *filename, uint64_t lv, uint32_t ts, const char *ptr)
 			GETU32(nci, ptr);
 			EAT(ptr, filename, lv, ',');
 			GETU32(npi, ptr);
-			return fs_deprecated_setgoal(FsContext::getForRestoreWithUidGid(ts, uid, 0),
-			                             inode, goal, smode, &ci, &nci, &npi);
+			action = [=]() mutable {
+				return fs_deprecated_setgoal(FsContext::getForRestoreWithUidGid(ts, uid, 0),
+				                             inode, goal, smode, &ci, &nci, &npi);
+			};
 		} else {
-			return fs_apply_setgoal(FsContext::getForRestoreWithUidGid(ts, uid, 0),
-			                        inode, goal, smode, ci);
+			action = [=]() {
+				return fs_apply_setgoal(FsContext::getForRestoreWithUidGid(ts, uid, 0),
+				                        inode, goal, smode, ci);
+			};
 		}
 	} else {
-		return fs_apply_setgoal(FsContext::getForRestoreWithUidGid(ts, uid, 0), inode, goal,
-		                        smode, SetGoalTask::kChanged);
+		action = [=]() {
+			return fs_apply_setgoal(FsContext::getForRestoreWithUidGid(ts, uid, 0), inode,
+			                        goal, smode, SetGoalTask::kChanged);
+		};
 	}
+	return LIZARDFS_STATUS_OK;
 }
 
-int do_setpath(const char* filename, uint64_t lv, uint32_t ts, const char* ptr) {
+static int do_setpath(const char* filename, uint64_t lv, uint32_t ts, const char* ptr,
+		RestoreAction &action) {
 	uint32_t inode;
-	static uint8_t *path = NULL;
-	static uint32_t pathsize = 0;
+	static thread_local uint8_t *path = NULL;
+	static thread_local uint32_t pathsize = 0;
 	EAT(ptr,filename,lv,'(');
 	GETU32(inode,ptr);
 	EAT(ptr,filename,lv,',');
 	GETPATH(path,pathsize,ptr,filename,lv,')');
 	EAT(ptr,filename,lv,')');
-	return fs_settrashpath(FsContext::getForRestore(ts), inode, std::string((const char*)path));
+	std::string path_string((const char*)path);
+	action = [=]() {
+		return fs_settrashpath(FsContext::getForRestore(ts), inode, path_string);
+	};
+	return LIZARDFS_STATUS_OK;
 }
 
-int do_settrashtime(const char *filename, uint64_t lv, uint32_t ts, const char *ptr) {
+static int do_settrashtime(const char *filename, uint64_t lv, uint32_t ts, const char *ptr,
+		RestoreAction &action) {
 	uint32_t inode, uid, ci, nci, npi;
 	uint32_t trashtime;
 	uint8_t smode;
@@ -578,24 +666,32 @@ int do_settrashtime(const char *filename, uint64_t lv, uint32_t ts, const char *
 			GETU32(nci, ptr);
 			EAT(ptr, filename, lv, ',');
 			GETU32(npi, ptr);
-			return fs_deprecated_settrashtime(
-			        FsContext::getForRestoreWithUidGid(ts, uid, 0), inode, trashtime,
-			        smode, &ci, &nci, &npi);
+			action = [=]() mutable {
+				return fs_deprecated_settrashtime(
+				        FsContext::getForRestoreWithUidGid(ts, uid, 0), inode, trashtime,
+				        smode, &ci, &nci, &npi);
+			};
 		} else {
-			return fs_apply_settrashtime(FsContext::getForRestoreWithUidGid(ts, uid, 0),
-			                             inode, trashtime, smode, ci);
+			action = [=]() {
+				return fs_apply_settrashtime(FsContext::getForRestoreWithUidGid(ts, uid, 0),
+				                             inode, trashtime, smode, ci);
+			};
 		}
 	} else {
-		return fs_apply_settrashtime(FsContext::getForRestoreWithUidGid(ts, uid, 0), inode,
-		                             trashtime, smode, SetTrashtimeTask::kChanged);
+		action = [=]() {
+			return fs_apply_settrashtime(FsContext::getForRestoreWithUidGid(ts, uid, 0), inode,
+			                             trashtime, smode, SetTrashtimeTask::kChanged);
+		};
 	}
+	return LIZARDFS_STATUS_OK;
 }
 
-int do_setxattr(const char* filename, uint64_t lv, uint32_t ts, const char* ptr) {
+static int do_setxattr(const char* filename, uint64_t lv, uint32_t ts, const char* ptr,
+		RestoreAction &action) {
 	uint32_t inode,valueleng,mode;
 	uint8_t name[256];
-	static uint8_t *value = NULL;
-	static uint32_t valuesize = 0;
+	static thread_local uint8_t *value = NULL;
+	static thread_local uint32_t valuesize = 0;
 	EAT(ptr,filename,lv,'(');
 	GETU32(inode,ptr);
 	EAT(ptr,filename,lv,',');
@@ -605,10 +701,17 @@ int do_setxattr(const char* filename, uint64_t lv, uint32_t ts, const char* ptr)
 	EAT(ptr,filename,lv,',');
 	GETU32(mode,ptr);
 	EAT(ptr,filename,lv,')');
-	return fs_apply_setxattr(ts,inode,strlen((char*)name),name,valueleng,value,mode);
+	std::string name_string((const char*)name);
+	std::vector<uint8_t> value_data(value, value + valueleng);
+	action = [=]() {
+		return fs_apply_setxattr(ts, inode, name_string.size(),
+				(const uint8_t*)name_string.data(), value_data.size(), value_data.data(), mode);
+	};
+	return LIZARDFS_STATUS_OK;
 }
 
-int do_deleteacl(const char *filename, uint64_t lv, uint32_t ts, const char *ptr) {
+static int do_deleteacl(const char *filename, uint64_t lv, uint32_t ts, const char *ptr,
+		RestoreAction &action) {
 	uint32_t inode;
 	char aclTypeRaw = '\0';
 
@@ -628,14 +731,16 @@ int do_deleteacl(const char *filename, uint64_t lv, uint32_t ts, const char *ptr
 		lzfs_pretty_syslog(LOG_ERR, "%s:%" PRIu64 ": corrupted ACL type", filename, lv);
 		return -1;
 	}
-	return fs_deleteacl(FsContext::getForRestore(ts), inode, aclType);
+	action = [=]() { return fs_deleteacl(FsContext::getForRestore(ts), inode, aclType); };
+	return LIZARDFS_STATUS_OK;
 }
 
-int do_setacl(const char *filename, uint64_t lv, uint32_t ts, const char *ptr) {
+static int do_setacl(const char *filename, uint64_t lv, uint32_t ts, const char *ptr,
+		RestoreAction &action) {
 	uint32_t inode;
 	char aclType = '\0';
-	static uint8_t *aclString = NULL;
-	static uint32_t aclSize = 0;
+	static thread_local uint8_t *aclString = NULL;
+	static thread_local uint32_t aclSize = 0;
 
 	EAT(ptr, filename, lv, '(');
 	GETU32(inode, ptr);
@@ -645,13 +750,16 @@ int do_setacl(const char *filename, uint64_t lv, uint32_t ts, const char *ptr) {
 	GETPATH(aclString, aclSize, ptr, filename, lv, ')');
 	EAT(ptr, filename, lv, ')');
 
-	return fs_apply_setacl(ts, inode, aclType, reinterpret_cast<const char*>(aclString));
+	std::string acl(reinterpret_cast<const char*>(aclString));
+	action = [=]() { return fs_apply_setacl(ts, inode, aclType, acl.c_str()); };
+	return LIZARDFS_STATUS_OK;
 }
 
-int do_setrichacl(const char *filename, uint64_t lv, uint32_t ts, const char *ptr) {
+static int do_setrichacl(const char *filename, uint64_t lv, uint32_t ts, const char *ptr,
+		RestoreAction &action) {
 	uint32_t inode;
-	static uint8_t *acl_string = NULL;
-	static uint32_t acl_size = 0;
+	static thread_local uint8_t *acl_string = NULL;
+	static thread_local uint32_t acl_size = 0;
 
 	EAT(ptr, filename, lv, '(');
 	GETU32(inode, ptr);
@@ -659,10 +767,13 @@ int do_setrichacl(const char *filename, uint64_t lv, uint32_t ts, const char *pt
 	GETPATH(acl_string, acl_size, ptr, filename, lv, ')');
 	EAT(ptr, filename, lv, ')');
 
-	return fs_apply_setrichacl(ts, inode, reinterpret_cast<const char*>(acl_string));
+	std::string acl(reinterpret_cast<const char*>(acl_string));
+	action = [=]() { return fs_apply_setrichacl(ts, inode, acl); };
+	return LIZARDFS_STATUS_OK;
 }
 
-int do_setquota(const char *filename, uint64_t lv, uint32_t, const char *ptr) {
+static int do_setquota(const char *filename, uint64_t lv, uint32_t, const char *ptr,
+		RestoreAction &action) {
 	char rigor = '\0', resource = '\0', ownerType = '\0';
 	uint32_t ownerId;
 	uint64_t limit;
@@ -679,15 +790,18 @@ int do_setquota(const char *filename, uint64_t lv, uint32_t, const char *ptr) {
 	GETU64(limit, ptr);
 	EAT(ptr, filename, lv, ')');
 
-	return fs_apply_setquota(rigor, resource, ownerType, ownerId, limit);
+	action = [=]() { return fs_apply_setquota(rigor, resource, ownerType, ownerId, limit); };
+	return LIZARDFS_STATUS_OK;
 }
 
-int do_snapshot(const char* /*filename*/, uint64_t /*lv*/, uint32_t /*ts*/, const char* /*ptr*/) {
+static int do_snapshot(const char* /*filename*/, uint64_t /*lv*/, uint32_t /*ts*/,
+		const char* /*ptr*/, RestoreAction &/*action*/) {
 	lzfs_pretty_syslog(LOG_ERR, "Trying to execute deprecated do_snapshot");
 	return -1;
 }
 
-int do_clone_node(const char* filename, uint64_t lv, uint32_t ts, const char* ptr) {
+static int do_clone_node(const char* filename, uint64_t lv, uint32_t ts, const char* ptr,
+		RestoreAction &action) {
 	uint32_t src_inode, dst_parent, dst_inode, can_overwrite;
 	uint8_t name[256];
 	EAT(ptr,filename,lv,'(');
@@ -701,15 +815,51 @@ int do_clone_node(const char* filename, uint64_t lv, uint32_t ts, const char* pt
 	EAT(ptr,filename,lv,',');
 	GETU32(can_overwrite,ptr);
 	EAT(ptr,filename,lv,')');
-	return fs_clone_node(FsContext::getForRestore(ts), src_inode, dst_parent, dst_inode,
-				HString((const char*)name), can_overwrite);
+	HString hname((const char*)name);
+	action = [=]() {
+		return fs_clone_node(FsContext::getForRestore(ts), src_inode, dst_parent, dst_inode,
+				hname, can_overwrite);
+	};
+	return LIZARDFS_STATUS_OK;
+}
+
+static int do_lazy_clone_node(const char* filename, uint64_t lv, uint32_t ts, const char* ptr,
+		RestoreAction &action) {
+	uint32_t src_inode, dst_parent, dst_inode;
+	uint8_t name[256];
+	EAT(ptr,filename,lv,'(');
+	GETU32(src_inode,ptr);
+	EAT(ptr,filename,lv,',');
+	GETU32(dst_parent,ptr);
+	EAT(ptr,filename,lv,',');
+	GETU32(dst_inode,ptr);
+	EAT(ptr,filename,lv,',');
+	GETNAME(name,ptr,filename,lv,')');
+	EAT(ptr,filename,lv,')');
+	HString hname((const char*)name);
+	action = [=]() {
+		return fs_lazy_clone_node(FsContext::getForRestore(ts), src_inode, dst_parent,
+				dst_inode, hname);
+	};
+	return LIZARDFS_STATUS_OK;
+}
+
+static int do_materialize(const char* filename, uint64_t lv, uint32_t /*ts*/, const char* ptr,
+		RestoreAction &action) {
+	uint32_t inode;
+	EAT(ptr,filename,lv,'(');
+	GETU32(inode,ptr);
+	EAT(ptr,filename,lv,')');
+	action = [=]() { return fs_apply_materialize(inode); };
+	return LIZARDFS_STATUS_OK;
 }
 
-int do_symlink(const char* filename, uint64_t lv, uint32_t ts, const char* ptr) {
+static int do_symlink(const char* filename, uint64_t lv, uint32_t ts, const char* ptr,
+		RestoreAction &action) {
 	uint32_t parent,uid,gid,inode;
 	uint8_t name[256];
-	static uint8_t *path = NULL;
-	static uint32_t pathsize = 0;
+	static thread_local uint8_t *path = NULL;
+	static thread_local uint32_t pathsize = 0;
 	EAT(ptr,filename,lv,'(');
 	GETU32(parent,ptr);
 	EAT(ptr,filename,lv,',');
@@ -723,19 +873,27 @@ int do_symlink(const char* filename, uint64_t lv, uint32_t ts, const char* ptr)
 	EAT(ptr,filename,lv,')');
 	EAT(ptr,filename,lv,':');
 	GETU32(inode,ptr);
-	return fs_symlink(FsContext::getForRestoreWithUidGid(ts, uid, gid),
-			parent, HString((char*)name), std::string((char*)path), &inode, nullptr);
+	HString hname((char*)name);
+	std::string path_string((char*)path);
+	action = [=]() mutable {
+		return fs_symlink(FsContext::getForRestoreWithUidGid(ts, uid, gid),
+				parent, hname, path_string, &inode, nullptr);
+	};
+	return LIZARDFS_STATUS_OK;
 }
 
-int do_undel(const char* filename, uint64_t lv, uint32_t ts, const char* ptr) {
+static int do_undel(const char* filename, uint64_t lv, uint32_t ts, const char* ptr,
+		RestoreAction &action) {
 	uint32_t inode;
 	EAT(ptr,filename,lv,'(');
 	GETU32(inode,ptr);
 	EAT(ptr,filename,lv,')');
-	return fs_undel(FsContext::getForRestore(ts), inode);
+	action = [=]() { return fs_undel(FsContext::getForRestore(ts), inode); };
+	return LIZARDFS_STATUS_OK;
 }
 
-int do_unlink(const char* filename, uint64_t lv, uint32_t ts, const char* ptr) {
+static int do_unlink(const char* filename, uint64_t lv, uint32_t ts, const char* ptr,
+		RestoreAction &action) {
 	uint32_t inode,parent;
 	uint8_t name[256];
 	EAT(ptr,filename,lv,'(');
@@ -745,28 +903,35 @@ int do_unlink(const char* filename, uint64_t lv, uint32_t ts, const char* ptr) {
 	EAT(ptr,filename,lv,')');
 	EAT(ptr,filename,lv,':');
 	GETU32(inode,ptr);
-	return fs_apply_unlink(ts, parent, HString((char*)name), inode);
+	HString hname((char*)name);
+	action = [=]() { return fs_apply_unlink(ts, parent, hname, inode); };
+	return LIZARDFS_STATUS_OK;
 }
 
-int do_unlock(const char* filename, uint64_t lv, uint32_t ts, const char* ptr) {
+static int do_unlock(const char* filename, uint64_t lv, uint32_t ts, const char* ptr,
+		RestoreAction &action) {
 	uint64_t chunkid;
 	(void)ts;
 	EAT(ptr,filename,lv,'(');
 	GETU64(chunkid,ptr);
 	EAT(ptr,filename,lv,')');
-	return fs_apply_unlock(chunkid);
+	action = [=]() { return fs_apply_unlock(chunkid); };
+	return LIZARDFS_STATUS_OK;
 }
 
-int do_nextchunkid(const char* filename, uint64_t lv, uint32_t ts, const char* ptr) {
+static int do_nextchunkid(const char* filename, uint64_t lv, uint32_t ts, const char* ptr,
+		RestoreAction &action) {
 	uint64_t nextChunkId;
 	EAT(ptr, filename, lv, '(');
 	GETU64(nextChunkId, ptr);
 	EAT(ptr, filename, lv, ')');
-	return fs_set_nextchunkid(FsContext::getForRestore(ts), nextChunkId);
+	action = [=]() { return fs_set_nextchunkid(FsContext::getForRestore(ts), nextChunkId); };
+	return LIZARDFS_STATUS_OK;
 }
 
 
-int do_trunc(const char* filename, uint64_t lv, uint32_t ts, const char* ptr) {
+static int do_trunc(const char* filename, uint64_t lv, uint32_t ts, const char* ptr,
+		RestoreAction &action) {
 	uint32_t inode,indx,lockid;
 	uint64_t chunkid;
 	EAT(ptr,filename,lv,'(');
@@ -782,10 +947,12 @@ int do_trunc(const char* filename, uint64_t lv, uint32_t ts, const char* ptr) {
 	EAT(ptr,filename,lv,')');
 	EAT(ptr,filename,lv,':');
 	GETU64(chunkid,ptr);
-	return fs_apply_trunc(ts,inode,indx,chunkid,lockid);
+	action = [=]() { return fs_apply_trunc(ts,inode,indx,chunkid,lockid); };
+	return LIZARDFS_STATUS_OK;
 }
 
-int do_write(const char* filename, uint64_t lv, uint32_t ts, const char* ptr) {
+static int do_write(const char* filename, uint64_t lv, uint32_t ts, const char* ptr,
+		RestoreAction &action) {
 	uint32_t inode,indx;
 	uint64_t chunkid;
 	uint32_t lockid;
@@ -809,158 +976,193 @@ int do_write(const char* filename, uint64_t lv, uint32_t ts, const char* ptr) {
 	EAT(ptr,filename,lv,')');
 	EAT(ptr,filename,lv,':');
 	GETU64(chunkid,ptr);
-	return fs_writechunk(FsContext::getForRestore(ts), inode, indx, false, &lockid, &chunkid, &opflag, nullptr);
+	action = [=]() mutable {
+		return fs_writechunk(FsContext::getForRestore(ts), inode, indx, false, &lockid,
+				&chunkid, &opflag, nullptr);
+	};
+	return LIZARDFS_STATUS_OK;
 }
 
-int restore_line(const char* filename, uint64_t lv, const char* line) {
+/*
+ * Returns LIZARDFS_ERROR_MAX for unknown entries, a negative value if the entry can't
+ * be parsed and LIZARDFS_STATUS_OK otherwise. Sets 'op' to the offset of the operation name.
+ */
+static int restore_parse_line(const char* filename, uint64_t lv, const char* line,
+		uint32_t &op, RestoreAction &action) {
 	uint32_t ts;
 	int status;
 
 	status = LIZARDFS_ERROR_MAX;
 	const char* ptr = line;
 
+	op = 0;
 	EAT(ptr,filename,lv,':');
 	EAT(ptr,filename,lv,' ');
 	GETU32(ts,ptr);
 	EAT(ptr,filename,lv,'|');
+	op = ptr - line;
 	switch (*ptr) {
 		case 'A':
 			if (strncmp(ptr,"ACCESS",6)==0) {
-				status = do_access(filename,lv,ts,ptr+6);
+				status = do_access(filename,lv,ts,ptr+6,action);
 			} else if (strncmp(ptr,"ATTR",4)==0) {
-				status = do_attr(filename,lv,ts,ptr+4);
+				status = do_attr(filename,lv,ts,ptr+4,action);
 			} else if (strncmp(ptr,"APPEND",6)==0) {
-				status = do_append(filename,lv,ts,ptr+6);
+				status = do_append(filename,lv,ts,ptr+6,action);
 			} else if (strncmp(ptr,"ACQUIRE",7)==0) {
-				status = do_acquire(filename,lv,ts,ptr+7);
+				status = do_acquire(filename,lv,ts,ptr+7,action);
 			} else if (strncmp(ptr,"AQUIRE",6)==0) {
-				status = do_acquire(filename,lv,ts,ptr+6);
+				status = do_acquire(filename,lv,ts,ptr+6,action);
 			}
 			break;
 		case 'C':
 			if (strncmp(ptr,"CHECKSUM",8)==0) {
-				status = do_checksum(filename,lv,ts,ptr+8);
+				status = do_checksum(filename,lv,ts,ptr+8,action);
 			} else if (strncmp(ptr,"CLONE",5)==0) {
-				status = do_clone_node(filename,lv,ts,ptr+5);
+				status = do_clone_node(filename,lv,ts,ptr+5,action);
 			} else if (strncmp(ptr,"CREATE",6)==0) {
-				status = do_create(filename,lv,ts,ptr+6);
+				status = do_create(filename,lv,ts,ptr+6,action);
 			} else if (strncmp(ptr,"CUSTOMER",8)==0) {      // deprecated
-				status = do_session(filename,lv,ts,ptr+8);
+				status = do_session(filename,lv,ts,ptr+8,action);
 			} else if (strncmp(ptr,"CLRLCK",6)==0) {
-				status = do_lock_clear_session(filename,lv,ts,ptr+6);
+				status = do_lock_clear_session(filename,lv,ts,ptr+6,action);
 			}
 			break;
 		case 'D':
 			if (strncmp(ptr,"DELETEACL",9)==0) {
-				status = do_deleteacl(filename,lv,ts,ptr+9);
+				status = do_deleteacl(filename,lv,ts,ptr+9,action);
 			}
 			break;
 		case 'E':
 			if (strncmp(ptr,"EMPTYTRASH",10)==0) {
-				status = do_emptytrash_deprecated(filename,lv,ts,ptr+10);
+				status = do_emptytrash_deprecated(filename,lv,ts,ptr+10,action);
 			} else if (strncmp(ptr,"EMPTYRESERVED",13)==0) {
-				status = do_emptyreserved_deprecated(filename,lv,ts,ptr+13);
+				status = do_emptyreserved_deprecated(filename,lv,ts,ptr+13,action);
 			}
 			break;
 		case 'F':
 			if (strncmp(ptr,"FLCKINODE",9)==0) {
-				status = do_lock_unlock_inode(filename,lv,ts,ptr+9);
+				status = do_lock_unlock_inode(filename,lv,ts,ptr+9,action);
 			} else if (strncmp(ptr, "FLCK", 4) == 0) {
-				status = do_lock_op(filename,lv,ts,ptr+4);
+				status = do_lock_op(filename,lv,ts,ptr+4,action);
 			} else if (strncmp(ptr, "FREEINODES", 10) == 0) {
-				status = do_freeinodes(filename,lv,ts,ptr+10);
+				status = do_freeinodes(filename,lv,ts,ptr+10,action);
 			}
 			break;
 		case 'I':
 			if (strncmp(ptr,"INCVERSION",10)==0) {
-				status = do_incversion(filename,lv,ts,ptr+10);
+				status = do_incversion(filename,lv,ts,ptr+10,action);
 			}
 			break;
 		case 'L':
 			if (strncmp(ptr,"LENGTH",6)==0) {
-				status = do_length(filename,lv,ts,ptr+6);
+				status = do_length(filename,lv,ts,ptr+6,action);
 			} else if (strncmp(ptr,"LINK",4)==0) {
-				status = do_link(filename,lv,ts,ptr+4);
+				status = do_link(filename,lv,ts,ptr+4,action);
+			} else if (strncmp(ptr,"LAZYCLONE",9)==0) {
+				status = do_lazy_clone_node(filename,lv,ts,ptr+9,action);
 			}
 			break;
 		case 'M':
 			if (strncmp(ptr,"MOVE",4)==0) {
-				status = do_move(filename,lv,ts,ptr+4);
+				status = do_move(filename,lv,ts,ptr+4,action);
+			} else if (strncmp(ptr,"MATERIALIZE",11)==0) {
+				status = do_materialize(filename,lv,ts,ptr+11,action);
 			}
 			break;
 		case 'N':
 			if (strncmp(ptr, "NEXTCHUNKID", 11) == 0) {
-				status = do_nextchunkid(filename,lv,ts,ptr + 11);
+				status = do_nextchunkid(filename,lv,ts,ptr + 11,action);
 			}
 			break;
 		case 'P':
 			if (strncmp(ptr,"PURGE",5)==0) {
-				status = do_purge(filename,lv,ts,ptr+5);
+				status = do_purge(filename,lv,ts,ptr+5,action);
 			}
 			break;
 		case 'R':
 			if (strncmp(ptr,"RELEASE",7)==0) {
-				status = do_release(filename,lv,ts,ptr+7);
+				status = do_release(filename,lv,ts,ptr+7,action);
 			} else if (strncmp(ptr,"REPAIR",6)==0) {
-				status = do_repair(filename,lv,ts,ptr+6);
+				status = do_repair(filename,lv,ts,ptr+6,action);
 			} else if (strncmp(ptr,"RMPLOCK",7)==0) {
-				status = do_remove_pending_op(filename,lv,ts,ptr+7);
+				status = do_remove_pending_op(filename,lv,ts,ptr+7,action);
 			}
 			break;
 		case 'S':
 			if (strncmp(ptr,"SESSION",7)==0) {
-				status = do_session(filename,lv,ts,ptr+7);
+				status = do_session(filename,lv,ts,ptr+7,action);
 			} else if (strncmp(ptr,"SETACL",6)==0) {
-				status = do_setacl(filename,lv,ts,ptr+6);
+				status = do_setacl(filename,lv,ts,ptr+6,action);
 			} else if (strncmp(ptr,"SETEATTR",8)==0) {
-				status = do_seteattr(filename,lv,ts,ptr+8);
+				status = do_seteattr(filename,lv,ts,ptr+8,action);
 			} else if (strncmp(ptr,"SETGOAL",7)==0) {
-				status = do_setgoal(filename,lv,ts,ptr+7);
+				status = do_setgoal(filename,lv,ts,ptr+7,action);
 			} else if (strncmp(ptr,"SETPATH",7)==0) {
-				status = do_setpath(filename,lv,ts,ptr+7);
+				status = do_setpath(filename,lv,ts,ptr+7,action);
 			} else if (strncmp(ptr,"SETQUOTA",8)==0) {
-				status = do_setquota(filename,lv,ts,ptr+8);
+				status = do_setquota(filename,lv,ts,ptr+8,action);
 			} else if (strncmp(ptr,"SETTRASHTIME",12)==0) {
-				status = do_settrashtime(filename,lv,ts,ptr+12);
+				status = do_settrashtime(filename,lv,ts,ptr+12,action);
 			} else if (strncmp(ptr,"SETXATTR",8)==0) {
-				status = do_setxattr(filename,lv,ts,ptr+8);
+				status = do_setxattr(filename,lv,ts,ptr+8,action);
 			} else if (strncmp(ptr,"SNAPSHOT",8)==0) {    // deprecated
-				status = do_snapshot(filename,lv,ts,ptr+8);
+				status = do_snapshot(filename,lv,ts,ptr+8,action);
 			} else if (strncmp(ptr,"SYMLINK",7)==0) {
-				status = do_symlink(filename,lv,ts,ptr+7);
+				status = do_symlink(filename,lv,ts,ptr+7,action);
 			} else if (strncmp(ptr,"SETRICHACL",10)==0) {
-				status = do_setrichacl(filename,lv,ts,ptr+10);
+				status = do_setrichacl(filename,lv,ts,ptr+10,action);
 			}
 			break;
 		case 'T':
 			if (strncmp(ptr,"TRUNC",5)==0) {
-				status = do_trunc(filename,lv,ts,ptr+5);
+				status = do_trunc(filename,lv,ts,ptr+5,action);
 			}
 			break;
 		case 'U':
 			if (strncmp(ptr,"UNLINK",6)==0) {
-				status = do_unlink(filename,lv,ts,ptr+6);
+				status = do_unlink(filename,lv,ts,ptr+6,action);
 			} else if (strncmp(ptr,"UNDEL",5)==0) {
-				status = do_undel(filename,lv,ts,ptr+5);
+				status = do_undel(filename,lv,ts,ptr+5,action);
 			} else if (strncmp(ptr,"UNLOCK",6)==0) {
-				status = do_unlock(filename,lv,ts,ptr+6);
+				status = do_unlock(filename,lv,ts,ptr+6,action);
 			}
 			break;
 		case 'W':
 			if (strncmp(ptr,"WRITE",5)==0) {
-				status = do_write(filename,lv,ts,ptr+5);
+				status = do_write(filename,lv,ts,ptr+5,action);
 			}
 			break;
 		default:
 			break;
 	}
+	return status;
+}
+
+void restore_parse(const char* filename, uint64_t lv, const char* line, RestoreEntry &entry) {
+	entry.filename = filename;
+	entry.version = lv;
+	entry.line = line;
+	entry.action = nullptr;
+	entry.status = restore_parse_line(filename, lv, line, entry.op, entry.action);
+}
 
+static int restore_line(const RestoreEntry &entry) {
+	const char *filename = entry.filename;
+	uint64_t lv = entry.version;
+	const char *line = entry.line.c_str();
+	int status = entry.status;
+
+	if (status == LIZARDFS_STATUS_OK) {
+		status = entry.action();
+	}
 	if (status == LIZARDFS_ERROR_MAX) {
 #ifndef METARESTORE
 		lzfs_silent_syslog(LOG_DEBUG, "master.mismatch File %s, %" PRIu64 ", %s -- unknown entry",
 			   filename, lv, line);
 #endif
-		lzfs_pretty_syslog(LOG_ERR, "%s:%" PRIu64 ": unknown entry '%s'", filename, lv, ptr);
+		lzfs_pretty_syslog(LOG_ERR, "%s:%" PRIu64 ": unknown entry '%s'", filename, lv,
+			line + entry.op);
 	} else if (status != LIZARDFS_STATUS_OK) {
 #ifndef METARESTORE
 		lzfs_silent_syslog(LOG_DEBUG, "master.mismatch File %s, %" PRIu64 ", %s -- %s",
@@ -985,6 +1187,33 @@ uint64_t currentFsVersion = 0; /* Metadata version from before restore_line() ca
 const char *lastfn = NULL;
 uint8_t verbosity = 0;
 
+/*
+ * Entries parsed ahead of applying them by restore_read_ahead(). Entries are handed over
+ * in batches, so that the threads don't synchronize for every entry.
+ */
+struct RestoreBatch {
+	static constexpr uint32_t kMaxEntries = 4096;
+	static constexpr uint32_t kMaxDataSize = 1 << 20;
+
+	void add(RestoreEntry &&entry) {
+		data_size += entry.line.size();
+		entries.push_back(std::move(entry));
+	}
+
+	bool full() const {
+		return entries.size() >= kMaxEntries || data_size >= kMaxDataSize;
+	}
+
+	std::vector<RestoreEntry> entries;
+	uint32_t data_size = 0; // size of lines of the entries
+};
+
+constexpr uint32_t RestoreBatch::kMaxEntries;
+constexpr uint32_t RestoreBatch::kMaxDataSize;
+
+// Number of batches which may wait for entries to be applied
+constexpr uint32_t kReadAheadBatches = 16;
+
 }
 
 void restore_reset() {
@@ -993,7 +1222,9 @@ void restore_reset() {
 	lastfn = NULL;
 }
 
-uint8_t restore(const char* filename, uint64_t newLogVersion, const char *ptr, RestoreRigor rigor) {
+uint8_t restore(const RestoreEntry &entry, RestoreRigor rigor) {
+	const char *filename = entry.filename;
+	uint64_t newLogVersion = entry.version;
 	if (currentFsVersion == 0 || nextFsVersion == 0) {
 		/*
 		 * This is first call to restore().
@@ -1005,7 +1236,7 @@ uint8_t restore(const char* filename, uint64_t newLogVersion, const char *ptr, R
 	if (verbosity > 1) {
 		lzfs_pretty_syslog(LOG_NOTICE, "filename: %s ; current meta version: %" PRIu64 " ; previous changeid: %"
 				PRIu64 " ; current changeid: %" PRIu64 " ; change data%s",
-				filename, nextFsVersion, currentFsVersion, newLogVersion, ptr);
+				filename, nextFsVersion, currentFsVersion, newLogVersion, entry.line.c_str());
 	}
 	if (newLogVersion < currentFsVersion) {
 		lzfs_pretty_syslog(LOG_ERR,
@@ -1025,9 +1256,9 @@ uint8_t restore(const char* filename, uint64_t newLogVersion, const char *ptr, R
 			return LIZARDFS_ERROR_CHANGELOGINCONSISTENT;
 		} else {
 			if (verbosity > 0) {
-				lzfs_pretty_syslog(LOG_NOTICE, "%s: change %s", filename, ptr);
+				lzfs_pretty_syslog(LOG_NOTICE, "%s: change %s", filename, entry.line.c_str());
 			}
-			int status = restore_line(filename,newLogVersion,ptr);
+			int status = restore_line(entry);
 			if (status<0) { // parse error - stop processing if requested
 				return (rigor == RestoreRigor::kIgnoreParseErrors ? 0 : LIZARDFS_ERROR_PARSE);
 			}
@@ -1049,6 +1280,74 @@ uint8_t restore(const char* filename, uint64_t newLogVersion, const char *ptr, R
 	return LIZARDFS_STATUS_OK;
 }
 
+uint8_t restore(const char* filename, uint64_t newLogVersion, const char *ptr, RestoreRigor rigor) {
+	RestoreEntry entry;
+	restore_parse(filename, newLogVersion, ptr, entry);
+	return restore(entry, rigor);
+}
+
+uint8_t restore_read_ahead(const std::function<bool(RestoreEntry &)> &read,
+		const std::function<uint8_t(const RestoreEntry &)> &apply) {
+	void *queue = queue_new(kReadAheadBatches);
+	std::atomic<bool> stop(false);
+	std::exception_ptr exception;
+
+	std::thread reader([queue, &read, &stop, &exception]() {
+		RestoreBatch *batch = nullptr;
+		try {
+			while (!stop) {
+				if (batch == nullptr) {
+					batch = new RestoreBatch;
+				}
+				RestoreEntry entry;
+				if (!read(entry)) {
+					break;
+				}
+				batch->add(std::move(entry));
+				if (batch->full()) {
+					queue_put(queue, 0, 0, reinterpret_cast<uint8_t *>(batch), 1);
+					batch = nullptr;
+				}
+			}
+		} catch (...) {
+			// rethrown by the applying thread after the entries read so far are applied
+			exception = std::current_exception();
+		}
+		if (batch != nullptr) {
+			queue_put(queue, 0, 0, reinterpret_cast<uint8_t *>(batch), 1);
+		}
+		// empty batch marks the end of entries
+		queue_put(queue, 0, 0, nullptr, 1);
+	});
+
+	uint8_t status = LIZARDFS_STATUS_OK;
+	for (;;) {
+		uint32_t id, op, length;
+		uint8_t *data;
+		queue_get(queue, &id, &op, &data, &length);
+		std::unique_ptr<RestoreBatch> batch(reinterpret_cast<RestoreBatch *>(data));
+		if (!batch) {
+			break;
+		}
+		// after an error, remaining batches are only taken, so that the reader can finish
+		for (const RestoreEntry &entry : batch->entries) {
+			if (status != LIZARDFS_STATUS_OK) {
+				break;
+			}
+			status = apply(entry);
+			if (status != LIZARDFS_STATUS_OK) {
+				stop = true;
+			}
+		}
+	}
+	reader.join();
+	queue_delete(queue);
+	if (status == LIZARDFS_STATUS_OK && exception) {
+		std::rethrow_exception(exception);
+	}
+	return status;
+}
+
 void restore_setverblevel(uint8_t _vlevel) {
 	verbosity = _vlevel;
 }
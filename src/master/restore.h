@@ -21,9 +21,44 @@
 #include "common/platform.h"
 
 #include <inttypes.h>
+#include <functional>
+#include <string>
 
 enum class RestoreRigor { kIgnoreParseErrors, kDontIgnoreAnyErrors };
 
+typedef std::function<int()> RestoreAction;
+
+/// Changelog entry parsed by restore_parse(), which can be applied later.
+struct RestoreEntry {
+	const char *filename = nullptr; // has to be valid until the entry is applied
+	uint64_t version = 0;
+	std::string line;
+	uint32_t op = 0; // offset of the operation name in the line
+	int status = 0; // result of parsing, the action is set only if it's LIZARDFS_STATUS_OK
+	RestoreAction action;
+};
+
 void restore_reset();
+
+/*! \brief Parses a changelog entry without changing metadata.
+ *
+ * Entries may be parsed by a different thread than the one applying them, but by one
+ * thread at a time.
+ */
+void restore_parse(const char* filename, uint64_t lv, const char* line, RestoreEntry &entry);
+
+/// Applies a parsed changelog entry, checking its version as restore() does.
+uint8_t restore(const RestoreEntry &entry, RestoreRigor rigor);
 uint8_t restore(const char* filename, uint64_t lv, const char* ptr, RestoreRigor rigor);
+
+/*! \brief Reads and parses changelog entries in a separate thread while applying them.
+ *
+ * \param read - called by the reading thread, fills the next entry (e.g. using
+ *        restore_parse()) and returns false when there are no more entries.
+ * \param apply - called in the calling thread for entries in the order they were read.
+ *        The first status other than LIZARDFS_STATUS_OK stops reading and is returned.
+ * An exception thrown by \p read is rethrown after entries read before it are applied.
+ */
+uint8_t restore_read_ahead(const std::function<bool(RestoreEntry &)> &read,
+		const std::function<uint8_t(const RestoreEntry &)> &apply);
 void restore_setverblevel(uint8_t _vlevel);
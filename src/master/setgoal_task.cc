@@ -23,6 +23,7 @@
 #include "master/filesystem_checksum.h"
 #include "master/filesystem_node.h"
 #include "master/filesystem_operations.h"
+#include "master/filesystem_snapshot.h"
 #include "master/matotsserv.h"
 
 int SetGoalTask::execute(uint32_t ts, intrusive_list<Task> &work_queue) {
@@ -35,6 +36,13 @@ int SetGoalTask::execute(uint32_t ts, intrusive_list<Task> &work_queue) {
 		return LIZARDFS_ERROR_EINVAL;
 	}
 
+	FsContext context = FsContext::getForMaster(ts);
+	if (node->type == FSNode::kDirectory && (smode_ & SMODE_RMASK)) {
+		fsnodes_lazy_snapshot_protect_dir(context, static_cast<FSNodeDirectory *>(node));
+	} else {
+		fsnodes_lazy_snapshot_protect(context, node);
+	}
+
 	uint8_t result = setGoal(node, ts);
 
 	if (result != kNoAction) {
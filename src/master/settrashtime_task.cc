@@ -22,6 +22,7 @@
 
 #include "master/filesystem_checksum.h"
 #include "master/filesystem_operations.h"
+#include "master/filesystem_snapshot.h"
 
 int SetTrashtimeTask::execute(uint32_t ts, intrusive_list<Task> &work_queue) {
 	assert(current_inode_ != inode_list_.end());
@@ -33,6 +34,13 @@ int SetTrashtimeTask::execute(uint32_t ts, intrusive_list<Task> &work_queue) {
 		return LIZARDFS_ERROR_EINVAL;
 	}
 
+	FsContext context = FsContext::getForMaster(ts);
+	if (node->type == FSNode::kDirectory && (smode_ & SMODE_RMASK)) {
+		fsnodes_lazy_snapshot_protect_dir(context, static_cast<FSNodeDirectory *>(node));
+	} else {
+		fsnodes_lazy_snapshot_protect(context, node);
+	}
+
 	uint8_t result = setTrashtime(node, ts);
 
 	if (result != kNoAction) {
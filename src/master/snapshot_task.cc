@@ -24,8 +24,13 @@
 #include "master/filesystem_metadata.h"
 #include "master/filesystem_operations.h"
 #include "master/filesystem_quota.h"
+#include "master/filesystem_snapshot.h"
 
 int SnapshotTask::cloneNodeTest(FSNode *src_node, FSNode *dst_node, FSNodeDirectory *dst_parent) {
+	// Lazy clones materialize contents which were already accounted for by the snapshot.
+	if (lazy_) {
+		return dst_node ? LIZARDFS_ERROR_EEXIST : LIZARDFS_STATUS_OK;
+	}
 	if (fsnodes_quota_exceeded_ug(src_node, {{QuotaResource::kInodes, 1}}) ||
 	    fsnodes_quota_exceeded_dir(dst_parent, {{QuotaResource::kInodes, 1}})) {
 		return LIZARDFS_ERROR_QUOTA;
@@ -146,7 +151,7 @@ void SnapshotTask::cloneChunkData(const FSNodeFile *src_node, FSNodeFile *dst_no
 	for (uint32_t i = 0; i < src_node->chunks.size(); ++i) {
 		auto chunkid = src_node->chunks[i];
 		if (chunkid > 0) {
-			if (chunk_add_file(chunkid, dst_node->goal) != LIZARDFS_STATUS_OK) {
+			if (chunk_add_file(chunkid, dst_node->goal, dst_node->id) != LIZARDFS_STATUS_OK) {
 				lzfs_pretty_syslog(LOG_ERR,
 				       "structure error - chunk %016" PRIX64
 				       " not found (inode: %" PRIu32 " ; index: %" PRIu32 ")",
@@ -161,9 +166,14 @@ void SnapshotTask::cloneChunkData(const FSNodeFile *src_node, FSNodeFile *dst_no
 }
 
 void SnapshotTask::cloneDirectoryData(const FSNodeDirectory *src_node, FSNodeDirectory *dst_node) {
+	if (lazy_) {
+		fsnodes_lazy_snapshot_register(src_node, dst_node);
+		return;
+	}
 	if (!enqueue_work_) {
 		return;
 	}
+	src_node = fsnodes_lazy_snapshot_resolve(src_node);
 	SubtaskContainer data;
 	data.reserve(src_node->entries.size());
 	for (const auto &entry : src_node->entries) {
@@ -198,6 +208,19 @@ void SnapshotTask::emitChangelog(uint32_t ts, uint32_t dst_inode) {
 		return;
 	}
 
+	if (lazy_ && defer_changelog_) {
+		fs_changelog_defer(ts, "LAZYCLONE(%" PRIu32 ",%" PRIu32 ",%" PRIu32 ",%s)",
+		                   current_subtask_->first, dst_parent_inode_, dst_inode,
+		                   fsnodes_escape_name(current_subtask_->second).c_str());
+		return;
+	}
+	if (lazy_) {
+		fs_changelog(ts, "LAZYCLONE(%" PRIu32 ",%" PRIu32 ",%" PRIu32 ",%s)",
+		             current_subtask_->first, dst_parent_inode_, dst_inode,
+		             fsnodes_escape_name(current_subtask_->second).c_str());
+		return;
+	}
+
 	fs_changelog(ts, "CLONE(%" PRIu32 ",%" PRIu32 ",%" PRIu32 ",%s,%" PRIu8 ")",
 	             current_subtask_->first, dst_parent_inode_, dst_inode,
 	             fsnodes_escape_name(current_subtask_->second).c_str(), can_overwrite_);
@@ -214,12 +237,19 @@ int SnapshotTask::cloneNode(uint32_t ts) {
 		return LIZARDFS_ERROR_EINVAL;
 	}
 
+	if (emit_changelog_ && !lazy_) {
+		fsnodes_lazy_snapshot_materialize(FsContext::getForMaster(ts), dst_parent, true);
+	}
+
 	FSNode *dst_node = fsnodes_lookup(dst_parent, current_subtask_->second);
 
 	int status = cloneNodeTest(src_node, dst_node, dst_parent);
 	if (status != LIZARDFS_STATUS_OK) {
 		return status;
 	}
+	if (emit_changelog_ && !lazy_) {
+		fsnodes_lazy_snapshot_protect_dir(FsContext::getForMaster(ts), dst_parent);
+	}
 
 	if (dst_node) {
 		dst_node = cloneToExistingNode(ts, src_node, dst_parent, dst_node);
@@ -38,6 +38,10 @@
  * with child inodes.
  *
  * Processing of enqueued tasks is done by Task Manager class.
+ *
+ * In lazy mode directories are not traversed. Cloned directory is registered
+ * as a lazy snapshot of its source (see LazySnapshotRegistry) and its contents
+ * are cloned on demand, one level at a time.
  */
 class SnapshotTask : public TaskManager::Task {
 public:
@@ -45,12 +49,15 @@ public:
 
 	SnapshotTask(SubtaskContainer &&subtask, uint32_t orig_inode, uint32_t dst_parent_inode,
 		     uint32_t dst_inode, uint8_t can_overwrite, uint8_t ignore_missing_src,
-		     bool emit_changelog, bool enqueue_work) :
+		     bool emit_changelog, bool enqueue_work, bool lazy = false,
+		     bool defer_changelog = false) :
 		     subtask_(std::move(subtask)), orig_inode_(orig_inode),
 		     dst_parent_inode_(dst_parent_inode),dst_inode_(dst_inode),
 		     can_overwrite_(can_overwrite), ignore_missing_src_(ignore_missing_src),
-		     emit_changelog_(emit_changelog), enqueue_work_(enqueue_work), local_tasks_() {
+		     emit_changelog_(emit_changelog), enqueue_work_(enqueue_work), lazy_(lazy),
+		     defer_changelog_(defer_changelog), local_tasks_() {
 		assert(subtask_.size() == 1 || (subtask_.size() > 1 && dst_inode == 0));
+		assert(!(lazy_ && enqueue_work_));
 		current_subtask_ = subtask_.begin();
 	}
 
@@ -100,8 +107,8 @@ protected:
 
 	/*! \brief Emit metadata changelog.
 	 *
-	 * The function (for master) emits metadata CLONE information. For shadow it updates
-	 * metadata version.
+	 * The function (for master) emits metadata CLONE (or LAZYCLONE) information.
+	 * For shadow it updates metadata version.
 	 */
 	void emitChangelog(uint32_t ts, uint32_t dst_inode);
 
@@ -119,6 +126,9 @@ private:
 	bool emit_changelog_;       /*!< If true change log message should be generated. */
 	bool enqueue_work_;         /*!< If true then new clone request should be created
 	                                 for source inode's children. */
+	bool lazy_;                 /*!< If true then directories are cloned as lazy snapshots. */
+	bool defer_changelog_;      /*!< If true change log message is deferred
+	                                 (see fs_changelog_defer). */
 	intrusive_list<Task> local_tasks_; /*< List of snapshot tasks created by this
 	                                                   task for source inode's children. */
 };
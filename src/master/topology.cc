@@ -27,6 +27,7 @@
 #include <string.h>
 #include <syslog.h>
 #include <unistd.h>
+#include <unordered_map>
 
 #include "common/cfg.h"
 #include "common/event_loop.h"
@@ -35,6 +36,8 @@
 #include "master/itree.h"
 
 static void *racktree;
+// rack id -> zone id, racks not listed here belong to zone 0
+static std::unordered_map<uint32_t, uint32_t> gRackZones;
 static char *TopologyFileName;
 static int gPreferLocalChunkserver;
 
@@ -153,11 +156,17 @@ int topology_parsenet(char *net,uint32_t *fromip,uint32_t *toip) {
 	return -1;
 }
 
+static uint32_t topology_zone(uint32_t rid) {
+	auto it = gRackZones.find(rid);
+	return it == gRackZones.end() ? 0 : it->second;
+}
+
 // as for now:
 //
 // 0 - same machine
 // 1 - same rack, different machines
-// 2 - different racks
+// 2 - different racks in the same zone
+// 3 - different zones
 
 uint8_t topology_distance(uint32_t ip1,uint32_t ip2) {
 	uint32_t rid1,rid2;
@@ -166,11 +175,14 @@ uint8_t topology_distance(uint32_t ip1,uint32_t ip2) {
 	}
 	rid1 = itree_find(racktree,ip1);
 	rid2 = itree_find(racktree,ip2);
-	return (rid1==rid2)?1:2;
+	if (rid1==rid2) {
+		return 1;
+	}
+	return (topology_zone(rid1)==topology_zone(rid2))?2:3;
 }
 
 // format:
-// network      rackid
+// network      rackid      [zoneid]
 
 /*
 idea for the future:
@@ -308,7 +320,9 @@ L: 00000001000000000000
 M: 00000010000000000000
 */
 
-int topology_parseline(char *line,uint32_t lineno,uint32_t *fip,uint32_t *tip,uint32_t *rid) {
+// returns 1 if zone id was given, 0 if not and -1 on error
+int topology_parseline(char *line,uint32_t lineno,uint32_t *fip,uint32_t *tip,uint32_t *rid,uint32_t *zid) {
+	int haszone;
 	char *net;
 	char *p;
 
@@ -353,19 +367,30 @@ int topology_parseline(char *line,uint32_t lineno,uint32_t *fip,uint32_t *tip,ui
 		p++;
 	}
 
+	haszone = 0;
+	if (*p>='0' && *p<='9') {
+		*zid = strtoul(p,&p,10);
+		haszone = 1;
+		while (*p==' ' || *p=='\t') {
+			p++;
+		}
+	}
+
 	if (*p && *p!='\r' && *p!='\n' && *p!='#') {
 		lzfs_pretty_syslog(LOG_WARNING,"mfstopology: garbage found at the end of line: %" PRIu32,lineno);
 		return -1;
 	}
-	return 0;
+	return haszone;
 }
 
 void topology_load(void) {
 	FILE *fd;
 	char linebuff[10000];
 	uint32_t lineno;
-	uint32_t fip,tip,rid;
+	uint32_t fip,tip,rid,zid;
+	int haszone;
 	void *newtree;
+	std::unordered_map<uint32_t, uint32_t> newzones;
 
 	fd = fopen(TopologyFileName,"r");
 	if (fd==NULL) {
@@ -401,9 +426,19 @@ void topology_load(void) {
 	newtree = NULL;
 	lineno = 1;
 	while (fgets(linebuff,10000,fd)) {
-		if (topology_parseline(linebuff,lineno,&fip,&tip,&rid)>=0) {
+		haszone = topology_parseline(linebuff,lineno,&fip,&tip,&rid,&zid);
+		if (haszone>=0) {
 			newtree = itree_add_interval(newtree,fip,tip,rid);
 		}
+		if (haszone>0) {
+			auto it = newzones.find(rid);
+			if (it != newzones.end() && it->second != zid) {
+				lzfs_pretty_syslog(LOG_WARNING,
+						"mfstopology: rack %" PRIu32 " moved to zone %" PRIu32 " in line: %" PRIu32,
+						rid,zid,lineno);
+			}
+			newzones[rid] = zid;
+		}
 		lineno++;
 	}
 	if (ferror(fd)) {
@@ -423,6 +458,7 @@ void topology_load(void) {
 	fclose(fd);
 	itree_freeall(racktree);
 	racktree = newtree;
+	gRackZones.swap(newzones);
 	if (racktree) {
 		racktree = itree_rebalance(racktree);
 	}
@@ -0,0 +1,224 @@
+/*
+   Copyright 2017 Skytechnology sp. z o.o.
+
+   This file is part of LizardFS.
+
+   LizardFS is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, version 3.
+
+   LizardFS is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with LizardFS. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "common/platform.h"
+#include "master/xattr_storage.h"
+
+#include <cassert>
+#include <cstring>
+#include <new>
+
+constexpr uint32_t InternedStringPool::kNone;
+constexpr uint32_t InternedStringPool::kChunkSize;
+constexpr uint32_t InternedStringPool::kMaxLength;
+constexpr uint32_t XattrStorage::kNone;
+
+InternedStringPool::InternedStringPool() : last_chunk_used_(kChunkSize) {
+}
+
+uint32_t InternedStringPool::hash(const uint8_t *data, uint32_t length) {
+	// FNV-1a
+	uint32_t hash = 2166136261U;
+	for (uint32_t i = 0; i < length; ++i) {
+		hash = (hash ^ data[i]) * 16777619U;
+	}
+	return hash;
+}
+
+uint32_t InternedStringPool::roundedLength(uint32_t length) {
+	return (length + 7) & ~7U;
+}
+
+uint64_t *InternedStringPool::findSlot(uint32_t hash, const uint8_t *data, uint32_t length) {
+	return index_.find(hash, [this, hash, data, length](uint64_t slot) {
+		if ((slot >> 32) != hash) {
+			return false;
+		}
+		uint32_t id = (slot & UINT32_MAX) - 1;
+		return records_[id].length == length &&
+		       (length == 0 || memcmp(this->data(id), data, length) == 0);
+	});
+}
+
+uint32_t InternedStringPool::find(const uint8_t *data, uint32_t length) {
+	uint64_t *slot = findSlot(hash(data, length), data, length);
+	return slot ? (*slot & UINT32_MAX) - 1 : kNone;
+}
+
+uint32_t InternedStringPool::acquire(const uint8_t *data, uint32_t length) {
+	assert(length <= kMaxLength);
+	uint32_t string_hash = hash(data, length);
+	uint64_t *slot = findSlot(string_hash, data, length);
+	if (slot) {
+		uint32_t id = (*slot & UINT32_MAX) - 1;
+		records_[id].refcount++;
+		return id;
+	}
+
+	uint32_t id;
+	if (!free_ids_.empty()) {
+		id = free_ids_.back();
+		free_ids_.pop_back();
+	} else {
+		if (records_.size() >= kNone - 1) {
+			throw std::bad_alloc();
+		}
+		id = records_.size();
+		records_.push_back(Record());
+	}
+	Record &record = records_[id];
+	record.offset = allocate(length);
+	record.length = length;
+	record.refcount = 1;
+	if (length > 0) {
+		memcpy(const_cast<uint8_t *>(this->data(id)), data, length);
+	}
+	index_.insert((static_cast<uint64_t>(string_hash) << 32) | (id + 1));
+	return id;
+}
+
+void InternedStringPool::release(uint32_t id) {
+	Record &record = records_[id];
+	assert(record.refcount > 0);
+	if (--record.refcount > 0) {
+		return;
+	}
+	uint64_t *slot = index_.find(hash(data(id), record.length),
+			[id](uint64_t slot) { return (slot & UINT32_MAX) == id + 1; });
+	assert(slot);
+	index_.erase(slot);
+	deallocate(record.offset, record.length);
+	free_ids_.push_back(id);
+}
+
+uint64_t InternedStringPool::allocate(uint32_t length) {
+	if (length == 0) {
+		return 0;
+	}
+	uint32_t size = roundedLength(length);
+	auto it = free_space_.find(size);
+	if (it != free_space_.end()) {
+		uint64_t offset = it->second.back();
+		it->second.pop_back();
+		if (it->second.empty()) {
+			free_space_.erase(it);
+		}
+		return offset;
+	}
+	if (last_chunk_used_ + size > kChunkSize) {
+		// the rest of the last chunk is not big enough, it is left for smaller strings
+		if (last_chunk_used_ < kChunkSize) {
+			deallocate(chunks_.size() * (uint64_t)kChunkSize - (kChunkSize - last_chunk_used_),
+			           kChunkSize - last_chunk_used_);
+		}
+		chunks_.emplace_back(new uint8_t[kChunkSize]);
+		last_chunk_used_ = 0;
+	}
+	uint64_t offset = (chunks_.size() - 1) * (uint64_t)kChunkSize + last_chunk_used_;
+	last_chunk_used_ += size;
+	return offset;
+}
+
+void InternedStringPool::deallocate(uint64_t offset, uint32_t length) {
+	if (length > 0) {
+		free_space_[roundedLength(length)].push_back(offset);
+	}
+}
+
+uint64_t InternedStringPool::memoryUsage() const {
+	uint64_t free_space_size = 0;
+	for (const auto &free : free_space_) {
+		free_space_size += free.second.capacity() * sizeof(uint64_t);
+	}
+	return chunks_.size() * (uint64_t)kChunkSize + records_.capacity() * sizeof(Record) +
+	       free_ids_.capacity() * sizeof(uint32_t) + free_space_size + index_.memoryUsage();
+}
+
+void InternedStringPool::clear() {
+	std::vector<Record>().swap(records_);
+	std::vector<uint32_t>().swap(free_ids_);
+	std::vector<std::unique_ptr<uint8_t[]>>().swap(chunks_);
+	last_chunk_used_ = kChunkSize;
+	free_space_.clear();
+	index_.clear();
+}
+
+XattrStorage::Entry *XattrStorage::find(uint32_t inode, const uint8_t *name,
+		uint8_t name_length) {
+	uint32_t name_id = names_.find(name, name_length);
+	if (name_id == InternedStringPool::kNone) {
+		return nullptr;
+	}
+	return findEntry(inode, name_id);
+}
+
+XattrStorage::Entry *XattrStorage::findAny(uint32_t inode) {
+	InodeIndex *index = findIndex(inode);
+	return index ? findEntry(inode, index->first) : nullptr;
+}
+
+void XattrStorage::insert(uint32_t inode, const uint8_t *name, uint8_t name_length,
+		const uint8_t *value, uint32_t value_length) {
+	assert(inode != 0);
+	uint32_t name_id = names_.acquire(name, name_length);
+	uint32_t value_id = values_.acquire(value, value_length);
+	InodeIndex *index = findIndex(inode);
+	if (index) {
+		entries_.insert(Entry(inode, name_id, value_id, index->first));
+		index->first = name_id;
+	} else {
+		entries_.insert(Entry(inode, name_id, value_id, kNone));
+		inodes_.insert(InodeIndex(inode, name_id));
+	}
+}
+
+void XattrStorage::setValue(Entry *entry, const uint8_t *value, uint32_t value_length) {
+	uint32_t old_value = entry->value;
+	entry->value = values_.acquire(value, value_length);
+	values_.release(old_value);
+}
+
+void XattrStorage::erase(Entry *entry) {
+	InodeIndex *index = findIndex(entry->inode);
+	assert(index);
+	if (index->first == entry->name) {
+		if (entry->next == kNone) {
+			inodes_.erase(index);
+		} else {
+			index->first = entry->next;
+		}
+	} else {
+		// Lists are short, so the previous attribute is found by walking from the head
+		Entry *prev = findEntry(entry->inode, index->first);
+		while (prev->next != entry->name) {
+			prev = findEntry(entry->inode, prev->next);
+			assert(prev);
+		}
+		prev->next = entry->next;
+	}
+	names_.release(entry->name);
+	values_.release(entry->value);
+	entries_.erase(entry);
+}
+
+void XattrStorage::clear() {
+	entries_.clear();
+	inodes_.clear();
+	names_.clear();
+	values_.clear();
+}
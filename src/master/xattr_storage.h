@@ -0,0 +1,272 @@
+/*
+   Copyright 2017 Skytechnology sp. z o.o.
+
+   This file is part of LizardFS.
+
+   LizardFS is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, version 3.
+
+   LizardFS is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with LizardFS. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include "common/platform.h"
+
+#include <cassert>
+#include <cstdint>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+#include "common/hashfn.h"
+#include "common/incremental_hash_table.h"
+
+/*!
+ * \brief Deduplicated, reference counted byte strings identified by 32-bit ids.
+ *
+ * Strings are kept in 1 MiB chunks. Space of released strings is reused by new strings
+ * of the same (rounded) length, so nothing is ever moved and pointers returned by data()
+ * are valid until the string is released.
+ */
+class InternedStringPool {
+public:
+	static constexpr uint32_t kNone = UINT32_MAX;
+	static constexpr uint32_t kChunkSize = 1 << 20;
+	/*! Maximal length of a string. */
+	static constexpr uint32_t kMaxLength = kChunkSize / 4;
+
+	InternedStringPool();
+
+	InternedStringPool(const InternedStringPool &) = delete;
+	InternedStringPool &operator=(const InternedStringPool &) = delete;
+
+	/*! \brief Returns id of the string or kNone if it isn't in the pool. */
+	uint32_t find(const uint8_t *data, uint32_t length);
+
+	/*! \brief Returns id of the string with its reference count increased. */
+	uint32_t acquire(const uint8_t *data, uint32_t length);
+
+	/*! \brief Decreases reference count of the string, removes it if it drops to 0. */
+	void release(uint32_t id);
+
+	/*! \brief Content of the string, nullptr for an empty one. */
+	const uint8_t *data(uint32_t id) const {
+		const Record &record = records_[id];
+		return record.length > 0 ? chunks_[record.offset / kChunkSize].get() +
+		                                   record.offset % kChunkSize
+		                         : nullptr;
+	}
+
+	uint32_t length(uint32_t id) const {
+		return records_[id].length;
+	}
+
+	uint32_t refcount(uint32_t id) const {
+		return records_[id].refcount;
+	}
+
+	/*! \brief Number of distinct strings. */
+	std::size_t size() const {
+		return index_.size();
+	}
+
+	/*! \brief Number of bytes allocated by the pool. */
+	uint64_t memoryUsage() const;
+
+	void clear();
+
+private:
+	struct Record {
+		uint64_t offset;
+		uint32_t length;
+		uint32_t refcount; /*!< 0 for unused records. */
+	};
+
+	/* Slot of the index is 32 bits of hash and id + 1 */
+	struct IndexHasher {
+		uint64_t operator()(uint64_t slot) const {
+			return slot >> 32;
+		}
+		static bool empty(uint64_t slot) {
+			return slot == 0;
+		}
+	};
+
+	static uint32_t hash(const uint8_t *data, uint32_t length);
+	static uint32_t roundedLength(uint32_t length);
+
+	uint64_t *findSlot(uint32_t hash, const uint8_t *data, uint32_t length);
+	uint64_t allocate(uint32_t length);
+	void deallocate(uint64_t offset, uint32_t length);
+
+	std::vector<Record> records_;
+	std::vector<uint32_t> free_ids_;
+	std::vector<std::unique_ptr<uint8_t[]>> chunks_;
+	uint32_t last_chunk_used_;
+	/*! Offsets of released strings, by their rounded length. */
+	std::unordered_map<uint32_t, std::vector<uint64_t>> free_space_;
+	IncrementalHashTable<uint64_t, IndexHasher> index_;
+};
+
+/*!
+ * \brief Extended attributes of all inodes.
+ *
+ * Attributes are kept in a hash table keyed by (inode, name id), with names and values
+ * interned in pools, so common names (e.g. "security.selinux") and values (e.g. labels)
+ * are stored once. Attributes of an inode form a list linked by name ids, whose head
+ * is kept in a second table keyed by inode, so listing and removing them doesn't
+ * depend on attributes of other inodes, even if many inodes have many attributes.
+ */
+class XattrStorage {
+public:
+	struct Entry {
+		Entry() : inode(0), name(0), value(0), next(0) {
+		}
+		Entry(uint32_t inode, uint32_t name, uint32_t value, uint32_t next)
+				: inode(inode), name(name), value(value), next(next) {
+		}
+
+		uint32_t inode; /*!< 0 for empty slots. */
+		uint32_t name;
+		uint32_t value;
+		uint32_t next;  /*!< Name of the next attribute of the inode or kNone. */
+	};
+
+	XattrStorage() = default;
+	XattrStorage(const XattrStorage &) = delete;
+	XattrStorage &operator=(const XattrStorage &) = delete;
+
+	/*! \brief Returns attribute of the inode or nullptr. */
+	Entry *find(uint32_t inode, const uint8_t *name, uint8_t name_length);
+
+	/*! \brief Returns any attribute of the inode or nullptr if it has none. */
+	Entry *findAny(uint32_t inode);
+
+	/*! \brief Adds an attribute, which the inode mustn't have yet. */
+	void insert(uint32_t inode, const uint8_t *name, uint8_t name_length, const uint8_t *value,
+			uint32_t value_length);
+
+	void setValue(Entry *entry, const uint8_t *value, uint32_t value_length);
+
+	/*! \brief Removes an attribute, invalidates pointers to other entries. */
+	void erase(Entry *entry);
+
+	/*! \brief Calls f(entry) for all attributes of the inode, f mustn't modify them. */
+	template <typename Function>
+	void forEachOfInode(uint32_t inode, Function f) {
+		const InodeIndex *index = findIndex(inode);
+		for (uint32_t name = index ? index->first : kNone; name != kNone;) {
+			const Entry *entry = findEntry(inode, name);
+			assert(entry);
+			f(*entry);
+			name = entry->next;
+		}
+	}
+
+	/*! \brief Calls f(entry) for all attributes. */
+	template <typename Function>
+	void forEach(Function f) const {
+		entries_.forEach(f);
+	}
+
+	const uint8_t *name(const Entry &entry) const {
+		return names_.data(entry.name);
+	}
+
+	uint8_t nameLength(const Entry &entry) const {
+		return names_.length(entry.name);
+	}
+
+	const uint8_t *value(const Entry &entry) const {
+		return values_.data(entry.value);
+	}
+
+	uint32_t valueLength(const Entry &entry) const {
+		return values_.length(entry.value);
+	}
+
+	/*! \brief Number of attributes. */
+	std::size_t size() const {
+		return entries_.size();
+	}
+
+	const InternedStringPool &names() const {
+		return names_;
+	}
+
+	const InternedStringPool &values() const {
+		return values_;
+	}
+
+	/*! \brief Number of bytes allocated by the storage. */
+	uint64_t memoryUsage() const {
+		return entries_.memoryUsage() + inodes_.memoryUsage() + names_.memoryUsage() +
+		       values_.memoryUsage();
+	}
+
+	void clear();
+
+private:
+	static constexpr uint32_t kNone = InternedStringPool::kNone;
+
+	/* Head of the list of attributes of an inode */
+	struct InodeIndex {
+		InodeIndex() : inode(0), first(0) {
+		}
+		InodeIndex(uint32_t inode, uint32_t first) : inode(inode), first(first) {
+		}
+
+		uint32_t inode; /*!< 0 for empty slots. */
+		uint32_t first; /*!< Name of the most recently added attribute. */
+	};
+
+	struct EntryHasher {
+		uint64_t operator()(const Entry &entry) const {
+			return entryHash(entry.inode, entry.name);
+		}
+		static bool empty(const Entry &entry) {
+			return entry.inode == 0;
+		}
+	};
+
+	struct InodeIndexHasher {
+		uint64_t operator()(const InodeIndex &index) const {
+			return inodeHash(index.inode);
+		}
+		static bool empty(const InodeIndex &index) {
+			return index.inode == 0;
+		}
+	};
+
+	static uint64_t entryHash(uint32_t inode, uint32_t name) {
+		return hash64((static_cast<uint64_t>(inode) << 32) | name);
+	}
+
+	static uint64_t inodeHash(uint32_t inode) {
+		return hash64(inode);
+	}
+
+	Entry *findEntry(uint32_t inode, uint32_t name) {
+		return entries_.find(entryHash(inode, name), [inode, name](const Entry &entry) {
+			return entry.inode == inode && entry.name == name;
+		});
+	}
+
+	InodeIndex *findIndex(uint32_t inode) {
+		return inodes_.find(inodeHash(inode),
+		                    [inode](const InodeIndex &index) { return index.inode == inode; });
+	}
+
+	InternedStringPool names_;
+	InternedStringPool values_;
+	IncrementalHashTable<Entry, EntryHasher> entries_;
+	IncrementalHashTable<InodeIndex, InodeIndexHasher> inodes_;
+};
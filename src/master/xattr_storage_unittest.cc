@@ -0,0 +1,222 @@
+/*
+   Copyright 2017 Skytechnology sp. z o.o.
+
+   This file is part of LizardFS.
+
+   LizardFS is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, version 3.
+
+   LizardFS is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with LizardFS. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "common/platform.h"
+#include "master/xattr_storage.h"
+
+#include <cstring>
+#include <iostream>
+#include <map>
+#include <random>
+#include <string>
+#include <gtest/gtest.h>
+
+#include "common/time_utils.h"
+
+static const uint8_t *bytes(const std::string &str) {
+	return reinterpret_cast<const uint8_t *>(str.data());
+}
+
+static std::string value_of(XattrStorage &storage, uint32_t inode, const std::string &name) {
+	XattrStorage::Entry *entry = storage.find(inode, bytes(name), name.size());
+	if (!entry) {
+		return "<none>";
+	}
+	return std::string(reinterpret_cast<const char *>(storage.value(*entry)),
+	                   storage.valueLength(*entry));
+}
+
+static std::map<std::string, std::string> attributes_of(XattrStorage &storage, uint32_t inode) {
+	std::map<std::string, std::string> result;
+	storage.forEachOfInode(inode, [&storage, &result](const XattrStorage::Entry &entry) {
+		result[std::string((const char *)storage.name(entry), storage.nameLength(entry))] =
+		        std::string((const char *)storage.value(entry), storage.valueLength(entry));
+	});
+	return result;
+}
+
+TEST(InternedStringPoolTests, Deduplication) {
+	InternedStringPool pool;
+	std::string label = "system_u:object_r:user_home_t:s0";
+	uint32_t id = pool.acquire(bytes(label), label.size());
+	EXPECT_EQ(id, pool.acquire(bytes(label), label.size()));
+	EXPECT_EQ(2U, pool.refcount(id));
+	EXPECT_EQ(1U, pool.size());
+	EXPECT_EQ(label, std::string((const char *)pool.data(id), pool.length(id)));
+
+	uint32_t empty = pool.acquire(nullptr, 0);
+	EXPECT_NE(id, empty);
+	EXPECT_EQ(nullptr, pool.data(empty));
+	EXPECT_EQ(empty, pool.find(bytes(label), 0));
+
+	pool.release(id);
+	EXPECT_EQ(id, pool.find(bytes(label), label.size()));
+	pool.release(id);
+	EXPECT_EQ(InternedStringPool::kNone, pool.find(bytes(label), label.size()));
+
+	// space of released strings is reused
+	uint64_t memory = pool.memoryUsage();
+	for (int i = 0; i < 100000; ++i) {
+		std::string value = "value" + std::to_string(i % 1000 + 1000);
+		uint32_t value_id = pool.acquire(bytes(value), value.size());
+		if (i % 2 == 0) {
+			pool.release(value_id);
+		}
+	}
+	EXPECT_EQ(501U, pool.size());
+	EXPECT_LT(pool.memoryUsage(), memory + 2 * InternedStringPool::kChunkSize);
+}
+
+TEST(XattrStorageTests, SetGetRemove) {
+	XattrStorage storage;
+	std::string label = "unconfined_u:object_r:user_home_t:s0";
+	for (uint32_t inode = 1; inode <= 10000; ++inode) {
+		storage.insert(inode, bytes("security.selinux"), 16, bytes(label), label.size());
+		if (inode % 2 == 0) {
+			std::string tag = "tag" + std::to_string(inode % 7);
+			storage.insert(inode, bytes("user.tag"), 8, bytes(tag), tag.size());
+		}
+	}
+	EXPECT_EQ(15000U, storage.size());
+	EXPECT_EQ(2U, storage.names().size());
+	EXPECT_EQ(8U, storage.values().size());
+
+	EXPECT_EQ(label, value_of(storage, 1, "security.selinux"));
+	EXPECT_EQ("<none>", value_of(storage, 1, "user.tag"));
+	EXPECT_EQ("tag3", value_of(storage, 10, "user.tag"));
+	EXPECT_EQ("<none>", value_of(storage, 10, "user.other"));
+	EXPECT_EQ("<none>", value_of(storage, 10001, "security.selinux"));
+
+	std::map<std::string, std::string> expected{{"security.selinux", label}, {"user.tag", "tag2"}};
+	EXPECT_EQ(expected, attributes_of(storage, 100));
+
+	XattrStorage::Entry *entry = storage.find(100, bytes("user.tag"), 8);
+	ASSERT_NE(nullptr, entry);
+	storage.setValue(entry, nullptr, 0);
+	EXPECT_EQ("", value_of(storage, 100, "user.tag"));
+	storage.erase(storage.find(100, bytes("user.tag"), 8));
+	storage.erase(storage.find(100, bytes("security.selinux"), 16));
+	EXPECT_EQ(nullptr, storage.findAny(100));
+	EXPECT_TRUE(attributes_of(storage, 100).empty());
+	EXPECT_EQ(label, value_of(storage, 101, "security.selinux"));
+
+	while (XattrStorage::Entry *entry = storage.findAny(2)) {
+		storage.erase(entry);
+	}
+	EXPECT_EQ(14996U, storage.size());
+
+	storage.clear();
+	EXPECT_EQ(0U, storage.size());
+	EXPECT_EQ(0U, storage.names().size());
+	EXPECT_EQ(0U, storage.values().size());
+}
+
+TEST(XattrStorageTests, ManyAttributesPerInode) {
+	XattrStorage storage;
+	std::map<uint32_t, std::map<std::string, std::string>> expected;
+	std::mt19937 generator(42);
+	for (int i = 0; i < 100000; ++i) {
+		uint32_t inode = 1 + generator() % 50;
+		std::string name = "user.attr" + std::to_string(generator() % 300);
+		std::string value = std::to_string(generator() % 10);
+		XattrStorage::Entry *entry = storage.find(inode, bytes(name), name.size());
+		switch (generator() % 3) {
+		case 0:
+			if (entry) {
+				storage.erase(entry);
+				expected[inode].erase(name);
+			}
+			break;
+		case 1:
+			if (entry) {
+				storage.setValue(entry, bytes(value), value.size());
+			} else {
+				storage.insert(inode, bytes(name), name.size(), bytes(value), value.size());
+			}
+			expected[inode][name] = value;
+			break;
+		default:
+			ASSERT_EQ(expected[inode].count(name) ? expected[inode][name] : "<none>",
+			          value_of(storage, inode, name));
+		}
+	}
+
+	std::size_t size = 0;
+	for (const auto &inode_attributes : expected) {
+		EXPECT_EQ(inode_attributes.second, attributes_of(storage, inode_attributes.first));
+		size += inode_attributes.second.size();
+	}
+	EXPECT_EQ(size, storage.size());
+
+	for (const auto &inode_attributes : expected) {
+		while (XattrStorage::Entry *entry = storage.findAny(inode_attributes.first)) {
+			storage.erase(entry);
+		}
+		EXPECT_TRUE(attributes_of(storage, inode_attributes.first).empty());
+	}
+	EXPECT_EQ(0U, storage.size());
+	EXPECT_EQ(0U, storage.names().size());
+}
+
+/*
+ * Stores attributes of labelled files: one common name and value, plus a name
+ * from a small set with a value mostly unique to the file.
+ */
+static void benchmark(uint32_t count) {
+	XattrStorage storage;
+	std::string label = "system_u:object_r:container_file_t:s0";
+	std::mt19937 generator(count);
+	Timer timer;
+	uint32_t inodes = count / 2;
+	for (uint32_t inode = 1; inode <= inodes; ++inode) {
+		storage.insert(inode, bytes("security.selinux"), 16, bytes(label), label.size());
+		std::string name = "user.tag" + std::to_string(inode % 16);
+		std::string value = std::to_string(generator() % (inodes / 4 + 1));
+		storage.insert(inode, bytes(name), name.size(), bytes(value), value.size());
+	}
+	int64_t insert_us = timer.lap_us();
+
+	uint64_t found = 0;
+	for (uint32_t i = 0; i < inodes; ++i) {
+		uint32_t inode = 1 + generator() % inodes;
+		found += storage.find(inode, bytes("security.selinux"), 16) != nullptr;
+		std::string name = "user.tag" + std::to_string(inode % 16);
+		found += storage.find(inode, bytes(name), name.size()) != nullptr;
+	}
+	int64_t lookup_us = timer.lap_us();
+	EXPECT_EQ(2 * (uint64_t)inodes, found);
+	EXPECT_EQ(2 * (uint64_t)inodes, storage.size());
+
+	// Chained hash tables with separately allocated names and values took
+	// 2 * 8 bytes of pointers in buckets, 64 bytes of entry and 2 allocations per attribute
+	std::cout << "xattr storage " << storage.size() << " entries: insert "
+	          << insert_us * 1000 / storage.size() << " ns/entry, lookup "
+	          << lookup_us * 1000 / storage.size() << " ns/lookup, memory "
+	          << storage.memoryUsage() / storage.size() << " B/entry ("
+	          << storage.values().size() << " distinct values)\n";
+}
+
+TEST(XattrStorageTests, Benchmark) {
+	benchmark(1000000);
+}
+
+TEST(XattrStorageTests, DISABLED_BenchmarkLarge) {
+	for (uint32_t count : {10000000, 100000000}) {
+		benchmark(count);
+	}
+}
@@ -25,6 +25,7 @@
 #include <vector>
 
 #include "common/datapack.h"
+#include "common/metadata_compression.h"
 #include "protocol/MFSCommunication.h"
 
 #define STR_AUX(x) #x
@@ -493,6 +494,27 @@ int fs_loadall(const char *fname) {
 		fclose(fd);
 		return -1;
 	}
+	if (metadataIsCompressed(hdr)) {
+#ifdef LIZARDFS_HAVE_METADATA_COMPRESSION
+		printf("# compressed: %c%c%c%c%c%c%c%c\n",hdr[0],hdr[1],hdr[2],hdr[3],hdr[4],hdr[5],hdr[6],hdr[7]);
+		FILE *decompressed = metadataOpenDecompressingStream(fd);
+		if (decompressed==NULL) {
+			printf("can't decompress metadata file\n");
+			fclose(fd);
+			return -1;
+		}
+		fd = decompressed;
+		if (fread(hdr,1,8,fd)!=8) {
+			printf("can't read metadata header\n");
+			fclose(fd);
+			return -1;
+		}
+#else
+		printf("compressed metadata is not supported in this build\n");
+		fclose(fd);
+		return -1;
+#endif
+	}
 	printf("# header: %c%c%c%c%c%c%c%c (%02X%02X%02X%02X%02X%02X%02X%02X)\n",dispchar(hdr[0]),dispchar(hdr[1]),dispchar(hdr[2]),dispchar(hdr[3]),dispchar(hdr[4]),dispchar(hdr[5]),dispchar(hdr[6]),dispchar(hdr[7]),hdr[0],hdr[1],hdr[2],hdr[3],hdr[4],hdr[5],hdr[6],hdr[7]);
 	if (memcmp(hdr,MFSSIGNATURE "M 1.5",8)==0 || memcmp(hdr,MFSSIGNATURE "M 1.6",8)==0) {
 		bool loadLockIds = (hdr[7] == '6');
@@ -27,6 +27,7 @@
 #include <string.h>
 #include <sys/stat.h>
 #include <unistd.h>
+#include <algorithm>
 #include <memory>
 #include <sstream>
 #include <string>
@@ -100,21 +101,23 @@ int changelog_checkname(const char *fname) {
 void usage(const char* appname) {
 	lzfs_pretty_syslog(LOG_ERR, "invalid/missing arguments");
 	fprintf(stderr, "restore metadata:\n"
-			"\t%s [-c] [-k <checksum>] [-z] [-f] [-b] [-i] [-x [-x]] [-B n] -m <meta data file> -o "
+			"\t%s [-c] [-k <checksum>] [-z] [-Z n] [-S] [-f] [-b] [-i] [-x [-x]] [-B n] -m <meta data file> -o "
 			"<restored meta data file> [ <change log file> [ <change log file> [ .... ]]\n"
 			"dump metadata:\n"
 			"\t%s [-i] -m <meta data file>\n"
 			"autorestore:\n"
-			"\t%s [-f] [-z] [-b] [-i] [-x [-x]] [-B n] -a [-d <data path>]\n"
+			"\t%s [-f] [-z] [-S] [-b] [-i] [-x [-x]] [-B n] -a [-d <data path>]\n"
 			"print version of metadata that can be read from disk by a master server in auto recovery mode:\n"
 			"\t%s -g -d <data path>\n"
 			"print version:\n"
 			"\t%s -v\n"
 			"\n"
 			"-B n - keep n backup copies of metadata file\n"
+			"-Z n - compress the restored metadata file with level n (1-9)\n"
 			"-c   - print checksum of the metadata\n"
 			"-k   - check checksum against given checksum\n"
 			"-z   - ignore metadata checksum inconsistency while applying changelogs\n"
+			"-S   - don't read changelogs ahead in a separate thread while applying them\n"
 			"-x   - produce more verbose output\n"
 			"-xx  - even more verbose output\n"
 			"-b   - if there is any error in change logs then save the best possible metadata file\n"
@@ -195,13 +198,14 @@ int main(int argc,char **argv) {
 	std::unique_ptr<uint64_t> expectedChecksum;
 	int storedPreviousBackMetaCopies = kMaxStoredPreviousBackMetaCopies;
 	bool noLock = false;
+	bool readAhead = true;
 
 	hstorage::Storage::reset(new hstorage::MemStorage());
 
 	prepareEnvironment();
 	openlog(nullptr, LOG_PID | LOG_NDELAY, LOG_USER);
 
-	while ((ch = getopt(argc, argv, "gfck:vm:o:d:abB:xih:z#?")) != -1) {
+	while ((ch = getopt(argc, argv, "gfck:vm:o:d:abB:xih:zZ:S#?")) != -1) {
 		switch (ch) {
 			case 'g':
 				versionRecovery = true;
@@ -256,6 +260,13 @@ int main(int argc,char **argv) {
 			case 'z':
 				fs_disable_checksum_verification(true);
 				break;
+			case 'Z':
+				gMetadataCompressionLevel =
+						std::min<uint32_t>(atoi(optarg), kMaxMetadataCompressionLevel);
+				break;
+			case 'S':
+				readAhead = false;
+				break;
 			case '#':
 				noLock = true;
 				break;
@@ -448,7 +459,7 @@ int main(int argc,char **argv) {
 		merger_start(filenames, MAXIDHOLE);
 	}
 
-	uint8_t status = merger_loop();
+	uint8_t status = merger_loop(readAhead);
 
 	if (status != LIZARDFS_STATUS_OK && savebest==0) {
 		return 1;
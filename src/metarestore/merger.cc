@@ -24,17 +24,19 @@
 #include <stdlib.h>
 #include <string.h>
 #include <syslog.h>
+#include <algorithm>
 
 #include "protocol/MFSCommunication.h"
 #include "common/lizardfs_error_codes.h"
 #include "common/slogger.h"
+#include "common/time_utils.h"
 #include "master/restore.h"
 
 #define BSIZE 200000
 
 typedef struct _hentry {
 	FILE *fd;
-	char *filename;
+	const char *filename;
 	char *buff;
 	char *ptr;
 	uint64_t nextid;
@@ -44,6 +46,9 @@ static hentry *heap;
 static uint32_t heapsize;
 static uint64_t maxidhole;
 
+// Names of all merged files, entries read ahead refer to them after their files are closed
+static std::vector<std::string> gFilenames;
+
 #define PARENT(x) (((x)-1)/2)
 #define CHILD(x) (((x)*2)+1)
 
@@ -107,9 +112,6 @@ void merger_delete_entry(void) {
 	if (heap[heapsize].fd) {
 		fclose(heap[heapsize].fd);
 	}
-	if (heap[heapsize].filename) {
-		free(heap[heapsize].filename);
-	}
 	if (heap[heapsize].buff) {
 		free(heap[heapsize].buff);
 	}
@@ -118,7 +120,7 @@ void merger_delete_entry(void) {
 void merger_new_entry(const char *filename) {
 	// printf("add file: %s\n",filename);
 	if ((heap[heapsize].fd = fopen(filename,"r"))!=NULL) {
-		heap[heapsize].filename = strdup(filename);
+		heap[heapsize].filename = filename;
 		heap[heapsize].buff = (char*) malloc(BSIZE);
 		heap[heapsize].ptr = NULL;
 		heap[heapsize].nextid = 0;
@@ -138,7 +140,8 @@ int merger_start(const std::vector<std::string>& filenames, uint64_t maxhole) {
 	if (heap==NULL) {
 		return -1;
 	}
-	for (const auto& filename : filenames) {
+	gFilenames = filenames;
+	for (const auto& filename : gFilenames) {
 		merger_new_entry(filename.c_str());
 		if (heap[heapsize].nextid==0) {
 			merger_delete_entry();
@@ -151,29 +154,78 @@ int merger_start(const std::vector<std::string>& filenames, uint64_t maxhole) {
 	return 0;
 }
 
-uint8_t merger_loop(void) {
-	uint8_t status;
+// Moves to the next entry, closing the file with the current one if it has ended
+static void merger_advance(void) {
 	hentry h;
 
+	merger_nextentry(0);
+	if (heap[0].nextid==0) {
+		heapsize--;
+		h = heap[0];
+		heap[0] = heap[heapsize];
+		heap[heapsize] = h;
+		merger_delete_entry();
+	}
+	merger_heap_sort_down();
+}
+
+static void merger_delete_all(void) {
+	while (heapsize) {
+		heapsize--;
+		merger_delete_entry();
+	}
+}
+
+static uint8_t merger_restore_in_place(uint64_t &count) {
+	uint8_t status;
+
 	while (heapsize) {
 //              lzfs_pretty_syslog(LOG_DEBUG, "current id: %" PRIu64 " / %s",heap[0].nextid,heap[0].ptr);
 		if ((status=restore(heap[0].filename, heap[0].nextid, heap[0].ptr,
 				RestoreRigor::kIgnoreParseErrors)) != LIZARDFS_STATUS_OK) {
-			while (heapsize) {
-				heapsize--;
-				merger_delete_entry();
-			}
+			merger_delete_all();
 			return status;
 		}
-		merger_nextentry(0);
-		if (heap[0].nextid==0) {
-			heapsize--;
-			h = heap[0];
-			heap[0] = heap[heapsize];
-			heap[heapsize] = h;
-			merger_delete_entry();
-		}
-		merger_heap_sort_down();
+		count++;
+		merger_advance();
 	}
-	return 0;
+	return LIZARDFS_STATUS_OK;
+}
+
+/*
+ * Reads, merges and parses changelogs in a separate thread, so that the restore loop,
+ * which cannot be run concurrently with anything modifying metadata, only applies entries.
+ */
+static uint8_t merger_restore_read_ahead(uint64_t &count) {
+	uint8_t status = restore_read_ahead(
+			[](RestoreEntry &entry) {
+				if (heapsize == 0) {
+					return false;
+				}
+				restore_parse(heap[0].filename, heap[0].nextid, heap[0].ptr, entry);
+				merger_advance();
+				return true;
+			},
+			[&count](const RestoreEntry &entry) {
+				uint8_t status = restore(entry, RestoreRigor::kIgnoreParseErrors);
+				if (status == LIZARDFS_STATUS_OK) {
+					count++;
+				}
+				return status;
+			});
+	merger_delete_all();
+	return status;
+}
+
+uint8_t merger_loop(bool read_ahead) {
+	uint64_t count = 0;
+	Timer timer;
+	uint8_t status = read_ahead ? merger_restore_read_ahead(count) : merger_restore_in_place(count);
+	int64_t elapsed_us = std::max<int64_t>(timer.elapsed_us(), 1);
+	if (count > 0) {
+		lzfs_pretty_syslog(LOG_NOTICE, "applied %" PRIu64 " changelog entries in %.3f seconds "
+				"(%" PRIu64 " entries/s)", count, elapsed_us / 1e6,
+				count * UINT64_C(1000000) / elapsed_us);
+	}
+	return status;
 }
@@ -25,4 +25,10 @@
 #include <vector>
 
 int merger_start(const std::vector<std::string>& filenames, uint64_t maxhole);
-uint8_t merger_loop(void);
+
+/*! \brief Applies entries of changelogs given to merger_start in order of their versions.
+ *
+ * \param read_ahead - whether changelogs should be read and merged by a separate thread
+ *        while entries are being applied.
+ */
+uint8_t merger_loop(bool read_ahead);
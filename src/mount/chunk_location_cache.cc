@@ -0,0 +1,128 @@
+/*
+   Copyright 2017 Skytechnology sp. z o.o.
+
+   This file is part of LizardFS.
+
+   LizardFS is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, version 3.
+
+   LizardFS is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with LizardFS. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "common/platform.h"
+#include "mount/chunk_location_cache.h"
+
+#include <algorithm>
+
+#include "protocol/MFSCommunication.h"
+
+std::unique_ptr<ChunkLocationCache> gChunkLocationCache;
+
+ChunkLocationCache::ChunkLocationCache(SteadyDuration timeout, uint32_t max_size)
+		: timeout_(timeout),
+		  max_size_(std::max<uint32_t>(max_size, 1)),
+		  hits_(0),
+		  misses_(0),
+		  changes_(0) {
+}
+
+ChunkLocationCache::LocationPtr ChunkLocationCache::find(uint32_t inode, uint32_t chunk_index,
+		SteadyTimePoint now) {
+	std::unique_lock<std::mutex> lock(mutex_);
+	auto it = entries_.find(Key(inode, chunk_index));
+	if (it == entries_.end() || !it->second.valid || now >= it->second.expiration_time
+			|| it->second.location->fileLength < (uint64_t(chunk_index) + 1) * MFSCHUNKSIZE) {
+		misses_++;
+		return LocationPtr();
+	}
+	hits_++;
+	return it->second.location;
+}
+
+void ChunkLocationCache::insert(uint32_t inode, uint32_t chunk_index, LocationPtr location,
+		SteadyTimePoint now) {
+	Key key(inode, chunk_index);
+	bool changed = false;
+	ChangeCallback callback;
+	{
+		std::unique_lock<std::mutex> lock(mutex_);
+		auto it = entries_.find(key);
+		if (it != entries_.end()) {
+			changed = !sameChunk(*it->second.location, *location);
+			erase(it);
+		}
+		// Another client may write into a hole at any time, without notifying this one
+		if (!location->isEmptyChunk()) {
+			while (entries_.size() >= max_size_) {
+				erase(entries_.find(insertion_order_.front()));
+			}
+			insertion_order_.push_back(key);
+			entries_[key] = Entry{std::move(location), now + timeout_, true,
+					std::prev(insertion_order_.end())};
+		}
+		if (changed) {
+			changes_++;
+			callback = change_callback_;
+		}
+	}
+	// The callback may take some time (e.g. recall layouts), so it is called without the lock
+	if (callback) {
+		callback(inode, chunk_index);
+	}
+}
+
+void ChunkLocationCache::invalidate(uint32_t inode, uint32_t chunk_index) {
+	std::unique_lock<std::mutex> lock(mutex_);
+	auto it = entries_.find(Key(inode, chunk_index));
+	if (it != entries_.end()) {
+		it->second.valid = false;
+	}
+}
+
+void ChunkLocationCache::invalidateInode(uint32_t inode) {
+	std::unique_lock<std::mutex> lock(mutex_);
+	auto it = entries_.lower_bound(Key(inode, 0));
+	while (it != entries_.end() && it->first.first == inode) {
+		erase(it++);
+	}
+}
+
+void ChunkLocationCache::setChangeCallback(ChangeCallback callback) {
+	std::unique_lock<std::mutex> lock(mutex_);
+	change_callback_ = std::move(callback);
+}
+
+ChunkLocationCache::Stats ChunkLocationCache::stats() const {
+	Stats result;
+	result.hits = hits_;
+	result.misses = misses_;
+	result.changes = changes_;
+	std::unique_lock<std::mutex> lock(mutex_);
+	result.entries = entries_.size();
+	return result;
+}
+
+bool ChunkLocationCache::sameChunk(const ChunkLocationInfo &a, const ChunkLocationInfo &b) {
+	if (a.chunkId != b.chunkId || a.version != b.version
+			|| a.locations.size() != b.locations.size()) {
+		return false;
+	}
+	// The master may send locations in a different order each time
+	ChunkLocationInfo::ChunkLocations a_locations = a.locations;
+	ChunkLocationInfo::ChunkLocations b_locations = b.locations;
+	std::sort(a_locations.begin(), a_locations.end());
+	std::sort(b_locations.begin(), b_locations.end());
+	return a_locations == b_locations;
+}
+
+void ChunkLocationCache::erase(EntryMap::iterator it) {
+	insertion_order_.erase(it->second.insertion_position);
+	entries_.erase(it);
+}
@@ -0,0 +1,133 @@
+/*
+   Copyright 2017 Skytechnology sp. z o.o.
+
+   This file is part of LizardFS.
+
+   LizardFS is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, version 3.
+
+   LizardFS is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with LizardFS. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "common/platform.h"
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <utility>
+
+#include "common/time_utils.h"
+#include "mount/chunk_locator.h"
+
+/*!
+ * \brief Locations of chunks shared by all readers in the mount process.
+ *
+ * Readers normally ask the master for the location of every chunk they start reading.
+ * With this cache a location received from the master is reused by all readers of
+ * the chunk until it expires or is invalidated (after a read error or a periodic refresh).
+ *
+ * Locations of the last chunk of a file are never returned, because the cached length
+ * of the file could be outdated. Holes (chunkId 0) are never cached, as another client
+ * may write into them at any time. Other chunks usually get new versions when they are
+ * modified or truncated, so reading them with an outdated location fails and makes
+ * the reader invalidate it. That doesn't hold for a chunk shared with a snapshot:
+ * modification of such a chunk by another client copies it to a chunk with a new id
+ * and the old one stays readable, so readers may get data from before the modification
+ * until the location expires. The timeout is thus the upper bound on staleness of data
+ * read from files modified by other clients after a snapshot was taken.
+ *
+ * Invalidated and expired entries are kept until they are replaced, so that a new
+ * location received from the master can be compared with the old one. When the chunk
+ * got a new id or version or its parts moved to other chunkservers, the change callback
+ * is called, which lets users caching layouts of files (pNFS) recall them.
+ *
+ * All entries live for the same time, so the oldest inserted entry is evicted when
+ * the cache is full.
+ */
+class ChunkLocationCache {
+public:
+	typedef std::shared_ptr<const ChunkLocationInfo> LocationPtr;
+	typedef std::function<void(uint32_t inode, uint32_t chunk_index)> ChangeCallback;
+
+	struct Stats {
+		uint64_t hits;
+		uint64_t misses;
+		uint64_t changes;
+		uint64_t entries;
+	};
+
+	/*!
+	 * \param timeout Time for which a location is valid.
+	 * \param max_size Maximal number of cached locations.
+	 */
+	ChunkLocationCache(SteadyDuration timeout, uint32_t max_size);
+
+	/*! \brief Returns a valid location of the chunk or nullptr if there is none. */
+	LocationPtr find(uint32_t inode, uint32_t chunk_index,
+			SteadyTimePoint now = SteadyClock::now());
+
+	/*!
+	 * \brief Stores a location received from the master.
+	 *
+	 * Calls the change callback if the previous location of the chunk was different.
+	 * Location of a hole only removes the previous location.
+	 */
+	void insert(uint32_t inode, uint32_t chunk_index, LocationPtr location,
+			SteadyTimePoint now = SteadyClock::now());
+
+	/*! \brief Makes the location of the chunk invalid, it will be fetched again. */
+	void invalidate(uint32_t inode, uint32_t chunk_index);
+
+	/*!
+	 * \brief Removes locations of all chunks of the inode.
+	 *
+	 * Used when this client modified the file, so changes of its chunks aren't reported.
+	 */
+	void invalidateInode(uint32_t inode);
+
+	void setChangeCallback(ChangeCallback callback);
+
+	Stats stats() const;
+
+private:
+	typedef std::pair<uint32_t, uint32_t> Key;
+	typedef std::list<Key> InsertionList;
+
+	struct Entry {
+		LocationPtr location;
+		SteadyTimePoint expiration_time;
+		bool valid;
+		InsertionList::iterator insertion_position;
+	};
+	typedef std::map<Key, Entry> EntryMap;
+
+	static bool sameChunk(const ChunkLocationInfo &a, const ChunkLocationInfo &b);
+
+	void erase(EntryMap::iterator it);
+
+	SteadyDuration timeout_;
+	uint32_t max_size_;
+	mutable std::mutex mutex_;
+	EntryMap entries_;
+	InsertionList insertion_order_; // the oldest entry first
+	ChangeCallback change_callback_;
+	std::atomic<uint64_t> hits_;
+	std::atomic<uint64_t> misses_;
+	std::atomic<uint64_t> changes_;
+};
+
+/*! \brief Cache used by readers, nullptr when caching of locations is disabled. */
+extern std::unique_ptr<ChunkLocationCache> gChunkLocationCache;
@@ -0,0 +1,155 @@
+/*
+   Copyright 2017 Skytechnology sp. z o.o.
+
+   This file is part of LizardFS.
+
+   LizardFS is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, version 3.
+
+   LizardFS is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with LizardFS. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "common/platform.h"
+#include "mount/chunk_location_cache.h"
+
+#include <gtest/gtest.h>
+
+#include "common/slice_traits.h"
+#include "protocol/MFSCommunication.h"
+
+typedef ChunkLocationCache::LocationPtr LocationPtr;
+
+static const uint64_t kFileLength = 10ULL * MFSCHUNKSIZE;
+
+static LocationPtr location(uint64_t chunk_id, uint32_t version, std::vector<uint32_t> ips,
+		uint64_t file_length = kFileLength) {
+	ChunkLocationInfo::ChunkLocations locations;
+	for (uint32_t ip : ips) {
+		locations.push_back(ChunkTypeWithAddress(NetworkAddress(ip, 9422),
+				slice_traits::standard::ChunkPartType(), LIZARDFS_VERSHEX));
+	}
+	return std::make_shared<ChunkLocationInfo>(chunk_id, version, file_length, locations);
+}
+
+TEST(ChunkLocationCache, FindAndInsert) {
+	ChunkLocationCache cache(std::chrono::seconds(10), 100);
+	SteadyTimePoint now = SteadyClock::now();
+
+	EXPECT_EQ(nullptr, cache.find(1, 0, now));
+	LocationPtr a = location(10, 1, {1, 2});
+	LocationPtr b = location(11, 1, {2, 3});
+	cache.insert(1, 0, a, now);
+	cache.insert(1, 1, b, now);
+
+	EXPECT_EQ(a, cache.find(1, 0, now));
+	EXPECT_EQ(b, cache.find(1, 1, now + std::chrono::seconds(9)));
+	EXPECT_EQ(nullptr, cache.find(2, 0, now));
+	EXPECT_EQ(nullptr, cache.find(1, 0, now + std::chrono::seconds(10)));
+
+	cache.invalidate(1, 0);
+	EXPECT_EQ(nullptr, cache.find(1, 0, now));
+	EXPECT_EQ(b, cache.find(1, 1, now));
+
+	auto stats = cache.stats();
+	EXPECT_EQ(3U, stats.hits);
+	EXPECT_EQ(4U, stats.misses);
+	EXPECT_EQ(0U, stats.changes);
+	EXPECT_EQ(2U, stats.entries);
+}
+
+TEST(ChunkLocationCache, LastChunkIsNotReturned) {
+	ChunkLocationCache cache(std::chrono::seconds(10), 100);
+
+	cache.insert(1, 0, location(10, 1, {1}, MFSCHUNKSIZE + 1));
+	cache.insert(1, 1, location(11, 1, {1}, MFSCHUNKSIZE + 1));
+	cache.insert(2, 0, location(20, 1, {1}, MFSCHUNKSIZE));
+	EXPECT_NE(nullptr, cache.find(1, 0));
+	EXPECT_EQ(nullptr, cache.find(1, 1));
+	EXPECT_NE(nullptr, cache.find(2, 0));
+}
+
+TEST(ChunkLocationCache, ChangesAreReported) {
+	ChunkLocationCache cache(std::chrono::seconds(10), 100);
+	std::vector<std::pair<uint32_t, uint32_t>> changes;
+	cache.setChangeCallback([&changes](uint32_t inode, uint32_t chunk_index) {
+		changes.emplace_back(inode, chunk_index);
+	});
+
+	cache.insert(1, 0, location(10, 1, {1, 2}));
+	cache.insert(1, 1, location(11, 1, {1, 2}));
+	EXPECT_TRUE(changes.empty());
+
+	// The same chunk with locations in another order
+	cache.invalidate(1, 0);
+	cache.insert(1, 0, location(10, 1, {2, 1}, 2 * kFileLength));
+	EXPECT_TRUE(changes.empty());
+
+	cache.insert(1, 0, location(10, 2, {1, 2}));
+	cache.insert(1, 1, location(11, 1, {1, 3}));
+	cache.insert(1, 1, location(11, 1, {1}));
+	cache.insert(1, 1, location(12, 1, {1}));
+	std::vector<std::pair<uint32_t, uint32_t>> expected = {{1, 0}, {1, 1}, {1, 1}, {1, 1}};
+	EXPECT_EQ(expected, changes);
+	EXPECT_EQ(4U, cache.stats().changes);
+
+	// Files modified by this client are forgotten
+	changes.clear();
+	cache.invalidateInode(1);
+	EXPECT_EQ(0U, cache.stats().entries);
+	cache.insert(1, 0, location(10, 3, {1, 2}));
+	EXPECT_TRUE(changes.empty());
+}
+
+TEST(ChunkLocationCache, OldestEntriesAreEvicted) {
+	ChunkLocationCache cache(std::chrono::seconds(10), 3);
+
+	cache.insert(1, 0, location(10, 1, {1}));
+	cache.insert(1, 1, location(11, 1, {1}));
+	cache.insert(2, 0, location(20, 1, {1}));
+	cache.insert(1, 0, location(10, 1, {1}));
+	cache.insert(3, 0, location(30, 1, {1}));
+
+	EXPECT_EQ(3U, cache.stats().entries);
+	EXPECT_EQ(nullptr, cache.find(1, 1));
+	EXPECT_NE(nullptr, cache.find(1, 0));
+	EXPECT_NE(nullptr, cache.find(2, 0));
+	EXPECT_NE(nullptr, cache.find(3, 0));
+
+	cache.invalidateInode(2);
+	EXPECT_EQ(2U, cache.stats().entries);
+	EXPECT_NE(nullptr, cache.find(1, 0));
+	EXPECT_NE(nullptr, cache.find(3, 0));
+}
+
+TEST(ChunkLocationCache, HolesAreNotCached) {
+	ChunkLocationCache cache(std::chrono::seconds(10), 100);
+	std::vector<std::pair<uint32_t, uint32_t>> changes;
+	cache.setChangeCallback([&changes](uint32_t inode, uint32_t chunk_index) {
+		changes.emplace_back(inode, chunk_index);
+	});
+
+	cache.insert(1, 0, location(0, 0, {}));
+	EXPECT_EQ(nullptr, cache.find(1, 0));
+	EXPECT_EQ(0U, cache.stats().entries);
+
+	// Another client wrote into the hole
+	LocationPtr written = location(10, 1, {1, 2});
+	cache.insert(1, 0, written);
+	EXPECT_EQ(written, cache.find(1, 0));
+	EXPECT_TRUE(changes.empty());
+
+	// The chunk was removed (e.g. by truncate and extend done by another client)
+	cache.invalidate(1, 0);
+	cache.insert(1, 0, location(0, 0, {}));
+	EXPECT_EQ(nullptr, cache.find(1, 0));
+	EXPECT_EQ(0U, cache.stats().entries);
+	std::vector<std::pair<uint32_t, uint32_t>> expected = {{1, 0}};
+	EXPECT_EQ(expected, changes);
+}
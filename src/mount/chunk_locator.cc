@@ -25,6 +25,7 @@
 #include "common/exceptions.h"
 #include "common/mfserr.h"
 #include "devtools/request_log.h"
+#include "mount/chunk_location_cache.h"
 #include "mount/mastercomm.h"
 
 void ReadChunkLocator::invalidateCache(uint32_t inode, uint32_t index) {
@@ -34,6 +35,12 @@ void ReadChunkLocator::invalidateCache(uint32_t inode, uint32_t index) {
 	}
 }
 
+void ReadChunkLocator::invalidateSharedCache(uint32_t inode, uint32_t index) {
+	if (gChunkLocationCache) {
+		gChunkLocationCache->invalidate(inode, index);
+	}
+}
+
 std::shared_ptr<const ChunkLocationInfo> ReadChunkLocator::locateChunk(uint32_t inode, uint32_t index) {
 	{
 		std::unique_lock<std::mutex> lock(mutex_);
@@ -41,6 +48,16 @@ std::shared_ptr<const ChunkLocationInfo> ReadChunkLocator::locateChunk(uint32_t
 			return cache_;
 		}
 	}
+	if (gChunkLocationCache) {
+		auto location = gChunkLocationCache->find(inode, index);
+		if (location) {
+			std::unique_lock<std::mutex> lock(mutex_);
+			inode_ = inode;
+			index_ = index;
+			cache_ = std::move(location);
+			return cache_;
+		}
+	}
 	LOG_AVG_TILL_END_OF_SCOPE0("ReadChunkLocator::locateChunk");
 	uint64_t chunkId;
 	uint32_t version;
@@ -78,11 +95,16 @@ std::shared_ptr<const ChunkLocationInfo> ReadChunkLocator::locateChunk(uint32_t
 		}
 	}
 #endif
+	auto location = std::make_shared<const ChunkLocationInfo>(chunkId, version, fileLength,
+			locations);
+	if (gChunkLocationCache) {
+		gChunkLocationCache->insert(inode, index, location);
+	}
 	{
 		std::unique_lock<std::mutex> lock(mutex_);
 		inode_ = inode;
 		index_ = index;
-		cache_ = std::make_shared<ChunkLocationInfo>(chunkId, version, fileLength, locations);
+		cache_ = std::move(location);
 		return cache_;
 	}
 }
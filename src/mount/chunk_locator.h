@@ -59,7 +59,7 @@ struct ChunkLocationInfo {
 };
 
 // Intended to be instantiated per descriptor.
-// May cache locations of previously queried chunks.
+// May cache locations of previously queried chunks, also in gChunkLocationCache.
 // Thread safe.
 class ReadChunkLocator {
 public:
@@ -68,6 +68,8 @@ public:
 
 	std::shared_ptr<const ChunkLocationInfo> locateChunk(uint32_t inode, uint32_t index);
 	void invalidateCache(uint32_t inode, uint32_t index);
+	// Makes other readers ask the master for the location of the chunk too
+	void invalidateSharedCache(uint32_t inode, uint32_t index);
 
 private:
 	uint32_t inode_;
@@ -27,6 +27,10 @@
 #include "common/time_utils.h"
 #include "mount/global_chunkserver_stats.h"
 
+// Locations are sorted by the master by their distance from us (see mfstopology.cfg), so a more
+// distant location is chosen only if it's clearly better than the closer one
+static const float kDistantLocationScoreRatio = 1.25;
+
 ChunkReader::ChunkReader(ChunkConnector& connector, double bandwidth_overuse)
 		: connector_(connector),
 		  inode_(0),
@@ -47,14 +51,19 @@ void ChunkReader::prepareReadingChunk(uint32_t inode, uint32_t index, bool force
 	inode_ = inode;
 	index_ = index;
 	locator_.invalidateCache(inode, index);
+	if (force_prepare) {
+		locator_.invalidateSharedCache(inode, index);
+	}
 	location_ = locator_.locateChunk(inode, index);
 	chunkAlreadyRead = false;
 	if (location_->isEmptyChunk()) {
 		return;
 	}
 	chunk_type_locations_.clear();
+	alternative_locations_.clear();
 
 	ChunkReadPlanner::ScoreContainer best_scores;
+	ChunkReadPlanner::ScoreContainer alternative_scores;
 
 	available_parts_.clear();
 	for (const ChunkTypeWithAddress& chunk_type_with_address : location_->locations) {
@@ -64,7 +73,7 @@ void ChunkReader::prepareReadingChunk(uint32_t inode, uint32_t index, bool force
 			continue;
 		}
 
-		float score = globalChunkserverStats.getStatisticsFor(chunk_type_with_address.address).score();
+		float score = globalChunkserverStats.getStatisticsFor(chunk_type_with_address.address).readScore();
 		if (chunk_type_locations_.count(type) == 0) {
 			// first location of this type, choose it (for now)
 			chunk_type_locations_[type] = chunk_type_with_address;
@@ -72,10 +81,16 @@ void ChunkReader::prepareReadingChunk(uint32_t inode, uint32_t index, bool force
 			available_parts_.push_back(type);
 		} else {
 			// we already know other locations
-			if (score > best_scores[type]) {
+			if (score > best_scores[type] * kDistantLocationScoreRatio) {
 				// this location is better, switch to it
+				alternative_locations_[type] = chunk_type_locations_[type];
+				alternative_scores[type] = best_scores[type];
 				chunk_type_locations_[type] = chunk_type_with_address;
 				best_scores[type] = score;
+			} else if (alternative_locations_.count(type) == 0
+					|| score > alternative_scores[type] * kDistantLocationScoreRatio) {
+				alternative_locations_[type] = chunk_type_with_address;
+				alternative_scores[type] = score;
 			}
 		}
 	}
@@ -84,7 +99,7 @@ void ChunkReader::prepareReadingChunk(uint32_t inode, uint32_t index, bool force
 
 uint32_t ChunkReader::readData(std::vector<uint8_t>& buffer, uint32_t offset, uint32_t size,
 		uint32_t connectTimeout_ms, uint32_t wave_timeout_ms, const Timeout& communicationTimeout,
-		bool prefetchXorStripes) {
+		bool prefetchXorStripes, double hedgePercentile) {
 	if (size == 0) {
 		return 0;
 	}
@@ -125,6 +140,9 @@ uint32_t ChunkReader::readData(std::vector<uint8_t>& buffer, uint32_t offset, ui
 		}
 		ReadPlanExecutor executor(globalChunkserverStats, location_->chunkId, location_->version,
 				std::move(plan));
+		if (hedgePercentile > 0) {
+			executor.enableHedging(hedgePercentile, alternative_locations_);
+		}
 		uint32_t initialBufferSize = buffer.size();
 		try {
 			chunkAlreadyRead = true;
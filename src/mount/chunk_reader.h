@@ -49,11 +49,14 @@ public:
 	void prepareReadingChunk(uint32_t inode, uint32_t index, bool forcePrepare);
 
 	/**
-	 * Reads data from the previously located chunk and appends it to the buffer
+	 * Reads data from the previously located chunk and appends it to the buffer.
+	 * Reads taking longer than hedgePercentile of previous reads from their chunkservers
+	 * are hedged (0 disables hedging, see ReadPlanExecutor::enableHedging).
 	 */
 	uint32_t readData(std::vector<uint8_t>& buffer, uint32_t offset, uint32_t size,
 			uint32_t connectTimeout_ms, uint32_t wave_timeout_ms,
-			const Timeout& communicationTimeout, bool prefetchXorStripes);
+			const Timeout& communicationTimeout, bool prefetchXorStripes,
+			double hedgePercentile = 0);
 
 	bool isChunkLocated() const {
 		return (bool)location_;
@@ -70,6 +73,12 @@ public:
 	uint32_t version() const {
 		return location_->version;
 	}
+	uint64_t fileLength() const {
+		return location_->fileLength;
+	}
+	bool isEmptyChunk() const {
+		return location_->isEmptyChunk();
+	}
 
 	/// Counter for the .lizardfds_tweaks file.
 	static std::atomic<uint64_t> preparations;
@@ -83,6 +92,8 @@ private:
 	ChunkReadPlanner planner_;
 	ReadPlan::PartsContainer available_parts_;
 	ReadPlanExecutor::ChunkTypeLocations chunk_type_locations_;
+	// the second best location of each part type, used for hedged reads
+	ReadPlanExecutor::ChunkTypeLocations alternative_locations_;
 	std::vector<ChunkTypeWithAddress> crcErrors_;
 	bool chunkAlreadyRead;
 };
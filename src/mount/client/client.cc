@@ -140,6 +140,8 @@ void Client::init(FsInitParams &params) {
 		LIZARDFS_LINK_FUNCTION(lizardfs_removexattr);
 		LIZARDFS_LINK_FUNCTION(lizardfs_getchunksinfo);
 		LIZARDFS_LINK_FUNCTION(lizardfs_getchunkservers);
+		LIZARDFS_LINK_FUNCTION(lizardfs_getstats);
+		LIZARDFS_LINK_FUNCTION(lizardfs_set_chunk_location_change_callback);
 		LIZARDFS_LINK_FUNCTION(lizardfs_getlk);
 		LIZARDFS_LINK_FUNCTION(lizardfs_setlk_send);
 		LIZARDFS_LINK_FUNCTION(lizardfs_setlk_recv);
@@ -761,6 +763,26 @@ std::vector<ChunkserverListEntry> Client::getchunkservers(std::error_code &ec) {
 	return ret.second;
 }
 
+std::string Client::getstats() {
+	std::error_code ec;
+	auto ret = getstats(ec);
+	if (ec) {
+		throw std::system_error(ec);
+	}
+	return ret;
+}
+
+std::string Client::getstats(std::error_code &ec) {
+	std::string stats;
+	int ret = lizardfs_getstats_(stats);
+	ec = make_error_code(ret);
+	return stats;
+}
+
+void Client::setChunkLocationChangeCallback(std::function<void(Inode, uint32_t)> callback) {
+	lizardfs_set_chunk_location_change_callback_(std::move(callback));
+}
+
 void Client::getlk(const Context &ctx, Inode ino, FileInfo *fileinfo, FlockWrapper &lock) {
 	std::error_code ec;
 	getlk(ctx, ino, fileinfo, lock, ec);
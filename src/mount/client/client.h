@@ -234,6 +234,13 @@ public:
 	std::vector<ChunkserverListEntry> getchunkservers();
 	std::vector<ChunkserverListEntry> getchunkservers(std::error_code &ec);
 
+	// Returns statistics of the client in the same format as the .stats file of a mount
+	std::string getstats();
+	std::string getstats(std::error_code &ec);
+
+	// Sets function called when a cached location of a chunk turns out to be outdated
+	void setChunkLocationChangeCallback(std::function<void(Inode, uint32_t)> callback);
+
 	void getlk(const Context &ctx, Inode ino, FileInfo *fileinfo, FlockWrapper &lock);
 	void getlk(const Context &ctx, Inode ino, FileInfo *fileinfo, FlockWrapper &lock,
 	           std::error_code &ec);
@@ -289,6 +296,9 @@ protected:
 	typedef decltype(&lizardfs_removexattr) RemoveXattrFunction;
 	typedef decltype(&lizardfs_getchunksinfo) GetChunksInfoFunction;
 	typedef decltype(&lizardfs_getchunkservers) GetChunkserversFunction;
+	typedef decltype(&lizardfs_getstats) GetStatsFunction;
+	typedef decltype(&lizardfs_set_chunk_location_change_callback)
+		SetChunkLocationChangeCallbackFunction;
 	typedef decltype(&lizardfs_getlk) GetlkFunction;
 	typedef decltype(&lizardfs_setlk_send) SetlkSendFunction;
 	typedef decltype(&lizardfs_setlk_recv) SetlkRecvFunction;
@@ -332,6 +342,8 @@ protected:
 	RemoveXattrFunction lizardfs_removexattr_;
 	GetChunksInfoFunction lizardfs_getchunksinfo_;
 	GetChunkserversFunction lizardfs_getchunkservers_;
+	GetStatsFunction lizardfs_getstats_;
+	SetChunkLocationChangeCallbackFunction lizardfs_set_chunk_location_change_callback_;
 	GetlkFunction lizardfs_getlk_;
 	SetlkSendFunction lizardfs_setlk_send_;
 	SetlkRecvFunction lizardfs_setlk_recv_;
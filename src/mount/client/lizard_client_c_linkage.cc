@@ -20,6 +20,11 @@
 
 #include "client/lizard_client_c_linkage.h"
 
+#include <stdlib.h>
+
+#include "mount/readdata.h"
+#include "mount/stats.h"
+
 typedef LizardClient::EntryParam EntryParam;
 typedef LizardClient::Inode Inode;
 typedef LizardClient::Context Context;
@@ -424,6 +429,27 @@ std::pair<int, std::vector<ChunkserverListEntry>> lizardfs_getchunkservers() {
 	}
 }
 
+int lizardfs_getstats(std::string &stats) {
+	try {
+		char *buff;
+		uint32_t leng;
+		stats_show_all(&buff, &leng);
+		if (buff == nullptr) {
+			return LIZARDFS_ERROR_OUTOFMEMORY;
+		}
+		stats.assign(buff, leng);
+		free(buff);
+		return LIZARDFS_STATUS_OK;
+	} catch (...) {
+		return LIZARDFS_ERROR_IO;
+	}
+}
+
+
+void lizardfs_set_chunk_location_change_callback(
+	std::function<void(LizardClient::Inode, uint32_t)> callback) {
+	read_data_set_chunk_location_change_callback(std::move(callback));
+}
 
 int lizardfs_getlk(const Context &ctx, Inode ino,
 	           LizardClient::FileInfo *fi, lzfs_locks::FlockWrapper &lock) {
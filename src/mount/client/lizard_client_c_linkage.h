@@ -20,6 +20,7 @@
 
 #include "common/platform.h"
 
+#include <functional>
 #include <utility>
 #include "mount/lizard_client.h"
 #include "protocol/lock_info.h"
@@ -101,6 +102,9 @@ int lizardfs_removexattr(LizardClient::Context ctx, LizardClient::Inode ino, con
 std::pair<int,std::vector<ChunkWithAddressAndLabel>> lizardfs_getchunksinfo(const LizardClient::Context &ctx,
 	             LizardClient::Inode ino, uint32_t chunk_index, uint32_t chunk_count);
 std::pair<int,std::vector<ChunkserverListEntry>> lizardfs_getchunkservers();
+int lizardfs_getstats(std::string &stats);
+void lizardfs_set_chunk_location_change_callback(
+	std::function<void(LizardClient::Inode, uint32_t)> callback);
 
 int lizardfs_getlk(const LizardClient::Context &ctx, LizardClient::Inode ino, LizardClient::FileInfo *fi,
 	  lzfs_locks::FlockWrapper &lock);
@@ -55,10 +55,15 @@ void liz_set_default_init_params(struct liz_init_params *params,
 	params->readahead_max_window_size_kB = LizardClient::FsInitParams::kDefaultReadaheadMaxWindowSize;
 	params->prefetch_xor_stripes = LizardClient::FsInitParams::kDefaultPrefetchXorStripes;
 	params->bandwidth_overuse = LizardClient::FsInitParams::kDefaultBandwidthOveruse;
+	params->shared_cache_size = LizardClient::FsInitParams::kDefaultSharedCacheSize;
+	params->hedge_read_percentile = LizardClient::FsInitParams::kDefaultHedgeReadPercentile;
+	params->chunk_location_cache_timeout_ms =
+	        LizardClient::FsInitParams::kDefaultChunkLocationCacheTimeout;
 
 	params->write_cache_size = LizardClient::FsInitParams::kDefaultWriteCacheSize;
 	params->write_workers = LizardClient::FsInitParams::kDefaultWriteWorkers;
 	params->write_window_size = LizardClient::FsInitParams::kDefaultWriteWindowSize;
+	params->write_lease_time_s = LizardClient::FsInitParams::kDefaultWriteLeaseTime;
 	params->chunkserver_write_timeout_ms = LizardClient::FsInitParams::kDefaultChunkserverWriteTo;
 	params->cache_per_inode_percentage = LizardClient::FsInitParams::kDefaultCachePerInodePercentage;
 	params->symlink_cache_timeout_s = LizardClient::FsInitParams::kDefaultSymlinkCacheTimeout;
@@ -227,9 +232,13 @@ liz_t *liz_init_with_params(struct liz_init_params *params) {
 		COPY_PARAM(readahead_max_window_size_kB);
 		COPY_PARAM(prefetch_xor_stripes);
 		COPY_PARAM(bandwidth_overuse);
+		COPY_PARAM(shared_cache_size);
+		COPY_PARAM(hedge_read_percentile);
+		COPY_PARAM(chunk_location_cache_timeout_ms);
 		COPY_PARAM(write_cache_size);
 		COPY_PARAM(write_workers);
 		COPY_PARAM(write_window_size);
+		COPY_PARAM(write_lease_time_s);
 		COPY_PARAM(chunkserver_write_timeout_ms);
 		COPY_PARAM(cache_per_inode_percentage);
 		COPY_PARAM(symlink_cache_timeout_s);
@@ -997,6 +1006,25 @@ void liz_destroy_chunkservers_info(liz_chunkserver_info_t *servers) {
 	}
 }
 
+int liz_get_stats(liz_t *instance, char *buf, size_t size, size_t *reply_size) {
+	Client &client = *(Client *)instance;
+	std::error_code ec;
+	assert(buf || size == 0);
+	assert(reply_size);
+	std::string stats = client.getstats(ec);
+	gLastErrorCode = ec.value();
+	if (ec) {
+		return -1;
+	}
+	*reply_size = stats.size();
+	if (size < stats.size()) {
+		gLastErrorCode = LIZARDFS_ERROR_WRONGSIZE;
+		return -1;
+	}
+	stats.copy(buf, size);
+	return 0;
+}
+
 void liz_destroy_chunks_info(liz_chunk_info_t *buffer) {
 	if (buffer && buffer->parts) {
 		std::free(buffer->parts);
@@ -1072,3 +1100,16 @@ int liz_setlk_interrupt(liz_t *instance, const liz_lock_interrupt_info_t *interr
 	}
 	return 0;
 }
+
+void liz_set_chunk_location_change_callback(liz_t *instance,
+	                                    liz_chunk_location_change_callback_t callback,
+	                                    void *priv) {
+	Client &client = *(Client *)instance;
+	std::function<void(Client::Inode, uint32_t)> function;
+	if (callback) {
+		function = [callback, priv](Client::Inode inode, uint32_t chunk_index) {
+			callback(inode, chunk_index, priv);
+		};
+	}
+	client.setChunkLocationChangeCallback(function);
+}
@@ -57,10 +57,14 @@ typedef struct liz_init_params {
 	unsigned readahead_max_window_size_kB;
 	bool prefetch_xor_stripes;
 	double bandwidth_overuse;
+	unsigned shared_cache_size;
+	unsigned hedge_read_percentile;
+	unsigned chunk_location_cache_timeout_ms;
 
 	unsigned write_cache_size;
 	unsigned write_workers;
 	unsigned write_window_size;
+	unsigned write_lease_time_s;
 	unsigned chunkserver_write_timeout_ms;
 	unsigned cache_per_inode_percentage;
 	unsigned symlink_cache_timeout_s;
@@ -274,6 +278,15 @@ typedef struct liz_lock_interrupt_info {
  */
 typedef int (*liz_lock_register_interrupt_t)(struct liz_lock_interrupt_info *info, void *priv);
 
+/*!
+ * \brief Function called when a cached location of a chunk turns out to be outdated.
+ * \param inode inode of the file
+ * \param chunk_index index of the chunk in the file
+ * \param priv private data passed to liz_set_chunk_location_change_callback
+ */
+typedef void (*liz_chunk_location_change_callback_t)(liz_inode_t inode, uint32_t chunk_index,
+	                                             void *priv);
+
 /*!
  * \brief Create a context for LizardFS operations
  *  Flavor 1: create default context with current uid/gid/pid
@@ -819,6 +832,15 @@ int liz_get_chunkservers_info(liz_t *instance, liz_chunkserver_info_t *servers,
  */
 void liz_destroy_chunkservers_info(liz_chunkserver_info_t *buffer);
 
+/*! \brief Get statistics of the client (operation counters and latency histograms)
+ * \param instance instance returned from liz_init
+ * \param buf buffer to be filled with statistics, in the same format as .stats file of a mount
+ * \param size buffer size
+ * \param reply_size size needed to store statistics
+ * \return 0 on success, -1 if failed, sets last error code (check with liz_last_err())
+ */
+int liz_get_stats(liz_t *instance, char *buf, size_t size, size_t *reply_size);
+
 /*! \brief Put a lock on a file (semantics based on POSIX setlk)
  * \param instance instance returned from liz_init
  * \param ctx context returned from liz_create_context
@@ -848,6 +870,20 @@ int liz_getlk(liz_t *instance, liz_context_t *ctx, liz_fileinfo_t *fileinfo, liz
  * \return 0 on success, -1 if failed, sets last error code (check with liz_last_err())
  */
 int liz_setlk_interrupt(liz_t *instance, const liz_lock_interrupt_info_t *interrupt_info);
+
+/*! \brief Set function called when the master reports that a chunk, whose location was
+ *         cached, got a new id or version or its parts moved to other chunkservers
+ * \param instance instance returned from liz_init
+ * \param callback function to be called, NULL removes previously set function
+ * \param priv private user data passed to callback
+ * \note The function is called only if instance was created with nonzero
+ *       chunk_location_cache_timeout_ms. It is called by a thread reading the file,
+ *       so it shouldn't call LizardFS functions nor wait for other threads.
+ *       Changes caused by writes and truncates done with this instance aren't reported.
+ */
+void liz_set_chunk_location_change_callback(liz_t *instance,
+	                                    liz_chunk_location_change_callback_t callback,
+	                                    void *priv);
 #ifdef __cplusplus
 } // extern "C"
 #endif
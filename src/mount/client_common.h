@@ -21,6 +21,7 @@
 #include "common/platform.h"
 
 #include "common/attributes.h"
+#include "common/time_utils.h"
 #include "mount/lizard_client.h"
 
 enum {
@@ -109,6 +110,35 @@ private:
 namespace LizardClient {
 void stats_inc(uint8_t id);
 
+/**
+ * Counts an operation (as stats_inc does) and adds its duration, measured until the object is
+ * destroyed, to the latency histogram of the operation. The operation can be set after
+ * construction if it's not known at the beginning.
+ */
+class OperationStats {
+public:
+	OperationStats() : id_(STATNODES), start_(SteadyClock::now()) {
+	}
+
+	explicit OperationStats(uint8_t id) : OperationStats() {
+		setOperation(id);
+	}
+
+	OperationStats(const OperationStats &) = delete;
+	OperationStats &operator=(const OperationStats &) = delete;
+
+	~OperationStats();
+
+	void setOperation(uint8_t id) {
+		id_ = id;
+		stats_inc(id);
+	}
+
+private:
+	uint8_t id_;
+	SteadyTimePoint start_;
+};
+
 void attr_to_stat(uint32_t inode, const Attributes &attr, struct stat *stbuf);
 
 void makeattrstr(char *buff, uint32_t size, struct stat *stbuf);
@@ -246,10 +246,14 @@ static int mainloop(struct fuse_args *args, const char *mountpoint, bool multith
 	params.cache_expiration_time_ms = gMountOptions.cacheexpirationtime;
 	params.readahead_max_window_size_kB = gMountOptions.readaheadmaxwindowsize;
 	params.prefetch_xor_stripes = gMountOptions.prefetchxorstripes;
+	params.shared_cache_size = gMountOptions.sharedcachesize;
+	params.hedge_read_percentile = gMountOptions.hedgereadpercentile;
+	params.chunk_location_cache_timeout_ms = gMountOptions.locationcachetimeout;
 	params.bandwidth_overuse = gMountOptions.bandwidthoveruse;
 	params.write_cache_size = gMountOptions.writecachesize;
 	params.write_workers = gMountOptions.writeworkers;
 	params.write_window_size = gMountOptions.writewindowsize;
+	params.write_lease_time_s = gMountOptions.writeleasetime;
 	params.chunkserver_write_timeout_ms = gMountOptions.chunkserverwriteto;
 	params.cache_per_inode_percentage = gMountOptions.cachePerInodePercentage;
 	params.keep_cache = gMountOptions.keepcache;
@@ -161,6 +161,7 @@ LizardClient::Context get_reduced_context(fuse_req_t& req) {
 	mode_t umask = 0000;
 #endif
 	auto ret = LizardClient::Context(fuse_ctx->uid, fuse_ctx->gid, fuse_ctx->pid, umask);
+	ret.start_time = SteadyClock::now();
 	return ret;
 }
 
@@ -57,6 +57,7 @@ struct fuse_opt gMfsOptsStage2[] = {
 	MFS_OPT("mfswriteworkers=%u", writeworkers, 0),
 	MFS_OPT("mfsioretries=%u", ioretries, 0),
 	MFS_OPT("mfswritewindowsize=%u", writewindowsize, 0),
+	MFS_OPT("mfswritelease=%u", writeleasetime, 0),
 	MFS_OPT("mfsdebug", debug, 1),
 	MFS_OPT("mfsmeta", meta, 1),
 	MFS_OPT("mfsdelayedinit", delayedinit, 1),
@@ -80,6 +81,9 @@ struct fuse_opt gMfsOptsStage2[] = {
 	MFS_OPT("cacheexpirationtime=%d", cacheexpirationtime, 0),
 	MFS_OPT("readaheadmaxwindowsize=%d", readaheadmaxwindowsize, 4096),
 	MFS_OPT("mfsprefetchxorstripes", prefetchxorstripes, 1),
+	MFS_OPT("mfssharedcachesize=%u", sharedcachesize, 0),
+	MFS_OPT("mfshedgepercentile=%u", hedgereadpercentile, 0),
+	MFS_OPT("mfslocationcachetimeout=%u", locationcachetimeout, 0),
 	MFS_OPT("mfschunkserverwriteto=%d", chunkserverwriteto, 0),
 	MFS_OPT("symlinkcachetimeout=%d", symlinkcachetimeout, 3600),
 	MFS_OPT("bandwidthoveruse=%lf", bandwidthoveruse, 1),
@@ -192,6 +196,14 @@ printf(
 				"descriptor in kibibytes (default: %u)\n"
 "    -o mfsprefetchxorstripes    prefetch full xor stripe on every first read "
 				"of a xor chunk\n"
+"    -o mfssharedcachesize=N     define size of read cache shared by all "
+				"descriptors in MiB (0 disables cache) (default: %u)\n"
+"    -o mfshedgepercentile=N     send reads taking longer than N-th percentile "
+				"of previous reads from a chunkserver also to "
+				"another copy (0 disables hedging) (default: %u)\n"
+"    -o mfslocationcachetimeout=MSEC  reuse locations of chunks received from "
+				"master for MSEC milliseconds (0 disables cache) "
+				"(default: %u)\n"
 "    -o mfschunkserverwriteto=MSEC  set chunkserver response timeout during "
 				"write operation in milliseconds (default: %u)\n"
 "    -o mfsnice=N                on startup mfsmount tries to change his "
@@ -210,6 +222,11 @@ printf(
 				"returned (default: %u)\n"
 "    -o mfswritewindowsize=N     define write window size (in blocks) for "
 				"each chunk (default: %u)\n"
+"    -o mfswritelease=SEC        keep chunk locked between consecutive writes "
+				"for up to SEC seconds (max 60) to save round "
+				"trips to master; file length is updated in "
+				"master when lock is released (0: disabled; "
+				"default: %u)\n"
 "    -o mfsmaster=HOST           define mfsmaster location (default: mfsmaster)\n"
 "    -o mfsport=PORT             define mfsmaster port number (default: 9421)\n"
 "    -o mfsbind=IP               define source ip address for connections "
@@ -251,6 +268,9 @@ printf(
 		LizardClient::FsInitParams::kDefaultChunkserverTotalReadTo,
 		LizardClient::FsInitParams::kDefaultCacheExpirationTime,
 		LizardClient::FsInitParams::kDefaultReadaheadMaxWindowSize,
+		LizardClient::FsInitParams::kDefaultSharedCacheSize,
+		LizardClient::FsInitParams::kDefaultHedgeReadPercentile,
+		LizardClient::FsInitParams::kDefaultChunkLocationCacheTimeout,
 		LizardClient::FsInitParams::kDefaultChunkserverWriteTo,
 		LizardClient::FsInitParams::kDefaultWriteCacheSize,
 		LizardClient::FsInitParams::kDefaultAclCacheSize,
@@ -258,6 +278,7 @@ printf(
 		LizardClient::FsInitParams::kDefaultWriteWorkers,
 		LizardClient::FsInitParams::kDefaultIoRetries,
 		LizardClient::FsInitParams::kDefaultWriteWindowSize,
+		LizardClient::FsInitParams::kDefaultWriteLeaseTime,
 		LizardClient::FsInitParams::kDefaultSubfolder,
 		LizardClient::FsInitParams::kDefaultSymlinkCacheTimeout,
 		LizardClient::FsInitParams::kDefaultBandwidthOveruse
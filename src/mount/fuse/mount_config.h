@@ -96,6 +96,7 @@ struct mfsopts_ {
 	unsigned writeworkers;
 	unsigned ioretries;
 	unsigned writewindowsize;
+	unsigned writeleasetime;
 	double attrcacheto;
 	double entrycacheto;
 	double direntrycacheto;
@@ -110,6 +111,9 @@ struct mfsopts_ {
 	int cacheexpirationtime;
 	int readaheadmaxwindowsize;
 	int prefetchxorstripes;
+	unsigned sharedcachesize;
+	unsigned hedgereadpercentile;
+	unsigned locationcachetimeout;
 	unsigned symlinkcachetimeout;
 	double bandwidthoveruse;
 #if FUSE_VERSION >= 30
@@ -152,6 +156,7 @@ struct mfsopts_ {
 		writeworkers(LizardClient::FsInitParams::kDefaultWriteWorkers),
 		ioretries(LizardClient::FsInitParams::kDefaultIoRetries),
 		writewindowsize(LizardClient::FsInitParams::kDefaultWriteWindowSize),
+		writeleasetime(LizardClient::FsInitParams::kDefaultWriteLeaseTime),
 		attrcacheto(LizardClient::FsInitParams::kDefaultAttrCacheTimeout),
 		entrycacheto(LizardClient::FsInitParams::kDefaultEntryCacheTimeout),
 		direntrycacheto(LizardClient::FsInitParams::kDefaultDirentryCacheTimeout),
@@ -166,6 +171,9 @@ struct mfsopts_ {
 		cacheexpirationtime(LizardClient::FsInitParams::kDefaultCacheExpirationTime),
 		readaheadmaxwindowsize(LizardClient::FsInitParams::kDefaultReadaheadMaxWindowSize),
 		prefetchxorstripes(LizardClient::FsInitParams::kDefaultPrefetchXorStripes),
+		sharedcachesize(LizardClient::FsInitParams::kDefaultSharedCacheSize),
+		hedgereadpercentile(LizardClient::FsInitParams::kDefaultHedgeReadPercentile),
+		locationcachetimeout(LizardClient::FsInitParams::kDefaultChunkLocationCacheTimeout),
 		symlinkcachetimeout(LizardClient::FsInitParams::kDefaultSymlinkCacheTimeout),
 		bandwidthoveruse(LizardClient::FsInitParams::kDefaultBandwidthOveruse)
 #if FUSE_VERSION >= 30
@@ -96,11 +96,16 @@ void MountLimiter::loadConfiguration(const IoLimitsConfigLoader& config) {
 	reconfigure_(1000, config.subsystem(), database_.getGroups());
 }
 
-std::shared_ptr<Group> LimiterProxy::getGroup(const IoLimitGroupId& groupId) const {
+LimiterProxy::Groups::const_iterator LimiterProxy::findGroup(const IoLimitGroupId& groupId) const {
 	Groups::const_iterator groupIt = groups_.find(groupId);
 	if (groupIt == groups_.end()) {
 		groupIt = groups_.find(kUnclassified);
 	}
+	return groupIt;
+}
+
+std::shared_ptr<Group> LimiterProxy::getGroup(const IoLimitGroupId& groupId) const {
+	Groups::const_iterator groupIt = findGroup(groupId);
 	if (groupIt == groups_.end()) {
 		return nullptr;
 	}
@@ -108,13 +113,43 @@ std::shared_ptr<Group> LimiterProxy::getGroup(const IoLimitGroupId& groupId) con
 }
 
 uint8_t LimiterProxy::waitForRead(const pid_t pid, const uint64_t size, SteadyTimePoint deadline) {
+	std::string subsystem;
+	{
+		std::unique_lock<std::mutex> cpuLock(cpuLocks_[currentCpuSlot(cpuSlots_)].mutex);
+		if (!enabled_) {
+			return LIZARDFS_STATUS_OK;
+		}
+		subsystem = subsystem_;
+	}
+	// Reading /proc/<pid>/cgroup takes a while, so it is done without any lock
+	IoLimitGroupId groupId = getIoLimitGroupIdNoExcept(pid, subsystem);
+	{
+		std::unique_lock<std::mutex> cpuLock(cpuLocks_[currentCpuSlot(cpuSlots_)].mutex);
+		if (!enabled_) {
+			return LIZARDFS_STATUS_OK;
+		}
+		if (subsystem == subsystem_) {
+			Groups::const_iterator groupIt = findGroup(groupId);
+			if (groupIt == groups_.end()) {
+				return LIZARDFS_ERROR_EPERM;
+			}
+			// The group can't be removed while the lock of any CPU is held
+			if (groupIt->second->tryTake(size)) {
+				return LIZARDFS_STATUS_OK;
+			}
+		}
+	}
+
 	std::unique_lock<std::mutex> lock(mutex_);
 	uint8_t status;
 	do {
 		if (!enabled_) {
 			return LIZARDFS_STATUS_OK;
 		}
-		IoLimitGroupId groupId = getIoLimitGroupIdNoExcept(pid, subsystem_);
+		if (subsystem != subsystem_) {
+			subsystem = subsystem_;
+			groupId = getIoLimitGroupIdNoExcept(pid, subsystem);
+		}
 		// Grab a shared_ptr reference on the group descriptor so that reconfigure() can
 		// quickly unreference this group from the groups_ map without waiting for us.
 		std::shared_ptr<Group> group = getGroup(groupId);
@@ -138,6 +173,10 @@ void LimiterProxy::reconfigure(uint32_t delta_us, const std::string& subsystem,
 	std::sort(newGroupIds.begin(), newGroupIds.end(), std::less<std::string>());
 
 	std::unique_lock<std::mutex> lock(mutex_);
+	std::vector<std::unique_lock<std::mutex>> cpuLocks;
+	for (uint32_t i = 0; i < cpuSlots_; ++i) {
+		cpuLocks.emplace_back(cpuLocks_[i].mutex);
+	}
 
 	const bool differentSubsystem = (subsystem_ != subsystem);
 	auto newIter = newGroupIds.begin();
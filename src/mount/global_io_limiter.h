@@ -58,12 +58,18 @@ private:
 
 // This class is a proxy that locally handles calls to a possibly remote Limiter.
 // It classifies clients into groups and performs required delays.
+//
+// Requests which can be satisfied with tokens left on the CPU of the caller (see Group) hold
+// only the lock of this CPU. Other requests wait under 'mutex_'. Configuration is changed
+// with 'mutex_' and locks of all CPUs held.
 class LimiterProxy {
 public:
 	LimiterProxy(Limiter& limiter, Clock& clock) :
 		shared_(limiter, std::chrono::milliseconds(100)),
 		enabled_(true),
-		clock_(clock)
+		clock_(clock),
+		cpuSlots_(ioLimiting::cpuSlots()),
+		cpuLocks_(new CpuLock[cpuSlots_])
 	{
 		using namespace std::placeholders;
 		limiter.registerReconfigure(std::bind(
@@ -83,6 +89,13 @@ public:
 private:
 	typedef std::map<IoLimitGroupId, std::shared_ptr<Group>> Groups;
 
+	// Padded to a cache line, so that CPUs don't share them
+	struct CpuLock {
+		std::mutex mutex;
+		char padding[64 - sizeof(std::mutex) % 64];
+	};
+
+	Groups::const_iterator findGroup(const IoLimitGroupId& groupId) const;
 	std::shared_ptr<Group> getGroup(const IoLimitGroupId& groupId) const;
 	// Remove groups that were deleted, cancel queued operations assigned to them. Add new groups.
 	// Update the delta_us parameter.
@@ -96,6 +109,8 @@ private:
 	Groups groups_;
 	bool enabled_;
 	Clock& clock_;
+	const uint32_t cpuSlots_;
+	std::unique_ptr<CpuLock[]> cpuLocks_;
 };
 
 } // namespace ioLimiting
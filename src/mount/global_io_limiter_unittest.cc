@@ -19,6 +19,7 @@
 #include "common/platform.h"
 #include "mount/global_io_limiter.h"
 
+#include <algorithm>
 #include <atomic>
 #include <future>
 #include <math.h>
@@ -54,6 +55,16 @@ struct UnlimitedLimiter : public TestingLimiter {
 	}
 };
 
+// This limiter accepts all requests and counts them
+struct CountingLimiter : public TestingLimiter {
+	CountingLimiter() : requestsNr(0) {}
+	uint64_t request(const IoLimitGroupId&, uint64_t size) override {
+		requestsNr++;
+		return size;
+	}
+	std::atomic<uint32_t> requestsNr;
+};
+
 // A clock that is incremented manually. 'sleepUntil' terminates when time is set to a value
 // exceeding expected time
 class ManuallyAdjustedClock : public Clock {
@@ -182,6 +193,78 @@ TEST(LimiterGroupTests, Die) {
 	}
 }
 
+// Check if bandwidth left after serving waiting users is used without waiting and without
+// asking the limiter, and if it is accounted in the next request sent to the limiter
+TEST(LimiterGroupTests, LocalTokens) {
+	CountingLimiter limiter;
+	SharedState shared{limiter, std::chrono::seconds(1)};
+	ManuallyAdjustedClock clock;
+	Group group(shared, "group", clock, 1);
+
+	std::mutex mutex;
+	std::unique_lock<std::mutex> lock(mutex);
+	auto deadline = clock.now() + std::chrono::seconds(1);
+
+	ASSERT_FALSE(group.tryTake(1));
+	ASSERT_EQ(LIZARDFS_STATUS_OK, group.wait(1000, deadline, lock));
+	ASSERT_EQ(1U, limiter.requestsNr.load());
+	ASSERT_FALSE(group.tryTake(1));
+	// The limiter is asked for the past and the pending request, half of it is left
+	ASSERT_EQ(LIZARDFS_STATUS_OK, group.wait(1000, deadline, lock));
+	ASSERT_EQ(2U, limiter.requestsNr.load());
+	ASSERT_TRUE(group.tryTake(600));
+	ASSERT_FALSE(group.tryTake(600));
+	ASSERT_TRUE(group.tryTake(400));
+	ASSERT_FALSE(group.tryTake(1));
+	ASSERT_EQ(2U, limiter.requestsNr.load());
+	// Past requests (2000 bytes) + taken locally (1000) + pending (1000)
+	ASSERT_EQ(LIZARDFS_STATUS_OK, group.wait(1000, deadline, lock));
+	ASSERT_EQ(3U, limiter.requestsNr.load());
+	ASSERT_TRUE(group.tryTake(3000));
+	ASSERT_FALSE(group.tryTake(1));
+
+	// Tokens expire as the reserve does
+	ASSERT_EQ(LIZARDFS_STATUS_OK, group.wait(1000, deadline, lock));
+	ASSERT_TRUE(group.tryTake(1));
+	clock.increase(std::chrono::milliseconds(1001));
+	ASSERT_FALSE(group.tryTake(1));
+
+	// Past requests expired too, so the limiter is asked only for the pending request
+	// and the byte taken locally
+	deadline = clock.now() + std::chrono::seconds(1);
+	ASSERT_EQ(LIZARDFS_STATUS_OK, group.wait(1000, deadline, lock));
+	ASSERT_TRUE(group.tryTake(1));
+	ASSERT_FALSE(group.tryTake(1));
+
+	ASSERT_EQ(LIZARDFS_STATUS_OK, group.wait(1000, deadline, lock));
+	ASSERT_TRUE(group.tryTake(1));
+	group.die();
+	ASSERT_FALSE(group.tryTake(1));
+}
+
+// Check if tokens left on other CPUs are used before the limiter is asked for more
+TEST(LimiterGroupTests, LocalTokensAreRebalanced) {
+	CountingLimiter limiter;
+	SharedState shared{limiter, std::chrono::seconds(1)};
+	ManuallyAdjustedClock clock;
+	Group group(shared, "group", clock, 4);
+
+	std::mutex mutex;
+	std::unique_lock<std::mutex> lock(mutex);
+	auto deadline = clock.now() + std::chrono::seconds(1);
+
+	ASSERT_EQ(LIZARDFS_STATUS_OK, group.wait(1000, deadline, lock));
+	ASSERT_EQ(LIZARDFS_STATUS_OK, group.wait(1000, deadline, lock));
+	ASSERT_EQ(2U, limiter.requestsNr.load());
+	// 1000 bytes are left, the bucket of this CPU has only a quarter of them
+	ASSERT_FALSE(group.tryTake(1000));
+	ASSERT_TRUE(group.tryTake(250));
+	ASSERT_FALSE(group.tryTake(1));
+	ASSERT_EQ(LIZARDFS_STATUS_OK, group.wait(750, deadline, lock));
+	ASSERT_EQ(2U, limiter.requestsNr.load());
+	ASSERT_FALSE(group.tryTake(1));
+}
+
 // It would be nice to provide this test, but we don't have any cgroup mock:
 // TEST(LimiterProxyTests, GroupRemoved)
 
@@ -360,6 +443,83 @@ TEST(LimiterProxyTests, ManyMountsSummaryThroughput) {
 	}
 }
 
+// Check if bandwidth is limited accurately when many threads use tokens left on their CPUs
+TEST(LimiterProxyTests, ManyThreadsThroughput) {
+	const int N = 16;
+	const int M = 100;
+	FastClock clock;
+	IoLimitsDatabaseLimiter limiter(clock);
+	limiter.database.setLimits(clock.now(), {{kUnclassified, 1000/*1000KBps*/}}, 250);
+	LimiterProxy lp(limiter, clock);
+	limiter.callReconfigure(10000, "", {kUnclassified});
+
+	auto beginTime = clock.now();
+	auto deadline = beginTime + std::chrono::seconds(100);
+
+	// Run N threads, each reading M kilobytes:
+	std::vector<std::future<void>> asyncs;
+	for (int i = 0; i < N; ++i) {
+		asyncs.push_back(std::async(std::launch::async, [&lp, &deadline]() {
+			for (int j = 0; j < M; ++j) {
+				ASSERT_EQ(LIZARDFS_STATUS_OK, lp.waitForRead(getpid(), 1024, deadline));
+			}
+		}));
+	}
+	for (auto& async : asyncs) {
+		async.get();
+	}
+
+	// The limit is 1KB per millisecond:
+	auto expected_time_us = N * M * 1000;
+	auto time_passed_us = std::chrono::duration_cast<std::chrono::microseconds>(
+			clock.now() - beginTime).count();
+	ASSERT_NEAR(expected_time_us, time_passed_us, expected_time_us / 10);
+}
+
+// Check if threads waiting for bandwidth are served in turns
+TEST(LimiterProxyTests, ManyThreadsFairness) {
+	const int N = 16;
+	const int M = 20;
+	ManuallyAdjustedClock clock;
+	IoLimitsDatabaseLimiter limiter(clock);
+	limiter.database.setLimits(clock.now(), {{kUnclassified, 1000/*1000KBps*/}}, 1);
+	LimiterProxy lp(limiter, clock);
+	limiter.callReconfigure(1000, "", {kUnclassified});
+
+	auto deadline = clock.now() + std::chrono::seconds(100);
+
+	std::mutex mutex;
+	std::condition_variable someoneCompleted;
+	int completed = 0;
+	// Run N threads, each performing M subsequent 1KB reads, remember the number of reads
+	// completed by all threads when each of them finished:
+	std::vector<std::future<int>> finishedAfter;
+	for (int i = 0; i < N; ++i) {
+		finishedAfter.push_back(std::async(std::launch::async, [&]() {
+			int result = 0;
+			for (int j = 0; j < M; ++j) {
+				EXPECT_EQ(LIZARDFS_STATUS_OK, lp.waitForRead(getpid(), 1024, deadline));
+				std::unique_lock<std::mutex> lock(mutex);
+				result = ++completed;
+				someoneCompleted.notify_all();
+			}
+			return result;
+		}));
+	}
+
+	// Exactly one read is completed after every millisecond
+	for (int i = 1; i <= N * M; ++i) {
+		clock.increase(std::chrono::milliseconds(1));
+		std::unique_lock<std::mutex> lock(mutex);
+		someoneCompleted.wait(lock, [&completed, i]() { return completed >= i; });
+		ASSERT_EQ(i, completed);
+	}
+	// Threads were served in turns, so none of them finished much earlier than others
+	for (auto& result : finishedAfter) {
+		ASSERT_LE(N * (M - 5), result.get());
+	}
+}
+
 // Check if we don't communicate with the master too often
 TEST(LimiterProxyTests, NumberOfRequestesSentToMaster) {
 	for (auto delta_ms : {1, 11, 37, 128, 5678}) {
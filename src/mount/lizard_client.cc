@@ -252,62 +252,74 @@ private:
 	bool locked_;
 };
 
-static uint64_t *statsptr[STATNODES];
+static uint32_t statscounters[STATNODES];
+static StatsLatencyHistogram statslatency[STATNODES];
+
+static void statsptr_init_op(uint8_t id, statsnode *s, statsnode *l, const char *name) {
+	statscounters[id] = stats_get_sharded_counter(stats_get_subnode(s,name,0),0);
+	statslatency[id].init(stats_get_subnode(l,name,0));
+}
 
 void statsptr_init(void) {
-	statsnode *s;
+	statsnode *s,*l;
 	s = stats_get_subnode(NULL,"fuse_ops",0);
-	statsptr[OP_SETXATTR] = stats_get_counterptr(stats_get_subnode(s,"setxattr",0));
-	statsptr[OP_GETXATTR] = stats_get_counterptr(stats_get_subnode(s,"getxattr",0));
-	statsptr[OP_LISTXATTR] = stats_get_counterptr(stats_get_subnode(s,"listxattr",0));
-	statsptr[OP_REMOVEXATTR] = stats_get_counterptr(stats_get_subnode(s,"removexattr",0));
-	statsptr[OP_FSYNC] = stats_get_counterptr(stats_get_subnode(s,"fsync",0));
-	statsptr[OP_FLUSH] = stats_get_counterptr(stats_get_subnode(s,"flush",0));
-	statsptr[OP_WRITE] = stats_get_counterptr(stats_get_subnode(s,"write",0));
-	statsptr[OP_READ] = stats_get_counterptr(stats_get_subnode(s,"read",0));
-	statsptr[OP_RELEASE] = stats_get_counterptr(stats_get_subnode(s,"release",0));
-	statsptr[OP_OPEN] = stats_get_counterptr(stats_get_subnode(s,"open",0));
-	statsptr[OP_CREATE] = stats_get_counterptr(stats_get_subnode(s,"create",0));
-	statsptr[OP_RELEASEDIR] = stats_get_counterptr(stats_get_subnode(s,"releasedir",0));
-	statsptr[OP_READDIR] = stats_get_counterptr(stats_get_subnode(s,"readdir",0));
-	statsptr[OP_READRESERVED] = stats_get_counterptr(stats_get_subnode(s,"readreserved",0));
-	statsptr[OP_READTRASH] = stats_get_counterptr(stats_get_subnode(s,"readtrash",0));
-	statsptr[OP_OPENDIR] = stats_get_counterptr(stats_get_subnode(s,"opendir",0));
-	statsptr[OP_LINK] = stats_get_counterptr(stats_get_subnode(s,"link",0));
-	statsptr[OP_RENAME] = stats_get_counterptr(stats_get_subnode(s,"rename",0));
-	statsptr[OP_READLINK] = stats_get_counterptr(stats_get_subnode(s,"readlink",0));
-	statsptr[OP_READLINK_CACHED] = stats_get_counterptr(stats_get_subnode(s,"readlink-cached",0));
-	statsptr[OP_SYMLINK] = stats_get_counterptr(stats_get_subnode(s,"symlink",0));
-	statsptr[OP_RMDIR] = stats_get_counterptr(stats_get_subnode(s,"rmdir",0));
-	statsptr[OP_MKDIR] = stats_get_counterptr(stats_get_subnode(s,"mkdir",0));
-	statsptr[OP_UNLINK] = stats_get_counterptr(stats_get_subnode(s,"unlink",0));
-	statsptr[OP_UNDEL] = stats_get_counterptr(stats_get_subnode(s,"undel",0));
-	statsptr[OP_MKNOD] = stats_get_counterptr(stats_get_subnode(s,"mknod",0));
-	statsptr[OP_SETATTR] = stats_get_counterptr(stats_get_subnode(s,"setattr",0));
-	statsptr[OP_GETATTR] = stats_get_counterptr(stats_get_subnode(s,"getattr",0));
-	statsptr[OP_DIRCACHE_GETATTR] = stats_get_counterptr(stats_get_subnode(s,"getattr-cached",0));
-	statsptr[OP_LOOKUP] = stats_get_counterptr(stats_get_subnode(s,"lookup",0));
-	statsptr[OP_LOOKUP_INTERNAL] = stats_get_counterptr(stats_get_subnode(s,"lookup-internal",0));
+	l = stats_get_subnode(NULL,"fuse_ops_latency",0);
+	statsptr_init_op(OP_SETXATTR,s,l,"setxattr");
+	statsptr_init_op(OP_GETXATTR,s,l,"getxattr");
+	statsptr_init_op(OP_LISTXATTR,s,l,"listxattr");
+	statsptr_init_op(OP_REMOVEXATTR,s,l,"removexattr");
+	statsptr_init_op(OP_FSYNC,s,l,"fsync");
+	statsptr_init_op(OP_FLUSH,s,l,"flush");
+	statsptr_init_op(OP_WRITE,s,l,"write");
+	statsptr_init_op(OP_READ,s,l,"read");
+	statsptr_init_op(OP_RELEASE,s,l,"release");
+	statsptr_init_op(OP_OPEN,s,l,"open");
+	statsptr_init_op(OP_CREATE,s,l,"create");
+	statsptr_init_op(OP_RELEASEDIR,s,l,"releasedir");
+	statsptr_init_op(OP_READDIR,s,l,"readdir");
+	statsptr_init_op(OP_READRESERVED,s,l,"readreserved");
+	statsptr_init_op(OP_READTRASH,s,l,"readtrash");
+	statsptr_init_op(OP_OPENDIR,s,l,"opendir");
+	statsptr_init_op(OP_LINK,s,l,"link");
+	statsptr_init_op(OP_RENAME,s,l,"rename");
+	statsptr_init_op(OP_READLINK,s,l,"readlink");
+	statsptr_init_op(OP_READLINK_CACHED,s,l,"readlink-cached");
+	statsptr_init_op(OP_SYMLINK,s,l,"symlink");
+	statsptr_init_op(OP_RMDIR,s,l,"rmdir");
+	statsptr_init_op(OP_MKDIR,s,l,"mkdir");
+	statsptr_init_op(OP_UNLINK,s,l,"unlink");
+	statsptr_init_op(OP_UNDEL,s,l,"undel");
+	statsptr_init_op(OP_MKNOD,s,l,"mknod");
+	statsptr_init_op(OP_SETATTR,s,l,"setattr");
+	statsptr_init_op(OP_GETATTR,s,l,"getattr");
+	statsptr_init_op(OP_DIRCACHE_GETATTR,s,l,"getattr-cached");
+	statsptr_init_op(OP_LOOKUP,s,l,"lookup");
+	statsptr_init_op(OP_LOOKUP_INTERNAL,s,l,"lookup-internal");
 	if (usedircache) {
-		statsptr[OP_DIRCACHE_LOOKUP] = stats_get_counterptr(stats_get_subnode(s,"lookup-cached",0));
+		statsptr_init_op(OP_DIRCACHE_LOOKUP,s,l,"lookup-cached");
 	}
-	statsptr[OP_ACCESS] = stats_get_counterptr(stats_get_subnode(s,"access",0));
-	statsptr[OP_STATFS] = stats_get_counterptr(stats_get_subnode(s,"statfs",0));
+	statsptr_init_op(OP_ACCESS,s,l,"access");
+	statsptr_init_op(OP_STATFS,s,l,"statfs");
 	if (usedircache) {
-		statsptr[OP_GETDIR_FULL] = stats_get_counterptr(stats_get_subnode(s,"getdir-full",0));
+		statsptr_init_op(OP_GETDIR_FULL,s,l,"getdir-full");
 	} else {
-		statsptr[OP_GETDIR_SMALL] = stats_get_counterptr(stats_get_subnode(s,"getdir-small",0));
+		statsptr_init_op(OP_GETDIR_SMALL,s,l,"getdir-small");
 	}
-	statsptr[OP_GETLK] = stats_get_counterptr(stats_get_subnode(s,"getlk",0));
-	statsptr[OP_SETLK] = stats_get_counterptr(stats_get_subnode(s,"setlk",0));
-	statsptr[OP_FLOCK] = stats_get_counterptr(stats_get_subnode(s,"flock",0));
+	statsptr_init_op(OP_GETLK,s,l,"getlk");
+	statsptr_init_op(OP_SETLK,s,l,"setlk");
+	statsptr_init_op(OP_FLOCK,s,l,"flock");
 }
 
 void stats_inc(uint8_t id) {
 	if (id < STATNODES) {
-		stats_lock();
-		(*statsptr[id])++;
-		stats_unlock();
+		stats_sharded_add(statscounters[id], 1);
+	}
+}
+
+OperationStats::~OperationStats() {
+	if (id_ < STATNODES) {
+		statslatency[id_].add(std::chrono::duration_cast<std::chrono::microseconds>(
+				SteadyClock::now() - start_).count());
 	}
 }
 
@@ -517,7 +529,7 @@ struct statvfs statfs(const Context &ctx, Inode ino) {
 	struct statvfs stfsbuf;
 	memset(&stfsbuf,0,sizeof(stfsbuf));
 
-	stats_inc(OP_STATFS);
+	OperationStats op_stats(OP_STATFS);
 	if (debug_mode) {
 		oplog_printf(ctx, "statfs (%lu)", (unsigned long int)ino);
 	}
@@ -580,7 +592,7 @@ void access(const Context &ctx, Inode ino, int mask) {
 	oplog_printf(ctx, "access (%lu,0x%X)",
 			(unsigned long int)ino,
 			mask);
-	stats_inc(OP_ACCESS);
+	OperationStats op_stats(OP_ACCESS);
 #if (R_OK==MODE_MASK_R) && (W_OK==MODE_MASK_W) && (X_OK==MODE_MASK_X)
 	mmode = mask & (MODE_MASK_R | MODE_MASK_W | MODE_MASK_X);
 #else
@@ -609,6 +621,7 @@ void access(const Context &ctx, Inode ino, int mask) {
 }
 
 EntryParam lookup(const Context &ctx, Inode parent, const char *name) {
+	OperationStats op_stats;
 	EntryParam e;
 	uint64_t maxfleng;
 	uint32_t inode;
@@ -624,7 +637,7 @@ EntryParam lookup(const Context &ctx, Inode parent, const char *name) {
 	}
 	nleng = strlen(name);
 	if (nleng > MFS_NAME_MAX) {
-		stats_inc(OP_LOOKUP);
+		op_stats.setOperation(OP_LOOKUP);
 		oplog_printf(ctx, "lookup (%lu,%s): %s",
 				(unsigned long int)parent,
 				name,
@@ -654,12 +667,12 @@ EntryParam lookup(const Context &ctx, Inode parent, const char *name) {
 		if (debug_mode) {
 			lzfs::log_debug("lookup: sending data from dircache");
 		}
-		stats_inc(OP_DIRCACHE_LOOKUP);
+		op_stats.setOperation(OP_DIRCACHE_LOOKUP);
 		status = 0;
 		icacheflag = 1;
 //              oplog_printf(ctx, "lookup (%lu,%s) (using open dir cache): OK (%lu)",(unsigned long int)parent,name,(unsigned long int)inode);
 	} else {
-		stats_inc(OP_LOOKUP);
+		op_stats.setOperation(OP_LOOKUP);
 		RETRY_ON_ERROR_WITH_UPDATED_CREDENTIALS(status, ctx.gid,
 		fs_lookup(parent, std::string(name, nleng), ctx.uid, ctx.gid, &inode, attr));
 		icacheflag = 0;
@@ -697,6 +710,7 @@ EntryParam lookup(const Context &ctx, Inode parent, const char *name) {
 }
 
 AttrReply getattr(const Context &ctx, Inode ino) {
+	OperationStats op_stats;
 	uint64_t maxfleng;
 	double attr_timeout;
 	struct stat o_stbuf;
@@ -717,10 +731,10 @@ AttrReply getattr(const Context &ctx, Inode ino) {
 		if (debug_mode) {
 			lzfs::log_debug("getattr: sending data from dircache\n");
 		}
-		stats_inc(OP_DIRCACHE_GETATTR);
+		op_stats.setOperation(OP_DIRCACHE_GETATTR);
 		status = LIZARDFS_STATUS_OK;
 	} else {
-		stats_inc(OP_GETATTR);
+		op_stats.setOperation(OP_GETATTR);
 		RETRY_ON_ERROR_WITH_UPDATED_CREDENTIALS(status, ctx.gid,
 		fs_getattr(ino,ctx.uid,ctx.gid,attr));
 	}
@@ -754,7 +768,7 @@ AttrReply setattr(const Context &ctx, Inode ino, struct stat *stbuf, int to_set)
 	int status;
 
 	makemodestr(modestr,stbuf->st_mode);
-	stats_inc(OP_SETATTR);
+	OperationStats op_stats(OP_SETATTR);
 	if (debug_mode) {
 		oplog_printf(ctx, "setattr (%lu,0x%X,[%s:0%04o,%ld,%ld,%lu,%lu,%" PRIu64 "]) ...",
 			(unsigned long int)ino,
@@ -953,7 +967,7 @@ EntryParam mknod(const Context &ctx, Inode parent, const char *name, mode_t mode
 	uint8_t type;
 
 	makemodestr(modestr,mode);
-	stats_inc(OP_MKNOD);
+	OperationStats op_stats(OP_MKNOD);
 	if (debug_mode) {
 		oplog_printf(ctx, "mknod (%lu,%s,%s:0%04o,0x%08lX) ...",
 				(unsigned long int)parent,
@@ -1043,7 +1057,7 @@ void unlink(const Context &ctx, Inode parent, const char *name) {
 	uint32_t nleng;
 	int status;
 
-	stats_inc(OP_UNLINK);
+	OperationStats op_stats(OP_UNLINK);
 	if (debug_mode) {
 		oplog_printf(ctx, "unlink (%lu,%s) ...", (unsigned long int)parent, name);
 	}
@@ -1084,7 +1098,7 @@ void unlink(const Context &ctx, Inode parent, const char *name) {
 }
 
 void undel(const Context &ctx, Inode ino) {
-	stats_inc(OP_UNDEL);
+	OperationStats op_stats(OP_UNDEL);
 	if (debug_mode) {
 		oplog_printf(ctx, "undel (%lu) ...", (unsigned long)ino);
 	}
@@ -1107,7 +1121,7 @@ EntryParam mkdir(const Context &ctx, Inode parent, const char *name, mode_t mode
 	int status;
 
 	makemodestr(modestr,mode);
-	stats_inc(OP_MKDIR);
+	OperationStats op_stats(OP_MKDIR);
 	if (debug_mode) {
 		oplog_printf(ctx, "mkdir (%lu,%s,d%s:0%04o) ...",
 				(unsigned long int)parent,
@@ -1172,7 +1186,7 @@ void rmdir(const Context &ctx, Inode parent, const char *name) {
 	uint32_t nleng;
 	int status;
 
-	stats_inc(OP_RMDIR);
+	OperationStats op_stats(OP_RMDIR);
 	if (debug_mode) {
 		oplog_printf(ctx, "rmdir (%lu,%s) ...", (unsigned long int)parent, name);
 	}
@@ -1221,7 +1235,7 @@ EntryParam symlink(const Context &ctx, const char *path, Inode parent,
 	uint32_t nleng;
 	int status;
 
-	stats_inc(OP_SYMLINK);
+	OperationStats op_stats(OP_SYMLINK);
 	if (debug_mode) {
 		oplog_printf(ctx, "symlink (%s,%lu,%s) ...",
 				path,
@@ -1287,13 +1301,13 @@ std::string readlink(const Context &ctx, Inode ino) {
 				(unsigned long int)ino);
 	}
 	if (symlink_cache_search(ino,&path)) {
-		stats_inc(OP_READLINK_CACHED);
+		OperationStats op_stats(OP_READLINK_CACHED);
 		oplog_printf(ctx, "readlink (%lu) (using cache): OK (%s)",
 				(unsigned long int)ino,
 				(char*)path);
 		return std::string((char*)path);
 	}
-	stats_inc(OP_READLINK);
+	OperationStats op_stats(OP_READLINK);
 	status = fs_readlink(ino,&path);
 	if (status != LIZARDFS_STATUS_OK) {
 		oplog_printf(ctx, "readlink (%lu): %s",
@@ -1316,7 +1330,7 @@ void rename(const Context &ctx, Inode parent, const char *name,
 	uint32_t inode;
 	Attributes attr;
 
-	stats_inc(OP_RENAME);
+	OperationStats op_stats(OP_RENAME);
 	if (debug_mode) {
 		oplog_printf(ctx, "rename (%lu,%s,%lu,%s) ...",
 				(unsigned long int)parent,
@@ -1399,7 +1413,7 @@ EntryParam link(const Context &ctx, Inode ino, Inode newparent, const char *newn
 	uint8_t mattr;
 
 
-	stats_inc(OP_LINK);
+	OperationStats op_stats(OP_LINK);
 	if (debug_mode) {
 		oplog_printf(ctx, "link (%lu,%lu,%s) ...",
 				(unsigned long int)ino,
@@ -1466,7 +1480,7 @@ EntryParam link(const Context &ctx, Inode ino, Inode newparent, const char *newn
 void opendir(const Context &ctx, Inode ino) {
 	int status;
 
-	stats_inc(OP_OPENDIR);
+	OperationStats op_stats(OP_OPENDIR);
 	if (debug_mode) {
 		oplog_printf(ctx, "opendir (%lu) ...", (unsigned long int)ino);
 	}
@@ -1501,7 +1515,7 @@ std::vector<DirEntry> readdir(const Context &ctx, Inode ino, off_t off, size_t m
 	// (LizardFS's offset can be interpreted as negative on signed integer types (e.g. off_t used by libfuse),
 	// as it is 64bit unsigned int on master)
 
-	stats_inc(OP_READDIR);
+	OperationStats op_stats(OP_READDIR);
 	if (debug_mode) {
 		oplog_printf(ctx, "readdir (%lu,%" PRIu64 ",%" PRIu64 ") ...",
 				static_cast<unsigned long int>(ino),
@@ -1633,7 +1647,7 @@ std::vector<DirEntry> readdir(const Context &ctx, Inode ino, off_t off, size_t m
 }
 
 std::vector<NamedInodeEntry> readreserved(const Context &ctx, NamedInodeOffset off, NamedInodeOffset max_entries) {
-	stats_inc(OP_READRESERVED);
+	OperationStats op_stats(OP_READRESERVED);
 	if (debug_mode) {
 		oplog_printf(ctx, "readreserved (%" PRIu64 ",%" PRIu64 ") ...",
 				(uint64_t)max_entries,
@@ -1653,7 +1667,7 @@ std::vector<NamedInodeEntry> readreserved(const Context &ctx, NamedInodeOffset o
 }
 
 std::vector<NamedInodeEntry> readtrash(const Context &ctx, NamedInodeOffset off, NamedInodeOffset max_entries) {
-	stats_inc(OP_READTRASH);
+	OperationStats op_stats(OP_READTRASH);
 	if (debug_mode) {
 		oplog_printf(ctx, "readtrash (%" PRIu64 ",%" PRIu64 ") ...",
 				(uint64_t)max_entries,
@@ -1675,7 +1689,7 @@ std::vector<NamedInodeEntry> readtrash(const Context &ctx, NamedInodeOffset off,
 void releasedir(Inode ino) {
 	static constexpr int kBatchSize = 1000;
 
-	stats_inc(OP_RELEASEDIR);
+	OperationStats op_stats(OP_RELEASEDIR);
 	if (debug_mode) {
 		oplog_printf("releasedir (%lu) ...",
 				(unsigned long int)ino);
@@ -1752,7 +1766,7 @@ EntryParam create(const Context &ctx, Inode parent, const char *name, mode_t mod
 	finfo *fileinfo;
 
 	makemodestr(modestr,mode);
-	stats_inc(OP_CREATE);
+	OperationStats op_stats(OP_CREATE);
 	if (debug_mode) {
 		oplog_printf(ctx, "create (%lu,%s,-%s:0%04o)",
 				(unsigned long int)parent,
@@ -1864,7 +1878,7 @@ void open(const Context &ctx, Inode ino, FileInfo *fi) {
 
 	finfo *fileinfo;
 
-	stats_inc(OP_OPEN);
+	OperationStats op_stats(OP_OPEN);
 	if (debug_mode) {
 		oplog_printf(ctx, "open (%lu) ...", (unsigned long int)ino);
 	}
@@ -1895,6 +1909,11 @@ void open(const Context &ctx, Inode ino, FileInfo *fi) {
 	}
 
 	mattr = attr_get_mattr(attr);
+	if (!(mattr & MATTR_ALLOWDATACACHE)) {
+		// the file could have been modified by other clients since it was opened here,
+		// which doesn't always change versions of its chunks
+		read_data_invalidate_shared_cache(ino);
+	}
 	fileinfo = fs_newfileinfo(fi->flags & O_ACCMODE,ino);
 	fi->fh = reinterpret_cast<uintptr_t>(fileinfo);
 	if (keep_cache==1) {
@@ -1924,7 +1943,7 @@ static void update_credentials(Context::IdType index, const GroupCache::Groups &
 void release(Inode ino, FileInfo *fi) {
 	finfo *fileinfo = reinterpret_cast<finfo*>(fi->fh);
 
-	stats_inc(OP_RELEASE);
+	OperationStats op_stats(OP_RELEASE);
 	if (debug_mode) {
 		oplog_printf("release (%lu) ...", (unsigned long int)ino);
 	}
@@ -1953,7 +1972,7 @@ std::vector<uint8_t> read_special_inode(const Context &ctx,
 			off_t off,
 			FileInfo* fi) {
 	LOG_AVG_TILL_END_OF_SCOPE0("read");
-	stats_inc(OP_READ);
+	OperationStats op_stats(OP_READ);
 
 	return special_read(ino, ctx, size, off, fi, debug_mode);
 }
@@ -1964,7 +1983,7 @@ ReadCache::Result read(const Context &ctx,
 			off_t off,
 			FileInfo *fi) {
 	LOG_AVG_TILL_END_OF_SCOPE0("read");
-	stats_inc(OP_READ);
+	OperationStats op_stats(OP_READ);
 
 	finfo *fileinfo = reinterpret_cast<finfo*>(fi->fh);
 	int err;
@@ -2036,6 +2055,11 @@ ReadCache::Result read(const Context &ctx,
 	}
 	// end of reader critical section
 	flushlock.unlock();
+	// Reads on the same descriptor proceed concurrently, a write switching the descriptor
+	// to IO_WRITE only marks the reader as ended and it is kept until all reads finish
+	void *rr = fileinfo->data;
+	read_data_acquire(rr);
+	lock.unlock();
 
 	write_data_flush_inode(ino);
 
@@ -2046,7 +2070,8 @@ ReadCache::Result read(const Context &ctx,
 
 	uint32_t ssize = alignedSize;
 
-	err = read_data(fileinfo->data, alignedOffset, ssize, ret);
+	err = read_data(rr, alignedOffset, ssize, ret);
+	read_data_release(rr);
 	ssize = ret.requestSize(alignedOffset, ssize);
 	if (err != LIZARDFS_STATUS_OK) {
 		oplog_printf(ctx, "read (%lu,%" PRIu64 ",%" PRIu64 "): %s",
@@ -2079,7 +2104,7 @@ BytesWritten write(const Context &ctx, Inode ino, const char *buf, size_t size,
 	finfo *fileinfo = reinterpret_cast<finfo*>(fi->fh);
 	int err;
 
-	stats_inc(OP_WRITE);
+	OperationStats op_stats(OP_WRITE);
 	if (debug_mode) {
 		oplog_printf(ctx, "write (%lu,%" PRIu64 ",%" PRIu64 ") ...",
 				(unsigned long int)ino,
@@ -2166,7 +2191,7 @@ void flush(const Context &ctx, Inode ino, FileInfo* fi) {
 	finfo *fileinfo = reinterpret_cast<finfo*>(fi->fh);
 	int err;
 
-	stats_inc(OP_FLUSH);
+	OperationStats op_stats(OP_FLUSH);
 	if (debug_mode) {
 		oplog_printf(ctx, "flush (%lu) ...",
 				(unsigned long int)ino);
@@ -2209,7 +2234,7 @@ void fsync(const Context &ctx, Inode ino, int datasync, FileInfo* fi) {
 	finfo *fileinfo = reinterpret_cast<finfo*>(fi->fh);
 	int err;
 
-	stats_inc(OP_FSYNC);
+	OperationStats op_stats(OP_FSYNC);
 	if (debug_mode) {
 		oplog_printf(ctx, "fsync (%lu,%d) ...",
 				(unsigned long int)ino,
@@ -2610,7 +2635,7 @@ void setxattr(const Context &ctx, Inode ino, const char *name, const char *value
 	uint8_t mode;
 
 
-	stats_inc(OP_SETXATTR);
+	OperationStats op_stats(OP_SETXATTR);
 	if (debug_mode) {
 		oplog_printf(ctx, "setxattr (%lu,%s,%" PRIu64 ",%d) ...",
 				(unsigned long int)ino,
@@ -2727,7 +2752,7 @@ XattrReply getxattr(const Context &ctx, Inode ino, const char *name, size_t size
 	uint32_t leng;
 
 
-	stats_inc(OP_GETXATTR);
+	OperationStats op_stats(OP_GETXATTR);
 	if (debug_mode) {
 		oplog_printf(ctx, "getxattr (%lu,%s,%" PRIu64 ") ...",
 				(unsigned long int)ino,
@@ -2825,7 +2850,7 @@ XattrReply listxattr(const Context &ctx, Inode ino, size_t size) {
 	int status;
 	uint8_t mode;
 
-	stats_inc(OP_LISTXATTR);
+	OperationStats op_stats(OP_LISTXATTR);
 	if (debug_mode) {
 		oplog_printf(ctx, "listxattr (%lu,%" PRIu64 ") ...",
 				(unsigned long int)ino,
@@ -2879,7 +2904,7 @@ void removexattr(const Context &ctx, Inode ino, const char *name) {
 	uint32_t nleng;
 	int status;
 
-	stats_inc(OP_REMOVEXATTR);
+	OperationStats op_stats(OP_REMOVEXATTR);
 	if (debug_mode) {
 		oplog_printf(ctx, "removexattr (%lu,%s) ...",
 				(unsigned long int)ino,
@@ -2941,7 +2966,7 @@ void setlk_interrupt(const lzfs_locks::InterruptData &data) {
 void getlk(const Context &ctx, Inode ino, FileInfo* fi, struct lzfs_locks::FlockWrapper &lock) {
 	uint32_t status;
 
-	stats_inc(OP_FLOCK);
+	OperationStats op_stats(OP_FLOCK);
 	if (IS_SPECIAL_INODE(ino)) {
 		if (debug_mode) {
 			oplog_printf(ctx, "flock(ctx, %lu, fi): %s", (unsigned long int)ino, lizardfs_error_string(LIZARDFS_ERROR_EINVAL));
@@ -2968,7 +2993,7 @@ uint32_t setlk_send(const Context &ctx, Inode ino, FileInfo* fi, struct lzfs_loc
 	uint32_t reqid;
 	uint32_t status;
 
-	stats_inc(OP_SETLK);
+	OperationStats op_stats(OP_SETLK);
 	if (IS_SPECIAL_INODE(ino)) {
 		if (debug_mode) {
 			oplog_printf(ctx, "flock(ctx, %lu, fi): %s", (unsigned long int)ino, lizardfs_error_string(LIZARDFS_ERROR_EINVAL));
@@ -3017,7 +3042,7 @@ uint32_t flock_send(const Context &ctx, Inode ino, FileInfo* fi, int op) {
 	uint32_t reqid;
 	uint32_t status;
 
-	stats_inc(OP_FLOCK);
+	OperationStats op_stats(OP_FLOCK);
 	if (IS_SPECIAL_INODE(ino)) {
 		if (debug_mode) {
 			oplog_printf(ctx, "flock(ctx, %lu, fi): %s", (unsigned long int)ino, lizardfs_error_string(LIZARDFS_ERROR_EINVAL));
@@ -3218,9 +3243,13 @@ void fs_init(FsInitParams &params) {
 			params.cache_expiration_time_ms,
 			params.readahead_max_window_size_kB,
 			params.prefetch_xor_stripes,
-			std::max(params.bandwidth_overuse, 1.));
+			std::max(params.bandwidth_overuse, 1.),
+			params.shared_cache_size,
+			std::min(params.hedge_read_percentile, 100U),
+			params.chunk_location_cache_timeout_ms);
 	write_data_init(params.write_cache_size, params.io_retries, params.write_workers,
-			params.write_window_size, params.chunkserver_write_timeout_ms, params.cache_per_inode_percentage);
+			params.write_window_size, params.chunkserver_write_timeout_ms, params.cache_per_inode_percentage,
+			params.write_lease_time_s);
 
 	init(params.debug_mode, params.keep_cache, params.direntry_cache_timeout, params.direntry_cache_size,
 		params.entry_cache_timeout, params.attr_cache_timeout, params.mkdir_copy_sgid,
@@ -62,6 +62,9 @@ struct FsInitParams {
 	static constexpr unsigned kDefaultCacheExpirationTime = 0;
 	static constexpr unsigned kDefaultReadaheadMaxWindowSize = 16384;
 	static constexpr bool     kDefaultPrefetchXorStripes = false;
+	static constexpr unsigned kDefaultSharedCacheSize = 0;
+	static constexpr unsigned kDefaultHedgeReadPercentile = 0;
+	static constexpr unsigned kDefaultChunkLocationCacheTimeout = 0;
 
 	static constexpr float    kDefaultBandwidthOveruse = 1.0;
 	static constexpr unsigned kDefaultChunkserverWriteTo = 5000;
@@ -73,6 +76,7 @@ struct FsInitParams {
 	static constexpr unsigned kDefaultCachePerInodePercentage = 25;
 	static constexpr unsigned kDefaultWriteWorkers = 10;
 	static constexpr unsigned kDefaultWriteWindowSize = 15;
+	static constexpr unsigned kDefaultWriteLeaseTime = 0;
 	static constexpr unsigned kDefaultSymlinkCacheTimeout = 3600;
 #if FUSE_VERSION >= 30
 	static constexpr int      kDefaultNonEmptyMounts = 0;
@@ -117,8 +121,12 @@ struct FsInitParams {
 	             readahead_max_window_size_kB(kDefaultReadaheadMaxWindowSize),
 	             prefetch_xor_stripes(kDefaultPrefetchXorStripes),
 	             bandwidth_overuse(kDefaultBandwidthOveruse),
+	             shared_cache_size(kDefaultSharedCacheSize),
+	             hedge_read_percentile(kDefaultHedgeReadPercentile),
+	             chunk_location_cache_timeout_ms(kDefaultChunkLocationCacheTimeout),
 	             write_cache_size(kDefaultWriteCacheSize),
 	             write_workers(kDefaultWriteWorkers), write_window_size(kDefaultWriteWindowSize),
+	             write_lease_time_s(kDefaultWriteLeaseTime),
 	             chunkserver_write_timeout_ms(kDefaultChunkserverWriteTo),
 	             cache_per_inode_percentage(kDefaultCachePerInodePercentage),
 	             symlink_cache_timeout_s(kDefaultSymlinkCacheTimeout),
@@ -144,8 +152,12 @@ struct FsInitParams {
 	             readahead_max_window_size_kB(kDefaultReadaheadMaxWindowSize),
 	             prefetch_xor_stripes(kDefaultPrefetchXorStripes),
 	             bandwidth_overuse(kDefaultBandwidthOveruse),
+	             shared_cache_size(kDefaultSharedCacheSize),
+	             hedge_read_percentile(kDefaultHedgeReadPercentile),
+	             chunk_location_cache_timeout_ms(kDefaultChunkLocationCacheTimeout),
 	             write_cache_size(kDefaultWriteCacheSize),
 	             write_workers(kDefaultWriteWorkers), write_window_size(kDefaultWriteWindowSize),
+	             write_lease_time_s(kDefaultWriteLeaseTime),
 	             chunkserver_write_timeout_ms(kDefaultChunkserverWriteTo),
 	             cache_per_inode_percentage(kDefaultCachePerInodePercentage),
 	             symlink_cache_timeout_s(kDefaultSymlinkCacheTimeout),
@@ -178,10 +190,14 @@ struct FsInitParams {
 	unsigned readahead_max_window_size_kB;
 	bool prefetch_xor_stripes;
 	double bandwidth_overuse;
+	unsigned shared_cache_size;
+	unsigned hedge_read_percentile;
+	unsigned chunk_location_cache_timeout_ms;
 
 	unsigned write_cache_size;
 	unsigned write_workers;
 	unsigned write_window_size;
+	unsigned write_lease_time_s;
 	unsigned chunkserver_write_timeout_ms;
 	unsigned cache_per_inode_percentage;
 	unsigned symlink_cache_timeout_s;
@@ -23,6 +23,8 @@
 #include <sys/types.h>
 #include <protocol/cltoma.h>
 
+#include "common/time_utils.h"
+
 namespace LizardClient {
 
 /**
@@ -55,6 +57,9 @@ struct Context {
 	pid_t  pid; // Never sent to master so we can use local type.
 	MaskType umask;
 	GroupsContainer gids;
+	// Arrival time of the request, used for latency in the oplog. Unset (zero) for
+	// contexts which are not bound to a single request.
+	SteadyTimePoint start_time;
 };
 
 } // namespace LizardClient
@@ -19,249 +19,667 @@
 #include "common/platform.h"
 #include "mount/oplog.h"
 
-#include <errno.h>
 #include <pthread.h>
 #include <stdarg.h>
 #include <stdio.h>
-#include <stdlib.h>
 #include <string.h>
-#include <sys/time.h>
 #include <time.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <limits>
+#include <map>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "common/massert.h"
+#include "common/time_utils.h"
+
+/*
+ * Operations are logged by every thread into its own ring of binary records. A record
+ * holds the time of the operation, its latency, the caller's context, a pointer to the
+ * (static) format string and the raw values of the arguments. Nothing is formatted and
+ * no lock is taken when the log is written, records are rendered to text only when
+ * .oplog or .ophistory is read.
+ */
 
-#define OPBUFFSIZE 0x1000000
 #define LINELENG 1000
-#define MAXHISTORYSIZE 0xF00000
 
-typedef struct _fhentry {
-	unsigned long fh;
-	uint64_t readpos;
-	uint32_t refcount;
-	struct _fhentry *next;
-} fhentry;
-
-static unsigned long nextfh=1;
-static fhentry *fhhead=NULL;
-
-static uint8_t opbuff[OPBUFFSIZE];
-static uint64_t writepos=0;
-static uint8_t waiting=0;
-static pthread_mutex_t opbufflock = PTHREAD_MUTEX_INITIALIZER;
-static pthread_cond_t nodata = PTHREAD_COND_INITIALIZER;
-
-static time_t gConvTmHour = std::numeric_limits<time_t>::max(); // enforce update on first read
-static struct tm gConvTm;
-static pthread_mutex_t timelock = PTHREAD_MUTEX_INITIALIZER;
-
-static inline void oplog_put(uint8_t *buff,uint32_t leng) {
-	uint32_t bpos;
-	if (leng>OPBUFFSIZE) {  // just in case
-		buff+=leng-OPBUFFSIZE;
-		leng=OPBUFFSIZE;
-	}
-	pthread_mutex_lock(&opbufflock);
-	bpos = writepos%OPBUFFSIZE;
-	writepos+=leng;
-	if (bpos+leng>OPBUFFSIZE) {
-		memcpy(opbuff+bpos,buff,OPBUFFSIZE-bpos);
-		buff+=OPBUFFSIZE-bpos;
-		leng-=OPBUFFSIZE-bpos;
-		bpos = 0;
-	}
-	memcpy(opbuff+bpos,buff,leng);
-	if (waiting) {
-		pthread_cond_broadcast(&nodata);
-		waiting=0;
-	}
-	pthread_mutex_unlock(&opbufflock);
+namespace {
+
+constexpr uint32_t kThreadLogSize = 1 << 18;
+constexpr uint32_t kMaxRecordSize = 4096;
+constexpr uint32_t kNoLatency = std::numeric_limits<uint32_t>::max();
+
+struct RecordHeader {
+	uint32_t size; // including the header
+	uint32_t latency_us;
+	uint64_t timestamp_us;
+	const char *format;
+	uint32_t uid;
+	uint32_t gid;
+	uint32_t pid;
+	uint32_t has_context;
+};
+
+/*
+ * Ring of records of a single thread. Only the owner appends records, readers copy them
+ * and check afterwards (using tail) that they were not overwritten in the meantime.
+ */
+struct ThreadLog {
+	ThreadLog() : head(0), tail(0), in_use(true), next(nullptr) {
+	}
+
+	void copyIn(uint64_t pos, const uint8_t *src, uint32_t size) {
+		uint32_t offset = pos % kThreadLogSize;
+		uint32_t first = std::min(size, kThreadLogSize - offset);
+		memcpy(data + offset, src, first);
+		memcpy(data, src + first, size - first);
+	}
+
+	void copyOut(uint64_t pos, uint8_t *dst, uint32_t size) const {
+		uint32_t offset = pos % kThreadLogSize;
+		uint32_t first = std::min(size, kThreadLogSize - offset);
+		memcpy(dst, data + offset, first);
+		memcpy(dst + first, data, size - first);
+	}
+
+	void append(const uint8_t *record, uint32_t size) {
+		uint64_t pos = head.load(std::memory_order_relaxed);
+		uint64_t old_tail = tail.load(std::memory_order_relaxed);
+		uint64_t new_tail = old_tail;
+		while (pos + size - new_tail > kThreadLogSize) {
+			RecordHeader header;
+			copyOut(new_tail, (uint8_t *)&header, sizeof(header));
+			new_tail += header.size;
+		}
+		if (new_tail != old_tail) {
+			// Readers have to see the new tail before the overwritten bytes
+			tail.store(new_tail, std::memory_order_relaxed);
+			std::atomic_thread_fence(std::memory_order_release);
+		}
+		copyIn(pos, record, size);
+		head.store(pos + size, std::memory_order_release);
+	}
+
+	std::atomic<uint64_t> head; // end of the newest record
+	std::atomic<uint64_t> tail; // beginning of the oldest record
+	std::atomic<bool> in_use;
+	ThreadLog *next;
+	uint8_t data[kThreadLogSize];
+};
+
+/*
+ * Parsed printf conversion specification, e.g. "%-*.3lu".
+ */
+struct FormatSpec {
+	const char *begin;        // '%'
+	const char *length_begin; // length modifier (empty range if there is none)
+	const char *length_end;   // conversion character
+	int stars;                // number of '*' arguments (width and precision)
+	char length;              // 'H' for "hh", 'q' for "ll", otherwise the modifier or 0
+	char conversion;
+};
+
+// Parses the specification starting with '%' and returns pointer to the rest of format
+const char *parse_spec(const char *p, FormatSpec &spec) {
+	spec.begin = p++;
+	spec.stars = 0;
+	while (*p && strchr("-+ #0'", *p)) {
+		++p;
+	}
+	for (bool precision = false;; precision = true) {
+		if (*p == '*') {
+			spec.stars++;
+			++p;
+		}
+		while (*p >= '0' && *p <= '9') {
+			++p;
+		}
+		if (precision || *p != '.') {
+			break;
+		}
+		++p;
+	}
+	spec.length_begin = p;
+	while (*p && strchr("hljztLq", *p)) {
+		++p;
+	}
+	spec.length_end = p;
+	spec.length = (p == spec.length_begin) ? 0 : *spec.length_begin;
+	if (p - spec.length_begin == 2) {
+		spec.length = (spec.length == 'h') ? 'H' : 'q';
+	}
+	spec.conversion = *p;
+	return *p ? p + 1 : p;
+}
+
+class RecordWriter {
+public:
+	explicit RecordWriter(uint8_t *buffer) : buffer_(buffer), size_(sizeof(RecordHeader)) {
+	}
+
+	void put(const void *value, uint32_t size) {
+		size = std::min(size, kMaxRecordSize - size_);
+		memcpy(buffer_ + size_, value, size);
+		size_ += size;
+	}
+
+	void putInteger(uint64_t value) {
+		put(&value, sizeof(value));
+	}
+
+	void putDouble(double value) {
+		put(&value, sizeof(value));
+	}
+
+	void putString(const char *str) {
+		if (str == nullptr) {
+			str = "(null)";
+		}
+		uint16_t length = strnlen(str, LINELENG);
+		put(&length, sizeof(length));
+		put(str, length);
+	}
+
+	uint32_t size() const {
+		return size_;
+	}
+
+private:
+	uint8_t *buffer_;
+	uint32_t size_;
+};
+
+class RecordReader {
+public:
+	RecordReader(const uint8_t *data, uint32_t size)
+			: data_(data), size_(size), pos_(sizeof(RecordHeader)) {
+	}
+
+	template <typename T>
+	bool get(T &value) {
+		if (size_ - pos_ < sizeof(T)) {
+			return false;
+		}
+		memcpy(&value, data_ + pos_, sizeof(T));
+		pos_ += sizeof(T);
+		return true;
+	}
+
+	bool getString(std::string &str) {
+		uint16_t length;
+		if (!get(length)) {
+			return false;
+		}
+		length = std::min<uint32_t>(length, size_ - pos_);
+		str.assign((const char *)data_ + pos_, length);
+		pos_ += length;
+		return true;
+	}
+
+private:
+	const uint8_t *data_;
+	uint32_t size_;
+	uint32_t pos_;
+};
+
+/*
+ * Stores values of all arguments described by the format. Integers are widened to
+ * 64 bits (and rendered with "ll" modifier), strings are copied.
+ */
+void capture_arguments(RecordWriter &writer, const char *format, va_list ap) {
+	for (const char *p = format; *p;) {
+		if (*p != '%') {
+			++p;
+			continue;
+		}
+		if (p[1] == '%') {
+			p += 2;
+			continue;
+		}
+		FormatSpec spec;
+		p = parse_spec(p, spec);
+		for (int i = 0; i < spec.stars; ++i) {
+			writer.putInteger((int64_t)va_arg(ap, int));
+		}
+		switch (spec.conversion) {
+		case 'd':
+		case 'i':
+			switch (spec.length) {
+			case 'q': writer.putInteger(va_arg(ap, long long)); break;
+			case 'l': writer.putInteger(va_arg(ap, long)); break;
+			case 'j': writer.putInteger(va_arg(ap, intmax_t)); break;
+			case 'z':
+			case 't': writer.putInteger(va_arg(ap, ptrdiff_t)); break;
+			case 'H': writer.putInteger((signed char)va_arg(ap, int)); break;
+			case 'h': writer.putInteger((short)va_arg(ap, int)); break;
+			default: writer.putInteger(va_arg(ap, int)); break;
+			}
+			break;
+		case 'u':
+		case 'o':
+		case 'x':
+		case 'X':
+			switch (spec.length) {
+			case 'q': writer.putInteger(va_arg(ap, unsigned long long)); break;
+			case 'l': writer.putInteger(va_arg(ap, unsigned long)); break;
+			case 'j': writer.putInteger(va_arg(ap, uintmax_t)); break;
+			case 'z':
+			case 't': writer.putInteger(va_arg(ap, size_t)); break;
+			case 'H': writer.putInteger((unsigned char)va_arg(ap, unsigned)); break;
+			case 'h': writer.putInteger((unsigned short)va_arg(ap, unsigned)); break;
+			default: writer.putInteger(va_arg(ap, unsigned)); break;
+			}
+			break;
+		case 'c':
+			writer.putInteger(va_arg(ap, int));
+			break;
+		case 'e':
+		case 'E':
+		case 'f':
+		case 'F':
+		case 'g':
+		case 'G':
+		case 'a':
+		case 'A':
+			if (spec.length == 'L') {
+				writer.putDouble(va_arg(ap, long double));
+			} else {
+				writer.putDouble(va_arg(ap, double));
+			}
+			break;
+		case 's':
+			writer.putString(va_arg(ap, const char *));
+			break;
+		case 'p':
+			writer.putInteger((uintptr_t)va_arg(ap, void *));
+			break;
+		default:
+			// Not supported (e.g. %n), the rest of the format is rendered without arguments
+			return;
+		}
+	}
+}
+
+template <typename T>
+void append_formatted(std::string &out, const std::string &format, int stars, const int *star,
+		T value) {
+	char buff[LINELENG];
+	int r;
+	if (stars == 0) {
+		r = snprintf(buff, sizeof(buff), format.c_str(), value);
+	} else if (stars == 1) {
+		r = snprintf(buff, sizeof(buff), format.c_str(), star[0], value);
+	} else {
+		r = snprintf(buff, sizeof(buff), format.c_str(), star[0], star[1], value);
+	}
+	if (r > 0) {
+		out.append(buff, std::min<int>(r, sizeof(buff) - 1));
+	}
+}
+
+/*
+ * Renders the message in the same way as printf would do it with the original arguments.
+ */
+void render_message(std::string &out, const char *format, RecordReader &reader) {
+	std::string str;
+	for (const char *p = format; *p;) {
+		if (*p != '%') {
+			out.push_back(*p++);
+			continue;
+		}
+		if (p[1] == '%') {
+			out.push_back('%');
+			p += 2;
+			continue;
+		}
+		FormatSpec spec;
+		const char *next = parse_spec(p, spec);
+		int star[2] = {0, 0};
+		bool ok = true;
+		for (int i = 0; i < spec.stars && i < 2; ++i) {
+			int64_t value = 0;
+			ok = ok && reader.get(value);
+			star[i] = value;
+		}
+		std::string spec_format(spec.begin, spec.length_begin);
+		int64_t integer = 0;
+		double floating = 0;
+		switch (spec.conversion) {
+		case 'd':
+		case 'i':
+		case 'u':
+		case 'o':
+		case 'x':
+		case 'X':
+			ok = ok && reader.get(integer);
+			spec_format += "ll";
+			spec_format.push_back(spec.conversion);
+			if (ok) {
+				append_formatted(out, spec_format, spec.stars, star, (long long)integer);
+			}
+			break;
+		case 'c':
+			ok = ok && reader.get(integer);
+			spec_format.push_back(spec.conversion);
+			if (ok) {
+				append_formatted(out, spec_format, spec.stars, star, (int)integer);
+			}
+			break;
+		case 'e':
+		case 'E':
+		case 'f':
+		case 'F':
+		case 'g':
+		case 'G':
+		case 'a':
+		case 'A':
+			ok = ok && reader.get(floating);
+			spec_format.push_back(spec.conversion);
+			if (ok) {
+				append_formatted(out, spec_format, spec.stars, star, floating);
+			}
+			break;
+		case 's':
+			ok = ok && reader.getString(str);
+			spec_format.push_back(spec.conversion);
+			if (ok) {
+				append_formatted(out, spec_format, spec.stars, star, str.c_str());
+			}
+			break;
+		case 'p':
+			ok = ok && reader.get(integer);
+			spec_format.push_back(spec.conversion);
+			if (ok) {
+				append_formatted(out, spec_format, spec.stars, star, (void *)(uintptr_t)integer);
+			}
+			break;
+		default:
+			ok = false;
+			break;
+		}
+		if (!ok) {
+			out.append(spec.begin);
+			return;
+		}
+		p = next;
+	}
+}
+
+std::atomic<ThreadLog *> gThreadLogs(nullptr);
+thread_local ThreadLog *tThreadLog = nullptr;
+pthread_key_t gThreadLogKey;
+pthread_once_t gThreadLogKeyOnce = PTHREAD_ONCE_INIT;
+
+// Number of readers waiting for new records
+std::atomic<int> gWaitingReaders(0);
+std::mutex gReadersMutex;
+std::condition_variable gNewRecords;
+
+void release_thread_log(void *log) {
+	static_cast<ThreadLog *>(log)->in_use.store(false, std::memory_order_release);
+}
+
+void create_thread_log_key() {
+	eassert(pthread_key_create(&gThreadLogKey, release_thread_log) == 0);
+}
+
+/*
+ * Returns log of the calling thread. Logs are never freed, a log of a finished thread
+ * (with its records) is taken over by the next new thread.
+ */
+ThreadLog *thread_log() {
+	if (tThreadLog != nullptr) {
+		return tThreadLog;
+	}
+	ThreadLog *log;
+	for (log = gThreadLogs.load(std::memory_order_acquire); log != nullptr; log = log->next) {
+		bool expected = false;
+		if (log->in_use.compare_exchange_strong(expected, true)) {
+			break;
+		}
+	}
+	if (log == nullptr) {
+		log = new ThreadLog();
+		log->next = gThreadLogs.load(std::memory_order_relaxed);
+		while (!gThreadLogs.compare_exchange_weak(log->next, log)) {
+		}
+	}
+	pthread_once(&gThreadLogKeyOnce, create_thread_log_key);
+	pthread_setspecific(gThreadLogKey, log);
+	tThreadLog = log;
+	return log;
+}
+
+void oplog_put(const struct LizardClient::Context *ctx, const char *format, va_list ap) {
+	uint8_t buffer[kMaxRecordSize];
+	RecordWriter writer(buffer);
+	capture_arguments(writer, format, ap);
+
+	RecordHeader header;
+	header.size = writer.size();
+	header.latency_us = kNoLatency;
+	timespec ts;
+	clock_gettime(CLOCK_REALTIME, &ts);
+	header.timestamp_us = (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+	header.format = format;
+	header.has_context = (ctx != nullptr);
+	header.uid = ctx ? ctx->uid : 0;
+	header.gid = ctx ? ctx->gid : 0;
+	header.pid = ctx ? ctx->pid : 0;
+	if (ctx && ctx->start_time != SteadyTimePoint()) {
+		auto latency = std::chrono::duration_cast<std::chrono::microseconds>(
+				SteadyClock::now() - ctx->start_time).count();
+		header.latency_us = std::min<int64_t>(std::max<int64_t>(latency, 0), kNoLatency - 1);
+	}
+	memcpy(buffer, &header, sizeof(header));
+
+	thread_log()->append(buffer, header.size);
+	if (gWaitingReaders.load(std::memory_order_relaxed) > 0) {
+		gNewRecords.notify_all();
+	}
 }
 
-static void get_time(timeval &tv, tm &ltime) {
-	gettimeofday(&tv, nullptr);
+struct OplogHandle {
+	OplogHandle() : refcount(1), text_pos(0) {
+	}
+
+	uint32_t refcount;
+	std::map<const ThreadLog *, uint64_t> positions; // next record to read in each log
+	std::string text; // rendered records
+	std::size_t text_pos; // beginning of the part of text not yet returned
+};
+
+unsigned long gNextHandle = 1;
+std::map<unsigned long, OplogHandle> gHandles;
+
+// Cache of localtime for the current hour (used under gReadersMutex)
+time_t gConvTmHour = std::numeric_limits<time_t>::max(); // enforce update on first use
+struct tm gConvTm;
+
+void get_time(time_t seconds, tm &ltime) {
 	static constexpr time_t secs_per_hour = 60 * 60;
-	time_t hour = tv.tv_sec / secs_per_hour;
-	unsigned secs_this_hour = tv.tv_sec % secs_per_hour;
+	time_t hour = seconds / secs_per_hour;
+	unsigned secs_this_hour = seconds % secs_per_hour;
 
-	pthread_mutex_lock(&timelock);
 	if (hour != gConvTmHour) {
 		gConvTmHour = hour;
 		time_t convts = hour * secs_per_hour;
 		localtime_r(&convts, &gConvTm);
 	}
 	ltime = gConvTm;
-	pthread_mutex_unlock(&timelock);
-
-	assert(ltime.tm_sec == 0);
-	assert(ltime.tm_min == 0);
-
 	ltime.tm_sec = secs_this_hour % 60;
 	ltime.tm_min = secs_this_hour / 60;
 }
 
-void oplog_printf(const struct LizardClient::Context &ctx,const char *format,...) {
-	struct timeval tv;
-	struct tm ltime;
-	va_list ap;
-	int r, leng = 0;
-	char buff[LINELENG];
+void render_record(std::string &out, const uint8_t *data) {
+	RecordHeader header;
+	memcpy(&header, data, sizeof(header));
+	time_t seconds = header.timestamp_us / 1000000;
+	tm ltime;
+	get_time(seconds, ltime);
 
-	get_time(tv, ltime);
-	r  = snprintf(buff, LINELENG, "%llu %02u.%02u %02u:%02u:%02u.%06u: uid:%u gid:%u pid:%u cmd:",
-		(unsigned long long)tv.tv_sec, ltime.tm_mon + 1, ltime.tm_mday, ltime.tm_hour, ltime.tm_min, ltime.tm_sec, (unsigned)tv.tv_usec,
-		(unsigned)ctx.uid, (unsigned)ctx.gid, (unsigned)ctx.pid);
-	if (r < 0) {
-		return;
+	std::size_t line_begin = out.size();
+	char buff[LINELENG];
+	int r;
+	if (header.has_context) {
+		r = snprintf(buff, LINELENG, "%llu %02u.%02u %02u:%02u:%02u.%06u: uid:%u gid:%u pid:%u cmd:",
+			(unsigned long long)seconds, ltime.tm_mon + 1, ltime.tm_mday, ltime.tm_hour, ltime.tm_min, ltime.tm_sec,
+			(unsigned)(header.timestamp_us % 1000000), header.uid, header.gid, header.pid);
+	} else {
+		r = snprintf(buff, LINELENG, "%llu %02u.%02u %02u:%02u:%02u.%06u: cmd:",
+			(unsigned long long)seconds, ltime.tm_mon + 1, ltime.tm_mday, ltime.tm_hour, ltime.tm_min, ltime.tm_sec,
+			(unsigned)(header.timestamp_us % 1000000));
 	}
-	leng = std::min(LINELENG - 1, r);
-
-	va_start(ap, format);
-	r = vsnprintf(buff + leng, LINELENG - leng, format, ap);
-	va_end(ap);
 	if (r < 0) {
 		return;
 	}
-	leng += r;
-
-	leng = std::min(LINELENG - 1, leng);
-	buff[leng++] = '\n';
-	oplog_put((uint8_t*)buff, leng);
+	out.append(buff, std::min(LINELENG - 1, r));
+	RecordReader reader(data, header.size);
+	render_message(out, header.format, reader);
+	if (header.latency_us != kNoLatency) {
+		r = snprintf(buff, LINELENG, " [%uus]", header.latency_us);
+		out.append(buff, std::max(r, 0));
+	}
+	if (out.size() - line_begin > LINELENG - 1) {
+		out.resize(line_begin + LINELENG - 1);
+	}
+	out.push_back('\n');
 }
 
-void oplog_printf(const char *format, ...) {
-	struct timeval tv;
-	struct tm ltime;
-	va_list ap;
-	int r, leng = 0;
-	char buff[LINELENG];
+/*
+ * Renders all records which appeared in logs since the previous call, in order of
+ * their timestamps.
+ */
+void collect_records(OplogHandle &handle) {
+	std::vector<uint8_t> records;
+	std::vector<std::pair<uint64_t, std::size_t>> order; // (timestamp, offset in records)
+	for (ThreadLog *log = gThreadLogs.load(std::memory_order_acquire); log != nullptr;
+			log = log->next) {
+		auto it = handle.positions.find(log);
+		uint64_t pos = (it != handle.positions.end())
+				? it->second : log->tail.load(std::memory_order_acquire);
+		uint64_t head = log->head.load(std::memory_order_acquire);
+		while (pos < head) {
+			RecordHeader header;
+			log->copyOut(pos, (uint8_t *)&header, sizeof(header));
+			bool valid = header.size >= sizeof(RecordHeader) && header.size <= kMaxRecordSize
+					&& pos + header.size <= head;
+			std::size_t offset = records.size();
+			if (valid) {
+				records.resize(offset + header.size);
+				log->copyOut(pos, records.data() + offset, header.size);
+			}
+			std::atomic_thread_fence(std::memory_order_acquire);
+			uint64_t tail = log->tail.load(std::memory_order_relaxed);
+			if (tail > pos) {
+				// The record was overwritten while it was being copied
+				records.resize(offset);
+				pos = tail;
+				continue;
+			}
+			if (!valid) {
+				pos = head;
+				break;
+			}
+			order.emplace_back(header.timestamp_us, offset);
+			pos += header.size;
+		}
+		handle.positions[log] = pos;
+	}
+	std::stable_sort(order.begin(), order.end(),
+			[](const std::pair<uint64_t, std::size_t> &a, const std::pair<uint64_t, std::size_t> &b) {
+				return a.first < b.first;
+			});
+	handle.text.erase(0, handle.text_pos);
+	handle.text_pos = 0;
+	for (const auto &entry : order) {
+		render_record(handle.text, records.data() + entry.second);
+	}
+}
 
-	get_time(tv, ltime);
-	r = snprintf(buff, LINELENG, "%llu %02u.%02u %02u:%02u:%02u.%06u: cmd:",
-		(unsigned long long)tv.tv_sec, ltime.tm_mon + 1, ltime.tm_mday, ltime.tm_hour, ltime.tm_min, ltime.tm_sec, (unsigned)tv.tv_usec);
-	if (r < 0) {
-		return;
+void release_handle(unsigned long fh) {
+	auto it = gHandles.find(fh);
+	if (it != gHandles.end() && --it->second.refcount == 0) {
+		gHandles.erase(it);
 	}
-	leng = std::min(LINELENG - 1, r);
+}
+
+} // anonymous namespace
 
+void oplog_printf(const struct LizardClient::Context &ctx,const char *format,...) {
+	va_list ap;
 	va_start(ap, format);
-	r = vsnprintf(buff + leng, LINELENG - leng, format, ap);
+	oplog_put(&ctx, format, ap);
 	va_end(ap);
-	if (r < 0) {
-		return;
-	}
-	leng += r;
+}
 
-	leng = std::min(LINELENG - 1, leng);
-	buff[leng++] = '\n';
-	oplog_put((uint8_t*)buff, leng);
+void oplog_printf(const char *format, ...) {
+	va_list ap;
+	va_start(ap, format);
+	oplog_put(nullptr, format, ap);
+	va_end(ap);
 }
 
 unsigned long oplog_newhandle(int hflag) {
-	fhentry *fhptr;
-	uint32_t bpos;
-
-	pthread_mutex_lock(&opbufflock);
-	fhptr = (fhentry*) malloc(sizeof(fhentry));
-	fhptr->fh = nextfh++;
-	fhptr->refcount = 1;
-	if (hflag) {
-		if (writepos<MAXHISTORYSIZE) {
-			fhptr->readpos = 0;
-		} else {
-			fhptr->readpos = writepos - MAXHISTORYSIZE;
-			bpos = fhptr->readpos%OPBUFFSIZE;
-			while (fhptr->readpos < writepos) {
-				if (opbuff[bpos]=='\n') {
-					break;
-				}
-				bpos++;
-				bpos%=OPBUFFSIZE;
-				fhptr->readpos++;
-			}
-			if (fhptr->readpos<writepos) {
-				fhptr->readpos++;
-			}
+	std::unique_lock<std::mutex> lock(gReadersMutex);
+	unsigned long fh = gNextHandle++;
+	OplogHandle &handle = gHandles[fh];
+	if (!hflag) {
+		// Only records added later are returned
+		for (ThreadLog *log = gThreadLogs.load(std::memory_order_acquire); log != nullptr;
+				log = log->next) {
+			handle.positions[log] = log->head.load(std::memory_order_acquire);
 		}
-	} else {
-		fhptr->readpos = writepos;
 	}
-	fhptr->next = fhhead;
-	fhhead = fhptr;
-	pthread_mutex_unlock(&opbufflock);
-	return fhptr->fh;
+	return fh;
 }
 
 void oplog_releasehandle(unsigned long fh) {
-	fhentry **fhpptr,*fhptr;
-	pthread_mutex_lock(&opbufflock);
-	fhpptr = &fhhead;
-	while ((fhptr = *fhpptr)) {
-		if (fhptr->fh==fh) {
-			fhptr->refcount--;
-			if (fhptr->refcount==0) {
-				*fhpptr = fhptr->next;
-				free(fhptr);
-			} else {
-				fhpptr = &(fhptr->next);
-			}
-		} else {
-			fhpptr = &(fhptr->next);
-		}
-	}
-	pthread_mutex_unlock(&opbufflock);
+	std::unique_lock<std::mutex> lock(gReadersMutex);
+	release_handle(fh);
 }
 
+// Returns with gReadersMutex locked, it is unlocked by oplog_releasedata
 void oplog_getdata(unsigned long fh,uint8_t **buff,uint32_t *leng,uint32_t maxleng) {
-	fhentry *fhptr;
-	uint32_t bpos;
-	struct timeval tv;
-	struct timespec ts;
-
-	pthread_mutex_lock(&opbufflock);
-	for (fhptr=fhhead ; fhptr && fhptr->fh != fh ; fhptr=fhptr->next) {
-	}
-	if (fhptr==NULL) {
+	std::unique_lock<std::mutex> lock(gReadersMutex);
+	auto it = gHandles.find(fh);
+	if (it == gHandles.end()) {
 		*buff = NULL;
 		*leng = 0;
+		lock.release();
 		return;
 	}
-	fhptr->refcount++;
-	while (fhptr->readpos>=writepos) {
-		gettimeofday(&tv,NULL);
-		ts.tv_sec = tv.tv_sec+1;
-		ts.tv_nsec = tv.tv_usec*1000;
-		waiting=1;
-		if (pthread_cond_timedwait(&nodata,&opbufflock,&ts)==ETIMEDOUT) {
+	OplogHandle &handle = it->second;
+	handle.refcount++;
+	Timeout timeout(std::chrono::seconds(1));
+	while (handle.text_pos >= handle.text.size()) {
+		collect_records(handle);
+		if (handle.text_pos < handle.text.size()) {
+			break;
+		}
+		if (timeout.expired()) {
 			*buff = (uint8_t*)"#\n";
 			*leng = 2;
+			lock.release();
 			return;
 		}
+		// Writers notify only if they see a waiting reader, so wake up periodically anyway
+		gWaitingReaders++;
+		gNewRecords.wait_for(lock, std::chrono::milliseconds(50));
+		gWaitingReaders--;
 	}
-	bpos = fhptr->readpos%OPBUFFSIZE;
-	*leng = (writepos-(fhptr->readpos));
-	*buff = opbuff+bpos;
-	if ((*leng)>(OPBUFFSIZE-bpos)) {
-		(*leng) = (OPBUFFSIZE-bpos);
-	}
-	if ((*leng)>maxleng) {
-		(*leng) = maxleng;
-	}
-	fhptr->readpos+=(*leng);
+	*buff = (uint8_t*)&handle.text[handle.text_pos];
+	*leng = std::min<std::size_t>(handle.text.size() - handle.text_pos, maxleng);
+	handle.text_pos += *leng;
+	lock.release();
 }
 
 void oplog_releasedata(unsigned long fh) {
-	fhentry **fhpptr,*fhptr;
-	fhpptr = &fhhead;
-	while ((fhptr = *fhpptr)) {
-		if (fhptr->fh==fh) {
-			fhptr->refcount--;
-			if (fhptr->refcount==0) {
-				*fhpptr = fhptr->next;
-				free(fhptr);
-			} else {
-				fhpptr = &(fhptr->next);
-			}
-		} else {
-			fhpptr = &(fhptr->next);
-		}
-	}
-	pthread_mutex_unlock(&opbufflock);
+	release_handle(fh);
+	gReadersMutex.unlock();
 }
@@ -0,0 +1,122 @@
+/*
+   Copyright 2017 Skytechnology sp. z o.o.
+
+   This file is part of LizardFS.
+
+   LizardFS is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, version 3.
+
+   LizardFS is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with LizardFS. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "common/platform.h"
+#include "mount/oplog.h"
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <gtest/gtest.h>
+
+// Reads everything what is available in the log, at most 'max_reads' chunks
+static std::string read_log(unsigned long fh, int max_reads = 1000) {
+	std::string result;
+	for (int i = 0; i < max_reads; ++i) {
+		uint8_t *buff;
+		uint32_t leng;
+		oplog_getdata(fh, &buff, &leng, 4096);
+		std::string data((char *)buff, leng);
+		oplog_releasedata(fh);
+		if (data == "#\n") {
+			break;
+		}
+		result += data;
+	}
+	return result;
+}
+
+static std::string strip_prefix(const std::string &line) {
+	auto pos = line.find("cmd:");
+	return pos == std::string::npos ? line : line.substr(pos + 4);
+}
+
+TEST(Oplog, MessagesAreFormattedLikePrintf) {
+	unsigned long fh = oplog_newhandle(0);
+	LizardClient::Context ctx(1000, 100, 12345, 0);
+	oplog_printf(ctx, "read (%lu,%llu,%d): %s %04o %#X %.1f %5.*s %c%%",
+			(unsigned long)7, 1ULL << 40, -5, "OK", 0755, 255U, 2.25, 2, "abc", 'x');
+	// volatile, so that the compiler doesn't warn about passing null for %s
+	const char *volatile missing_name = nullptr;
+	oplog_printf("lookup (%u,%s): %s", 1U, missing_name, "ENOENT");
+	std::string log = read_log(fh, 1);
+	oplog_releasehandle(fh);
+
+	auto newline = log.find('\n');
+	ASSERT_NE(std::string::npos, newline);
+	std::string first = log.substr(0, newline);
+	std::string second = log.substr(newline + 1);
+	EXPECT_NE(std::string::npos, first.find(" uid:1000 gid:100 pid:12345 cmd:"));
+	EXPECT_EQ("read (7,1099511627776,-5): OK 0755 0XFF 2.2    ab x%", strip_prefix(first));
+	EXPECT_EQ(std::string::npos, second.find("uid:"));
+	EXPECT_EQ("lookup (1,(null)): ENOENT\n", strip_prefix(second));
+}
+
+TEST(Oplog, LatencyIsRecorded) {
+	unsigned long fh = oplog_newhandle(0);
+	LizardClient::Context ctx(0, 0, 1, 0);
+	ctx.start_time = SteadyClock::now() - std::chrono::milliseconds(5);
+	oplog_printf(ctx, "getattr (%lu): OK", 1UL);
+	std::string log = read_log(fh, 1);
+	oplog_releasehandle(fh);
+
+	auto begin = log.find(" [");
+	ASSERT_NE(std::string::npos, begin);
+	EXPECT_LE(5000, std::stoi(log.substr(begin + 2)));
+	EXPECT_EQ("us]\n", log.substr(log.size() - 4));
+}
+
+TEST(Oplog, HistoryKeepsNewestRecords) {
+	std::thread writer([]() {
+		for (int i = 0; i < 100000; ++i) {
+			oplog_printf("write (%d): OK", i);
+		}
+	});
+	writer.join();
+
+	unsigned long fh = oplog_newhandle(1);
+	std::string log = read_log(fh);
+	oplog_releasehandle(fh);
+	EXPECT_NE(std::string::npos, log.find("cmd:write (99999): OK\n"));
+	EXPECT_EQ(std::string::npos, log.find("cmd:write (0): OK\n"));
+	// Records of the writer are complete and ordered
+	int previous = -1;
+	for (std::size_t pos = log.find("cmd:write ("); pos != std::string::npos;
+			pos = log.find("cmd:write (", pos + 1)) {
+		int current = std::stoi(log.substr(pos + 11));
+		EXPECT_EQ(previous < 0 ? current : previous + 1, current);
+		EXPECT_EQ(0, log.compare(log.find(')', pos), 6, "): OK\n"));
+		previous = current;
+	}
+}
+
+TEST(Oplog, WritingSpeed) {
+	LizardClient::Context ctx(1000, 100, 12345, 0);
+	const int count = 1000000;
+	auto start = std::chrono::steady_clock::now();
+	for (int i = 0; i < count; ++i) {
+		oplog_printf(ctx, "read (%lu,%llu,%llu): OK (%lu)", (unsigned long)i,
+				(unsigned long long)i * 65536, 65536ULL, 65536UL);
+	}
+	auto duration = std::chrono::steady_clock::now() - start;
+	std::cout << "oplog_printf: "
+	          << std::chrono::duration_cast<std::chrono::nanoseconds>(duration).count() / count
+	          << " ns per call" << std::endl;
+}
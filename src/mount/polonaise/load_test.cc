@@ -0,0 +1,357 @@
+/*
+   Copyright 2017 Skytechnology sp. z o.o.
+
+   This file is part of LizardFS.
+
+   LizardFS is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, version 3.
+
+   LizardFS is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with LizardFS. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * Load test of the Polonaise server.
+ *
+ * Usage:
+ *  lizardfs-polonaise-load-test [-c connections] [-d pipeline depth] [-t seconds]
+ *                               [-w worker threads] [-l backend latency in us] [-j client threads]
+ *
+ * Runs NonblockingServer in-process with a fake backend, which answers getattr and lookup
+ * after the given latency instead of calling LizardClient. Opens the given number of
+ * connections to it, keeps 'pipeline depth' requests in flight on each of them and prints
+ * number of operations per second and percentiles of latency of requests.
+ */
+
+#include "common/platform.h"
+
+#include <sys/resource.h>
+#include <unistd.h>
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include <boost/make_shared.hpp>
+#include <polonaise/polonaise_constants.h>
+#include <polonaise/Polonaise.h>
+#include <thrift/protocol/TBinaryProtocol.h>
+#include <thrift/transport/TBufferTransports.h>
+
+#include "common/sockets.h"
+#include "common/time_utils.h"
+#include "mount/polonaise/nonblocking_server.h"
+
+using namespace ::apache::thrift;
+using namespace ::apache::thrift::protocol;
+using namespace ::apache::thrift::transport;
+using namespace ::polonaise;
+
+static const uint32_t kMaxMessageSize = 1 << 20;
+
+/**
+ * Backend which answers metadata requests after a fixed delay, like LizardClient waiting
+ * for a reply from the master would
+ */
+class FakeHandler : public PolonaiseIfNull {
+public:
+	explicit FakeHandler(uint32_t latencyUs) : latencyUs_(latencyUs) {}
+
+	void getattr(AttributesReply& _return, const Context&, const Inode inode,
+			const Descriptor) override {
+		wait();
+		_return.attributes.inode = inode;
+		_return.attributes.type = FileType::kRegular;
+		_return.attributes.nlink = 1;
+	}
+
+	void lookup(EntryReply& _return, const Context&, const Inode inode,
+			const std::string&) override {
+		wait();
+		_return.inode = inode + 1;
+		_return.attributes.inode = inode + 1;
+		_return.attributes.type = FileType::kRegular;
+	}
+
+private:
+	void wait() {
+		if (latencyUs_ > 0) {
+			usleep(latencyUs_);
+		}
+	}
+
+	uint32_t latencyUs_;
+};
+
+struct ClientConnection {
+	int socket;
+	std::vector<uint8_t> input;
+	std::vector<uint8_t> output;
+	size_t outputSent;
+	int32_t nextSeqid;
+	std::unordered_map<int32_t, SteadyTimePoint> inFlight;
+};
+
+struct ClientStats {
+	std::vector<uint32_t> latenciesUs;
+	uint64_t errors = 0;
+};
+
+static void appendRequest(ClientConnection& connection) {
+	auto buffer = boost::make_shared<TMemoryBuffer>();
+	TBinaryProtocol protocol(buffer);
+	int32_t seqid = connection.nextSeqid++;
+	Context context;
+	Inode inode = 1 + seqid % 1000;
+	if (seqid % 2 == 0) {
+		Descriptor descriptor = g_polonaise_constants.kNullDescriptor;
+		Polonaise_getattr_pargs args;
+		args.context = &context;
+		args.inode = &inode;
+		args.descriptor = &descriptor;
+		protocol.writeMessageBegin("getattr", T_CALL, seqid);
+		args.write(&protocol);
+	} else {
+		std::string name = "file_" + std::to_string(seqid % 1000);
+		Polonaise_lookup_pargs args;
+		args.context = &context;
+		args.inode = &inode;
+		args.name = &name;
+		protocol.writeMessageBegin("lookup", T_CALL, seqid);
+		args.write(&protocol);
+	}
+	protocol.writeMessageEnd();
+
+	uint8_t *data;
+	uint32_t size;
+	buffer->getBuffer(&data, &size);
+	connection.output.insert(connection.output.end(), data, data + size);
+	connection.inFlight[seqid] = SteadyClock::now();
+}
+
+/**
+ * Reads replies available on a connection and sends a new request for each of them
+ * \return false if the connection failed
+ */
+static bool readReplies(ClientConnection& connection, bool sendMore, ClientStats& stats) {
+	uint8_t buffer[64 * 1024];
+	int32_t received = tcprecv(connection.socket, buffer, sizeof(buffer));
+	if (received <= 0) {
+		return received < 0 && errno == EAGAIN;
+	}
+	connection.input.insert(connection.input.end(), buffer, buffer + received);
+
+	uint32_t offset = 0;
+	while (offset < connection.input.size()) {
+		uint32_t length = thriftMessageLength(connection.input.data() + offset,
+				connection.input.size() - offset, kMaxMessageSize);
+		if (length == 0) {
+			break;
+		}
+		auto reply = boost::make_shared<TMemoryBuffer>(connection.input.data() + offset, length);
+		TBinaryProtocol protocol(reply);
+		std::string name;
+		TMessageType type;
+		int32_t seqid;
+		protocol.readMessageBegin(name, type, seqid);
+		offset += length;
+
+		auto it = connection.inFlight.find(seqid);
+		if (it == connection.inFlight.end() || type != T_REPLY) {
+			stats.errors++;
+			continue;
+		}
+		stats.latenciesUs.push_back(std::chrono::duration_cast<std::chrono::microseconds>(
+				SteadyClock::now() - it->second).count());
+		connection.inFlight.erase(it);
+		if (sendMore) {
+			appendRequest(connection);
+		}
+	}
+	connection.input.erase(connection.input.begin(), connection.input.begin() + offset);
+	return true;
+}
+
+static bool writeRequests(ClientConnection& connection) {
+	while (connection.outputSent < connection.output.size()) {
+		int32_t sent = tcpsend(connection.socket, connection.output.data() + connection.outputSent,
+				connection.output.size() - connection.outputSent);
+		if (sent < 0) {
+			return errno == EAGAIN;
+		}
+		connection.outputSent += sent;
+	}
+	connection.output.clear();
+	connection.outputSent = 0;
+	return true;
+}
+
+static void clientLoop(std::vector<ClientConnection>& connections, uint32_t depth,
+		SteadyTimePoint end, ClientStats& stats) {
+	for (auto& connection : connections) {
+		for (uint32_t i = 0; i < depth; ++i) {
+			appendRequest(connection);
+		}
+	}
+	std::vector<pollfd> pdesc(connections.size());
+	while (true) {
+		bool sendMore = SteadyClock::now() < end;
+		bool waiting = false;
+		for (size_t i = 0; i < connections.size(); ++i) {
+			pdesc[i].fd = connections[i].socket;
+			pdesc[i].events = POLLIN;
+			pdesc[i].revents = 0;
+			if (connections[i].outputSent < connections[i].output.size()) {
+				pdesc[i].events |= POLLOUT;
+			}
+			waiting = waiting || !connections[i].inFlight.empty();
+		}
+		if (!sendMore && !waiting) {
+			return;
+		}
+		if (tcppoll(pdesc, 100) < 0 && errno != EINTR) {
+			perror("poll");
+			stats.errors++;
+			return;
+		}
+		for (size_t i = 0; i < connections.size(); ++i) {
+			bool ok = true;
+			if (pdesc[i].revents & (POLLIN | POLLHUP | POLLERR)) {
+				ok = readReplies(connections[i], sendMore, stats);
+			}
+			if (ok && connections[i].outputSent < connections[i].output.size()) {
+				ok = writeRequests(connections[i]);
+			}
+			if (!ok) {
+				std::cerr << "Connection failed" << std::endl;
+				stats.errors++;
+				return;
+			}
+		}
+	}
+}
+
+static void usage(const char *appname) {
+	std::cerr << "Usage: " << appname << " [-c connections] [-d pipeline depth] [-t seconds] "
+			<< "[-w worker threads] [-l backend latency in us] [-j client threads]" << std::endl;
+}
+
+int main(int argc, char **argv) {
+	uint32_t connectionCount = 2000;
+	uint32_t depth = 1;
+	uint32_t seconds = 10;
+	uint32_t latencyUs = 100;
+	uint32_t clientThreads = 2;
+	NonblockingServer::Options options;
+
+	int ch;
+	while ((ch = getopt(argc, argv, "c:d:t:w:l:j:h?")) != -1) {
+		switch (ch) {
+			case 'c':
+				connectionCount = strtoul(optarg, nullptr, 10);
+				break;
+			case 'd':
+				depth = strtoul(optarg, nullptr, 10);
+				break;
+			case 't':
+				seconds = strtoul(optarg, nullptr, 10);
+				break;
+			case 'w':
+				options.workerThreads = strtoul(optarg, nullptr, 10);
+				break;
+			case 'l':
+				latencyUs = strtoul(optarg, nullptr, 10);
+				break;
+			case 'j':
+				clientThreads = strtoul(optarg, nullptr, 10);
+				break;
+			default:
+				usage(argv[0]);
+				return 1;
+		}
+	}
+	if (connectionCount == 0 || depth == 0 || clientThreads == 0 || options.workerThreads == 0) {
+		usage(argv[0]);
+		return 1;
+	}
+	options.maxPipelinedRequests = depth;
+
+	// Both ends of every connection are in this process
+	struct rlimit limit;
+	if (getrlimit(RLIMIT_NOFILE, &limit) == 0 && limit.rlim_cur < limit.rlim_max) {
+		limit.rlim_cur = limit.rlim_max;
+		setrlimit(RLIMIT_NOFILE, &limit);
+	}
+
+	boost::shared_ptr<PolonaiseIf> handler(new FakeHandler(latencyUs));
+	boost::shared_ptr<TProcessor> processor(new PolonaiseProcessor(handler));
+	NonblockingServer server(processor, options);
+	server.listen(0);
+	std::thread serverThread([&server]() { server.serve(); });
+
+	std::vector<std::vector<ClientConnection>> connections(clientThreads);
+	for (uint32_t i = 0; i < connectionCount; ++i) {
+		int socket = tcpsocket();
+		if (socket < 0 || tcpnumconnect(socket, 0x7F000001, server.port()) < 0) {
+			perror("connect");
+			std::cerr << "Opened " << i << " connections, try raising the limit of open files"
+					<< std::endl;
+			server.stop();
+			serverThread.join();
+			return 1;
+		}
+		tcpnonblock(socket);
+		tcpnodelay(socket);
+		connections[i % clientThreads].push_back(ClientConnection{socket, {}, {}, 0, 0, {}});
+	}
+
+	std::vector<ClientStats> stats(clientThreads);
+	std::vector<std::thread> clients;
+	SteadyTimePoint start = SteadyClock::now();
+	SteadyTimePoint end = start + std::chrono::seconds(seconds);
+	for (uint32_t i = 0; i < clientThreads; ++i) {
+		clients.emplace_back(clientLoop, std::ref(connections[i]), depth, end, std::ref(stats[i]));
+	}
+	for (auto& client : clients) {
+		client.join();
+	}
+	double elapsed = std::chrono::duration<double>(SteadyClock::now() - start).count();
+	server.stop();
+	serverThread.join();
+	for (auto& threadConnections : connections) {
+		for (auto& connection : threadConnections) {
+			tcpclose(connection.socket);
+		}
+	}
+
+	std::vector<uint32_t> latencies;
+	uint64_t errors = 0;
+	for (auto& threadStats : stats) {
+		latencies.insert(latencies.end(), threadStats.latenciesUs.begin(),
+				threadStats.latenciesUs.end());
+		errors += threadStats.errors;
+	}
+	std::sort(latencies.begin(), latencies.end());
+	auto percentile = [&latencies](double percent) {
+		return latencies.empty() ? 0 : latencies[std::min<size_t>(latencies.size() - 1,
+				latencies.size() * percent / 100)] / 1000.;
+	};
+
+	printf("connections: %u, pipeline depth: %u, worker threads: %u, backend latency: %u us\n",
+			connectionCount, depth, options.workerThreads, latencyUs);
+	printf("operations: %zu, ops/s: %.0f, errors: %lu\n", latencies.size(),
+			latencies.size() / elapsed, (unsigned long)errors);
+	printf("latency: p50 %.3f ms, p99 %.3f ms, max %.3f ms\n", percentile(50), percentile(99),
+			latencies.empty() ? 0 : latencies.back() / 1000.);
+	return (errors > 0 || latencies.empty()) ? 1 : 0;
+}
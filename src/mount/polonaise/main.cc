@@ -42,6 +42,7 @@
 #include "mount/readdata.h"
 #include "mount/symlinkcache.h"
 #include "mount/writedata.h"
+#include "mount/polonaise/nonblocking_server.h"
 #include "mount/polonaise/options.h"
 #include "mount/polonaise/setup.h"
 
@@ -957,7 +958,11 @@ public:
 const uint32_t BigBufferedTransportFactory::kReadBufferSize;
 const uint32_t BigBufferedTransportFactory::kWriteBufferSize;
 
+#ifdef _WIN32
 static std::unique_ptr<apache::thrift::server::TThreadedServer> gServer;
+#else
+static std::unique_ptr<NonblockingServer> gServer;
+#endif
 static sig_atomic_t gTerminated = 0;
 
 void termhandle(int) {
@@ -1077,22 +1082,27 @@ int main (int argc, char **argv) {
 	using namespace ::apache::thrift::server;
 	boost::shared_ptr<PolonaiseHandler> handler(new PolonaiseHandler());
 	boost::shared_ptr<TProcessor> processor(new PolonaiseProcessor(handler));
+
+#ifdef _WIN32
 	boost::shared_ptr<TTransportFactory> transportFactory(new BigBufferedTransportFactory());
 	boost::shared_ptr<TProtocolFactory> protocolFactory(new TBinaryProtocolFactory());
 	boost::shared_ptr<TServerTransport> serverTransport;
 
-#ifdef _WIN32
 	if (gSetup.bind_port > 0) {
 		serverTransport.reset(new TServerSocket(gSetup.bind_port));
 	} else {
 		static const int kPipeBufferSize = 128 * 1024;
 		serverTransport.reset(new TPipeServer(gSetup.pipe_name, kPipeBufferSize));
 	}
-#else
-	serverTransport.reset(new TServerSocket(gSetup.bind_port));
-#endif
 
 	gServer.reset(new TThreadedServer(processor, serverTransport, transportFactory, protocolFactory));
+#else
+	NonblockingServer::Options serverOptions;
+	serverOptions.workerThreads = gSetup.worker_threads;
+	serverOptions.maxPipelinedRequests = gSetup.max_pipelined_requests;
+	gServer.reset(new NonblockingServer(processor, serverOptions));
+	gServer->listen(gSetup.bind_port);
+#endif
 
 	if (gTerminated == 0) {
 		gServer->serve();
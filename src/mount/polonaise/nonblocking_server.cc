@@ -0,0 +1,367 @@
+/*
+   Copyright 2017 Skytechnology sp. z o.o.
+
+   This file is part of LizardFS.
+
+   LizardFS is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, version 3.
+
+   LizardFS is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with LizardFS. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "common/platform.h"
+#include "mount/polonaise/nonblocking_server.h"
+
+#ifndef _WIN32
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <boost/make_shared.hpp>
+#include <thrift/protocol/TBinaryProtocol.h>
+#include <thrift/transport/TBufferTransports.h>
+#include <thrift/transport/TTransportException.h>
+
+#include "common/slogger.h"
+#include "common/sockets.h"
+
+using namespace ::apache::thrift;
+using namespace ::apache::thrift::protocol;
+using namespace ::apache::thrift::transport;
+
+#ifdef MSG_NOSIGNAL
+static const int kSendFlags = MSG_NOSIGNAL;
+#else
+static const int kSendFlags = 0;
+#endif
+
+static const uint32_t kReadSize = 64 * 1024;
+static const uint16_t kListenQueue = 1024;
+
+uint32_t thriftMessageLength(const uint8_t *data, uint32_t size, uint32_t maxSize) {
+	auto buffer = boost::make_shared<TMemoryBuffer>(const_cast<uint8_t *>(data), size);
+	TBinaryProtocol protocol(buffer, maxSize, maxSize, false, true);
+	try {
+		std::string name;
+		TMessageType type;
+		int32_t seqid;
+		protocol.readMessageBegin(name, type, seqid);
+		skip(protocol, T_STRUCT);
+		protocol.readMessageEnd();
+	} catch (TTransportException &ex) {
+		if (ex.getType() != TTransportException::END_OF_FILE) {
+			throw;
+		}
+		if (size >= maxSize) {
+			throw TProtocolException(TProtocolException::SIZE_LIMIT, "Message too long");
+		}
+		return 0;
+	}
+	return size - buffer->available_read();
+}
+
+NonblockingServer::NonblockingServer(boost::shared_ptr<TProcessor> processor,
+		const Options &options)
+		: processor_(processor),
+		  options_(options),
+		  listenSocket_(-1),
+		  port_(0),
+		  terminate_(0),
+		  nextConnectionId_(0),
+		  workersTerminate_(false) {
+	if (pipe(wakeupPipe_) < 0) {
+		throw TTransportException(TTransportException::UNKNOWN, "pipe failed", errno);
+	}
+	fcntl(wakeupPipe_[0], F_SETFL, O_NONBLOCK);
+	fcntl(wakeupPipe_[1], F_SETFL, O_NONBLOCK);
+}
+
+NonblockingServer::~NonblockingServer() {
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		workersTerminate_ = true;
+	}
+	requestsCond_.notify_all();
+	for (auto &worker : workers_) {
+		worker.join();
+	}
+	for (auto &idAndConnection : connections_) {
+		tcpclose(idAndConnection.second.socket);
+	}
+	if (listenSocket_ >= 0) {
+		tcpclose(listenSocket_);
+	}
+	close(wakeupPipe_[0]);
+	close(wakeupPipe_[1]);
+}
+
+void NonblockingServer::listen(int port) {
+	listenSocket_ = tcpsocket();
+	if (listenSocket_ < 0) {
+		throw TTransportException(TTransportException::NOT_OPEN, "socket failed", errno);
+	}
+	tcpreuseaddr(listenSocket_);
+	tcpnonblock(listenSocket_);
+	if (tcpnumlisten(listenSocket_, 0, port, kListenQueue) < 0) {
+		int err = errno;
+		tcpclose(listenSocket_);
+		listenSocket_ = -1;
+		throw TTransportException(TTransportException::NOT_OPEN,
+				"Could not listen on port " + std::to_string(port), err);
+	}
+	uint16_t boundPort;
+	tcpgetmyaddr(listenSocket_, nullptr, &boundPort);
+	port_ = boundPort;
+}
+
+void NonblockingServer::stop() {
+	terminate_ = 1;
+	// Only async-signal-safe calls here
+	char c = 0;
+	if (write(wakeupPipe_[1], &c, 1) < 0) {
+		// the pipe is full, so the loop will wake up anyway
+	}
+}
+
+void NonblockingServer::serve() {
+	for (uint32_t i = workers_.size(); i < options_.workerThreads; ++i) {
+		workers_.emplace_back(&NonblockingServer::workerLoop, this);
+	}
+
+	std::vector<pollfd> pdesc;
+	std::vector<uint64_t> pdescConnections;
+	while (terminate_ == 0) {
+		pdesc.clear();
+		pdescConnections.clear();
+		pdesc.push_back({wakeupPipe_[0], POLLIN, 0});
+		pdesc.push_back({listenSocket_, POLLIN, 0});
+		for (const auto &idAndConnection : connections_) {
+			const Connection &connection = idAndConnection.second;
+			short events = 0;
+			if (!connection.closing &&
+					connection.requestsInProgress < options_.maxPipelinedRequests) {
+				events |= POLLIN;
+			}
+			if (connection.outputSent < connection.output.size()) {
+				events |= POLLOUT;
+			}
+			if (events != 0) {
+				pdesc.push_back({connection.socket, events, 0});
+				pdescConnections.push_back(idAndConnection.first);
+			}
+		}
+
+		if (tcppoll(pdesc, 1000) < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+			lzfs_pretty_errlog(LOG_ERR, "poll error");
+			break;
+		}
+
+		if (pdesc[0].revents & POLLIN) {
+			char buffer[256];
+			while (read(wakeupPipe_[0], buffer, sizeof(buffer)) > 0) {
+			}
+		}
+		collectReplies();
+		if (pdesc[1].revents & POLLIN) {
+			acceptConnections();
+		}
+		for (size_t i = 2; i < pdesc.size(); ++i) {
+			uint64_t id = pdescConnections[i - 2];
+			auto it = connections_.find(id);
+			if (it == connections_.end()) {
+				continue;
+			}
+			Connection &connection = it->second;
+			bool ok = true;
+			if (pdesc[i].revents & (POLLIN | POLLHUP | POLLERR)) {
+				ok = readRequests(id, connection);
+			}
+			if (ok && (pdesc[i].revents & POLLOUT)) {
+				ok = writeReplies(connection);
+			}
+			if (!ok || (connection.closing && connection.requestsInProgress == 0 &&
+					connection.outputSent == connection.output.size())) {
+				closeConnection(id);
+			}
+		}
+	}
+}
+
+void NonblockingServer::acceptConnections() {
+	while (true) {
+		int socket = tcpaccept(listenSocket_);
+		if (socket < 0) {
+			if (errno != EAGAIN && errno != EWOULDBLOCK && errno != ECONNABORTED) {
+				lzfs_pretty_errlog(LOG_WARNING, "accept error");
+			}
+			return;
+		}
+		tcpnonblock(socket);
+		tcpnodelay(socket);
+		Connection &connection = connections_[nextConnectionId_++];
+		connection.socket = socket;
+		connection.outputSent = 0;
+		connection.requestsInProgress = 0;
+		connection.closing = false;
+	}
+}
+
+bool NonblockingServer::readRequests(uint64_t id, Connection &connection) {
+	// Reading more when a long message is being received keeps the cost of looking for
+	// its end linear in its length
+	size_t oldSize = connection.input.size();
+	uint32_t readSize = std::max<size_t>(kReadSize, oldSize);
+	connection.input.resize(oldSize + readSize);
+	int32_t received = tcprecv(connection.socket, connection.input.data() + oldSize, readSize);
+	if (received <= 0) {
+		connection.input.resize(oldSize);
+		if (received < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)) {
+			return true;
+		}
+		// Send replies to requests which are already being processed
+		connection.closing = true;
+		return connection.requestsInProgress > 0;
+	}
+	connection.input.resize(oldSize + received);
+
+	uint32_t offset = 0;
+	std::vector<Request> newRequests;
+	try {
+		while (offset < connection.input.size()) {
+			uint32_t length = thriftMessageLength(connection.input.data() + offset,
+					connection.input.size() - offset, options_.maxMessageSize);
+			if (length == 0) {
+				break;
+			}
+			newRequests.push_back({id, std::vector<uint8_t>(connection.input.begin() + offset,
+					connection.input.begin() + offset + length)});
+			offset += length;
+		}
+	} catch (TException &ex) {
+		lzfs_pretty_syslog(LOG_WARNING, "polonaise: invalid request: %s", ex.what());
+		return false;
+	}
+	connection.input.erase(connection.input.begin(), connection.input.begin() + offset);
+
+	if (!newRequests.empty()) {
+		connection.requestsInProgress += newRequests.size();
+		std::lock_guard<std::mutex> lock(mutex_);
+		for (auto &request : newRequests) {
+			requests_.push_back(std::move(request));
+		}
+	}
+	if (newRequests.size() == 1) {
+		requestsCond_.notify_one();
+	} else if (newRequests.size() > 1) {
+		requestsCond_.notify_all();
+	}
+	return true;
+}
+
+bool NonblockingServer::writeReplies(Connection &connection) {
+	while (connection.outputSent < connection.output.size()) {
+		int32_t sent = tcpsend(connection.socket, connection.output.data() + connection.outputSent,
+				connection.output.size() - connection.outputSent, kSendFlags);
+		if (sent < 0) {
+			if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR) {
+				return true;
+			}
+			return false;
+		}
+		connection.outputSent += sent;
+	}
+	connection.output.clear();
+	connection.outputSent = 0;
+	return true;
+}
+
+void NonblockingServer::collectReplies() {
+	std::vector<Reply> replies;
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		replies.swap(replies_);
+	}
+	for (Reply &reply : replies) {
+		auto it = connections_.find(reply.connectionId);
+		if (it == connections_.end()) {
+			continue;
+		}
+		Connection &connection = it->second;
+		connection.requestsInProgress--;
+		if (reply.failed) {
+			connection.closing = true;
+		}
+		connection.output.insert(connection.output.end(), reply.message.begin(),
+				reply.message.end());
+		// Try to send right away, poll is needed only when the socket buffer is full
+		if (!writeReplies(connection) || (connection.closing &&
+				connection.requestsInProgress == 0 && connection.output.empty())) {
+			closeConnection(reply.connectionId);
+		}
+	}
+}
+
+void NonblockingServer::closeConnection(uint64_t id) {
+	auto it = connections_.find(id);
+	tcpclose(it->second.socket);
+	connections_.erase(it);
+}
+
+void NonblockingServer::workerLoop() {
+	while (true) {
+		Request request;
+		{
+			std::unique_lock<std::mutex> lock(mutex_);
+			requestsCond_.wait(lock, [this]() { return workersTerminate_ || !requests_.empty(); });
+			if (workersTerminate_) {
+				return;
+			}
+			request = std::move(requests_.front());
+			requests_.pop_front();
+		}
+
+		Reply reply{request.connectionId, std::string(), false};
+		try {
+			auto input = boost::make_shared<TMemoryBuffer>(request.message.data(),
+					request.message.size());
+			auto output = boost::make_shared<TMemoryBuffer>();
+			processor_->process(boost::make_shared<TBinaryProtocol>(input),
+					boost::make_shared<TBinaryProtocol>(output), nullptr);
+			uint8_t *data;
+			uint32_t size;
+			output->getBuffer(&data, &size);
+			reply.message.assign(reinterpret_cast<char *>(data), size);
+		} catch (TException &ex) {
+			lzfs_pretty_syslog(LOG_WARNING, "polonaise: processing of request failed: %s",
+					ex.what());
+			reply.failed = true;
+		}
+
+		bool wakeup;
+		{
+			std::lock_guard<std::mutex> lock(mutex_);
+			wakeup = replies_.empty();
+			replies_.push_back(std::move(reply));
+		}
+		if (wakeup) {
+			char c = 0;
+			if (write(wakeupPipe_[1], &c, 1) < 0) {
+				// the pipe is full, so the loop will wake up anyway
+			}
+		}
+	}
+}
+
+#endif // _WIN32
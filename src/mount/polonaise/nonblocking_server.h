@@ -0,0 +1,139 @@
+/*
+   Copyright 2017 Skytechnology sp. z o.o.
+
+   This file is part of LizardFS.
+
+   LizardFS is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, version 3.
+
+   LizardFS is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with LizardFS. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+#include "common/platform.h"
+
+#ifndef _WIN32
+
+#include <signal.h>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include <boost/shared_ptr.hpp>
+#include <thrift/TProcessor.h>
+
+/**
+ * Returns length of the first Thrift binary protocol message in a buffer
+ * \param data received bytes
+ * \param size number of received bytes
+ * \param maxSize limit of length of a message
+ * \throw apache::thrift::TException when data isn't a valid message or the message is longer
+ *        than maxSize
+ * \return length of the message or 0 if it isn't received completely yet
+ */
+uint32_t thriftMessageLength(const uint8_t *data, uint32_t size, uint32_t maxSize);
+
+/**
+ * Thrift server which handles all connections in a single event loop and processes
+ * requests in a bounded pool of worker threads.
+ *
+ * Messages are framed by parsing the binary protocol, so clients using unframed transports
+ * are served as by TThreadedServer. A client may send many requests without waiting for
+ * replies, they are processed in parallel and replies are sent in order of completion.
+ */
+class NonblockingServer {
+public:
+	struct Options {
+		Options() : workerThreads(32), maxPipelinedRequests(16), maxMessageSize(64 << 20) {}
+
+		uint32_t workerThreads;          ///< Number of threads processing requests.
+		uint32_t maxPipelinedRequests;   ///< Requests of a connection processed at once.
+		uint32_t maxMessageSize;         ///< Longer requests close the connection.
+	};
+
+	NonblockingServer(boost::shared_ptr<apache::thrift::TProcessor> processor,
+			const Options &options);
+	~NonblockingServer();
+
+	/**
+	 * Start listening for connections
+	 * \param port TCP port, 0 chooses any free port
+	 * \throw apache::thrift::transport::TTransportException when listening fails
+	 */
+	void listen(int port);
+
+	/**
+	 * Port on which the server listens
+	 */
+	int port() const {
+		return port_;
+	}
+
+	/**
+	 * Serve connections until stop() is called
+	 */
+	void serve();
+
+	/**
+	 * Make serve() return, may be called from a signal handler
+	 */
+	void stop();
+
+private:
+	struct Connection {
+		int socket;
+		std::vector<uint8_t> input;
+		std::vector<uint8_t> output;
+		uint32_t outputSent;
+		uint32_t requestsInProgress;
+		bool closing;  ///< Close the connection when all replies are sent.
+	};
+
+	struct Request {
+		uint64_t connectionId;
+		std::vector<uint8_t> message;
+	};
+
+	struct Reply {
+		uint64_t connectionId;
+		std::string message;
+		bool failed;
+	};
+
+	void acceptConnections();
+	bool readRequests(uint64_t id, Connection &connection);
+	bool writeReplies(Connection &connection);
+	void collectReplies();
+	void workerLoop();
+	void closeConnection(uint64_t id);
+
+	boost::shared_ptr<apache::thrift::TProcessor> processor_;
+	Options options_;
+	int listenSocket_;
+	int port_;
+	int wakeupPipe_[2];
+	volatile sig_atomic_t terminate_;
+
+	uint64_t nextConnectionId_;
+	std::unordered_map<uint64_t, Connection> connections_;
+
+	std::vector<std::thread> workers_;
+	std::mutex mutex_;
+	std::condition_variable requestsCond_;
+	std::deque<Request> requests_;
+	std::vector<Reply> replies_;
+	bool workersTerminate_;
+};
+
+#endif // _WIN32
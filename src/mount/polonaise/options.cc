@@ -20,6 +20,7 @@
 #include "mount/polonaise/options.h"
 
 #include <iostream>
+#include <stdexcept>
 #include <boost/program_options.hpp>
 
 #include "mount/lizard_client.h"
@@ -145,6 +146,13 @@ void parse_command_line(int argc, char** argv, Setup& setup) {
 			("pipe-name,N",
 			        po::value<std::string>(&setup.pipe_name)->default_value("polonaise-server-1"),
 			        "name of pipe used for communication with client")
+#else
+			("worker-threads",
+				po::value<uint32_t>(&setup.worker_threads)->default_value(32),
+				"number of threads processing requests")
+			("max-pipelined-requests",
+				po::value<uint32_t>(&setup.max_pipelined_requests)->default_value(16),
+				"maximum number of requests of a single connection processed at once")
 #endif
 			;
 		po::variables_map vm;
@@ -155,6 +163,12 @@ void parse_command_line(int argc, char** argv, Setup& setup) {
 			std::cout << desc << std::endl;
 			exit(0);
 		}
+#ifndef _WIN32
+		if (setup.worker_threads == 0 || setup.max_pipelined_requests == 0) {
+			throw std::invalid_argument(
+					"worker-threads and max-pipelined-requests must be greater than 0");
+		}
+#endif
 	} catch (const std::exception& e) {
 		std::cerr << e.what() << std::endl;
 		exit (1);
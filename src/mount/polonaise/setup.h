@@ -45,6 +45,9 @@ struct Setup {
 	bool enable_acl;
 #ifdef _WIN32
 	std::string pipe_name;
+#else
+	uint32_t worker_threads;
+	uint32_t max_pipelined_requests;
 #endif
 };
 
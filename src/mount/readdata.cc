@@ -29,9 +29,12 @@
 #include <sys/time.h>
 #include <time.h>
 #include <unistd.h>
+#include <algorithm>
 #include <condition_variable>
 #include <map>
+#include <memory>
 #include <mutex>
+#include <string>
 
 #include "common/connection_pool.h"
 #include "common/datapack.h"
@@ -41,17 +44,23 @@
 #include "common/slogger.h"
 #include "common/sockets.h"
 #include "common/time_utils.h"
+#include "mount/chunk_location_cache.h"
 #include "mount/chunk_locator.h"
 #include "mount/chunk_reader.h"
+#include "mount/global_chunkserver_stats.h"
 #include "mount/mastercomm.h"
 #include "mount/readahead_adviser.h"
 #include "mount/readdata_cache.h"
+#include "mount/shared_block_cache.h"
+#include "mount/stats.h"
 #include "mount/tweaks.h"
 #include "protocol/MFSCommunication.h"
 
 #define USECTICK 333333
 #define REFRESHTICKS 15
 
+#define CHUNK_LOCATION_CACHE_SIZE 100000
+
 #define MAPBITS 10
 #define MAPSIZE (1<<(MAPBITS))
 #define MAPMASK (MAPSIZE-1)
@@ -61,28 +70,78 @@ static std::atomic<uint32_t> gReadaheadMaxWindowSize;
 static std::atomic<uint32_t> gCacheExpirationTime_ms;
 
 struct readrec {
-	ChunkReader reader;
-	ReadCache cache;
-	ReadaheadAdviser readahead_adviser;
+	std::mutex mutex;
+	std::vector<std::unique_ptr<ChunkReader>> idle_readers; // mutex
+	uint32_t readers_generation;    // mutex
+	ReadCache cache;                // mutex
+	ReadaheadAdviser readahead_adviser; // mutex
 	std::vector<uint8_t> read_buffer;
+	ChunkConnector& connector;
+	double bandwidth_overuse;
 	uint32_t inode;
 	uint8_t refreshCounter;         // gMutex
+	uint32_t activeReads;           // gMutex
 	bool expired;                   // gMutex
 	struct readrec *next;           // gMutex
 	struct readrec *mapnext;        // gMutex
 
 	readrec(uint32_t inode, ChunkConnector& connector, double bandwidth_overuse)
-			: reader(connector, bandwidth_overuse),
+			: readers_generation(0),
 			  cache(gCacheExpirationTime_ms),
 			  readahead_adviser(gCacheExpirationTime_ms, gReadaheadMaxWindowSize),
+			  connector(connector),
+			  bandwidth_overuse(bandwidth_overuse),
 			  inode(inode),
 			  refreshCounter(0),
+			  activeReads(0),
 			  expired(false),
 			  next(nullptr),
 			  mapnext(nullptr) {
 	}
 };
 
+/*
+ * Reads on one descriptor may run concurrently, so each of them borrows a ChunkReader
+ * from the pool of the readrec. Readers are reused, because they remember the location
+ * of the last read chunk. When locations have to be refreshed, the pool is emptied
+ * and readers borrowed earlier are not returned to it.
+ */
+class PooledChunkReader {
+public:
+	PooledChunkReader(readrec *rrec, bool refresh) : rrec_(rrec) {
+		std::unique_lock<std::mutex> lock(rrec_->mutex);
+		if (refresh) {
+			rrec_->idle_readers.clear();
+			rrec_->readers_generation++;
+		}
+		generation_ = rrec_->readers_generation;
+		if (!rrec_->idle_readers.empty()) {
+			reader_ = std::move(rrec_->idle_readers.back());
+			rrec_->idle_readers.pop_back();
+		}
+		lock.unlock();
+		if (!reader_) {
+			reader_.reset(new ChunkReader(rrec_->connector, rrec_->bandwidth_overuse));
+		}
+	}
+
+	~PooledChunkReader() {
+		std::unique_lock<std::mutex> lock(rrec_->mutex);
+		if (generation_ == rrec_->readers_generation) {
+			rrec_->idle_readers.push_back(std::move(reader_));
+		}
+	}
+
+	ChunkReader &operator*() {
+		return *reader_;
+	}
+
+private:
+	readrec *rrec_;
+	std::unique_ptr<ChunkReader> reader_;
+	uint32_t generation_;
+};
+
 static ConnectionPool gReadConnectionPool;
 static ChunkConnectorUsingPool gChunkConnector(gReadConnectionPool);
 static std::mutex gMutex;
@@ -93,9 +152,44 @@ static std::atomic<uint32_t> gChunkserverConnectTimeout_ms;
 static std::atomic<uint32_t> gChunkserverWaveReadTimeout_ms;
 static std::atomic<uint32_t> gChunkserverTotalReadTimeout_ms;
 static std::atomic<bool> gPrefetchXorStripes;
+static std::atomic<uint32_t> gHedgeReadPercentile;
 static bool readDataTerminate;
 static std::atomic<uint32_t> maxRetries;
 static double gBandwidthOveruse;
+static std::unique_ptr<SharedBlockCache> gSharedBlockCache;
+
+enum {
+	SHARED_CACHE_HITS,
+	SHARED_CACHE_MISSES,
+	SHARED_CACHE_EVICTIONS,
+	SHARED_CACHE_INVALIDATIONS,
+	SHARED_CACHE_BLOCKS,
+	SHARED_CACHE_BYTES,
+	SHARED_CACHE_STATNODES
+};
+static uint64_t *gSharedCacheStatsPtr[SHARED_CACHE_STATNODES];
+static SharedBlockCache::Stats gSharedCacheReportedStats;
+
+enum {
+	LOCATION_CACHE_HITS,
+	LOCATION_CACHE_MISSES,
+	LOCATION_CACHE_CHANGES,
+	LOCATION_CACHE_ENTRIES,
+	LOCATION_CACHE_STATNODES
+};
+static uint64_t *gLocationCacheStatsPtr[LOCATION_CACHE_STATNODES];
+static ChunkLocationCache::Stats gLocationCacheReportedStats;
+
+// Read latency histograms of chunkservers in .stats, used only by the delayed ops thread
+struct ChunkserverLatencyStatsPtr {
+	uint64_t *count;
+	uint64_t *sum_us;
+	uint64_t *buckets[LatencyHistogram::kBuckets];
+	uint64_t *latency_ewma_us;
+	uint64_t *bandwidth_ewma;
+	LatencyHistogram reported;
+};
+static std::map<NetworkAddress, ChunkserverLatencyStatsPtr> gChunkserverLatencyStatsPtr;
 
 const unsigned ReadaheadAdviser::kInitWindowSize;
 const unsigned ReadaheadAdviser::kDefaultWindowSizeLimit;
@@ -120,12 +214,109 @@ bool read_data_get_prefetchxorstripes() {
 	return gPrefetchXorStripes;
 }
 
+static void read_data_shared_cache_statsptr_init() {
+	statsnode *s = stats_get_subnode(NULL, "shared_cache", 0);
+	gSharedCacheStatsPtr[SHARED_CACHE_HITS] = stats_get_counterptr(stats_get_subnode(s, "hits", 0));
+	gSharedCacheStatsPtr[SHARED_CACHE_MISSES] = stats_get_counterptr(stats_get_subnode(s, "misses", 0));
+	gSharedCacheStatsPtr[SHARED_CACHE_EVICTIONS] = stats_get_counterptr(stats_get_subnode(s, "evictions", 0));
+	gSharedCacheStatsPtr[SHARED_CACHE_INVALIDATIONS] = stats_get_counterptr(stats_get_subnode(s, "invalidations", 0));
+	gSharedCacheStatsPtr[SHARED_CACHE_BLOCKS] = stats_get_counterptr(stats_get_subnode(s, "blocks", 1));
+	gSharedCacheStatsPtr[SHARED_CACHE_BYTES] = stats_get_counterptr(stats_get_subnode(s, "bytes", 1));
+	memset(&gSharedCacheReportedStats, 0, sizeof(gSharedCacheReportedStats));
+}
+
+// Counters of the cache are atomic, so they are copied to .stats periodically
+// instead of taking the stats lock for every block
+static void read_data_shared_cache_stats_update() {
+	SharedBlockCache::Stats stats = gSharedBlockCache->stats();
+	SharedBlockCache::Stats &reported = gSharedCacheReportedStats;
+	stats_lock();
+	*gSharedCacheStatsPtr[SHARED_CACHE_HITS] += stats.hits - reported.hits;
+	*gSharedCacheStatsPtr[SHARED_CACHE_MISSES] += stats.misses - reported.misses;
+	*gSharedCacheStatsPtr[SHARED_CACHE_EVICTIONS] += stats.evictions - reported.evictions;
+	*gSharedCacheStatsPtr[SHARED_CACHE_INVALIDATIONS] += stats.invalidations - reported.invalidations;
+	*gSharedCacheStatsPtr[SHARED_CACHE_BLOCKS] = stats.blocks;
+	*gSharedCacheStatsPtr[SHARED_CACHE_BYTES] = stats.bytes;
+	stats_unlock();
+	reported = stats;
+}
+
+static void read_data_location_cache_statsptr_init() {
+	statsnode *s = stats_get_subnode(NULL, "chunk_location_cache", 0);
+	gLocationCacheStatsPtr[LOCATION_CACHE_HITS] = stats_get_counterptr(stats_get_subnode(s, "hits", 0));
+	gLocationCacheStatsPtr[LOCATION_CACHE_MISSES] = stats_get_counterptr(stats_get_subnode(s, "misses", 0));
+	gLocationCacheStatsPtr[LOCATION_CACHE_CHANGES] = stats_get_counterptr(stats_get_subnode(s, "changes", 0));
+	gLocationCacheStatsPtr[LOCATION_CACHE_ENTRIES] = stats_get_counterptr(stats_get_subnode(s, "entries", 1));
+	memset(&gLocationCacheReportedStats, 0, sizeof(gLocationCacheReportedStats));
+}
+
+static void read_data_location_cache_stats_update() {
+	ChunkLocationCache::Stats stats = gChunkLocationCache->stats();
+	ChunkLocationCache::Stats &reported = gLocationCacheReportedStats;
+	stats_lock();
+	*gLocationCacheStatsPtr[LOCATION_CACHE_HITS] += stats.hits - reported.hits;
+	*gLocationCacheStatsPtr[LOCATION_CACHE_MISSES] += stats.misses - reported.misses;
+	*gLocationCacheStatsPtr[LOCATION_CACHE_CHANGES] += stats.changes - reported.changes;
+	*gLocationCacheStatsPtr[LOCATION_CACHE_ENTRIES] = stats.entries;
+	stats_unlock();
+	reported = stats;
+}
+
+static void read_data_chunkserver_statsptr_init(const NetworkAddress &address,
+		ChunkserverLatencyStatsPtr &ptr) {
+	statsnode *s = stats_get_subnode(NULL, "chunkservers", 0);
+	s = stats_get_subnode(stats_get_subnode(s, address.toString().c_str(), 0), "read_latency", 0);
+	for (int k = LatencyHistogram::kBuckets - 1; k >= 0; k--) {
+		statsnode *bucket = stats_get_subnode(s, stats_latency_bucket_name(k).c_str(), 0);
+		stats_lock();
+		bucket->hidezero = 1;
+		stats_unlock();
+		ptr.buckets[k] = stats_get_counterptr(bucket);
+	}
+	ptr.sum_us = stats_get_counterptr(stats_get_subnode(s, "sum_us", 0));
+	ptr.count = stats_get_counterptr(stats_get_subnode(s, "count", 0));
+	ptr.latency_ewma_us = stats_get_counterptr(stats_get_subnode(s, "average_us", 1));
+	ptr.bandwidth_ewma = stats_get_counterptr(stats_get_subnode(s, "average_bandwidth", 1));
+}
+
+// Latencies are gathered in globalChunkserverStats (under its lock, which is taken for each
+// read operation anyway) and copied to .stats periodically
+static void read_data_chunkserver_stats_update() {
+	for (const auto &entry : globalChunkserverStats.readLatencies()) {
+		auto it = gChunkserverLatencyStatsPtr.find(entry.first);
+		if (it == gChunkserverLatencyStatsPtr.end()) {
+			it = gChunkserverLatencyStatsPtr.insert({entry.first, ChunkserverLatencyStatsPtr()}).first;
+			read_data_chunkserver_statsptr_init(entry.first, it->second);
+		}
+		const LatencyHistogram &latency = entry.second;
+		ChunkserverLatencyStatsPtr &ptr = it->second;
+		auto chunkserver = globalChunkserverStats.getStatisticsFor(entry.first);
+		stats_lock();
+		*ptr.latency_ewma_us = chunkserver.readLatencyEwma_us();
+		*ptr.bandwidth_ewma = chunkserver.readBandwidthEwma();
+		*ptr.count += latency.count() - ptr.reported.count();
+		*ptr.sum_us += latency.sumUs() - ptr.reported.sumUs();
+		for (int k = 0; k < LatencyHistogram::kBuckets; k++) {
+			*ptr.buckets[k] += latency.bucketCount(k) - ptr.reported.bucketCount(k);
+		}
+		stats_unlock();
+		ptr.reported = latency;
+	}
+}
+
 void* read_data_delayed_ops(void *arg) {
 	readrec *rrec,**rrecp;
 	readrec **rrecmap;
 	(void)arg;
 	for (;;) {
 		gReadConnectionPool.cleanup();
+		if (gSharedBlockCache) {
+			read_data_shared_cache_stats_update();
+		}
+		if (gChunkLocationCache) {
+			read_data_location_cache_stats_update();
+		}
+		read_data_chunkserver_stats_update();
 		std::unique_lock<std::mutex> lock(gMutex);
 		if (readDataTerminate) {
 			return NULL;
@@ -135,7 +326,7 @@ void* read_data_delayed_ops(void *arg) {
 			if (rrec->refreshCounter < REFRESHTICKS) {
 				rrec->refreshCounter++;
 			}
-			if (rrec->expired) {
+			if (rrec->expired && rrec->activeReads == 0) {
 				*rrecp = rrec->next;
 				rrecmap = &(rdinodemap[MAPINDX(rrec->inode)]);
 				while (*rrecmap) {
@@ -172,6 +363,21 @@ void read_data_end(void* rr) {
 	rrec->expired = true;
 }
 
+void read_data_acquire(void *rr) {
+	readrec *rrec = (readrec*)rr;
+
+	std::unique_lock<std::mutex> lock(gMutex);
+	rrec->activeReads++;
+}
+
+void read_data_release(void *rr) {
+	readrec *rrec = (readrec*)rr;
+
+	std::unique_lock<std::mutex> lock(gMutex);
+	assert(rrec->activeReads > 0);
+	rrec->activeReads--;
+}
+
 void read_data_init(uint32_t retries,
 		uint32_t chunkserverRoundTripTime_ms,
 		uint32_t chunkserverConnectTimeout_ms,
@@ -180,7 +386,10 @@ void read_data_init(uint32_t retries,
 		uint32_t cache_expiration_time_ms,
 		uint32_t readahead_max_window_size_kB,
 		bool prefetchXorStripes,
-		double bandwidth_overuse) {
+		double bandwidth_overuse,
+		uint32_t shared_cache_size_MB,
+		uint32_t hedge_read_percentile,
+		uint32_t chunk_location_cache_timeout_ms) {
 	uint32_t i;
 	pthread_attr_t thattr;
 
@@ -196,6 +405,17 @@ void read_data_init(uint32_t retries,
 	gReadaheadMaxWindowSize = readahead_max_window_size_kB * 1024;
 	gPrefetchXorStripes = prefetchXorStripes;
 	gBandwidthOveruse = bandwidth_overuse;
+	gHedgeReadPercentile = hedge_read_percentile;
+	if (shared_cache_size_MB > 0) {
+		gSharedBlockCache.reset(new SharedBlockCache(uint64_t(shared_cache_size_MB) << 20));
+		read_data_shared_cache_statsptr_init();
+	}
+	if (chunk_location_cache_timeout_ms > 0) {
+		gChunkLocationCache.reset(new ChunkLocationCache(
+				std::chrono::milliseconds(chunk_location_cache_timeout_ms),
+				CHUNK_LOCATION_CACHE_SIZE));
+		read_data_location_cache_statsptr_init();
+	}
 	gTweaks.registerVariable("PrefetchXorStripes", gPrefetchXorStripes);
 	gChunkConnector.setRoundTripTime(chunkserverRoundTripTime_ms);
 	gChunkConnector.setSourceIp(fs_getsrcip());
@@ -214,6 +434,9 @@ void read_data_init(uint32_t retries,
 	gTweaks.registerVariable("ReqExecutedTotal", ReadPlanExecutor::executions_total_);
 	gTweaks.registerVariable("ReqExecutedUsingAll", ReadPlanExecutor::executions_with_additional_operations_);
 	gTweaks.registerVariable("ReqFinishedUsingAll", ReadPlanExecutor::executions_finished_by_additional_operations_);
+	gTweaks.registerVariable("ReadHedgePercentile", gHedgeReadPercentile);
+	gTweaks.registerVariable("ReadHedgesIssued", ReadPlanExecutor::hedged_reads_issued_);
+	gTweaks.registerVariable("ReadHedgesWon", ReadPlanExecutor::hedged_reads_won_);
 }
 
 void read_data_term(void) {
@@ -233,10 +456,17 @@ void read_data_term(void) {
 		rr = NULL;
 	}
 	rdhead = NULL;
+	gSharedBlockCache.reset();
+	gChunkLocationCache.reset();
 }
 
 void read_inode_ops(uint32_t inode) { // attributes of inode have been changed - force reconnect and clear cache
 	readrec *rrec;
+	read_data_invalidate_shared_cache(inode);
+	// Chunks modified by this client are located again without reporting changes
+	if (gChunkLocationCache) {
+		gChunkLocationCache->invalidateInode(inode);
+	}
 	std::unique_lock<std::mutex> lock(gMutex);
 	for (rrec = rdinodemap[MAPINDX(inode)] ; rrec ; rrec=rrec->mapnext) {
 		if (rrec->inode == inode) {
@@ -245,6 +475,19 @@ void read_inode_ops(uint32_t inode) { // attributes of inode have been changed -
 	}
 }
 
+void read_data_invalidate_shared_cache(uint32_t inode) {
+	if (gSharedBlockCache) {
+		gSharedBlockCache->invalidateInode(inode);
+	}
+}
+
+void read_data_set_chunk_location_change_callback(
+		std::function<void(uint32_t inode, uint32_t chunk_index)> callback) {
+	if (gChunkLocationCache) {
+		gChunkLocationCache->setChangeCallback(std::move(callback));
+	}
+}
+
 int read_data_sleep_time_ms(int tryCounter) {
 	if (tryCounter <= 13) {            // 2^13 = 8192
 		return (1 << tryCounter);  // 2^tryCounter milliseconds
@@ -253,20 +496,82 @@ int read_data_sleep_time_ms(int tryCounter) {
 	}
 }
 
-static void print_error_msg(const readrec *rrec, uint32_t try_counter, const Exception &ex) {
-	if (rrec->reader.isChunkLocated()) {
+static void print_error_msg(const ChunkReader &reader, uint32_t try_counter, const Exception &ex) {
+	if (reader.isChunkLocated()) {
 		lzfs_pretty_syslog(LOG_WARNING,
 		                   "read file error, inode: %u, index: %u, chunk: %" PRIu64 ", version: %u - %s "
-		                   "(try counter: %u)", rrec->reader.inode(), rrec->reader.index(),
-		                   rrec->reader.chunkId(), rrec->reader.version(), ex.what(), try_counter);
+		                   "(try counter: %u)", reader.inode(), reader.index(),
+		                   reader.chunkId(), reader.version(), ex.what(), try_counter);
 	} else {
 		lzfs_pretty_syslog(LOG_WARNING,
 		                   "read file error, inode: %u, index: %u, chunk: failed to locate - %s "
-		                   "(try counter: %u)", rrec->reader.inode(), rrec->reader.index(),
+		                   "(try counter: %u)", reader.inode(), reader.index(),
 		                   ex.what(), try_counter);
 	}
 }
 
+/*
+ * Reads data from the chunk prepared by the reader and appends it to the buffer.
+ * Leading blocks which are in the shared block cache are taken from it, the rest is read
+ * from chunkservers and its full blocks are added to the cache.
+ */
+static uint32_t read_chunk_data(ChunkReader &reader, std::vector<uint8_t> &buffer,
+		uint32_t offset_in_chunk, uint32_t size, const Timeout &communication_timeout) {
+	if (!gSharedBlockCache || reader.isEmptyChunk()) {
+		return reader.readData(buffer, offset_in_chunk, size,
+				gChunkserverConnectTimeout_ms, gChunkserverWaveReadTimeout_ms,
+				communication_timeout, gPrefetchXorStripes, gHedgeReadPercentile);
+	}
+
+	uint64_t offset_of_chunk = static_cast<uint64_t>(reader.index()) * MFSCHUNKSIZE;
+	SharedBlockCache::Key key(reader.inode(), reader.index(), reader.chunkId(),
+			reader.version(), 0);
+	std::size_t initial_buffer_size = buffer.size();
+	uint32_t bytes_from_cache = 0;
+	while (bytes_from_cache < size && offset_in_chunk % MFSBLOCKSIZE == 0) {
+		uint64_t offset_in_file = offset_of_chunk + offset_in_chunk;
+		if (offset_in_file + MFSBLOCKSIZE > reader.fileLength()) {
+			// blocks at the end of file are never cached
+			break;
+		}
+		key.block = offset_in_chunk / MFSBLOCKSIZE;
+		SharedBlockCache::BlockPtr block = gSharedBlockCache->find(key);
+		if (!block) {
+			break;
+		}
+		uint32_t bytes = std::min<uint32_t>(MFSBLOCKSIZE, size - bytes_from_cache);
+		buffer.insert(buffer.end(), block->begin(), block->begin() + bytes);
+		bytes_from_cache += bytes;
+		offset_in_chunk += bytes;
+	}
+	if (bytes_from_cache == size) {
+		return size;
+	}
+
+	std::size_t read_buffer_offset = buffer.size();
+	// Blocks read while this client writes to the file mustn't be cached
+	uint64_t generation = gSharedBlockCache->generation(reader.inode());
+	uint32_t bytes_read;
+	try {
+		bytes_read = reader.readData(buffer, offset_in_chunk, size - bytes_from_cache,
+				gChunkserverConnectTimeout_ms, gChunkserverWaveReadTimeout_ms,
+				communication_timeout, gPrefetchXorStripes, gHedgeReadPercentile);
+	} catch (...) {
+		// the caller retries the whole read, so it doesn't expect any data appended
+		buffer.resize(initial_buffer_size);
+		throw;
+	}
+	if (offset_in_chunk % MFSBLOCKSIZE == 0) {
+		for (uint32_t pos = 0; pos + MFSBLOCKSIZE <= bytes_read; pos += MFSBLOCKSIZE) {
+			key.block = (offset_in_chunk + pos) / MFSBLOCKSIZE;
+			auto block_begin = buffer.begin() + read_buffer_offset + pos;
+			gSharedBlockCache->insert(key,
+					std::vector<uint8_t>(block_begin, block_begin + MFSBLOCKSIZE), generation);
+		}
+	}
+	return bytes_from_cache + bytes_read;
+}
+
 static int read_to_buffer(readrec *rrec, uint64_t current_offset, uint64_t bytes_to_read,
 		std::vector<uint8_t> &read_buffer, uint64_t *bytes_read) {
 	uint32_t try_counter = 0;
@@ -280,6 +585,7 @@ static int read_to_buffer(readrec *rrec, uint64_t current_offset, uint64_t bytes
 	std::unique_lock<std::mutex> lock(gMutex);
 	bool force_prepare = (rrec->refreshCounter == REFRESHTICKS);
 	lock.unlock();
+	PooledChunkReader reader(rrec, force_prepare);
 
 	while (bytes_to_read > 0) {
 		Timeout sleep_timeout = Timeout(std::chrono::milliseconds(sleep_time_ms));
@@ -291,7 +597,7 @@ static int read_to_buffer(readrec *rrec, uint64_t current_offset, uint64_t bytes
 		try {
 			uint32_t chunk_id = current_offset / MFSCHUNKSIZE;
 			if (force_prepare || prepared_inode != rrec->inode || prepared_chunk_id != chunk_id) {
-				rrec->reader.prepareReadingChunk(rrec->inode, chunk_id, force_prepare);
+				(*reader).prepareReadingChunk(rrec->inode, chunk_id, force_prepare);
 				prepared_chunk_id = chunk_id;
 				prepared_inode = rrec->inode;
 				force_prepare = false;
@@ -306,10 +612,8 @@ static int read_to_buffer(readrec *rrec, uint64_t current_offset, uint64_t bytes
 			if (size_in_chunk > bytes_to_read) {
 				size_in_chunk = bytes_to_read;
 			}
-			uint32_t bytes_read_from_chunk = rrec->reader.readData(
-					read_buffer, offset_in_chunk, size_in_chunk,
-					gChunkserverConnectTimeout_ms, gChunkserverWaveReadTimeout_ms,
-					communication_timeout, gPrefetchXorStripes);
+			uint32_t bytes_read_from_chunk = read_chunk_data(
+					*reader, read_buffer, offset_in_chunk, size_in_chunk, communication_timeout);
 			// No exceptions thrown. We can increase the counters and go to the next chunk
 			*bytes_read += bytes_read_from_chunk;
 			current_offset += bytes_read_from_chunk;
@@ -320,7 +624,7 @@ static int read_to_buffer(readrec *rrec, uint64_t current_offset, uint64_t bytes
 			}
 			try_counter = 0;
 		} catch (UnrecoverableReadException &ex) {
-			print_error_msg(rrec, try_counter, ex);
+			print_error_msg(*reader, try_counter, ex);
 			if (ex.status() == LIZARDFS_ERROR_ENOENT) {
 				return LIZARDFS_ERROR_EBADF; // stale handle
 			} else {
@@ -328,7 +632,7 @@ static int read_to_buffer(readrec *rrec, uint64_t current_offset, uint64_t bytes
 			}
 		} catch (Exception &ex) {
 			if (try_counter > 0) {
-				print_error_msg(rrec, try_counter, ex);
+				print_error_msg(*reader, try_counter, ex);
 			}
 			force_prepare = true;
 			if (try_counter > maxRetries) {
@@ -352,26 +656,31 @@ int read_data(void *rr, uint64_t offset, uint32_t size, ReadCache::Result &ret)
 		return LIZARDFS_STATUS_OK;
 	}
 
+	std::unique_lock<std::mutex> lock(rrec->mutex);
 	rrec->readahead_adviser.feed(offset, size);
 
 	ReadCache::Result result = rrec->cache.query(offset, size);
 
 	if (result.frontOffset() <= offset && offset + size <= result.endOffset()) {
+		lock.unlock();
 		ret = std::move(result);
 		return LIZARDFS_STATUS_OK;
 	}
 	uint64_t request_offset = result.remainingOffset();
 	uint64_t bytes_to_read_left = std::max<uint64_t>(size, rrec->readahead_adviser.window()) - (request_offset - offset);
 	bytes_to_read_left = (bytes_to_read_left + MFSBLOCKSIZE - 1) / MFSBLOCKSIZE * MFSBLOCKSIZE;
+	// other reads on this descriptor may proceed while this one waits for chunkservers
+	lock.unlock();
 
 	uint64_t bytes_read = 0;
 	int err = read_to_buffer(rrec, request_offset, bytes_to_read_left, result.inputBuffer(), &bytes_read);
 	if (err) {
 		// paranoia check - discard any leftover bytes from incorrect read
 		result.inputBuffer().clear();
+		result.inputBufferFilled();
 		return err;
 	}
-	result.entries.back()->reset_timer();
+	result.inputBufferFilled();
 
 	ret = std::move(result);
 	return LIZARDFS_STATUS_OK;
@@ -21,6 +21,7 @@
 #include "common/platform.h"
 
 #include <inttypes.h>
+#include <functional>
 
 #include "mount/chunk_locator.h"
 #include "mount/readdata_cache.h"
@@ -31,8 +32,14 @@ uint32_t read_data_get_total_read_timeout_ms();
 bool read_data_get_prefetchxorstripes();
 
 void read_inode_ops(uint32_t inode);
+void read_data_invalidate_shared_cache(uint32_t inode);
+// Sets function called when a cached location of a chunk turns out to be outdated
+void read_data_set_chunk_location_change_callback(
+		std::function<void(uint32_t inode, uint32_t chunk_index)> callback);
 void* read_data_new(uint32_t inode);
 void read_data_end(void *rr);
+void read_data_acquire(void *rr);
+void read_data_release(void *rr);
 int read_data(void *rr, uint64_t offset, uint32_t size, ReadCache::Result &ret);
 void read_data_freebuff(void *rr);
 void read_data_init(uint32_t retries,
@@ -43,5 +50,8 @@ void read_data_init(uint32_t retries,
 		uint32_t cache_expiration_time_ms,
 		uint32_t readahead_max_window_size_kB,
 		bool prefetchXorStripes,
-		double bandwidth_overuse);
+		double bandwidth_overuse,
+		uint32_t shared_cache_size_MB,
+		uint32_t hedge_read_percentile,
+		uint32_t chunk_location_cache_timeout_ms);
 void read_data_term(void);
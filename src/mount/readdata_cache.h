@@ -27,9 +27,12 @@
 #include <cassert>
 #include <cstring>
 #include <deque>
+#include <limits>
 #include <map>
 #include <memory>
 #include <numeric>
+#include <string>
+#include <vector>
 
 #include <boost/intrusive/list.hpp>
 #include <boost/intrusive/set.hpp>
@@ -41,9 +44,11 @@ public:
 
 	struct Entry {
 		Offset offset;
+		Size requested_size; // size of the read which created the entry
 		std::vector<uint8_t> buffer;
 		Timer timer;
 		std::atomic<int> refcount;
+		std::atomic<bool> filled; // buffer and timer are not modified any more
 		boost::intrusive::set_member_hook<> set_member_hook;
 		boost::intrusive::list_member_hook<> lru_member_hook;
 		boost::intrusive::list_member_hook<> reserved_member_hook;
@@ -54,8 +59,9 @@ public:
 			}
 		};
 
-		Entry(Offset offset) : offset(offset), buffer(), timer(), refcount(0),
-		      set_member_hook(), lru_member_hook() {}
+		Entry(Offset offset, Size requested_size = 0)
+		      : offset(offset), requested_size(requested_size), buffer(), timer(), refcount(0),
+		        filled(false), set_member_hook(), lru_member_hook() {}
 
 		bool operator<(const Entry &other) const {
 			return offset < other.offset;
@@ -111,6 +117,7 @@ public:
 		Result(std::vector<uint8_t> &&data) : entries(), is_fake(true) {
 			Entry *entry = new Entry(0);
 			entry->buffer = std::move(data);
+			entry->filled = true;
 			entries.push_back(entry);
 		}
 
@@ -151,6 +158,18 @@ public:
 			return entries.back()->buffer;
 		}
 
+		/*!
+		 * \brief Mark the input buffer as complete.
+		 *
+		 * Queries (possibly run concurrently with reading data into the buffer)
+		 * don't use the entry before it is marked.
+		 */
+		void inputBufferFilled() {
+			assert(!entries.empty());
+			entries.back()->reset_timer();
+			entries.back()->filled = true;
+		}
+
 		/*!
 		 * \brief Serialize cache query result to an iovector.
 		 *
@@ -267,7 +286,12 @@ public:
 	 * If all data is available in cache, it can be obtained from result
 	 * as an iovector via result.toIoVec() call.
 	 * If some or no data is available, the rest should be read into the result buffer
-	 * via result.inputBuffer(). Then, it can be obtain as an iovector via result.toIoVec().
+	 * via result.inputBuffer() and marked with result.inputBufferFilled(). Then, it can be
+	 * obtain as an iovector via result.toIoVec().
+	 *
+	 * Queries have to be serialized, but filling the buffers may be done concurrently
+	 * with other queries. An entry which is still being filled is treated as a gap
+	 * and is replaced with a new one if the range it was created for overlaps the query.
 	 *
 	 * \return cache query result
 	 */
@@ -288,6 +312,14 @@ public:
 				break;
 			}
 
+			if (!it->filled) {
+				if (it->offset + it->requested_size <= offset) {
+					++it;
+					continue;
+				}
+				break;
+			}
+
 			if (it->expired(expiration_time_) || it->buffer.empty()) {
 				it = erase(it);
 				continue;
@@ -321,7 +353,7 @@ public:
 protected:
 	EntrySet::iterator insert(EntrySet::iterator it, Offset offset, Size size) {
 		it = clearCollisions(it, offset + size);
-		Entry *e = new Entry(offset);
+		Entry *e = new Entry(offset, size);
 		lru_.push_back(*e);
 		assert(entries_.find(*e) == entries_.end());
 		return entries_.insert(it, *e);
@@ -331,7 +363,7 @@ protected:
 		unsigned reserved_count = count;
 		while (!lru_.empty() && count-- > 0) {
 			Entry *e = std::addressof(lru_.front());
-			if (e->expired(expiration_time_)) {
+			if (e->filled && e->expired(expiration_time_)) {
 				erase(entries_.iterator_to(*e));
 			} else {
 				break;
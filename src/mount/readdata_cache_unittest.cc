@@ -0,0 +1,91 @@
+/*
+   Copyright 2017 Skytechnology sp. z o.o.
+
+   This file is part of LizardFS.
+
+   LizardFS is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, version 3.
+
+   LizardFS is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with LizardFS. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "common/platform.h"
+#include "mount/readdata_cache.h"
+
+#include <gtest/gtest.h>
+
+static void fill(ReadCache::Result &result, uint32_t size, uint8_t value) {
+	result.inputBuffer().assign(size, value);
+	result.inputBufferFilled();
+}
+
+TEST(ReadCache, QueryFilledEntries) {
+	ReadCache cache(10000);
+
+	ReadCache::Result first = cache.query(0, 1024);
+	EXPECT_EQ(0U, first.remainingOffset());
+	fill(first, 2048, 1);
+
+	ReadCache::Result second = cache.query(1024, 1024);
+	EXPECT_EQ(0U, second.frontOffset());
+	EXPECT_EQ(2048U, second.endOffset());
+
+	ReadCache::Result third = cache.query(1024, 2048);
+	EXPECT_EQ(2048U, third.remainingOffset());
+	fill(third, 1024, 2);
+	std::vector<uint8_t> data(2048);
+	EXPECT_EQ(2048U, third.copyToBuffer(data.data(), 1024, 2048));
+	EXPECT_EQ(1, data[1023]);
+	EXPECT_EQ(2, data[1024]);
+}
+
+TEST(ReadCache, EntryBeingFilledIsNotUsed) {
+	ReadCache cache(10000);
+
+	// The first read is still waiting for data when the second one queries the cache
+	ReadCache::Result first = cache.query(0, 4096);
+	ReadCache::Result second = cache.query(1024, 1024);
+	EXPECT_EQ(1024U, second.remainingOffset());
+	fill(second, 1024, 2);
+	fill(first, 4096, 1);
+
+	// The first entry was replaced, but its data is still available to its reader
+	std::vector<uint8_t> data(4096);
+	EXPECT_EQ(4096U, first.copyToBuffer(data.data(), 0, 4096));
+	EXPECT_EQ(std::vector<uint8_t>(4096, 1), data);
+
+	ReadCache::Result third = cache.query(1024, 1024);
+	EXPECT_EQ(1024U, third.frontOffset());
+	EXPECT_EQ(2048U, third.endOffset());
+	EXPECT_EQ(1024U, third.copyToBuffer(data.data(), 1024, 1024));
+	EXPECT_EQ(2, data[0]);
+}
+
+TEST(ReadCache, DisjointEntriesBeingFilled) {
+	ReadCache cache(10000);
+
+	// Two reads of different parts of the file wait for data at the same time
+	ReadCache::Result first = cache.query(0, 1024);
+	ReadCache::Result second = cache.query(4096, 1024);
+	EXPECT_EQ(4096U, second.remainingOffset());
+	fill(second, 1024, 2);
+	fill(first, 1024, 1);
+
+	// Neither of them replaced the other one
+	ReadCache::Result third = cache.query(0, 1024);
+	EXPECT_EQ(0U, third.frontOffset());
+	EXPECT_EQ(1024U, third.endOffset());
+	ReadCache::Result fourth = cache.query(4096, 1024);
+	EXPECT_EQ(4096U, fourth.frontOffset());
+	EXPECT_EQ(5120U, fourth.endOffset());
+	std::vector<uint8_t> data(1024);
+	EXPECT_EQ(1024U, fourth.copyToBuffer(data.data(), 4096, 1024));
+	EXPECT_EQ(std::vector<uint8_t>(1024, 2), data);
+}
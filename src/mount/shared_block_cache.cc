@@ -0,0 +1,145 @@
+/*
+   Copyright 2017 Skytechnology sp. z o.o.
+
+   This file is part of LizardFS.
+
+   LizardFS is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, version 3.
+
+   LizardFS is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with LizardFS. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "common/platform.h"
+#include "mount/shared_block_cache.h"
+
+#include <iterator>
+#include <limits>
+
+constexpr unsigned SharedBlockCache::kShardCount;
+constexpr unsigned SharedBlockCache::kGenerationSlots;
+
+SharedBlockCache::SharedBlockCache(uint64_t max_size)
+		: max_shard_size_(max_size / kShardCount),
+		  hits_(0),
+		  misses_(0),
+		  evictions_(0),
+		  invalidations_(0) {
+	for (auto &generation : generations_) {
+		generation.store(0, std::memory_order_relaxed);
+	}
+}
+
+SharedBlockCache::BlockPtr SharedBlockCache::find(const Key &key) {
+	Shard &s = shard(key.inode, key.chunk_index);
+	std::unique_lock<std::mutex> lock(s.mutex);
+	auto it = s.entries.find(key);
+	if (it == s.entries.end()) {
+		misses_++;
+		return BlockPtr();
+	}
+	s.lru.splice(s.lru.end(), s.lru, it->second.lru_position);
+	hits_++;
+	return it->second.data;
+}
+
+void SharedBlockCache::insert(const Key &key, std::vector<uint8_t> data,
+		uint64_t generation) {
+	static const uint32_t kMax32 = std::numeric_limits<uint32_t>::max();
+	static const uint64_t kMax64 = std::numeric_limits<uint64_t>::max();
+
+	uint64_t size = data.size();
+	if (size > max_shard_size_) {
+		return;
+	}
+	BlockPtr block = std::make_shared<const std::vector<uint8_t>>(std::move(data));
+	Shard &s = shard(key.inode, key.chunk_index);
+	std::unique_lock<std::mutex> lock(s.mutex);
+	// invalidateInode changes the generation before it takes locks of shards, so the block
+	// is either dropped here or removed by invalidateInode
+	if (generation != this->generation(key.inode)) {
+		invalidations_++;
+		return;
+	}
+
+	// Blocks of other versions of the chunk are stale, they are sorted just before
+	// and just after blocks of the current version
+	auto chunk_begin = s.entries.lower_bound(Key(key.inode, key.chunk_index, 0, 0, 0));
+	auto version_begin = s.entries.lower_bound(
+			Key(key.inode, key.chunk_index, key.chunk_id, key.chunk_version, 0));
+	invalidations_ += s.erase(chunk_begin, version_begin);
+	auto version_end = s.entries.upper_bound(
+			Key(key.inode, key.chunk_index, key.chunk_id, key.chunk_version, kMax32));
+	auto chunk_end = s.entries.upper_bound(
+			Key(key.inode, key.chunk_index, kMax64, kMax32, kMax32));
+	invalidations_ += s.erase(version_end, chunk_end);
+
+	auto it = s.entries.find(key);
+	if (it != s.entries.end()) {
+		s.bytes -= it->second.data->size();
+		it->second.data = std::move(block);
+		s.lru.splice(s.lru.end(), s.lru, it->second.lru_position);
+	} else {
+		s.lru.push_back(key);
+		Shard::Entry entry;
+		entry.data = std::move(block);
+		entry.lru_position = std::prev(s.lru.end());
+		s.entries.emplace(key, std::move(entry));
+	}
+	s.bytes += size;
+
+	while (s.bytes > max_shard_size_) {
+		s.erase(s.entries.find(s.lru.front()));
+		evictions_++;
+	}
+}
+
+void SharedBlockCache::invalidateInode(uint32_t inode) {
+	static const uint32_t kMax32 = std::numeric_limits<uint32_t>::max();
+	static const uint64_t kMax64 = std::numeric_limits<uint64_t>::max();
+
+	generations_[inode % kGenerationSlots].fetch_add(1, std::memory_order_acq_rel);
+	for (Shard &s : shards_) {
+		std::unique_lock<std::mutex> lock(s.mutex);
+		auto first = s.entries.lower_bound(Key(inode, 0, 0, 0, 0));
+		auto last = s.entries.upper_bound(Key(inode, kMax32, kMax64, kMax32, kMax32));
+		invalidations_ += s.erase(first, last);
+	}
+}
+
+SharedBlockCache::Stats SharedBlockCache::stats() const {
+	Stats result;
+	result.hits = hits_;
+	result.misses = misses_;
+	result.evictions = evictions_;
+	result.invalidations = invalidations_;
+	result.blocks = 0;
+	result.bytes = 0;
+	for (const Shard &s : shards_) {
+		std::unique_lock<std::mutex> lock(s.mutex);
+		result.blocks += s.entries.size();
+		result.bytes += s.bytes;
+	}
+	return result;
+}
+
+void SharedBlockCache::Shard::erase(EntryMap::iterator it) {
+	bytes -= it->second.data->size();
+	lru.erase(it->second.lru_position);
+	entries.erase(it);
+}
+
+uint64_t SharedBlockCache::Shard::erase(EntryMap::iterator first, EntryMap::iterator last) {
+	uint64_t count = 0;
+	while (first != last) {
+		erase(first++);
+		count++;
+	}
+	return count;
+}
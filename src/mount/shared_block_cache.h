@@ -0,0 +1,145 @@
+/*
+   Copyright 2017 Skytechnology sp. z o.o.
+
+   This file is part of LizardFS.
+
+   LizardFS is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, version 3.
+
+   LizardFS is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with LizardFS. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include "common/platform.h"
+
+#include <atomic>
+#include <cstdint>
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <tuple>
+#include <vector>
+
+/*!
+ * \brief Cache of file blocks shared by all readers in the mount process.
+ *
+ * Blocks are identified by inode, chunk id, chunk version and the number of the block
+ * in the chunk, so data of a chunk which got a new version is never returned. Inserting
+ * a block of a new version of a chunk removes all blocks of its older versions. Blocks
+ * of files modified in other ways (chunk versions don't change on every write) have to
+ * be dropped with invalidateInode.
+ *
+ * A read may start before the inode is invalidated and finish after it, so readers take
+ * the invalidation generation of the inode before reading and pass it to insert, which
+ * drops blocks read before the last invalidation. Generations are kept in a fixed number
+ * of slots (by inode), so invalidation of one inode may also drop blocks of another one
+ * read at the same time.
+ *
+ * The cache is divided into shards (by inode and chunk index), each with its own lock
+ * and LRU list, and each shard gets an equal part of the memory limit.
+ */
+class SharedBlockCache {
+public:
+	typedef std::shared_ptr<const std::vector<uint8_t>> BlockPtr;
+
+	struct Key {
+		Key(uint32_t inode, uint32_t chunk_index, uint64_t chunk_id, uint32_t chunk_version,
+				uint32_t block)
+				: inode(inode),
+				  chunk_index(chunk_index),
+				  chunk_id(chunk_id),
+				  chunk_version(chunk_version),
+				  block(block) {
+		}
+
+		bool operator<(const Key &other) const {
+			return std::tie(inode, chunk_index, chunk_id, chunk_version, block) <
+			       std::tie(other.inode, other.chunk_index, other.chunk_id,
+			                other.chunk_version, other.block);
+		}
+
+		uint32_t inode;
+		uint32_t chunk_index;
+		uint64_t chunk_id;
+		uint32_t chunk_version;
+		uint32_t block;
+	};
+
+	struct Stats {
+		uint64_t hits;
+		uint64_t misses;
+		uint64_t evictions;
+		uint64_t invalidations;
+		uint64_t blocks;
+		uint64_t bytes;
+	};
+
+	static constexpr unsigned kShardCount = 16;
+	static constexpr unsigned kGenerationSlots = 1024;
+
+	/*! \param max_size Maximal size (in bytes) of cached data. */
+	explicit SharedBlockCache(uint64_t max_size);
+
+	/*! \brief Returns cached block or nullptr if it's not in the cache. */
+	BlockPtr find(const Key &key);
+
+	/*! \brief Returns the invalidation generation of the inode, to be passed to insert. */
+	uint64_t generation(uint32_t inode) const {
+		return generations_[inode % kGenerationSlots].load(std::memory_order_acquire);
+	}
+
+	/*!
+	 * \brief Adds a block to the cache, evicting least recently used blocks if needed.
+	 *
+	 * \param generation Generation of the inode taken before the block was read, the block
+	 *                   isn't added if the inode was invalidated since then.
+	 */
+	void insert(const Key &key, std::vector<uint8_t> data, uint64_t generation);
+
+	/*! \brief Removes all blocks of the inode. */
+	void invalidateInode(uint32_t inode);
+
+	Stats stats() const;
+
+private:
+	struct Shard {
+		typedef std::list<Key> LruList;
+		struct Entry {
+			BlockPtr data;
+			LruList::iterator lru_position;
+		};
+		typedef std::map<Key, Entry> EntryMap;
+
+		Shard() : bytes(0) {
+		}
+
+		void erase(EntryMap::iterator it);
+		uint64_t erase(EntryMap::iterator first, EntryMap::iterator last);
+
+		mutable std::mutex mutex;
+		EntryMap entries;
+		LruList lru; // the least recently used block first
+		uint64_t bytes;
+	};
+
+	Shard &shard(uint32_t inode, uint32_t chunk_index) {
+		return shards_[(inode * 0x9E3779B1U + chunk_index) % kShardCount];
+	}
+
+	uint64_t max_shard_size_;
+	Shard shards_[kShardCount];
+	std::atomic<uint64_t> generations_[kGenerationSlots];
+	std::atomic<uint64_t> hits_;
+	std::atomic<uint64_t> misses_;
+	std::atomic<uint64_t> evictions_;
+	std::atomic<uint64_t> invalidations_;
+};
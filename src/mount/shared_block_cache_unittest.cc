@@ -0,0 +1,137 @@
+/*
+   Copyright 2017 Skytechnology sp. z o.o.
+
+   This file is part of LizardFS.
+
+   LizardFS is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, version 3.
+
+   LizardFS is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with LizardFS. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "common/platform.h"
+#include "mount/shared_block_cache.h"
+
+#include <gtest/gtest.h>
+
+typedef SharedBlockCache::Key Key;
+
+static std::vector<uint8_t> block(uint8_t value) {
+	return std::vector<uint8_t>(1024, value);
+}
+
+TEST(SharedBlockCache, FindAndInsert) {
+	SharedBlockCache cache(1024 * 1024);
+
+	EXPECT_EQ(nullptr, cache.find(Key(1, 0, 10, 1, 0)));
+	cache.insert(Key(1, 0, 10, 1, 0), block(1), cache.generation(1));
+	cache.insert(Key(1, 0, 10, 1, 1), block(2), cache.generation(1));
+	cache.insert(Key(2, 0, 20, 1, 0), block(3), cache.generation(2));
+
+	ASSERT_NE(nullptr, cache.find(Key(1, 0, 10, 1, 0)));
+	EXPECT_EQ(block(1), *cache.find(Key(1, 0, 10, 1, 0)));
+	EXPECT_EQ(block(2), *cache.find(Key(1, 0, 10, 1, 1)));
+	EXPECT_EQ(block(3), *cache.find(Key(2, 0, 20, 1, 0)));
+	EXPECT_EQ(nullptr, cache.find(Key(1, 1, 10, 1, 0)));
+	EXPECT_EQ(nullptr, cache.find(Key(1, 0, 10, 2, 0)));
+
+	cache.insert(Key(1, 0, 10, 1, 0), block(4), cache.generation(1));
+	EXPECT_EQ(block(4), *cache.find(Key(1, 0, 10, 1, 0)));
+
+	auto stats = cache.stats();
+	EXPECT_EQ(5U, stats.hits);
+	EXPECT_EQ(3U, stats.misses);
+	EXPECT_EQ(3U, stats.blocks);
+	EXPECT_EQ(3U * 1024, stats.bytes);
+}
+
+TEST(SharedBlockCache, NewVersionReplacesOldOne) {
+	SharedBlockCache cache(1024 * 1024);
+
+	cache.insert(Key(1, 0, 10, 1, 0), block(1), cache.generation(1));
+	cache.insert(Key(1, 0, 10, 1, 1), block(1), cache.generation(1));
+	cache.insert(Key(1, 1, 11, 1, 0), block(1), cache.generation(1));
+	cache.insert(Key(1, 0, 10, 3, 5), block(2), cache.generation(1));
+	EXPECT_EQ(nullptr, cache.find(Key(1, 0, 10, 1, 0)));
+	EXPECT_EQ(nullptr, cache.find(Key(1, 0, 10, 1, 1)));
+	EXPECT_NE(nullptr, cache.find(Key(1, 1, 11, 1, 0)));
+	EXPECT_NE(nullptr, cache.find(Key(1, 0, 10, 3, 5)));
+
+	// Older version inserted by a slow reader replaces the newer one as well
+	cache.insert(Key(1, 0, 10, 2, 0), block(3), cache.generation(1));
+	EXPECT_EQ(nullptr, cache.find(Key(1, 0, 10, 3, 5)));
+	EXPECT_EQ(3U, cache.stats().invalidations);
+	EXPECT_EQ(2U, cache.stats().blocks);
+}
+
+TEST(SharedBlockCache, InvalidateInode) {
+	SharedBlockCache cache(1024 * 1024);
+
+	for (uint32_t chunk_index = 0; chunk_index < 20; ++chunk_index) {
+		cache.insert(Key(1, chunk_index, 10 + chunk_index, 1, 0), block(1),
+				cache.generation(1));
+		cache.insert(Key(2, chunk_index, 50 + chunk_index, 1, 0), block(2),
+				cache.generation(2));
+	}
+	cache.invalidateInode(1);
+	for (uint32_t chunk_index = 0; chunk_index < 20; ++chunk_index) {
+		EXPECT_EQ(nullptr, cache.find(Key(1, chunk_index, 10 + chunk_index, 1, 0)));
+		EXPECT_NE(nullptr, cache.find(Key(2, chunk_index, 50 + chunk_index, 1, 0)));
+	}
+	EXPECT_EQ(20U, cache.stats().invalidations);
+	EXPECT_EQ(20U, cache.stats().blocks);
+}
+
+TEST(SharedBlockCache, BlocksReadBeforeInvalidationAreDropped) {
+	SharedBlockCache cache(1024 * 1024);
+
+	// A reader starts reading inode 1 and inode 2...
+	uint64_t generation1 = cache.generation(1);
+	uint64_t generation2 = cache.generation(2);
+	cache.insert(Key(1, 0, 10, 1, 0), block(1), generation1);
+	// ...the client writes to inode 1 (the chunk keeps its version)...
+	cache.invalidateInode(1);
+	// ...and the reader finishes with data from before the write
+	cache.insert(Key(1, 0, 10, 1, 1), block(1), generation1);
+	cache.insert(Key(2, 0, 20, 1, 0), block(2), generation2);
+	EXPECT_EQ(nullptr, cache.find(Key(1, 0, 10, 1, 0)));
+	EXPECT_EQ(nullptr, cache.find(Key(1, 0, 10, 1, 1)));
+	EXPECT_NE(nullptr, cache.find(Key(2, 0, 20, 1, 0)));
+
+	// Reads started after the write are cached again
+	cache.insert(Key(1, 0, 10, 1, 1), block(3), cache.generation(1));
+	ASSERT_NE(nullptr, cache.find(Key(1, 0, 10, 1, 1)));
+	EXPECT_EQ(block(3), *cache.find(Key(1, 0, 10, 1, 1)));
+}
+
+TEST(SharedBlockCache, LeastRecentlyUsedBlocksAreEvicted) {
+	// Each shard holds 4 blocks, blocks of one chunk go to the same shard
+	SharedBlockCache cache(SharedBlockCache::kShardCount * 4 * 1024);
+
+	for (uint32_t i = 0; i < 4; ++i) {
+		cache.insert(Key(1, 0, 10, 1, i), block(i), cache.generation(1));
+	}
+	cache.find(Key(1, 0, 10, 1, 0));
+	cache.insert(Key(1, 0, 10, 1, 4), block(4), cache.generation(1));
+	EXPECT_NE(nullptr, cache.find(Key(1, 0, 10, 1, 0)));
+	EXPECT_EQ(nullptr, cache.find(Key(1, 0, 10, 1, 1)));
+	EXPECT_NE(nullptr, cache.find(Key(1, 0, 10, 1, 4)));
+	EXPECT_EQ(1U, cache.stats().evictions);
+	EXPECT_EQ(4U * 1024, cache.stats().bytes);
+
+	// Returned data stays valid after eviction
+	auto data = cache.find(Key(1, 0, 10, 1, 2));
+	for (uint32_t i = 5; i < 10; ++i) {
+		cache.insert(Key(1, 0, 10, 1, i), block(i), cache.generation(1));
+	}
+	EXPECT_EQ(nullptr, cache.find(Key(1, 0, 10, 1, 2)));
+	ASSERT_NE(nullptr, data);
+	EXPECT_EQ(block(2), *data);
+}
@@ -25,12 +25,36 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <atomic>
+#include <string>
+
+#include "common/massert.h"
+
+#define SHARDBLOCKSIZE 256
+#define MAXSHARDBLOCKS 64
 
 static statsnode *firstnode = NULL;
 static uint32_t allactiveplengs = 0;
 static uint32_t activenodes = 0;
 static pthread_mutex_t glock = PTHREAD_MUTEX_INITIALIZER;
 
+/*
+ * Copies of sharded counters owned by a single thread. Blocks of counters are allocated when
+ * the thread uses them for the first time. Shards are never freed, a shard of a finished
+ * thread is taken over (with its values) by the next new thread.
+ */
+struct statsshard {
+	std::atomic<std::atomic<uint64_t>*> blocks[MAXSHARDBLOCKS];
+	std::atomic<bool> inuse;
+	statsshard *next;
+};
+
+static std::atomic<statsshard*> firstshard(nullptr);
+static uint32_t shardedcounters = 0;
+static thread_local statsshard *threadshard = nullptr;
+static pthread_key_t shardkey;
+static pthread_once_t shardkeyonce = PTHREAD_ONCE_INIT;
+
 void stats_lock(void) {
 	pthread_mutex_lock(&glock);
 }
@@ -56,6 +80,9 @@ statsnode* stats_get_subnode(statsnode *node, const char *name, uint8_t absolute
 	a->counter = 0;
 	a->active = 0;
 	a->absolute = absolute;
+	a->hidezero = 0;
+	a->sharded = 0;
+	a->shardedbase = 0;
 	a->name = strdup(name);
 	a->nleng = strlen(name);
 
@@ -103,9 +130,117 @@ uint64_t* stats_get_counterptr(statsnode *node) {
 	return &(node->counter);
 }
 
+static void stats_release_shard(void *shard) {
+	static_cast<statsshard*>(shard)->inuse.store(false, std::memory_order_release);
+}
+
+static void stats_create_shard_key(void) {
+	eassert(pthread_key_create(&shardkey, stats_release_shard) == 0);
+}
+
+static statsshard* stats_get_thread_shard(void) {
+	statsshard *shard;
+
+	if (threadshard)
+		return threadshard;
+
+	for (shard = firstshard.load(std::memory_order_acquire); shard; shard = shard->next) {
+		bool expected = false;
+		if (shard->inuse.compare_exchange_strong(expected, true))
+			break;
+	}
+
+	if (!shard) {
+		shard = new statsshard;
+		for (auto &block : shard->blocks)
+			block.store(nullptr, std::memory_order_relaxed);
+		shard->inuse.store(true, std::memory_order_relaxed);
+		shard->next = firstshard.load(std::memory_order_relaxed);
+		while (!firstshard.compare_exchange_weak(shard->next, shard)) {
+		}
+	}
+
+	pthread_once(&shardkeyonce, stats_create_shard_key);
+	pthread_setspecific(shardkey, shard);
+	threadshard = shard;
+	return shard;
+}
+
+uint32_t stats_get_sharded_counter(statsnode *node, uint8_t hidezero) {
+	stats_lock();
+
+	if (!node->sharded && shardedcounters < SHARDBLOCKSIZE * MAXSHARDBLOCKS)
+		node->sharded = ++shardedcounters;
+	node->hidezero = hidezero;
+	if (node->sharded && !node->active) {
+		node->active = 1;
+		allactiveplengs += node->fnleng;
+		activenodes++;
+	}
+
+	stats_unlock();
+
+	return node->sharded;
+}
+
+void stats_sharded_add(uint32_t counter, uint64_t value) {
+	if (counter == 0)
+		return;
+
+	uint32_t index = counter - 1;
+	statsshard *shard = stats_get_thread_shard();
+	std::atomic<uint64_t> *block = shard->blocks[index / SHARDBLOCKSIZE].load(std::memory_order_relaxed);
+
+	if (!block) {
+		block = new std::atomic<uint64_t>[SHARDBLOCKSIZE];
+		for (uint32_t i = 0; i < SHARDBLOCKSIZE; i++)
+			block[i].store(0, std::memory_order_relaxed);
+		shard->blocks[index / SHARDBLOCKSIZE].store(block, std::memory_order_release);
+	}
+
+	// only the owner thread writes to the shard, so there is no need for an atomic increment
+	std::atomic<uint64_t> &c = block[index % SHARDBLOCKSIZE];
+	c.store(c.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+}
+
+static uint64_t stats_sharded_sum(uint32_t counter) {
+	uint32_t index = counter - 1;
+	uint64_t sum = 0;
+
+	for (statsshard *shard = firstshard.load(std::memory_order_acquire); shard; shard = shard->next) {
+		std::atomic<uint64_t> *block = shard->blocks[index / SHARDBLOCKSIZE].load(std::memory_order_acquire);
+		if (block)
+			sum += block[index % SHARDBLOCKSIZE].load(std::memory_order_relaxed);
+	}
+
+	return sum;
+}
+
+std::string stats_latency_bucket_name(int k) {
+	if (k == LatencyHistogram::kBuckets - 1)
+		return "lt_inf";
+	return "lt_" + std::to_string(LatencyHistogram::bucketLimit(k)) + "us";
+}
+
+void StatsLatencyHistogram::init(statsnode *node) {
+	// nodes are shown in reverse order of creation
+	for (int k = LatencyHistogram::kBuckets - 1; k >= 0; k--)
+		buckets_[k] = stats_get_sharded_counter(stats_get_subnode(node, stats_latency_bucket_name(k).c_str(), 0), 1);
+	sum_us_ = stats_get_sharded_counter(stats_get_subnode(node, "sum_us", 0), 0);
+	count_ = stats_get_sharded_counter(stats_get_subnode(node, "count", 0), 0);
+}
+
+void StatsLatencyHistogram::add(uint64_t latency_us) {
+	stats_sharded_add(count_, 1);
+	stats_sharded_add(sum_us_, latency_us);
+	stats_sharded_add(buckets_[LatencyHistogram::bucket(latency_us)], 1);
+}
+
 static inline void stats_reset(statsnode *node) {
 	statsnode *a;
 
+	if (node->sharded && !node->absolute)
+		node->shardedbase = stats_sharded_sum(node->sharded);
 	if (!node->absolute)
 		node->counter = 0;
 
@@ -124,7 +259,11 @@ void stats_reset_all(void) {
 }
 
 static inline uint32_t stats_print_values(char *buff, uint32_t maxleng, statsnode *n) {
-	uint32_t l = n->active ? snprintf(buff, maxleng, "%s: %" PRIu64 "\n", n->fullname, n->counter) : 0;
+	if (n->sharded)
+		n->counter = stats_sharded_sum(n->sharded) - n->shardedbase;
+
+	uint32_t l = (n->active && !(n->hidezero && n->counter == 0))
+			? snprintf(buff, maxleng, "%s: %" PRIu64 "\n", n->fullname, n->counter) : 0;
 
 	for (statsnode *a = n->firstchild; a; a = a->nextsibling)
 		if (maxleng > l)
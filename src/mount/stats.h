@@ -22,11 +22,17 @@
 #include "common/platform.h"
 
 #include <inttypes.h>
+#include <string>
+
+#include "common/latency_histogram.h"
 
 struct statsnode {
 	uint64_t counter;
 	uint8_t active;
 	uint8_t absolute;
+	uint8_t hidezero; // don't show the counter while it's 0
+	uint32_t sharded; // 1 + index of the sharded counter, 0 for ordinary counters
+	uint64_t shardedbase; // sum of shards at the last reset
 	char *name;
 	char *fullname;
 	uint32_t nleng; // : strlen(name)
@@ -42,3 +48,31 @@ void stats_show_all(char **buff, uint32_t *leng);
 void stats_lock(void);
 void stats_unlock(void);
 void stats_term(void);
+
+/*
+ * Sharded counters are updated without the stats lock: every thread adds to its own copy
+ * of the counter and the copies are summed up when the statistics are shown.
+ */
+uint32_t stats_get_sharded_counter(statsnode *node, uint8_t hidezero);
+void stats_sharded_add(uint32_t counter, uint64_t value);
+
+// name of the node of the k-th bucket of a latency histogram, e.g. "lt_1024us"
+std::string stats_latency_bucket_name(int k);
+
+/*
+ * Latency histogram kept in sharded counters, shown as "<node>.count", "<node>.sum_us" and
+ * one "<node>.lt_<limit>us" entry for each bucket of LatencyHistogram which isn't empty.
+ */
+class StatsLatencyHistogram {
+public:
+	StatsLatencyHistogram() : count_(0), sum_us_(0), buckets_() {
+	}
+
+	void init(statsnode *node);
+	void add(uint64_t latency_us);
+
+private:
+	uint32_t count_;
+	uint32_t sum_us_;
+	uint32_t buckets_[LatencyHistogram::kBuckets];
+};
@@ -0,0 +1,124 @@
+/*
+   Copyright 2017 Skytechnology sp. z o.o.
+
+   This file is part of LizardFS.
+
+   LizardFS is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, version 3.
+
+   LizardFS is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with LizardFS. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "common/platform.h"
+#include "mount/stats.h"
+
+#include <stdlib.h>
+#include <chrono>
+#include <functional>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+#include <gtest/gtest.h>
+
+static std::string show_stats() {
+	char *buff;
+	uint32_t leng;
+	stats_show_all(&buff, &leng);
+	std::string result(buff, leng);
+	free(buff);
+	return result;
+}
+
+TEST(Stats, ShardedCountersAreSummedUp) {
+	statsnode *s = stats_get_subnode(NULL, "sharded_test", 0);
+	uint32_t counter = stats_get_sharded_counter(stats_get_subnode(s, "ops", 0), 0);
+	uint32_t absolute = stats_get_sharded_counter(stats_get_subnode(s, "total", 1), 0);
+
+	std::vector<std::thread> threads;
+	for (int i = 0; i < 4; ++i) {
+		threads.emplace_back([=]() {
+			for (int j = 0; j < 1000; ++j) {
+				stats_sharded_add(counter, 1);
+				stats_sharded_add(absolute, 2);
+			}
+		});
+	}
+	for (auto &thread : threads) {
+		thread.join();
+	}
+	std::string stats = show_stats();
+	EXPECT_NE(std::string::npos, stats.find("sharded_test.ops: 4000\n"));
+	EXPECT_NE(std::string::npos, stats.find("sharded_test.total: 8000\n"));
+
+	stats_reset_all();
+	stats_sharded_add(counter, 5);
+	stats = show_stats();
+	EXPECT_NE(std::string::npos, stats.find("sharded_test.ops: 5\n"));
+	EXPECT_NE(std::string::npos, stats.find("sharded_test.total: 8000\n"));
+}
+
+TEST(Stats, LatencyHistogram) {
+	StatsLatencyHistogram histogram;
+	histogram.init(stats_get_subnode(NULL, "latency_test", 0));
+	histogram.add(0);
+	histogram.add(100);
+	histogram.add(127);
+	histogram.add(5000);
+
+	std::string stats = show_stats();
+	EXPECT_NE(std::string::npos, stats.find("latency_test.count: 4\n"));
+	EXPECT_NE(std::string::npos, stats.find("latency_test.sum_us: 5227\n"));
+	EXPECT_NE(std::string::npos, stats.find("latency_test.lt_1us: 1\n"));
+	EXPECT_NE(std::string::npos, stats.find("latency_test.lt_128us: 2\n"));
+	EXPECT_NE(std::string::npos, stats.find("latency_test.lt_8192us: 1\n"));
+	// Empty buckets are not shown
+	EXPECT_EQ(std::string::npos, stats.find("latency_test.lt_2us"));
+	EXPECT_LT(stats.find("latency_test.count"), stats.find("latency_test.lt_1us"));
+	EXPECT_LT(stats.find("latency_test.lt_1us"), stats.find("latency_test.lt_128us"));
+}
+
+TEST(Stats, ShardedCounterSpeed) {
+	uint32_t counter = stats_get_sharded_counter(
+			stats_get_subnode(stats_get_subnode(NULL, "speed_test", 0), "ops", 0), 0);
+	uint64_t *plain = stats_get_counterptr(
+			stats_get_subnode(stats_get_subnode(NULL, "speed_test", 0), "locked_ops", 0));
+	const int count = 1000000;
+	const int thread_count = 4;
+
+	auto measure = [&](std::function<void()> increment) {
+		auto start = std::chrono::steady_clock::now();
+		std::vector<std::thread> threads;
+		for (int i = 0; i < thread_count; ++i) {
+			threads.emplace_back([&]() {
+				for (int j = 0; j < count; ++j) {
+					increment();
+				}
+			});
+		}
+		for (auto &thread : threads) {
+			thread.join();
+		}
+		auto duration = std::chrono::steady_clock::now() - start;
+		return std::chrono::duration_cast<std::chrono::nanoseconds>(duration).count() / count;
+	};
+
+	auto sharded_ns = measure([&]() { stats_sharded_add(counter, 1); });
+	auto locked_ns = measure([&]() {
+		stats_lock();
+		(*plain)++;
+		stats_unlock();
+	});
+	std::cout << thread_count << " threads, ns per increment: sharded " << sharded_ns
+	          << ", locked " << locked_ns << std::endl;
+	std::string stats = show_stats();
+	EXPECT_NE(std::string::npos, stats.find("speed_test.ops: 4000000\n"));
+	EXPECT_NE(std::string::npos, stats.find("speed_test.locked_ops: 4000000\n"));
+}
@@ -67,6 +67,7 @@ namespace {
 
 struct inodedata {
 	uint32_t inode;
+	std::mutex mutex; // protects all the fields except next (see gInodeHashMutex) and lcnt
 	uint64_t maxfleng;
 	int status;
 	uint16_t flushwaiting;
@@ -81,6 +82,8 @@ struct inodedata {
 	std::condition_variable writecond; // wait for flushwaiting==0 (write)
 	inodedata *next;
 	std::unique_ptr<WriteChunkLocator> locator;
+	bool hasLease; // locator holds a chunk lock kept between jobs (see write lease)
+	Timer leaseTimer; // time since the leased lock was taken
 	int newDataInChainPipe[2];
 	bool workerWaitingForData;
 	Timer lastWriteToDataChain;
@@ -98,6 +101,7 @@ struct inodedata {
 			  minimumBlocksToWrite(1),
 			  alterations_in_chain(),
 			  next(nullptr),
+			  hasLease(false),
 			  workerWaitingForData(false) {
 #ifdef _WIN32
 		// We don't use inodeData->waitingworker and inodeData->pipe on Cygwin because
@@ -205,17 +209,44 @@ struct DelayedQueueEntry {
 } // anonymous namespace
 
 static std::atomic<uint32_t> maxretries;
-static std::mutex gMutex;
+
+/*
+ * Write cache state of each inode is protected by its own mutex (inodedata::mutex, called
+ * glock in comments below), so that writes to different files don't contend with each other.
+ * Hash of inodes (and inodedata::lcnt) is protected by gInodeHashMutex, the delayed queue
+ * by gDelayedQueueMutex. If more locks are needed, they are taken in this order.
+ * Free cache blocks are counted by an atomic counter, gFreeBlocksMutex is used only
+ * for waiting for free blocks.
+ */
 typedef std::unique_lock<std::mutex> Glock;
+static std::mutex gInodeHashMutex;
+static std::mutex gDelayedQueueMutex;
+static std::mutex gFreeBlocksMutex;
 
 static std::condition_variable fcbcond;
-static uint32_t fcbwaiting = 0;
-static int64_t freecacheblocks;
+static std::atomic<uint32_t> fcbwaiting(0);
+static std::atomic<int64_t> freecacheblocks;
 static inodedata **idhash;
 
 static uint32_t gWriteWindowSize;
 static uint32_t gChunkserverTimeout_ms;
 
+/*
+ * Write lease: the chunk lock taken from the master is kept between consecutive jobs writing
+ * the same chunk for at most gWriteLeaseTime_ms, so that appending to a file doesn't need
+ * a WRITE_CHUNK / WRITE_END round trip to the master for every batch of blocks. The new file
+ * length is sent to the master when the lease ends (flush, fsync, close, read, truncate,
+ * moving to the next chunk or the lease expiration). 0 disables leases.
+ */
+static uint32_t gWriteLeaseTime_ms;
+static const uint32_t kMaxWriteLeaseTime_s = 60; // must be lower than master's LOCKTIMEOUT
+
+/* glock: LOCKED */
+static bool write_lease_valid(inodedata *id) {
+	return id->hasLease && id->flushwaiting == 0
+			&& id->leaseTimer.elapsed_ms() < gWriteLeaseTime_ms;
+}
+
 // percentage of the free cache (1% - 100%) which can be used by one inode
 static uint32_t gCachePerInodePercentage;
 
@@ -228,29 +259,53 @@ static std::list<DelayedQueueEntry> delayedQueue;
 static ConnectionPool gChunkserverConnectionPool;
 static ChunkConnectorUsingPool gChunkConnector(gChunkserverConnectionPool);
 
-void write_cb_release_blocks(uint32_t count, Glock&) {
+void write_cb_release_blocks(uint32_t count) {
 	freecacheblocks += count;
-	if (fcbwaiting > 0 && freecacheblocks > 0) {
+	if (fcbwaiting > 0) {
+		std::lock_guard<std::mutex> lock(gFreeBlocksMutex);
 		fcbcond.notify_all();
 	}
 }
 
-void write_cb_acquire_blocks(uint32_t count, Glock&) {
+void write_cb_acquire_blocks(uint32_t count) {
 	freecacheblocks -= count;
 }
 
-void write_cb_wait_for_block(inodedata* id, Glock& glock) {
+/*
+ * Takes one block if there is any free block and the inode doesn't occupy
+ * too big part of the cache.
+ */
+static bool write_cb_try_acquire_block(uint64_t dataChainSize) {
+	int64_t freeBlocks = freecacheblocks;
+	while (freeBlocks > 0
+			// dataChainSize / (dataChainSize + freeBlocks) <= gCachePerInodePercentage / 100
+			// really means "0 <= 0"
+			&& dataChainSize * 100 <= (dataChainSize + freeBlocks) * gCachePerInodePercentage) {
+		if (freecacheblocks.compare_exchange_weak(freeBlocks, freeBlocks - 1)) {
+			return true;
+		}
+	}
+	return false;
+}
+
+/* glock: LOCKED (released while waiting) */
+void write_cb_wait_and_acquire_block(inodedata* id, Glock& glock) {
 	LOG_AVG_TILL_END_OF_SCOPE0("write_cb_wait_for_block");
-	fcbwaiting++;
 	uint64_t dataChainSize = id->dataChain.size();
-	while (freecacheblocks <= 0
-			// dataChainSize / (dataChainSize + freecacheblocks) > gCachePerInodePercentage / 100
-			// really means "0 > 0"
-			|| dataChainSize * 100 > (dataChainSize + freecacheblocks) * gCachePerInodePercentage)
+	if (write_cb_try_acquire_block(dataChainSize)) {
+		return;
+	}
+	// Let the worker of this inode write (and release) blocks while we are waiting
+	glock.unlock();
 	{
-		fcbcond.wait(glock);
+		std::unique_lock<std::mutex> lock(gFreeBlocksMutex);
+		fcbwaiting++;
+		while (!write_cb_try_acquire_block(dataChainSize)) {
+			fcbcond.wait(lock);
+		}
+		fcbwaiting--;
 	}
-	fcbwaiting--;
+	glock.lock();
 }
 
 /* inode */
@@ -295,11 +350,13 @@ void write_free_inodedata(inodedata* fid, Glock&) {
 
 /* delayed queue */
 
-static void delayed_queue_put(inodedata* id, uint32_t seconds, Glock&) {
+static void delayed_queue_put(inodedata* id, uint32_t seconds) {
+	std::lock_guard<std::mutex> lock(gDelayedQueueMutex);
 	delayedQueue.push_back(DelayedQueueEntry(id, seconds * DelayedQueueEntry::kTicksPerSecond));
 }
 
-static bool delayed_queue_remove(inodedata* id, Glock&) {
+static bool delayed_queue_remove(inodedata* id) {
+	std::lock_guard<std::mutex> lock(gDelayedQueueMutex);
 	for (auto it = delayedQueue.begin(); it != delayedQueue.end(); ++it) {
 		if (it->inodeData == id) {
 			delayedQueue.erase(it);
@@ -312,7 +369,7 @@ static bool delayed_queue_remove(inodedata* id, Glock&) {
 void* delayed_queue_worker(void*) {
 	for (;;) {
 		Timeout timeout(std::chrono::microseconds(1000000 / DelayedQueueEntry::kTicksPerSecond));
-		Glock lock(gMutex);
+		Glock lock(gDelayedQueueMutex);
 		auto it = delayedQueue.begin();
 		while (it != delayedQueue.end()) {
 			if (it->inodeData == NULL) {
@@ -333,9 +390,9 @@ void* delayed_queue_worker(void*) {
 
 /* queues */
 
-void write_delayed_enqueue(inodedata* id, uint32_t seconds, Glock& lock) {
+void write_delayed_enqueue(inodedata* id, uint32_t seconds, Glock&) {
 	if (seconds > 0) {
-		delayed_queue_put(id, seconds, lock);
+		delayed_queue_put(id, seconds);
 	} else {
 		queue_put(jqueue, 0, 0, (uint8_t*) id, 0);
 	}
@@ -348,10 +405,13 @@ void write_enqueue(inodedata* id, Glock&) {
 void write_job_delayed_end(inodedata* id, int status, int seconds, Glock &lock) {
 	LOG_AVG_TILL_END_OF_SCOPE0("write_job_delayed_end");
 	LOG_AVG_TILL_END_OF_SCOPE1("write_job_delayed_end#sec", seconds);
-	id->locator.reset();
 	if (status != LIZARDFS_STATUS_OK) {
 		lzfs_pretty_syslog(LOG_WARNING, "error writing file number %" PRIu32 ": %s", id->inode, lizardfs_error_string(status));
 		id->status = status;
+		id->hasLease = false;
+	}
+	if (!id->hasLease) {
+		id->locator.reset();
 	}
 	status = id->status;
 	if (id->requiresFlushing() > 0) {
@@ -361,9 +421,14 @@ void write_job_delayed_end(inodedata* id, int status, int seconds, Glock &lock)
 	if (!id->dataChain.empty() && status == LIZARDFS_STATUS_OK) { // still have some work to do
 		id->trycnt = 0; // on good write reset try counter
 		write_delayed_enqueue(id, seconds, lock);
+	} else if (id->hasLease) {
+		// No data, but the chunk is still locked -- check the lease again later. The inode
+		// stays in queue and keeps its length cache, because the master doesn't know it yet.
+		id->trycnt = 0;
+		write_delayed_enqueue(id, 1, lock);
 	} else {        // no more work or error occurred
 		// if this is an error then release all data blocks
-		write_cb_release_blocks(id->dataChain.size(), lock);
+		write_cb_release_blocks(id->dataChain.size());
 		id->dataChain.clear();
 		id->inqueue = false;
 		id->maxfleng = 0; // proper file length is now on the master server, remove our length cache
@@ -403,9 +468,17 @@ void InodeChunkWriter::processJob(inodedata* inodeData) {
 	inodeData_ = inodeData;
 
 	// First, choose index of some chunk to write
-	Glock lock(gMutex);
+	Glock lock(inodeData_->mutex);
 	int status = inodeData_->status;
 	bool haveDataToWrite;
+	if (inodeData_->hasLease && inodeData_->dataChain.empty() && status == LIZARDFS_STATUS_OK
+			&& write_lease_valid(inodeData_)) {
+		// Nothing to write yet, keep the lease until it expires or somebody flushes the data
+		write_job_delayed_end(inodeData_, LIZARDFS_STATUS_OK, 1, lock);
+		return;
+	}
+	bool leased = inodeData_->hasLease;
+	inodeData_->hasLease = false;
 	if (inodeData_->locator) {
 		// There is a chunk lock left by a previous unfinished job -- let's finish it!
 		chunkIndex_ = inodeData_->locator->chunkIndex();
@@ -425,6 +498,7 @@ void InodeChunkWriter::processJob(inodedata* inodeData) {
 		write_job_end(inodeData_, status, lock);
 		return;
 	}
+	Timer leaseTimer = inodeData_->leaseTimer;
 	lock.unlock();
 
 	/*  Process the job */
@@ -437,7 +511,10 @@ void InodeChunkWriter::processJob(inodedata* inodeData) {
 
 	try {
 		try {
-			locator->locateAndLockChunk(inodeData_->inode, chunkIndex_);
+			if (!leased) {
+				locator->locateAndLockChunk(inodeData_->inode, chunkIndex_);
+				leaseTimer.reset();
+			}
 
 			// Optimization -- talk with chunkservers only if we have to write any data.
 			// Don't do this if we just have to release some previously unlocked lock.
@@ -446,13 +523,29 @@ void InodeChunkWriter::processJob(inodedata* inodeData) {
 				processDataChain(writer);
 				writer.finish(kTimeToFinishOperations * 1000);
 
-				Glock lock(gMutex);
+				Glock lock(inodeData_->mutex);
 				returnJournalToDataChain(writer.releaseJournal(), lock);
 			}
-			locator->unlockChunk();
+			bool keepLease = false;
+			if (haveDataToWrite && gWriteLeaseTime_ms > 0) {
+				Glock lock(inodeData_->mutex);
+				// Keep the lock only if all the data left in the chain is in the same chunk
+				keepLease = inodeData_->flushwaiting == 0
+						&& leaseTimer.elapsed_ms() < gWriteLeaseTime_ms
+						&& !inodeData_->hasMultipleChunkIdsInChain()
+						&& (inodeData_->dataChain.empty() || haveAnyBlockInCurrentChunk(lock));
+				if (keepLease) {
+					inodeData_->locator = std::move(locator);
+					inodeData_->hasLease = true;
+					inodeData_->leaseTimer = leaseTimer;
+				}
+			}
+			if (!keepLease) {
+				locator->unlockChunk();
+			}
 			read_inode_ops(inodeData_->inode);
 
-			Glock lock(gMutex);
+			Glock lock(inodeData_->mutex);
 			inodeData_->minimumBlocksToWrite = writer.getMinimumBlockCountWorthWriting();
 			bool canWait = !inodeData_->requiresFlushing();
 			if (!haveAnyBlockInCurrentChunk(lock)) {
@@ -468,7 +561,12 @@ void InodeChunkWriter::processJob(inodedata* inodeData) {
 			write_job_delayed_end(inodeData_, LIZARDFS_STATUS_OK, (canWait ? 1 : 0), lock);
 		} catch (Exception& e) {
 			std::string errorString = e.what();
-			Glock lock(gMutex);
+			Glock lock(inodeData_->mutex);
+			if (!locator) {
+				// The lock was passed back to the inode as a lease just before the failure
+				locator = std::move(inodeData_->locator);
+				inodeData_->hasLease = false;
+			}
 			if (e.status() != LIZARDFS_ERROR_LOCKED) {
 				inodeData_->trycnt++;
 				errorString += " (try counter: " + std::to_string(inodeData->trycnt) + ")";
@@ -495,7 +593,7 @@ void InodeChunkWriter::processJob(inodedata* inodeData) {
 			}
 		}
 	} catch (UnrecoverableWriteException& e) {
-		Glock lock(gMutex);
+		Glock lock(inodeData_->mutex);
 		if (e.status() == LIZARDFS_ERROR_ENOENT) {
 			write_job_end(inodeData_, LIZARDFS_ERROR_EBADF, lock);
 		} else if (e.status() == LIZARDFS_ERROR_QUOTA) {
@@ -506,7 +604,7 @@ void InodeChunkWriter::processJob(inodedata* inodeData) {
 			write_job_end(inodeData_, LIZARDFS_ERROR_IO, lock);
 		}
 	} catch (Exception& e) {
-		Glock lock(gMutex);
+		Glock lock(inodeData_->mutex);
 		int waitTime = 1;
 		if (inodeData_->trycnt > 10) {
 			waitTime = std::min<int>(10, inodeData_->trycnt - 9);
@@ -539,13 +637,13 @@ void InodeChunkWriter::processDataChain(ChunkWriter& writer) {
 		bool can_expect_next_block = true;
 		if (wholeOperationTimer.elapsed_s() + kTimeToFinishOperations < maximumTime
 				&& writer.acceptsNewOperations()) {
-			Glock lock(gMutex);
+			Glock lock(inodeData_->mutex);
 			// While there is any block worth sending, we add new write operation
 			while (haveBlockWorthWriting(writer.getUnfinishedOperationsCount(), lock)) {
 				// Remove block from cache and pass it to the writer
 				writer.addOperation(std::move(inodeData_->dataChain.front()));
 				inodeData_->popFromChain();
-				write_cb_release_blocks(1, lock);
+				write_cb_release_blocks(1);
 			}
 			if (inodeData_->requiresFlushing() && !haveAnyBlockInCurrentChunk(lock)) {
 				// No more data and some flushing is needed or required, so flush everything
@@ -557,7 +655,7 @@ void InodeChunkWriter::processDataChain(ChunkWriter& writer) {
 			can_expect_next_block = haveAnyBlockInCurrentChunk(lock);
 		} else if (writer.acceptsNewOperations()) {
 			// We are running out of time...
-			Glock lock(gMutex);
+			Glock lock(inodeData_->mutex);
 			if (!inodeData_->requiresFlushing()) {
 				// Nobody is waiting for the data to be flushed and the data in write chain
 				// isn't too old. Let's postpone any operations
@@ -571,7 +669,7 @@ void InodeChunkWriter::processDataChain(ChunkWriter& writer) {
 		}
 
 		if (writer.startNewOperations(can_expect_next_block) > 0) {
-			Glock lock(gMutex);
+			Glock lock(inodeData_->mutex);
 			inodeData_->lastWriteToChunkservers.reset();
 		}
 		if (writer.getPendingOperationsCount() == 0) {
@@ -587,9 +685,9 @@ void InodeChunkWriter::processDataChain(ChunkWriter& writer) {
 	}
 }
 
-void InodeChunkWriter::returnJournalToDataChain(std::list<WriteCacheBlock> &&journal, Glock &lock) {
+void InodeChunkWriter::returnJournalToDataChain(std::list<WriteCacheBlock> &&journal, Glock &) {
 	if (!journal.empty()) {
-		write_cb_acquire_blocks(journal.size(), lock);
+		write_cb_acquire_blocks(journal.size());
 		uint64_t prev_id = journal.front().chunkIndex;
 		int alterations = (!inodeData_->dataChain.empty()
 				&& journal.back().chunkIndex != inodeData_->dataChain.front().chunkIndex) ? 1 : 0;
@@ -665,7 +763,8 @@ void* write_worker(void*) {
 
 /* API | glock: INITIALIZED,UNLOCKED */
 void write_data_init(uint32_t cachesize, uint32_t retries, uint32_t workers,
-		uint32_t writewindowsize, uint32_t chunkserverTimeout_ms, uint32_t cachePerInodePercentage) {
+		uint32_t writewindowsize, uint32_t chunkserverTimeout_ms, uint32_t cachePerInodePercentage,
+		uint32_t leaseTime_s) {
 	uint64_t cachebytecount = uint64_t(cachesize) * 1024 * 1024;
 	uint64_t cacheblockcount = (cachebytecount / MFSBLOCKSIZE);
 	uint32_t i;
@@ -674,6 +773,7 @@ void write_data_init(uint32_t cachesize, uint32_t retries, uint32_t workers,
 	gChunkConnector.setSourceIp(fs_getsrcip());
 	gWriteWindowSize = writewindowsize;
 	gChunkserverTimeout_ms = chunkserverTimeout_ms;
+	gWriteLeaseTime_ms = std::min(leaseTime_s, kMaxWriteLeaseTime_s) * 1000;
 	maxretries = retries;
 	if (cacheblockcount < 10) {
 		cacheblockcount = 10;
@@ -705,10 +805,7 @@ void write_data_term(void) {
 	uint32_t i;
 	inodedata *id, *idn;
 
-	{
-		Glock lock(gMutex);
-		delayed_queue_put(nullptr, 0, lock);
-	}
+	delayed_queue_put(nullptr, 0);
 	for (i = 0; i < write_worker_th.size(); i++) {
 		queue_put(jqueue, 0, 0, NULL, 0);
 	}
@@ -728,7 +825,7 @@ void write_data_term(void) {
 
 /* glock: UNLOCKED */
 int write_block(inodedata *id, uint32_t chindx, uint16_t pos, uint32_t from, uint32_t to, const uint8_t *data) {
-	Glock lock(gMutex);
+	Glock lock(id->mutex);
 	id->lastWriteToDataChain.reset();
 
 	// Try to expand the last block
@@ -744,8 +841,7 @@ int write_block(inodedata *id, uint32_t chindx, uint16_t pos, uint32_t from, uin
 	}
 
 	// Didn't manage to expand an existing block, so allocate a new one
-	write_cb_wait_for_block(id, lock);
-	write_cb_acquire_blocks(1, lock);
+	write_cb_wait_and_acquire_block(id, lock);
 	id->pushToChain(WriteCacheBlock(chindx, pos, WriteCacheBlock::kWritableBlock));
 	sassert(id->dataChain.back().expand(from, to, data));
 	if (id->inqueue) {
@@ -754,7 +850,7 @@ int write_block(inodedata *id, uint32_t chindx, uint16_t pos, uint32_t from, uin
 		// - there are at least two chunks in the write chain
 		if (id->trycnt == 0 && (id->dataChain.size() > id->minimumBlocksToWrite
 			|| id->dataChain.front().chunkIndex != id->dataChain.back().chunkIndex)) {
-			if (delayed_queue_remove(id, lock)) {
+			if (delayed_queue_remove(id)) {
 				write_enqueue(id, lock);
 			}
 		}
@@ -803,7 +899,7 @@ int write_data(void *vid, uint64_t offset, uint32_t size, const uint8_t* data) {
 		return LIZARDFS_ERROR_IO;
 	}
 
-	Glock lock(gMutex);
+	Glock lock(id->mutex);
 	status = id->status;
 	if (status == LIZARDFS_STATUS_OK) {
 		if (offset + size > id->maxfleng) {     // move fleng
@@ -835,20 +931,28 @@ static void write_data_flushwaiting_decrease(inodedata *id, Glock&) {
 	}
 }
 
+/* gInodeHashMutex: LOCKED */
 static void write_data_lcnt_increase(inodedata *id, Glock&) {
 	id->lcnt++;
 }
 
-static void write_data_lcnt_decrease(inodedata *id, Glock& lock) {
+/* gInodeHashMutex: UNLOCKED, glock: UNLOCKED */
+static void write_data_lcnt_decrease(inodedata *id) {
+	Glock hashLock(gInodeHashMutex);
 	id->lcnt--;
-	if (id->lcnt == 0 && !id->inqueue && id->flushwaiting == 0 && id->writewaiting == 0) {
-		write_free_inodedata(id, lock);
+	if (id->lcnt == 0) {
+		Glock lock(id->mutex);
+		if (!id->inqueue && id->flushwaiting == 0 && id->writewaiting == 0) {
+			// Nobody else can reach the inode now - it has no handles and isn't being written
+			lock.unlock();
+			write_free_inodedata(id, hashLock);
+		}
 	}
 }
 
 void* write_data_new(uint32_t inode) {
 	inodedata* id;
-	Glock lock(gMutex);
+	Glock lock(gInodeHashMutex);
 	id = write_get_inodedata(inode, lock);
 	if (id == NULL) {
 		return NULL;
@@ -865,7 +969,7 @@ static int write_data_flush(void* vid, Glock& lock) {
 
 	write_data_flushwaiting_increase(id, lock);
 	// If there are no errors (trycnt==0) and inode is waiting in the delayed queue, speed it up
-	if (id->trycnt == 0 && delayed_queue_remove(id, lock)) {
+	if (id->trycnt == 0 && delayed_queue_remove(id)) {
 		write_enqueue(id, lock);
 	}
 	// Wait for the data to be flushed
@@ -877,16 +981,21 @@ static int write_data_flush(void* vid, Glock& lock) {
 }
 
 int write_data_flush(void* vid) {
-	Glock lock(gMutex);
-	return write_data_flush(vid, lock);
+	inodedata* id = (inodedata*) vid;
+	if (id == NULL) {
+		return LIZARDFS_ERROR_IO;
+	}
+	Glock lock(id->mutex);
+	return write_data_flush(id, lock);
 }
 
 uint64_t write_data_getmaxfleng(uint32_t inode) {
 	uint64_t maxfleng;
 	inodedata* id;
-	Glock lock(gMutex);
-	id = write_find_inodedata(inode, lock);
+	Glock hashLock(gInodeHashMutex);
+	id = write_find_inodedata(inode, hashLock);
 	if (id) {
+		Glock lock(id->mutex);
 		maxfleng = id->maxfleng;
 	} else {
 		maxfleng = 0;
@@ -895,30 +1004,37 @@ uint64_t write_data_getmaxfleng(uint32_t inode) {
 }
 
 int write_data_flush_inode(uint32_t inode) {
-	Glock lock(gMutex);
-	inodedata* id = write_find_inodedata(inode, lock);
+	Glock hashLock(gInodeHashMutex);
+	inodedata* id = write_find_inodedata(inode, hashLock);
 	if (id == NULL) {
 		return 0;
 	}
+	// The inode won't be freed after releasing hashLock, because flushwaiting is increased
+	Glock lock(id->mutex);
+	hashLock.unlock();
 	return write_data_flush(id, lock);
 }
 
 int write_data_truncate(uint32_t inode, bool opened, uint32_t uid, uint32_t gid, uint64_t length,
 		Attributes& attr) {
-	Glock lock(gMutex);
+	Glock hashLock(gInodeHashMutex);
 
 	// 1. Flush writes but don't finish it completely - it'll be done at the end of truncate
-	inodedata* id = write_get_inodedata(inode, lock);
+	inodedata* id = write_get_inodedata(inode, hashLock);
 	if (id == NULL) {
 		return LIZARDFS_ERROR_IO;
 	}
-	write_data_lcnt_increase(id, lock);
+	write_data_lcnt_increase(id, hashLock);
+	hashLock.unlock();
+
+	Glock lock(id->mutex);
 	write_data_flushwaiting_increase(id, lock); // this will block any writing to this inode
 
 	int err = write_data_flush(id, lock);
 	if (err != 0) {
 		write_data_flushwaiting_decrease(id, lock);
-		write_data_lcnt_decrease(id, lock);
+		lock.unlock();
+		write_data_lcnt_decrease(id);
 		return err;
 	}
 
@@ -951,7 +1067,8 @@ int write_data_truncate(uint32_t inode, bool opened, uint32_t uid, uint32_t gid,
 	if (status != 0 || !writeNeeded) {
 		// Something failed or we have nothing to do more (master server managed to do the truncate)
 		write_data_flushwaiting_decrease(id, lock);
-		write_data_lcnt_decrease(id, lock);
+		lock.unlock();
+		write_data_lcnt_decrease(id);
 		if (status == LIZARDFS_STATUS_OK) {
 			return 0;
 		} else {
@@ -980,7 +1097,8 @@ int write_data_truncate(uint32_t inode, bool opened, uint32_t uid, uint32_t gid,
 		lock.lock();
 		if (err != 0) {
 			write_data_flushwaiting_decrease(id, lock);
-			write_data_lcnt_decrease(id, lock);
+			lock.unlock();
+			write_data_lcnt_decrease(id);
 			return err;
 		}
 
@@ -990,7 +1108,8 @@ int write_data_truncate(uint32_t inode, bool opened, uint32_t uid, uint32_t gid,
 		if (err != 0) {
 			// unlock the chunk here?
 			write_data_flushwaiting_decrease(id, lock);
-			write_data_lcnt_decrease(id, lock);
+			lock.unlock();
+			write_data_lcnt_decrease(id);
 			return err;
 		}
 	}
@@ -998,8 +1117,10 @@ int write_data_truncate(uint32_t inode, bool opened, uint32_t uid, uint32_t gid,
 	// Now we can tell the master server to finish the truncate operation and then unblock the inode
 	lock.unlock();
 	status = fs_truncateend(inode, uid, gid, length, lockId, attr);
+	lock.lock();
 	write_data_flushwaiting_decrease(id, lock);
-	write_data_lcnt_decrease(id, lock);
+	lock.unlock();
+	write_data_lcnt_decrease(id);
 
 	if (status != LIZARDFS_STATUS_OK) {
 		// status is now MFS status, so we cannot return any errno
@@ -1009,12 +1130,13 @@ int write_data_truncate(uint32_t inode, bool opened, uint32_t uid, uint32_t gid,
 }
 
 int write_data_end(void* vid) {
-	Glock lock(gMutex);
 	inodedata* id = (inodedata*) vid;
 	if (id == NULL) {
 		return LIZARDFS_ERROR_IO;
 	}
+	Glock lock(id->mutex);
 	int status = write_data_flush(id, lock);
-	write_data_lcnt_decrease(id, lock);
+	lock.unlock();
+	write_data_lcnt_decrease(id);
 	return status;
 }
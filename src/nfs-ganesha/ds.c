@@ -132,6 +132,8 @@ static nfsstat4 lzfs_fsal_ds_handle_read(struct fsal_ds_handle *const ds_hdl,
 	nb_read = liz_cred_read(lzfs_export->lzfs_instance, NULL, file_handle, offset, requested_length,
 	                        buffer);
 
+	lzfs_fsal_recall_layouts(lzfs_export);
+
 	if (nb_read < 0) {
 		return lzfs_nfs4_last_err();
 	}
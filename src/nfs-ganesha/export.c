@@ -60,6 +60,7 @@ static void lzfs_fsal_release(struct fsal_export *export_hdl) {
 		lzfs_export->fileinfo_cache = NULL;
 	}
 
+	lzfs_fsal_destroy_layout_recalls(lzfs_export);
 	liz_destroy(lzfs_export->lzfs_instance);
 	lzfs_export->lzfs_instance = NULL;
 	gsh_free(lzfs_export);
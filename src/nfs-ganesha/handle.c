@@ -891,6 +891,8 @@ static fsal_status_t lzfs_fsal_read2(struct fsal_obj_handle *obj_hdl, bool bypas
 		PTHREAD_RWLOCK_unlock(&obj_hdl->obj_lock);
 	}
 
+	lzfs_fsal_recall_layouts(lzfs_export);
+
 	return status;
 }
 
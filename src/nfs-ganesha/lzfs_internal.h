@@ -17,6 +17,7 @@
  */
 
 #include "fsal_api.h"
+#include "gsh_list.h"
 #include "FSAL/fsal_commonlib.h"
 
 #include "fileinfo_cache.h"
@@ -45,6 +46,10 @@ struct lzfs_fsal_export {
 	uint32_t fileinfo_cache_timeout;
 	uint32_t fileinfo_cache_max_size;
 	liz_init_params_t lzfs_params;
+
+	bool layout_recalls_enabled;
+	pthread_mutex_t layout_recalls_lock;
+	struct glist_head layout_recalls; /*< Files whose layouts have to be recalled */
 };
 
 struct lzfs_fsal_fd {
@@ -102,6 +107,9 @@ void lzfs_fsal_handle_ops_init(struct lzfs_fsal_export *lzfs_export, struct fsal
 void lzfs_fsal_handle_ops_pnfs(struct fsal_obj_ops *ops);
 void lzfs_fsal_export_ops_pnfs(struct export_ops *ops);
 void lzfs_fsal_ops_pnfs(struct fsal_ops *ops);
+void lzfs_fsal_init_layout_recalls(struct lzfs_fsal_export *lzfs_export);
+void lzfs_fsal_destroy_layout_recalls(struct lzfs_fsal_export *lzfs_export);
+void lzfs_fsal_recall_layouts(struct lzfs_fsal_export *lzfs_export);
 struct lzfs_fsal_handle *lzfs_fsal_new_handle(const struct stat *attr,
                                               struct lzfs_fsal_export *lzfs_export);
 void lzfs_fsal_delete_handle(struct lzfs_fsal_handle *obj);
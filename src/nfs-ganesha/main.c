@@ -123,6 +123,8 @@ static struct config_item lzfs_fsal_export_params[] = {
                    lzfs_params.cache_per_inode_percentage),
     CONF_ITEM_UI32("symlink_cache_timeout_s", 0, 60000, 3600, lzfs_fsal_export,
                    lzfs_params.symlink_cache_timeout_s),
+    CONF_ITEM_UI32("chunk_location_cache_timeout_ms", 0, 3600000, 1000, lzfs_fsal_export,
+                   lzfs_params.chunk_location_cache_timeout_ms),
 
     CONF_ITEM_BOOL("debug_mode", false, lzfs_fsal_export, lzfs_params.debug_mode),
     CONF_ITEM_I32("keep_cache", 0, 2, 0, lzfs_fsal_export, lzfs_params.keep_cache),
@@ -226,6 +228,9 @@ static fsal_status_t lzfs_fsal_create_export(struct fsal_module *fsal_hdl, void
 	if (lzfs_export->pnfs_mds_enabled) {
 		LogDebug(COMPONENT_PNFS, "pnfs mds was enabled for [%s]", op_ctx->ctx_export->fullpath);
 		lzfs_fsal_export_ops_pnfs(&lzfs_export->export.exp_ops);
+		if (lzfs_export->lzfs_params.chunk_location_cache_timeout_ms > 0) {
+			lzfs_fsal_init_layout_recalls(lzfs_export);
+		}
 	}
 
 	// get attributes for root inode
@@ -245,6 +250,7 @@ static fsal_status_t lzfs_fsal_create_export(struct fsal_module *fsal_hdl, void
 error:
 	if (lzfs_export) {
 		if (lzfs_export->lzfs_instance) {
+			lzfs_fsal_destroy_layout_recalls(lzfs_export);
 			liz_destroy(lzfs_export->lzfs_instance);
 		}
 		if (lzfs_export->fileinfo_cache) {
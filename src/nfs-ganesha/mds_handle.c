@@ -151,6 +151,116 @@ static nfsstat4 lzfs_fsal_layoutcommit(struct fsal_obj_handle *obj_pub,
 	return NFS4_OK;
 }
 
+struct lzfs_fsal_layout_recall {
+	struct glist_head list_hook;
+	liz_inode_t inode;
+};
+
+/*! \brief Remember that a file has an outdated layout
+ *
+ * Called by the client library when a cached location of a chunk of the file turned out
+ * to be outdated. It is called from inside a read, so the layout is recalled later,
+ * by lzfs_fsal_recall_layouts.
+ */
+static void lzfs_int_chunk_location_changed(liz_inode_t inode, uint32_t chunk_index, void *priv) {
+	struct lzfs_fsal_export *lzfs_export = priv;
+	struct lzfs_fsal_layout_recall *recall;
+	struct glist_head *node;
+
+	LogDebug(COMPONENT_PNFS, "location of chunk %" PRIu32 " of inode %" PRIu32 " changed",
+	         chunk_index, inode);
+
+	PTHREAD_MUTEX_lock(&lzfs_export->layout_recalls_lock);
+	glist_for_each(node, &lzfs_export->layout_recalls) {
+		recall = glist_entry(node, struct lzfs_fsal_layout_recall, list_hook);
+		if (recall->inode == inode) {
+			PTHREAD_MUTEX_unlock(&lzfs_export->layout_recalls_lock);
+			return;
+		}
+	}
+	recall = gsh_malloc(sizeof(struct lzfs_fsal_layout_recall));
+	recall->inode = inode;
+	glist_add_tail(&lzfs_export->layout_recalls, &recall->list_hook);
+	PTHREAD_MUTEX_unlock(&lzfs_export->layout_recalls_lock);
+}
+
+/*! \brief Start recalling layouts of files whose chunks change
+ *
+ * Data servers cache locations of chunks (so that they don't ask the master before every
+ * read), so clients are told to get new layouts when a chunk gets a new version or its
+ * parts move to other chunkservers.
+ */
+void lzfs_fsal_init_layout_recalls(struct lzfs_fsal_export *lzfs_export) {
+	PTHREAD_MUTEX_init(&lzfs_export->layout_recalls_lock, NULL);
+	glist_init(&lzfs_export->layout_recalls);
+	lzfs_export->layout_recalls_enabled = true;
+	liz_set_chunk_location_change_callback(lzfs_export->lzfs_instance,
+	                                       lzfs_int_chunk_location_changed, lzfs_export);
+}
+
+void lzfs_fsal_destroy_layout_recalls(struct lzfs_fsal_export *lzfs_export) {
+	struct lzfs_fsal_layout_recall *recall;
+
+	if (!lzfs_export->layout_recalls_enabled) {
+		return;
+	}
+
+	liz_set_chunk_location_change_callback(lzfs_export->lzfs_instance, NULL, NULL);
+	while ((recall = glist_first_entry(&lzfs_export->layout_recalls,
+	                                   struct lzfs_fsal_layout_recall, list_hook)) != NULL) {
+		glist_del(&recall->list_hook);
+		gsh_free(recall);
+	}
+	PTHREAD_MUTEX_destroy(&lzfs_export->layout_recalls_lock);
+	lzfs_export->layout_recalls_enabled = false;
+}
+
+/*! \brief Recall layouts of files remembered by lzfs_int_chunk_location_changed
+ *
+ * Has to be called without locks of object handles held.
+ */
+void lzfs_fsal_recall_layouts(struct lzfs_fsal_export *lzfs_export) {
+	struct lzfs_fsal_layout_recall *recall;
+	struct lzfs_fsal_key key;
+	struct gsh_buffdesc handle = {.addr = &key, .len = sizeof(struct lzfs_fsal_key)};
+	struct pnfs_segment segment = {
+	    .io_mode = LAYOUTIOMODE4_ANY, .offset = 0, .length = NFS4_UINT64_MAX};
+	state_status_t status;
+
+	if (!lzfs_export->layout_recalls_enabled) {
+		return;
+	}
+
+	while (true) {
+		PTHREAD_MUTEX_lock(&lzfs_export->layout_recalls_lock);
+		recall = glist_first_entry(&lzfs_export->layout_recalls, struct lzfs_fsal_layout_recall,
+		                           list_hook);
+		if (recall != NULL) {
+			glist_del(&recall->list_hook);
+		}
+		PTHREAD_MUTEX_unlock(&lzfs_export->layout_recalls_lock);
+		if (recall == NULL) {
+			break;
+		}
+
+		memset(&key, 0, sizeof(key));
+		key.module_id = FSAL_ID_EXPERIMENTAL;
+		key.export_id = lzfs_export->export.export_id;
+		key.inode = recall->inode;
+
+		status = lzfs_export->export.up_ops->layoutrecall(lzfs_export->export.up_ops, &handle,
+		                                                  LAYOUT4_NFSV4_1_FILES, true, &segment,
+		                                                  NULL, NULL);
+		if (status != STATE_SUCCESS && status != STATE_NOT_FOUND) {
+			LogMajor(COMPONENT_PNFS, "Failed to recall layouts of inode %" PRIu32 ": %s",
+			         recall->inode, state_err_str(status));
+		} else {
+			LogDebug(COMPONENT_PNFS, "Recalled layouts of inode %" PRIu32, recall->inode);
+		}
+		gsh_free(recall);
+	}
+}
+
 void lzfs_fsal_handle_ops_pnfs(struct fsal_obj_ops *ops) {
 	ops->layoutget = lzfs_fsal_layoutget;
 	ops->layoutreturn = lzfs_fsal_layoutreturn;
@@ -643,6 +643,14 @@ enum class SugidClearMode {
 /// version==0 chunkid:64 chunkversion:32 chunktype:8
 /// version==1 chunkid:64 chunkversion:32 chunktype:16
 
+// 0x04BF
+#define LIZ_CLTOCS_HDD_SCRUB_INFO (1000U + 215U)
+/// version==0 -
+
+// 0x04C0
+#define LIZ_CSTOCL_HDD_SCRUB_INFO (1000U + 216U)
+/// version==0 disks:(N * DiskScrubInfo)
+
 //CHUNKSERVER <-> CHUNKSERVER
 
 // 0x00FA
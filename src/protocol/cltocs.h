@@ -37,6 +37,9 @@ LIZARDFS_DEFINE_PACKET_SERIALIZATION(
 		uint64_t, chunkId, uint32_t, chunkVersion, ChunkPartType, chunkType,
 		uint32_t, readOffset, uint32_t, readSize)
 
+LIZARDFS_DEFINE_PACKET_SERIALIZATION(
+		cltocs, hddScrubInfo, LIZ_CLTOCS_HDD_SCRUB_INFO, 0)
+
 namespace cltocs {
 
 namespace read {
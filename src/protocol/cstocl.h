@@ -20,9 +20,14 @@
 
 #include "common/platform.h"
 
+#include "common/disk_info.h"
 #include "common/serialization_macros.h"
 #include "protocol/packet.h"
 
+LIZARDFS_DEFINE_PACKET_SERIALIZATION(
+		cstocl, hddScrubInfo, LIZ_CSTOCL_HDD_SCRUB_INFO, 0,
+		std::vector<DiskScrubInfo>, disks)
+
 namespace cstocl {
 
 namespace readData {
@@ -81,3 +81,36 @@ TEST(CltocsCommunicationTests, WriteStatus) {
 	LIZARDFS_VERIFY_INOUT_PAIR(writeId);
 	LIZARDFS_VERIFY_INOUT_PAIR(status);
 }
+
+TEST(CltocsCommunicationTests, HddScrubInfo) {
+	DiskScrubInfo disk;
+	disk.path = "/mnt/hdd1/";
+	disk.chunksInPass = 1000;
+	disk.chunksTestedInPass = 123;
+	disk.passStartTime = 1500000000;
+	disk.completedPasses = 2;
+	disk.lastPassEndTime = 1499999999;
+	disk.lastPassDuration = 86400;
+	disk.bytesLastMinute = 64 * 1024 * 1024;
+	disk.slowdown = 4;
+	std::vector<DiskScrubInfo> disksIn{disk, DiskScrubInfo()}, disksOut;
+
+	std::vector<uint8_t> buffer;
+	ASSERT_NO_THROW(cstocl::hddScrubInfo::serialize(buffer, disksIn));
+
+	verifyHeader(buffer, LIZ_CSTOCL_HDD_SCRUB_INFO);
+	removeHeaderInPlace(buffer);
+	ASSERT_NO_THROW(cstocl::hddScrubInfo::deserialize(buffer, disksOut));
+
+	ASSERT_EQ(2U, disksOut.size());
+	EXPECT_EQ(disk.path, disksOut[0].path);
+	EXPECT_EQ(disk.chunksInPass, disksOut[0].chunksInPass);
+	EXPECT_EQ(disk.chunksTestedInPass, disksOut[0].chunksTestedInPass);
+	EXPECT_EQ(disk.passStartTime, disksOut[0].passStartTime);
+	EXPECT_EQ(disk.completedPasses, disksOut[0].completedPasses);
+	EXPECT_EQ(disk.lastPassEndTime, disksOut[0].lastPassEndTime);
+	EXPECT_EQ(disk.lastPassDuration, disksOut[0].lastPassDuration);
+	EXPECT_EQ(disk.bytesLastMinute, disksOut[0].bytesLastMinute);
+	EXPECT_EQ(disk.slowdown, disksOut[0].slowdown);
+	EXPECT_EQ("", disksOut[1].path);
+}
@@ -0,0 +1,19 @@
+timeout_set 10 minutes
+
+CHUNKSERVERS=3 \
+	USE_RAMDISK=YES \
+	MOUNT_EXTRA_CONFIG="mfscachemode=NEVER" \
+	setup_local_empty_lizardfs info
+
+cd "${info[mount0]}"
+FILE_SIZE=512M file-generate file
+
+# All threads use the same descriptor, so the results show how well reads
+# on a single descriptor proceed concurrently
+for threads in 1 4 16; do
+	read_speed=$(parallel-pread file $threads 65536 $((4096 / threads)))
+	echo -e "${threads} threads\n${read_speed}" > "${TEMP_DIR}/pread_${threads}.csv"
+done
+
+paste -d, $TEMP_DIR/pread_1.csv $TEMP_DIR/pread_4.csv $TEMP_DIR/pread_16.csv \
+		| tee "${TEST_OUTPUT_DIR}/parallel_pread_single_descriptor_results.csv"
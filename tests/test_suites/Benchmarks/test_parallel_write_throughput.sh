@@ -0,0 +1,27 @@
+timeout_set 10 minutes
+
+CHUNKSERVERS=3 \
+	USE_RAMDISK=YES \
+	MOUNT_EXTRA_CONFIG="mfswriteworkers=32|mfswritecachesize=1024" \
+	setup_local_empty_lizardfs info
+
+file_size_mb=256
+cd "${info[mount0]}"
+
+# Each writer writes its own file, so the results show how the write cache of
+# a single mount scales with the number of concurrently written files
+for writers in 1 4 16; do
+	start_ns=$(date +%s%N)
+	for ((i = 0; i < writers; i++)); do
+		dd if=/dev/zero of="file_${writers}_${i}" bs=128K count=$((file_size_mb * 8)) \
+				conv=fsync 2>/dev/null &
+	done
+	wait
+	end_ns=$(date +%s%N)
+	write_speed=$(echo "scale=3;${writers}*${file_size_mb}*1000000000/(${end_ns}-${start_ns})" | bc)
+	echo -e "${writers} writers\n${write_speed}" > "${TEMP_DIR}/write_${writers}.csv"
+	rm -f file_${writers}_*
+done
+
+paste -d, $TEMP_DIR/write_1.csv $TEMP_DIR/write_4.csv $TEMP_DIR/write_16.csv \
+		| tee "${TEST_OUTPUT_DIR}/parallel_write_throughput_results.csv"
@@ -0,0 +1,41 @@
+timeout_set 3 minutes
+
+CHUNKSERVERS=3 \
+	MOUNTS=2 \
+	USE_RAMDISK=YES \
+	MOUNT_0_EXTRA_CONFIG="mfscachemode=NEVER,mfslocationcachetimeout=60000" \
+	MOUNT_1_EXTRA_CONFIG="mfscachemode=NEVER" \
+	setup_local_empty_lizardfs info
+
+stats_counter() {
+	grep "chunk_location_cache.$1:" "${info[mount0]}/.stats" | awk '{print $2}'
+}
+
+cd "${info[mount0]}"
+lizardfs setgoal 2 .
+FILE_SIZE=200M file-generate file
+
+# Many readers of one file, each with its own descriptor, share locations of its chunks
+for i in {1..8}; do
+	file-validate file &
+done
+wait
+sleep 1 # counters are copied to .stats periodically
+assert_less_than 0 "$(stats_counter hits)"
+assert_less_than 0 "$(stats_counter entries)"
+
+# Chunks overwritten by another client get new versions, old locations are not used for them
+dd if=/dev/zero of="${info[mount1]}/file" bs=1M count=100 seek=20 conv=notrunc
+expected_md5=$(md5sum "${info[mount1]}/file" | awk '{print $1}')
+assert_equals "$expected_md5" "$(md5sum file | awk '{print $1}')"
+
+# Holes are not cached, data written into them by another client is visible at once
+truncate -s 200M sparse
+head -c 100M sparse | md5sum > /dev/null
+dd if=/dev/urandom of="${info[mount1]}/sparse" bs=1M count=1 seek=20 conv=notrunc
+expected_sparse_md5=$(md5sum "${info[mount1]}/sparse" | awk '{print $1}')
+assert_equals "$expected_sparse_md5" "$(md5sum sparse | awk '{print $1}')"
+
+# Locations pointing to a stopped chunkserver are replaced
+lizardfs_chunkserver_daemon 0 stop
+assert_equals "$expected_md5" "$(md5sum file | awk '{print $1}')"
@@ -3,6 +3,7 @@
 : ${number_of_chunkservers:=12}
 : ${goals="2 3 4 5 6 7 8 9 xor2 xor3 xor4 xor5 xor6 xor7 xor8 xor9"}
 : ${verify_file_content=YES}
+: ${master_extra_config=}
 
 # Returns list of all chunks in the following format:
 # chunk 0000000000000001_00000001 parity 6
@@ -22,7 +23,8 @@ CHUNKSERVERS=$number_of_chunkservers \
 			`|CHUNKS_WRITE_REP_LIMIT = 10`
 			`|OPERATIONS_DELAY_INIT = 0`
 			`|OPERATIONS_DELAY_DISCONNECT = 0`
-			`|ACCEPTABLE_DIFFERENCE = 10" \
+			`|ACCEPTABLE_DIFFERENCE = 10`
+			`$master_extra_config" \
 	setup_local_empty_lizardfs info
 
 # Create files with goals from the $goals list
@@ -0,0 +1,4 @@
+goals="2 3 4 xor2 xor3"
+master_extra_config="|CHUNKS_LOOP_THREADS = 2"
+
+source $(readlink -m test_suites/ShortSystemTests/test_chunk_replication.sh)
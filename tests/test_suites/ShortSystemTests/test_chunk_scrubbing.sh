@@ -0,0 +1,41 @@
+CHUNKSERVERS=1 \
+	DISK_PER_CHUNKSERVER=2 \
+	MOUNT_EXTRA_CONFIG="mfscachemode=NEVER" \
+	CHUNKSERVER_EXTRA_CONFIG="HDD_TEST_FREQ = 0.05|HDD_TEST_BATCH_SIZE = 4" \
+	USE_RAMDISK=YES \
+	setup_local_empty_lizardfs info
+
+cd "${info[mount0]}"
+for i in {1..20}; do
+	FILE_SIZE=100K file-generate file_$i
+done
+
+# Every disk is tested completely, columns 35-37 are: tested chunks, chunks in pass, passes
+assert_eventually_prints 2 \
+		"lizardfs_probe_master list-disks --verbose | awk '\$37 > 0' | wc -l" "30 seconds"
+
+# Restart the chunkserver in the middle of a pass of its first disk, testing slowly enough
+# to see that the pass is resumed instead of being counted as completed
+lizardfs_chunkserver_daemon 0 stop
+hdd=$(sed -e 's/*//' "${info[chunkserver0_hdd]}" | head -n 1)
+cursor=$(find_chunkserver_chunks 0 | grep -F "$hdd/" \
+		| sed -E 's/.*_([0-9A-F]{16})_[0-9A-F]{8}[.](mfs|liz)$/\1/' | sort -u | sed -n 5p)
+echo "$((16#$cursor)) $(($(date +%s) - 100))" > "$hdd/.scrub_progress"
+sed -i -e 's/HDD_TEST_FREQ = 0.05/HDD_TEST_FREQ = 1/' "${info[chunkserver0_cfg]}"
+lizardfs_chunkserver_daemon 0 start
+lizardfs_wait_for_all_ready_chunkservers
+list_first_disk="lizardfs_probe_master list-disks --verbose | grep -F '$hdd/'"
+assert_eventually_prints 1 "$list_first_disk | awk '\$36 > 0' | wc -l" "30 seconds"
+assert_equals 0 "$(eval "$list_first_disk" | awk '{print $37}')"
+assert_less_or_equal 5 "$(eval "$list_first_disk" | awk '{print $35}')"
+# The resumed pass is completed and its duration includes the time before the restart
+assert_eventually_prints 1 "$list_first_disk | awk '\$37 > 0 && \$39 >= 100' | wc -l" \
+		"60 seconds"
+sed -i -e 's/HDD_TEST_FREQ = 1/HDD_TEST_FREQ = 0.05/' "${info[chunkserver0_cfg]}"
+lizardfs_chunkserver_daemon 0 reload
+
+# Damage a chunk and expect that the tester finds it
+chunk=$(find_chunkserver_chunks 0 | head -n 1)
+dd if=/dev/zero of="$chunk" bs=1 count=4 seek=100k conv=notrunc
+assert_eventually_prints 1 \
+		"lizardfs_probe_master list-disks | awk '\$6 != 0' | wc -l" "30 seconds"
@@ -0,0 +1,31 @@
+timeout_set 90 seconds
+
+# A full test of files would take 2 hours, so defective files have to be found by tests
+# driven by changes of health of chunks
+CHUNKSERVERS=2 \
+	USE_RAMDISK=YES \
+	MOUNT_EXTRA_CONFIG="mfscachemode=NEVER" \
+	MASTER_EXTRA_CONFIG="OPERATIONS_DELAY_INIT = 0|FILE_TEST_LOOP_MIN_TIME = 7200|OPERATIONS_DELAY_DISCONNECT = 0" \
+	setup_local_empty_lizardfs info
+
+cd ${info[mount0]}
+
+mkdir dir
+lizardfs setgoal 2 dir
+for i in {1..5}; do
+	FILE_SIZE=1K file-generate dir/file$i
+done
+
+lizardfs_chunkserver_daemon 0 stop
+assert_eventually_prints 5 "lizardfs_admin_master list-defective-files --undergoal --porcelain | wc -l"
+assert_equals 0 $(lizardfs_admin_master list-defective-files --unavailable --porcelain | wc -l)
+
+lizardfs_chunkserver_daemon 1 stop
+assert_eventually_prints 5 "lizardfs_admin_master list-defective-files --unavailable --porcelain | wc -l"
+assert_equals 0 $(lizardfs_admin_master list-defective-files --structure-error --porcelain | wc -l)
+
+lizardfs_chunkserver_daemon 0 start
+lizardfs_chunkserver_daemon 1 start
+lizardfs_wait_for_all_ready_chunkservers
+assert_eventually_prints 0 "lizardfs_admin_master list-defective-files --unavailable --porcelain | wc -l"
+assert_eventually_prints 0 "lizardfs_admin_master list-defective-files --undergoal --porcelain | wc -l"
@@ -0,0 +1,49 @@
+start_proxy() {
+	# Accept one connection from mfsmount on the fake port
+	socat tcp-listen:$1,reuseaddr system:"
+		socat stdio tcp\:$(get_ip_addr)\:$2 |  # connect to real server
+		{
+			dd bs=1k count=12k ;               # forward 12MB
+			sleep 1d ;                         # and go catatonic
+		}" &
+}
+
+tweak() {
+	awk -v name="$1" '$1 == name {print $2}' "${info[mount0]}/.lizardfs_tweaks"
+}
+
+if ! is_program_installed socat; then
+	test_fail "Configuration error, please install 'socat'"
+fi
+
+timeout_set 2 minutes
+
+# Wave and total read timeouts are long, so a read from a stalled chunkserver can be finished
+# quickly only by a hedged read from the other one
+CHUNKSERVERS=2 \
+	DISK_PER_CHUNKSERVER=1 \
+	MOUNT_EXTRA_CONFIG="mfscachemode=NEVER`
+			`|mfshedgepercentile=90`
+			`|mfschunkserverwavereadto=20000`
+			`|mfschunkservertotalreadto=60000" \
+	USE_RAMDISK=YES \
+	setup_local_empty_lizardfs info
+
+dir="${info[mount0]}/dir"
+mkdir "$dir"
+lizardfs setgoal 2 "$dir"
+FILE_SIZE=100M file-generate "$dir/file"
+
+port=${info[chunkserver0_port]}
+start_proxy $port $((port + 1000))
+lizardfs_chunkserver_daemon 0 stop
+LD_PRELOAD="$LIZARDFS_ROOT/lib/libredirect_bind.so" lizardfs_chunkserver_daemon 0 start
+lizardfs_wait_for_all_ready_chunkservers
+
+for i in {1..3}; do
+	if ! timeout 15s file-validate "$dir/file"; then
+		test_add_failure "Reading the file failed or took too long (attempt $i)"
+	fi
+done
+assert_less_than 0 "$(tweak ReadHedgesIssued)"
+assert_less_than 0 "$(tweak ReadHedgesWon)"
@@ -0,0 +1,91 @@
+timeout_set 2 minutes
+assert_program_installed setfacl setfattr getfattr
+
+CHUNKSERVERS=1 \
+	MASTERSERVERS=2 \
+	USE_RAMDISK=YES \
+	MOUNT_EXTRA_CONFIG="mfscachemode=NEVER,mfsdirentrycacheto=0,mfsaclcacheto=0" \
+	MASTER_EXTRA_CONFIG="SNAPSHOT_LAZY = 1|NO_ATIME = 1" \
+	DEBUG_LOG_FAIL_ON="master.fs.checksum.mismatch" \
+	setup_local_empty_lizardfs info
+
+lizardfs_master_n 1 start
+
+# Create a directory tree
+cd "${info[mount0]}"
+mkdir -p src/a/b/c src/d
+for dir in src src/a src/a/b src/a/b/c src/d; do
+	for i in 1 2; do
+		echo "$dir $i" > $dir/file$i
+	done
+done
+src_stats=$(lizardfs dirinfo src | grep -v path)
+
+# Lazy snapshot is created with a single changelog entry
+changelog_entries() {
+	grep -c "$1" "${info[master0_data_path]}"/changelog.mfs || true
+}
+assert_success lizardfs makesnapshot src snap
+assert_equals 1 $(changelog_entries LAZYCLONE)
+# ... and it already has statistics of its source
+assert_equals "$src_stats" "$(lizardfs dirinfo snap | grep -v path)"
+
+# Modifications of the source are not visible in the snapshot
+echo "modified" >> src/a/b/c/file1
+rm src/a/file2
+mkdir src/a/new
+echo "new" > src/d/file3
+expect_equals "src/a/b/c 1" "$(cat snap/a/b/c/file1)"
+expect_equals "src/a 2" "$(cat snap/a/file2)"
+assert_failure test -e snap/a/new
+assert_failure test -e snap/d/file3
+assert_equals "$src_stats" "$(lizardfs dirinfo snap | grep -v path)"
+
+# Extended attributes and ACLs are not copied to snapshots (as in regular snapshots)
+# and changing them in the source doesn't change the snapshot
+setfattr -n user.attr -v "src" src/a/file1
+setfacl -m user:nobody:rw src/a/b/file1
+src_mode=$(stat -c %a src/a/b/file1)
+assert_success lizardfs makesnapshot src snap_attr
+setfattr -n user.attr -v "modified" src/a/file1
+setfattr -n user.new -v "new" src/a/file2
+setfacl -m user:nobody:r src/a/b/file1
+assert_failure getfattr -n user.attr snap_attr/a/file1
+assert_failure getfattr -n user.new snap_attr/a/file2
+assert_equals "" "$(getfacl -cp snap_attr/a/b/file1 | grep user:nobody || true)"
+assert_equals "$src_mode" "$(stat -c %a snap_attr/a/b/file1)"
+
+# Reading a snapshot doesn't add changelog entries, its contents are materialized
+# and logged together with the next modification of metadata
+assert_success lizardfs makesnapshot src snap_read
+materialized=$(changelog_entries MATERIALIZE)
+ls -lR snap_read > /dev/null
+assert_equals $materialized $(changelog_entries MATERIALIZE)
+touch src/file3
+assert_less_than $materialized $(changelog_entries MATERIALIZE)
+
+# Modifications of the snapshot are not visible in the source
+assert_success lizardfs makesnapshot src snap2
+echo "modified" > snap2/d/file1
+rm -r snap2/a/b
+expect_equals "src/d 1" "$(cat src/d/file1)"
+expect_equals "src/a/b 1" "$(cat src/a/b/file1)"
+
+# Snapshot of a lazy snapshot
+assert_success lizardfs makesnapshot snap snap3
+expect_equals "$(find snap | sed 's/^snap//' | sort)" "$(find snap3 | sed 's/^snap3//' | sort)"
+
+# Removing whole snapshot
+assert_success lizardfs makesnapshot src snap4
+assert_success lizardfs rremove snap4
+assert_failure test -e snap4
+
+# Shadow master and metadata saved to disk have to be consistent with the master
+metadata=$(metadata_print)
+assert_eventually "lizardfs_shadow_synchronized 1"
+assert_success lizardfs_admin_master magic-recalculate-metadata-checksum
+cd
+lizardfs_master_daemon restart
+lizardfs_wait_for_all_ready_chunkservers
+cd "${info[mount0]}"
+assert_no_diff "$metadata" "$(metadata_print)"
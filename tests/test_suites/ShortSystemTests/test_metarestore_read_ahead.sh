@@ -0,0 +1,44 @@
+CHUNKSERVERS=1 \
+	USE_RAMDISK="YES" \
+	setup_local_empty_lizardfs info
+
+data_path="${info[master_data_path]}"
+
+# Create some metadata
+cd "${info[mount0]}"
+for dir in {0..9}; do
+	mkdir dir$dir
+	touch dir$dir/file{00..49}
+	setfattr -n user.tag -v "$dir" dir$dir/file{00..09}
+	mv dir$dir/file1{0..9} .
+	ln -s "dir$dir" link$dir
+	echo "data" > dir$dir/data
+done
+rm -f dir0/* file1*
+cd
+
+# Changelogs are restored after the master is killed, so that it doesn't dump metadata
+lizardfs_master_daemon kill
+changelog="$TEMP_DIR/changelog.mfs"
+cp "$data_path/changelog.mfs" "$changelog"
+entries=$(wc -l < "$changelog")
+assert_less_than 500 "$entries"
+
+# Split the changelog into overlapping files, so that they have to be merged
+head -n $((entries * 2 / 3)) "$changelog" > "$TEMP_DIR/changelog.mfs.2"
+tail -n $((entries * 2 / 3)) "$changelog" > "$TEMP_DIR/changelog.mfs.1"
+
+restore() {
+	mfsmetarestore -c "$@" -m "$data_path/metadata.mfs" -o "$TEMP_DIR/metadata_$RANDOM.mfs" \
+			"$TEMP_DIR/changelog.mfs.2" "$TEMP_DIR/changelog.mfs.1"
+}
+sequential_checksum=$(restore -S)
+read_ahead_checksum=$(restore)
+assert_not_equal "" "$read_ahead_checksum"
+assert_equals "$sequential_checksum" "$read_ahead_checksum"
+assert_equals "$sequential_checksum" "$(mfsmetarestore -c -S -m "$data_path/metadata.mfs" \
+		-o "$TEMP_DIR/metadata.mfs" "$changelog")"
+
+assert_success mfsmetarestore -a -d "$data_path"
+assert_equals "$sequential_checksum" "$(mfsmetarestore -c -m "$data_path/metadata.mfs" \
+		-o "$TEMP_DIR/metadata_restored.mfs")"
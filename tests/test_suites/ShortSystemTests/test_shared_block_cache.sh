@@ -0,0 +1,36 @@
+timeout_set 2 minutes
+
+CHUNKSERVERS=2 \
+	MOUNTS=2 \
+	USE_RAMDISK=YES \
+	MOUNT_0_EXTRA_CONFIG="mfscachemode=NEVER,mfssharedcachesize=64" \
+	MOUNT_1_EXTRA_CONFIG="mfscachemode=NEVER" \
+	setup_local_empty_lizardfs info
+
+stats_counter() {
+	grep "shared_cache.$1:" "${info[mount0]}/.stats" | awk '{print $2}'
+}
+
+cd "${info[mount0]}"
+FILE_SIZE=20M file-generate file
+
+# Many readers of one file, each with its own descriptor, share cached blocks
+for i in {1..8}; do
+	file-validate file &
+done
+wait
+sleep 1 # counters are copied to .stats periodically
+assert_less_than 0 "$(stats_counter hits)"
+assert_less_than "$(stats_counter misses)" "$(stats_counter hits)"
+
+# Data overwritten by another client is not read from cache after the file is reopened
+dd if=/dev/zero of="${info[mount1]}/file" bs=1M count=5 seek=2 conv=notrunc
+expected_md5=$(md5sum "${info[mount1]}/file" | awk '{print $1}')
+assert_equals "$expected_md5" "$(md5sum file | awk '{print $1}')"
+
+# Data overwritten locally is invalidated
+FILE_SIZE=20M file-generate file
+for i in {1..4}; do
+	file-validate file &
+done
+wait
@@ -0,0 +1,32 @@
+purge_rate=20
+files=200
+
+MOUNTS=2 \
+	CHUNKSERVERS=1 \
+	USE_RAMDISK=YES \
+	MFSEXPORTS_META_EXTRA_OPTIONS="nonrootmeta" \
+	MOUNT_1_EXTRA_CONFIG="mfsmeta" \
+	MASTER_EXTRA_CONFIG="TRASH_PURGE_MAX_RATE = $purge_rate" \
+	setup_local_empty_lizardfs info
+
+trash="${info[mount1]}/trash"
+
+files_in_trash() {
+	ls "$trash" | grep -v undel | wc -l
+}
+
+cd "${info[mount0]}"
+mkdir dir
+lizardfs settrashtime 1 dir
+for i in $(seq $files); do
+	touch dir/file$i
+done
+rm dir/file*
+
+# All files expire at once, but they are purged at most $purge_rate per second
+sleep 3
+assert_less_than 0 "$(files_in_trash)"
+begin_ts=$(timestamp)
+assert_eventually '[ $(files_in_trash) == 0 ]' "$((3 * files / purge_rate)) seconds"
+end_ts=$(timestamp)
+assert_less_or_equal "$((files / purge_rate - 5))" "$((end_ts - begin_ts))"
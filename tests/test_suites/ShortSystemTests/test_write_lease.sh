@@ -0,0 +1,24 @@
+timeout_set 2 minutes
+
+CHUNKSERVERS=2 \
+	MOUNTS=2 \
+	USE_RAMDISK=YES \
+	MOUNT_0_EXTRA_CONFIG="mfscachemode=NEVER,mfswritelease=3" \
+	MOUNT_1_EXTRA_CONFIG="mfscachemode=NEVER" \
+	setup_local_empty_lizardfs info
+
+cd "${info[mount0]}"
+
+# Many small appends spanning a few chunks are visible to other clients after close
+BLOCK_SIZE=4K FILE_SIZE=150M file-generate file
+assert_success file-validate "${info[mount1]}/file"
+
+# The writer sees its own length immediately, other clients when the lease expires
+exec 3>>appended
+head -c 100000 /dev/urandom >&3
+assert_equals 100000 "$(stat --format=%s appended)"
+assert_eventually_prints 100000 'stat --format=%s "${info[mount1]}/appended"' "10 seconds"
+head -c 100000 /dev/urandom >&3
+exec 3>&-
+assert_eventually_prints 200000 'stat --format=%s "${info[mount1]}/appended"'
+assert_equals "$(md5sum < appended)" "$(md5sum < "${info[mount1]}/appended")"
@@ -0,0 +1,130 @@
+/*
+   Copyright 2017 Skytechnology sp. z o.o.
+
+   This file is part of LizardFS.
+
+   LizardFS is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, version 3.
+
+   LizardFS is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with LizardFS. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+// Built with METARESTORE defined, as a part of the metarestore library is benchmarked
+#include "common/platform.h"
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "common/lizardfs_error_codes.h"
+#include "common/massert.h"
+#include "common/special_inode_defs.h"
+#include "master/chunks.h"
+#include "master/filesystem.h"
+#include "master/filesystem_metadata.h"
+#include "master/filesystem_store.h"
+#include "master/hstring_memstorage.h"
+#include "master/restore.h"
+#include "metarestore/merger.h"
+#include "microbench.h"
+
+namespace {
+
+const uint32_t kEntriesPerFile = 5;
+
+/*
+ * Writes a changelog with about 'entries' entries, which create files, write one chunk
+ * to each of them and change their attributes, as a busy master would.
+ * Returns the name of the file.
+ */
+std::string generateChangelog(uint64_t entries, uint64_t first_version) {
+	char name[] = "/tmp/lizardfs-microbench-changelog.XXXXXX";
+	int fd = mkstemp(name);
+	massert(fd >= 0, "can't create a temporary changelog");
+	FILE *changelog = fdopen(fd, "w");
+	massert(changelog != nullptr, "can't open a temporary changelog");
+	uint64_t version = first_version;
+	uint32_t ts = 1500000000;
+	for (uint64_t file = 0; file < (entries + kEntriesPerFile - 1) / kEntriesPerFile; ++file) {
+		uint32_t inode = SPECIAL_INODE_ROOT + 1 + file;
+		uint64_t chunkid = file + 1;
+		fprintf(changelog, "%" PRIu64 ": %" PRIu32 "|CREATE(1,file%" PRIu64 ",f,420,0,0,0):%"
+				PRIu32 "\n", version++, ts, file, inode);
+		fprintf(changelog, "%" PRIu64 ": %" PRIu32 "|WRITE(%" PRIu32 ",0,1,1):%" PRIu64 "\n",
+				version++, ts, inode, chunkid);
+		fprintf(changelog, "%" PRIu64 ": %" PRIu32 "|LENGTH(%" PRIu32 ",65536)\n",
+				version++, ts, inode);
+		fprintf(changelog, "%" PRIu64 ": %" PRIu32 "|UNLOCK(%" PRIu64 ")\n",
+				version++, ts, chunkid);
+		fprintf(changelog, "%" PRIu64 ": %" PRIu32 "|ATTR(%" PRIu32 ",416,1000,1000,%" PRIu32
+				",%" PRIu32 ")\n", version++, ts, inode, ts, ts);
+		ts++;
+	}
+	massert(fclose(changelog) == 0, "can't write a temporary changelog");
+	return name;
+}
+
+// Replays a generated changelog on an empty filesystem, one operation is one entry
+void replayChangelog(microbench::Run &run, bool read_ahead) {
+	if (gMetadata == nullptr) {
+		// names are kept in memory, as in mfsmetarestore
+		hstorage::Storage::reset(new hstorage::MemStorage());
+	}
+	delete gMetadata;
+	chunk_unload();
+	gMetadata = new FilesystemMetadata;
+	chunk_strinit();
+	fs_new();
+	restore_reset();
+	std::string changelog = generateChangelog(run.operations(), fs_getversion());
+	massert(merger_start({changelog}, 1000000) == 0, "can't start merging changelogs");
+	run.start();
+	uint8_t status = merger_loop(read_ahead);
+	run.stop();
+	unlink(changelog.c_str());
+	massert(status == LIZARDFS_STATUS_OK, "can't apply the generated changelog");
+	run.consume(fs_getversion());
+}
+
+} // anonymous namespace
+
+// Entries are read, merged and parsed by a separate thread, which is the default of
+// mfsmetarestore
+MICROBENCH(changelog_replay_read_ahead, 200000) {
+	replayChangelog(run, true);
+}
+
+// Parsing only, which read ahead moves out of the thread applying entries
+MICROBENCH(changelog_parse, 200000) {
+	std::string changelog = generateChangelog(run.operations(), 1);
+	std::vector<std::string> lines;
+	std::ifstream in(changelog);
+	for (std::string line; std::getline(in, line);) {
+		lines.push_back(line);
+	}
+	unlink(changelog.c_str());
+	RestoreEntry entry;
+	run.start();
+	for (const std::string &line : lines) {
+		char *end;
+		uint64_t version = strtoull(line.c_str(), &end, 10);
+		restore_parse(changelog.c_str(), version, end, entry);
+		run.consume(entry.status);
+	}
+}
+
+// Entries are read, parsed and applied by one thread, as mfsmetarestore -S does
+MICROBENCH(changelog_replay_in_place, 200000) {
+	replayChangelog(run, false);
+}
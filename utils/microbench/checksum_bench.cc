@@ -0,0 +1,92 @@
+/*
+   Copyright 2017 Skytechnology sp. z o.o.
+
+   This file is part of LizardFS.
+
+   LizardFS is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, version 3.
+
+   LizardFS is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with LizardFS. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "common/platform.h"
+
+#include <random>
+#include <vector>
+
+#include "common/crc.h"
+#include "common/galois_field.h"
+#include "protocol/MFSCommunication.h"
+#include "microbench.h"
+
+static std::vector<uint8_t> random_data(size_t size) {
+	std::mt19937 generator(size);
+	std::vector<uint8_t> data(size);
+	for (uint8_t &byte : data) {
+		byte = generator();
+	}
+	return data;
+}
+
+// One operation is a checksum of a whole block, as computed for every block read or written
+MICROBENCH(mycrc32_block, 20000) {
+	std::vector<uint8_t> block = random_data(MFSBLOCKSIZE);
+	run.start();
+	for (uint64_t i = 0; i < run.operations(); ++i) {
+		block[i % MFSBLOCKSIZE] = i;
+		run.consume(mycrc32(0, block.data(), block.size()));
+	}
+}
+
+MICROBENCH(mycrc32_combine, 1000000) {
+	run.start();
+	uint32_t crc = 0;
+	for (uint64_t i = 0; i < run.operations(); ++i) {
+		crc = mycrc32_combine(crc, i, MFSBLOCKSIZE);
+	}
+	run.consume(crc);
+}
+
+/*
+ * One operation encodes parity parts of one block of data split into 'k' data parts,
+ * the way chunkservers and clients compute parts of erasure coded chunks.
+ */
+static void galois_field_encode(microbench::Run &run, int k, int m) {
+	int part_size = MFSBLOCKSIZE / k;
+	std::vector<uint8_t> matrix((k + m) * k);
+	std::vector<uint8_t> tables(32 * k * m);
+	gf_gen_cauchy1_matrix(matrix.data(), k + m, k);
+	ec_init_tables(k, m, matrix.data() + k * k, tables.data());
+
+	std::vector<uint8_t> data = random_data(part_size * k);
+	std::vector<uint8_t> parity(part_size * m);
+	std::vector<uint8_t *> sources, destinations;
+	for (int i = 0; i < k; ++i) {
+		sources.push_back(data.data() + i * part_size);
+	}
+	for (int i = 0; i < m; ++i) {
+		destinations.push_back(parity.data() + i * part_size);
+	}
+
+	run.start();
+	for (uint64_t i = 0; i < run.operations(); ++i) {
+		data[i % data.size()] = i;
+		ec_encode_data(part_size, k, m, tables.data(), sources.data(), destinations.data());
+		run.consume(parity[i % parity.size()]);
+	}
+}
+
+MICROBENCH(galois_field_encode_ec_3_2, 20000) {
+	galois_field_encode(run, 3, 2);
+}
+
+MICROBENCH(galois_field_encode_ec_8_4, 10000) {
+	galois_field_encode(run, 8, 4);
+}
@@ -0,0 +1,162 @@
+/*
+   Copyright 2017 Skytechnology sp. z o.o.
+
+   This file is part of LizardFS.
+
+   LizardFS is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, version 3.
+
+   LizardFS is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with LizardFS. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "common/platform.h"
+
+#include <random>
+#include <vector>
+
+#include "common/compact_vector.h"
+#include "common/flat_map.h"
+#include "common/lru_cache.h"
+#include "common/ring_buffer.h"
+#ifdef LIZARDFS_HAVE_JUDY
+#  include "common/judy_map.h"
+#endif
+#include "microbench.h"
+
+static std::vector<uint32_t> random_keys(uint64_t count, uint32_t range) {
+	std::mt19937 generator(count);
+	std::vector<uint32_t> keys(count);
+	for (uint32_t &key : keys) {
+		key = generator() % range;
+	}
+	return keys;
+}
+
+// Maps of a directory size, as they are used e.g. for children of a node
+static constexpr uint32_t kFlatMapSize = 1000;
+
+MICROBENCH(flat_map_insert, 1000000) {
+	std::vector<uint32_t> keys = random_keys(kFlatMapSize, UINT32_MAX);
+	run.start();
+	for (uint64_t done = 0; done < run.operations(); done += keys.size()) {
+		flat_map<uint32_t, uint32_t> map;
+		for (uint32_t key : keys) {
+			map.insert({key, key});
+		}
+		run.consume(map.size());
+	}
+}
+
+MICROBENCH(flat_map_find, 1000000) {
+	std::vector<uint32_t> keys = random_keys(kFlatMapSize, 2 * kFlatMapSize);
+	flat_map<uint32_t, uint32_t> map;
+	for (uint32_t i = 0; i < kFlatMapSize; ++i) {
+		map.insert({2 * i, i});
+	}
+	run.start();
+	for (uint64_t i = 0; i < run.operations(); ++i) {
+		run.consume(map.find(keys[i % keys.size()]) != map.end());
+	}
+}
+
+MICROBENCH(compact_vector_push_back, 1000000) {
+	// Vectors of chunk ids of small files
+	run.start();
+	for (uint64_t done = 0; done < run.operations(); done += 8) {
+		compact_vector<uint64_t> vector;
+		for (uint64_t i = 0; i < 8; ++i) {
+			vector.push_back(done + i);
+		}
+		run.consume(vector.size());
+	}
+}
+
+MICROBENCH(compact_vector_iterate, 10000000) {
+	std::vector<compact_vector<uint32_t, uint32_t>> vectors(1000);
+	for (size_t i = 0; i < vectors.size(); ++i) {
+		vectors[i].resize(i % 32, i);
+	}
+	run.start();
+	uint64_t done = 0;
+	while (done < run.operations()) {
+		for (const auto &vector : vectors) {
+			for (uint32_t value : vector) {
+				run.consume(value);
+			}
+			done += vector.size();
+		}
+	}
+}
+
+#ifdef LIZARDFS_HAVE_JUDY
+
+MICROBENCH(judy_map_insert, 1000000) {
+	std::vector<uint32_t> keys = random_keys(run.operations(), UINT32_MAX);
+	judy_map<uint32_t, uint64_t> map;
+	run.start();
+	for (uint32_t key : keys) {
+		map[key] = key;
+	}
+	run.consume(map.size());
+}
+
+MICROBENCH(judy_map_find, 1000000) {
+	std::vector<uint32_t> keys = random_keys(run.operations(), 1 << 20);
+	judy_map<uint32_t, uint64_t> map;
+	for (uint32_t key = 0; key < (1 << 20); key += 2) {
+		map[key] = key;
+	}
+	run.start();
+	for (uint32_t key : keys) {
+		run.consume(map.find(key) != map.end());
+	}
+}
+
+#endif // LIZARDFS_HAVE_JUDY
+
+typedef LruCache<LruCacheOption::UseHashMap, LruCacheOption::NotReentrant, uint64_t, uint64_t>
+		HashLruCache;
+
+MICROBENCH(lru_cache_get_hit, 1000000) {
+	HashLruCache cache(std::chrono::seconds(60), 10000);
+	SteadyTimePoint now = SteadyClock::now();
+	auto obtainer = [](uint64_t key) { return key * 2; };
+	for (uint64_t key = 0; key < 10000; ++key) {
+		cache.get(now, key, obtainer);
+	}
+	run.start();
+	for (uint64_t i = 0; i < run.operations(); ++i) {
+		run.consume(cache.get(now, i % 10000, obtainer));
+	}
+}
+
+MICROBENCH(lru_cache_get_miss, 1000000) {
+	// Every get evicts the oldest entry
+	HashLruCache cache(std::chrono::seconds(60), 10000);
+	SteadyTimePoint now = SteadyClock::now();
+	auto obtainer = [](uint64_t key) { return key * 2; };
+	run.start();
+	for (uint64_t i = 0; i < run.operations(); ++i) {
+		run.consume(cache.get(now, i, obtainer));
+	}
+}
+
+MICROBENCH(ring_buffer_push_pop, 10000000) {
+	RingBuffer<uint64_t, 64> buffer;
+	run.start();
+	for (uint64_t i = 0; i < run.operations(); ++i) {
+		if (buffer.full()) {
+			run.consume(buffer[0]);
+			buffer.pop_front();
+		}
+		buffer.push_back(i);
+	}
+	run.consume(buffer.size());
+}
@@ -0,0 +1,99 @@
+/*
+   Copyright 2017 Skytechnology sp. z o.o.
+
+   This file is part of LizardFS.
+
+   LizardFS is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, version 3.
+
+   LizardFS is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with LizardFS. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "common/platform.h"
+
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "common/io_limiting.h"
+#include "protocol/MFSCommunication.h"
+#include "microbench.h"
+
+using namespace ioLimiting;
+
+namespace {
+
+// Grants everything, so that only the cost of limiting in the client is measured
+struct UnlimitedLimiter : public Limiter {
+	uint64_t request(const IoLimitGroupId&, uint64_t size) override {
+		return size;
+	}
+};
+
+const int kThreads = 64;
+
+/*
+ * One operation is an assignment of one block to one of kThreads threads, which all
+ * request blocks of the same group at the same time.
+ */
+template <typename RequestFunction>
+void contendedRequests(microbench::Run &run, RequestFunction request) {
+	UnlimitedLimiter limiter;
+	SharedState shared(limiter, std::chrono::milliseconds(100));
+	RTClock clock;
+	Group group(shared, "group", clock);
+	std::mutex mutex;
+	std::atomic<bool> go(false);
+	std::atomic<uint64_t> granted(0);
+	std::vector<std::thread> threads;
+	for (int i = 0; i < kThreads; ++i) {
+		threads.emplace_back([&]() {
+			while (!go) {
+				std::this_thread::yield();
+			}
+			SteadyTimePoint deadline = clock.now() + std::chrono::seconds(60);
+			uint64_t count = 0;
+			for (uint64_t j = 0; j < run.operations() / kThreads; ++j) {
+				count += request(group, mutex, deadline);
+			}
+			granted += count;
+		});
+	}
+	run.start();
+	go = true;
+	for (auto &thread : threads) {
+		thread.join();
+	}
+	run.consume(granted);
+}
+
+} // anonymous namespace
+
+// Every request waits in the queue of the group, as all requests did before tokens were
+// kept per CPU
+MICROBENCH(io_limit_group_wait_64_threads, 640000) {
+	contendedRequests(run, [](Group &group, std::mutex &mutex, SteadyTimePoint deadline) {
+		std::unique_lock<std::mutex> lock(mutex);
+		return group.wait(MFSBLOCKSIZE, deadline, lock) == LIZARDFS_STATUS_OK;
+	});
+}
+
+// Requests take tokens left on their CPUs and wait only when there are not enough of them,
+// as requests passed to LimiterProxy do
+MICROBENCH(io_limit_group_take_64_threads, 640000) {
+	contendedRequests(run, [](Group &group, std::mutex &mutex, SteadyTimePoint deadline) {
+		if (group.tryTake(MFSBLOCKSIZE)) {
+			return true;
+		}
+		std::unique_lock<std::mutex> lock(mutex);
+		return group.wait(MFSBLOCKSIZE, deadline, lock) == LIZARDFS_STATUS_OK;
+	});
+}
@@ -0,0 +1,121 @@
+/*
+   Copyright 2017 Skytechnology sp. z o.o.
+
+   This file is part of LizardFS.
+
+   LizardFS is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, version 3.
+
+   LizardFS is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with LizardFS. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/**
+ * Micro-benchmarks of containers and hot-path primitives.
+ *
+ * Usage:
+ *  lizardfs-microbench [-l] [-f <filter>] [-w <warmup runs>] [-r <repetitions>]
+ *                      [-s <scale>] [-j <json file>]
+ *
+ * Prints nanoseconds per operation of every benchmark and optionally writes them
+ * as JSON, which can be compared with results of another build using
+ * microbench_compare.py.
+ */
+
+#include "common/platform.h"
+
+#include <unistd.h>
+#include <algorithm>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+
+#include "common/crc.h"
+#include "microbench.h"
+
+static void usage(const char *appname) {
+	std::cerr << "Usage: " << appname << " [-l] [-f filter] [-w warmup] [-r repetitions] "
+	          << "[-s scale] [-j file]\n"
+	          << "\n"
+	          << "-l   - list benchmarks\n"
+	          << "-f   - run only benchmarks with names containing the filter\n"
+	          << "-w   - number of runs before measuring (default 1)\n"
+	          << "-r   - number of measured runs (default 10)\n"
+	          << "-s   - multiply number of operations in every run (default 1.0)\n"
+	          << "-j   - write results as JSON to the file\n";
+}
+
+int main(int argc, char **argv) {
+	microbench::Options options;
+	std::string json_file;
+	bool list = false;
+	int ch;
+
+	while ((ch = getopt(argc, argv, "lf:w:r:s:j:h?")) != -1) {
+		switch (ch) {
+			case 'l':
+				list = true;
+				break;
+			case 'f':
+				options.filter = optarg;
+				break;
+			case 'w':
+				options.warmup = atoi(optarg);
+				break;
+			case 'r':
+				options.repetitions = atoi(optarg);
+				break;
+			case 's':
+				options.scale = atof(optarg);
+				break;
+			case 'j':
+				json_file = optarg;
+				break;
+			default:
+				usage(argv[0]);
+				return 1;
+		}
+	}
+	if (optind != argc || options.repetitions == 0 || options.scale <= 0) {
+		usage(argv[0]);
+		return 1;
+	}
+
+	mycrc32_init();
+	std::vector<microbench::Result> results;
+	if (!list) {
+		microbench::printHeader(std::cout);
+	}
+	std::vector<microbench::Benchmark> benchmarks = microbench::registry();
+	std::sort(benchmarks.begin(), benchmarks.end(),
+			[](const microbench::Benchmark &a, const microbench::Benchmark &b) {
+				return a.name < b.name;
+			});
+	for (const microbench::Benchmark &benchmark : benchmarks) {
+		if (benchmark.name.find(options.filter) == std::string::npos) {
+			continue;
+		}
+		if (list) {
+			std::cout << benchmark.name << "\n";
+			continue;
+		}
+		results.push_back(microbench::run(benchmark, options));
+		microbench::printResult(std::cout, results.back());
+	}
+
+	if (!json_file.empty()) {
+		std::ofstream out(json_file);
+		microbench::writeJson(out, results);
+		if (!out) {
+			std::cerr << "Can't write results to " << json_file << "\n";
+			return 1;
+		}
+	}
+	return 0;
+}
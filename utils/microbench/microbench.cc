@@ -0,0 +1,122 @@
+/*
+   Copyright 2017 Skytechnology sp. z o.o.
+
+   This file is part of LizardFS.
+
+   LizardFS is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, version 3.
+
+   LizardFS is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with LizardFS. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "common/platform.h"
+#include "microbench.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <numeric>
+
+namespace microbench {
+
+std::vector<Benchmark> &registry() {
+	static std::vector<Benchmark> benchmarks;
+	return benchmarks;
+}
+
+double percentile(const std::vector<double> &sorted, double percent) {
+	if (sorted.empty()) {
+		return 0;
+	}
+	double position = percent / 100 * (sorted.size() - 1);
+	size_t lower = std::floor(position);
+	size_t upper = std::min(lower + 1, sorted.size() - 1);
+	double fraction = position - lower;
+	return sorted[lower] + (sorted[upper] - sorted[lower]) * fraction;
+}
+
+// The result of every run is printed to /dev/null, so that it is really computed
+static void discard(uint64_t sink) {
+	static FILE *null = fopen("/dev/null", "w");
+	if (null) {
+		fprintf(null, "%lu", (unsigned long)sink);
+	}
+}
+
+Result run(const Benchmark &benchmark, const Options &options) {
+	uint64_t operations = std::max<uint64_t>(1, std::llround(benchmark.operations * options.scale));
+	for (uint32_t i = 0; i < options.warmup; ++i) {
+		Run warmup(operations);
+		benchmark.function(warmup);
+		discard(warmup.sink());
+	}
+
+	std::vector<double> samples;
+	for (uint32_t i = 0; i < options.repetitions; ++i) {
+		Run measured(operations);
+		measured.start();
+		benchmark.function(measured);
+		int64_t elapsed_ns = measured.elapsedNs();
+		discard(measured.sink());
+		samples.push_back(static_cast<double>(elapsed_ns) / operations);
+	}
+	std::sort(samples.begin(), samples.end());
+
+	Result result;
+	result.name = benchmark.name;
+	result.operations = operations;
+	result.repetitions = samples.size();
+	result.min = samples.empty() ? 0 : samples.front();
+	result.max = samples.empty() ? 0 : samples.back();
+	result.mean = samples.empty() ? 0 :
+	              std::accumulate(samples.begin(), samples.end(), 0.0) / samples.size();
+	result.p50 = percentile(samples, 50);
+	result.p90 = percentile(samples, 90);
+	result.p99 = percentile(samples, 99);
+	return result;
+}
+
+void printHeader(std::ostream &out) {
+	char line[256];
+	snprintf(line, sizeof(line), "%-40s %12s %10s %10s %10s %10s  (ns/op)\n", "benchmark",
+	         "operations", "min", "p50", "p90", "max");
+	out << line;
+}
+
+void printResult(std::ostream &out, const Result &result) {
+	char line[256];
+	snprintf(line, sizeof(line), "%-40s %12lu %10.2f %10.2f %10.2f %10.2f\n", result.name.c_str(),
+	         (unsigned long)result.operations, result.min, result.p50, result.p90, result.max);
+	out << line;
+}
+
+static std::string jsonNumber(double value) {
+	char buffer[64];
+	snprintf(buffer, sizeof(buffer), "%.3f", value);
+	return buffer;
+}
+
+void writeJson(std::ostream &out, const std::vector<Result> &results) {
+	// Benchmark names are identifiers, so they don't need escaping
+	out << "{\n  \"unit\": \"ns/op\",\n  \"benchmarks\": [";
+	for (size_t i = 0; i < results.size(); ++i) {
+		const Result &result = results[i];
+		out << (i == 0 ? "\n" : ",\n");
+		out << "    {\"name\": \"" << result.name << "\", \"operations\": " << result.operations
+		    << ", \"repetitions\": " << result.repetitions << ", \"min\": "
+		    << jsonNumber(result.min) << ", \"mean\": " << jsonNumber(result.mean)
+		    << ", \"p50\": " << jsonNumber(result.p50) << ", \"p90\": " << jsonNumber(result.p90)
+		    << ", \"p99\": " << jsonNumber(result.p99) << ", \"max\": " << jsonNumber(result.max)
+		    << "}";
+	}
+	out << "\n  ]\n}\n";
+}
+
+} // namespace microbench
@@ -0,0 +1,135 @@
+/*
+   Copyright 2017 Skytechnology sp. z o.o.
+
+   This file is part of LizardFS.
+
+   LizardFS is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, version 3.
+
+   LizardFS is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with LizardFS. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include "common/platform.h"
+
+#include <cstdint>
+#include <functional>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "common/time_utils.h"
+
+namespace microbench {
+
+/*! \brief State of a single measured run of a benchmark.
+ *
+ * A benchmark performs operations() operations of the measured kind. Work done before
+ * the call to start() (e.g. filling a container which is then searched) is not measured.
+ * Results of the operations should be passed to consume(), so that the compiler
+ * cannot optimize the work away.
+ */
+class Run {
+public:
+	explicit Run(uint64_t operations) : operations_(operations), sink_(0), elapsed_ns_(-1) {
+	}
+
+	uint64_t operations() const {
+		return operations_;
+	}
+
+	void start() {
+		timer_.reset();
+	}
+
+	void stop() {
+		elapsed_ns_ = timer_.elapsed_ns();
+	}
+
+	void consume(uint64_t value) {
+		sink_ += value;
+	}
+
+	uint64_t sink() const {
+		return sink_;
+	}
+
+	/// Measured time, the whole run is measured if stop() wasn't called.
+	int64_t elapsedNs() const {
+		return elapsed_ns_ >= 0 ? elapsed_ns_ : timer_.elapsed_ns();
+	}
+
+private:
+	uint64_t operations_;
+	uint64_t sink_;
+	int64_t elapsed_ns_;
+	Timer timer_;
+};
+
+typedef std::function<void(Run &)> BenchmarkFunction;
+
+struct Benchmark {
+	std::string name;
+	uint64_t operations;  ///< Default number of operations in one run.
+	BenchmarkFunction function;
+};
+
+struct Options {
+	Options() : warmup(1), repetitions(10), scale(1.0) {
+	}
+
+	uint32_t warmup;        ///< Runs done before measuring.
+	uint32_t repetitions;   ///< Measured runs.
+	double scale;           ///< Multiplier of the number of operations in a run.
+	std::string filter;     ///< Only benchmarks with names containing it are run.
+};
+
+/// Statistics of nanoseconds per operation over all measured runs of a benchmark.
+struct Result {
+	std::string name;
+	uint64_t operations;
+	uint32_t repetitions;
+	double min, mean, p50, p90, p99, max;
+};
+
+std::vector<Benchmark> &registry();
+
+struct Registrar {
+	Registrar(const char *name, uint64_t operations, BenchmarkFunction function) {
+		registry().push_back(Benchmark{name, operations, std::move(function)});
+	}
+};
+
+/// Returns value at the given percentile (0-100) of sorted samples, interpolating linearly.
+double percentile(const std::vector<double> &sorted, double percent);
+
+Result run(const Benchmark &benchmark, const Options &options);
+
+void printHeader(std::ostream &out);
+void printResult(std::ostream &out, const Result &result);
+void writeJson(std::ostream &out, const std::vector<Result> &results);
+
+} // namespace microbench
+
+/*! \brief Defines a benchmark doing about 'operations' operations in one run.
+ *
+ * Usage:
+ *   MICROBENCH(flat_map_find, 1000000) {
+ *     ... setup ...
+ *     run.start();
+ *     for (uint64_t i = 0; i < run.operations(); ++i) { ... }
+ *   }
+ */
+#define MICROBENCH(name, operations) \
+	static void microbench_##name(microbench::Run &run); \
+	static microbench::Registrar microbench_registrar_##name(#name, operations, \
+			microbench_##name); \
+	static void microbench_##name(microbench::Run &run)
@@ -0,0 +1,60 @@
+#!/usr/bin/env python3
+"""Compares two result files written by `lizardfs-microbench -j`.
+
+Usage:
+  microbench_compare.py [--threshold PERCENT] BASELINE.json CURRENT.json
+
+Prints the change of the median time of every benchmark present in both files.
+A benchmark regressed if its median grew by more than the threshold (default 10%)
+and its fastest run is slower than the median of the baseline, so that noise of single
+runs is not reported. Exits with 1 if any benchmark regressed, 0 otherwise.
+"""
+
+import argparse
+import json
+import sys
+from typing import Any, Dict, List
+
+
+def load(path: str) -> Dict[str, Dict[str, Any]]:
+    with open(path) as results_file:
+        results = json.load(results_file)
+    return {benchmark["name"]: benchmark for benchmark in results["benchmarks"]}
+
+
+def compare(baseline: Dict[str, Dict[str, Any]], current: Dict[str, Dict[str, Any]],
+            threshold: float) -> List[str]:
+    regressions = []
+    print("%-40s %12s %12s %9s" % ("benchmark", "baseline", "current", "change"))
+    for name in sorted(set(baseline) | set(current)):
+        if name not in baseline or name not in current:
+            print("%-40s %s" % (name, "only in current" if name in current else "only in baseline"))
+            continue
+        old = baseline[name]
+        new = current[name]
+        change = 100.0 * (new["p50"] - old["p50"]) / old["p50"] if old["p50"] > 0 else 0.0
+        regressed = change > threshold and new["min"] > old["p50"]
+        if regressed:
+            regressions.append(name)
+        print("%-40s %12.2f %12.2f %8.1f%%%s" % (name, old["p50"], new["p50"], change,
+                                                 "  REGRESSION" if regressed else ""))
+    return regressions
+
+
+def main() -> int:
+    parser = argparse.ArgumentParser(description="Compare two lizardfs-microbench results.")
+    parser.add_argument("--threshold", type=float, default=10.0,
+                        help="allowed growth of the median time in percents")
+    parser.add_argument("baseline")
+    parser.add_argument("current")
+    args = parser.parse_args()
+
+    regressions = compare(load(args.baseline), load(args.current), args.threshold)
+    if regressions:
+        print("%d benchmark(s) regressed: %s" % (len(regressions), ", ".join(regressions)))
+        return 1
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
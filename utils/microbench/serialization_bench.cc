@@ -0,0 +1,83 @@
+/*
+   Copyright 2017 Skytechnology sp. z o.o.
+
+   This file is part of LizardFS.
+
+   LizardFS is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, version 3.
+
+   LizardFS is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with LizardFS. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "common/platform.h"
+
+#include <string>
+#include <vector>
+
+#include "common/serialization.h"
+#include "microbench.h"
+
+// Fields of a typical small message: ids, a name and a list of ids
+struct Message {
+	uint32_t message_id;
+	uint32_t inode;
+	uint64_t chunk_id;
+	std::string name;
+	std::vector<uint32_t> ids;
+};
+
+static Message example_message() {
+	return Message{1, 12345, 0x1122334455667788ULL, "some_file_name.txt", {1, 2, 3, 4, 5, 6, 7, 8}};
+}
+
+MICROBENCH(serialize_message, 1000000) {
+	Message message = example_message();
+	std::vector<uint8_t> buffer;
+	run.start();
+	for (uint64_t i = 0; i < run.operations(); ++i) {
+		buffer.clear();
+		message.inode = i;
+		serialize(buffer, message.message_id, message.inode, message.chunk_id, message.name,
+				message.ids);
+		run.consume(buffer.size());
+	}
+}
+
+MICROBENCH(deserialize_message, 1000000) {
+	Message message = example_message();
+	std::vector<uint8_t> buffer;
+	serialize(buffer, message.message_id, message.inode, message.chunk_id, message.name,
+			message.ids);
+	run.start();
+	for (uint64_t i = 0; i < run.operations(); ++i) {
+		Message result;
+		deserialize(buffer, result.message_id, result.inode, result.chunk_id, result.name,
+				result.ids);
+		run.consume(result.inode + result.ids.size());
+	}
+}
+
+MICROBENCH(serialize_integers, 10000000) {
+	// Raw put/get of fixed size integers, used by every packet header
+	std::vector<uint8_t> buffer(8 * 1024);
+	run.start();
+	uint8_t *destination = buffer.data();
+	for (uint64_t i = 0; i < run.operations(); ++i) {
+		if (destination + 8 > buffer.data() + buffer.size()) {
+			destination = buffer.data();
+		}
+		serialize(&destination, i);
+	}
+	const uint8_t *source = buffer.data();
+	uint32_t bytes_left = buffer.size();
+	uint64_t value;
+	deserialize(&source, bytes_left, value);
+	run.consume(value);
+}
@@ -0,0 +1,82 @@
+/**
+ * Multi-threaded pread benchmark.
+ *
+ * Usage:
+ *  ./exe <file> <threads> <block-size> <reads-per-thread>
+ *
+ * Opens the file once and runs <threads> threads, each of them calling pread
+ * <reads-per-thread> times on the shared descriptor, with <block-size> bytes from
+ * random aligned offsets. Prints the total throughput in MiB/s.
+ *
+ * The executable returns 0 on success and 1 on any error.
+ */
+
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <random>
+#include <thread>
+#include <vector>
+
+int main(int argc, char *argv[]) {
+	if (argc != 5) {
+		std::cerr << "Usage: " << argv[0] << " <file> <threads> <block-size> <reads-per-thread>\n";
+		return 1;
+	}
+	int threads = std::atoi(argv[2]);
+	std::size_t block_size = std::atol(argv[3]);
+	int reads_per_thread = std::atoi(argv[4]);
+	if (threads <= 0 || block_size == 0 || reads_per_thread <= 0) {
+		std::cerr << "Invalid arguments\n";
+		return 1;
+	}
+
+	int fd = ::open(argv[1], O_RDONLY);
+	struct stat st;
+	if (fd == -1 || ::fstat(fd, &st) != 0) {
+		std::cerr << "Cannot open " << argv[1] << ": " << strerror(errno) << '\n';
+		return 1;
+	}
+	off_t blocks = st.st_size / block_size;
+	if (blocks == 0) {
+		std::cerr << "File " << argv[1] << " is smaller than a single block\n";
+		return 1;
+	}
+
+	std::atomic<bool> failed(false);
+	std::vector<std::thread> workers;
+	auto start = std::chrono::steady_clock::now();
+	for (int i = 0; i < threads; ++i) {
+		workers.emplace_back([=, &failed]() {
+			std::mt19937 generator(i);
+			std::vector<char> buffer(block_size);
+			for (int j = 0; j < reads_per_thread && !failed; ++j) {
+				off_t offset = (generator() % blocks) * block_size;
+				if (::pread(fd, buffer.data(), block_size, offset) != (ssize_t)block_size) {
+					std::cerr << "pread at " << offset << " failed: " << strerror(errno) << '\n';
+					failed = true;
+				}
+			}
+		});
+	}
+	for (auto &worker : workers) {
+		worker.join();
+	}
+	auto duration = std::chrono::steady_clock::now() - start;
+	::close(fd);
+	if (failed) {
+		return 1;
+	}
+
+	double seconds = std::chrono::duration<double>(duration).count();
+	double mebibytes = double(threads) * reads_per_thread * block_size / (1024 * 1024);
+	std::cout << mebibytes / seconds << '\n';
+	return 0;
+}
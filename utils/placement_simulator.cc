@@ -0,0 +1,390 @@
+/*
+   Copyright 2017 Skytechnology sp. z o.o.
+
+   This file is part of LizardFS.
+
+   LizardFS is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, version 3.
+
+   LizardFS is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with LizardFS. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/**
+ * Offline simulator of placement of new chunks.
+ *
+ * Usage:
+ *  lizardfs-placement-simulator [-p policy[,policy...]] [-s servers file] [-n chunks]
+ *                               [-r chunks per second] [-g copies] [-c changelog]
+ *                               [-L load penalty] [-R replication penalty] [-a difference]
+ *
+ * Replays a stream of writes against a modelled cluster, placing new chunks with
+ * GetServersForNewChunk and the given placement policies (as the master does), and
+ * prints per policy: skew of disk usage, traffic needed to rebalance the cluster and
+ * latencies of chunk writes.
+ *
+ * The stream is synthetic (-n chunks created with the rate -r) or derived from a changelog
+ * (-c): every WRITE of a chunk not seen before creates it and writes to known chunks load
+ * their servers again, at times given by the changelog.
+ *
+ * Every line of the servers file describes one chunkserver:
+ *   <total GiB> <used GiB> <chunk writes per second> <replications in progress>
+ * By default a cluster of 12 servers is modelled, some of them fuller, slower or busy
+ * replicating. Writes to a server are queued and served with its rate, replications in
+ * progress take a part of it. Servers report their used space and load (busy part of
+ * the last second) once a second, like chunkservers do.
+ */
+
+#include "common/platform.h"
+
+#include <unistd.h>
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "common/media_label.h"
+#include "master/chunk_placement_policy.h"
+#include "master/get_servers_for_new_chunk.h"
+#include "protocol/MFSCommunication.h"
+
+static const double kGiB = 1024. * 1024. * 1024.;
+// Time step of the simulation in seconds
+static const double kStep = 0.01;
+// Part of write rate of a server taken by every replication in progress
+static const double kReplicationCost = 0.05;
+
+struct ServerModel {
+	double total_space;
+	double used_space;
+	double write_rate;
+	double reported_used_space;  ///< Used space known to the master.
+	uint32_t replications;
+
+	double queue;          ///< Chunk writes waiting or being served.
+	double busy_time;      ///< Time spent serving writes since the last load report.
+	uint8_t load_factor;   ///< Last reported load.
+	uint64_t chunks_created;
+};
+
+struct WriteEvent {
+	double time;
+	uint64_t chunk_id;  ///< Chunk not written before is created.
+};
+
+struct Options {
+	Options()
+	    : policies("free_space,load_aware"),
+	      chunks(20000),
+	      rate(100),
+	      copies(2),
+	      load_penalty(0.5),
+	      replication_penalty(0.1),
+	      acceptable_difference(0.1) {
+	}
+
+	std::string policies;
+	std::string servers_file;
+	std::string changelog;
+	uint64_t chunks;
+	double rate;
+	int copies;
+	double load_penalty;
+	double replication_penalty;
+	double acceptable_difference;
+};
+
+static std::vector<ServerModel> default_cluster() {
+	std::vector<ServerModel> servers;
+	// total TiB, used part, writes/s, replications
+	const double cluster[][4] = {
+		{4, 0.50, 40, 0}, {4, 0.50, 40, 0}, {4, 0.55, 40, 0}, {4, 0.45, 40, 0},
+		{8, 0.30, 60, 0}, {8, 0.35, 60, 0}, {8, 0.30, 60, 8}, {8, 0.40, 60, 0},
+		{4, 0.20, 10, 0}, {4, 0.25, 10, 0},  // new but slow disks
+		{4, 0.70, 40, 4}, {4, 0.65, 40, 0},
+	};
+	for (const auto &server : cluster) {
+		servers.push_back(ServerModel{server[0] * 1024 * kGiB, server[0] * 1024 * kGiB * server[1],
+		                              server[2], server[0] * 1024 * kGiB * server[1],
+		                              (uint32_t)server[3], 0, 0, 0, 0});
+	}
+	return servers;
+}
+
+static bool load_cluster(const std::string &filename, std::vector<ServerModel> &servers) {
+	std::ifstream file(filename);
+	if (!file) {
+		std::cerr << "Can't open " << filename << "\n";
+		return false;
+	}
+	std::string line;
+	while (std::getline(file, line)) {
+		if (line.empty() || line[0] == '#') {
+			continue;
+		}
+		std::istringstream fields(line);
+		double total, used, rate;
+		uint32_t replications;
+		if (!(fields >> total >> used >> rate >> replications) || used > total || rate <= 0) {
+			std::cerr << "Invalid server description: " << line << "\n";
+			return false;
+		}
+		servers.push_back(ServerModel{total * kGiB, used * kGiB, rate, used * kGiB, replications,
+		                              0, 0, 0, 0});
+	}
+	return !servers.empty();
+}
+
+static std::vector<WriteEvent> synthetic_stream(uint64_t chunks, double rate) {
+	std::vector<WriteEvent> events;
+	for (uint64_t i = 0; i < chunks; ++i) {
+		events.push_back(WriteEvent{i / rate, i + 1});
+	}
+	return events;
+}
+
+// Lines look like "<version>: <timestamp>|WRITE(<inode>,<index>[,<opflag>[,<lockid>]]):<chunkid>"
+static bool changelog_stream(const std::string &filename, std::vector<WriteEvent> &events) {
+	std::ifstream file(filename);
+	if (!file) {
+		std::cerr << "Can't open " << filename << "\n";
+		return false;
+	}
+	std::string line;
+	uint64_t first_timestamp = 0;
+	std::vector<WriteEvent> second;  // events of one second are spread evenly
+	uint64_t second_timestamp = 0;
+	auto flush = [&]() {
+		for (size_t i = 0; i < second.size(); ++i) {
+			second[i].time += double(i) / second.size();
+			events.push_back(second[i]);
+		}
+		second.clear();
+	};
+	while (std::getline(file, line)) {
+		size_t separator = line.find(": ");
+		size_t bar = line.find('|');
+		if (separator == std::string::npos || bar == std::string::npos ||
+		    line.compare(bar + 1, 6, "WRITE(") != 0) {
+			continue;
+		}
+		uint64_t timestamp = strtoull(line.c_str() + separator + 2, nullptr, 10);
+		size_t colon = line.rfind(':');
+		uint64_t chunk_id = strtoull(line.c_str() + colon + 1, nullptr, 10);
+		if (first_timestamp == 0) {
+			first_timestamp = second_timestamp = timestamp;
+		}
+		if (timestamp != second_timestamp) {
+			flush();
+			second_timestamp = timestamp;
+		}
+		second.push_back(WriteEvent{double(timestamp - first_timestamp), chunk_id});
+	}
+	flush();
+	return true;
+}
+
+struct Statistics {
+	std::vector<double> latencies;
+	double max_queue = 0;
+};
+
+static void advance(std::vector<ServerModel> &servers, double time, double &now,
+		double &next_report) {
+	while (now + kStep <= time) {
+		now += kStep;
+		for (ServerModel &server : servers) {
+			double rate = server.write_rate *
+			              std::max(0.2, 1. - kReplicationCost * server.replications);
+			double served = std::min(server.queue, rate * kStep);
+			server.queue -= served;
+			server.busy_time += served / rate;
+		}
+		if (now >= next_report) {
+			for (ServerModel &server : servers) {
+				server.load_factor = std::min(100., 100. * server.busy_time);
+				server.reported_used_space = server.used_space;
+				server.busy_time = 0;
+			}
+			next_report += 1.0;
+		}
+	}
+}
+
+// Queues a chunk write on the server and returns time after which it will be finished
+static double write_chunk(ServerModel &server) {
+	double rate = server.write_rate * std::max(0.2, 1. - kReplicationCost * server.replications);
+	server.queue += 1;
+	return server.queue / rate;
+}
+
+static void simulate(const ChunkPlacementPolicy &policy, std::vector<ServerModel> servers,
+		const std::vector<WriteEvent> &events, const Options &options) {
+	ChunkCreationHistory history;
+	Statistics statistics;
+	std::unordered_map<uint64_t, std::vector<int>> chunk_servers;
+	double now = 0, next_report = 1.0;
+
+	Goal::Slice::Labels labels = {{MediaLabel::kWildcard, options.copies}};
+	Goal::Slice::ConstPartProxy proxy(
+	    vector_range<const Goal::Slice::DataContainer, Goal::Slice::SizeContainer::value_type>(
+	        labels.data(), 0, labels.size()));
+
+	for (const WriteEvent &event : events) {
+		advance(servers, event.time, now, next_report);
+		std::vector<int> &chosen = chunk_servers[event.chunk_id];
+		if (chosen.empty()) {
+			GetServersForNewChunk getter;
+			for (size_t i = 0; i < servers.size(); ++i) {
+				const ServerModel &server = servers[i];
+				if (server.total_space - server.reported_used_space < MFSCHUNKSIZE) {
+					continue;
+				}
+				ChunkserverPlacementInfo info(server.reported_used_space, server.total_space,
+				                              server.load_factor, server.replications);
+				getter.addServer(reinterpret_cast<matocsserventry *>(i + 1),
+				                 MediaLabel::kWildcard, policy.weight(info), 0, server.load_factor);
+			}
+			getter.prepareData(history);
+			std::vector<matocsserventry *> used;
+			for (matocsserventry *server : getter.chooseServersForLabels(history, proxy, 0, used)) {
+				int index = reinterpret_cast<intptr_t>(server) - 1;
+				chosen.push_back(index);
+				servers[index].used_space += MFSCHUNKSIZE;
+				servers[index].chunks_created++;
+			}
+		}
+		double latency = 0;
+		for (int index : chosen) {
+			latency = std::max(latency, write_chunk(servers[index]));
+			statistics.max_queue = std::max(statistics.max_queue, servers[index].queue);
+		}
+		statistics.latencies.push_back(latency);
+	}
+
+	double total = 0, used = 0, min_usage = 1, max_usage = 0;
+	for (const ServerModel &server : servers) {
+		total += server.total_space;
+		used += server.used_space;
+		min_usage = std::min(min_usage, server.used_space / server.total_space);
+		max_usage = std::max(max_usage, server.used_space / server.total_space);
+	}
+	// Chunks over the acceptable difference from the average usage have to be moved
+	double average = used / total, rebalance = 0;
+	for (const ServerModel &server : servers) {
+		double limit = (average + options.acceptable_difference / 2) * server.total_space;
+		rebalance += std::max(0., server.used_space - limit);
+	}
+
+	std::vector<double> &latencies = statistics.latencies;
+	std::sort(latencies.begin(), latencies.end());
+	auto percentile = [&latencies](double percent) {
+		return latencies.empty() ? 0. : latencies[std::min<size_t>(
+				latencies.size() - 1, latencies.size() * percent / 100)];
+	};
+
+	printf("policy %s:\n", policy.name());
+	printf("  usage skew: %.2f%% (min %.2f%%, max %.2f%%), rebalance traffic: %.1f GiB\n",
+	       100 * (max_usage - min_usage), 100 * min_usage, 100 * max_usage, rebalance / kGiB);
+	printf("  write latency: p50 %.3f s, p99 %.3f s, p99.9 %.3f s, max %.3f s, max queue %.0f\n",
+	       percentile(50), percentile(99), percentile(99.9), latencies.empty() ? 0 : latencies.back(),
+	       statistics.max_queue);
+	printf("  chunks created per server:");
+	for (const ServerModel &server : servers) {
+		printf(" %lu", (unsigned long)server.chunks_created);
+	}
+	printf("\n");
+}
+
+static void usage(const char *appname) {
+	std::cerr << "Usage: " << appname << " [-p policy[,policy...]] [-s servers file] [-n chunks] "
+	          << "[-r chunks per second] [-g copies] [-c changelog] [-L load penalty] "
+	          << "[-R replication penalty] [-a acceptable difference]\n";
+}
+
+int main(int argc, char **argv) {
+	Options options;
+	int ch;
+	while ((ch = getopt(argc, argv, "p:s:n:r:g:c:L:R:a:h?")) != -1) {
+		switch (ch) {
+			case 'p':
+				options.policies = optarg;
+				break;
+			case 's':
+				options.servers_file = optarg;
+				break;
+			case 'n':
+				options.chunks = strtoull(optarg, nullptr, 10);
+				break;
+			case 'r':
+				options.rate = atof(optarg);
+				break;
+			case 'g':
+				options.copies = atoi(optarg);
+				break;
+			case 'c':
+				options.changelog = optarg;
+				break;
+			case 'L':
+				options.load_penalty = atof(optarg);
+				break;
+			case 'R':
+				options.replication_penalty = atof(optarg);
+				break;
+			case 'a':
+				options.acceptable_difference = atof(optarg);
+				break;
+			default:
+				usage(argv[0]);
+				return 1;
+		}
+	}
+	if (optind != argc || options.rate <= 0 || options.copies < 1) {
+		usage(argv[0]);
+		return 1;
+	}
+
+	std::vector<ServerModel> servers;
+	if (options.servers_file.empty()) {
+		servers = default_cluster();
+	} else if (!load_cluster(options.servers_file, servers)) {
+		return 1;
+	}
+
+	std::vector<WriteEvent> events;
+	if (options.changelog.empty()) {
+		events = synthetic_stream(options.chunks, options.rate);
+	} else if (!changelog_stream(options.changelog, events)) {
+		return 1;
+	}
+	printf("%zu servers, %zu chunk writes, %d copies\n", servers.size(), events.size(),
+	       options.copies);
+
+	std::istringstream policies(options.policies);
+	std::string name;
+	while (std::getline(policies, name, ',')) {
+		std::unique_ptr<ChunkPlacementPolicy> policy = createChunkPlacementPolicy(
+				name, options.load_penalty, options.replication_penalty);
+		if (!policy) {
+			std::cerr << "Unknown policy " << name << "\n";
+			return 1;
+		}
+		simulate(*policy, servers, events, options);
+	}
+	return 0;
+}
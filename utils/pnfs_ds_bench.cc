@@ -0,0 +1,244 @@
+/**
+ * Benchmark of the data path used by the pNFS data server of the nfs-ganesha plugin.
+ *
+ * Usage:
+ *  lizardfs-pnfs-ds-bench -H <master host> -P <master port> [-f file] [-S file size in MiB]
+ *                         [-t threads] [-b request size in KiB] [-n requests per thread]
+ *                         [-c chunk location cache timeout in ms] [-w]
+ *
+ * Connects to the master with liblizardfs-client and does what the data server does
+ * for each NFS request: reads (or writes) a range of a file using a descriptor shared by
+ * all requests for the file (the plugin keeps them in its fileinfo cache). Each thread
+ * sends requests for random aligned ranges of the file (in the root directory of the
+ * filesystem). With -w the file is first
+ * created and written by all threads, each writing every <threads>-th chunk (like
+ * data servers given a striped layout) and flushing it like a COMMIT does.
+ *
+ * Prints throughput of writes and reads and the chunk_location_cache statistics of
+ * the client, which show how often the master had to be asked for locations of chunks.
+ *
+ * The executable returns 0 on success and 1 on any error.
+ */
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "mount/client/lizardfs_c_api.h"
+
+static const uint64_t kChunkSize = 64 << 20;
+
+struct Options {
+	std::string host;
+	std::string port;
+	std::string file = "pnfs_ds_bench";
+	uint64_t file_size = 1024ULL << 20;
+	int threads = 8;
+	size_t request_size = 1 << 20;
+	int requests = 256;
+	unsigned location_cache_timeout_ms = 10000;
+	bool write = false;
+};
+
+static void usage(const char *appname) {
+	std::cerr << "Usage: " << appname << " -H <master host> -P <master port> [-f file] "
+	          << "[-S file size in MiB] [-t threads] [-b request size in KiB] "
+	          << "[-n requests per thread] [-c chunk location cache timeout in ms] [-w]\n";
+}
+
+static void print_error(const char *operation) {
+	std::cerr << operation << " failed: " << liz_error_string(liz_last_err()) << '\n';
+}
+
+static double mebibytes_per_second(uint64_t bytes, std::chrono::steady_clock::duration duration) {
+	return bytes / (1024. * 1024.) / std::chrono::duration<double>(duration).count();
+}
+
+static bool write_file(liz_t *liz, liz_fileinfo_t *fileinfo, const Options &options) {
+	std::atomic<bool> failed(false);
+	std::vector<std::thread> workers;
+	uint64_t chunks = (options.file_size + kChunkSize - 1) / kChunkSize;
+	for (int i = 0; i < options.threads; ++i) {
+		workers.emplace_back([=, &failed]() {
+			liz_context_t *ctx = liz_create_context();
+			std::vector<char> buffer(options.request_size, 'a' + i % 26);
+			for (uint64_t chunk = i; chunk < chunks && !failed; chunk += options.threads) {
+				uint64_t end = std::min(options.file_size, (chunk + 1) * kChunkSize);
+				for (uint64_t offset = chunk * kChunkSize; offset < end && !failed;
+						offset += options.request_size) {
+					size_t size = std::min<uint64_t>(options.request_size, end - offset);
+					if (liz_write(liz, ctx, fileinfo, offset, size, buffer.data()) != (ssize_t)size) {
+						print_error("write");
+						failed = true;
+					}
+				}
+				if (!failed && liz_flush(liz, ctx, fileinfo) != 0) {
+					print_error("flush");
+					failed = true;
+				}
+			}
+			liz_destroy_context(ctx);
+		});
+	}
+	for (auto &worker : workers) {
+		worker.join();
+	}
+	return !failed;
+}
+
+static bool read_file(liz_t *liz, liz_fileinfo_t *fileinfo, const Options &options) {
+	std::atomic<bool> failed(false);
+	std::vector<std::thread> workers;
+	uint64_t requests_in_file = options.file_size / options.request_size;
+	for (int i = 0; i < options.threads; ++i) {
+		workers.emplace_back([=, &failed]() {
+			liz_context_t *ctx = liz_create_context();
+			std::mt19937 generator(i);
+			std::vector<char> buffer(options.request_size);
+			for (int j = 0; j < options.requests && !failed; ++j) {
+				uint64_t offset = (generator() % requests_in_file) * options.request_size;
+				ssize_t size = liz_read(liz, ctx, fileinfo, offset, options.request_size,
+				                        buffer.data());
+				if (size != (ssize_t)options.request_size) {
+					if (size < 0) {
+						print_error("read");
+					} else {
+						std::cerr << "read at " << offset << " returned " << size << " bytes\n";
+					}
+					failed = true;
+				}
+			}
+			liz_destroy_context(ctx);
+		});
+	}
+	for (auto &worker : workers) {
+		worker.join();
+	}
+	return !failed;
+}
+
+static void print_location_cache_stats(liz_t *liz) {
+	// Statistics are copied to the stats tree periodically
+	sleep(1);
+	std::vector<char> buffer(1 << 20);
+	size_t size;
+	if (liz_get_stats(liz, buffer.data(), buffer.size(), &size) != 0) {
+		print_error("get stats");
+		return;
+	}
+	std::istringstream stats(std::string(buffer.data(), size));
+	std::string line;
+	while (std::getline(stats, line)) {
+		if (line.find("chunk_location_cache") != std::string::npos) {
+			std::cout << line << '\n';
+		}
+	}
+}
+
+int main(int argc, char **argv) {
+	Options options;
+	int ch;
+	while ((ch = getopt(argc, argv, "H:P:f:S:t:b:n:c:wh?")) != -1) {
+		switch (ch) {
+			case 'H':
+				options.host = optarg;
+				break;
+			case 'P':
+				options.port = optarg;
+				break;
+			case 'f':
+				options.file = optarg;
+				break;
+			case 'S':
+				options.file_size = strtoull(optarg, nullptr, 10) << 20;
+				break;
+			case 't':
+				options.threads = atoi(optarg);
+				break;
+			case 'b':
+				options.request_size = strtoul(optarg, nullptr, 10) << 10;
+				break;
+			case 'n':
+				options.requests = atoi(optarg);
+				break;
+			case 'c':
+				options.location_cache_timeout_ms = strtoul(optarg, nullptr, 10);
+				break;
+			case 'w':
+				options.write = true;
+				break;
+			default:
+				usage(argv[0]);
+				return 1;
+		}
+	}
+	if (options.host.empty() || options.port.empty() || options.threads <= 0
+			|| options.request_size == 0 || options.requests <= 0) {
+		usage(argv[0]);
+		return 1;
+	}
+
+	liz_init_params_t params;
+	liz_set_default_init_params(&params, options.host.c_str(), options.port.c_str(), "/");
+	params.chunk_location_cache_timeout_ms = options.location_cache_timeout_ms;
+	liz_t *liz = liz_init_with_params(&params);
+	if (liz == nullptr) {
+		print_error("connecting to master");
+		return 1;
+	}
+	liz_context_t *ctx = liz_create_context();
+	struct liz_entry entry;
+	bool ok = true;
+	if (options.write) {
+		liz_unlink(liz, ctx, LIZARDFS_INODE_ROOT, options.file.c_str());
+		ok = liz_mknod(liz, ctx, LIZARDFS_INODE_ROOT, options.file.c_str(), 0644, 0, &entry) == 0;
+	} else {
+		ok = liz_lookup(liz, ctx, LIZARDFS_INODE_ROOT, options.file.c_str(), &entry) == 0;
+		options.file_size = entry.attr.st_size;
+	}
+	liz_fileinfo_t *fileinfo = ok ? liz_open(liz, ctx, entry.ino, O_RDWR) : nullptr;
+	if (fileinfo == nullptr) {
+		print_error(options.file.c_str());
+		liz_destroy_context(ctx);
+		liz_destroy(liz);
+		return 1;
+	}
+
+	if (options.write) {
+		auto start = std::chrono::steady_clock::now();
+		ok = write_file(liz, fileinfo, options);
+		if (ok) {
+			std::cout << "write: " << mebibytes_per_second(options.file_size,
+			                  std::chrono::steady_clock::now() - start) << " MiB/s\n";
+		}
+	}
+	if (ok && options.file_size < options.request_size) {
+		std::cerr << "File " << options.file << " is smaller than a single request\n";
+		ok = false;
+	}
+	if (ok) {
+		auto start = std::chrono::steady_clock::now();
+		ok = read_file(liz, fileinfo, options);
+		if (ok) {
+			uint64_t bytes = uint64_t(options.threads) * options.requests * options.request_size;
+			std::cout << "read: " << mebibytes_per_second(bytes,
+			                 std::chrono::steady_clock::now() - start) << " MiB/s\n";
+			print_location_cache_stats(liz);
+		}
+	}
+
+	liz_release(liz, fileinfo);
+	liz_destroy_context(ctx);
+	liz_destroy(liz);
+	return ok ? 0 : 1;
+}